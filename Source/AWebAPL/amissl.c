@@ -31,6 +31,7 @@
 #include <sys/filio.h> /* For FIONBIO */
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <netinet/in.h> /* For sockaddr_in and ntohs() */
 /* struct timeval and fd_set are provided by <sys/socket.h> via
  * <proto/bsdsocket.h> */
 #include "aweb.h"
@@ -89,6 +90,16 @@ struct Assl {
   char cert_error_msg[256];    /* Error message from certificate validation */
   struct SignalSemaphore use_sema; /* Per-object semaphore to protect SSL object
                                       usage vs cleanup */
+  long port;     /* Peer port, for the session cache */
+  BOOL verified; /* Handshake completed and certificate accepted */
+};
+
+/* TLS session cache entry */
+struct Sslsession {
+  NODE(Sslsession);
+  UBYTE *hostname;
+  long port;
+  SSL_SESSION *session;
 };
 
 struct Library *AmiSSLMasterBase;
@@ -121,6 +132,16 @@ static BOOL ssl_init_sema_initialized = FALSE;
 static struct TaskRefCount *task_ref_list = NULL;
 static struct SignalSemaphore task_ref_sema = {0};
 
+/* TLS session cache. When a connection is closed or returned to the keep-alive
+ * pool, its session is kept per host and port, most recently used first. The
+ * next connection to that host offers it to skip the full handshake. */
+#define SSLSESSIONMAX 16
+static LIST(Sslsession) sslsessions;
+static long nrsslsessions = 0;
+static struct SignalSemaphore sslsession_sema;
+static ULONG sslsession_hits = 0;   /* Handshakes that resumed a session */
+static ULONG sslsession_misses = 0; /* Full handshakes */
+
 /* Static errno for main task's OpenAmiSSLTags() call */
 /* OpenAmiSSLTags() is called before we have a task ref entry, so we use a static errno */
 static int main_task_errno = 0;
@@ -138,6 +159,8 @@ static void InitSSLSemaphore(void) {
   if (!ssl_init_sema_initialized) {
     InitSemaphore(&ssl_init_sema);
     InitSemaphore(&task_ref_sema);
+    InitSemaphore(&sslsession_sema);
+    NEWLIST(&sslsessions);
     ssl_init_sema_initialized = TRUE;
     /* NOTE: debug_log_sema is initialized in Inithttp() in http.c, not here */
     /* We just use it here via the extern declaration */
@@ -968,6 +991,13 @@ static SSL_CTX *GetSharedSSLCTX(void) {
   /* Disable certificate verification (user will be prompted if needed) */
   SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, NULL);
   check_ssl_error("SSL_CTX_set_verify", AmiSSLBase);
+
+  /* Client sessions are kept in our own per-host cache, not in OpenSSL's.
+   * Session tickets are used unless built with NOSESSIONTICKETS. */
+  SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+#ifdef NOSESSIONTICKETS
+  SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+#endif
   
   /* Set cipher preferences - prioritize CHACHA20 over AES for better performance on older CPUs */
   /* TLS 1.2 and below: prioritize CHACHA20 ciphers */
@@ -1014,6 +1044,116 @@ static SSL_CTX *GetSharedSSLCTX(void) {
 
 /*-----------------------------------------------------------------------*/
 
+/* Find a cached session for this host and port, and move it to the head.
+ * Returns a new reference that the caller must free. */
+static SSL_SESSION *Getsslsession(UBYTE *hostname, long port) {
+  struct Sslsession *ss;
+  SSL_SESSION *session = NULL;
+  if (!ssl_init_sema_initialized || !hostname) return NULL;
+  ObtainSemaphore(&sslsession_sema);
+  for (ss = sslsessions.first; ss->next; ss = ss->next) {
+    if (ss->port == port && STRIEQUAL(ss->hostname, hostname)) {
+      REMOVE(ss);
+      ADDHEAD(&sslsessions, ss);
+      if (SSL_SESSION_up_ref(ss->session)) session = ss->session;
+      break;
+    }
+  }
+  ReleaseSemaphore(&sslsession_sema);
+  return session;
+}
+
+/* Remove the cached session for this host and port */
+static void Forgetsslsession(UBYTE *hostname, long port) {
+  struct Sslsession *ss;
+  if (!ssl_init_sema_initialized || !hostname) return;
+  ObtainSemaphore(&sslsession_sema);
+  for (ss = sslsessions.first; ss->next; ss = ss->next) {
+    if (ss->port == port && STRIEQUAL(ss->hostname, hostname)) {
+      REMOVE(ss);
+      nrsslsessions--;
+      SSL_SESSION_free(ss->session);
+      FREE(ss->hostname);
+      FREE(ss);
+      break;
+    }
+  }
+  ReleaseSemaphore(&sslsession_sema);
+}
+
+/* Keep this session for the host and port, replacing an older one. Takes
+ * over the reference. Drops the least recently used session if full. */
+static void Putsslsession(UBYTE *hostname, long port, SSL_SESSION *session) {
+  struct Sslsession *ss;
+  ObtainSemaphore(&sslsession_sema);
+  for (ss = sslsessions.first; ss->next; ss = ss->next) {
+    if (ss->port == port && STRIEQUAL(ss->hostname, hostname)) break;
+  }
+  if (ss->next) {
+    REMOVE(ss);
+    SSL_SESSION_free(ss->session);
+    ss->session = session;
+  } else if (ss = ALLOCSTRUCT(Sslsession, 1, MEMF_CLEAR)) {
+    if (ss->hostname = Dupstr(hostname, -1)) {
+      ss->port = port;
+      ss->session = session;
+      nrsslsessions++;
+    } else {
+      FREE(ss);
+      ss = NULL;
+    }
+  }
+  if (ss) {
+    ADDHEAD(&sslsessions, ss);
+    while (nrsslsessions > SSLSESSIONMAX && (ss = (struct Sslsession *)REMTAIL(&sslsessions))) {
+      nrsslsessions--;
+      SSL_SESSION_free(ss->session);
+      FREE(ss->hostname);
+      FREE(ss);
+    }
+  } else {
+    SSL_SESSION_free(session);
+  }
+  ReleaseSemaphore(&sslsession_sema);
+}
+
+/* Free all cached sessions */
+static void Freesslsessions(void) {
+  struct Sslsession *ss;
+  if (!ssl_init_sema_initialized) return;
+  ObtainSemaphore(&sslsession_sema);
+  while (ss = (struct Sslsession *)REMHEAD(&sslsessions)) {
+    SSL_SESSION_free(ss->session);
+    FREE(ss->hostname);
+    FREE(ss);
+  }
+  nrsslsessions = 0;
+  ReleaseSemaphore(&sslsession_sema);
+}
+
+/* Store the session of this connection in the cache, if the handshake was
+ * completed and the certificate accepted. */
+__asm void Assl_savesession(register __a0 struct Assl *assl) {
+  SSL_SESSION *session;
+  if (!assl || !AmiSSLBase) return;
+  ObtainSemaphore(&assl->use_sema);
+  if (!assl->closed && assl->ssl && assl->verified && assl->hostname && assl->port) {
+    if (session = SSL_get1_session(assl->ssl)) {
+      if (SSL_SESSION_is_resumable(session)) {
+        Putsslsession(assl->hostname, assl->port, session);
+      } else {
+        SSL_SESSION_free(session);
+      }
+    }
+  }
+  ReleaseSemaphore(&assl->use_sema);
+}
+
+void Assl_sessionstats(ULONG *hits, ULONG *misses) {
+  *hits = sslsession_hits;
+  *misses = sslsession_misses;
+}
+
 struct Assl *Assl_initamissl(struct Library *socketbase) {
   struct Assl *assl;
   struct Task *current_task;
@@ -1714,6 +1854,9 @@ __asm void Assl_closessl(register __a0 struct Assl *assl) {
       return;
     }
 
+    /* Keep the session for the next connection to this host */
+    Assl_savesession(assl);
+
     /* CRITICAL: Mark as closed NOW to prevent concurrent calls */
     assl->closed = TRUE;
 
@@ -1889,6 +2032,10 @@ __asm long Assl_connect(register __a0 struct Assl *assl,
   BOOL hostname_valid;
   BOOL chain_valid; /* Certificate chain validation result */
   SSL *local_ssl;     /* Local copy of SSL pointer for use after semaphore release */
+  SSL_SESSION *session; /* Cached session offered to the server */
+  BOOL resumed;
+  struct sockaddr_in sin;
+  LONG sinlen;
 
   debug_printf("DEBUG: Assl_connect: ENTRY - assl=%p, sock=%ld, hostname=%s\n",
                assl, sock, hostname ? (char *)hostname : "(NULL)");
@@ -1994,6 +2141,22 @@ __asm long Assl_connect(register __a0 struct Assl *assl,
     check_ssl_error("SSL_set_tlsext_host_name", AmiSSLBase);
   }
 
+  /* Offer the cached session for this host and port, if any */
+  assl->verified = FALSE;
+  assl->port = 0;
+  session = NULL;
+  sinlen = sizeof(sin);
+  if (getpeername(sock, (struct sockaddr *)&sin, &sinlen) == 0) {
+    assl->port = ntohs(sin.sin_port);
+  }
+  if (hostname && *hostname && assl->port &&
+      (session = Getsslsession(hostname, assl->port))) {
+    debug_printf("DEBUG: Assl_connect: Offering cached session for %s:%ld\n",
+                 hostname, assl->port);
+    SSL_set_session(local_ssl, session);
+    SSL_SESSION_free(session);
+  }
+
   /* Debug: Log protocol version settings for SSL object before connecting */
   {
     long min_proto = SSL_get_min_proto_version(local_ssl);
@@ -2033,10 +2196,23 @@ __asm long Assl_connect(register __a0 struct Assl *assl,
   if (ssl_result == 1) {
     debug_printf("DEBUG: Assl_connect: Handshake SUCCESS\n");
 
+    resumed = SSL_session_reused(local_ssl);
+    ObtainSemaphore(&sslsession_sema);
+    if (resumed) sslsession_hits++;
+    else sslsession_misses++;
+    ReleaseSemaphore(&sslsession_sema);
+
     /* Manually verify certificate chain AFTER handshake completes (prevents
      * deadlocks) */
     /* This validates: trusted CA, expiration, signature validity, etc. */
-    chain_valid = Verify_certificate_chain(local_ssl, assl->sslctx, AmiSSLBase);
+    /* A resumed session was only cached after its certificate was accepted
+     * on an earlier connection to this host, so the chain isn't checked again. */
+    if (resumed) {
+      debug_printf("DEBUG: Assl_connect: Session resumed, skipping chain verification\n");
+      chain_valid = TRUE;
+    } else {
+      chain_valid = Verify_certificate_chain(local_ssl, assl->sslctx, AmiSSLBase);
+    }
 
     cert_subj[0] = '\0'; /* Initialize */
     cert = SSL_get_peer_certificate(local_ssl);
@@ -2154,6 +2330,15 @@ __asm long Assl_connect(register __a0 struct Assl *assl,
     } else {
       result = ASSLCONNECT_FAIL;
     }
+
+    /* Don't offer the same session again when the caller retries */
+    if (session) {
+      Forgetsslsession(hostname, assl->port);
+    }
+  }
+
+  if (result == ASSLCONNECT_OK && hostname && *hostname) {
+    assl->verified = TRUE;
   }
 
   /* SocketBase remains set globally */
@@ -2929,6 +3114,9 @@ void Freeamissl(void)
    if (AmiSSLMasterBase && AmiSSLBase)
    {
       debug_printf("DEBUG: Freeamissl: Cleaning up AmiSSL\n");
+
+      /* Cached sessions must be freed while AmiSSL is still open */
+      Freesslsessions();
       
       /* CloseAmiSSL() must be called before closing amisslmaster.library */
       /* This cleans up AmiSSL internal resources and certificate cache */
@@ -2963,6 +3151,7 @@ struct Jumptab {
 /* Library jump table - referenced by awebamissllib structure for function
  * dispatch */
 static struct Jumptab jumptab[] = {
+    JMP, Assl_savesession,
     JMP, Assl_libname,  JMP, Assl_getcipher, JMP, Assl_read,
     JMP, Assl_write,    JMP, Assl_geterror,  JMP, Assl_connect,
     JMP, Assl_closessl, JMP, Assl_openssl,   JMP, Assl_cleanup,
@@ -1062,6 +1062,7 @@ static void Cleanup(void)
    Freemime();
    Freeboopsi();
    Freeauthor();
+   Stopnameserv();/* before Freeobject() because it disposes the prefetch task */
    Freetcp();     /* MUST be called before Freerequest(), Freeprefs() */
    Freecookie();
    if(aweb)
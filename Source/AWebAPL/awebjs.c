@@ -130,9 +130,15 @@ static __saveds __asm void delay(register __a0 struct Jcontext *jc)
    }
 }
 
+/* Elapsed time between two datestamps in ticks */
+static long Elapsed(struct DateStamp *from,struct DateStamp *to)
+{  return ((to->ds_Days-from->ds_Days)*24*60+(to->ds_Minute-from->ds_Minute))*60*TICKS_PER_SECOND
+      +(to->ds_Tick-from->ds_Tick);
+}
+
 void main()
-{  long args[4]={0};
-   UBYTE *argtemplate="FILES/M/A,PUBSCREEN/K,-D=DEBUG/S";
+{  long args[5]={0};
+   UBYTE *argtemplate="FILES/M/A,PUBSCREEN/K,-D=DEBUG/S,-A=AST/S,-T=TIME/S";
    struct RDArgs *rda;
    UBYTE **p;
    UBYTE *source;
@@ -144,6 +150,8 @@ void main()
    void *jv;
    void *dtbase;
    struct Jobject *jgscope[4];
+   struct DateStamp start,stop;
+   long ticks;
    
 /* window.class bug workaround */
 dtbase=OpenLibrary("datatypes.library",0);
@@ -187,6 +195,10 @@ dtbase=OpenLibrary("datatypes.library",0);
                if(args[2])
                {  Jdebug(jc,TRUE);
                }
+               if(args[3])
+               {  /* Run the parse tree, to compare with the bytecode */
+                  Jbytecode(jc,FALSE);
+               }
                for(p=(UBYTE **)args[0];*p;p++)
                {  if(f=fopen(*p,"r"))
                   {  fseek(f,0,SEEK_END);
@@ -195,7 +207,14 @@ dtbase=OpenLibrary("datatypes.library",0);
                      if(source=AllocVec(l+1,MEMF_PUBLIC|MEMF_CLEAR))
                      {  fread(source,l,1,f);
                         Jerrors(jc,TRUE,1,FALSE);
+                        DateStamp(&start);
                         Runjprogram(jc,jo,source,jo,jgscope,0,0);
+                        DateStamp(&stop);
+                        if(args[4])
+                        {  ticks=Elapsed(&start,&stop);
+                           fprintf(stderr,"%s: %ld.%02ld s\n",*p,
+                              ticks/TICKS_PER_SECOND,(ticks%TICKS_PER_SECOND)*2);
+                        }
                         FreeVec(source);
                      }
                      fclose(f);
@@ -85,6 +85,20 @@ struct Token
 typedef BOOL Jfeedback(struct Jcontext *jc);
 #define NUM_ERRORTYPES  6
 
+struct Gcstats             /* Garbage collector statistics, shown by the debugger */
+{  ULONG allocated;        /* Objects created */
+   ULONG minor;            /* Nursery collections */
+   ULONG major;            /* Completed marks of all objects */
+   ULONG slices;           /* Incremental mark steps */
+   ULONG youngfreed;       /* Objects swept from the nursery */
+   ULONG promoted;         /* Objects moved to the old generation */
+   ULONG oldfreed;         /* Objects swept from the old generation */
+   ULONG pauses;           /* Number of collector pauses */
+   ULONG pausesecs;        /* Total pause time */
+   ULONG pausemicros;
+   ULONG maxpause;         /* Longest pause in microseconds */
+};
+
 struct Jcontext
 {  void *pool;
    void *objpool;
@@ -99,6 +113,7 @@ struct Jcontext
    struct Variable *throw;    /* Variable holding last throw or runtime error object */
    struct Value *throwval;    /* pointer to jc->throw->val */
    struct Element *elt;       /* currently executing element */
+   struct Vmframe *vmframe;   /* Value stacks of running bytecode */
    LIST(This) thislist;       /* this stack */
    long gc;                   /* garbage collect if less than 0 */
    long nogc;                 /* don't auto gc if <0 */
@@ -136,14 +151,38 @@ struct Jcontext
    struct Jobject *regexp;    /* Standard Regular Expression function */
    struct Jobject *error;      /* Standard Error constructor function */
    struct Jobject *nativeErrors[NUM_ERRORTYPES]; /*Native error constructors */
+   LIST(Jscript) scripts;     /* Compiled script cache, most recently used first */
+   long nscripts;             /* Number of scripts in (scripts) */
+   long rundepth;             /* Nesting of Runjprogram() calls */
+   LIST(Jobject) young;       /* Nursery, objects created since last collection */
+   long nursery;              /* Objects to create between nursery collections */
+   struct Jobject **gcstack;  /* Objects marked but not yet scanned */
+   long gcsp;                 /* Number of objects on (gcstack) */
+   long gcstacksize;
+   struct Jobject **gcremember;  /* Old objects that got nursery references */
+   long gcnremember;
+   long gcremembersize;
+   long gcpromoted;           /* Objects promoted since the last full mark */
+   long gclimit;              /* Start a full mark after this many promotions */
+   USHORT gcphase;            /* See below */
+   struct Gcstats gcstats;
 };
 
 
 #define GC_THRESHOLD 256  /* 256 */        /* number of objects created before first garbage collection */
+#define GC_NURSERYMAX   4096     /* Largest nursery the survival rate can grow to */
+#define GC_SLICE        256      /* Minimum objects scanned per incremental mark step */
+#define GC_MAJORMIN     1024     /* Minimum promotions before a full mark starts */
+
+#define GCP_IDLE        0        /* No full mark running */
+#define GCP_MARK        1        /* Full mark running in steps */
 
 #define JCF_ERROR       0x0001   /* Compiler error occurred */
 #define JCF_IGNORE      0x0002   /* Ignore all errors */
 #define JCF_ERRORS      0x0004   /* Show compilation error requesters */
+#define JCF_BYTECODE    0x0008   /* Lower functions and loops to bytecode */
+#define JCF_FUNCTIONS   0x0010   /* Compiled source declared functions */
+#define JCF_KEEPPROGRAM 0x0020   /* Don't dispose program after execution */
 
 #define EXF_KEEPREF     0x0100   /* Variable reference is valid */
 #define EXF_CONSTRUCT   0x0200   /* Function was called as constructor */
@@ -179,6 +218,16 @@ struct Value
    } value;
 };
 
+/* String values point to the text of a Jstring. The buffer is shared
+ * between values by reference count, and may have room to append. */
+struct Jstring
+{  long refcount;
+   long length;      /* Length of text, not including the nul */
+   long size;        /* Space for text, including the nul */
+};
+
+#define JSTRING(s)      ((struct Jstring *)(s)-1)
+
 #define VTP_UNDEFINED   0
 #define VTP_NUMBER      1
 #define VTP_BOOLEAN     2
@@ -216,11 +265,15 @@ struct Variable
    void *hookdata;            /* Private data for use in hook */
    ULONG protkey;             /* Data protection key */
    USHORT flags;
+   struct Variable *hnext;    /* Next in owner's property hash chain */
+   ULONG hash;                /* Hash of (name) when owned by an object */
+   struct Jobject *owner;     /* Object having this as property or element */
 };
 
 #define VARF_HIDDEN     0x0001   /* Property is hidden (doesn't show up in for(in)) */
 #define VARF_SYNONYM    0x0002   /* Use variable pointed to by hookdata instead. */
 #define VARF_DONTDELETE 0x0004   /* Property cannot be deleted */
+#define VARF_LOCAL      0x0008   /* Local variable of a function on the stack */
 
 /* Hook function when property is added to object.
  * Returns TRUE if it understands the function, FALSE if default
@@ -256,12 +309,23 @@ struct Jobject
    long keepnr;               /* If >0, mark as used from here */
    BOOL notdisposed;          /* this is set to 1 and reset to 0 on disposal */
    struct Variable *var;      /* The variable this object is assigned to */
+   long nprops;               /* Number of properties in (properties) */
+   struct Variable **hash;    /* Property hash index, NULL if not built */
+   long hashsize;             /* Number of hash chains, power of 2 */
 };
 
+#define PROPHASH_MIN    8        /* Build hash index at this number of properties */
+
 #define OBJF_CLEARING   0x0001   /* Clearing this object */
 #define OBJF_TEMP       0x0002   /* Temporary object */
 #define OBJF_USED       0x0004   /* Don't sweep away */
 #define OBJF_ASFUNCTION 0x0008   /* Object may be called as function to obtain its properties */
+#define OBJF_BUILTINS   0x0010   /* Standard constructors were added to this scope */
+#define OBJF_YOUNG      0x0020   /* Object is in the nursery */
+#define OBJF_ESCAPED    0x0040   /* Nursery object was stored outside the roots */
+#define OBJF_LIVE       0x0080   /* Reached by the nursery collection */
+#define OBJF_GREY       0x0100   /* Object is on the mark stack */
+#define OBJF_REMEMBERED 0x0200   /* Old object referring to the nursery */
 
 #define OBJT_USER     0x10000000    /* User object (usually html DOM) */
 #define OBJT_GENERIC  0x00000000    /* Generic object */
@@ -416,6 +480,14 @@ struct Elementlist         /* A list type compiler element */
    LIST(Elementnode) subs; /* List of child element references */
 };
 
+struct Jscript             /* A compiled script in the script cache */
+{  NODE(Jscript);
+   ULONG hash;             /* Hash of (source) */
+   UBYTE *source;          /* Copy of the source */
+   struct Elementlist *program;
+   long busy;              /* Nr of runs using this program */
+};
+
 struct Elementfunc         /* A function [object] definition */
 {  UWORD type;            /* ET_FUNCTION */
    long generation;
@@ -522,6 +594,9 @@ enum ELEMENT_TYPES
    ET_IDENTIFIER,ET_REGEXP,ET_ARRAY,ET_OBJECTLIT,
    ET_LABEL,
 
+   /* Bytecode for the element in sub1. sub2 is the struct Bytecode */
+   ET_BYTECODE,
+
 #ifdef JSDEBUG
    ET_DEBUG,
 #endif
@@ -532,6 +607,82 @@ enum ELEMENT_TYPES
 
 /*-----------------------------------------------------------------------*/
 
+/* Jcompile() can lower function bodies and top level loops to bytecode
+ * for a value stack machine, see jvm.c. The element tree is kept with
+ * the bytecode for decompilation, the debugger and as fallback. */
+
+struct Binstr              /* A bytecode instruction */
+{  UWORD op;               /* Operation, see below */
+   UWORD slot;             /* Name slot, inline cache or loop number */
+   long arg;               /* Jump target, constant number, count or element type */
+   struct Element *elt;    /* Source element, for errors and fallbacks */
+};
+
+struct Propcache           /* Inline cache for a property lookup */
+{  struct Jobject *jo;     /* Object last looked up */
+   struct Variable *var;   /* Property found for (jo) */
+   UBYTE *name;            /* Fixed property name, or NULL */
+   ULONG stamp;            /* Value of (propstamp) when filled */
+};
+
+struct Bloop               /* Jump targets for completions of fallback statements */
+{  long brk;
+   long cont;
+};
+
+struct Bytecode
+{  struct Binstr *code;
+   long ncode;
+   struct Value *consts;   /* Constant values */
+   long nconsts;
+   UBYTE **names;          /* Variable names, by slot */
+   long nslots;
+   struct Propcache *caches;
+   long ncaches;
+   struct Bloop *loops;    /* Loops, numbered from 1 */
+   long nloops;
+   long maxstack;          /* Deepest value stack used */
+};
+
+enum BYTECODE_OPS
+{  BC_END=0,
+   BC_CONST,               /* Push consts[arg] */
+   BC_POP,                 /* Drop top value */
+   BC_SETVAL,              /* Pop statement value into jc->val */
+   BC_GETVAR,              /* Push variable (slot) */
+   BC_SETVAR,              /* Assign top to variable (slot) */
+   BC_ASGOPVAR,            /* Pop value, apply assignment operator (arg) to variable (slot) */
+   BC_DECLVAR,             /* Declare local variable (slot) */
+   BC_INITVAR,             /* Pop initial value into declared variable (slot) */
+   BC_INCVAR,              /* Increment/decrement (arg) variable (slot) */
+   BC_GETMEMBER,           /* Replace object by member, inline cache (slot) */
+   BC_SETMEMBER,           /* Pop value, replace object by assigned value */
+   BC_INCMEMBER,           /* Replace object by incremented/decremented (arg) member */
+   BC_GETINDEX,            /* Replace object and index by member, inline cache (slot) */
+   BC_SETINDEX,            /* Pop value, replace object and index by assigned value */
+   BC_INCINDEX,            /* Replace object and index by incremented/decremented member */
+   BC_BINARY,              /* Binary operator, (arg) is element type */
+   BC_UNARY,               /* Unary operator, (arg) is element type */
+   BC_JUMP,                /* Jump to (arg) */
+   BC_JUMPFALSE,           /* Pop and jump to (arg) if false */
+   BC_AND,                 /* Jump to (arg) keeping top if false, else pop */
+   BC_OR,                  /* Jump to (arg) keeping top if true, else pop */
+   BC_LOOP,                /* Jump back to (arg) unless stopped */
+   BC_CALL,                /* Call with (arg) arguments */
+   BC_EVAL,                /* Push value of element */
+   BC_EXEC,                /* Execute statement element within loop (slot) */
+   BC_RETURN,              /* Pop return value and return */
+   BC_RETURNUNDEF,         /* Return without value */
+};
+
+struct Vmframe             /* Value stack of a running bytecode, for the garbage collector */
+{  struct Vmframe *prev;
+   struct Value *stack;
+   long size;              /* Unused entries are undefined */
+};
+
+/*-----------------------------------------------------------------------*/
+
 typedef void Internfunc(void *);
 
 /* Runtime error type constants */
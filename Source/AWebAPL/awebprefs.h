@@ -242,6 +242,7 @@ struct Networkprefs
    BOOL autosearch;
    BOOL contanim;
    BOOL restrictimages;
+   BOOL pipelining;
    /* ext programs page */
    UBYTE *telnetcmd,*telnetargs;
    UBYTE *starttcpcmd,*starttcpargs;
@@ -258,6 +259,7 @@ struct Networkprefs
    UBYTE *cachepath;       /* cache's temp path */
    long camemsize;
    long cadisksize;
+   long capacksize;        /* pack objects up to this size (kB), 0 = off */
    long minfreechip,minfreefast;
    short caverify;
    BOOL fastresponse;
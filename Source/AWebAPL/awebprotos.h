@@ -403,6 +403,9 @@ extern UBYTE *Getjcookies(UBYTE *url);
    /* Flush all cookies beyond this memory limit */
 extern void Flushcookies(long max);
 
+   /* Forget cached Cookie: headers after cookie preferences changed */
+extern void Cookieprefschanged(void);
+
    /* Get/Set all cookies for ARexx */
 extern void Getrexxcookies(struct Arexxcmd *ac,UBYTE *stem);
 extern void Setrexxcookies(struct Arexxcmd *ac,UBYTE *stem,BOOL add);
@@ -430,6 +433,10 @@ extern long Textlength(struct RastPort *rp,UBYTE *text,long count);
    /* Calculate text length, and return real pixel length in (extent) */
 extern long Textlengthext(struct RastPort *rp,UBYTE *text,long count,long *extent);
 
+   /* Forget cached character widths of this font, or of all fonts if NULL.
+    * Call before the font is closed. */
+extern void Forgetfontwidths(struct TextFont *font);
+
 /*-----------------------------------------------------------------------*/
 /*-- event --------------------------------------------------------------*/
 /*-----------------------------------------------------------------------*/
@@ -574,6 +581,7 @@ extern void Httptask(struct Fetchdriver *fd);
 
    /* keep-alive connection management */
 extern void CloseIdleKeepAliveConnections(void);
+extern void Httpconnstats(ULONG *opened,ULONG *reused);
 
 /*-----------------------------------------------------------------------*/
 /*-- info ---------------------------------------------------------------*/
@@ -662,10 +670,23 @@ extern BOOL Isxbm(UBYTE *mimetype);
 
 extern BOOL Initnameserv(void);
 extern void Freenameserv(void);
+extern void Stopnameserv(void);
 
    /* Look up host name */
 extern struct hostent *Lookup(UBYTE *name,struct Library *base);
 
+   /* Resolve the host in this URL in the background */
+extern void Prefetchname(UBYTE *url);
+
+   /* Let following lookups of this host return its next address first */
+extern void Nextaddress(struct hostent *hent);
+
+   /* Use this function instead of the TCP stack to resolve names, and
+    * these times in seconds to keep resolved and failed names. NULL and 0
+    * restore the defaults. For testing. */
+typedef struct hostent *Nameresolver(UBYTE *name,struct Library *base);
+extern void Setnameresolver(Nameresolver *fun,long ttl,long negttl);
+
 /*-----------------------------------------------------------------------*/
 /*-- netstat ------------------------------------------------------------*/
 /*-----------------------------------------------------------------------*/
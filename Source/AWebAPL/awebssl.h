@@ -49,6 +49,10 @@ void Assl_closelibraries(struct Assl *assl);
 /* This is used at application shutdown to close unique library bases */
 void Assl_closelibrarybase(struct Library *library_base);
 
+/* Get the number of TLS handshakes that resumed a cached session, and the
+ * number of full handshakes */
+void Assl_sessionstats(ULONG *hits, ULONG *misses);
+
 /* SSL certificate acceptance function */
 BOOL Httpcertaccept(char *hostname, char *certname);
 
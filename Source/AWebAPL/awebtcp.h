@@ -74,6 +74,11 @@ char *Assl_getcipher(struct Assl *);
 
 char *Assl_libname(struct Assl *);
 
+/* Keep the session of this connection for the next connection to the same
+ * host and port. Called when the connection is kept alive; Assl_closessl()
+ * does this too. */
+void Assl_savesession(struct Assl *);
+
 
 /* Management functions */
 /* defined in awebtcp.c */
@@ -112,5 +117,6 @@ extern struct Assl *Tcpopenssl(struct Library *socketbase);
 #pragma libcall AwebSslBase Assl_read 42 09803
 #pragma libcall AwebSslBase Assl_getcipher 48 801
 #pragma libcall AwebSslBase Assl_libname 4e 801
+#pragma libcall AwebSslBase Assl_savesession 54 801
 
 #endif
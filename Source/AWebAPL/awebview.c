@@ -980,6 +980,7 @@ static void Cleanup(void)
    Freeboopsi();
 #ifndef LOCALONLY
    Freeauthor();
+   Stopnameserv();/* before Freeobject() because it disposes the prefetch task */
    Freetcp();     /* MUST be called before Freerequest(), Freeprefs() */
 #endif
    Freecookie();
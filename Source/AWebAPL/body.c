@@ -52,6 +52,12 @@
  * When AOBJ_Changedchild is set, the child is looked up and all remembered
  * lines after this child are removed. This ensures the next CHANGED methods
  * will start at or before the line containing the changed child.
+ *
+ * Lines are only added and removed at the end, in increasing y order, so
+ * they are kept in an array that can be searched by y. Children on a line
+ * don't reach above the line, nor below the next line unless that line has
+ * LINEF_MORE or LINEF_MARGIN set. HITTEST and RENDER use this to look only
+ * at the children of the lines in range.
  */
 
 /*------------------------------------------------------------------------*/
@@ -68,7 +74,8 @@ struct Body
    short hmargin,vmargin;     /* body's outer margins */
    USHORT flags;
    void *win;                 /* pass to childs */
-   LIST(Line) lines;          /* quick vertical index */
+   struct Line *lines;        /* quick vertical index, sorted by y */
+   long nlines,maxlines;      /* number of lines used and allocated */
    struct Element *chchild;   /* first changed child */
    long rendery;              /* Y position of first line to render CHANGED */
    LIST(Margin) leftmargins;  /* Left side floating margins */
@@ -172,10 +179,10 @@ struct Fontinfo               /* stacked character font info */
 #define FONTF_FACE      0x0008   /* face was expliticly set */
 
 struct Line
-{  NODE(Line);
-   struct Element *child;     /* First child on this line */
+{  struct Element *child;     /* First child on this line */
    long y;                    /* Smallest y coordinate on this line */
    long w;                    /* Width of this line */
+   long maxw;                 /* Maximum width of this and all previous lines */
    USHORT flags;
 };
 
@@ -231,7 +238,10 @@ struct Openfont *Addopenfont(struct Body *bd,struct TextFont *font)
 /* Close this font and dispose structure */
 void Freeopenfont(struct Openfont *of)
 {  if(of)
-   {  if(of->font) CloseFont(of->font);
+   {  if(of->font)
+      {  Forgetfontwidths(of->font);
+         CloseFont(of->font);
+      }
       FREE(of);
    }
 }
@@ -448,48 +458,46 @@ static BOOL Newbodybuild(struct Body *bd)
 /* Add a line index. */
 static struct Line *Addline(struct Body *bd,struct Element *child,long y,long w,
    BOOL more,BOOL margin)
-{  struct Line *line;
-   if(line=PALLOCSTRUCT(Line,1,MEMF_CLEAR,bd->pool))
-   {  line->y=y;
-      line->w=w;
-      line->child=child;
-      if(more) line->flags|=LINEF_MORE;
-      if(margin) line->flags|=LINEF_MARGIN;
-      ADDTAIL(&bd->lines,line);
-   }
+{  struct Line *line,*lines;
+   long max;
+   if(bd->nlines>=bd->maxlines)
+   {  max=2*bd->maxlines+32;
+      if(!(lines=PALLOCSTRUCT(Line,max,0,bd->pool))) return NULL;
+      if(bd->lines)
+      {  memcpy(lines,bd->lines,bd->nlines*sizeof(struct Line));
+         FREE(bd->lines);
+      }
+      bd->lines=lines;
+      bd->maxlines=max;
+   }
+   line=&bd->lines[bd->nlines];
+   line->y=y;
+   line->w=w;
+   line->maxw=w;
+   if(bd->nlines && line[-1].maxw>w) line->maxw=line[-1].maxw;
+   line->child=child;
+   line->flags=0;
+   if(more) line->flags|=LINEF_MORE;
+   if(margin) line->flags|=LINEF_MARGIN;
+   bd->nlines++;
    return line;
 }
 
-/* Remove all lines below this y. Remove all lines for this y except the last one. */
+/* Remove all lines below this y. Remove all lines for this y except the first one. */
 static void Removelinesbelow(struct Body *bd,long y)
-{  struct Line *line,*prev;
-   for(line=bd->lines.last;line->prev && line->y>y;line=prev)
-   {  prev=line->prev;
-      REMOVE(line);
-      FREE(line);
-   }
-   for(;line->prev && line->y==y;line=prev)
-   {  prev=line->prev;
-      if(prev->prev && prev->y==y)
-      {  REMOVE(line);
-         FREE(line);
-      }
-   }
+{  while(bd->nlines && bd->lines[bd->nlines-1].y>y) bd->nlines--;
+   while(bd->nlines>1 && bd->lines[bd->nlines-1].y==y
+   && bd->lines[bd->nlines-2].y==y) bd->nlines--;
 }
 
 /* Remove all lines from behind with one of these flags set */
 static void Removelinesflags(struct Body *bd,USHORT flags)
-{  struct Line *line,*prev;
-   for(line=bd->lines.last;line->prev && (line->flags&flags);line=prev)
-   {  prev=line->prev;
-      REMOVE(line);
-      FREE(line);
-   }
+{  while(bd->nlines && (bd->lines[bd->nlines-1].flags&flags)) bd->nlines--;
 }
 
 /* Find first child from last line, or first child if there are no lines. */
 static struct Element *Findchild(struct Body *bd)
-{  if(bd->lines.last->prev) return bd->lines.last->child;
+{  if(bd->nlines) return bd->lines[bd->nlines-1].child;
    else return bd->contents.first;
 }
 
@@ -509,25 +517,42 @@ static void Setchchild(struct Body *bd,struct Element *child)
    }
 }
 
-/* Find last line before this Y, with these flags unset.
- * Start from end because for long bodies it's faster and for shorter bodies
- * it doesn't differ much. */
+/* Find the number of lines that start at or before this Y. */
+static long Findlineindex(struct Body *bd,long y)
+{  long lo=0,hi=bd->nlines,mid;
+   while(lo<hi)
+   {  mid=(lo+hi)/2;
+      if(bd->lines[mid].y<=y) lo=mid+1;
+      else hi=mid;
+   }
+   return lo;
+}
+
+/* Find last line before this Y, with these flags unset. */
 static struct Line *Findlinebefore(struct Body *bd,long y,USHORT flags)
-{  struct Line *line;
-   for(line=bd->lines.last;line->prev;line=line->prev)
-   {  if(line->y<=y && !(line->flags&flags)) return line;
+{  long i;
+   for(i=Findlineindex(bd,y)-1;i>=0;i--)
+   {  if(!(bd->lines[i].flags&flags)) return &bd->lines[i];
    }
    return NULL;
 }
 
+/* Find the first child that can't reach up to this Y. Returns NULL if
+ * all children after the last line might. */
+static struct Element *Findchildbelow(struct Body *bd,long y)
+{  struct Line *line;
+   long i=Findlineindex(bd,y);
+   if(i>=bd->nlines) return NULL;
+   line=&bd->lines[i];
+   /* A multiline child continued on this line started above it */
+   if(line->flags&LINEF_MORE) return line->child->next;
+   return line->child;
+}
+
 /* Find the maximum width of all existing lines */
 static long Lineswidth(struct Body *bd)
-{  struct Line *line;
-   long w=0;
-   for(line=bd->lines.first;line->next;line=line->next)
-   {  if(line->w>w) w=line->w;
-   }
-   return w;
+{  if(bd->nlines) return bd->lines[bd->nlines-1].maxw;
+   return 0;
 }
 
 /*------------------------------------------------------------------------*/
@@ -824,8 +849,8 @@ static long Layoutbody(struct Body *bd,struct Amlayout *amlp)
    }
    /* If there is a last line, use its Y as starting Y. Remove the line, a new
     * one will be added in the process. */
-   if(bd->lines.last->prev)
-   {  line=bd->lines.last;
+   if(bd->nlines)
+   {  line=&bd->lines[bd->nlines-1];
       y=bd->rendery=line->y;
       child=line->child;
       /* If a FITHEIGHT layout is requested, check if we are not already too high */
@@ -833,8 +858,7 @@ static long Layoutbody(struct Body *bd,struct Amlayout *amlp)
       {  bd->aoh=y;
          return 0;
       }
-      REMOVE(line);
-      FREE(line);
+      bd->nlines--;
    }
    else
    {  /* Start Y position includes top padding */
@@ -1424,7 +1448,7 @@ if(SetSignal(0,0)&SIGBREAKF_CTRL_C) return 0;
 
 static long Renderbody(struct Body *bd,struct Amrender *amr)
 {  struct Coords *coo;
-   struct Element *child;
+   struct Element *child,*endchild;
    struct Line *line;
    USHORT flags=amr->flags&~AMRF_CLEAR;
    short bgcolor;
@@ -1575,8 +1599,13 @@ static long Renderbody(struct Body *bd,struct Amrender *amr)
          }
       }
       else
-      {  /* Normal rendering without scroll offset */
-         for(;child->next;child=child->next)
+      {  /* Normal rendering without scroll offset. Skip the lines outside
+          * the clip rectangle. */
+         if((line=Findlinebefore(bd,clipMinY,LINEF_MORE|LINEF_MARGIN)) && line->y>y)
+         {  child=line->child;
+         }
+         endchild=Findchildbelow(bd,clipMaxY);
+         for(;child->next && child!=endchild;child=child->next)
          {  /* Apply overflow clipping to child rendering */
             if(child->aox<=clipMaxX && child->aox+child->aow>clipMinX 
             && child->aoy<=clipMaxY && child->aoy+child->aoh>clipMinY)
@@ -2182,7 +2211,7 @@ static long Setbody(struct Body *bd,struct Amset *ams)
 static void Disposebody(struct Body *bd)
 {  void *p;
    while(p=REMHEAD(&bd->contents)) Adisposeobject(p);
-   while(p=REMHEAD(&bd->lines)) FREE(p);
+   if(bd->lines) FREE(bd->lines);
    while(p=REMHEAD(&bd->leftmargins)) FREE(p);
    while(p=REMHEAD(&bd->rightmargins)) FREE(p);
    while(p=REMHEAD(&bd->openfonts)) Freeopenfont(p);
@@ -2213,7 +2242,6 @@ static struct Body *Newbody(struct Amset *ams)
 {  struct Body *bd;
    if(bd=Allocobject(AOTP_BODY,sizeof(struct Body),ams))
    {  NEWLIST(&bd->contents);
-      NEWLIST(&bd->lines);
       NEWLIST(&bd->leftmargins);
       NEWLIST(&bd->rightmargins);
       NEWLIST(&bd->openfonts);
@@ -2438,7 +2466,8 @@ static long Getbody(struct Body *bd,struct Amset *ams)
 static long Hittestbody(struct Body *bd,struct Amhittest *amh)
 {  long result=0;
    struct Coords *coo,coords={0};
-   struct Element *child;
+   struct Element *child,*endchild;
+   struct Line *line;
    long x,y;
    if(!(coo=amh->coords))
    {  Framecoords(bd->cframe,&coords);
@@ -2447,7 +2476,11 @@ static long Hittestbody(struct Body *bd,struct Amhittest *amh)
    if(coo->win)
    {  x=amh->xco-coo->dx;
       y=amh->yco-coo->dy;
-      for(child=bd->contents.first;child->next;child=child->next)
+      /* Only children of the lines around y can contain it */
+      if(line=Findlinebefore(bd,y,LINEF_MORE|LINEF_MARGIN)) child=line->child;
+      else child=bd->contents.first;
+      endchild=Findchildbelow(bd,y);
+      for(;child->next && child!=endchild;child=child->next)
       {  if(y>=child->aoy && y<child->aoy+child->aoh
          && x>=child->aox && x<child->aox+child->aow)
          {  result=Ahittest(child,coo,amh->xco,amh->yco,amh->flags,amh->oldobject,amh->amhr);
@@ -222,6 +222,7 @@ void Opencabrowse(void)
    }
    else
    {  if(cabrwindow) Adisposeobject(cabrwindow);
+      Completecache();
       cabrwindow=Anewobject(AOTP_CABROWSE,TAG_END);
    }
 #endif
@@ -346,7 +346,8 @@ static struct Node *Allocbrnode(struct Cabrwindow *cbw,struct Cache *cac)
       Lprintdate(ci->datebuf,Locale()->loc_ShortDateFormat,&ds);
       sprintf(ci->sizebuf,"%d",cac->disksize);
       for(i=0;cac->mimetype[i];i++) ci->typebuf[i]=tolower(cac->mimetype[i]);
-      strncpy(ci->filebuf,cbw->cfnameshort(cac->name),sizeof(ci->filebuf)-1);
+      strncpy(ci->filebuf,cbw->cfnameshort(cac->name?cac->name:cac->pack.seg->name),
+         sizeof(ci->filebuf)-1);
       if(!((node=(struct Node *)AllocListBrowserNode(5,
          LBNA_UserData,ci,
          LBNA_Column,0,
@@ -372,7 +373,7 @@ static void Allocnodes(struct Cabrwindow *cbw,struct List *list)
    struct Cache *cac;
    ObtainSemaphore(cbw->cachesema);
    for(cac=cbw->cache->first;cac->next;cac=cac->next)
-   {  if(cac->name)  /* We have a file */
+   {  if(cac->name || cac->pack.seg)  /* We have a file */
       {  if(node=Allocbrnode(cbw,cac))
          {  AddTail(list,node);
             cbw->nrfiles++;
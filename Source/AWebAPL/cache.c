@@ -24,6 +24,8 @@
 #include "asyncio.h"
 #include "window.h"
 #include "arexx.h"
+#include "capack.h"
+#include "casnap.h"
 #include <libraries/locale.h>
 #include <proto/exec.h>
 #include <proto/dos.h>
@@ -45,8 +47,31 @@ static BOOL initializing,exitting;
 static long nradded=0;
 static long sizeadded=0;
 
-#define NRCHKPT   100      /* Nr of files to add before saving AWCR again */
+#define NRCHKPT   100      /* Nr of files to add before saving AWCS again */
 #define CHKAFTER  102400   /* Nr of bytes to add before flushing excess */
+#define FLUSHTO   90       /* Percentage of max size to flush down to */
+#define PROTECTED 80       /* Percentage of max size for reused files */
+#define AGEDAYS   30       /* Days without use before a file loses its hits */
+#define PACKSTEP  32768    /* Nr of bytes to compact after each file added */
+
+static struct Caevict caevict;
+static struct Capack capack;
+
+/* Entry in the snapshot that has no Cache object yet. Its Caentry has
+ * no userdata. */
+struct Caslot
+{  struct Caentry ce;            /* Eviction order, size and last access. */
+   struct Caploc pack;           /* Location if stored in a pack file. */
+   struct Csnapentry *entry;     /* NULL when made into a Cache object or deleted. */
+};
+
+static struct Casnap casnap;
+static UBYTE *snapblock;         /* Snapshot as read */
+static struct Csnapentry **snapentries;
+static struct Caslot *snapslots;
+static long snapcount;           /* Nr of slots */
+static ULONG snapserial;         /* Serial of last snapshot */
+static BOOL snapbusy;            /* Don't look up new URLs */
 
 struct SignalSemaphore cachesema;
 
@@ -72,17 +97,35 @@ static UBYTE *Makename(UBYTE *file,UBYTE *ext)
    return name;
 }
 
+/* Name of the own file of cache object (nr). Dynamic string. */
+static UBYTE *Cachefilename(ULONG nr,UBYTE *url,UBYTE *mimetype)
+{  UBYTE *ext,*name;
+   UBYTE buf[20];
+   ext=Urlfileext(url);
+   if(!ext && Isxbm(mimetype)) ext=Dupstr("xbm",3);
+   sprintf(buf,"AWCD%02X/%08X",nr&0x3f,nr);
+   name=Makename(buf,ext);
+   if(ext) FREE(ext);
+   return name;
+}
+
 /*------------------------------------------------------------------------*/
 
 struct Creghdr          /* Cache registration header */
 {  UBYTE label[4];      /* 'AWCR' */
    long version;        /* CACHEVERSION */
    ULONG lastnr;        /* last nr used */
+   /* version 7: followed by ULONG serial of the snapshot it follows */
 };
 
-#define CACHEVERSION    4
+/* Up to version 6 the registration (AWCR) holds all entries, and AWCU is
+ * AWCR with entries appended since. From version 7 all entries are in the
+ * snapshot (AWCS, see casnap.h) and AWCU only holds the entries since. */
+#define CACHEVERSION    7
 
-struct Cregentry        /* Cache registration entry version 3/4 */
+static long regversion; /* Version of registration read */
+
+struct Cregentry        /* Cache registration entry version 3/4/5/6/7 */
 {  ULONG nr;            /* nr of file */
    ULONG date;          /* date stamp */
    ULONG expires;       /* expiry date stamp */
@@ -93,6 +136,21 @@ struct Cregentry        /* Cache registration entry version 3/4 */
    /* followed by MIME type '\0' terminated (max 32 bytes) */
    /* followed by URL '\0' terminated (urlsize bytes) */
    /* if COTYPE_MOVED followed by movedto URL '\0' terminated */
+   /* version 4: followed by ETag '\0' terminated (max 64 bytes) */
+   /* version 5: followed by struct Cregaccess */
+   /* version 6: followed by struct Cregpack */
+};
+
+struct Cregaccess       /* Cache registration access info version 5 */
+{  ULONG atime;         /* last access */
+   ULONG hits;          /* nr of uses after the first */
+};
+
+struct Cregpack         /* Cache registration pack location version 6 */
+{  ULONG segnr;         /* nr of pack file, or 0 if in own file */
+   long offset;         /* offset of record in pack file */
+   long length;         /* object length */
+   ULONG checksum;      /* object checksum */
 };
 
 #define COTYPE_MOVED       1     /* used in AWCR */
@@ -107,11 +165,13 @@ static BOOL Readcachereg(UBYTE *name,long lock)
    long filesize=0,readsize=0,nextsize=0;
    struct Creghdr crh;
    struct Cregentry cre;
-   UBYTE mimetype[32],*p;
+   struct Cregaccess cra;
+   struct Cregpack crp;
+   UBYTE mimetype[32],etag[64],*p;
    short i;
-   UBYTE *urlbuf=NULL,*ext;
-   UBYTE buf[20];
+   UBYTE *urlbuf=NULL;
    long urlbuflen=0;
+   ULONG serial;
    void *url;
    struct Cache *cac;
    BOOL ok=TRUE;
@@ -128,9 +188,21 @@ static BOOL Readcachereg(UBYTE *name,long lock)
       ok=FALSE;
       if(!STRNEQUAL(crh.label,"AWCR",4)) goto err;
       if(crh.version<3 || crh.version>CACHEVERSION) goto err;
-      ok=TRUE;
-      cachenr=crh.lastnr;
       readsize=sizeof(crh);
+      if(crh.version>=7)
+      {  /* A log without its snapshot is useless. A log that doesn't follow
+          * the snapshot is from before it, and already in it. Then a new
+          * log must be started. */
+         if(!snapblock) goto err;
+         ok=TRUE;
+         regversion=0;
+         if(ReadAsync(fh,&serial,sizeof(serial))!=sizeof(serial)) goto err;
+         if(serial!=snapserial) goto err;
+         readsize+=sizeof(serial);
+      }
+      ok=TRUE;
+      regversion=crh.version;
+      if(crh.lastnr>cachenr) cachenr=crh.lastnr;
       while(ReadAsync(fh,&cre,sizeof(cre))==sizeof(cre))
       {  readsize+=sizeof(cre);
          if(cre.type<0 || cre.type>MAX_COTYPE) goto err;
@@ -148,6 +220,31 @@ static BOOL Readcachereg(UBYTE *name,long lock)
          }
          if(ReadAsync(fh,urlbuf,cre.urlsize)!=cre.urlsize) goto err;
          readsize+=cre.urlsize;
+         /* Read ETag if version >= 4. It is written for all entries. */
+         etag[0]='\0';
+         if(crh.version>=4)
+         {  p=etag;
+            i=0;
+            do
+            {  if(ReadAsync(fh,p,1)!=1) goto err;
+               readsize+=1;
+               i++;
+            } while(*p++ && i<64); /* loop until nullbyte read */
+            if(p[-1]) goto err;
+         }
+         /* Read access info if version >= 5, else assume no reuse */
+         cra.atime=cre.cachedate;
+         cra.hits=0;
+         if(crh.version>=5)
+         {  if(ReadAsync(fh,&cra,sizeof(cra))!=sizeof(cra)) goto err;
+            readsize+=sizeof(cra);
+         }
+         /* Read pack location if version >= 6, else own file */
+         crp.segnr=0;
+         if(crh.version>=6)
+         {  if(ReadAsync(fh,&crp,sizeof(crp))!=sizeof(crp)) goto err;
+            readsize+=sizeof(crp);
+         }
          if(cre.type==COTYPE_DEL)
          {  if(!(url=Findurl("",urlbuf,0))) goto err;
             cac=(struct Cache *)Agetattr(url,AOURL_Cache);
@@ -156,12 +253,14 @@ static BOOL Readcachereg(UBYTE *name,long lock)
             }
          }
          else
-         {  if(!(url=Anewobject(AOTP_URL,AOURL_Url,urlbuf,TAG_END))) goto err;
-            ext=Urlfileext(urlbuf);
-            if(!ext && Isxbm(mimetype)) ext=Dupstr("xbm",3);
-            sprintf(buf,"AWCD%02X/%08X",cre.nr&0x3f,cre.nr);
-            p=Makename(buf,ext);
-            if(ext) FREE(ext);
+         {  if(!(url=Findurl("",urlbuf,0))) goto err;
+            /* This entry replaces an earlier one for the URL */
+            if(cac=(struct Cache *)Agetattr(url,AOURL_Cache))
+            {  if(cac->nr==cre.nr) cac->flags|=CACF_NODELETE;
+               Auspecial(url,AUMST_DELETECACHE);
+            }
+            p=NULL;
+            if(!crp.segnr) p=Cachefilename(cre.nr,urlbuf,mimetype);
             if(cre.expires && cre.expires<=Today())
             {  if(p)
                {  DeleteFile(p);
@@ -175,6 +274,10 @@ static BOOL Readcachereg(UBYTE *name,long lock)
                   AOCAC_Cachedate,cre.cachedate,
                   TAG_END))) goto err;
                cac->name=p;
+               if(crp.segnr)
+               {  if(!Capackload(&capack,&cac->pack,crp.segnr,crp.offset,crp.length,crp.checksum))
+                     goto err;
+               }
                cac->date=cre.date;
                cac->expires=cre.expires;
                strcpy(cac->mimetype,mimetype);
@@ -192,26 +295,18 @@ static BOOL Readcachereg(UBYTE *name,long lock)
                {  /* Don't restore temporary moves from cache - they should not be cached.
                     * Clear any existing temporary move state. */
                }
-               /* Read ETag if version >= 4 */
-               if(crh.version>=4)
-               {  UBYTE etagbuf[64];
-                  UBYTE *ep=etagbuf;
-                  i=0;
-                  do
-                  {  if(ReadAsync(fh,ep,1)!=1) goto err;
-                     readsize+=1;
-                     i++;
-                  } while(*ep++ && i<64); /* loop until nullbyte read */
-                  if(i>=64) goto err;
-                  strcpy(cac->etag,etagbuf);
-               }
-               else
-               {  /* Version 3: no ETag, initialize to empty */
-                  cac->etag[0]='\0';
-               }
+               strcpy(cac->etag,etag);
+               /* Files not used for a long time start over in probation */
+               cac->ce.atime=cra.atime;
+               if(cra.atime+AGEDAYS*86400<Today()) cra.hits=0;
+               cac->ce.hits=MIN(cra.hits,0xffff);
+               Caesetsize(&caevict,&cac->ce,cac->disksize);
+               Caeadd(&caevict,&cac->ce);
                if(cre.nr>cachenr) cachenr=cre.nr;
             }
          }
+         /* Entries in the log count towards the next checkpoint */
+         nradded++;
          if(readsize>nextsize)
          {  Setloadreqlevel(readsize,filesize);
             nextsize+=filesize/10;
@@ -242,7 +337,7 @@ static void Createdirectories(void)
 #endif
 }
 
-/* Create an empty cache registration */
+/* Create an empty log following the last snapshot */
 static void Createlog(UBYTE *name)
 {
 #ifndef LOCALONLY
@@ -253,6 +348,7 @@ static void Createlog(UBYTE *name)
       crh.version=CACHEVERSION;
       crh.lastnr=cachenr;
       WriteAsync(fh,&crh,sizeof(crh));
+      WriteAsync(fh,&snapserial,sizeof(snapserial));
       CloseAsync(fh);
    }
 #endif
@@ -263,6 +359,8 @@ static void Writeregentry(void *fh,struct Cache *cac,BOOL del)
 {
 #ifndef LOCALONLY
    struct Cregentry cre;
+   struct Cregaccess cra;
+   struct Cregpack crp;
    short urlsize,movedsize;
    UBYTE *url=(UBYTE *)Agetattr(cac->url,AOURL_Realurl);
    UBYTE *movedto=NULL;
@@ -292,40 +390,126 @@ static void Writeregentry(void *fh,struct Cache *cac,BOOL del)
    if(movedto && !del) WriteAsync(fh,movedto,movedsize);
    /* Write ETag (version 4) */
    WriteAsync(fh,cac->etag,strlen(cac->etag)+1);
+   /* Write access info (version 5) */
+   cra.atime=cac->ce.atime;
+   cra.hits=cac->ce.hits;
+   WriteAsync(fh,&cra,sizeof(cra));
+   /* Write pack location (version 6) */
+   crp.segnr=cac->pack.seg?cac->pack.seg->nr:0;
+   crp.offset=cac->pack.offset;
+   crp.length=cac->pack.length;
+   crp.checksum=cac->pack.checksum;
+   WriteAsync(fh,&crp,sizeof(crp));
 #endif
 }
 
+#ifndef LOCALONLY
+static long Writesnap(void *fh,void *data,long length)
+{  return WriteAsync(fh,data,length);
+}
+
+/* Count, or write to (w), the snapshot entries. They are in eviction order
+ * so that order is restored when the snapshot is read. Objects that are
+ * still being written aren't included. */
+static long Snapshotentries(struct Casnapwriter *w,BOOL nodelete)
+{  struct Caentry *ce;
+   struct Cache *cac;
+   struct Caslot *slot;
+   struct Csnapentry e;
+   UBYTE *url,*movedto;
+   long n=0;
+   short i;
+   for(i=0;i<2;i++)
+   {  for(ce=i?caevict.protected.first:caevict.probation.first;ce->next;ce=ce->next)
+      {  if(cac=(struct Cache *)ce->userdata)
+         {  if(cac!=(struct Cache *)Agetattr(cac->url,AOURL_Cache)) continue;
+            url=(UBYTE *)Agetattr(cac->url,AOURL_Realurl);
+            movedto=(UBYTE *)Agetattr(cac->url,AOURL_Movedto);
+            if(!Casnapentrysize(url,movedto,cac->mimetype,cac->etag)) continue;
+            if(w)
+            {  e.nr=cac->nr;
+               e.date=cac->date;
+               e.expires=cac->expires;
+               e.cachedate=cac->cachedate;
+               e.size=cac->disksize;
+               e.atime=ce->atime;
+               e.hits=ce->hits;
+               e.type=movedto?COTYPE_MOVED:0;
+               e.segnr=cac->pack.seg?cac->pack.seg->nr:0;
+               e.packoffset=cac->pack.offset;
+               e.packlength=cac->pack.length;
+               e.packsum=cac->pack.checksum;
+               Casnapadd(w,&e,url,movedto,cac->mimetype,cac->etag);
+               if(nodelete) cac->flags|=CACF_NODELETE;
+            }
+         }
+         else
+         {  slot=(struct Caslot *)ce;
+            if(w)
+            {  e=*slot->entry;
+               e.atime=ce->atime;
+               e.hits=ce->hits;
+               e.segnr=slot->pack.seg?slot->pack.seg->nr:0;
+               e.packoffset=slot->pack.offset;
+               e.packlength=slot->pack.length;
+               e.packsum=slot->pack.checksum;
+               Casnapadd(w,&e,Casnapurl(slot->entry),Casnapmovedto(slot->entry),
+                  Casnapmimetype(slot->entry),Casnapetag(slot->entry));
+            }
+         }
+         n++;
+      }
+   }
+   return n;
+}
+#endif
+
+/* Write a new snapshot and start a new log */
 static void Savecachereg(BOOL nodelete)
 {
 #ifndef LOCALONLY
-   UBYTE *name;
+   UBYTE *name,*snapname=NULL,*p;
    void *fh;
-   struct Creghdr crh;
+   struct Casnapwriter w;
    struct Cache *cac,*ucac;
+   ULONG *buckets;
+   long n;
    BOOL ok=FALSE;
-   if(name=Makename("AWCR",NULL))
+   ObtainSemaphore(&cachesema);
+   n=Snapshotentries(NULL,FALSE);
+   if((name=Makename("AWCN",NULL)) && (snapname=Makename("AWCS",NULL))
+   && (buckets=ALLOCTYPE(ULONG,Casnapbuckets(n),0)))
    {  if(fh=OpenAsync(name,MODE_WRITE,FILEBLOCKSIZE))
-      {  strncpy(crh.label,"AWCR",4);
-         crh.version=CACHEVERSION;
-         crh.lastnr=cachenr;
-         WriteAsync(fh,&crh,sizeof(crh));
-         for(cac=cache.first;cac->next;cac=cac->next)
-         {  ucac=(struct Cache *)Agetattr(cac->url,AOURL_Cache);
-            if(cac==ucac)
-            {  Writeregentry(fh,cac,FALSE);
-               if(nodelete) cac->flags|=CACF_NODELETE;
-            }
+      {  Casnapstart(&w,Writesnap,fh,buckets,n,snapserial+1,cachenr);
+         Snapshotentries(&w,nodelete);
+         ok=Casnapend(&w);
+         if(CloseAsync(fh)<0) ok=FALSE;
+         if(ok)
+         {  /* Rename() doesn't replace a file. If we crash before it is
+             * renamed, Initcache() does it. */
+            DeleteFile(snapname);
+            ok=Rename(name,snapname);
          }
-         ok=TRUE;
-         if(CloseAsync(fh)>=0)
-         {  DeleteFile(awcuname);
+         if(ok)
+         {  snapserial++;
+            Createlog(awcuname);
+            /* Registration of an earlier version is no longer needed,
+             * nor are empty pack files */
+            if(p=Makename("AWCR",NULL))
+            {  DeleteFile(p);
+               FREE(p);
+            }
+            Capackpurge(&capack);
          }
          else
          {  DeleteFile(name);
          }
       }
-      FREE(name);
+      FREE(buckets);
    }
+   if(name) FREE(name);
+   if(snapname) FREE(snapname);
+   ReleaseSemaphore(&cachesema);
    if(nodelete && !ok)
    {  for(cac=cache.first;cac->next;cac=cac->next)
       {  ucac=(struct Cache *)Agetattr(cac->url,AOURL_Cache);
@@ -337,6 +521,15 @@ static void Savecachereg(BOOL nodelete)
 #endif
 }
 
+/* Save a snapshot and continue with a new log */
+static void Checkpoint(void)
+{
+#ifndef LOCALONLY
+   Savecachereg(FALSE);
+   nradded=0;
+#endif
+}
+
 /* Add an entry to the registration */
 static void Addregentry(struct Cache *cac,BOOL del)
 {
@@ -347,16 +540,159 @@ static void Addregentry(struct Cache *cac,BOOL del)
       {  Writeregentry(fh,cac,del);
          CloseAsync(fh);
       }
-      if(++nradded>NRCHKPT)
-      {  UBYTE *awcrname=Makename("AWCR",NULL);  
-         if(awcrname)
-         {  Savecachereg(FALSE);
-            Rename(awcrname,awcuname);
-            FREE(awcrname);
-            nradded=0;
+      if(++nradded>NRCHKPT) Checkpoint();
+   }
+#endif
+}
+
+/*------------------------------------------------------------------------*/
+
+/* Entries in the snapshot only get a Cache object when their URL is
+ * created, or when all objects are needed. Until then they are only
+ * a slot in the eviction lists and, if packed, in their pack file. */
+
+#ifndef LOCALONLY
+static void Freesnapshot(void)
+{  if(snapslots) FREE(snapslots);
+   if(snapentries) FREE(snapentries);
+   if(snapblock) FREE(snapblock);
+   snapslots=NULL;
+   snapentries=NULL;
+   snapblock=NULL;
+   snapcount=0;
+}
+
+/* Read the snapshot and add its entries as slots */
+static BOOL Loadsnapshot(UBYTE *name,long lock)
+{  struct FileInfoBlock *fib;
+   struct Csnapentry *e;
+   struct Caslot *slot;
+   long size=0,n,i,fh;
+   ULONG today=Today();
+   BOOL ok=FALSE;
+   if(fib=AllocDosObject(DOS_FIB,TAG_END))
+   {  if(Examine(lock,fib)) size=fib->fib_Size;
+      FreeDosObject(DOS_FIB,fib);
+   }
+   if(size>0 && (snapblock=ALLOCTYPE(UBYTE,size,0)))
+   {  if(fh=Open(name,MODE_OLDFILE))
+      {  if(Read(fh,snapblock,size)==size
+         && (n=Casnapcount(snapblock,size))>=0
+         && (snapentries=ALLOCTYPE(struct Csnapentry *,n+1,0))
+         && (snapslots=ALLOCSTRUCT(Caslot,n+1,MEMF_CLEAR))
+         && Casnapinit(&casnap,snapblock,size,snapentries))
+         {  for(i=0;i<n;i++)
+            {  e=snapentries[i];
+               slot=&snapslots[i];
+               if(e->segnr && !Capackload(&capack,&slot->pack,e->segnr,
+                  e->packoffset,e->packlength,e->packsum)) continue;
+               slot->entry=e;
+               /* Files not used for a long time start over in probation */
+               slot->ce.atime=e->atime;
+               slot->ce.hits=(e->atime+AGEDAYS*86400<today)?0:e->hits;
+               Caesetsize(&caevict,&slot->ce,e->size);
+               Caeadd(&caevict,&slot->ce);
+               cadisksize+=e->size;
+               if(e->nr>cachenr) cachenr=e->nr;
+            }
+            if(casnap.hdr->lastnr>cachenr) cachenr=casnap.hdr->lastnr;
+            snapserial=casnap.hdr->serial;
+            snapcount=n;
+            ok=TRUE;
          }
+         Close(fh);
       }
    }
+   if(!ok) Freesnapshot();
+   return ok;
+}
+
+/* Create the Cache object for a slot. Returns NULL if the entry turns
+ * out to be useless, it is deleted then. */
+static struct Cache *Makecache(struct Caslot *slot,void *url)
+{  struct Csnapentry *e=slot->entry;
+   struct Cache *cac,*ucac;
+   UBYTE *name=NULL;
+   if(!slot->pack.seg)
+   {  if(!(name=Cachefilename(e->nr,Casnapurl(e),Casnapmimetype(e)))) return NULL;
+   }
+   if(!(cac=Anewobject(AOTP_CACHE,
+      AOCAC_Url,url,
+      AOCAC_Number,e->nr,
+      AOCAC_Cachedate,e->cachedate,
+      TAG_END)))
+   {  if(name) FREE(name);
+      return NULL;
+   }
+   cac->name=name;
+   cac->date=e->date;
+   cac->expires=e->expires;
+   strcpy(cac->mimetype,Casnapmimetype(e));
+   strcpy(cac->etag,Casnapetag(e));
+   cac->disksize=e->size;
+   ObtainSemaphore(&cachesema);
+   Caereplace(&caevict,&slot->ce,&cac->ce);
+   ReleaseSemaphore(&cachesema);
+   Capackmove(&slot->pack,&cac->pack);
+   slot->entry=NULL;
+   /* From here on it is like any other object, disposing of it deletes
+    * its file and logs that. */
+   if(ucac=(struct Cache *)Agetattr(url,AOURL_Cache))
+   {  if(ucac->nr==cac->nr) cac->flags|=CACF_NODELETE;
+      Adisposeobject(cac);
+      return NULL;
+   }
+   Asetattrs(url,
+      AOURL_Cache,cac,
+      AOURL_Visited,TRUE,
+      TAG_END);
+   if((struct Cache *)Agetattr(url,AOURL_Cache)!=cac)
+   {  Adisposeobject(cac);
+      return NULL;
+   }
+   if(cac->expires && cac->expires<=Today())
+   {  Auspecial(url,AUMST_DELETECACHE);
+      return NULL;
+   }
+   if(e->type==COTYPE_MOVED)
+   {  Asetattrs(url,AOURL_Movedto,Casnapmovedto(e),TAG_END);
+   }
+   return cac;
+}
+
+/* Create the Cache object for a slot whose URL may not exist yet */
+static struct Cache *Slotcache(struct Caslot *slot)
+{  void *url;
+   snapbusy=TRUE;
+   url=Findurl("",Casnapurl(slot->entry),0);
+   snapbusy=FALSE;
+   return url?Makecache(slot,url):NULL;
+}
+#endif
+
+void Cachelookup(void *url)
+{
+#ifndef LOCALONLY
+   struct Csnapentry *e;
+   UBYTE *p;
+   if(snapcount && !snapbusy && (p=(UBYTE *)Agetattr(url,AOURL_Realurl))
+   && (e=Casnapfind(&casnap,p)) && snapslots[e->index].entry)
+   {  Makecache(&snapslots[e->index],url);
+   }
+#endif
+}
+
+void Completecache(void)
+{
+#ifndef LOCALONLY
+   long i;
+   BOOL done=TRUE;
+   for(i=0;i<snapcount;i++)
+   {  if(snapslots[i].entry) Slotcache(&snapslots[i]);
+      if(snapslots[i].entry) done=FALSE;
+   }
+   /* Nothing refers to the snapshot anymore */
+   if(done) Freesnapshot();
 #endif
 }
 
@@ -373,9 +709,42 @@ static void Opencacfile(struct Cache *cac)
    cac->fh=OpenAsync(cac->name,MODE_WRITE,FILEBLOCKSIZE);
 }
 
+/* Collect a small object in memory, to store it in a pack file when
+ * complete. Otherwise create its own file. */
+static void Startcacfile(struct Cache *cac)
+{  long max=MIN(prefs.capacksize*1024,CAPMAXOBJECT);
+   if(max>0 && (cac->packbuf=ALLOCTYPE(UBYTE,max,0)))
+   {  cac->packmax=max;
+   }
+   else Opencacfile(cac);
+}
+
+/* Object turns out too large to pack, or the pack file can't be written.
+ * Move collected data to its own file. */
+static void Spillcacfile(struct Cache *cac)
+{  Opencacfile(cac);
+   if(cac->fh)
+   {  WriteAsync(cac->fh,cac->packbuf,cac->disksize);
+   }
+   else
+   {  cadisksize-=cac->disksize;
+      cac->disksize=0;
+      Caesetsize(&caevict,&cac->ce,0);
+   }
+   FREE(cac->packbuf);
+   cac->packbuf=NULL;
+}
+
+/* Compact pack files a bit. When one is empty, save the registration so
+ * it can be deleted. */
+static void Compactpacks(void)
+{  if(Capackcompact(&capack,PACKSTEP)) Checkpoint();
+}
+
 /* Delete the associated file, and write entry in registration. */
 static void Deletecache(struct Cache *cac)
-{  DeleteFile(cac->name);
+{  if(cac->pack.seg) Capackfree(&capack,&cac->pack);
+   else DeleteFile(cac->name);
    if(!initializing)
    {  /* Don't add a DEL entry when we are reading in the registration */
       Addregentry(cac,TRUE);
@@ -397,14 +766,25 @@ static void Setcomment(struct Cache *cac)
 
 /*------------------------------------------------------------------------*/
 
-/* Delete all files beyond limit, last touched first */
+/* When beyond limit, delete files until below FLUSHTO percent of the limit.
+ * Files used only once go first, least recently used first, then files
+ * that were reused. Flushing a bit more than needed means a full cache
+ * isn't flushed again for every file added. */
 static void Flushexcess(void)
-{  struct Cache *cac,*next;
+{  struct Caentry *ce;
+   struct Cache *cac;
    long max=prefs.cadisksize*1024;
    ObtainSemaphore(&cachesema);
-   for(cac=cache.first;cac->next && cadisksize>max;cac=next)
-   {  next=cac->next;
-      Auspecial(cac->url,AUMST_DELETECACHE);
+   caevict.protmax=max/100*PROTECTED;
+   if(cadisksize>max)
+   {  while(cadisksize>max/100*FLUSHTO && (ce=Caevictnext(&caevict)))
+      {  cac=(struct Cache *)ce->userdata;
+#ifndef LOCALONLY
+         /* A slot gets its object first, so deleting it is logged */
+         if(!cac) cac=Slotcache((struct Caslot *)ce);
+#endif
+         if(cac) Auspecial(cac->url,AUMST_DELETECACHE);
+      }
    }
    ReleaseSemaphore(&cachesema);
    sizeadded=0;
@@ -427,6 +807,7 @@ static void Flushtype(USHORT type,UBYTE *pattern)
       }
       scheme=BOOLVAL(strstr(pattern,"://"));
    }
+   Completecache();
    ObtainSemaphore(&cachesema);
    for(cac=cache.first;cac->next;cac=next)
    {  next=cac->next;
@@ -565,14 +946,15 @@ static BOOL Fixroot(void *preq)
    if(Examine(cachelock,&fib) && fib.fib_DirEntryType>0)
    {  while(ExNext(cachelock,&fib))
       {  if(fib.fib_DirEntryType<0)          /* plain file */
-         {  if(!STREQUAL(fib.fib_FileName,"AWCU") && !STREQUAL(fib.fib_FileName,"AWCK"))
+         {  if(!STREQUAL(fib.fib_FileName,"AWCU") && !STREQUAL(fib.fib_FileName,"AWCK")
+            && !STREQUAL(fib.fib_FileName,"AWCS"))
             {  if(cd=Newcafixdel(fib.fib_FileName)) ADDTAIL(&dellist,cd);
             }
          }
          else if(fib.fib_DirEntryType>0)     /* directory */
          {  p=fib.fib_FileName;
             if(!(STRNEQUAL(p,"AWCD",4) && p[4]>='0' && p[4]<='3'
-            && isxdigit(p[5]) && p[6]=='\0'))
+            && isxdigit(p[5]) && p[6]=='\0') && !STREQUAL(p,"AWCP"))
             {  Deletedir(fib.fib_FileName);
                if(cd=Newcafixdel(fib.fib_FileName)) ADDTAIL(&dellist,cd);
             }
@@ -645,6 +1027,54 @@ err:
    return ok;
 }
 
+/* Delete pack files that aren't known */
+static BOOL Fixpackdir(void *preq)
+{  __aligned struct FileInfoBlock fib={0};
+   long oldcd=CurrentDir(cachelock);
+   long dirlock;
+   LIST(Cafixdel) dellist;
+   struct Cafixdel *cd;
+   struct Capseg *seg;
+   UBYTE name[12];
+   BOOL ok=FALSE,fileok;
+   NEWLIST(&dellist);
+   if(dirlock=Lock("AWCP",SHARED_LOCK))
+   {  CurrentDir(dirlock);
+      if(Examine(dirlock,&fib))
+      {  while(ExNext(dirlock,&fib))
+         {  fileok=FALSE;
+            if(fib.fib_DirEntryType<0)       /* plain file */
+            {  for(seg=capack.segs.first;seg->next;seg=seg->next)
+               {  sprintf(name,"%08lX",seg->nr);
+                  if(STRIEQUAL(fib.fib_FileName,name))
+                  {  fileok=TRUE;
+                     break;
+                  }
+               }
+            }
+            else if(fib.fib_DirEntryType>0)  /* directory */
+            {  Deletedir(fib.fib_FileName);
+            }
+            if(!fileok)
+            {  if(cd=Newcafixdel(fib.fib_FileName)) ADDTAIL(&dellist,cd);
+            }
+            if(Checkprogressreq(preq)) goto err;
+         }
+      }
+      while(cd=REMHEAD(&dellist))
+      {  DeleteFile(cd->name);
+         FREE(cd);
+      }
+      ok=TRUE;
+err:
+      while(cd=REMHEAD(&dellist)) FREE(cd);
+      UnLock(dirlock);
+   }
+   else ok=TRUE;
+   CurrentDir(oldcd);
+   return ok;
+}
+
 static void Fixcachereg(LIST(Cafix) *list)
 {  struct Cafix *cf;
    while(cf=REMHEAD(list))
@@ -657,11 +1087,11 @@ static void Dofixcache(short code,void *data)
 {  void *preq;
    struct Cafix *cf;
    short i;
-   UBYTE *awcrname=Makename("AWCR",NULL);
-   if(code && awcrname)
+   if(code)
    {  LIST(Cafix) list;
       NEWLIST(&list);
       Busypointer(TRUE);
+      Completecache();
       ObtainSemaphore(&cachesema);
       if(preq=Openprogressreq(AWEBSTR(MSG_FIXCACHE_PROGRESS)))
       {  if(!Makecafixlist(&list)) goto err;
@@ -673,9 +1103,9 @@ static void Dofixcache(short code,void *data)
          {  if(!Fixcachedir(preq,&list,i)) goto err;
             Setprogressreq(preq,i+3,67);
          }
+         if(!Fixpackdir(preq)) goto err;
          Fixcachereg(&list);
-         Savecachereg(FALSE);
-         Rename(awcrname,awcuname);
+         Checkpoint();
          Setprogressreq(preq,67,67);
 err:
          while(cf=REMHEAD(&list)) FREE(cf);
@@ -685,7 +1115,6 @@ err:
       Busypointer(FALSE);
    }
    if(data) FREE(data);
-   if(awcrname) FREE(awcrname);
 }
 #endif /* !LOCALONLY */
 
@@ -712,6 +1141,7 @@ static long Setcache(struct Cache *cac,struct Amset *ams)
             {  ObtainSemaphore(&cachesema);
                REMOVE(cac);
                ADDTAIL(&cache,cac);
+               Caetouch(&caevict,&cac->ce,Today());
                ReleaseSemaphore(&cachesema);
             }
             break;
@@ -729,6 +1159,8 @@ static struct Cache *Newcache(struct Amset *ams)
    {  Setcache(cac,ams);
       if(!cac->nr) cac->nr=++cachenr;
       if(!cac->cachedate) cac->cachedate=Today();
+      cac->ce.userdata=cac;
+      cac->ce.atime=cac->cachedate;
       ObtainSemaphore(&cachesema);
       ADDTAIL(&cache,cac);
       ReleaseSemaphore(&cachesema);
@@ -764,6 +1196,9 @@ static long Getcache(struct Cache *cac,struct Amset *ams)
          case AOCAC_Etag:
             PUTATTR(tag,*cac->etag?cac->etag:NULL);
             break;
+         case AOCAC_Packloc:
+            PUTATTR(tag,cac->pack.seg?&cac->pack:NULL);
+            break;
       }
    }
    return 0;
@@ -773,7 +1208,7 @@ static long Srcupdatecache(struct Cache *cac,struct Amsrcupdate *ams)
 {  struct TagItem *tag,*tstate=ams->tags;
    UBYTE *data=NULL;
    long length=0;
-   BOOL eof=FALSE;
+   BOOL eof=FALSE,stored;
    while(tag=NextTagItem(&tstate))
    {  switch(tag->ti_Tag)
       {  case AOURL_Contenttype:
@@ -804,25 +1239,46 @@ static long Srcupdatecache(struct Cache *cac,struct Amsrcupdate *ams)
       }
    }
    if(data || eof)
-   {  if(!cac->name) Opencacfile(cac);
+   {  if(!cac->name && !cac->packbuf && !cac->pack.seg) Startcacfile(cac);
    }
    if(data)
-   {  if(length && cac->fh)
-      {  WriteAsync(cac->fh,data,length);
+   {  if(length && cac->packbuf && cac->disksize+length>cac->packmax)
+      {  Spillcacfile(cac);
+      }
+      if(length && (cac->fh || cac->packbuf))
+      {  if(cac->packbuf) memmove(cac->packbuf+cac->disksize,data,length);
+         else WriteAsync(cac->fh,data,length);
          cac->disksize+=length;
          cadisksize+=length;
+         Caesetsize(&caevict,&cac->ce,cac->disksize);
          sizeadded+=length;
          if(sizeadded>CHKAFTER) Flushexcess();
       }
    }
    if(eof)
-   {  if(cac->fh)
+   {  stored=FALSE;
+      if(cac->packbuf)
+      {  if(Capackwrite(&capack,&cac->pack,cac->nr,cac->packbuf,cac->disksize))
+         {  FREE(cac->packbuf);
+            cac->packbuf=NULL;
+            stored=TRUE;
+         }
+         else Spillcacfile(cac);
+      }
+      if(cac->fh)
       {  CloseAsync(cac->fh);
          Setcomment(cac);
          cac->fh=NULL;
+         stored=TRUE;
+      }
+      if(stored)
+      {  ObtainSemaphore(&cachesema);
+         Caeadd(&caevict,&cac->ce);
+         ReleaseSemaphore(&cachesema);
          Addregentry(cac,FALSE);
          Addcabrobject(cac);
          Flushexcess();
+         Compactpacks();
       }
    }
    return 0;
@@ -831,19 +1287,26 @@ static long Srcupdatecache(struct Cache *cac,struct Amsrcupdate *ams)
 static void Disposecache(struct Cache *cac)
 {  ObtainSemaphore(&cachesema);
    REMOVE(cac);
+   Caeremove(&caevict,&cac->ce);
    ReleaseSemaphore(&cachesema);
    cadisksize-=cac->disksize;
    Remcabrobject(cac);
    if(cac->fh) CloseAsync(cac->fh);
-   if(cac->name)
+   if(cac->packbuf) FREE(cac->packbuf);
+   if(cac->name || cac->pack.seg)
    {  if(!(cac->flags&CACF_NODELETE)) Deletecache(cac);
-      FREE(cac->name);
+      if(cac->name) FREE(cac->name);
    }
+   Capackfree(&capack,&cac->pack);
    Amethodas(AOTP_OBJECT,cac,AOM_DISPOSE);
 }
 
 static void Deinstallcache(void)
 {  while(cache.first->next) Adisposeobject(cache.first);
+   if(capack.segs.first) Exitcapack(&capack);
+#ifndef LOCALONLY
+   Freesnapshot();
+#endif
    if(awcuname) FREE(awcuname);
    if(cachelock) UnLock(cachelock);
 }
@@ -877,39 +1340,61 @@ static long Dispatch(struct Cache *cac,struct Amessage *amsg)
 
 BOOL Installcache(void)
 {  NEWLIST(&cache);
+   Initcaevict(&caevict);
    InitSemaphore(&cachesema);
    if(!Amethod(NULL,AOM_INSTALL,AOTP_CACHE,Dispatch)) return FALSE;
    return TRUE;
 }
 
 BOOL Initcache(void)
-{  UBYTE *awcr;
+{  UBYTE *awcr,*awcs,*awcn;
    long lock;
    BOOL corrupt=FALSE;
    cachelock=Lock(prefs.cachepath,SHARED_LOCK);
    if(!cachelock) cachelock=Lock("T:",SHARED_LOCK);
    if(cachelock) NameFromLock(cachelock,cachename,NAMESIZE);
+   Initcapack(&capack,cachename);
    if(!(awcuname=Makename("AWCU",NULL))) return FALSE;
    if(!(awcr=Makename("AWCR",NULL))) return FALSE;
+   if(!(awcs=Makename("AWCS",NULL))) return FALSE;
 #ifndef LOCALONLY
+   caevict.protmax=prefs.cadisksize*1024/100*PROTECTED;
    initializing=TRUE;
-   if(lock=Lock(awcuname,SHARED_LOCK))
+   if(!(lock=Lock(awcs,SHARED_LOCK)))
+   {  /* A new snapshot was written but not yet renamed */
+      if(awcn=Makename("AWCN",NULL))
+      {  Rename(awcn,awcs);
+         FREE(awcn);
+      }
+      lock=Lock(awcs,SHARED_LOCK);
+   }
+   if(lock)
+   {  /* Snapshot exists - replay the log that follows it */
+      corrupt=!Loadsnapshot(awcs,lock);
+      UnLock(lock);
+      regversion=CACHEVERSION;
+      if(lock=Lock(awcuname,SHARED_LOCK))
+      {  if(!Readcachereg(awcuname,lock)) corrupt=TRUE;
+         UnLock(lock);
+      }
+      else Createlog(awcuname);
+      if(corrupt || regversion<CACHEVERSION || nradded>NRCHKPT) Checkpoint();
+   }
+   else if(lock=Lock(awcuname,SHARED_LOCK))
    {  /* old cache log exists - rebuild cache */
       corrupt=!Readcachereg(awcuname,lock);
       UnLock(lock);
-      Savecachereg(FALSE);   /* create new reg file and delete AWCU */
-      Rename(awcr,awcuname);
+      Checkpoint();
+   }
+   else if(lock=Lock(awcr,SHARED_LOCK))
+   {  /* registration of an earlier version */
+      corrupt=!Readcachereg(awcr,lock);
+      UnLock(lock);
+      Checkpoint();
    }
    else
-   {  if(lock=Lock(awcr,SHARED_LOCK))
-      {  corrupt=!Readcachereg(awcr,lock);
-         UnLock(lock);
-         Rename(awcr,awcuname);
-      }
-      else
-      {  Createdirectories();
-         Createlog(awcuname);
-      }
+   {  Createdirectories();
+      Checkpoint();
    }
    initializing=FALSE;
    if(corrupt)
@@ -920,6 +1405,7 @@ BOOL Initcache(void)
    }
 #endif
    FREE(awcr);
+   FREE(awcs);
    return TRUE;
 }
 
@@ -1005,6 +1491,7 @@ void Getcachecontents(struct Arexxcmd *ac,UBYTE *stem,UBYTE *pattern)
       }
       scheme=BOOLVAL(strstr(pattern,"://"));
    }
+   Completecache();
    ObtainSemaphore(&cachesema);
    i=0;
    for(cac=cache.first;cac->next;cac=cac->next)
@@ -1028,7 +1515,8 @@ void Getcachecontents(struct Arexxcmd *ac,UBYTE *stem,UBYTE *pattern)
          Setstemvar(ac,stem,i,"SIZE",buf);
          sprintf(buf,"%d",cac->cachedate/86400);
          Setstemvar(ac,stem,i,"DATE",buf);
-         Setstemvar(ac,stem,i,"FILE",Cfnameshort(cac->name));
+         Setstemvar(ac,stem,i,"FILE",
+            Cfnameshort(cac->name?cac->name:cac->pack.seg?cac->pack.seg->name:(UBYTE *)""));
       }
    }
    ReleaseSemaphore(&cachesema);
@@ -31,7 +31,7 @@
    /* (void *) URL this cache is for. */
 
 #define AOCAC_Name         (AOCAC_Dummy+2)
-   /* (UBYTE *) Fully qualified file name. */
+   /* (UBYTE *) Fully qualified file name, or NULL if stored in a pack file. */
 
 #define AOCAC_Number       (AOCAC_Dummy+3)
    /* (long) Cache sequence number */
@@ -57,7 +57,10 @@
 #define AOCAC_Etag         (AOCAC_Dummy+10)  /* GET */
    /* (UBYTE *) ETag value from HTTP response for cache validation */
 
-#define AOCAC_    (AOCAC_Dummy+)
+#define AOCAC_Packloc      (AOCAC_Dummy+11)  /* GET */
+   /* (struct Caploc *) Location in pack file, or NULL if in own file.
+    * See capack.h. */
+
 #define AOCAC_    (AOCAC_Dummy+)
 #define AOCAC_    (AOCAC_Dummy+)
 
@@ -77,6 +80,10 @@ extern void Fixcache(BOOL force);
 extern void Getcachecontents(struct Arexxcmd *ac,UBYTE *stem,UBYTE *pattern);
    /* Obtain cache contents in an ARexx stem variable */
 
+extern void Cachelookup(void *url);
+   /* New URL object is created, attach its cache object if it is in the
+    * registration snapshot. */
+
 /* flush types */
 
 #define CACFT_DOCUMENTS    1  /* Document types (text/...) */
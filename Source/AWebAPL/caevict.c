@@ -0,0 +1,144 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb APL distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* caevict.c - AWeb disk cache eviction order */
+
+/* This file has no system dependencies, so it can be built and tested
+ * on any host. The lists are linked here instead of with exec for that
+ * reason; they have the same layout as exec lists. */
+
+#include <exec/types.h>
+#include "caevict.h"
+
+typedef LIST(Caentry) Calist;
+
+/*-----------------------------------------------------------------------*/
+
+static void Newlist(Calist *list)
+{  list->first=(struct Caentry *)&list->tail;
+   list->tail=NULL;
+   list->last=(struct Caentry *)list;
+}
+
+static void Addtail(Calist *list,struct Caentry *ce)
+{  struct Caentry *tailnode=(struct Caentry *)&list->tail;
+   ce->next=tailnode;
+   ce->prev=list->last;
+   list->last->next=ce;
+   list->last=ce;
+}
+
+static void Remove(struct Caentry *ce)
+{  ce->prev->next=ce->next;
+   ce->next->prev=ce->prev;
+   ce->next=ce->prev=NULL;
+}
+
+static struct Caentry *Remhead(Calist *list)
+{  struct Caentry *ce=list->first;
+   if(!ce->next) return NULL;
+   Remove(ce);
+   return ce;
+}
+
+/* Move least recently used protected entries back to probation */
+static void Demote(struct Caevict *cae)
+{  struct Caentry *ce;
+   while(cae->protsize>cae->protmax && (ce=Remhead((Calist *)&cae->protected)))
+   {  cae->protsize-=ce->size;
+      ce->flags&=~CAEF_PROTECTED;
+      ce->hits=0;
+      Addtail((Calist *)&cae->probation,ce);
+   }
+}
+
+/*-----------------------------------------------------------------------*/
+
+void Initcaevict(struct Caevict *cae)
+{  Newlist((Calist *)&cae->probation);
+   Newlist((Calist *)&cae->protected);
+   cae->protsize=0;
+   cae->protmax=0;
+}
+
+void Caeadd(struct Caevict *cae,struct Caentry *ce)
+{  if(ce->flags&CAEF_LINKED) return;
+   if(ce->hits>=CAE_PROTECTHITS)
+   {  Addtail((Calist *)&cae->protected,ce);
+      ce->flags|=CAEF_PROTECTED;
+      cae->protsize+=ce->size;
+   }
+   else
+   {  Addtail((Calist *)&cae->probation,ce);
+      ce->flags&=~CAEF_PROTECTED;
+   }
+   ce->flags|=CAEF_LINKED;
+   Demote(cae);
+}
+
+void Caetouch(struct Caevict *cae,struct Caentry *ce,ULONG now)
+{  ce->atime=now;
+   if(ce->hits<0xffff) ce->hits++;
+   if(ce->flags&CAEF_LINKED)
+   {  Caeremove(cae,ce);
+      Caeadd(cae,ce);
+   }
+}
+
+void Caesetsize(struct Caevict *cae,struct Caentry *ce,long size)
+{  if(ce->flags&CAEF_PROTECTED)
+   {  cae->protsize+=size-ce->size;
+      ce->size=size;
+      Demote(cae);
+   }
+   else ce->size=size;
+}
+
+void Caeremove(struct Caevict *cae,struct Caentry *ce)
+{  if(ce->flags&CAEF_LINKED)
+   {  Remove(ce);
+      if(ce->flags&CAEF_PROTECTED) cae->protsize-=ce->size;
+   }
+   ce->flags&=~(CAEF_LINKED|CAEF_PROTECTED);
+}
+
+void Caereplace(struct Caevict *cae,struct Caentry *old,struct Caentry *ce)
+{  ce->size=old->size;
+   ce->atime=old->atime;
+   ce->hits=old->hits;
+   ce->flags=old->flags;
+   if(old->flags&CAEF_LINKED)
+   {  ce->next=old->next;
+      ce->prev=old->prev;
+      ce->prev->next=ce;
+      ce->next->prev=ce;
+      old->next=old->prev=NULL;
+   }
+   old->flags=0;
+}
+
+struct Caentry *Caevictnext(struct Caevict *cae)
+{  struct Caentry *ce;
+   if(!(ce=Remhead((Calist *)&cae->probation)))
+   {  if(ce=Remhead((Calist *)&cae->protected))
+      {  cae->protsize-=ce->size;
+      }
+   }
+   if(ce) ce->flags&=~(CAEF_LINKED|CAEF_PROTECTED);
+   return ce;
+}
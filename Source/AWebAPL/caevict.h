@@ -0,0 +1,79 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb APL distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* caevict.h - AWeb disk cache eviction order */
+
+#ifndef AWEB_CAEVICT_H
+#define AWEB_CAEVICT_H
+
+#include <exec/types.h>
+#include "ezlists.h"
+
+/* Segmented LRU. New cache entries go into the probation segment. An entry
+ * that is used again moves to the protected segment. Entries are evicted
+ * from the least recently used end of probation first, so objects that were
+ * used once, like large downloads, go before the style sheets and logos a
+ * site uses on every page. When the protected segment grows beyond its share
+ * of the cache, its least recently used entries go back to probation.
+ * All operations take constant time. */
+
+struct Caentry
+{  NODE(Caentry);
+   void *userdata;
+   long size;
+   ULONG atime;            /* Last access, in seconds */
+   UWORD hits;             /* Number of uses after the first, saturating */
+   UWORD flags;            /* See below */
+};
+
+#define CAEF_PROTECTED  0x0001   /* In protected segment */
+#define CAEF_LINKED     0x0002   /* In one of the segments */
+
+struct Caevict
+{  LIST(Caentry) probation;
+   LIST(Caentry) protected;
+   long protsize;          /* Size of protected entries */
+   long protmax;           /* Size limit of the protected segment */
+};
+
+/* Entries with (hits) from here on are protected */
+#define CAE_PROTECTHITS 1
+
+extern void Initcaevict(struct Caevict *cae);
+
+/* Add a complete entry as most recently used in its segment, following
+ * its (hits). Entries that are still being written are not added, so
+ * they can't be evicted. */
+extern void Caeadd(struct Caevict *cae,struct Caentry *ce);
+
+/* Entry was used at (now). */
+extern void Caetouch(struct Caevict *cae,struct Caentry *ce,ULONG now);
+
+/* Entry size has changed. */
+extern void Caesetsize(struct Caevict *cae,struct Caentry *ce,long size);
+
+/* Remove entry, if it wasn't already. */
+extern void Caeremove(struct Caevict *cae,struct Caentry *ce);
+
+/* Put (ce) in the place of (old), with its size and access info. */
+extern void Caereplace(struct Caevict *cae,struct Caentry *old,struct Caentry *ce);
+
+/* Remove and return the entry to evict next, or NULL. */
+extern struct Caentry *Caevictnext(struct Caevict *cae);
+
+#endif
@@ -0,0 +1,331 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb APL distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* capack.c - AWeb disk cache pack files */
+
+#include "aweb.h"
+#include "capack.h"
+#include "asyncio.h"
+#include <proto/exec.h>
+#include <proto/dos.h>
+
+#define RECSIZE(length) ((long)sizeof(struct Caprecord)+(length))
+
+/*-----------------------------------------------------------------------*/
+
+static struct Capseg *Newseg(struct Capack *cp,ULONG nr)
+{  struct Capseg *seg;
+   UBYTE buf[16];
+   long len=strlen(cp->dir)+16;
+   if(seg=ALLOCSTRUCT(Capseg,1,MEMF_CLEAR))
+   {  NEWLIST(&seg->locs);
+      seg->nr=nr;
+      if(seg->name=ALLOCTYPE(UBYTE,len,0))
+      {  strcpy(seg->name,cp->dir);
+         sprintf(buf,"AWCP/%08lX",nr);
+         AddPart(seg->name,buf,len);
+         ADDTAIL(&cp->segs,seg);
+         if(nr>cp->lastnr) cp->lastnr=nr;
+      }
+      else
+      {  FREE(seg);
+         seg=NULL;
+      }
+   }
+   return seg;
+}
+
+static void Disposeseg(struct Capseg *seg)
+{  if(seg->name) FREE(seg->name);
+   FREE(seg);
+}
+
+static struct Capseg *Findseg(struct Capack *cp,ULONG nr)
+{  struct Capseg *seg;
+   for(seg=cp->segs.first;seg->next;seg=seg->next)
+   {  if(seg->nr==nr) return seg;
+   }
+   return NULL;
+}
+
+/* Link (loc) to (seg) */
+static void Addloc(struct Capseg *seg,struct Caploc *loc)
+{  ADDTAIL(&seg->locs,loc);
+   loc->seg=seg;
+   seg->live+=RECSIZE(loc->length);
+   seg->flags&=~CAPSF_DELETE;
+}
+
+static void Remloc(struct Caploc *loc)
+{  struct Capseg *seg=loc->seg;
+   REMOVE(loc);
+   seg->live-=RECSIZE(loc->length);
+   loc->seg=NULL;
+}
+
+/* Get the pack file to append (size) bytes to */
+static struct Capseg *Appendseg(struct Capack *cp,long size)
+{  struct Capseg *seg=cp->current;
+   if(!seg || (seg->flags&CAPSF_FULL) || (seg->size && seg->size+size>CAPSEGSIZE))
+   {  if(seg) seg->flags|=CAPSF_FULL;
+      seg=cp->current=Newseg(cp,cp->lastnr+1);
+   }
+   return seg;
+}
+
+/* Append a record. If (*fhp) is an open file, it must be the current pack
+ * file and it is left open. Otherwise the file is opened and closed. */
+static BOOL Append(struct Capack *cp,struct Caploc *loc,ULONG nr,UBYTE *data,long length,
+   void **fhp)
+{  struct Capseg *seg;
+   struct Caprecord rec;
+   void *fh=fhp?*fhp:NULL;
+   BOOL ok=FALSE;
+   if(fh && ((cp->current->flags&CAPSF_FULL) || cp->current->size+RECSIZE(length)>CAPSEGSIZE))
+   {  CloseAsync(fh);
+      fh=NULL;
+   }
+   if(!(seg=Appendseg(cp,RECSIZE(length)))) return FALSE;
+   /* A new pack file is created, so nothing left by a crash is kept */
+   if(fh || (fh=OpenAsync(seg->name,seg->size?MODE_APPEND:MODE_WRITE,FILEBLOCKSIZE)))
+   {  strncpy(rec.label,"AWCO",4);
+      rec.nr=nr;
+      rec.length=length;
+      rec.checksum=Capacksum(data,length);
+      ok=(WriteAsync(fh,&rec,sizeof(rec))==sizeof(rec)
+         && WriteAsync(fh,data,length)==length);
+      if(!fhp)
+      {  if(CloseAsync(fh)<0) ok=FALSE;
+         fh=NULL;
+      }
+      if(ok)
+      {  loc->offset=seg->size;
+         loc->length=length;
+         loc->checksum=rec.checksum;
+         Addloc(seg,loc);
+      }
+      else
+      {  /* Unknown how much was written, don't append any more */
+         seg->flags|=CAPSF_FULL;
+      }
+      seg->size+=RECSIZE(length);
+   }
+   else seg->flags|=CAPSF_FULL;
+   if(fhp) *fhp=fh;
+   return ok;
+}
+
+/* Read and verify record at (offset) */
+static BOOL Readrecord(void *fh,long offset,long length,ULONG checksum,ULONG *nrp,UBYTE *buf)
+{  struct Caprecord rec;
+   if(SeekAsync(fh,offset,MODE_START)<0) return FALSE;
+   if(ReadAsync(fh,&rec,sizeof(rec))!=sizeof(rec)) return FALSE;
+   if(!STRNEQUAL(rec.label,"AWCO",4) || rec.length!=length || rec.checksum!=checksum)
+      return FALSE;
+   if(ReadAsync(fh,buf,length)!=length) return FALSE;
+   if(Capacksum(buf,length)!=checksum) return FALSE;
+   if(nrp) *nrp=rec.nr;
+   return TRUE;
+}
+
+/* Find the pack file with the most dead space, if enough */
+static struct Capseg *Compactseg(struct Capack *cp)
+{  struct Capseg *seg,*best=NULL;
+   long dead,bestdead=0;
+   for(seg=cp->segs.first;seg->next;seg=seg->next)
+   {  if(seg!=cp->current && seg->locs.first->next && !(seg->flags&CAPSF_NOCOMPACT))
+      {  dead=seg->size-seg->live;
+         if(dead>=seg->size/100*CAPGARBAGE && dead>bestdead)
+         {  best=seg;
+            bestdead=dead;
+         }
+      }
+   }
+   return best;
+}
+
+static void Endcompact(struct Capack *cp)
+{  if(cp->compfh) CloseAsync(cp->compfh);
+   cp->compfh=NULL;
+   cp->compact=NULL;
+}
+
+/*-----------------------------------------------------------------------*/
+
+void Initcapack(struct Capack *cp,UBYTE *dir)
+{  UBYTE *name;
+   long len=strlen(dir)+8;
+   long lock;
+   NEWLIST(&cp->segs);
+   cp->dir=dir;
+   cp->current=NULL;
+   cp->lastnr=0;
+   cp->compact=NULL;
+   cp->compfh=NULL;
+   if(name=ALLOCTYPE(UBYTE,len,0))
+   {  strcpy(name,dir);
+      AddPart(name,"AWCP",len);
+      if(lock=CreateDir(name)) UnLock(lock);
+      FREE(name);
+   }
+}
+
+void Exitcapack(struct Capack *cp)
+{  struct Capseg *seg;
+   Endcompact(cp);
+   while(seg=REMHEAD(&cp->segs)) Disposeseg(seg);
+   cp->current=NULL;
+}
+
+/* Adler-32 */
+ULONG Capacksum(UBYTE *data,long length)
+{  ULONG a=1,b=0;
+   long n;
+   while(length>0)
+   {  n=MIN(length,5552);
+      length-=n;
+      while(n--)
+      {  a+=*data++;
+         b+=a;
+      }
+      a%=65521;
+      b%=65521;
+   }
+   return (b<<16)|a;
+}
+
+BOOL Capackwrite(struct Capack *cp,struct Caploc *loc,ULONG nr,UBYTE *data,long length)
+{  return Append(cp,loc,nr,data,length,NULL);
+}
+
+/* Pack files from the registration are not appended to, the end of the
+ * file may be from a write that didn't finish. */
+BOOL Capackload(struct Capack *cp,struct Caploc *loc,ULONG segnr,
+   long offset,long length,ULONG checksum)
+{  struct Capseg *seg;
+   if(!(seg=Findseg(cp,segnr)))
+   {  if(!(seg=Newseg(cp,segnr))) return FALSE;
+      seg->flags|=CAPSF_FULL;
+   }
+   loc->offset=offset;
+   loc->length=length;
+   loc->checksum=checksum;
+   Addloc(seg,loc);
+   if(offset+RECSIZE(length)>seg->size) seg->size=offset+RECSIZE(length);
+   return TRUE;
+}
+
+void Capackfree(struct Capack *cp,struct Caploc *loc)
+{  struct Capseg *seg=loc->seg;
+   if(seg)
+   {  Remloc(loc);
+      if(!seg->locs.first->next && seg!=cp->current) seg->flags|=CAPSF_DELETE;
+   }
+}
+
+void Capackmove(struct Caploc *old,struct Caploc *loc)
+{  loc->seg=old->seg;
+   loc->offset=old->offset;
+   loc->length=old->length;
+   loc->checksum=old->checksum;
+   if(old->seg)
+   {  loc->next=old->next;
+      loc->prev=old->prev;
+      loc->prev->next=loc;
+      loc->next->prev=loc;
+      old->next=old->prev=NULL;
+      old->seg=NULL;
+   }
+}
+
+BOOL Capackcompact(struct Capack *cp,long budget)
+{  struct Capseg *seg;
+   struct Caploc *loc;
+   UBYTE *buf;
+   void *fh=NULL;
+   ULONG nr;
+   BOOL done=FALSE;
+   if(!cp->compact)
+   {  if(!(seg=Compactseg(cp))) return FALSE;
+      if(!(cp->compfh=OpenAsync(seg->name,MODE_READ,FILEBLOCKSIZE)))
+      {  seg->flags|=CAPSF_NOCOMPACT;
+         return FALSE;
+      }
+      cp->compact=seg;
+   }
+   seg=cp->compact;
+   if(!(buf=ALLOCTYPE(UBYTE,CAPMAXOBJECT,0))) return FALSE;
+   while(budget>0 && (loc=seg->locs.first)->next)
+   {  if(loc->length>CAPMAXOBJECT
+      || !Readrecord(cp->compfh,loc->offset,loc->length,loc->checksum,&nr,buf))
+      {  /* Leave this pack file alone, the object will fail when it is read */
+         seg->flags|=CAPSF_NOCOMPACT;
+         Endcompact(cp);
+         break;
+      }
+      Remloc(loc);
+      if(!Append(cp,loc,nr,buf,loc->length,&fh))
+      {  /* Keep it where it was */
+         Addloc(seg,loc);
+         seg->flags|=CAPSF_NOCOMPACT;
+         Endcompact(cp);
+         break;
+      }
+      budget-=RECSIZE(loc->length);
+   }
+   if(fh) CloseAsync(fh);
+   FREE(buf);
+   if(cp->compact && !seg->locs.first->next)
+   {  seg->flags|=CAPSF_DELETE;
+      Endcompact(cp);
+      done=TRUE;
+   }
+   return done;
+}
+
+void Capackpurge(struct Capack *cp)
+{  struct Capseg *seg,*next;
+   for(seg=cp->segs.first;seg->next;seg=next)
+   {  next=seg->next;
+      if((seg->flags&CAPSF_DELETE) && !seg->locs.first->next
+      && seg!=cp->current && seg!=cp->compact)
+      {  /* Fails while the file is being read, then try again next time */
+         if(DeleteFile(seg->name))
+         {  REMOVE(seg);
+            Disposeseg(seg);
+         }
+      }
+   }
+}
+
+long Capacksize(struct Capack *cp)
+{  struct Capseg *seg;
+   long size=0;
+   for(seg=cp->segs.first;seg->next;seg=seg->next) size+=seg->size;
+   return size;
+}
+
+BOOL Capackread(UBYTE *name,long offset,long length,ULONG checksum,UBYTE *buf)
+{  void *fh;
+   BOOL ok=FALSE;
+   if(fh=OpenAsync(name,MODE_READ,FILEBLOCKSIZE))
+   {  ok=Readrecord(fh,offset,length,checksum,NULL,buf);
+      CloseAsync(fh);
+   }
+   return ok;
+}
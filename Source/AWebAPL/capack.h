@@ -0,0 +1,117 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb APL distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* capack.h - AWeb disk cache pack files */
+
+#ifndef AWEB_CAPACK_H
+#define AWEB_CAPACK_H
+
+#include <exec/types.h>
+#include "ezlists.h"
+
+/* Small cache objects can be stored in pack files instead of a file of
+ * their own. Objects are appended to the current pack file, which is
+ * replaced by a new one when it reaches CAPSEGSIZE. Each object has a
+ * record header with its length and checksum. Deleting an object only
+ * counts its space as dead. A pack file with enough dead space is
+ * compacted a bit at a time, by moving its objects to the current pack
+ * file. Pack files without objects are deleted when the registration
+ * no longer refers to them, see Capackpurge().
+ *
+ * Pack files are named AWCP/xxxxxxxx in the cache directory. */
+
+#define CAPSEGSIZE      (1024*1024)    /* Pack file size to start a new one */
+#define CAPMAXOBJECT    (64*1024)      /* Largest object that can be packed */
+#define CAPGARBAGE      50             /* Percentage dead to compact a pack */
+
+struct Capseg
+{  NODE(Capseg);
+   LIST(Caploc) locs;      /* Objects in this pack */
+   ULONG nr;               /* File number */
+   UBYTE *name;            /* Full file name */
+   long size;              /* Bytes in file, including dead */
+   long live;              /* Bytes of objects, including their headers */
+   USHORT flags;
+};
+
+#define CAPSF_FULL      0x0001   /* Not appended to anymore */
+#define CAPSF_DELETE    0x0002   /* Empty, delete when registration saved */
+#define CAPSF_NOCOMPACT 0x0004   /* Compacting failed, leave it */
+
+/* Location of a packed object, embedded in the object */
+struct Caploc
+{  NODE(Caploc);
+   struct Capseg *seg;     /* Pack file or NULL */
+   long offset;            /* Offset of record header */
+   long length;            /* Object length, without header */
+   ULONG checksum;
+};
+
+/* Record header before each object in a pack file */
+struct Caprecord
+{  UBYTE label[4];         /* 'AWCO' */
+   ULONG nr;               /* Cache number of object */
+   long length;
+   ULONG checksum;
+};
+
+struct Capack
+{  LIST(Capseg) segs;
+   UBYTE *dir;             /* Cache directory */
+   struct Capseg *current; /* Pack file appended to */
+   ULONG lastnr;
+   struct Capseg *compact; /* Pack file being compacted */
+   void *compfh;           /* Async file handle of (compact) */
+};
+
+extern void Initcapack(struct Capack *cp,UBYTE *dir);
+extern void Exitcapack(struct Capack *cp);
+
+/* Checksum of object data */
+extern ULONG Capacksum(UBYTE *data,long length);
+
+/* Append an object. Returns FALSE if it couldn't be written. */
+extern BOOL Capackwrite(struct Capack *cp,struct Caploc *loc,ULONG nr,
+   UBYTE *data,long length);
+
+/* Add an object from the registration. Returns FALSE if out of memory. */
+extern BOOL Capackload(struct Capack *cp,struct Caploc *loc,ULONG segnr,
+   long offset,long length,ULONG checksum);
+
+/* Object is deleted. Its space becomes dead. */
+extern void Capackfree(struct Capack *cp,struct Caploc *loc);
+
+/* The object at (old) is now known by (loc). */
+extern void Capackmove(struct Caploc *old,struct Caploc *loc);
+
+/* Move objects from a pack file with much dead space, about (budget)
+ * bytes. Returns TRUE if a pack file became empty, the registration must
+ * be saved before it can be deleted. */
+extern BOOL Capackcompact(struct Capack *cp,long budget);
+
+/* Registration was saved, delete empty pack files. */
+extern void Capackpurge(struct Capack *cp);
+
+/* Bytes in pack files */
+extern long Capacksize(struct Capack *cp);
+
+/* Read an object from pack file (name) into (buf) and verify it. This
+ * doesn't use the Capack, so it can be called from any task. */
+extern BOOL Capackread(UBYTE *name,long offset,long length,ULONG checksum,UBYTE *buf);
+
+#endif
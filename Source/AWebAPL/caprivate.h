@@ -18,6 +18,9 @@
 
 /* caprivate.h - cache, cabrowse, cabrtask private data */
 
+#include "caevict.h"
+#include "capack.h"
+
 struct Cache
 {  struct Aobject object;
    void *url;                    /* Url cached. */
@@ -32,6 +35,10 @@ struct Cache
    long disksize;                /* Size written to disk. */
    USHORT flags;
    struct Node *brnode;          /* Cache browser list node. */
+   struct Caentry ce;            /* Eviction order, size and last access. */
+   struct Caploc pack;           /* Location if stored in a pack file. */
+   UBYTE *packbuf;               /* Data collected for a pack file. */
+   long packmax;                 /* Size of (packbuf). */
 };
 
 #define CACF_NODELETE      0x0001   /* Don't delete cache file. */
@@ -101,6 +108,7 @@ extern LIST(Cache) cache;
 extern struct SignalSemaphore cachesema;
 extern long cadisksize;
 extern UBYTE *Cfnameshort(UBYTE *name);
+extern void Completecache(void);    /* Create objects for all entries */
 
 /* from cabrowse.c */
 
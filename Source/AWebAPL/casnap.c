@@ -0,0 +1,228 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb APL distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* casnap.c - AWeb disk cache registration snapshot */
+
+/* This file has no system dependencies, so it can be built and tested
+ * on any host. Writing goes through a function supplied by the caller. */
+
+#include <exec/types.h>
+#include <string.h>
+#include "casnap.h"
+
+#define MAXMIMETYPE  32      /* Including '\0', as in struct Cache */
+#define MAXETAG      64
+#define MAXURLSIZE   32767   /* As in the log */
+#define MAXRECLEN    65532
+
+#define ROUND4(n)    (((n)+3)&~3)
+
+/*-----------------------------------------------------------------------*/
+
+/* Length of the string at (p) including '\0', or 0 if it doesn't end
+ * before (end) */
+static long Stringsize(UBYTE *p,UBYTE *end)
+{  UBYTE *q;
+   for(q=p;q<end;q++)
+   {  if(!*q) return q-p+1;
+   }
+   return 0;
+}
+
+/* Check the entry at (e) of at most (max) bytes */
+static BOOL Checkentry(struct Csnapentry *e,long max)
+{  UBYTE *p,*end;
+   long n,m;
+   if(max<(long)sizeof(struct Csnapentry)) return FALSE;
+   if(e->reclen<sizeof(struct Csnapentry) || (e->reclen&3) || e->reclen>max) return FALSE;
+   p=(UBYTE *)(e+1);
+   end=(UBYTE *)e+e->reclen;
+   if(!(n=Stringsize(p,end)) || n>MAXMIMETYPE) return FALSE;
+   p+=n;
+   if(!(n=Stringsize(p,end)) || n>MAXETAG) return FALSE;
+   p+=n;
+   if(p+e->urlsize>end || !(n=Stringsize(p,p+e->urlsize))) return FALSE;
+   if(n<e->urlsize)
+   {  /* Moved-to URL, not empty */
+      if((m=Stringsize(p+n,p+e->urlsize))<2 || n+m!=e->urlsize) return FALSE;
+   }
+   return TRUE;
+}
+
+/*-----------------------------------------------------------------------*/
+
+/* FNV-1a */
+ULONG Casnaphash(UBYTE *url)
+{  ULONG h=2166136261UL;
+   while(*url)
+   {  h^=*url++;
+      h*=16777619UL;
+   }
+   return h;
+}
+
+ULONG Casnapbuckets(ULONG nrentries)
+{  ULONG n=256;
+   while(n<nrentries && n<0x100000) n<<=1;
+   return n;
+}
+
+long Casnapcount(UBYTE *block,long size)
+{  struct Csnaphdr *hdr=(struct Csnaphdr *)block;
+   if(size<(long)sizeof(struct Csnaphdr)) return -1;
+   if(strncmp(hdr->label,"AWCS",4) || hdr->version!=CASNAPVERSION) return -1;
+   if(!hdr->nrbuckets || (hdr->nrbuckets&(hdr->nrbuckets-1))) return -1;
+   if(hdr->nrbuckets>(ULONG)(size-sizeof(struct Csnaphdr))/4) return -1;
+   if(hdr->nrentries>(ULONG)(size-sizeof(struct Csnaphdr))/sizeof(struct Csnapentry))
+      return -1;
+   return (long)hdr->nrentries;
+}
+
+BOOL Casnapinit(struct Casnap *cs,UBYTE *block,long size,struct Csnapentry **entries)
+{  struct Csnaphdr *hdr=(struct Csnaphdr *)block;
+   struct Csnapentry *e;
+   long offset,end;
+   ULONG i;
+   if(Casnapcount(block,size)<0) return FALSE;
+   end=size-hdr->nrbuckets*4;
+   offset=sizeof(struct Csnaphdr);
+   for(i=0;i<hdr->nrentries;i++)
+   {  e=(struct Csnapentry *)(block+offset);
+      if(!Checkentry(e,end-offset) || e->index!=i) return FALSE;
+      entries[i]=e;
+      offset+=e->reclen;
+   }
+   if(offset!=end) return FALSE;
+   cs->hdr=hdr;
+   cs->entries=entries;
+   cs->buckets=(ULONG *)(block+end);
+   return TRUE;
+}
+
+struct Csnapentry *Casnapfind(struct Casnap *cs,UBYTE *url)
+{  struct Csnapentry *e;
+   ULONG h=Casnaphash(url);
+   ULONG offset,end=(UBYTE *)cs->buckets-(UBYTE *)cs->hdr;
+   ULONG n;
+   offset=cs->buckets[h&(cs->hdr->nrbuckets-1)];
+   for(n=0;offset && n<cs->hdr->nrentries;n++)
+   {  /* Only follow offsets of real entries */
+      if((offset&3) || offset<sizeof(struct Csnaphdr) || offset>=end) break;
+      e=(struct Csnapentry *)((UBYTE *)cs->hdr+offset);
+      if(e->index>=cs->hdr->nrentries || cs->entries[e->index]!=e) break;
+      if(e->hash==h && !strcmp(Casnapurl(e),url)) return e;
+      offset=e->next;
+   }
+   return NULL;
+}
+
+UBYTE *Casnapmimetype(struct Csnapentry *e)
+{  return (UBYTE *)(e+1);
+}
+
+UBYTE *Casnapetag(struct Csnapentry *e)
+{  UBYTE *p=Casnapmimetype(e);
+   return p+strlen(p)+1;
+}
+
+UBYTE *Casnapurl(struct Csnapentry *e)
+{  UBYTE *p=Casnapetag(e);
+   return p+strlen(p)+1;
+}
+
+UBYTE *Casnapmovedto(struct Csnapentry *e)
+{  UBYTE *p=Casnapurl(e);
+   long n=strlen(p)+1;
+   return n<e->urlsize?p+n:NULL;
+}
+
+/*-----------------------------------------------------------------------*/
+
+long Casnapentrysize(UBYTE *url,UBYTE *movedto,UBYTE *mimetype,UBYTE *etag)
+{  long urlsize=strlen(url)+1,reclen;
+   if(movedto) urlsize+=strlen(movedto)+1;
+   if(urlsize>MAXURLSIZE || strlen(mimetype)>=MAXMIMETYPE || strlen(etag)>=MAXETAG) return 0;
+   reclen=ROUND4(sizeof(struct Csnapentry)+strlen(mimetype)+1+strlen(etag)+1+urlsize);
+   return reclen<=MAXRECLEN?reclen:0;
+}
+
+static void Writedata(struct Casnapwriter *w,void *data,long length)
+{  if(w->ok && w->write(w->handle,data,length)!=length) w->ok=FALSE;
+   w->offset+=length;
+}
+
+void Casnapstart(struct Casnapwriter *w,casnapwritef *write,void *handle,
+   ULONG *buckets,ULONG nrentries,ULONG serial,ULONG lastnr)
+{  struct Csnaphdr hdr;
+   ULONG i;
+   w->write=write;
+   w->handle=handle;
+   w->buckets=buckets;
+   w->nrbuckets=Casnapbuckets(nrentries);
+   w->nrentries=nrentries;
+   w->index=0;
+   w->offset=0;
+   w->ok=TRUE;
+   for(i=0;i<w->nrbuckets;i++) buckets[i]=0;
+   strncpy(hdr.label,"AWCS",4);
+   hdr.version=CASNAPVERSION;
+   hdr.serial=serial;
+   hdr.lastnr=lastnr;
+   hdr.nrentries=nrentries;
+   hdr.nrbuckets=w->nrbuckets;
+   Writedata(w,&hdr,sizeof(hdr));
+}
+
+void Casnapadd(struct Casnapwriter *w,struct Csnapentry *e,
+   UBYTE *url,UBYTE *movedto,UBYTE *mimetype,UBYTE *etag)
+{  static UBYTE zero[4];
+   long reclen=Casnapentrysize(url,movedto,mimetype,etag);
+   long n;
+   ULONG *bucket;
+   if(!reclen || w->index>=w->nrentries)
+   {  w->ok=FALSE;
+      return;
+   }
+   e->hash=Casnaphash(url);
+   bucket=&w->buckets[e->hash&(w->nrbuckets-1)];
+   e->next=*bucket;
+   *bucket=w->offset;
+   e->index=w->index++;
+   e->reclen=reclen;
+   e->urlsize=strlen(url)+1;
+   if(movedto) e->urlsize+=strlen(movedto)+1;
+   Writedata(w,e,sizeof(*e));
+   n=sizeof(*e);
+   n+=strlen(mimetype)+1;
+   Writedata(w,mimetype,strlen(mimetype)+1);
+   n+=strlen(etag)+1;
+   Writedata(w,etag,strlen(etag)+1);
+   n+=strlen(url)+1;
+   Writedata(w,url,strlen(url)+1);
+   if(movedto)
+   {  n+=strlen(movedto)+1;
+      Writedata(w,movedto,strlen(movedto)+1);
+   }
+   if(reclen>n) Writedata(w,zero,reclen-n);
+}
+
+BOOL Casnapend(struct Casnapwriter *w)
+{  if(w->index!=w->nrentries) w->ok=FALSE;
+   Writedata(w,w->buckets,w->nrbuckets*4);
+   return w->ok;
+}
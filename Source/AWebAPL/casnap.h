@@ -0,0 +1,126 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb APL distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* casnap.h - AWeb disk cache registration snapshot */
+
+#ifndef AWEB_CASNAP_H
+#define AWEB_CASNAP_H
+
+#include <exec/types.h>
+
+/* The snapshot holds all cache entries at a checkpoint. It is read in
+ * one go and used as it is in memory: entries are found through a hash
+ * table of offsets in the file, so nothing has to be parsed or allocated
+ * per entry. Changes after the checkpoint go to the log (AWCU), which
+ * names the snapshot it follows by its serial number.
+ *
+ * File layout: struct Csnaphdr, (nrentries) entries each followed by its
+ * strings, then (nrbuckets) ULONG offsets of the first entry in each
+ * bucket. Offsets are from the start of the file, 0 is none. */
+
+#define CASNAPVERSION   1
+
+struct Csnaphdr
+{  UBYTE label[4];         /* 'AWCS' */
+   ULONG version;          /* CASNAPVERSION */
+   ULONG serial;           /* Checkpoint number */
+   ULONG lastnr;           /* Last cache nr used */
+   ULONG nrentries;
+   ULONG nrbuckets;        /* Power of 2 */
+};
+
+struct Csnapentry
+{  ULONG next;             /* Offset of next entry in the same bucket */
+   ULONG hash;             /* Casnaphash() of URL */
+   ULONG index;            /* Entry number in file */
+   ULONG nr;               /* Cache nr */
+   ULONG date;
+   ULONG expires;
+   ULONG cachedate;
+   long size;
+   ULONG atime;            /* Last access */
+   ULONG segnr;            /* Pack file nr, or 0 if in own file */
+   long packoffset;
+   long packlength;
+   ULONG packsum;
+   UWORD hits;             /* Uses after the first */
+   UWORD type;             /* Cache object type */
+   UWORD reclen;           /* Length including strings, multiple of 4 */
+   UWORD urlsize;          /* URL and moved-to URL, including '\0' bytes */
+   /* followed by MIME type '\0', ETag '\0', URL '\0',
+    * moved-to URL '\0' if any, padded to a multiple of 4 */
+};
+
+struct Casnap
+{  struct Csnaphdr *hdr;
+   struct Csnapentry **entries;  /* Entry for each index */
+   ULONG *buckets;
+};
+
+/* Hash of an URL */
+extern ULONG Casnaphash(UBYTE *url);
+
+/* Number of buckets for (nrentries) */
+extern ULONG Casnapbuckets(ULONG nrentries);
+
+/* Number of entries if (block) has a valid header, or -1 */
+extern long Casnapcount(UBYTE *block,long size);
+
+/* Check the snapshot in (block) and set up (cs) to use it. (entries) must
+ * have room for Casnapcount() pointers. */
+extern BOOL Casnapinit(struct Casnap *cs,UBYTE *block,long size,struct Csnapentry **entries);
+
+/* Find the entry for (url), or NULL */
+extern struct Csnapentry *Casnapfind(struct Casnap *cs,UBYTE *url);
+
+/* Strings of an entry. Casnapmovedto() returns NULL if there is none. */
+extern UBYTE *Casnapmimetype(struct Csnapentry *e);
+extern UBYTE *Casnapetag(struct Csnapentry *e);
+extern UBYTE *Casnapurl(struct Csnapentry *e);
+extern UBYTE *Casnapmovedto(struct Csnapentry *e);
+
+/*--- writing ---*/
+
+typedef long casnapwritef(void *handle,void *data,long length);
+
+struct Casnapwriter
+{  casnapwritef *write;
+   void *handle;
+   ULONG *buckets;         /* Casnapbuckets() ULONGs */
+   ULONG nrbuckets;
+   ULONG nrentries;
+   ULONG index;            /* Entries written */
+   ULONG offset;           /* Bytes written */
+   BOOL ok;
+};
+
+/* Size of the entry in the file, or 0 if it doesn't fit */
+extern long Casnapentrysize(UBYTE *url,UBYTE *movedto,UBYTE *mimetype,UBYTE *etag);
+
+/* Write the header. Exactly (nrentries) entries must follow. */
+extern void Casnapstart(struct Casnapwriter *w,casnapwritef *write,void *handle,
+   ULONG *buckets,ULONG nrentries,ULONG serial,ULONG lastnr);
+
+/* Write an entry. The fields from (nr) to (type) are taken from (e). */
+extern void Casnapadd(struct Casnapwriter *w,struct Csnapentry *e,
+   UBYTE *url,UBYTE *movedto,UBYTE *mimetype,UBYTE *etag);
+
+/* Write the hash table. Returns FALSE if anything failed. */
+extern BOOL Casnapend(struct Casnapwriter *w);
+
+#endif
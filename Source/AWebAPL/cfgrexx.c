@@ -65,6 +65,7 @@ static struct Iteminfo iteminfo[]=
    "BUTTON",            NULL,    IT_BUTTON,  OFFSET(Prefs,buttons),0,
    "CACHEDISK",         NULL,    IT_LONG,    OFFSET(Prefs,cadisksize),0,
    "CACHEMEMORY",       NULL,    IT_LONG,    OFFSET(Prefs,camemsize),0,
+   "CACHEPACK",         NULL,    IT_LONG,    OFFSET(Prefs,capacksize),0,
    "CACHEPATH",         NULL,    IT_STRING,  OFFSET(Prefs,cachepath),0,
    "CENTERREQS",        NULL,    IT_BOOL,    OFFSET(Prefs,centerreq),0,
    "COLOUR",            "BACKGROUND",IT_RGB, OFFSET(Prefs,background),0,
@@ -190,6 +191,7 @@ static struct Iteminfo iteminfo[]=
    "PALETTE",           "6",     IT_RGB,     OFFSET(Prefs,scrpalette[18]),0,
    "PALETTE",           "7",     IT_RGB,     OFFSET(Prefs,scrpalette[21]),0,
    "PASSIVEFTP",        NULL,    IT_BOOL,    OFFSET(Prefs,passiveftp),0,
+   "PIPELINING",        NULL,    IT_BOOL,    OFFSET(Prefs,pipelining),0,
    "POPUP",             NULL,    IT_POPUP,   OFFSET(Prefs,popupkey),0,
    "POPUPMENU",         NULL,    IT_PUPMENU, OFFSET(Prefs,popupmenu),0,
    "RESTRICTIMAGES",    NULL,    IT_BOOL,    OFFSET(Prefs,restrictimages),0,
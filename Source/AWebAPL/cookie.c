@@ -62,6 +62,27 @@ struct Cookie
    short version;
    UBYTE flags;
    long size;
+   struct Cookiedomain *cd;   /* Domain this cookie is stored under */
+   ULONG seq;                 /* Order in which cookies were added */
+   long heapnr;               /* Position in expiry heap, or 0 */
+};
+
+/* All cookies for one domain string. Domains are hashed from right to left,
+ * so the hashes of all suffixes of a host name are found in one pass. */
+struct Cookiedomain
+{  struct Cookiedomain *next; /* Next in hash bucket */
+   ULONG hash;
+   UBYTE *domain;
+   LIST(Cookie) cookies;      /* Sorted on pathlen, descending */
+};
+
+/* A cached Cookie: header for one host, path and secure state */
+struct Cookiecache
+{  NODE(Cookiecache);
+   UBYTE *key;
+   UBYTE *header;             /* Cookie: header, or NULL if no cookies */
+   struct Cookie **used;      /* Cookies in the header */
+   long nused;
 };
 
 #define COOF_DOMAIN  0x0001   /* Domain was given in original set */
@@ -72,11 +93,30 @@ struct Cookie
 /* Get cookie address from Usenode */
 #define COOKIE(u) ((struct Cookie *)((ULONG)u-8))
 
-/* List contains cookies sorted on pathlen, descending */
-static LIST(Cookie) cookies;
+#define DOMAINHASHMIN   64
+#define DOMAINLOADFACTOR 2
+#define COOKIECACHEMAX  32
+
+static struct Cookiedomain **domainhash;
+static long domainhashsize;
+static long nrdomains;
+
+/* Cookies with an expiry date, as a heap with the first to expire at [1] */
+static struct Cookie **expheap;
+static long nrexpheap,expheapsize;
+
+/* Header cache, most recently used first. Flushed when any cookie changes. */
+static LIST(Cookiecache) cookiecache;
+static long nrcookiecache;
+
+/* Bumped when preferences that affect cookies change. The cache is flushed
+ * when this no longer matches cookiecachegen. */
+static volatile ULONG cookieprefsgen;
+static ULONG cookiecachegen;
 
 static LIST(Usenode) usenodes;
 static long cookiesize=0;
+static ULONG cookieseq=0;
 
 static struct SignalSemaphore cookiesema;
 
@@ -282,9 +322,180 @@ static short Askcookie(UBYTE *domain,UBYTE *path,UBYTE *name,UBYTE *value,
 
 /*----------------------------------------------------------------------*/
 
+/* Flush the header cache */
+static void Flushcookiecache(void)
+{  struct Cookiecache *cc;
+   while(cc=REMHEAD(&cookiecache))
+   {  if(cc->key) FREE(cc->key);
+      if(cc->header) FREE(cc->header);
+      if(cc->used) FREE(cc->used);
+      FREE(cc);
+   }
+   nrcookiecache=0;
+}
+
+/* One step of the domain hash. Steps are taken from the last character
+ * to the first. */
+#define DOMAINHASHSTEP(h,c)   (((h)^(ULONG)tolower(c))*16777619UL)
+#define DOMAINHASHINIT        2166136261UL
+
+static ULONG Domainhash(UBYTE *domain)
+{  ULONG h=DOMAINHASHINIT;
+   UBYTE *p;
+   for(p=domain+strlen(domain);p>domain;)
+   {  p--;
+      h=DOMAINHASHSTEP(h,*p);
+   }
+   return h;
+}
+
+/* Find the domain record for this domain. If (dot) is set, look for
+ * "." followed by (domain). */
+static struct Cookiedomain *Finddomain(ULONG hash,UBYTE *domain,BOOL dot)
+{  struct Cookiedomain *cd;
+   if(!domainhash) return NULL;
+   for(cd=domainhash[hash&(domainhashsize-1)];cd;cd=cd->next)
+   {  if(cd->hash==hash)
+      {  if(dot)
+         {  if(cd->domain[0]=='.' && STRIEQUAL(cd->domain+1,domain)) return cd;
+         }
+         else
+         {  if(STRIEQUAL(cd->domain,domain)) return cd;
+         }
+      }
+   }
+   return NULL;
+}
+
+/* Double the domain hash table */
+static BOOL Growdomainhash(void)
+{  struct Cookiedomain **newhash,*cd,*next;
+   long newsize,i;
+   newsize=domainhashsize?2*domainhashsize:DOMAINHASHMIN;
+   if(!(newhash=ALLOCTYPE(struct Cookiedomain *,newsize,MEMF_CLEAR))) return FALSE;
+   for(i=0;i<domainhashsize;i++)
+   {  for(cd=domainhash[i];cd;cd=next)
+      {  next=cd->next;
+         cd->next=newhash[cd->hash&(newsize-1)];
+         newhash[cd->hash&(newsize-1)]=cd;
+      }
+   }
+   if(domainhash) FREE(domainhash);
+   domainhash=newhash;
+   domainhashsize=newsize;
+   return TRUE;
+}
+
+/* Find or create the domain record */
+static struct Cookiedomain *Adddomain(UBYTE *domain)
+{  struct Cookiedomain *cd;
+   ULONG hash=Domainhash(domain);
+   if(cd=Finddomain(hash,domain,FALSE)) return cd;
+   if(nrdomains>=domainhashsize*DOMAINLOADFACTOR || !domainhash)
+   {  if(!Growdomainhash() && !domainhash) return NULL;
+   }
+   if(cd=ALLOCSTRUCT(Cookiedomain,1,MEMF_CLEAR))
+   {  if(cd->domain=Dupstr(domain,-1))
+      {  cd->hash=hash;
+         NEWLIST(&cd->cookies);
+         cd->next=domainhash[hash&(domainhashsize-1)];
+         domainhash[hash&(domainhashsize-1)]=cd;
+         nrdomains++;
+      }
+      else
+      {  FREE(cd);
+         cd=NULL;
+      }
+   }
+   return cd;
+}
+
+/* Remove the domain record when its last cookie is gone */
+static void Remdomain(struct Cookiedomain *cd)
+{  struct Cookiedomain **pcd;
+   for(pcd=&domainhash[cd->hash&(domainhashsize-1)];*pcd;pcd=&(*pcd)->next)
+   {  if(*pcd==cd)
+      {  *pcd=cd->next;
+         break;
+      }
+   }
+   nrdomains--;
+   FREE(cd->domain);
+   FREE(cd);
+}
+
+/*----------------------------------------------------------------------*/
+
+/* Expiry heap. Positions are 1-based, so heapnr 0 means not in the heap. */
+
+static void Heapset(long i,struct Cookie *ck)
+{  expheap[i]=ck;
+   ck->heapnr=i;
+}
+
+static void Heapup(long i)
+{  struct Cookie *ck=expheap[i];
+   while(i>1 && expheap[i/2]->expires>ck->expires)
+   {  Heapset(i,expheap[i/2]);
+      i/=2;
+   }
+   Heapset(i,ck);
+}
+
+static void Heapdown(long i)
+{  struct Cookie *ck=expheap[i];
+   long j;
+   for(;;)
+   {  j=2*i;
+      if(j>nrexpheap) break;
+      if(j<nrexpheap && expheap[j+1]->expires<expheap[j]->expires) j++;
+      if(expheap[j]->expires>=ck->expires) break;
+      Heapset(i,expheap[j]);
+      i=j;
+   }
+   Heapset(i,ck);
+}
+
+static void Heapadd(struct Cookie *ck)
+{  struct Cookie **newheap;
+   long newsize;
+   if(nrexpheap+1>=expheapsize)
+   {  newsize=expheapsize?2*expheapsize:64;
+      if(!(newheap=ALLOCTYPE(struct Cookie *,newsize,0))) return;
+      if(expheap)
+      {  memcpy(newheap,expheap,(nrexpheap+1)*sizeof(struct Cookie *));
+         FREE(expheap);
+      }
+      expheap=newheap;
+      expheapsize=newsize;
+   }
+   Heapset(++nrexpheap,ck);
+   Heapup(nrexpheap);
+}
+
+static void Heapremove(struct Cookie *ck)
+{  long i=ck->heapnr;
+   if(i)
+   {  ck->heapnr=0;
+      if(i<nrexpheap)
+      {  Heapset(i,expheap[nrexpheap--]);
+         Heapup(i);
+         Heapdown(expheap[i]->heapnr);
+      }
+      else nrexpheap--;
+   }
+}
+
+/*----------------------------------------------------------------------*/
+
 static void Deletecookie(struct Cookie *ck)
 {  if(ck)
-   {  if(ck->use.next) REMOVE(&ck->use);
+   {  if(ck->cd)
+      {  REMOVE(ck);
+         if(ISEMPTY(&ck->cd->cookies)) Remdomain(ck->cd);
+      }
+      Heapremove(ck);
+      if(ck->use.next) REMOVE(&ck->use);
       if(ck->name) FREE(ck->name);
       if(ck->value) FREE(ck->value);
       if(ck->domain) FREE(ck->domain);
@@ -292,52 +503,78 @@ static void Deletecookie(struct Cookie *ck)
       if(ck->comment) FREE(ck->comment);
       cookiesize-=ck->size;
       FREE(ck);
+      Flushcookiecache();
    }
 }
 
-/* Remember this cookie. Delete any old cookies with same keys */
-static void Addcookie(struct Cookie *nck)
-{  struct Cookie *ck,*nextck;
-   ObtainSemaphore(&cookiesema);
-   for(ck=cookies.first;ck->next;ck=nextck)
-   {  nextck=ck->next;
-      if(STRIEQUAL(ck->domain,nck->domain)
-      && STREQUAL(ck->path,nck->path)
-      && STRIEQUAL(ck->name,nck->name))
-      {  REMOVE(ck);
-         Deletecookie(ck);
+/* Delete all cookies that have expired */
+static void Expirecookies(void)
+{  ULONG now;
+   if(nrexpheap)
+   {  now=Today();
+      while(nrexpheap && expheap[1]->expires<now)
+      {  Deletecookie(expheap[1]);
       }
    }
-   if(nck->expires && nck->expires<=Today())
-   {  Deletecookie(nck);
-   }
-   else
+}
+
+/* Remember this cookie. Delete any old cookies with same keys.
+ * Returns TRUE if the cookie was kept and has an expiry date. */
+static BOOL Addcookie(struct Cookie *nck)
+{  struct Cookie *ck,*nextck;
+   struct Cookiedomain *cd;
+   BOOL saved=FALSE;
+   ObtainSemaphore(&cookiesema);
+   if(cd=Adddomain(nck->domain))
    {  nck->pathlen=strlen(nck->path);
       nck->domainlen=strlen(nck->domain);
       nck->size=nck->pathlen+nck->domainlen+strlen(nck->name)+strlen(nck->value);
       if(nck->comment) nck->size+=strlen(nck->comment);
-      for(ck=cookies.first;ck->next;ck=ck->next)
+      nck->seq=++cookieseq;
+      for(ck=cd->cookies.first;ck->next;ck=ck->next)
       {  if(ck->pathlen<nck->pathlen) break;
       }
-      INSERT(&cookies,nck,ck->prev);
+      INSERT(&cd->cookies,nck,ck->prev);
+      nck->cd=cd;
       ADDTAIL(&usenodes,&nck->use);
-      cookiesize+=ck->size;
+      if(nck->expires) Heapadd(nck);
+      cookiesize+=nck->size;
+      /* The domain keeps at least the new cookie, so it isn't freed here */
+      for(ck=cd->cookies.first;ck->next;ck=nextck)
+      {  nextck=ck->next;
+         if(ck!=nck
+         && STREQUAL(ck->path,nck->path)
+         && STRIEQUAL(ck->name,nck->name))
+         {  Deletecookie(ck);
+         }
+      }
+      if(nck->expires && nck->expires<=Today())
+      {  Deletecookie(nck);
+      }
+      else if(nck->expires) saved=TRUE;
+      Flushcookiecache();
+   }
+   else
+   {  Deletecookie(nck);
    }
    ReleaseSemaphore(&cookiesema);
+   return saved;
 }
 
 /* Check if this is a known cookie */
 static short Knowncookie(UBYTE *domain,UBYTE *path,UBYTE *name)
 {  struct Cookie *ck;
+   struct Cookiedomain *cd;
    short known=COOKIE_REJECT;
 #ifndef DEMOVERSION
    ObtainSemaphore(&cookiesema);
-   for(ck=cookies.first;ck->next && !known;ck=ck->next)
-   {  if((ck->flags&COOF_ACCEPT)
-      && STRIEQUAL(ck->domain,domain)
-      && STREQUAL(ck->path,path)
-      && STRIEQUAL(ck->name,name))
-      {  known=COOKIE_ACCEPT;
+   if(cd=Finddomain(Domainhash(domain),domain,FALSE))
+   {  for(ck=cd->cookies.first;ck->next && !known;ck=ck->next)
+      {  if((ck->flags&COOF_ACCEPT)
+         && STREQUAL(ck->path,path)
+         && STRIEQUAL(ck->name,name))
+         {  known=COOKIE_ACCEPT;
+         }
       }
    }
    ReleaseSemaphore(&cookiesema);
@@ -424,35 +661,6 @@ static BOOL Matchdomain(UBYTE *domain,UBYTE *orgdomain)
    return match;
 }
 
-/* See if cookie matches domain to send.
- * Both must be equal, or ckdomain must match domain from (domain)'s first period.
- * If RFC2109 is off, a simple right-hand match is used. */
-static BOOL Matchdomainsend(UBYTE *ckdomain,UBYTE *domain)
-{  UBYTE *p;
-   BOOL match=FALSE;
-   long l1,l2;
-   if(STRIEQUAL(ckdomain,domain))
-   {  match=TRUE;
-   }
-   else
-   {        if(prefs.rfc2109)
-      {  p=strchr(domain,'.');
-         if(p && STRIEQUAL(ckdomain,p)) match=TRUE;
-      }
-      else
-      {  if((*ckdomain=='.') && (STRIEQUAL(ckdomain+1,domain)))
-         {  match=TRUE;
-         }
-         else
-         {  l1=strlen(ckdomain);
-            l2=strlen(domain);
-            if(l2>l1 && STRIEQUAL(domain+l2-l1,ckdomain)) match=TRUE;
-         }
-      }
-   }
-   return match;
-}
-
 /* See if path matches orgpath */
 static BOOL Matchpath(UBYTE *path,UBYTE *orgpath)
 {  long len,orglen;
@@ -488,6 +696,115 @@ static BOOL Nocookie(UBYTE *domain)
    return result;
 }
 
+/* Sort cookies to send: longest path first, then in the order they were set */
+static int Sortcookies(struct Cookie **ca,struct Cookie **cb)
+{  if((*ca)->pathlen!=(*cb)->pathlen) return (*cb)->pathlen-(*ca)->pathlen;
+   return ((*ca)->seq<(*cb)->seq)?-1:1;
+}
+
+/* Add the matching cookies of this domain record to the array */
+static BOOL Gatherdomain(struct Cookiedomain *cd,UBYTE *path,short secure,
+   struct Cookie ***array,long *n,long *size)
+{  struct Cookie *ck,**newarray;
+   long newsize;
+   if(!cd || Nocookie(cd->domain)) return TRUE;
+   for(ck=cd->cookies.first;ck->next;ck=ck->next)
+   {  if(Matchpath(ck->path,path)
+      && (secure<0 || secure || !(ck->flags&COOF_SECURE)))
+      {  if(*n>=*size)
+         {  newsize=*size?2*(*size):16;
+            if(!(newarray=ALLOCTYPE(struct Cookie *,newsize,0))) return FALSE;
+            if(*array)
+            {  memcpy(newarray,*array,*n*sizeof(struct Cookie *));
+               FREE(*array);
+            }
+            *array=newarray;
+            *size=newsize;
+         }
+         (*array)[(*n)++]=ck;
+      }
+   }
+   return TRUE;
+}
+
+/* Find all cookies to send to this domain and path, in the order to send them.
+ * A cookie is sent if its domain equals (domain), or if it matches (domain)
+ * from its first period. If RFC2109 is off, any right-hand part of (domain)
+ * matches, and so does (domain) preceded by a period.
+ * If (secure) is negative, secure cookies are included too.
+ * Returns the number of cookies, the array must be freed by the caller. */
+static long Gathercookies(UBYTE *domain,UBYTE *path,short secure,struct Cookie ***array)
+{  UBYTE *p,*dot;
+   ULONG h=DOMAINHASHINIT;
+   long n=0,size=0;
+   BOOL rfc2109=prefs.rfc2109;
+   *array=NULL;
+   dot=strchr(domain,'.');
+   p=domain+strlen(domain);
+   if(!*domain || !rfc2109)
+   {  Gatherdomain(Finddomain(h,p,FALSE),path,secure,array,&n,&size);
+   }
+   while(p>domain)
+   {  p--;
+      h=DOMAINHASHSTEP(h,*p);
+      if(p==domain || !rfc2109 || p==dot)
+      {  if(!Gatherdomain(Finddomain(h,p,FALSE),path,secure,array,&n,&size)) break;
+      }
+   }
+   if(!rfc2109 && *domain)
+   {  h=DOMAINHASHSTEP(h,'.');
+      Gatherdomain(Finddomain(h,domain,TRUE),path,secure,array,&n,&size);
+   }
+   if(n>1) qsort(*array,n,sizeof(struct Cookie *),Sortcookies);
+   return n;
+}
+
+/* Find the cached header for this key, and make it the most recently used one */
+static struct Cookiecache *Findcookiecache(UBYTE *key)
+{  struct Cookiecache *cc;
+   if(cookieprefsgen!=cookiecachegen)
+   {  Flushcookiecache();
+      cookiecachegen=cookieprefsgen;
+   }
+   for(cc=cookiecache.first;cc->next;cc=cc->next)
+   {  if(STREQUAL(cc->key,key))
+      {  REMOVE(cc);
+         ADDHEAD(&cookiecache,cc);
+         return cc;
+      }
+   }
+   return NULL;
+}
+
+/* Remember a header. Takes over the used array. */
+static void Addcookiecache(UBYTE *key,UBYTE *header,struct Cookie **used,long nused)
+{  struct Cookiecache *cc;
+   if(nrcookiecache>=COOKIECACHEMAX)
+   {  cc=cookiecache.last;
+      REMOVE(cc);
+      nrcookiecache--;
+      if(cc->key) FREE(cc->key);
+      if(cc->header) FREE(cc->header);
+      if(cc->used) FREE(cc->used);
+      FREE(cc);
+   }
+   if((cc=ALLOCSTRUCT(Cookiecache,1,MEMF_CLEAR))
+   && (cc->key=Dupstr(key,-1))
+   && (!header || (cc->header=Dupstr(header,-1))))
+   {  cc->used=used;
+      cc->nused=nused;
+      ADDHEAD(&cookiecache,cc);
+      nrcookiecache++;
+   }
+   else
+   {  if(cc)
+      {  if(cc->key) FREE(cc->key);
+         FREE(cc);
+      }
+      if(used) FREE(used);
+   }
+}
+
 static void Writestring(void *fh,UBYTE *string)
 {  WriteAsync(fh,string,strlen(string));
 }
@@ -499,6 +816,7 @@ static void Savecookies(void)
    void *fh;
    UBYTE name[256],datebuf[32];
    ObtainSemaphore(&cookiesema);
+   Expirecookies();
    strcpy(name,Cachename());
    if(AddPart(name,"AWCK",256))
    {  if(fh=OpenAsync(name,MODE_WRITE,IOBUFSIZE))
@@ -670,8 +988,7 @@ static void Parsecookie(UBYTE *cookiespec,UBYTE *orgdomain,UBYTE *orgpath,ULONG
                   if(version) ck->version=atol(version);
                   if(ok==COOKIE_ACCEPT) flags|=COOF_ACCEPT;
                   ck->flags=flags;
-                  Addcookie(ck);
-                  if(orgdomain && ck->expires)
+                  if(Addcookie(ck) && orgdomain)
                   {  Savecookies();
                   }
                }
@@ -726,8 +1043,8 @@ err:
 BOOL Initcookie(void)
 {  
 #ifndef LOCALONLY
-   NEWLIST(&cookies);
    NEWLIST(&usenodes);
+   NEWLIST(&cookiecache);
    InitSemaphore(&cookiesema);
    Readcookies();
 #endif
@@ -737,10 +1054,16 @@ BOOL Initcookie(void)
 void Freecookie(void)
 {  
 #ifndef LOCALONLY
-   void *p;
-   if(cookies.first)
+   if(usenodes.first)
    {  Savecookies();
-      while(p=REMHEAD(&cookies)) Deletecookie(p);
+      while(!ISEMPTY(&usenodes)) Deletecookie(COOKIE(usenodes.first));
+      if(domainhash) FREE(domainhash);
+      domainhash=NULL;
+      domainhashsize=0;
+      if(expheap) FREE(expheap);
+      expheap=NULL;
+      nrexpheap=expheapsize=0;
+      Flushcookiecache();
    }
 #endif
 }
@@ -762,18 +1085,41 @@ UBYTE *Findcookies(UBYTE *url,BOOL secure)
 #ifndef LOCALONLY
    struct Buffer buf={0};
    UBYTE versionbuf[16];
-   struct Cookie *ck;
-   UBYTE *urldup,*domain=NULL,*path=NULL;
-   BOOL first=TRUE;
+   struct Cookie *ck,**used;
+   struct Cookiecache *cc;
+   UBYTE *urldup,*domain=NULL,*path=NULL,*key,*p;
+   long nused,i;
+   BOOL rfc2109;
    urldup=Breakup(url,&domain,&path);
    if(!urldup) return NULL;
+   /* Key is secure flag, lowercase domain and path */
+   if(!(key=ALLOCTYPE(UBYTE,strlen(domain)+strlen(path)+3,0)))
+   {  FREE(urldup);
+      return NULL;
+   }
+   key[0]=secure?'S':'-';
+   for(p=key+1;*domain;domain++) *p++=tolower(*domain);
+   *p++=' ';
+   strcpy(p,path);
+   domain=urldup;
    ObtainSemaphore(&cookiesema);
-   for(ck=cookies.first;ck->next;ck=ck->next)
-   {  if(Matchdomainsend(ck->domain,domain) && Matchpath(ck->path,path)
-      && !Nocookie(ck->domain)
-      && (secure || !(ck->flags&COOF_SECURE))
-      && (!ck->expires || ck->expires>=Today()))
-      {  if(first)
+   Expirecookies();
+   if(cc=Findcookiecache(key))
+   {  for(i=0;i<cc->nused;i++)
+      {  ck=cc->used[i];
+         REMOVE(&ck->use);
+         ADDTAIL(&usenodes,&ck->use);
+      }
+      if(cc->header) header=Dupstr(cc->header,-1);
+   }
+   else
+   {  nused=Gathercookies(domain,path,secure?1:0,&used);
+      ObtainSemaphore(&prefssema);
+      rfc2109=prefs.rfc2109;
+      ReleaseSemaphore(&prefssema);
+      for(i=0;i<nused;i++)
+      {  ck=used[i];
+         if(i==0)
          {  Addtobuffer(&buf,"Cookie: ",8);
             if(ck->version)
             {  sprintf(versionbuf,"%d",ck->version);
@@ -788,8 +1134,7 @@ UBYTE *Findcookies(UBYTE *url,BOOL secure)
          Addtobuffer(&buf,ck->name,strlen(ck->name));
          Addtobuffer(&buf,"=",1);
          Addtobuffer(&buf,ck->value,strlen(ck->value));
-         ObtainSemaphore(&prefssema);
-         if(prefs.rfc2109)
+         if(rfc2109)
          {  if(ck->flags&COOF_PATH)
             {  Addtobuffer(&buf,"; $Path=\"",9);
                Addtobuffer(&buf,ck->path,strlen(ck->path));
@@ -801,18 +1146,18 @@ UBYTE *Findcookies(UBYTE *url,BOOL secure)
                Addtobuffer(&buf,"\"",1);
             }
          }
-         ReleaseSemaphore(&prefssema);
          REMOVE(&ck->use);
          ADDTAIL(&usenodes,&ck->use);
-         first=FALSE;
       }
+      if(buf.buffer)
+      {  Addtobuffer(&buf,"\r\n",3);
+         header=Dupstr(buf.buffer,-1);
+         Freebuffer(&buf);
+      }
+      Addcookiecache(key,header,used,nused);
    }
    ReleaseSemaphore(&cookiesema);
-   if(buf.buffer)
-   {  Addtobuffer(&buf,"\r\n",3);
-      header=Dupstr(buf.buffer,-1);
-      Freebuffer(&buf);
-   }
+   FREE(key);
    FREE(urldup);
 #endif
    return header;
@@ -823,26 +1168,25 @@ UBYTE *Getjcookies(UBYTE *url)
 {  UBYTE *cstring=NULL;
 #ifndef LOCALONLY
    struct Buffer buf={0};
-   struct Cookie *ck;
+   struct Cookie *ck,**used;
    UBYTE *urldup,*domain=NULL,*path=NULL;
-   BOOL first=TRUE;
+   long nused,i;
    urldup=Breakup(url,&domain,&path);
    if(!urldup) return NULL;
    ObtainSemaphore(&cookiesema);
-   for(ck=cookies.first;ck->next;ck=ck->next)
-   {  if(Matchdomainsend(ck->domain,domain) && Matchpath(ck->path,path)
-      && !Nocookie(ck->domain)
-      && (!ck->expires || ck->expires>=Today()))
-      {  if(!first)
-         {  Addtobuffer(&buf,"; ",2);
-         }
-         Addtobuffer(&buf,ck->name,strlen(ck->name));
-         Addtobuffer(&buf,"=",1);
-         Addtobuffer(&buf,ck->value,strlen(ck->value));
-         first=FALSE;
+   Expirecookies();
+   nused=Gathercookies(domain,path,-1,&used);
+   for(i=0;i<nused;i++)
+   {  ck=used[i];
+      if(i)
+      {  Addtobuffer(&buf,"; ",2);
       }
+      Addtobuffer(&buf,ck->name,strlen(ck->name));
+      Addtobuffer(&buf,"=",1);
+      Addtobuffer(&buf,ck->value,strlen(ck->value));
    }
    ReleaseSemaphore(&cookiesema);
+   if(used) FREE(used);
    if(buf.buffer)
    {  Addtobuffer(&buf,"",1);
       cstring=Dupstr(buf.buffer,-1);
@@ -853,17 +1197,25 @@ UBYTE *Getjcookies(UBYTE *url)
    return cstring;
 }
 
+/* Forget cached headers after the nocookie list or cookie options changed */
+void Cookieprefschanged(void)
+{
+#ifndef LOCALONLY
+   cookieprefsgen++;
+#endif
+}
+
 void Flushcookies(long max)
 {  
 #ifndef LOCALONLY
    struct Usenode *u,*next;
-   struct Cookie *ck;
+   ObtainSemaphore(&cookiesema);
+   Expirecookies();
    for(u=usenodes.first;u->next && cookiesize>max;u=next)
    {  next=u->next;
-      ck=COOKIE(u);
-      REMOVE(ck);
-      Deletecookie(ck);
+      Deletecookie(COOKIE(u));
    }
+   ReleaseSemaphore(&cookiesema);
 #endif
 }
 
@@ -902,13 +1254,14 @@ void Getrexxcookies(struct Arexxcmd *ac,UBYTE *stem)
 
 void Setrexxcookies(struct Arexxcmd *ac,UBYTE *stem,BOOL add)
 {  UBYTE *name,*value,*expires,*domain,*path,*comment,*version,*flags,*max;
-   struct Cookie *ck;
    long nmax,i;
    struct Buffer buf={0};
    UBYTE *p;
 #ifndef LOCALONLY
    if(!add)
-   {  while(ck=REMHEAD(&cookies)) Deletecookie(ck);
+   {  ObtainSemaphore(&cookiesema);
+      while(!ISEMPTY(&usenodes)) Deletecookie(COOKIE(usenodes.first));
+      ReleaseSemaphore(&cookiesema);
    }
    if(max=Getstemvar(ac,stem,0,NULL))
    {  nmax=atoi(max);
@@ -313,6 +313,17 @@ static void Setdisplayed(struct Copy *cop,BOOL displayed)
    SETFLAG(cop->flags,CPYF_DISPLAYED,displayed);
 }
 
+/* We are visible but still waiting for our source. Let the url know,
+ * so its fetch is started before images that are not visible. */
+static void Showncopy(struct Copy *cop)
+{  void *url;
+   if(!(cop->flags&CPYF_SHOWN) && cop->source
+   && (url=(void *)Agetattr(cop->source,AOSRC_Url)))
+   {  Asetattrs(url,AOURL_Visible,TRUE,TAG_END);
+      cop->flags|=CPYF_SHOWN;
+   }
+}
+
 /* Our image has changed. If it is embedded and still fits in place, render it now
  * if we are displayed.
  * If it is background, only let parent know when driver is ready.
@@ -428,6 +439,7 @@ static void Initialloadcopy(struct Copy *cop)
    {  if(!prefs.restrictimages || Issamehost(url,cop->referer))
       {  if(prefs.docolors)
          {  Auload(url,AUMLF_IMAGE|flag,cop->referer,NULL,cop->frame);
+            Showncopy(cop);
          }
          else
          {  Auload(url,AUMLF_IFINMEM|PROXY(cop),cop->referer,NULL,cop->frame);
@@ -628,7 +640,8 @@ static long Rendercopy(struct Copy *cop,struct Amrender *amr)
       }
    }
    else
-   {  coo=Clipcoords(cop->cframe,amr->coords);
+   {  Showncopy(cop);
+      coo=Clipcoords(cop->cframe,amr->coords);
       if(coo && coo->rp)
       {  if(!(amr->flags&(AMRF_UPDATESELECTED|AMRF_UPDATENORMAL)))
          {  if(amr->flags&AMRF_CLEAR)
@@ -746,6 +759,7 @@ static long Setcopy(struct Copy *cop,struct Amset *ams)
       {  case AOCPY_Url:
             newsource=(void *)Agetattr((void *)tag->ti_Data,AOURL_Source);
             cop->flags|=CPYF_NEWSOURCE;
+            cop->flags&=~CPYF_SHOWN;
             cop->url=(void *)tag->ti_Data;
             if(cop->win && (cop->flags&CPYF_INITIAL)) initload=TRUE;
             else if(cop->flags&CPYF_JSIMAGE) initload=TRUE;
@@ -753,7 +767,7 @@ static long Setcopy(struct Copy *cop,struct Amset *ams)
          case AOCPY_Source:
             newsource=(void *)tag->ti_Data;
             cop->flags|=CPYF_NEWSOURCE;
-            cop->flags&=~(CPYF_ERROR|CPYF_EOF);
+            cop->flags&=~(CPYF_ERROR|CPYF_EOF|CPYF_SHOWN);
             if(cop->driver)
             {  Adisposeobject(cop->driver);
                cop->driver=NULL;
@@ -84,6 +84,7 @@ struct Copy
 #define CPYF_CHANGEDCOPY   0x00100000  /* Driver has changed, rerender */
 #define CPYF_BORDERSET     0x00200000  /* Border was explicitly set */
 #define CPYF_POPUPHIT      0x00400000  /* Last hittest was for popup */
+#define CPYF_SHOWN         0x00800000  /* Url was told we are visible */
 
 #define PROXY(c) (Agetattr((c)->win,AOWIN_Noproxy)?AUMLF_NOPROXY:0)
 
@@ -115,6 +115,7 @@ void ParseCSSStylesheet(struct Document *doc,UBYTE *css)
       struct CSSSelector *sel;
       long ruleCount = 0;
       doc->cssstylesheet = (void *)sheet;
+      IndexCSSRules(sheet,(struct CSSRule *)sheet->rules.mlh_Head);
       /* Count rules and log selectors */
       for(rule = (struct CSSRule *)sheet->rules.mlh_Head;
           (struct MinNode *)rule->node.mln_Succ;
@@ -143,6 +144,7 @@ void MergeCSSStylesheet(struct Document *doc,UBYTE *css)
 {  struct CSSStylesheet *existingSheet;
    struct CSSStylesheet *newSheet;
    struct CSSRule *rule;
+   struct CSSRule *firstRule;
    struct CSSSelector *sel;
    long ruleCount;
    
@@ -182,6 +184,7 @@ void MergeCSSStylesheet(struct Document *doc,UBYTE *css)
    /* If no existing stylesheet, just use the new one */
    if(!doc->cssstylesheet)
    {  doc->cssstylesheet = (void *)newSheet;
+      IndexCSSRules(newSheet,(struct CSSRule *)newSheet->rules.mlh_Head);
       /* debug_printf("MergeCSSStylesheet: No existing sheet, using new one\n"); */
       return;
    }
@@ -190,21 +193,18 @@ void MergeCSSStylesheet(struct Document *doc,UBYTE *css)
    existingSheet = (struct CSSStylesheet *)doc->cssstylesheet;
    
    /* Move all rules from newSheet to existingSheet */
+   firstRule = NULL;
    while((rule = (struct CSSRule *)REMHEAD(&newSheet->rules)))
    {  ADDTAIL(&existingSheet->rules,rule);
+      if(!firstRule) firstRule = rule;
    }
    
    /* Free the empty newSheet structure */
    FREE(newSheet);
    
-   /* Count total rules after merge */
-   ruleCount = 0;
-   for(rule = (struct CSSRule *)existingSheet->rules.mlh_Head;
-       (struct MinNode *)rule->node.mln_Succ;
-       rule = (struct CSSRule *)rule->node.mln_Succ)
-   {  ruleCount++;
-   }
-   css_debug_printf("MergeCSSStylesheet: Merge completed, total rules=%ld\n", ruleCount);
+   /* Add the merged rules to the index, after the existing ones */
+   if(firstRule) IndexCSSRules(existingSheet,firstRule);
+   css_debug_printf("MergeCSSStylesheet: Merge completed, total rules=%ld\n", existingSheet->nrules);
 }
 
 /* Parse CSS content */
@@ -418,7 +418,7 @@ static struct CSSStylesheet* ParseCSS(struct Document *doc,UBYTE *css)
                   url = Findurl(doc->base, importUrl, 0);
                   if(url)
                   {  /* Try to load external CSS */
-                     extcss = Finddocext(doc, url, FALSE);
+                     extcss = Finddocext(doc, url, FALSE, AUMLF_STYLE);
                      if(extcss && extcss != (UBYTE *)~0)
                      {  /* CSS loaded synchronously - merge it immediately */
                         css_debug_printf("ParseCSS: @import CSS loaded synchronously, merging\n");
@@ -2238,6 +2238,9 @@ void ApplyCSSToElement(struct Document *doc,void *element)
    UBYTE *class;
    UBYTE *id;
    long matchCount;
+   struct CSSCandidates cand;
+   struct CSSRule *lastRule;
+   long i;
    
    if(!doc || !element || !doc->cssstylesheet) return;
    
@@ -2268,44 +2271,20 @@ void ApplyCSSToElement(struct Document *doc,void *element)
    
    NEWLIST(&matches);
    
-   /* Find all matching rules and calculate their maximum specificity */
-   /* Optimize: Check element attributes once to avoid repeated Agetattr calls */
-   for(rule = (struct CSSRule *)sheet->rules.mlh_Head;
-       (struct MinNode *)rule->node.mln_Succ;
-       rule = (struct CSSRule *)rule->node.mln_Succ)
-   {  maxSpec = 0;
-      for(sel = (struct CSSSelector *)rule->selectors.mlh_Head;
-         (struct MinNode *)sel->node.mln_Succ;
-         sel = (struct CSSSelector *)sel->node.mln_Succ)
-      {  /* Quick rejection: If selector has an ID and element doesn't match, skip */
-         if(sel->type & CSS_SEL_ID && sel->id)
-         {  UBYTE *elemId;
-            short objtype;
-            struct Aobject *ao;
-            
-            ao = (struct Aobject *)element;
-            objtype = ao->objecttype;
-            if(objtype == AOTP_BODY)
-            {  elemId = (UBYTE *)Agetattr(element, AOBDY_Id);
-            }
-            else
-            {  elemId = (UBYTE *)Agetattr(element, AOELT_Id);
-            }
-            if(!elemId || Stricmp((char *)sel->id, (char *)elemId) != 0)
-            {  continue;  /* ID doesn't match, skip this selector */
-            }
-         }
-         
-         if(MatchSelector(sel,element))
-         {  /* Find maximum specificity among matching selectors */
-            if(sel->specificity > maxSpec)
-            {  maxSpec = sel->specificity;
-            }
-            /* Early exit: If we found a match, we can stop checking other selectors in this rule */
-            /* (One matching selector is enough to apply the rule) */
-            break;
-         }
-      }
+   /* Find all matching rules and calculate their maximum specificity.
+    * Only selectors filed under this element's tag, classes, id or the
+    * universal bucket can match. */
+   FindCSSCandidates(sheet,tagname,class,id,&cand);
+   lastRule = NULL;
+   for(i = 0; i < cand.count; i++)
+   {  rule = cand.entries[i]->rule;
+      sel = cand.entries[i]->sel;
+      
+      /* One matching selector is enough to apply the rule */
+      if(rule == lastRule) continue;
+      if(!MatchSelector(sel,element)) continue;
+      lastRule = rule;
+      maxSpec = sel->specificity;
       
       /* If at least one selector matched, add rule with its specificity */
       if(maxSpec > 0)
@@ -2338,6 +2317,7 @@ void ApplyCSSToElement(struct Document *doc,void *element)
          }
       }
    }
+   FreeCSSCandidates(&cand);
    
    /* Count matching rules */
    matchCount = 0;
@@ -2558,6 +2538,8 @@ static void FreeCSSStylesheetInternal(struct CSSStylesheet *sheet)
    if(!sheet) return;
    
    /* Remove and free all rules from the list */
+   FreeCSSIndex(sheet);
+   
    while((rule = (struct CSSRule *)REMHEAD(&sheet->rules)))
    {  FreeCSSRule(rule);
    }
@@ -4564,6 +4546,8 @@ struct Colorinfo *ExtractBackgroundColorFromRules(struct Document *doc,UBYTE *cl
    struct CSSProperty *prop;
    struct CSSStylesheet *sheet;
    BOOL matches;
+   struct CSSCandidates cand;
+   long i;
    ULONG colorrgb;
    struct Colorinfo *ci;
    
@@ -4573,58 +4557,59 @@ struct Colorinfo *ExtractBackgroundColorFromRules(struct Document *doc,UBYTE *cl
    sheet = (struct CSSStylesheet *)doc->cssstylesheet;
    
    /* Find matching CSS rules and extract background-color */
-   for(rule = (struct CSSRule *)sheet->rules.mlh_Head;
-       (struct MinNode *)rule->node.mln_Succ;
-       rule = (struct CSSRule *)rule->node.mln_Succ)
-   {  for(sel = (struct CSSSelector *)rule->selectors.mlh_Head;
-         (struct MinNode *)sel->node.mln_Succ;
-         sel = (struct CSSSelector *)sel->node.mln_Succ)
-      {  matches = TRUE;
-         
-         /* Match element name */
-         if(sel->type & CSS_SEL_ELEMENT && sel->name)
-         {  if(!tagname || Stricmp((char *)sel->name,(char *)tagname) != 0)
-            {  matches = FALSE;
-            }
-         }
-         
-         /* Match class */
-         if(matches && sel->type & CSS_SEL_CLASS && sel->class)
-         {  if(!MatchClassAttribute(class, sel->class))
-            {  matches = FALSE;
-            }
+   FindCSSCandidates(sheet,tagname,class,id,&cand);
+   for(i = 0; i < cand.count; i++)
+   {  rule = cand.entries[i]->rule;
+      sel = cand.entries[i]->sel;
+      matches = TRUE;
+      
+      /* Match element name */
+      if(sel->type & CSS_SEL_ELEMENT && sel->name)
+      {  if(!tagname || Stricmp((char *)sel->name,(char *)tagname) != 0)
+         {  matches = FALSE;
          }
-         
-         /* Match ID */
-         if(matches && sel->type & CSS_SEL_ID && sel->id)
-         {  if(!id || Stricmp((char *)sel->id,(char *)id) != 0)
-            {  matches = FALSE;
-            }
+      }
+      
+      /* Match class */
+      if(matches && sel->type & CSS_SEL_CLASS && sel->class)
+      {  if(!MatchClassAttribute(class, sel->class))
+         {  matches = FALSE;
          }
-         
-         /* Skip rules with pseudo-classes */
-         if(matches && (sel->type & CSS_SEL_PSEUDO) && sel->pseudo)
+      }
+      
+      /* Match ID */
+      if(matches && sel->type & CSS_SEL_ID && sel->id)
+      {  if(!id || Stricmp((char *)sel->id,(char *)id) != 0)
          {  matches = FALSE;
          }
-         
-         /* If selector matches, extract background-color */
-         if(matches)
-         {  for(prop = (struct CSSProperty *)rule->properties.mlh_Head;
-               (struct MinNode *)prop->node.mln_Succ;
-               prop = (struct CSSProperty *)prop->node.mln_Succ)
-            {  if(prop->name && prop->value && 
-                  Stricmp((char *)prop->name,"background-color") == 0)
-               {  colorrgb = ParseHexColor(prop->value);
-                  if(colorrgb != ~0)
-                  {  ci = Finddoccolor(doc,colorrgb);
-                     /* Return first matching background-color */
-                     if(ci) return ci;
+      }
+      
+      /* Skip rules with pseudo-classes */
+      if(matches && (sel->type & CSS_SEL_PSEUDO) && sel->pseudo)
+      {  matches = FALSE;
+      }
+      
+      /* If selector matches, extract background-color */
+      if(matches)
+      {  for(prop = (struct CSSProperty *)rule->properties.mlh_Head;
+            (struct MinNode *)prop->node.mln_Succ;
+            prop = (struct CSSProperty *)prop->node.mln_Succ)
+         {  if(prop->name && prop->value && 
+               Stricmp((char *)prop->name,"background-color") == 0)
+            {  colorrgb = ParseHexColor(prop->value);
+               if(colorrgb != ~0)
+               {  ci = Finddoccolor(doc,colorrgb);
+                  /* Return first matching background-color */
+                  if(ci)
+                  {  FreeCSSCandidates(&cand);
+                     return ci;
                   }
                }
             }
          }
       }
    }
+   FreeCSSCandidates(&cand);
    
    return ci;
 }
@@ -4678,6 +4663,8 @@ void ApplyCSSToTableCellFromRules(struct Document *doc,void *table,UBYTE *class,
    struct CSSProperty *prop;
    struct CSSStylesheet *sheet;
    BOOL matches;
+   struct CSSCandidates cand;
+   long i;
    long widthValue;
    long heightValue;
    short valign;
@@ -4700,109 +4687,107 @@ void ApplyCSSToTableCellFromRules(struct Document *doc,void *table,UBYTE *class,
    cssBgcolor = NULL;
    
    /* Find matching CSS rules and extract table-cell-specific properties */
-   for(rule = (struct CSSRule *)sheet->rules.mlh_Head;
-       (struct MinNode *)rule->node.mln_Succ;
-       rule = (struct CSSRule *)rule->node.mln_Succ)
-   {  for(sel = (struct CSSSelector *)rule->selectors.mlh_Head;
-         (struct MinNode *)sel->node.mln_Succ;
-         sel = (struct CSSSelector *)sel->node.mln_Succ)
-      {  matches = TRUE;
-         
-         /* Match element name */
-         if(sel->type & CSS_SEL_ELEMENT && sel->name)
-         {  if(!tagname || Stricmp((char *)sel->name,(char *)tagname) != 0)
-            {  matches = FALSE;
-            }
-         }
-         
-         /* Match class */
-         if(matches && sel->type & CSS_SEL_CLASS && sel->class)
-         {  if(!MatchClassAttribute(class, sel->class))
-            {  matches = FALSE;
-            }
+   FindCSSCandidates(sheet,tagname,class,id,&cand);
+   for(i = 0; i < cand.count; i++)
+   {  rule = cand.entries[i]->rule;
+      sel = cand.entries[i]->sel;
+      matches = TRUE;
+      
+      /* Match element name */
+      if(sel->type & CSS_SEL_ELEMENT && sel->name)
+      {  if(!tagname || Stricmp((char *)sel->name,(char *)tagname) != 0)
+         {  matches = FALSE;
          }
-         
-         /* Match ID */
-         if(matches && sel->type & CSS_SEL_ID && sel->id)
-         {  if(!id || Stricmp((char *)sel->id,(char *)id) != 0)
-            {  matches = FALSE;
-            }
+      }
+      
+      /* Match class */
+      if(matches && sel->type & CSS_SEL_CLASS && sel->class)
+      {  if(!MatchClassAttribute(class, sel->class))
+         {  matches = FALSE;
          }
-         
-         /* Skip rules with pseudo-classes */
-         if(matches && (sel->type & CSS_SEL_PSEUDO) && sel->pseudo)
+      }
+      
+      /* Match ID */
+      if(matches && sel->type & CSS_SEL_ID && sel->id)
+      {  if(!id || Stricmp((char *)sel->id,(char *)id) != 0)
          {  matches = FALSE;
          }
-         
-         /* If selector matches, extract table-cell-specific properties */
-         if(matches)
-         {  for(prop = (struct CSSProperty *)rule->properties.mlh_Head;
-               (struct MinNode *)prop->node.mln_Succ;
-               prop = (struct CSSProperty *)prop->node.mln_Succ)
-            {  if(prop->name && prop->value)
-               {  /* Extract width */
-                  if(Stricmp((char *)prop->name,"width") == 0)
-                  {  widthValue = ParseCSSLengthValue(prop->value,&num);
-                     if(widthValue >= 0 && num.type != NUMBER_NONE)
-                     {  if(num.type == NUMBER_PERCENT)
-                        {  wtag = AOTAB_Percentwidth;
-                        }
-                        else
-                        {  wtag = AOTAB_Pixelwidth;
-                        }
+      }
+      
+      /* Skip rules with pseudo-classes */
+      if(matches && (sel->type & CSS_SEL_PSEUDO) && sel->pseudo)
+      {  matches = FALSE;
+      }
+      
+      /* If selector matches, extract table-cell-specific properties */
+      if(matches)
+      {  for(prop = (struct CSSProperty *)rule->properties.mlh_Head;
+            (struct MinNode *)prop->node.mln_Succ;
+            prop = (struct CSSProperty *)prop->node.mln_Succ)
+         {  if(prop->name && prop->value)
+            {  /* Extract width */
+               if(Stricmp((char *)prop->name,"width") == 0)
+               {  widthValue = ParseCSSLengthValue(prop->value,&num);
+                  if(widthValue >= 0 && num.type != NUMBER_NONE)
+                  {  if(num.type == NUMBER_PERCENT)
+                     {  wtag = AOTAB_Percentwidth;
                      }
-                  }
-                  /* Extract height */
-                  else if(Stricmp((char *)prop->name,"height") == 0)
-                  {  heightValue = ParseCSSLengthValue(prop->value,&num);
-                     if(heightValue >= 0 && num.type != NUMBER_NONE)
-                     {  if(num.type == NUMBER_PERCENT)
-                        {  htag = AOTAB_Percentheight;
-                        }
-                        else
-                        {  htag = AOTAB_Pixelheight;
-                        }
+                     else
+                     {  wtag = AOTAB_Pixelwidth;
                      }
                   }
-                  /* Extract vertical-align */
-                  else if(Stricmp((char *)prop->name,"vertical-align") == 0)
-                  {  if(Stricmp((char *)prop->value,"top") == 0)
-                     {  valign = VALIGN_TOP;
-                     }
-                     else if(Stricmp((char *)prop->value,"middle") == 0)
-                     {  valign = VALIGN_MIDDLE;
-                     }
-                     else if(Stricmp((char *)prop->value,"bottom") == 0)
-                     {  valign = VALIGN_BOTTOM;
+               }
+               /* Extract height */
+               else if(Stricmp((char *)prop->name,"height") == 0)
+               {  heightValue = ParseCSSLengthValue(prop->value,&num);
+                  if(heightValue >= 0 && num.type != NUMBER_NONE)
+                  {  if(num.type == NUMBER_PERCENT)
+                     {  htag = AOTAB_Percentheight;
                      }
-                     else if(Stricmp((char *)prop->value,"baseline") == 0)
-                     {  valign = VALIGN_BASELINE;
+                     else
+                     {  htag = AOTAB_Pixelheight;
                      }
                   }
-                  /* Extract text-align for horizontal alignment */
-                  else if(Stricmp((char *)prop->name,"text-align") == 0)
-                  {  if(Stricmp((char *)prop->value,"center") == 0)
-                     {  halign = HALIGN_CENTER;
-                     }
-                     else if(Stricmp((char *)prop->value,"left") == 0)
-                     {  halign = HALIGN_LEFT;
-                     }
-                     else if(Stricmp((char *)prop->value,"right") == 0)
-                     {  halign = HALIGN_RIGHT;
-                     }
+               }
+               /* Extract vertical-align */
+               else if(Stricmp((char *)prop->name,"vertical-align") == 0)
+               {  if(Stricmp((char *)prop->value,"top") == 0)
+                  {  valign = VALIGN_TOP;
                   }
-                  /* Extract background-color for table cells */
-                  else if(Stricmp((char *)prop->name,"background-color") == 0)
-                  {  colorrgb = ParseHexColor(prop->value);
-                     if(colorrgb != ~0)
-                     {  cssBgcolor = Finddoccolor(doc,colorrgb);
-                     }
+                  else if(Stricmp((char *)prop->value,"middle") == 0)
+                  {  valign = VALIGN_MIDDLE;
+                  }
+                  else if(Stricmp((char *)prop->value,"bottom") == 0)
+                  {  valign = VALIGN_BOTTOM;
+                  }
+                  else if(Stricmp((char *)prop->value,"baseline") == 0)
+                  {  valign = VALIGN_BASELINE;
+                  }
+               }
+               /* Extract text-align for horizontal alignment */
+               else if(Stricmp((char *)prop->name,"text-align") == 0)
+               {  if(Stricmp((char *)prop->value,"center") == 0)
+                  {  halign = HALIGN_CENTER;
+                  }
+                  else if(Stricmp((char *)prop->value,"left") == 0)
+                  {  halign = HALIGN_LEFT;
+                  }
+                  else if(Stricmp((char *)prop->value,"right") == 0)
+                  {  halign = HALIGN_RIGHT;
+                  }
+               }
+               /* Extract background-color for table cells */
+               else if(Stricmp((char *)prop->name,"background-color") == 0)
+               {  colorrgb = ParseHexColor(prop->value);
+                  if(colorrgb != ~0)
+                  {  cssBgcolor = Finddoccolor(doc,colorrgb);
                   }
                }
             }
          }
       }
    }
+   FreeCSSCandidates(&cand);
    
    /* Apply extracted values to table cell */
    if(wtag != TAG_IGNORE && widthValue >= 0)
@@ -5162,6 +5147,8 @@ void ApplyCSSToTableFromRules(struct Document *doc,void *table,UBYTE *class,UBYT
    struct CSSProperty *prop;
    struct CSSStylesheet *sheet;
    BOOL matches;
+   struct CSSCandidates cand;
+   long i;
    struct Number num;
    long borderValue;
    long widthValue;
@@ -5181,90 +5168,88 @@ void ApplyCSSToTableFromRules(struct Document *doc,void *table,UBYTE *class,UBYT
    cssBgcolor = NULL;
    
    /* Find matching CSS rules and apply properties */
-   for(rule = (struct CSSRule *)sheet->rules.mlh_Head;
-       (struct MinNode *)rule->node.mln_Succ;
-       rule = (struct CSSRule *)rule->node.mln_Succ)
-   {  for(sel = (struct CSSSelector *)rule->selectors.mlh_Head;
-         (struct MinNode *)sel->node.mln_Succ;
-         sel = (struct CSSSelector *)sel->node.mln_Succ)
-      {  matches = TRUE;
-         
-         /* Match element name (should be "table") */
-         if(sel->type & CSS_SEL_ELEMENT && sel->name)
-         {  if(Stricmp((char *)sel->name,"table") != 0)
-            {  matches = FALSE;
-            }
-         }
-         
-         /* Match class */
-         if(matches && sel->type & CSS_SEL_CLASS && sel->class)
-         {  if(!MatchClassAttribute(class, sel->class))
-            {  matches = FALSE;
-            }
+   FindCSSCandidates(sheet,(UBYTE *)"table",class,id,&cand);
+   for(i = 0; i < cand.count; i++)
+   {  rule = cand.entries[i]->rule;
+      sel = cand.entries[i]->sel;
+      matches = TRUE;
+      
+      /* Match element name (should be "table") */
+      if(sel->type & CSS_SEL_ELEMENT && sel->name)
+      {  if(Stricmp((char *)sel->name,"table") != 0)
+         {  matches = FALSE;
          }
-         
-         /* Match ID */
-         if(matches && sel->type & CSS_SEL_ID && sel->id)
-         {  if(!id || Stricmp((char *)sel->id,(char *)id) != 0)
-            {  matches = FALSE;
-            }
+      }
+      
+      /* Match class */
+      if(matches && sel->type & CSS_SEL_CLASS && sel->class)
+      {  if(!MatchClassAttribute(class, sel->class))
+         {  matches = FALSE;
          }
-         
-         /* Skip rules with pseudo-classes */
-         if(matches && (sel->type & CSS_SEL_PSEUDO) && sel->pseudo)
+      }
+      
+      /* Match ID */
+      if(matches && sel->type & CSS_SEL_ID && sel->id)
+      {  if(!id || Stricmp((char *)sel->id,(char *)id) != 0)
          {  matches = FALSE;
          }
-         
-         /* If selector matches, apply properties */
-         if(matches)
-         {  for(prop = (struct CSSProperty *)rule->properties.mlh_Head;
-               (struct MinNode *)prop->node.mln_Succ;
-               prop = (struct CSSProperty *)prop->node.mln_Succ)
-            {  if(!prop->name || !prop->value) continue;
-               
-               /* Extract border */
-               if(Stricmp((char *)prop->name,"border") == 0)
-               {  borderValue = ParseCSSLengthValue(prop->value,&num);
-                  if(borderValue < 0) borderValue = 0;
-               }
-               /* Extract width */
-               else if(Stricmp((char *)prop->name,"width") == 0)
-               {  widthValue = ParseCSSLengthValue(prop->value,&num);
-                  if(widthValue > 0)
-                  {  if(num.type == NUMBER_PERCENT)
-                     {  wtag = AOTAB_Percentwidth;
-                     }
-                     else
-                     {  wtag = AOTAB_Pixelwidth;
-                     }
+      }
+      
+      /* Skip rules with pseudo-classes */
+      if(matches && (sel->type & CSS_SEL_PSEUDO) && sel->pseudo)
+      {  matches = FALSE;
+      }
+      
+      /* If selector matches, apply properties */
+      if(matches)
+      {  for(prop = (struct CSSProperty *)rule->properties.mlh_Head;
+            (struct MinNode *)prop->node.mln_Succ;
+            prop = (struct CSSProperty *)prop->node.mln_Succ)
+         {  if(!prop->name || !prop->value) continue;
+            
+            /* Extract border */
+            if(Stricmp((char *)prop->name,"border") == 0)
+            {  borderValue = ParseCSSLengthValue(prop->value,&num);
+               if(borderValue < 0) borderValue = 0;
+            }
+            /* Extract width */
+            else if(Stricmp((char *)prop->name,"width") == 0)
+            {  widthValue = ParseCSSLengthValue(prop->value,&num);
+               if(widthValue > 0)
+               {  if(num.type == NUMBER_PERCENT)
+                  {  wtag = AOTAB_Percentwidth;
                   }
-               }
-               /* Extract cellpadding via padding */
-               else if(Stricmp((char *)prop->name,"padding") == 0)
-               {  cellpaddingValue = ParseCSSLengthValue(prop->value,&num);
-                  if(cellpaddingValue < 0) cellpaddingValue = 0;
-               }
-               /* Extract background-color */
-               else if(Stricmp((char *)prop->name,"background-color") == 0)
-               {  colorrgb = ParseHexColor(prop->value);
-                  if(colorrgb != ~0)
-                  {  cssBgcolor = Finddoccolor(doc,colorrgb);
+                  else
+                  {  wtag = AOTAB_Pixelwidth;
                   }
                }
-               /* Extract border-color */
-               else if(Stricmp((char *)prop->name,"border-color") == 0)
-               {  colorrgb = ParseHexColor(prop->value);
-                  if(colorrgb != ~0)
-                  {  ci = Finddoccolor(doc,colorrgb);
-                     if(ci)
-                     {  Asetattrs(table,AOTAB_Bordercolor,ci,TAG_END);
-                     }
+            }
+            /* Extract cellpadding via padding */
+            else if(Stricmp((char *)prop->name,"padding") == 0)
+            {  cellpaddingValue = ParseCSSLengthValue(prop->value,&num);
+               if(cellpaddingValue < 0) cellpaddingValue = 0;
+            }
+            /* Extract background-color */
+            else if(Stricmp((char *)prop->name,"background-color") == 0)
+            {  colorrgb = ParseHexColor(prop->value);
+               if(colorrgb != ~0)
+               {  cssBgcolor = Finddoccolor(doc,colorrgb);
+               }
+            }
+            /* Extract border-color */
+            else if(Stricmp((char *)prop->name,"border-color") == 0)
+            {  colorrgb = ParseHexColor(prop->value);
+               if(colorrgb != ~0)
+               {  ci = Finddoccolor(doc,colorrgb);
+                  if(ci)
+                  {  Asetattrs(table,AOTAB_Bordercolor,ci,TAG_END);
                   }
                }
             }
          }
       }
    }
+   FreeCSSCandidates(&cand);
    
    /* Apply extracted values to table */
    if(borderValue >= 0)
@@ -0,0 +1,296 @@
+/**********************************************************************
+ * 
+ * This file is part of the AWeb APL distribution
+ *
+ * Copyright (C) 2026 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* cssindex.c - AWeb CSS rule index */
+
+/* This file only uses the memory functions, so it can be built and
+ * tested on any host. */
+
+#include <exec/types.h>
+#include <exec/memory.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include "cssindex.h"
+
+/* From memory.c */
+extern void *Allocmem(long size,ULONG flags);
+extern void Freemem(void *mem);
+
+#define ALLOCTYPE(t,n,f)      (t*)Allocmem((n)*sizeof(t),(f)|MEMF_PUBLIC)
+#define ALLOCSTRUCT(s,n,f)    ALLOCTYPE(struct s,n,f)
+#define FREE(p)               Freemem(p)
+
+/*-----------------------------------------------------------------------*/
+
+/* Compiled rule index. Each selector is filed once under the most
+ * selective key of its rightmost compound (id, first class, tag), or
+ * in the universal bucket when it has none. Matching then only needs
+ * to look at the buckets an element can possibly hit. */
+
+/* Case-insensitive hash of (kind,key) */
+static ULONG HashCSSKey(UWORD kind,UBYTE *key,long len)
+{  ULONG h=2166136261UL^kind;
+   long i;
+   for(i=0;i<len;i++)
+   {  h^=(ULONG)tolower(key[i]);
+      h*=16777619UL;
+   }
+   return h;
+}
+
+/* Find the bucket for (kind,key), or NULL */
+static struct CSSIndexBucket *FindCSSBucket(struct CSSStylesheet *sheet,
+   UWORD kind,UBYTE *key,long len)
+{  struct CSSIndexBucket *b;
+   ULONG h;
+   long i;
+   if(kind==CSS_IDX_UNIVERSAL) return &sheet->universal;
+   if(!sheet->index || len<=0) return NULL;
+   h=HashCSSKey(kind,key,len);
+   for(b=sheet->index[h&(sheet->indexsize-1)];b;b=b->next)
+   {  if(b->hash==h && b->kind==kind && b->keylen==len)
+      {  for(i=0;i<len;i++)
+         {  if(b->key[i]!=tolower(key[i])) break;
+         }
+         if(i==len) return b;
+      }
+   }
+   return NULL;
+}
+
+/* Double the hash table size */
+static BOOL GrowCSSIndex(struct CSSStylesheet *sheet)
+{  struct CSSIndexBucket **newindex,*b,*next;
+   long newsize,i;
+   newsize=sheet->indexsize?2*sheet->indexsize:CSS_IDX_MINHASH;
+   if(!(newindex=ALLOCTYPE(struct CSSIndexBucket *,newsize,MEMF_FAST))) return FALSE;
+   for(i=0;i<sheet->indexsize;i++)
+   {  for(b=sheet->index[i];b;b=next)
+      {  next=b->next;
+         b->next=newindex[b->hash&(newsize-1)];
+         newindex[b->hash&(newsize-1)]=b;
+      }
+   }
+   if(sheet->index) FREE(sheet->index);
+   sheet->index=newindex;
+   sheet->indexsize=newsize;
+   return TRUE;
+}
+
+/* Find or create the bucket for (kind,key), interning the key */
+static struct CSSIndexBucket *AddCSSBucket(struct CSSStylesheet *sheet,
+   UWORD kind,UBYTE *key,long len)
+{  struct CSSIndexBucket *b;
+   long i;
+   if((b=FindCSSBucket(sheet,kind,key,len))) return b;
+   if(sheet->nbuckets>=sheet->indexsize)
+   {  if(!GrowCSSIndex(sheet)) return NULL;
+   }
+   if(!(b=ALLOCSTRUCT(CSSIndexBucket,1,MEMF_FAST))) return NULL;
+   if(!(b->key=ALLOCTYPE(UBYTE,len+1,MEMF_FAST)))
+   {  FREE(b);
+      return NULL;
+   }
+   for(i=0;i<len;i++) b->key[i]=tolower(key[i]);
+   b->keylen=len;
+   b->kind=kind;
+   b->hash=HashCSSKey(kind,key,len);
+   b->next=sheet->index[b->hash&(sheet->indexsize-1)];
+   sheet->index[b->hash&(sheet->indexsize-1)]=b;
+   sheet->nbuckets++;
+   return b;
+}
+
+/* Add an entry to a bucket. Entries are always added in document order. */
+static BOOL AddCSSBucketEntry(struct CSSIndexBucket *b,struct CSSRule *rule,
+   struct CSSSelector *sel,ULONG order)
+{  struct CSSIndexEntry *newentries;
+   long newsize;
+   if(b->count>=b->size)
+   {  newsize=b->size?2*b->size:4;
+      if(!(newentries=ALLOCSTRUCT(CSSIndexEntry,newsize,MEMF_FAST))) return FALSE;
+      if(b->entries)
+      {  memmove(newentries,b->entries,b->count*sizeof(struct CSSIndexEntry));
+         FREE(b->entries);
+      }
+      b->entries=newentries;
+      b->size=newsize;
+   }
+   b->entries[b->count].rule=rule;
+   b->entries[b->count].sel=sel;
+   b->entries[b->count].order=order;
+   b->count++;
+   return TRUE;
+}
+
+/* Find the first whitespace-separated word in (p), return its length */
+static long FirstCSSWord(UBYTE *p,UBYTE **word)
+{  UBYTE *start;
+   while(*p && isspace(*p)) p++;
+   start=p;
+   while(*p && !isspace(*p)) p++;
+   *word=start;
+   return p-start;
+}
+
+/* Is (name) html or body, in any case? */
+static BOOL IsCSSRootName(UBYTE *name)
+{  UBYTE buf[5];
+   long i;
+   for(i=0;i<4 && name[i];i++) buf[i]=tolower(name[i]);
+   buf[i]='\0';
+   if(name[i]) return FALSE;
+   return (BOOL)(!strcmp((char *)buf,"html") || !strcmp((char *)buf,"body"));
+}
+
+/* Determine the index key for a selector's rightmost compound. Selectors
+ * for html and body go in the universal bucket, because they also match
+ * the root and document body that have no tag name. */
+static UWORD CSSSelectorKey(struct CSSSelector *sel,UBYTE **key,long *len)
+{  if(sel->type&CSS_SEL_ROOT) return CSS_IDX_UNIVERSAL;
+   if((sel->type&CSS_SEL_ID) && sel->id && *sel->id)
+   {  *key=sel->id;
+      *len=strlen((char *)sel->id);
+      return CSS_IDX_ID;
+   }
+   if((sel->type&CSS_SEL_CLASS) && sel->class)
+   {  if((*len=FirstCSSWord(sel->class,key))>0) return CSS_IDX_CLASS;
+   }
+   if((sel->type&CSS_SEL_ELEMENT) && sel->name && *sel->name
+   && !IsCSSRootName(sel->name))
+   {  *key=sel->name;
+      *len=strlen((char *)sel->name);
+      return CSS_IDX_TAG;
+   }
+   return CSS_IDX_UNIVERSAL;
+}
+
+/* Index all rules from (rule) to the end of the sheet */
+void IndexCSSRules(struct CSSStylesheet *sheet,struct CSSRule *rule)
+{  struct CSSSelector *sel;
+   struct CSSIndexBucket *b;
+   UBYTE *key;
+   long len;
+   UWORD kind;
+   for(;rule->node.mln_Succ;rule=(struct CSSRule *)rule->node.mln_Succ)
+   {  sheet->nrules++;
+      for(sel=(struct CSSSelector *)rule->selectors.mlh_Head;
+         sel->node.mln_Succ;
+         sel=(struct CSSSelector *)sel->node.mln_Succ)
+      {  key=NULL;
+         len=0;
+         kind=CSSSelectorKey(sel,&key,&len);
+         b=AddCSSBucket(sheet,kind,key,len);
+         /* On allocation failure fall back to the universal bucket, so
+          * the selector is still checked against every element. */
+         if(!b || !AddCSSBucketEntry(b,rule,sel,sheet->nextorder))
+         {  AddCSSBucketEntry(&sheet->universal,rule,sel,sheet->nextorder);
+         }
+         sheet->nextorder++;
+      }
+   }
+}
+
+/* Free the rule index */
+void FreeCSSIndex(struct CSSStylesheet *sheet)
+{  struct CSSIndexBucket *b,*next;
+   long i;
+   for(i=0;i<sheet->indexsize;i++)
+   {  for(b=sheet->index[i];b;b=next)
+      {  next=b->next;
+         if(b->entries) FREE(b->entries);
+         if(b->key) FREE(b->key);
+         FREE(b);
+      }
+   }
+   if(sheet->index) FREE(sheet->index);
+   if(sheet->universal.entries) FREE(sheet->universal.entries);
+   sheet->index=NULL;
+   sheet->indexsize=0;
+   sheet->nbuckets=0;
+   sheet->universal.entries=NULL;
+   sheet->universal.count=sheet->universal.size=0;
+}
+
+/* Add all entries of a bucket to the candidate set */
+static void AddCSSCandidates(struct CSSCandidates *cand,struct CSSIndexBucket *b)
+{  struct CSSIndexEntry **newentries;
+   long newsize,i;
+   if(!b || !b->count) return;
+   if(cand->count+b->count>cand->size)
+   {  newsize=2*(cand->count+b->count);
+      if(!(newentries=ALLOCTYPE(struct CSSIndexEntry *,newsize,MEMF_FAST))) return;
+      memmove(newentries,cand->entries,cand->count*sizeof(struct CSSIndexEntry *));
+      if(cand->entries!=cand->local) FREE(cand->entries);
+      cand->entries=newentries;
+      cand->size=newsize;
+   }
+   for(i=0;i<b->count;i++)
+   {  cand->entries[cand->count++]=&b->entries[i];
+   }
+}
+
+static int CompareCSSCandidates(const void *a,const void *b)
+{  ULONG oa=(*(struct CSSIndexEntry **)a)->order;
+   ULONG ob=(*(struct CSSIndexEntry **)b)->order;
+   return (oa<ob)?-1:(oa>ob)?1:0;
+}
+
+/* Collect all selectors that can possibly match an element with this
+ * tag name, class attribute and id, in document order. The caller must
+ * still match every candidate, and call FreeCSSCandidates() afterwards. */
+void FindCSSCandidates(struct CSSStylesheet *sheet,UBYTE *tagname,UBYTE *class,UBYTE *id,
+   struct CSSCandidates *cand)
+{  UBYTE *p,*word;
+   long len,nbuckets,i,j;
+   cand->entries=cand->local;
+   cand->count=0;
+   cand->size=CSS_MAXLOCALCAND;
+   if(!sheet) return;
+   nbuckets=0;
+   AddCSSCandidates(cand,&sheet->universal);
+   if(sheet->universal.count) nbuckets++;
+   if(tagname && *tagname)
+   {  AddCSSCandidates(cand,FindCSSBucket(sheet,CSS_IDX_TAG,tagname,strlen((char *)tagname)));
+      nbuckets++;
+   }
+   if(id && *id)
+   {  AddCSSCandidates(cand,FindCSSBucket(sheet,CSS_IDX_ID,id,strlen((char *)id)));
+      nbuckets++;
+   }
+   if(class)
+   {  for(p=class;(len=FirstCSSWord(p,&word))>0;p=word+len)
+      {  AddCSSCandidates(cand,FindCSSBucket(sheet,CSS_IDX_CLASS,word,len));
+         nbuckets++;
+      }
+   }
+   if(nbuckets>1 && cand->count>1)
+   {  qsort(cand->entries,cand->count,sizeof(struct CSSIndexEntry *),CompareCSSCandidates);
+      /* Drop duplicates from repeated class names */
+      for(i=1,j=1;i<cand->count;i++)
+      {  if(cand->entries[i]!=cand->entries[j-1]) cand->entries[j++]=cand->entries[i];
+      }
+      cand->count=j;
+   }
+}
+
+void FreeCSSCandidates(struct CSSCandidates *cand)
+{  if(cand->entries && cand->entries!=cand->local) FREE(cand->entries);
+   cand->entries=NULL;
+   cand->count=0;
+}
@@ -0,0 +1,139 @@
+/**********************************************************************
+ * 
+ * This file is part of the AWeb APL distribution
+ *
+ * Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* cssindex.h - AWeb CSS rules and rule index */
+
+#ifndef AWEB_CSSINDEX_H
+#define AWEB_CSSINDEX_H
+
+#include <exec/types.h>
+#include <exec/lists.h>
+#include <exec/nodes.h>
+
+/* CSS selector types */
+#define CSS_SEL_ELEMENT    0x0001
+#define CSS_SEL_CLASS      0x0002
+#define CSS_SEL_ID         0x0004
+#define CSS_SEL_PSEUDO     0x0008
+#define CSS_SEL_PSEUDOEL   0x0010  /* Pseudo-element (::before, ::after, etc.) */
+#define CSS_SEL_ATTRIBUTE  0x0020  /* Attribute selector [attr] */
+#define CSS_SEL_ROOT       0x0040  /* :root selector */
+
+/* CSS selector combinators */
+#define CSS_COMB_NONE        0
+#define CSS_COMB_DESCENDANT  1  /* space: "div p" */
+#define CSS_COMB_CHILD       2  /* >: "div > p" */
+
+/* CSS attribute selector operators */
+#define CSS_ATTR_NONE      0  /* [attr] */
+#define CSS_ATTR_EQUAL     1  /* [attr=value] */
+#define CSS_ATTR_CONTAINS  2  /* [attr*=value] */
+#define CSS_ATTR_STARTS    3  /* [attr^=value] */
+#define CSS_ATTR_ENDS      4  /* [attr$=value] */
+#define CSS_ATTR_WORD      5  /* [attr~=value] (word match) */
+
+/* CSS attribute selector structure */
+struct CSSAttribute
+{  UBYTE *name;              /* Attribute name */
+   UBYTE *value;             /* Attribute value (for =, *=, ^=, $=, ~=) */
+   UWORD operator;           /* CSS_ATTR_* operator */
+};
+
+/* CSS selector structure */
+struct CSSSelector
+{  struct MinNode node;
+   USHORT type;              /* Selector type flags */
+   UBYTE *name;              /* Element name (NULL = any) */
+   UBYTE *class;             /* Class name */
+   UBYTE *id;                /* ID name */
+   UBYTE *pseudo;            /* Pseudo-class name (e.g., "link", "visited", "hover") */
+   UBYTE *pseudoElement;     /* Pseudo-element name (e.g., "before", "after", "selection") */
+   struct CSSAttribute *attr; /* Attribute selector (NULL if none) */
+   USHORT specificity;      /* Selector specificity for cascade */
+   struct CSSSelector *parent; /* Parent selector for descendant/child selectors */
+   UWORD combinator;         /* CSS_COMB_NONE, CSS_COMB_DESCENDANT, CSS_COMB_CHILD */
+};
+
+/* CSS property structure */
+struct CSSProperty
+{  struct MinNode node;
+   UBYTE *name;              /* Property name */
+   UBYTE *value;             /* Property value */
+};
+
+/* CSS rule structure */
+struct CSSRule
+{  struct MinNode node;
+   struct MinList selectors; /* List of CSSSelector */
+   struct MinList properties; /* List of CSSProperty */
+};
+
+/* CSS rule index bucket kinds */
+#define CSS_IDX_UNIVERSAL  0  /* No usable id, class or tag */
+#define CSS_IDX_TAG        1  /* Keyed by rightmost element name */
+#define CSS_IDX_CLASS      2  /* Keyed by first rightmost class */
+#define CSS_IDX_ID         3  /* Keyed by rightmost id */
+
+#define CSS_IDX_MINHASH   64  /* Initial hash table size, power of 2 */
+#define CSS_MAXLOCALCAND  32  /* Candidates held without allocation */
+
+/* One selector of one rule in the index, in document order */
+struct CSSIndexEntry
+{  struct CSSRule *rule;
+   struct CSSSelector *sel;
+   ULONG order;              /* Document order of rule/selector */
+};
+
+/* Index bucket, keyed by kind and interned lower-cased key */
+struct CSSIndexBucket
+{  struct CSSIndexBucket *next; /* Hash chain */
+   UBYTE *key;               /* Interned lower-cased key, NULL for universal */
+   long keylen;
+   ULONG hash;
+   UWORD kind;               /* CSS_IDX_* */
+   long count;               /* Entries in use */
+   long size;                /* Entries allocated */
+   struct CSSIndexEntry *entries;
+};
+
+/* CSS stylesheet structure */
+struct CSSStylesheet
+{  struct MinList rules;     /* List of CSSRule */
+   void *pool;               /* Memory pool */
+   long nrules;              /* Number of indexed rules */
+   ULONG nextorder;          /* Document order for next indexed selector */
+   struct CSSIndexBucket **index; /* Hashed buckets by (kind,key) */
+   long indexsize;           /* Hash table size, power of 2 */
+   long nbuckets;            /* Number of keyed buckets */
+   struct CSSIndexBucket universal; /* Selectors that can't be keyed */
+};
+
+/* Candidate selectors for one element, sorted in document order */
+struct CSSCandidates
+{  struct CSSIndexEntry **entries;
+   long count;
+   long size;
+   struct CSSIndexEntry *local[CSS_MAXLOCALCAND];
+};
+
+/* Function prototypes */
+void IndexCSSRules(struct CSSStylesheet *sheet,struct CSSRule *rule);
+void FreeCSSIndex(struct CSSStylesheet *sheet);
+void FindCSSCandidates(struct CSSStylesheet *sheet,UBYTE *tagname,UBYTE *class,UBYTE *id,struct CSSCandidates *cand);
+void FreeCSSCandidates(struct CSSCandidates *cand);
+
+#endif /* AWEB_CSSINDEX_H */
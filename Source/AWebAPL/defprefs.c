@@ -193,6 +193,7 @@ struct Prefs defprefs=
       NDTRUE,                                /* auto search */
       FALSE,                                 /* continuous animation */
       FALSE,                                 /* restrict images to same host */
+      FALSE,                                 /* pipelining */
       NULL,NULL,                             /* telnet cmd,arg */
       NULL,NULL,                             /* starttcp cmd,arg */
       NULL,NULL,                             /* endtcp cmd,arg */
@@ -205,6 +206,7 @@ struct Prefs defprefs=
       EMPTYLIST(Noproxy,defprefs.network.noproxy), /* no proxy sites */
       "AWeb:Cache",                          /* cache path */
       1024,10240,                            /* memsize, disksize */
+      0,                                     /* packsize */
       100,0,                                 /* min free chip,fast */
       CAVERIFY_ONCE,                         /* verification mode */
       TRUE,                                  /* fast response */
@@ -426,6 +428,7 @@ static struct Saveformat networksave[]=
    "CANI",SVF_SHORT, 0,OFFSET(Networkprefs,contanim),
 #ifndef DEMOVERSION
    "RSTI",SVF_SHORT, 0,OFFSET(Networkprefs,restrictimages),
+   "PIPE",SVF_SHORT, 0,OFFSET(Networkprefs,pipelining),
    "TLNC",SVF_NLSTR, 0,OFFSET(Networkprefs,telnetcmd),
    "TLNA",SVF_NLSTR, 0,OFFSET(Networkprefs,telnetargs),
    "TCPC",SVF_NLSTR, 0,OFFSET(Networkprefs,starttcpcmd),
@@ -445,6 +448,7 @@ static struct Saveformat networksave[]=
    "CAPA",SVF_STRING,0,OFFSET(Networkprefs,cachepath),
    "CAME",SVF_LONG,  0,OFFSET(Networkprefs,camemsize),
    "CADI",SVF_LONG,  0,OFFSET(Networkprefs,cadisksize),
+   "CAPK",SVF_LONG,  0,OFFSET(Networkprefs,capacksize),
    "FREC",SVF_LONG,  0,OFFSET(Networkprefs,minfreechip),
    "FREF",SVF_LONG,  0,OFFSET(Networkprefs,minfreefast),
    "CAVE",SVF_SHORT, 0,OFFSET(Networkprefs,caverify),
@@ -2223,6 +2227,7 @@ BOOL Copynetworkprefs(struct Networkprefs *from,struct Networkprefs *to)
    to->autosearch=from->autosearch;
    to->contanim=from->contanim;
    to->restrictimages=from->restrictimages;
+   to->pipelining=from->pipelining;
    if(!Copyoptstring(from->mailtocmd,&to->mailtocmd)) return FALSE;
    if(!Copyoptstring(from->mailtoargs,&to->mailtoargs)) return FALSE;
    if(!Copyoptstring(from->telnetcmd,&to->telnetcmd)) return FALSE;
@@ -2242,6 +2247,7 @@ BOOL Copynetworkprefs(struct Networkprefs *from,struct Networkprefs *to)
    if(!(to->cachepath=Dupstr(from->cachepath,-1))) return FALSE;
    to->camemsize=from->camemsize;
    to->cadisksize=from->cadisksize;
+   to->capacksize=from->capacksize;
    to->minfreechip=from->minfreechip;
    to->minfreefast=from->minfreefast;
    to->caverify=from->caverify;
@@ -317,12 +317,12 @@ BOOL Installdocext(void)
 
 /* Return the source for this document extension. If NULL return, a
  * load for that file was started and the document was added to the
- * wait list.
+ * wait list. (type) is AUMLF_STYLE or AUMLF_SCRIPT.
  * If (UBYTE *)~0 return, the extension is in error. */
-UBYTE *Finddocext(struct Document *doc,void *url,BOOL reload)
+UBYTE *Finddocext(struct Document *doc,void *url,BOOL reload,ULONG type)
 {  struct Docext *dox;
    struct Docext *found_dox=NULL;
-   ULONG loadflags=AUMLF_DOCEXT;
+   ULONG loadflags=AUMLF_DOCEXT|type;
    void *durl;
    void *furl=(void *)Agetattr(url,AOURL_Finalurlptr);
    UBYTE *urlstr;
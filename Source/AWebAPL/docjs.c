@@ -284,12 +284,12 @@ static BOOL Propertytitle(struct Varhookdata *vd)
 static void Domethodwrite(struct Jcontext *jc,BOOL ln)
 {  struct Jvar *jv;
    UBYTE *s;
-   long n;
+   long n,len;
    struct Document *doc=Jointernal(Jthis(jc));
    if(doc)
    {  for(n=0;jv=Jfargument(jc,n);n++)
-      {  s=Jtostring(jc,jv);
-         if(s) Addtobuffer(&doc->jout,s,strlen(s));
+      {  s=Jtostringlen(jc,jv,&len);
+         if(s) Addtobuffer(&doc->jout,s,len);
       }
       if(ln) Addtobuffer(&doc->jout,"\n",1);
       if(doc->pflags&DPF_JRUN)
@@ -22,6 +22,7 @@
 #define AWEB_DOCPRIVATE_H
 
 #include "copydriver.h"
+#include "tokenize.h"
 
 /*--- Document source driver ---*/
 
@@ -32,6 +33,35 @@ struct Docsource
    USHORT flags;
    void *editor;
    struct Document *spare;    /* A spare document copy. */
+   void *tokentask;           /* Task that tokenizes the source ahead of the parser */
+   struct SignalSemaphore tokensema;   /* Protects buf and the tokens */
+   LIST(Tokenblock) tokens;   /* Tokens found so far, in source order */
+   LIST(Tokenattrblock) tokenattrs;
+   long tokenserial;          /* Changes when tokens are discarded */
+   long tokenmem;             /* Memory used by tokens */
+   USHORT tokenmode;          /* HTML mode the tokens were made for */
+};
+
+/* Tokens are only added by the token task, and never move. The parser may
+ * use a token as soon as it is counted in its block. */
+
+#define TOKENBLOCKSIZE     256
+#define TOKENATTRBLOCKSIZE 512
+
+/* Tokenizer lexing rules for an HTML mode */
+#define LEXMODE(m) ((m)==HTML_STRICT?LXM_STRICT:(m)==HTML_COMPATIBLE?LXM_COMPATIBLE:0)
+
+struct Tokenblock
+{  NODE(Tokenblock);
+   long count;
+   struct Token token[TOKENBLOCKSIZE];
+};
+
+struct Tokenattrblock
+{  NODE(Tokenattrblock);
+   long size;
+   long count;
+   struct Tokenattr attr[1];
 };
 
 #define DOSF_HTML       0x0001   /* text/html type, if clear then text/plain */
@@ -49,6 +79,9 @@ struct Docsource
    /* (struct Document *) Spare document. If SET to nonnull, existing spare is
     * disposed. If set to NULL, object is left intact but pointer is cleared. */
 
+#define AODOS_Tokenize     (AODOS_Dummy+2)   /* SET */
+   /* (BOOL) Sent to the token task when more source is available. */
+
 /*--- Document extension source driver ---*/
 
 struct Docext
@@ -66,6 +99,16 @@ struct Docext
 
 /*--- Document copy driver ---*/
 
+#define ATTRBLOCKSIZE   16
+
+/* Storage for the attributes of the tag being parsed. The first block is part
+ * of the document, more are allocated from the document pool when a tag has
+ * many attributes. All blocks are reused for every tag. */
+struct Attrblock
+{  NODE(Attrblock);
+   struct Tagattr attr[ATTRBLOCKSIZE];
+};
+
 struct Document
 {  struct Copydriver cdv;
    void *pool;                /* memory pool */
@@ -75,6 +118,16 @@ struct Document
 
    struct Buffer text;        /* displayable text */
    struct Buffer args;        /* tag arguments, reused */
+   LIST(Tagattr) attrs;       /* attributes of the tag being parsed, values in args */
+   LIST(Attrblock) attrblocks;   /* attribute storage */
+   struct Attrblock *attrblock;  /* block to take the next attribute from */
+   short nextattr;            /* next free attribute in attrblock */
+   struct Attrblock firstattrs;  /* first block of attribute storage */
+   struct Tokenattr *lexattrs;   /* attributes of a tag lexed by the parser */
+   long maxlexattrs;
+   struct Tokenblock *tokenblock;   /* next token to look at */
+   long tokenindex;
+   long tokenserial;          /* docsource token serial for tokenblock */
    struct Buffer jsrc;        /* Javascript source */
    struct Buffer jout;        /* Javascript output */
    struct Buffer csssrc;      /* CSS source from <style> tags */
@@ -277,6 +330,9 @@ struct Infotext
 extern BOOL Parsehtml(struct Document *doc,struct Buffer *src,BOOL eof,long *srcpos);
 extern BOOL Parseplain(struct Document *doc,struct Buffer *src,BOOL eof,long *srcpos);
 extern BOOL Parsemarkdown(struct Document *doc,struct Buffer *src,BOOL eof,long *srcpos);
+extern void Initattrs(struct Document *doc);
+extern void Resetattrs(struct Document *doc);
+extern struct Tagattr *Nextattr(struct Document *doc);
 
 /* from html.c: */
 
@@ -299,7 +355,7 @@ extern void Exitdocjs(void);
 
 /* from docext.c: */
 
-extern UBYTE *Finddocext(struct Document *doc,void *url,BOOL reload);
+extern UBYTE *Finddocext(struct Document *doc,void *url,BOOL reload,ULONG type);
 extern void Remwaitingdoc(struct Document *doc);
 
 /* from docsource.c: */
@@ -26,11 +26,146 @@
 #include "file.h"
 #include "application.h"
 #include "editor.h"
+#include "task.h"
 #include "docprivate.h"
 #include <proto/utility.h>
 
 #define DQID_RELOAD2    1  /* Queue-id: reload 2nd phase: srcupdate */
 
+#define TOKENMINSIZE    8192  /* Don't start a token task for less source */
+#define TOKENBATCH      64    /* Tokens to add before releasing the semaphore */
+
+/*------------------------------------------------------------------------*/
+
+/* HTML source is tokenized by a subtask while it is still arriving, so the
+ * parser on the main task finds most tags already split up. The parser
+ * never waits for it: a tag that has no token yet is lexed by the parser. */
+
+struct Tokenproducer
+{  struct Docsource *dos;
+   long batch;                /* Tokens added since the semaphore was obtained */
+   BOOL failed;               /* Out of memory */
+};
+
+/* Add a token. Called by the token task with the semaphore obtained. */
+static BOOL Emittoken(struct Tokenproducer *tp,struct Token *tk)
+{  struct Docsource *dos=tp->dos;
+   struct Tokenblock *tb=dos->tokens.last;
+   struct Tokenattrblock *tab=dos->tokenattrs.last;
+   struct Token *t;
+   long size;
+   if(ISEMPTY(&dos->tokens) || tb->count==TOKENBLOCKSIZE)
+   {  if(!(tb=ALLOCSTRUCT(Tokenblock,1,0)))
+      {  tp->failed=TRUE;
+         return FALSE;
+      }
+      tb->count=0;
+      ADDTAIL(&dos->tokens,tb);
+      dos->tokenmem+=sizeof(struct Tokenblock);
+   }
+   t=&tb->token[tb->count];
+   *t=*tk;
+   if(tk->nattrs)
+   {  if(ISEMPTY(&dos->tokenattrs) || tab->size-tab->count<tk->nattrs)
+      {  size=MAX(TOKENATTRBLOCKSIZE,tk->nattrs);
+         if(!(tab=(struct Tokenattrblock *)ALLOCTYPE(UBYTE,
+            sizeof(struct Tokenattrblock)+(size-1)*sizeof(struct Tokenattr),0)))
+         {  tp->failed=TRUE;
+            return FALSE;
+         }
+         tab->size=size;
+         tab->count=0;
+         ADDTAIL(&dos->tokenattrs,tab);
+         dos->tokenmem+=sizeof(struct Tokenattrblock)+(size-1)*sizeof(struct Tokenattr);
+      }
+      t->attrs=&tab->attr[tab->count];
+      memmove(t->attrs,tk->attrs,tk->nattrs*sizeof(struct Tokenattr));
+      tab->count+=tk->nattrs;
+   }
+   else t->attrs=NULL;
+   tb->count++;
+   return (BOOL)(++tp->batch<TOKENBATCH);
+}
+
+/* Token subtask */
+static void Tokentask(struct Docsource *dos)
+{  struct Tokenproducer tp={0};
+   struct Tokenizer tkz={0};
+   struct Tokenattr *attrs;
+   struct Taskmsg *msg;
+   struct TagItem *tag,*tstate;
+   BOOL done=FALSE,eof;
+   short result;
+   tp.dos=dos;
+   tkz.lexmode=LEXMODE(dos->tokenmode);
+   tkz.emit=(BOOL (*)(void *,struct Token *))Emittoken;
+   tkz.userdata=&tp;
+   tkz.maxattrs=32;
+   if(!(tkz.attrs=ALLOCTYPE(struct Tokenattr,tkz.maxattrs,0))) return;
+   Inittokenizer(&tkz);
+   while(!done)
+   {  while(!done && (msg=Gettaskmsg()))
+      {  if(msg->amsg && msg->amsg->method==AOM_SET)
+         {  tstate=((struct Amset *)msg->amsg)->tags;
+            while(tag=NextTagItem(&tstate))
+            {  if(tag->ti_Tag==AOTSK_Stop && tag->ti_Data) done=TRUE;
+            }
+         }
+         Replytaskmsg(msg);
+      }
+      if(done) break;
+      if(!Obtaintasksemaphore(&dos->tokensema)) break;
+      tp.batch=0;
+      result=Tokenize(&tkz,dos->buf.buffer,dos->buf.length);
+      eof=BOOLVAL(dos->flags&DOSF_EOF);
+      ReleaseSemaphore(&dos->tokensema);
+      if(tp.failed) break;
+      if(result==TKZ_FULL)
+      {  if(!(attrs=ALLOCTYPE(struct Tokenattr,tkz.maxattrs*2,0))) break;
+         FREE(tkz.attrs);
+         tkz.attrs=attrs;
+         tkz.maxattrs*=2;
+      }
+      else if(result==TKZ_MORE)
+      {  if(eof) break;
+         Waittask(0);
+      }
+   }
+   FREE(tkz.attrs);
+}
+
+/* Start the token task if it is worthwhile. Only while source is still
+ * arriving: with all source present the parser is as fast on its own. */
+static void Starttokens(struct Docsource *dos)
+{  if(!dos->tokentask && (dos->flags&DOSF_HTML) && !(dos->flags&DOSF_EOF)
+   && dos->buf.length>=TOKENMINSIZE && ISEMPTY(&dos->tokens))
+   {  dos->tokenmode=prefs.htmlmode;
+      if(dos->tokentask=Anewobject(AOTP_TASK,
+         AOTSK_Entry,Tokentask,
+         AOTSK_Name,"AWeb tokenizer",
+         AOTSK_Userdata,dos,
+         TAG_END))
+      {  Asetattrs(dos->tokentask,AOTSK_Start,TRUE,TAG_END);
+      }
+   }
+   else if(dos->tokentask)
+   {  Asetattrsasync(dos->tokentask,AODOS_Tokenize,TRUE,TAG_END);
+   }
+}
+
+/* Stop the token task and discard all tokens */
+static void Discardtokens(struct Docsource *dos)
+{  void *p;
+   if(dos->tokentask)
+   {  Adisposeobject(dos->tokentask);
+      dos->tokentask=NULL;
+   }
+   while(p=REMHEAD(&dos->tokens)) FREE(p);
+   while(p=REMHEAD(&dos->tokenattrs)) FREE(p);
+   dos->tokenmem=0;
+   dos->tokenserial++;
+}
+
 /*------------------------------------------------------------------------*/
 
 /*------------------------------------------------------------------------*/
@@ -106,7 +241,8 @@ static void Savesource(struct Docsource *dos,void *file)
 
 /* Re-do everything with the current source data. */
 static void Redodocsource(struct Docsource *dos)
-{  if(dos->spare)
+{  Discardtokens(dos);
+   if(dos->spare)
    {  Adisposeobject(dos->spare);
       dos->spare=NULL;
    }
@@ -199,6 +335,9 @@ static struct Docsource *Newdocsource(struct Amset *ams)
    if(dos=Allocobject(AOTP_DOCSOURCE,sizeof(struct Docsource),ams))
    {  Aaddchild(Aweb(),dos,AOREL_APP_USE_BROWSER);
       dos->flags|=DOSF_INREL|DOSF_SCRIPTJS;
+      InitSemaphore(&dos->tokensema);
+      NEWLIST(&dos->tokens);
+      NEWLIST(&dos->tokenattrs);
       Setdocsource(dos,ams);
    }
    return dos;
@@ -255,6 +394,7 @@ static long Updatedocsource(struct Docsource *dos,struct Amset *ams)
    }
    if(data)
    {  if(date) Asetattrs(dos->source,AOSRC_Lastmodified,date,TAG_END);
+      Discardtokens(dos);
       Freebuffer(&dos->buf);
       Addtobuffer(&dos->buf,data,length);
       Redodocsource(dos);
@@ -274,7 +414,9 @@ static long Srcupdatedocsource(struct Docsource *dos,struct Amsrcupdate *ams)
             Sethtmlflag(dos,(UBYTE *)tag->ti_Data);
             break;
          case AOURL_Contentlength:
+            ObtainSemaphore(&dos->tokensema);
             Expandbuffer(&dos->buf,tag->ti_Data-dos->buf.length);
+            ReleaseSemaphore(&dos->tokensema);
             break;
          case AOURL_Data:
             data=(UBYTE *)tag->ti_Data;
@@ -288,11 +430,16 @@ static long Srcupdatedocsource(struct Docsource *dos,struct Amsrcupdate *ams)
                dos->spare=NULL;
             }
             Anotifyset(dos->source,AODOC_Reload,TRUE,TAG_END);
+            Discardtokens(dos);
             Freebuffer(&dos->buf);
             dos->flags&=~DOSF_EOF;
             break;
          case AOURL_Eof:
-            if(tag->ti_Data) dos->flags|=DOSF_EOF;
+            if(tag->ti_Data)
+            {  ObtainSemaphore(&dos->tokensema);
+               dos->flags|=DOSF_EOF;
+               ReleaseSemaphore(&dos->tokensema);
+            }
             eof=TRUE;
             break;
          case AOURL_Jsopen:
@@ -308,9 +455,12 @@ static long Srcupdatedocsource(struct Docsource *dos,struct Amsrcupdate *ams)
       }
    }
    if(data)
-   {  Addtobuffer(&dos->buf,data,length);
-      Asetattrs(dos->source,AOSRC_Memory,dos->buf.size,TAG_END);
+   {  ObtainSemaphore(&dos->tokensema);
+      Addtobuffer(&dos->buf,data,length);
+      ReleaseSemaphore(&dos->tokensema);
+      Asetattrs(dos->source,AOSRC_Memory,dos->buf.size+dos->tokenmem,TAG_END);
    }
+   if(data || eof) Starttokens(dos);
    if(data || eof) Anotifyset(dos->source,AODOC_Srcupdate,TRUE,TAG_END);
    return 0;
 }
@@ -325,6 +475,7 @@ static long Addchilddocsource(struct Docsource *dos,struct Amadd *ama)
 
 static void Disposedocsource(struct Docsource *dos)
 {  if(dos->flags&DOSF_INREL) Aremchild(Aweb(),dos,AOREL_APP_USE_BROWSER);
+   Discardtokens(dos);
    Freebuffer(&dos->buf);
    Asetattrs(dos->source,AOSRC_Memory,0,TAG_END);
    if(dos->editor) Adisposeobject(dos->editor);
@@ -35,6 +35,7 @@
 #include "jslib.h"
 #include "xhrjs.h"
 #include "css.h"
+#include "htmlnames.h"
 #include <proto/exec.h>
 #include <proto/graphics.h>
 #include <proto/utility.h>
@@ -683,7 +684,7 @@ static long Setdocument(struct Document *doc,struct Amset *ams)
                                urlstr ? (char *)urlstr : "NULL", doc->cssstylesheet);
                      }
                      /* Try to get the CSS content */
-                     extcss = Finddocext(doc,url,FALSE);
+                     extcss = Finddocext(doc,url,FALSE,AUMLF_STYLE);
                      if(extcss && extcss != (UBYTE *)~0)
                      {  if(httpdebug)
                         {  printf("[STYLE] AODOC_Docextready: CSS file loaded, calling MergeCSSStylesheet\n");
@@ -924,6 +925,7 @@ static struct Document *Newdocument(struct Amset *ams)
       NEWLIST(&doc->forms);
       NEWLIST(&doc->fragments);
       NEWLIST(&doc->infotexts);
+      Initattrs(doc);
       doc->htmlmode=prefs.htmlmode;
       doc->gotbreak=2;
       /* Ensure DPF_NORLDOCEXT is cleared for new document */
@@ -1239,6 +1241,7 @@ static long Dispatch(struct Document *doc,struct Amessage *amsg)
 BOOL Installdocument(void)
 {  Initdocjs();
    Initxhrjs();
+   Inithtmlnames();
    if(!Amethod(NULL,AOM_INSTALL,AOTP_DOCUMENT,Dispatch)) return FALSE;
    return TRUE;
 }
@@ -28,6 +28,31 @@
 static struct RastPort eltrp;
 struct RastPort *mrp;
 
+/* Advance widths and ink extents of all 256 characters of a font, so that
+ * text can be measured without calling the graphics library or ttengine.
+ * Only used if the widths of a test string add up to what the font engine
+ * reports; fonts with kerning or fractional advances are measured by the
+ * engine as before. */
+struct Glyphwidths
+{  NODE(Glyphwidths);
+   void *font;                /* TextFont, or ttengine font handle */
+   UWORD ysize;               /* TextFont's size, flags, style and glyph data, */
+   UBYTE flags,fontstyle;     /* to tell a font opened at the address of a */
+   APTR chardata;             /* closed one from the old font */
+   UBYTE style;               /* Algorithmic style */
+   short spacing;             /* Extra character spacing */
+   BOOL exact;                /* Widths add up */
+   short width[256];          /* Advance width */
+   short extent[256];         /* Right edge of ink plus one */
+};
+
+#define MAXGLYPHWIDTHS     32
+
+static LIST(Glyphwidths) glyphwidths;
+static long nrglyphwidths;
+
+static UBYTE glyphprobe[]="AVATAR To Wa LT Yo ff fi ij 'quoted' -- 0123456789.,;:!?";
+
 #define Halignvalue(h,v) (((v)&0x0f)|((h)&0xf0))
 
 /*----------------------------------------------------------------------*/
@@ -345,6 +370,7 @@ static long Dispatch(struct Element *elt,struct Amessage *amsg)
          Disposeelement(elt);
          break;
       case AOM_DEINSTALL:
+         Forgetfontwidths(NULL);
          break;
       default:
          break;
@@ -355,18 +381,19 @@ static long Dispatch(struct Element *elt,struct Amessage *amsg)
 /*----------------------------------------------------------------------*/
 
 BOOL Installelement(void)
-{  InitRastPort(&eltrp);
+{  NEWLIST(&glyphwidths);
+   InitRastPort(&eltrp);
    mrp=&eltrp;
    if(!Amethod(NULL,AOM_INSTALL,AOTP_ELEMENT,Dispatch)) return FALSE;
    return TRUE;
 }
 
-long Textlengthext(struct RastPort *rp,UBYTE *text,long count,long *extent)
+/* Measure with the font engine */
+static long Enginelength(struct RastPort *rp,BOOL tt,UBYTE *text,long count,long *extent)
 {  long length=0,part;
    struct TextExtent te={0};
    if(extent) *extent=0;
-   /* Use ttengine wrapper if ttengine font is active, else use standard graphics.library function */
-   if(IsTTEngineFontActive(rp))
+   if(tt)
    {  /* For ttengine, use TextExtent directly for the whole string - ttengine handles whole strings at once */
       if(count > 0)
       {  TTEngineTextExtent(rp,text,(WORD)count,&te);
@@ -387,9 +414,104 @@ long Textlengthext(struct RastPort *rp,UBYTE *text,long count,long *extent)
    return length;
 }
 
+/* Measure using the width table */
+static long Tablelength(struct Glyphwidths *gw,UBYTE *text,long count,long *extent)
+{  long x=0,maxx=0,e;
+   while(count-->0)
+   {  e=x+gw->extent[*text];
+      if(e>maxx) maxx=e;
+      x+=gw->width[*text++];
+   }
+   if(extent) *extent=maxx;
+   return x;
+}
+
+/* Find the width table for the font and style set in this RastPort.
+ * Returns NULL if the text must be measured by the font engine. */
+static struct Glyphwidths *Findglyphwidths(struct RastPort *rp,BOOL tt)
+{  struct Glyphwidths *gw;
+   void *font;
+   struct TextFont *tf=NULL;
+   UBYTE c;
+   long length,extent,tlength,textent;
+   short i;
+   if(tt)
+   {  if(!(font=TTEngineActiveFont(rp))) return NULL;
+   }
+   else font=tf=rp->Font;
+   if(!font) return NULL;
+   for(gw=glyphwidths.first;gw->next;gw=gw->next)
+   {  if(gw->font==font && gw->style==rp->AlgoStyle && gw->spacing==rp->TxSpacing
+      && (!tf || (gw->ysize==tf->tf_YSize && gw->flags==tf->tf_Flags
+         && gw->fontstyle==tf->tf_Style && gw->chardata==tf->tf_CharData)))
+      {  if(gw!=glyphwidths.first)
+         {  REMOVE(gw);
+            ADDHEAD(&glyphwidths,gw);
+         }
+         return gw->exact?gw:NULL;
+      }
+   }
+   if(!(gw=ALLOCSTRUCT(Glyphwidths,1,0))) return NULL;
+   gw->font=font;
+   if(tf)
+   {  gw->ysize=tf->tf_YSize;
+      gw->flags=tf->tf_Flags;
+      gw->fontstyle=tf->tf_Style;
+      gw->chardata=tf->tf_CharData;
+   }
+   gw->style=rp->AlgoStyle;
+   gw->spacing=rp->TxSpacing;
+   for(i=0;i<256;i++)
+   {  c=i;
+      gw->width[i]=Enginelength(rp,tt,&c,1,&extent);
+      gw->extent[i]=extent;
+   }
+   length=Enginelength(rp,tt,glyphprobe,sizeof(glyphprobe)-1,&extent);
+   tlength=Tablelength(gw,glyphprobe,sizeof(glyphprobe)-1,&textent);
+   gw->exact=(length==tlength && extent==textent);
+   if(tt && gw->exact)
+   {  gw->exact=(TTEngineTextLength(rp,glyphprobe,sizeof(glyphprobe)-1)==length);
+   }
+   ADDHEAD(&glyphwidths,gw);
+   if(++nrglyphwidths>MAXGLYPHWIDTHS)
+   {  FREE(REMTAIL(&glyphwidths));
+      nrglyphwidths--;
+   }
+   return gw->exact?gw:NULL;
+}
+
+/* Forget the width table for this font, or all tables if NULL */
+void Forgetfontwidths(struct TextFont *font)
+{  struct Glyphwidths *gw,*next;
+   if(!glyphwidths.first) return;
+   for(gw=glyphwidths.first;gw->next;gw=next)
+   {  next=gw->next;
+      if(!font || gw->font==font)
+      {  REMOVE(gw);
+         FREE(gw);
+         nrglyphwidths--;
+      }
+   }
+}
+
+long Textlengthext(struct RastPort *rp,UBYTE *text,long count,long *extent)
+{  struct Glyphwidths *gw;
+   /* Use ttengine wrapper if ttengine font is active, else use standard graphics.library function */
+   BOOL tt=IsTTEngineFontActive(rp);
+   if(gw=Findglyphwidths(rp,tt))
+   {  return Tablelength(gw,text,count,extent);
+   }
+   return Enginelength(rp,tt,text,count,extent);
+}
+
 long Textlength(struct RastPort *rp,UBYTE *text,long count)
-{  /* Use ttengine wrapper if ttengine font is active, else use standard function */
-   if(IsTTEngineFontActive(rp))
+{  struct Glyphwidths *gw;
+   /* Use ttengine wrapper if ttengine font is active, else use standard function */
+   BOOL tt=IsTTEngineFontActive(rp);
+   if(gw=Findglyphwidths(rp,tt))
+   {  return Tablelength(gw,text,count,NULL);
+   }
+   if(tt)
    {  /* ttengine handles whole strings at once - no need for loops */
       if(count > 0)
       {  return (long)TTEngineTextLength(rp,text,count);
@@ -397,6 +519,6 @@ long Textlength(struct RastPort *rp,UBYTE *text,long count)
       return 0;
    }
    else
-   {  return Textlengthext(rp,text,count,NULL);
+   {  return Enginelength(rp,FALSE,text,count,NULL);
    }
 }
\ No newline at end of file
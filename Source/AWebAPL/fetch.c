@@ -22,6 +22,7 @@
 #include "fetch.h"
 #include "url.h"
 #include "fetchdriver.h"
+#include "capack.h"
 #include "application.h"
 #include "task.h"
 #include "window.h"
@@ -57,6 +58,11 @@ struct Fetch
    struct Library *fdbase;
    void (*driverfun)(struct Fetchdriver *);
    void *task;
+   struct Fqentry fqe;           /* Network scheduling */
+   struct Referer *ref;          /* Index entry of (referer) */
+   struct Fetch *refnext,*refprev; /* Other fetches with the same referer */
+   long packoffset,packlength;   /* Location in cache pack file */
+   ULONG packsum;
 };
 
 #define FCHF_RUNNING       0x00000001  /* Fetchdriver is running */
@@ -77,13 +83,38 @@ struct Fetch
 #define FCHF_FORMWARN      0x00008000  /* Warn if form is sent over unsecure link */
 #define FCHF_CHANNEL       0x00010000  /* This is a channel fetch */
 #define FCHF_VIEWSOURCE    0x00020000  /* view-source: URL - render as plain text */
+#define FCHF_PRIORITY      0x00040000  /* Priority class was set explicitly */
+#define FCHF_PACKED        0x00080000  /* Cache reload from pack file */
+#define FCHF_PIPELINED     0x00100000  /* Runs on the connection of another fetch */
+#define FCHF_NOPIPELINE    0x00200000  /* Don't pipeline, it was tried */
+#define FCHF_REQUEUE       0x00400000  /* Queue again when driver terminates */
 
-static LIST(Fetch) netqueue;
+/* Queueid: start queued fetches */
+#define FCQID_START        1
+
+/* Connections to one host at the same time */
+#define MAX_HOST_CONNECTIONS  4
+
+static LIST(Fetch) netqueue;        /* Order is kept in fetchqueue */
 static LIST(Fetch) localqueue;
 static LIST(Fetch) running;         /* Also fetches in authorization state */
 static LIST(Fetch) channels;
 
-static long nrlocal,nrnet;
+static struct Fetchqueue fetchqueue;
+static long nrlocal;
+
+/* Fetches are indexed by referer, so the fetches for a page can be found
+ * without scanning the fetch lists. There is one entry for every referer
+ * string; the hash is case insensitive like Cancelfetchesbyreferer(). */
+struct Referer
+{  struct Referer *hashnext;     /* Next in hash bucket */
+   ULONG hash;
+   UBYTE *url;                   /* Referer URL, shared by the fetches */
+   struct Fetch *fetches;        /* Linked through refnext */
+};
+
+#define REFHASHSIZE        64
+static struct Referer *refhash[REFHASHSIZE];
 
 static long channelid=0;
 
@@ -349,7 +380,8 @@ static BOOL Dostartdriver(struct Fetch *fch)
          else fch->netstat=Addnetstat(fch,(UBYTE *)Agetattr(fch->url,AOURL_Url),
             NWS_STARTED,BOOLVAL(fch->flags&FCHF_NETSLOT));
          if(fch->flags&FCHF_LOCALSLOT) nrlocal++;
-         else if(fch->flags&FCHF_NETSLOT) nrnet++;
+         else if((fch->flags&FCHF_NETSLOT) && !(fch->flags&FCHF_PIPELINED))
+            Fqstart(&fetchqueue,&fch->fqe);
       }
       else
       {  Adisposeobject(fch->task);
@@ -412,16 +444,144 @@ static void Addtoqueue(LIST(Fetch) *queue,struct Fetch *fch)
    }
 }
 
+static ULONG Refererhash(UBYTE *url)
+{  ULONG hash=2166136261UL;
+   for(;*url;url++)
+   {  hash^=(ULONG)tolower(*url);
+      hash*=16777619UL;
+   }
+   return hash;
+}
+
+/* Move (fch) to the index entry for this referer string, or take it out
+ * of the index if NULL. Sets fch->referer to the entry's string. */
+static void Setreferer(struct Fetch *fch,UBYTE *url)
+{  struct Referer *ref,**p;
+   ULONG hash=0;
+   if(url)
+   {  hash=Refererhash(url);
+      for(ref=refhash[hash%REFHASHSIZE];ref;ref=ref->hashnext)
+      {  if(ref->hash==hash && STREQUAL(ref->url,url)) break;
+      }
+      if(ref && ref==fch->ref) return;
+   }
+   if(ref=fch->ref)
+   {  if(fch->refprev) fch->refprev->refnext=fch->refnext;
+      else ref->fetches=fch->refnext;
+      if(fch->refnext) fch->refnext->refprev=fch->refprev;
+      fch->ref=NULL;
+      fch->refnext=fch->refprev=NULL;
+      fch->referer=NULL;
+      if(!ref->fetches)
+      {  for(p=&refhash[ref->hash%REFHASHSIZE];*p!=ref;p=&(*p)->hashnext);
+         *p=ref->hashnext;
+         FREE(ref->url);
+         FREE(ref);
+      }
+   }
+   if(!url) return;
+   for(ref=refhash[hash%REFHASHSIZE];ref;ref=ref->hashnext)
+   {  if(ref->hash==hash && STREQUAL(ref->url,url)) break;
+   }
+   if(!ref && (ref=ALLOCSTRUCT(Referer,1,MEMF_CLEAR)))
+   {  if(ref->url=Dupstr(url,-1))
+      {  ref->hash=hash;
+         ref->hashnext=refhash[hash%REFHASHSIZE];
+         refhash[hash%REFHASHSIZE]=ref;
+      }
+      else
+      {  FREE(ref);
+         ref=NULL;
+      }
+   }
+   if(ref)
+   {  fch->ref=ref;
+      fch->refnext=ref->fetches;
+      if(ref->fetches) ref->fetches->refprev=fch;
+      ref->fetches=fch;
+      fch->referer=ref->url;
+   }
+}
+
+/* Priority class following the load flags */
+static UWORD Fetchpriority(struct Fetch *fch)
+{  if(fch->flags&FCHF_IMAGE) return FQP_OFFSCREEN;
+   if(fch->loadflags&AUMLF_DOWNLOAD) return FQP_PREFETCH;
+   if(fch->loadflags&AUMLF_STYLE) return FQP_STYLE;
+   if(fch->loadflags&AUMLF_SCRIPT) return FQP_SCRIPT;
+   return FQP_DOCUMENT;
+}
+
+/* Follow the network prefs, they may have changed */
+static void Setqueuelimits(void)
+{  fetchqueue.maxrunning=prefs.maxconnect;
+   fetchqueue.maxperhost=MIN(MAX_HOST_CONNECTIONS,prefs.maxconnect);
+   fetchqueue.reserved=1;
+}
+
+#ifndef LOCALONLY
+/* Returns TRUE if this fetch is a GET request that can share a connection
+ * with other requests */
+static BOOL Canpipeline(struct Fetch *fch)
+{  return (BOOL)(fch->driverfun==Httptask && fch->fd && !fch->fd->proxy
+      && !fch->postmsg && !fch->mpd
+      && !(fch->flags&(FCHF_CHANNEL|FCHF_NOPIPELINE)));
+}
+
+/* With pipelining enabled, queued requests are sent on the connection of a
+ * running fetch for the same host instead of waiting for a free slot. They
+ * don't take up a slot themselves. The driver requeues the fetch if the
+ * connection can't take the request after all. */
+static void Startpipelined(void)
+{  struct Fqentry *fqe,*next;
+   struct Fetch *fch,*rfch;
+   long nowners,npiped;
+   short i;
+   for(i=0;i<FQP_NUMBER;i++)
+   {  for(fqe=fetchqueue.queue[i].first;fqe->next;fqe=next)
+      {  next=fqe->next;
+         fch=fqe->userdata;
+         if(!fqe->host || !Canpipeline(fch)) continue;
+         nowners=npiped=0;
+         for(rfch=running.first;rfch->next;rfch=rfch->next)
+         {  if(rfch->task && rfch->fqe.host==fqe->host && Canpipeline(rfch))
+            {  if(rfch->flags&FCHF_PIPELINED) npiped++;
+               else if(rfch->flags&FCHF_NETSLOT) nowners++;
+            }
+         }
+         if(npiped<nowners*(PIPELINE_DEPTH-1))
+         {  Fqremove(&fetchqueue,fqe);
+            REMOVE(fch);
+            ADDTAIL(&running,fch);
+            fch->flags&=~FCHF_QUEUED;
+            fch->flags|=FCHF_PIPELINED;
+            fch->fd->flags|=FDVF_PIPELINE;
+            if(!Dostartdriver(fch))
+            {  Asrcupdatetags(fch->url,fch,
+                  AOURL_Terminate,TRUE,
+                  TAG_END);
+               Adisposeobject(fch);
+            }
+         }
+      }
+   }
+}
+#endif
+
 /* Check the queues as a result of this fetch terminating */
 static void Checkqueues(struct Fetch *tfch)
 {  struct Fetch *fch;
+   struct Fqentry *fqe;
    if(tfch && (tfch->flags&FCHF_USESLOT))
-   {  if(tfch->flags&FCHF_NETSLOT) nrnet--;
+   {  if(tfch->flags&FCHF_NETSLOT) Fqremove(&fetchqueue,&tfch->fqe);
       if(tfch->flags&FCHF_LOCALSLOT) nrlocal--;
       tfch->flags&=~FCHF_USESLOT;
    }
-   while(nrnet<prefs.maxconnect && (fch=REMHEAD(&netqueue)))
-   {  ADDTAIL(&running,fch);
+   Setqueuelimits();
+   while(fqe=Fqnext(&fetchqueue))
+   {  fch=fqe->userdata;
+      REMOVE(fch);
+      ADDTAIL(&running,fch);
       fch->flags&=~FCHF_QUEUED;
       if(!Dostartdriver(fch))
       {  Asrcupdatetags(fch->url,fch,
@@ -430,6 +590,9 @@ static void Checkqueues(struct Fetch *tfch)
          Adisposeobject(fch);
       }
    }
+#ifndef LOCALONLY
+   if(prefs.pipelining) Startpipelined();
+#endif
    while(nrlocal<prefs.maxdiskread && (fch=REMHEAD(&localqueue)))
    {  ADDTAIL(&running,fch);
       fch->flags&=~FCHF_QUEUED;
@@ -501,6 +664,12 @@ static void Driverfunction(struct Fetch *fch)
    {  fch->driverfun=Localfiletask;
       fch->fd->name=fch->name;
       fch->fd->flags|=FDVF_CACHERELOAD;
+      if(fch->flags&FCHF_PACKED)
+      {  fch->fd->flags|=FDVF_CACHEPACK;
+         fch->fd->packoffset=fch->packoffset;
+         fch->fd->packlength=fch->packlength;
+         fch->fd->packsum=fch->packsum;
+      }
       fch->flags|=FCHF_LOCALSLOT;
    }
    else if(fch->flags&FCHF_CHANNEL)
@@ -767,6 +936,23 @@ static void Disposefd(struct Fetchdriver *fd)
    }
 }
 
+/* Returns TRUE if this network fetch can start now. Images are always
+ * queued until the current message is handled, because the parser may
+ * find a style sheet or script right after them. Other fetches that can't
+ * start at once get the queue checked then too, they may go over their
+ * host's limit if nothing else can use the connection. */
+static BOOL Netslotfree(struct Fetch *fch)
+{  fch->fqe.userdata=fch;
+   fch->fqe.host=Fqhostkey(fch->name);
+   if(!(fch->flags&FCHF_PRIORITY)) fch->fqe.priority=Fetchpriority(fch);
+   Setqueuelimits();
+   if(fch->fqe.priority<FQP_DELAYABLE && Fqcanstart(&fetchqueue,&fch->fqe))
+   {  return TRUE;
+   }
+   Queuesetmsg(fch,FCQID_START);
+   return FALSE;
+}
+
 /* Create the fetch driver process */
 static BOOL Startdriver(struct Fetch *fch)
 {  BOOL result=FALSE;
@@ -828,9 +1014,10 @@ static BOOL Startdriver(struct Fetch *fch)
          else fch->netstat=Addnetstat(fch,(UBYTE *)Agetattr(fch->url,AOURL_Url),NWS_QUEUED,FALSE);
          result=TRUE;
       }
-      else if((fch->flags&FCHF_NETSLOT) && nrnet>=prefs.maxconnect)
+      else if((fch->flags&FCHF_NETSLOT) && !Netslotfree(fch))
       {  REMOVE(fch);
-         Addtoqueue(&netqueue,fch);
+         ADDTAIL(&netqueue,fch);
+         Fqqueue(&fetchqueue,&fch->fqe);
          fch->flags|=FCHF_QUEUED;
          if(fch->netstat) Chgnetstat(fch->netstat,NWS_QUEUED,0,0);
          else fch->netstat=Addnetstat(fch,(UBYTE *)Agetattr(fch->url,AOURL_Url),NWS_QUEUED,TRUE);
@@ -921,7 +1108,7 @@ static BOOL Incompleterequest(struct Fetch *fch)
 /* Process output from driver */
 static long Updatefetch(struct Fetch *fch,struct Amset *ams)
 {  struct TagItem *tag,*tstate=ams->tags;
-   BOOL forward=TRUE,dispose=FALSE,retryget=FALSE,statusset=FALSE;
+   BOOL forward=TRUE,dispose=FALSE,retryget=FALSE,requeue=FALSE,statusset=FALSE;
    ULONG netstat=0;
    UBYTE buf[40];
    ULONG statustag=TAG_IGNORE;
@@ -946,8 +1133,19 @@ static long Updatefetch(struct Fetch *fch,struct Amset *ams)
                }
                break;
             case AOURL_Terminate:
-               /* Forward and dispose only if no error after redirected POST */
-               if(fch->flags&FCHF_POSTNOGOOD)
+               /* Forward and dispose only if no error after redirected POST,
+                * or if a pipelined request that got no response is cancelled */
+               if(fch->flags&FCHF_REQUEUE)
+               {  fch->flags&=~FCHF_REQUEUE;
+                  if(fch->flags&(FCHF_CANCELLED|FCHF_DISPOSED))
+                  {  dispose=TRUE;
+                  }
+                  else
+                  {  forward=FALSE;
+                     requeue=TRUE;
+                  }
+               }
+               else if(fch->flags&FCHF_POSTNOGOOD)
                {  forward=FALSE;
                   retryget=TRUE;
                }
@@ -1006,6 +1204,10 @@ static long Updatefetch(struct Fetch *fch,struct Amset *ams)
                }
                else fch->flags&=~FCHF_POSTNOGOOD;
                break;
+            case AOURL_Requeue:
+               SETFLAG(fch->flags,FCHF_REQUEUE,tag->ti_Data);
+               forward=FALSE;
+               break;
             case AOURL_Reload:
                fch->total=0;
                fch->sofar=0;
@@ -1022,7 +1224,7 @@ static long Updatefetch(struct Fetch *fch,struct Amset *ams)
       }
    }
    /* If we are already disposed, or we should retry, don't forward. */
-   if(fch->flags&(FCHF_DISPOSED|FCHF_POSTNOGOOD))
+   if(fch->flags&(FCHF_DISPOSED|FCHF_POSTNOGOOD|FCHF_REQUEUE))
    {  forward=FALSE;
    }
    /* Forward this message. Build status text */
@@ -1069,6 +1271,20 @@ static long Updatefetch(struct Fetch *fch,struct Amset *ams)
          Adisposeobject(fch);
       }
    }
+   /* Try again without pipelining */
+   if(requeue)
+   {  fch->flags&=~(FCHF_RUNNING|FCHF_PIPELINED);
+      fch->flags|=FCHF_NOPIPELINE;
+      Disposefd(fch->fd);
+      fch->fd=NULL;
+      if(!Startdriver(fch))
+      {  Asrcupdatetags(fch->url,fch,
+            AOURL_Terminate,TRUE,
+            TAG_END);
+         Checkqueues(fch);
+         Adisposeobject(fch);
+      }
+   }
    /* Dispose ourselves if our time has come */
    if(dispose)
    {  fch->flags&=~FCHF_RUNNING;
@@ -1079,7 +1295,7 @@ static long Updatefetch(struct Fetch *fch,struct Amset *ams)
 
 static long Setfetch(struct Fetch *fch,struct Amset *ams)
 {  struct TagItem *tag,*tstate=ams->tags;
-   BOOL cancel=FALSE,cancelerr=FALSE;
+   BOOL cancel=FALSE,cancelerr=FALSE,check=FALSE;
    while(tag=NextTagItem(&tstate))
    {  switch(tag->ti_Tag)
       {  case AOFCH_Url:
@@ -1103,6 +1319,15 @@ static long Setfetch(struct Fetch *fch,struct Amset *ams)
             if(tag->ti_Data) fch->flags|=FCHF_CACHE;
             else fch->flags&=~FCHF_CACHE;
             break;
+         case AOFCH_Packloc:
+            if(tag->ti_Data)
+            {  struct Caploc *loc=(struct Caploc *)tag->ti_Data;
+               fch->packoffset=loc->offset;
+               fch->packlength=loc->length;
+               fch->packsum=loc->checksum;
+               fch->flags|=FCHF_PACKED;
+            }
+            break;
          case AOFCH_Cancel:
             if(tag->ti_Data) cancel=cancelerr=TRUE;
             break;
@@ -1118,8 +1343,7 @@ static long Setfetch(struct Fetch *fch,struct Amset *ams)
             fch->mpd=(struct Multipartdata *)tag->ti_Data;
             break;
          case AOFCH_Referer:
-            if(fch->referer) FREE(fch->referer);
-            fch->referer=Dupstr((UBYTE *)tag->ti_Data,-1);
+            Setreferer(fch,(UBYTE *)tag->ti_Data);
             break;
          case AOFCH_Windowkey:
             fch->windowkey=tag->ti_Data;
@@ -1134,6 +1358,10 @@ static long Setfetch(struct Fetch *fch,struct Amset *ams)
          case AOFCH_Imagefetch:
             SETFLAG(fch->flags,FCHF_IMAGE,tag->ti_Data);
             break;
+         case AOFCH_Priority:
+            Fqsetpriority(&fetchqueue,&fch->fqe,(UWORD)tag->ti_Data);
+            fch->flags|=FCHF_PRIORITY;
+            break;
          case AOFCH_Commands:
             SETFLAG(fch->flags,FCHF_COMMANDS,tag->ti_Data);
             break;
@@ -1146,6 +1374,9 @@ static long Setfetch(struct Fetch *fch,struct Amset *ams)
          case AOFCH_Channel:
             SETFLAG(fch->flags,FCHF_CHANNEL,tag->ti_Data);
             break;
+         case AOBJ_Queueid:
+            if(tag->ti_Data==FCQID_START) check=TRUE;
+            break;
       }
    }
    if(cancel)
@@ -1169,6 +1400,9 @@ static long Setfetch(struct Fetch *fch,struct Amset *ams)
          Adisposeobject(fch);
       }
    }
+   if(check)
+   {  Checkqueues(NULL);
+   }
    return 0;
 }
 
@@ -1185,13 +1419,15 @@ static void Disposefetch(struct Fetch *fch)
    }
    else
    {  REMOVE(fch);
+      Fqremove(&fetchqueue,&fch->fqe);
+      Queuesetmsg(fch,0);
       if(fch->netstat) Chgnetstat(fch->netstat,NWS_END,0,0);
       if(fch->fd) Disposefd(fch->fd);
       if(fch->fdbase) CloseLibrary(fch->fdbase);
       if(fch->name) FREE(fch->name);
       if(fch->postmsg) FREE(fch->postmsg);
       if(fch->mpd) Freemultipartdata(fch->mpd);
-      if(fch->referer) FREE(fch->referer);
+      Setreferer(fch,NULL);
       if(fch->etag) FREE(fch->etag);
       Amethodas(AOTP_OBJECT,fch,AOM_DISPOSE);
       Checkwaitrequests();
@@ -1233,6 +1469,9 @@ static long Getfetch(struct Fetch *fch,struct Amset *ams)
          case AOFCH_Loadflags:
             PUTATTR(tag,fch->loadflags);
             break;
+         case AOFCH_Priority:
+            PUTATTR(tag,fch->fqe.priority);
+            break;
          case AOFCH_Channelid:
             PUTATTR(tag,fch->channelid);
             break;
@@ -1272,31 +1511,19 @@ static long Dispatch(struct Fetch *fch,struct Amessage *amsg)
 
 /* Cancel all fetches that have the specified referer URL string */
 void Cancelfetchesbyreferer(UBYTE *refererurl)
-{  struct Fetch *fch,*next;
+{  struct Referer *ref,*nextref;
+   struct Fetch *fch,*next;
+   ULONG hash;
    if(!refererurl) return;
-   /* Check all fetch lists: running, netqueue, localqueue, channels */
-   for(fch=running.first;fch->next;fch=next)
-   {  next=fch->next;
-      if(fch->referer && STRIEQUAL(fch->referer,refererurl))
-      {  Asetattrs(fch,AOFCH_Cancel,TRUE,TAG_END);
-      }
-   }
-   for(fch=netqueue.first;fch->next;fch=next)
-   {  next=fch->next;
-      if(fch->referer && STRIEQUAL(fch->referer,refererurl))
-      {  Asetattrs(fch,AOFCH_Cancel,TRUE,TAG_END);
-      }
-   }
-   for(fch=localqueue.first;fch->next;fch=next)
-   {  next=fch->next;
-      if(fch->referer && STRIEQUAL(fch->referer,refererurl))
-      {  Asetattrs(fch,AOFCH_Cancel,TRUE,TAG_END);
-      }
-   }
-   for(fch=channels.first;fch->next;fch=next)
-   {  next=fch->next;
-      if(fch->referer && STRIEQUAL(fch->referer,refererurl))
-      {  Asetattrs(fch,AOFCH_Cancel,TRUE,TAG_END);
+   hash=Refererhash(refererurl);
+   /* Cancelling may dispose the fetch, and with the last one its entry */
+   for(ref=refhash[hash%REFHASHSIZE];ref;ref=nextref)
+   {  nextref=ref->hashnext;
+      if(ref->hash==hash && STRIEQUAL(ref->url,refererurl))
+      {  for(fch=ref->fetches;fch;fch=next)
+         {  next=fch->refnext;
+            Asetattrs(fch,AOFCH_Cancel,TRUE,TAG_END);
+         }
       }
    }
 }
@@ -1334,6 +1561,7 @@ void Cancelwindowfetches(ULONG windowkey)
 
 BOOL Installfetch(void)
 {  NEWLIST(&netqueue);
+   Initfetchqueue(&fetchqueue);
    NEWLIST(&localqueue);
    NEWLIST(&running);
    NEWLIST(&channels);
@@ -22,6 +22,7 @@
 #define AWEB_FETCH_H
 
 #include "object.h"
+#include "fetchq.h"
 
 /*--- fetch tags ---*/
 
@@ -91,7 +92,14 @@
 #define AOFCH_Etag      (AOFCH_Dummy+21)   /* NEW,SET,GET */
    /* (UBYTE *) ETag value for If-None-Match header */
 
-#define AOFCH_    (AOFCH_Dummy+)
+#define AOFCH_Priority     (AOFCH_Dummy+22)  /* NEW,SET,GET */
+   /* (UWORD) FQP_xxx priority class of a network fetch. Defaults to a class
+    * following the load flags. A queued fetch moves to its new class. */
+
+#define AOFCH_Packloc      (AOFCH_Dummy+23)  /* NEW */
+   /* (struct Caploc *) For a cache reload, location of the object in the
+    * pack file given as AOFCH_Name. */
+
 #define AOFCH_    (AOFCH_Dummy+)
 
 /*--- fetch functions ---*/
@@ -45,6 +45,9 @@ struct Fetchdriver
    /* Temporary storage fields */
    ULONG serverdate;          /* Date as reported by server */
    UBYTE *etag;               /* ETag value from HTTP response for caching */
+   long packoffset;           /* Cache reload from pack file (name): */
+   long packlength;           /*  record offset, object length */
+   ULONG packsum;             /*  and checksum */
 };
 
 #define FDVF_NOCACHE       0x0001   /* Don't use any cache */
@@ -54,6 +57,12 @@ struct Fetchdriver
 #define FDVF_SSL           0x0010   /* Use secure transfer if possible */
 #define FDVF_FORMWARN      0x0020   /* Warn if form is sent over unsecure link */
 #define FDVF_STREAMING     0x0040   /* Enable HTTP streaming for this request */
+#define FDVF_CACHEPACK     0x0080   /* Cache reload from pack file */
+#define FDVF_PIPELINE      0x0100   /* Send request on the connection of a running fetch */
+
+/* Requests that may be outstanding on one connection with FDVF_PIPELINE,
+ * including the one whose response is being read */
+#define PIPELINE_DEPTH     4
 
 #endif
 
@@ -0,0 +1,175 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb APL distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* fetchq.c - AWeb network fetch scheduler */
+
+/* This file has no system dependencies, so it can be built and tested
+ * on any host. The lists are linked here instead of with exec for that
+ * reason; they have the same layout as exec lists. */
+
+#include <exec/types.h>
+#include <ctype.h>
+#include "fetchq.h"
+
+typedef LIST(Fqentry) Fqlist;
+
+/*-----------------------------------------------------------------------*/
+
+static void Newlist(Fqlist *list)
+{  list->first=(struct Fqentry *)&list->tail;
+   list->tail=NULL;
+   list->last=(struct Fqentry *)list;
+}
+
+static void Addtail(Fqlist *list,struct Fqentry *fqe)
+{  struct Fqentry *tailnode=(struct Fqentry *)&list->tail;
+   fqe->next=tailnode;
+   fqe->prev=list->last;
+   list->last->next=fqe;
+   list->last=fqe;
+}
+
+static void Remove(struct Fqentry *fqe)
+{  fqe->prev->next=fqe->next;
+   fqe->next->prev=fqe->prev;
+   fqe->next=fqe->prev=NULL;
+}
+
+/* Number of running entries for this host */
+static long Hostrunning(struct Fetchqueue *fq,ULONG host)
+{  struct Fqentry *fqe;
+   long n=0;
+   for(fqe=fq->running.first;fqe->next;fqe=fqe->next)
+   {  if(fqe->host==host) n++;
+   }
+   return n;
+}
+
+/* Returns TRUE if a document is loading. Its parser may find more fetches
+ * of urgent classes. */
+static BOOL Urgentrunning(struct Fetchqueue *fq)
+{  struct Fqentry *fqe;
+   for(fqe=fq->running.first;fqe->next;fqe=fqe->next)
+   {  if(fqe->priority==FQP_DOCUMENT) return TRUE;
+   }
+   return FALSE;
+}
+
+/* Returns TRUE if (fqe) can start. The host limit is only checked
+ * if (hostlimit) is set. */
+static BOOL Canstart(struct Fetchqueue *fq,struct Fqentry *fqe,BOOL hostlimit)
+{  long max=fq->maxrunning;
+   if(fqe->priority>=FQP_DELAYABLE && fq->reserved && Urgentrunning(fq))
+   {  max-=fq->reserved;
+      if(max<1) max=1;
+   }
+   if(fq->nrunning>=max) return FALSE;
+   if(hostlimit && fq->maxperhost && fqe->host
+   && Hostrunning(fq,fqe->host)>=fq->maxperhost)
+   {  return FALSE;
+   }
+   return TRUE;
+}
+
+/*-----------------------------------------------------------------------*/
+
+void Initfetchqueue(struct Fetchqueue *fq)
+{  short i;
+   for(i=0;i<FQP_NUMBER;i++) Newlist((Fqlist *)&fq->queue[i]);
+   Newlist((Fqlist *)&fq->running);
+   fq->nrunning=0;
+   fq->maxrunning=1;
+   fq->maxperhost=0;
+   fq->reserved=0;
+}
+
+/* Hash the part between "scheme://" and the path, without user info.
+ * Host names are case insensitive. */
+ULONG Fqhostkey(UBYTE *url)
+{  UBYTE *p,*q;
+   ULONG key=5381;
+   if(!url) return 0;
+   for(p=url;*p && *p!=':' && *p!='/';p++);
+   if(p[0]!=':' || p[1]!='/' || p[2]!='/') return 0;
+   p+=3;
+   for(q=p;*q && *q!='/' && *q!='?' && *q!='#';q++)
+   {  if(*q=='@') p=q+1;
+   }
+   if(q==p) return 0;
+   for(;p<q;p++) key=key*33+tolower(*p);
+   return key?key:1;
+}
+
+BOOL Fqcanstart(struct Fetchqueue *fq,struct Fqentry *fqe)
+{  return Canstart(fq,fqe,TRUE);
+}
+
+void Fqqueue(struct Fetchqueue *fq,struct Fqentry *fqe)
+{  if(fqe->priority>=FQP_NUMBER) fqe->priority=FQP_NUMBER-1;
+   Addtail((Fqlist *)&fq->queue[fqe->priority],fqe);
+   fqe->flags|=FQEF_QUEUED;
+}
+
+void Fqstart(struct Fetchqueue *fq,struct Fqentry *fqe)
+{  Addtail((Fqlist *)&fq->running,fqe);
+   fqe->flags|=FQEF_RUNNING;
+   fq->nrunning++;
+}
+
+void Fqremove(struct Fetchqueue *fq,struct Fqentry *fqe)
+{  if(fqe->flags&FQEF_RUNNING) fq->nrunning--;
+   if(fqe->flags&(FQEF_QUEUED|FQEF_RUNNING)) Remove(fqe);
+   fqe->flags&=~(FQEF_QUEUED|FQEF_RUNNING);
+}
+
+void Fqsetpriority(struct Fetchqueue *fq,struct Fqentry *fqe,UWORD priority)
+{  if(priority>=FQP_NUMBER) priority=FQP_NUMBER-1;
+   if(priority==fqe->priority) return;
+   fqe->priority=priority;
+   if(fqe->flags&FQEF_QUEUED)
+   {  Remove(fqe);
+      Addtail((Fqlist *)&fq->queue[priority],fqe);
+   }
+}
+
+/* Entries that can't start because their host is busy are passed over,
+ * so one slow host doesn't hold up the others. If nothing else can start,
+ * the first of them goes over its host limit rather than leaving the
+ * connection unused. */
+struct Fqentry *Fqnext(struct Fetchqueue *fq)
+{  struct Fqentry *fqe;
+   short pass,i;
+   if(fq->nrunning>=fq->maxrunning) return NULL;
+   for(pass=0;pass<2;pass++)
+   {  for(i=0;i<FQP_NUMBER;i++)
+      {  for(fqe=fq->queue[i].first;fqe->next;fqe=fqe->next)
+         {  if(Canstart(fq,fqe,(BOOL)(pass==0)))
+            {  Remove(fqe);
+               fqe->flags&=~FQEF_QUEUED;
+               return fqe;
+            }
+            /* The rest of this class and the later classes are delayable
+             * too, so they can't start either. */
+            if(i>=FQP_DELAYABLE && fq->nrunning>=fq->maxrunning-fq->reserved
+            && Urgentrunning(fq)) break;
+         }
+         if(fqe->next) break;
+      }
+   }
+   return NULL;
+}
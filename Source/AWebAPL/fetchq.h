@@ -0,0 +1,97 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb APL distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* fetchq.h - AWeb network fetch scheduler */
+
+#ifndef AWEB_FETCHQ_H
+#define AWEB_FETCHQ_H
+
+#include <exec/types.h>
+#include "ezlists.h"
+
+/* The fetch queue decides which waiting network fetch gets the next free
+ * connection. Every fetch has a priority class; within a class fetches are
+ * started in the order they were queued. A fetch is only started when the
+ * total number of running fetches is below its limit. The number running
+ * to one host is limited too, but a host may go over that limit when no
+ * fetch for another host can use the connection. While a document is
+ * loading, the last free connection is kept for the style sheets and
+ * scripts its parser may find, so a page can be laid out without waiting
+ * for images that happen to be ahead. Entries are linked in and out in
+ * constant time. */
+
+/* Priority classes, most urgent first */
+#define FQP_DOCUMENT    0     /* Documents and frames */
+#define FQP_STYLE       1     /* Style sheets */
+#define FQP_SCRIPT      2     /* Scripts */
+#define FQP_IMAGE       3     /* Images that are visible */
+#define FQP_OFFSCREEN   4     /* Images that are not (yet) visible */
+#define FQP_PREFETCH    5     /* Not needed for display: downloads */
+#define FQP_NUMBER      6
+
+/* Classes from here on never take the last free connection while a
+ * document is loading */
+#define FQP_DELAYABLE   FQP_IMAGE
+
+struct Fqentry
+{  NODE(Fqentry);
+   void *userdata;
+   ULONG host;             /* Fqhostkey() of the URL */
+   UWORD priority;         /* FQP_xxx */
+   UWORD flags;            /* See below */
+};
+
+#define FQEF_QUEUED     0x0001   /* Waiting in a queue */
+#define FQEF_RUNNING    0x0002   /* Counts as running */
+
+struct Fetchqueue
+{  LIST(Fqentry) queue[FQP_NUMBER];
+   LIST(Fqentry) running;
+   long nrunning;
+   long maxrunning;        /* Limit for all hosts together */
+   long maxperhost;        /* Limit for one host, or 0 for none */
+   long reserved;          /* Connections kept free for urgent classes */
+};
+
+extern void Initfetchqueue(struct Fetchqueue *fq);
+
+/* Hash of the host and port of an URL. Returns 0 if the URL has no host,
+ * such a fetch is only limited by (maxrunning). */
+extern ULONG Fqhostkey(UBYTE *url);
+
+/* Returns TRUE if (fqe) can start now within all limits. */
+extern BOOL Fqcanstart(struct Fetchqueue *fq,struct Fqentry *fqe);
+
+/* Add (fqe) to the end of the queue of its class. */
+extern void Fqqueue(struct Fetchqueue *fq,struct Fqentry *fqe);
+
+/* Count (fqe) as running. */
+extern void Fqstart(struct Fetchqueue *fq,struct Fqentry *fqe);
+
+/* Remove (fqe) from its queue, or stop counting it as running. */
+extern void Fqremove(struct Fetchqueue *fq,struct Fqentry *fqe);
+
+/* Change the class of (fqe). A queued entry moves to the end of the
+ * queue of its new class. */
+extern void Fqsetpriority(struct Fetchqueue *fq,struct Fqentry *fqe,UWORD priority);
+
+/* Remove the entry that must be started next from its queue, or return
+ * NULL if none can start. The caller must Fqstart() it. */
+extern struct Fqentry *Fqnext(struct Fetchqueue *fq);
+
+#endif
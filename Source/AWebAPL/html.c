@@ -333,6 +333,8 @@ static BOOL IsDivInline(struct Document *doc,UBYTE *class,UBYTE *id,UBYTE *style
    UBYTE *classPtr;
    UBYTE *p;
    BOOL matches;
+   struct CSSCandidates cand;
+   long i;
    
    /* First check inline style - look for "display" followed by "inline" or "float: left" */
    if(styleAttr)
@@ -379,120 +381,118 @@ static BOOL IsDivInline(struct Document *doc,UBYTE *class,UBYTE *id,UBYTE *style
    
    sheet = (struct CSSStylesheet *)doc->cssstylesheet;
    
-   /* Optimize: Only check rules that could possibly match */
-   /* Skip early if DIV has no class/ID and selector requires one */
-   
-   for(rule = (struct CSSRule *)sheet->rules.mlh_Head;
-       (struct MinNode *)rule->node.mln_Succ;
-       rule = (struct CSSRule *)rule->node.mln_Succ)
-   {  for(sel = (struct CSSSelector *)rule->selectors.mlh_Head;
-         (struct MinNode *)sel->node.mln_Succ;
-         sel = (struct CSSSelector *)sel->node.mln_Succ)
-      {  /* Early skip: if selector requires class but DIV has no class, skip */
-         if((sel->type & CSS_SEL_CLASS) && sel->class && !class)
-         {  continue; /* Skip this selector */
-         }
-         
-         /* Early skip: if selector requires ID but DIV has no ID, skip */
-         if((sel->type & CSS_SEL_ID) && sel->id && !id)
-         {  continue; /* Skip this selector */
+   /* Only check rules filed under div, the DIV's classes or id */
+   FindCSSCandidates(sheet,(UBYTE *)"div",class,id,&cand);
+   for(i = 0; i < cand.count; i++)
+   {  rule = cand.entries[i]->rule;
+      sel = cand.entries[i]->sel;
+      /* Early skip: if selector requires class but DIV has no class, skip */
+      if((sel->type & CSS_SEL_CLASS) && sel->class && !class)
+      {  continue; /* Skip this selector */
+      }
+      
+      /* Early skip: if selector requires ID but DIV has no ID, skip */
+      if((sel->type & CSS_SEL_ID) && sel->id && !id)
+      {  continue; /* Skip this selector */
+      }
+      
+      matches = TRUE;
+      
+      /* Match element name - must be "div" or match any element (or no element specified) */
+      if(sel->type & CSS_SEL_ELEMENT && sel->name)
+      {  if(Stricmp((char *)sel->name,"div") != 0)
+         {  matches = FALSE;
          }
-         
-         matches = TRUE;
-         
-         /* Match element name - must be "div" or match any element (or no element specified) */
-         if(sel->type & CSS_SEL_ELEMENT && sel->name)
-         {  if(Stricmp((char *)sel->name,"div") != 0)
-            {  matches = FALSE;
-            }
+      }
+      /* If no element name specified, it matches any element (including div) */
+      
+      /* Match class - use proper word-boundary matching */
+      if(matches && sel->type & CSS_SEL_CLASS && sel->class)
+      {  if(!class)
+         {  matches = FALSE;
          }
-         /* If no element name specified, it matches any element (including div) */
-         
-         /* Match class - use proper word-boundary matching */
-         if(matches && sel->type & CSS_SEL_CLASS && sel->class)
-         {  if(!class)
-            {  matches = FALSE;
-            }
-            else
-            {  UBYTE *p;
-               UBYTE *start;
-               size_t selectorLen;
-               size_t wordLen;
-               BOOL classMatch = FALSE;
-               
-               selectorLen = strlen((char *)sel->class);
-               p = class;
+         else
+         {  UBYTE *p;
+            UBYTE *start;
+            size_t selectorLen;
+            size_t wordLen;
+            BOOL classMatch = FALSE;
+            
+            selectorLen = strlen((char *)sel->class);
+            p = class;
+            
+            /* Skip leading whitespace */
+            while(*p && isspace(*p)) p++;
+            
+            /* Check each word in class attribute */
+            while(*p && !classMatch)
+            {  start = p;
                
-               /* Skip leading whitespace */
-               while(*p && isspace(*p)) p++;
+               /* Find end of current word */
+               while(*p && !isspace(*p)) p++;
+               wordLen = p - start;
                
-               /* Check each word in class attribute */
-               while(*p && !classMatch)
-               {  start = p;
-                  
-                  /* Find end of current word */
-                  while(*p && !isspace(*p)) p++;
-                  wordLen = p - start;
-                  
-                  /* Check if this word matches selector class (case-insensitive) */
-                  if(wordLen == selectorLen)
-                  {  if(Strnicmp((char *)start, (char *)sel->class, selectorLen) == 0)
-                     {  classMatch = TRUE;
-                     }
+               /* Check if this word matches selector class (case-insensitive) */
+               if(wordLen == selectorLen)
+               {  if(Strnicmp((char *)start, (char *)sel->class, selectorLen) == 0)
+                  {  classMatch = TRUE;
                   }
-                  
-                  /* Skip whitespace to next word */
-                  while(*p && isspace(*p)) p++;
                }
                
-               if(!classMatch)
-               {  matches = FALSE;
-               }
+               /* Skip whitespace to next word */
+               while(*p && isspace(*p)) p++;
             }
-         }
-         
-         /* Match ID */
-         if(matches && sel->type & CSS_SEL_ID && sel->id)
-         {  if(!id || Stricmp((char *)sel->id,(char *)id) != 0)
+            
+            if(!classMatch)
             {  matches = FALSE;
             }
          }
-         
-         /* If selector matches, check for display: inline or float: left */
-         if(matches)
-         {  /* debug_printf("IsDivInline: Selector matched! class=%s id=%s, checking for display:inline or float:left\n",
-                        class ? (char *)class : "NULL",
-                        id ? (char *)id : "NULL"); */
-            for(prop = (struct CSSProperty *)rule->properties.mlh_Head;
-               (struct MinNode *)prop->node.mln_Succ;
-               prop = (struct CSSProperty *)prop->node.mln_Succ)
-            {  if(prop->name && prop->value)
-               {  if(Stricmp((char *)prop->name,"display") == 0)
-                  {  if(Stricmp((char *)prop->value,"inline") == 0 ||
-                        Stricmp((char *)prop->value,"inline-block") == 0)
-                     {  /* debug_printf("IsDivInline: Found display:inline or inline-block! class=%s id=%s, Returning TRUE\n",
-                                  class ? (char *)class : "NULL",
-                                  id ? (char *)id : "NULL"); */
-                        return TRUE;
-                     }
+      }
+      
+      /* Match ID */
+      if(matches && sel->type & CSS_SEL_ID && sel->id)
+      {  if(!id || Stricmp((char *)sel->id,(char *)id) != 0)
+         {  matches = FALSE;
+         }
+      }
+      
+      /* If selector matches, check for display: inline or float: left */
+      if(matches)
+      {  /* debug_printf("IsDivInline: Selector matched! class=%s id=%s, checking for display:inline or float:left\n",
+                     class ? (char *)class : "NULL",
+                     id ? (char *)id : "NULL"); */
+         for(prop = (struct CSSProperty *)rule->properties.mlh_Head;
+            (struct MinNode *)prop->node.mln_Succ;
+            prop = (struct CSSProperty *)prop->node.mln_Succ)
+         {  if(prop->name && prop->value)
+            {  if(Stricmp((char *)prop->name,"display") == 0)
+               {  if(Stricmp((char *)prop->value,"inline") == 0 ||
+                     Stricmp((char *)prop->value,"inline-block") == 0)
+                  {  /* debug_printf("IsDivInline: Found display:inline or inline-block! class=%s id=%s, Returning TRUE\n",
+                               class ? (char *)class : "NULL",
+                               id ? (char *)id : "NULL"); */
+                     FreeCSSCandidates(&cand);
+                     return TRUE;
                   }
-                  else if(Stricmp((char *)prop->name,"float") == 0)
-                  {  UBYTE *floatValue;
-                     floatValue = prop->value;
-                     /* Skip whitespace */
-                     while(*floatValue && isspace(*floatValue)) floatValue++;
-                     if(Stricmp((char *)floatValue,"left") == 0)
-                     {  /* debug_printf("IsDivInline: Found float:left! class=%s id=%s, Returning TRUE\n",
-                                  class ? (char *)class : "NULL",
-                                  id ? (char *)id : "NULL"); */
-                        return TRUE;
-                     }
+               }
+               else if(Stricmp((char *)prop->name,"float") == 0)
+               {  UBYTE *floatValue;
+                  floatValue = prop->value;
+                  /* Skip whitespace */
+                  while(*floatValue && isspace(*floatValue)) floatValue++;
+                  if(Stricmp((char *)floatValue,"left") == 0)
+                  {  /* debug_printf("IsDivInline: Found float:left! class=%s id=%s, Returning TRUE\n",
+                               class ? (char *)class : "NULL",
+                               id ? (char *)id : "NULL"); */
+                     FreeCSSCandidates(&cand);
+                     return TRUE;
                   }
                }
             }
          }
       }
    }
+   FreeCSSCandidates(&cand);
    
    return FALSE;
 }
@@ -518,6 +518,8 @@ void ApplyCSSToBody(struct Document *doc,void *body,UBYTE *class,UBYTE *id,UBYTE
    extern BOOL httpdebug;
    long ruleCount;
    long selectorCount;
+   struct CSSCandidates cand;
+   long i;
    
    if(!doc || !body || !doc->cssstylesheet)
    {  if(httpdebug)
@@ -553,301 +555,316 @@ void ApplyCSSToBody(struct Document *doc,void *body,UBYTE *class,UBYTE *id,UBYTE
    sheet = (struct CSSStylesheet *)doc->cssstylesheet;
    
    /* First pass: Find matching CSS rules and determine position type */
-   ruleCount = 0;
+   ruleCount = sheet->nrules;
    selectorCount = 0;
-   for(rule = (struct CSSRule *)sheet->rules.mlh_Head;
-       (struct MinNode *)rule->node.mln_Succ;
-       rule = (struct CSSRule *)rule->node.mln_Succ)
-   {  ruleCount++;
-   }
    if(httpdebug && tagname && Stricmp((char *)tagname,"PRE") == 0)
    {  printf("[CSS] ApplyCSSToBody: Checking %ld rule(s) against PRE element\n", ruleCount);
    }
-   for(rule = (struct CSSRule *)sheet->rules.mlh_Head;
-       (struct MinNode *)rule->node.mln_Succ;
-       rule = (struct CSSRule *)rule->node.mln_Succ)
-   {  for(sel = (struct CSSSelector *)rule->selectors.mlh_Head;
-         (struct MinNode *)sel->node.mln_Succ;
-         sel = (struct CSSSelector *)sel->node.mln_Succ)
-      {  matches = TRUE;
-         if(httpdebug && tagname && Stricmp((char *)tagname,"PRE") == 0)
-         {  printf("[CSS] ApplyCSSToBody: Checking selector - element=%s, class=%s, id=%s against PRE\n",
-                  sel->name ? (char *)sel->name : "any",
-                  sel->class ? (char *)sel->class : "none",
-                  sel->id ? (char *)sel->id : "none");
-         }
-         
-         /* debug_printf("CSS: Checking selector: type=0x%lx name=%s class=%s id=%s against element tagname=%s class=%s id=%s\n",
-                     (ULONG)sel->type,
-                     (sel->name ? (char *)sel->name : "NULL"),
-                     (sel->class ? (char *)sel->class : "NULL"),
-                     (sel->id ? (char *)sel->id : "NULL"),
-                     (tagname ? (char *)tagname : "NULL"),
-                     (class ? (char *)class : "NULL"),
-                     (id ? (char *)id : "NULL")); */
-         
-         /* Match element name */
-         if(sel->type & CSS_SEL_ELEMENT && sel->name)
-         {  /* For body selector, tagname can be "BODY" or NULL (for document body) */
-            if(Stricmp((char *)sel->name,"body") == 0)
-            {  if(tagname && Stricmp((char *)tagname,"BODY") != 0)
-               {  /* debug_printf("CSS: Element name mismatch: selector wants 'body' but element is '%s'\n", tagname); */
-                  matches = FALSE;
-               }
-            }
-            else if(Stricmp((char *)sel->name, "html") == 0)
-            {  /* html selector matches html element OR root element (no tagname) */
-               if(tagname && Stricmp((char *)tagname, "html") != 0)
-               {  /* Has tagname but it's not "html" - doesn't match */
-                  matches = FALSE;
-               }
-               /* If no tagname, this is the root element - html selector matches */
-            }
-            else if(!tagname || Stricmp((char *)sel->name,(char *)tagname) != 0)
-            {  /* debug_printf("CSS: Element name mismatch: selector wants '%s' but element is '%s'\n",
-                           sel->name, tagname ? (char *)tagname : "NULL"); */
+   FindCSSCandidates(sheet,tagname,class,id,&cand);
+   for(i = 0; i < cand.count; i++)
+   {  rule = cand.entries[i]->rule;
+      sel = cand.entries[i]->sel;
+      matches = TRUE;
+      if(httpdebug && tagname && Stricmp((char *)tagname,"PRE") == 0)
+      {  printf("[CSS] ApplyCSSToBody: Checking selector - element=%s, class=%s, id=%s against PRE\n",
+               sel->name ? (char *)sel->name : "any",
+               sel->class ? (char *)sel->class : "none",
+               sel->id ? (char *)sel->id : "none");
+      }
+      
+      /* debug_printf("CSS: Checking selector: type=0x%lx name=%s class=%s id=%s against element tagname=%s class=%s id=%s\n",
+                  (ULONG)sel->type,
+                  (sel->name ? (char *)sel->name : "NULL"),
+                  (sel->class ? (char *)sel->class : "NULL"),
+                  (sel->id ? (char *)sel->id : "NULL"),
+                  (tagname ? (char *)tagname : "NULL"),
+                  (class ? (char *)class : "NULL"),
+                  (id ? (char *)id : "NULL")); */
+      
+      /* Match element name */
+      if(sel->type & CSS_SEL_ELEMENT && sel->name)
+      {  /* For body selector, tagname can be "BODY" or NULL (for document body) */
+         if(Stricmp((char *)sel->name,"body") == 0)
+         {  if(tagname && Stricmp((char *)tagname,"BODY") != 0)
+            {  /* debug_printf("CSS: Element name mismatch: selector wants 'body' but element is '%s'\n", tagname); */
                matches = FALSE;
             }
-            else
-            {  /* debug_printf("CSS: Element name matches: '%s'\n", sel->name); */
-            }
          }
-         
-         /* Match class */
-         if(matches && sel->type & CSS_SEL_CLASS && sel->class)
-         {  if(!class)
-            {  /* debug_printf("CSS: Class selector requires class but element has none\n"); */
+         else if(Stricmp((char *)sel->name, "html") == 0)
+         {  /* html selector matches html element OR root element (no tagname) */
+            if(tagname && Stricmp((char *)tagname, "html") != 0)
+            {  /* Has tagname but it's not "html" - doesn't match */
                matches = FALSE;
             }
-            else
-            {  /* Use proper word-boundary matching */
-               if(!MatchClassAttribute(class, sel->class))
-               {  matches = FALSE;
-               }
-            }
+            /* If no tagname, this is the root element - html selector matches */
          }
-         
-         /* Match ID */
-         if(matches && sel->type & CSS_SEL_ID && sel->id)
-         {  if(!id || Stricmp((char *)sel->id,(char *)id) != 0)
-            {  /* debug_printf("CSS: ID mismatch: selector wants '%s' but element has '%s'\n",
-                           sel->id, id ? (char *)id : "NULL"); */
-               matches = FALSE;
-            }
-            else
-            {  /* debug_printf("CSS: ID matches: '%s'\n", sel->id); */
+         else if(!tagname || Stricmp((char *)sel->name,(char *)tagname) != 0)
+         {  /* debug_printf("CSS: Element name mismatch: selector wants '%s' but element is '%s'\n",
+                        sel->name, tagname ? (char *)tagname : "NULL"); */
+            matches = FALSE;
+         }
+         else
+         {  /* debug_printf("CSS: Element name matches: '%s'\n", sel->name); */
+         }
+      }
+      
+      /* Match class */
+      if(matches && sel->type & CSS_SEL_CLASS && sel->class)
+      {  if(!class)
+         {  /* debug_printf("CSS: Class selector requires class but element has none\n"); */
+            matches = FALSE;
+         }
+         else
+         {  /* Use proper word-boundary matching */
+            if(!MatchClassAttribute(class, sel->class))
+            {  matches = FALSE;
             }
          }
-         
-         /* If selector matches, collect position-related properties */
-         if(matches)
-         {  for(prop = (struct CSSProperty *)rule->properties.mlh_Head;
-               (struct MinNode *)prop->node.mln_Succ;
-               prop = (struct CSSProperty *)prop->node.mln_Succ)
-            {  if(prop->name && prop->value)
-               {  /* Check position property first */
-                  if(Stricmp((char *)prop->name,"position") == 0)
-                  {  if(Stricmp((char *)prop->value,"absolute") == 0)
-                     {  isAbsolute = TRUE;
-                     }
-                  }
-                  /* Store top, left, margin-right for later processing */
-                  else if(Stricmp((char *)prop->name,"top") == 0)
-                  {  topValue = prop->value;
-                  }
-                  else if(Stricmp((char *)prop->name,"left") == 0)
-                  {  leftValue = prop->value;
-                  }
-                  else if(Stricmp((char *)prop->name,"margin-right") == 0)
-                  {  marginRightValue = prop->value;
+      }
+      
+      /* Match ID */
+      if(matches && sel->type & CSS_SEL_ID && sel->id)
+      {  if(!id || Stricmp((char *)sel->id,(char *)id) != 0)
+         {  /* debug_printf("CSS: ID mismatch: selector wants '%s' but element has '%s'\n",
+                        sel->id, id ? (char *)id : "NULL"); */
+            matches = FALSE;
+         }
+         else
+         {  /* debug_printf("CSS: ID matches: '%s'\n", sel->id); */
+         }
+      }
+      
+      /* If selector matches, collect position-related properties */
+      if(matches)
+      {  for(prop = (struct CSSProperty *)rule->properties.mlh_Head;
+            (struct MinNode *)prop->node.mln_Succ;
+            prop = (struct CSSProperty *)prop->node.mln_Succ)
+         {  if(prop->name && prop->value)
+            {  /* Check position property first */
+               if(Stricmp((char *)prop->name,"position") == 0)
+               {  if(Stricmp((char *)prop->value,"absolute") == 0)
+                  {  isAbsolute = TRUE;
                   }
                }
+               /* Store top, left, margin-right for later processing */
+               else if(Stricmp((char *)prop->name,"top") == 0)
+               {  topValue = prop->value;
+               }
+               else if(Stricmp((char *)prop->name,"left") == 0)
+               {  leftValue = prop->value;
+               }
+               else if(Stricmp((char *)prop->name,"margin-right") == 0)
+               {  marginRightValue = prop->value;
+               }
             }
          }
       }
    }
+   FreeCSSCandidates(&cand);
    
    /* Second pass: Apply all properties */
-   for(rule = (struct CSSRule *)sheet->rules.mlh_Head;
-       (struct MinNode *)rule->node.mln_Succ;
-       rule = (struct CSSRule *)rule->node.mln_Succ)
-   {  for(sel = (struct CSSSelector *)rule->selectors.mlh_Head;
-         (struct MinNode *)sel->node.mln_Succ;
-         sel = (struct CSSSelector *)sel->node.mln_Succ)
-      {  matches = TRUE;
-         
-         /* Match element name */
-         if(sel->type & CSS_SEL_ELEMENT && sel->name)
-         {  /* For body selector, tagname can be "BODY" or NULL (for document body) */
-            if(Stricmp((char *)sel->name,"body") == 0)
-            {  if(tagname && Stricmp((char *)tagname,"BODY") != 0)
-               {  if(httpdebug && tagname && Stricmp((char *)tagname,"PRE") == 0)
-                  {  printf("[CSS] ApplyCSSToBody: Selector 'body' doesn't match tagname=%s\n", tagname);
-                  }
-                  matches = FALSE;
-               }
-            }
-            else if(Stricmp((char *)sel->name, "html") == 0)
-            {  /* html selector matches html element OR root element (no tagname) */
-               if(tagname && Stricmp((char *)tagname, "html") != 0)
-               {  /* Has tagname but it's not "html" - doesn't match */
-                  if(httpdebug && tagname && Stricmp((char *)tagname,"PRE") == 0)
-                  {  printf("[CSS] ApplyCSSToBody: Selector 'html' doesn't match tagname=%s\n", tagname);
-                  }
-                  matches = FALSE;
+   FindCSSCandidates(sheet,tagname,class,id,&cand);
+   for(i = 0; i < cand.count; i++)
+   {  rule = cand.entries[i]->rule;
+      sel = cand.entries[i]->sel;
+      matches = TRUE;
+      
+      /* Match element name */
+      if(sel->type & CSS_SEL_ELEMENT && sel->name)
+      {  /* For body selector, tagname can be "BODY" or NULL (for document body) */
+         if(Stricmp((char *)sel->name,"body") == 0)
+         {  if(tagname && Stricmp((char *)tagname,"BODY") != 0)
+            {  if(httpdebug && tagname && Stricmp((char *)tagname,"PRE") == 0)
+               {  printf("[CSS] ApplyCSSToBody: Selector 'body' doesn't match tagname=%s\n", tagname);
                }
-               /* If no tagname, this is the root element - html selector matches */
+               matches = FALSE;
             }
-            else if(!tagname || Stricmp((char *)sel->name,(char *)tagname) != 0)
-            {  if(httpdebug && tagname && Stricmp((char *)tagname,"PRE") == 0)
-               {  printf("[CSS] ApplyCSSToBody: Selector '%s' doesn't match tagname=%s\n",
-                        sel->name ? (char *)sel->name : "NULL", tagname);
+         }
+         else if(Stricmp((char *)sel->name, "html") == 0)
+         {  /* html selector matches html element OR root element (no tagname) */
+            if(tagname && Stricmp((char *)tagname, "html") != 0)
+            {  /* Has tagname but it's not "html" - doesn't match */
+               if(httpdebug && tagname && Stricmp((char *)tagname,"PRE") == 0)
+               {  printf("[CSS] ApplyCSSToBody: Selector 'html' doesn't match tagname=%s\n", tagname);
                }
                matches = FALSE;
             }
-            else if(httpdebug && tagname && Stricmp((char *)tagname,"PRE") == 0)
-            {  printf("[CSS] ApplyCSSToBody: Selector '%s' element name matches tagname=%s\n",
+            /* If no tagname, this is the root element - html selector matches */
+         }
+         else if(!tagname || Stricmp((char *)sel->name,(char *)tagname) != 0)
+         {  if(httpdebug && tagname && Stricmp((char *)tagname,"PRE") == 0)
+            {  printf("[CSS] ApplyCSSToBody: Selector '%s' doesn't match tagname=%s\n",
                      sel->name ? (char *)sel->name : "NULL", tagname);
             }
+            matches = FALSE;
          }
-         
-         /* Match class - use proper word-boundary matching */
-         if(matches && sel->type & CSS_SEL_CLASS && sel->class)
-         {  if(!MatchClassAttribute(class, sel->class))
-            {  matches = FALSE;
-            }
+         else if(httpdebug && tagname && Stricmp((char *)tagname,"PRE") == 0)
+         {  printf("[CSS] ApplyCSSToBody: Selector '%s' element name matches tagname=%s\n",
+                  sel->name ? (char *)sel->name : "NULL", tagname);
          }
-         
-         /* Match ID */
-         if(matches && sel->type & CSS_SEL_ID && sel->id)
-         {  if(!id || Stricmp((char *)sel->id,(char *)id) != 0)
-            {  matches = FALSE;
-            }
+      }
+      
+      /* Match class - use proper word-boundary matching */
+      if(matches && sel->type & CSS_SEL_CLASS && sel->class)
+      {  if(!MatchClassAttribute(class, sel->class))
+         {  matches = FALSE;
          }
-         
-         /* Skip rules with pseudo-classes (e.g., :link, :visited, :hover) - these are handled
-          * by ApplyCSSToLinkColors and ApplyCSSToLink, not by ApplyCSSToBody */
-         if(matches && (sel->type & CSS_SEL_PSEUDO) && sel->pseudo)
+      }
+      
+      /* Match ID */
+      if(matches && sel->type & CSS_SEL_ID && sel->id)
+      {  if(!id || Stricmp((char *)sel->id,(char *)id) != 0)
          {  matches = FALSE;
          }
-         
-         /* If selector matches, apply properties */
-         if(matches)
-         {  extern BOOL httpdebug;
-            if(httpdebug)
-            {  printf("[CSS] ApplyCSSToBody: Selector matched - element=%s, class=%s, id=%s, tagname=%s\n",
-                     (sel->name ? (char *)sel->name : "any"),
-                     (sel->class ? (char *)sel->class : "none"),
-                     (sel->id ? (char *)sel->id : "none"),
-                     (tagname ? (char *)tagname : "NULL"));
-            }
-            for(prop = (struct CSSProperty *)rule->properties.mlh_Head;
-               (struct MinNode *)prop->node.mln_Succ;
-               prop = (struct CSSProperty *)prop->node.mln_Succ)
-            {  if(prop->name && prop->value && prop->value[0] != '\0')
-               {  extern BOOL httpdebug;
-                  if(httpdebug)
-                  {  printf("[CSS] ApplyCSSToBody: Applying property %s = %s to tagname=%s\n",
-                           prop->name ? (char *)prop->name : "NULL",
-                           prop->value ? (char *)prop->value : "NULL",
-                           tagname ? (char *)tagname : "NULL");
+      }
+      
+      /* Skip rules with pseudo-classes (e.g., :link, :visited, :hover) - these are handled
+       * by ApplyCSSToLinkColors and ApplyCSSToLink, not by ApplyCSSToBody */
+      if(matches && (sel->type & CSS_SEL_PSEUDO) && sel->pseudo)
+      {  matches = FALSE;
+      }
+      
+      /* If selector matches, apply properties */
+      if(matches)
+      {  extern BOOL httpdebug;
+         if(httpdebug)
+         {  printf("[CSS] ApplyCSSToBody: Selector matched - element=%s, class=%s, id=%s, tagname=%s\n",
+                  (sel->name ? (char *)sel->name : "any"),
+                  (sel->class ? (char *)sel->class : "none"),
+                  (sel->id ? (char *)sel->id : "none"),
+                  (tagname ? (char *)tagname : "NULL"));
+         }
+         for(prop = (struct CSSProperty *)rule->properties.mlh_Head;
+            (struct MinNode *)prop->node.mln_Succ;
+            prop = (struct CSSProperty *)prop->node.mln_Succ)
+         {  if(prop->name && prop->value && prop->value[0] != '\0')
+            {  extern BOOL httpdebug;
+               if(httpdebug)
+               {  printf("[CSS] ApplyCSSToBody: Applying property %s = %s to tagname=%s\n",
+                        prop->name ? (char *)prop->name : "NULL",
+                        prop->value ? (char *)prop->value : "NULL",
+                        tagname ? (char *)tagname : "NULL");
+               }
+               /* Apply text-align to body alignment */
+               if(Stricmp((char *)prop->name,"text-align") == 0)
+               {  if(Stricmp((char *)prop->value,"center") == 0)
+                  {  align = HALIGN_CENTER;
                   }
-                  /* Apply text-align to body alignment */
-                  if(Stricmp((char *)prop->name,"text-align") == 0)
-                  {  if(Stricmp((char *)prop->value,"center") == 0)
-                     {  align = HALIGN_CENTER;
-                     }
-                     else if(Stricmp((char *)prop->value,"left") == 0)
-                     {  align = HALIGN_LEFT;
-                     }
-                     else if(Stricmp((char *)prop->value,"right") == 0)
-                     {  align = HALIGN_RIGHT;
+                  else if(Stricmp((char *)prop->value,"left") == 0)
+                  {  align = HALIGN_LEFT;
+                  }
+                  else if(Stricmp((char *)prop->value,"right") == 0)
+                  {  align = HALIGN_RIGHT;
+                  }
+                  else
+                  {  continue;
+                  }
+                  /* Apply to body's divalign (for DIV) or align (for P) */
+                  if(tagname && Stricmp((char *)tagname,"DIV") == 0)
+                  {  Asetattrs(body,AOBDY_Divalign,align,TAG_END);
+                  }
+                  else if(tagname && Stricmp((char *)tagname,"P") == 0)
+                  {  Asetattrs(body,AOBDY_Align,align,TAG_END);
+                  }
+                  /* For table cells (TD/TH), text-align is handled by ApplyCSSToTableCellFromRules */
+                  /* which applies it to the table object, not the body */
+               }
+               /* Apply font-family - handle comma-separated list */
+               else if(Stricmp((char *)prop->name,"font-family") == 0)
+               {  UBYTE *fontValue;
+                  UBYTE *p;
+                  UBYTE *start;
+                  UBYTE *end;
+                  long len;
+                  BOOL found = FALSE;
+                  
+                  fontFace = NULL;
+                  fontValue = prop->value;
+                  /* debug_printf("CSS: font-family property value='%s' (length=%ld)\n",
+                               fontValue ? (char *)fontValue : "NULL",
+                               fontValue ? strlen((char *)fontValue) : 0); */
+                  p = fontValue;
+                  
+                  /* Try each font in the comma-separated list */
+                  while(*p && !found)
+                  {  /* Skip leading whitespace */
+                     while(*p && isspace(*p)) p++;
+                     if(!*p) break;
+                     
+                     start = p;
+                     
+                     /* Check if font name is quoted */
+                     if(*p == '"' || *p == '\'')
+                     {  UBYTE quote = *p;
+                        start = p + 1;
+                        /* Find closing quote */
+                        end = (UBYTE *)strchr((char *)start,quote);
+                        if(end)
+                        {  len = end - start;
+                           p = end + 1;
+                        }
+                        else
+                        {  /* No closing quote, use rest of string */
+                           len = strlen((char *)start);
+                           p = start + len;
+                        }
                      }
                      else
-                     {  continue;
-                     }
-                     /* Apply to body's divalign (for DIV) or align (for P) */
-                     if(tagname && Stricmp((char *)tagname,"DIV") == 0)
-                     {  Asetattrs(body,AOBDY_Divalign,align,TAG_END);
-                     }
-                     else if(tagname && Stricmp((char *)tagname,"P") == 0)
-                     {  Asetattrs(body,AOBDY_Align,align,TAG_END);
+                     {  /* Find comma or end */
+                        end = (UBYTE *)strchr((char *)start,',');
+                        if(end)
+                        {  len = end - start;
+                           p = end + 1;
+                        }
+                        else
+                        {  len = strlen((char *)start);
+                           p = start + len;
+                        }
                      }
-                     /* For table cells (TD/TH), text-align is handled by ApplyCSSToTableCellFromRules */
-                     /* which applies it to the table object, not the body */
+                     
+                     /* Trim trailing whitespace */
+                     while(len > 0 && isspace(start[len - 1])) len--;
+                     
+                     /* Skip comma and whitespace */
+                     while(*p && (isspace(*p) || *p == ',')) p++;
                   }
-                  /* Apply font-family - handle comma-separated list */
-                  else if(Stricmp((char *)prop->name,"font-family") == 0)
-                  {  UBYTE *fontValue;
-                     UBYTE *p;
-                     UBYTE *start;
-                     UBYTE *end;
+                  
+                  /* Apply the full font list so Matchfont can handle fallbacks properly */
+                  /* Strip quotes from font names before passing to Matchfont */
+                  if(fontValue && *fontValue)
+                  {  UBYTE *p;
+                     UBYTE *q;
                      long len;
-                     BOOL found = FALSE;
+                     BOOL inQuotes;
+                     UBYTE quote;
                      
-                     fontFace = NULL;
-                     fontValue = prop->value;
-                     /* debug_printf("CSS: font-family property value='%s' (length=%ld)\n",
-                                  fontValue ? (char *)fontValue : "NULL",
-                                  fontValue ? strlen((char *)fontValue) : 0); */
+                     /* Calculate length needed (without quotes) */
+                     len = 0;
                      p = fontValue;
-                     
-                     /* Try each font in the comma-separated list */
-                     while(*p && !found)
-                     {  /* Skip leading whitespace */
-                        while(*p && isspace(*p)) p++;
-                        if(!*p) break;
-                        
-                        start = p;
-                        
-                        /* Check if font name is quoted */
-                        if(*p == '"' || *p == '\'')
-                        {  UBYTE quote = *p;
-                           start = p + 1;
-                           /* Find closing quote */
-                           end = (UBYTE *)strchr((char *)start,quote);
-                           if(end)
-                           {  len = end - start;
-                              p = end + 1;
-                           }
-                           else
-                           {  /* No closing quote, use rest of string */
-                              len = strlen((char *)start);
-                              p = start + len;
-                           }
+                     inQuotes = FALSE;
+                     quote = 0;
+                     while(*p)
+                     {  if((*p == '"' || *p == '\'') && !inQuotes)
+                        {  quote = *p;
+                           inQuotes = TRUE;
+                           p++;
+                        }
+                        else if(inQuotes && *p == quote)
+                        {  inQuotes = FALSE;
+                           quote = 0;
+                           p++;
                         }
                         else
-                        {  /* Find comma or end */
-                           end = (UBYTE *)strchr((char *)start,',');
-                           if(end)
-                           {  len = end - start;
-                              p = end + 1;
-                           }
-                           else
-                           {  len = strlen((char *)start);
-                              p = start + len;
-                           }
+                        {  len++;
+                           p++;
                         }
-                        
-                        /* Trim trailing whitespace */
-                        while(len > 0 && isspace(start[len - 1])) len--;
-                        
-                        /* Skip comma and whitespace */
-                        while(*p && (isspace(*p) || *p == ',')) p++;
                      }
                      
-                     /* Apply the full font list so Matchfont can handle fallbacks properly */
-                     /* Strip quotes from font names before passing to Matchfont */
-                     if(fontValue && *fontValue)
-                     {  UBYTE *p;
-                        UBYTE *q;
-                        long len;
-                        BOOL inQuotes;
-                        UBYTE quote;
-                        
-                        /* Calculate length needed (without quotes) */
-                        len = 0;
+                     fontFace = ALLOCTYPE(UBYTE,len + 1,0);
+                     if(fontFace)
+                     {  /* Copy font value, stripping quotes */
                         p = fontValue;
+                        q = fontFace;
                         inQuotes = FALSE;
                         quote = 0;
                         while(*p)
@@ -862,764 +879,757 @@ void ApplyCSSToBody(struct Document *doc,void *body,UBYTE *class,UBYTE *id,UBYTE
                               p++;
                            }
                            else
-                           {  len++;
-                              p++;
+                           {  *q++ = *p++;
                            }
                         }
+                        *q = '\0';
                         
-                        fontFace = ALLOCTYPE(UBYTE,len + 1,0);
-                        if(fontFace)
-                        {  /* Copy font value, stripping quotes */
-                           p = fontValue;
-                           q = fontFace;
-                           inQuotes = FALSE;
-                           quote = 0;
-                           while(*p)
-                           {  if((*p == '"' || *p == '\'') && !inQuotes)
-                              {  quote = *p;
-                                 inQuotes = TRUE;
-                                 p++;
-                              }
-                              else if(inQuotes && *p == quote)
-                              {  inQuotes = FALSE;
-                                 quote = 0;
-                                 p++;
-                              }
-                              else
-                              {  *q++ = *p++;
-                              }
-                           }
-                           *q = '\0';
-                           
-                           /* debug_printf("CSS: Applying full font-family='%s' to body (tagname=%s, length=%ld)\n",
-                                        fontFace, (tagname ? (char *)tagname : "NULL"),
-                                        strlen((char *)fontFace)); */
-                           /* Apply font face to body - Matchfont will handle the comma-separated list and generic families */
-                           /* Note: We need to ensure the font is actually used - Matchfont should find Helvetica or Arial from the alias list */
-                           Asetattrs(body,AOBDY_Fontface,fontFace,TAG_END);
-                           /* debug_printf("CSS: font-family applied to body, fontFace='%s'\n", fontFace); */
-                           FREE(fontFace);
-                           /* debug_printf("CSS: font-family applied successfully\n"); */
-                        }
-                        else
-                        {  /* debug_printf("CSS: font-family allocation failed for '%s'\n",fontValue); */
-                        }
+                        /* debug_printf("CSS: Applying full font-family='%s' to body (tagname=%s, length=%ld)\n",
+                                     fontFace, (tagname ? (char *)tagname : "NULL"),
+                                     strlen((char *)fontFace)); */
+                        /* Apply font face to body - Matchfont will handle the comma-separated list and generic families */
+                        /* Note: We need to ensure the font is actually used - Matchfont should find Helvetica or Arial from the alias list */
+                        Asetattrs(body,AOBDY_Fontface,fontFace,TAG_END);
+                        /* debug_printf("CSS: font-family applied to body, fontFace='%s'\n", fontFace); */
+                        FREE(fontFace);
+                        /* debug_printf("CSS: font-family applied successfully\n"); */
                      }
                      else
-                     {  /* debug_printf("CSS: font-family value is empty or NULL\n"); */
+                     {  /* debug_printf("CSS: font-family allocation failed for '%s'\n",fontValue); */
                      }
                   }
-                  /* Apply font-size */
-                  else if(Stricmp((char *)prop->name,"font-size") == 0)
-                  {  fontSize = 0;
-                     isRelative = FALSE;
-                     
-                     /* Map CSS font-size keywords to AWeb sizes (1-7) */
-                     if(Stricmp((char *)prop->value,"xx-small") == 0)
-                     {  fontSize = 1; /* Smallest */
-                     }
-                     else if(Stricmp((char *)prop->value,"x-small") == 0)
-                     {  fontSize = 2;
-                     }
-                     else if(Stricmp((char *)prop->value,"small") == 0)
-                     {  fontSize = 3;
-                     }
-                     else if(Stricmp((char *)prop->value,"medium") == 0)
-                     {  fontSize = 4; /* Default */
-                     }
-                     else if(Stricmp((char *)prop->value,"large") == 0)
-                     {  fontSize = 5;
-                     }
-                     else if(Stricmp((char *)prop->value,"x-large") == 0)
-                     {  fontSize = 6;
-                     }
-                     else if(Stricmp((char *)prop->value,"xx-large") == 0)
-                     {  fontSize = 7; /* Largest */
-                     }
-                     else if(Stricmp((char *)prop->value,"smaller") == 0)
-                     {  fontSize = -1; /* Relative: one size smaller */
-                        isRelative = TRUE;
-                     }
-                     else if(Stricmp((char *)prop->value,"larger") == 0)
-                     {  fontSize = 1; /* Relative: one size larger */
-                        isRelative = TRUE;
-                     }
-                     else
-                     {  /* Try to parse as pixel/length value (e.g., "14px", "1.2em") */
-                        long sizeValue;
-                        sizeValue = ParseCSSLengthValue(prop->value,&num);
-                        if(num.type == NUMBER_NUMBER && sizeValue > 0)
-                        {  /* Map pixel values to AWeb sizes (1-7)
-                             * Approximate mapping: <10px=1, 10-12px=2, 13-14px=3, 15-16px=4, 17-18px=5, 19-22px=6, >22px=7 */
-                           if(sizeValue < 10)
-                           {  fontSize = 1;
-                           }
-                           else if(sizeValue <= 12)
-                           {  fontSize = 2;
-                           }
-                           else if(sizeValue <= 14)
-                           {  fontSize = 3;
-                           }
-                           else if(sizeValue <= 16)
-                           {  fontSize = 4;
-                           }
-                           else if(sizeValue <= 18)
-                           {  fontSize = 5;
-                           }
-                           else if(sizeValue <= 22)
-                           {  fontSize = 6;
-                           }
-                           else
-                           {  fontSize = 7;
-                           }
+                  else
+                  {  /* debug_printf("CSS: font-family value is empty or NULL\n"); */
+                  }
+               }
+               /* Apply font-size */
+               else if(Stricmp((char *)prop->name,"font-size") == 0)
+               {  fontSize = 0;
+                  isRelative = FALSE;
+                  
+                  /* Map CSS font-size keywords to AWeb sizes (1-7) */
+                  if(Stricmp((char *)prop->value,"xx-small") == 0)
+                  {  fontSize = 1; /* Smallest */
+                  }
+                  else if(Stricmp((char *)prop->value,"x-small") == 0)
+                  {  fontSize = 2;
+                  }
+                  else if(Stricmp((char *)prop->value,"small") == 0)
+                  {  fontSize = 3;
+                  }
+                  else if(Stricmp((char *)prop->value,"medium") == 0)
+                  {  fontSize = 4; /* Default */
+                  }
+                  else if(Stricmp((char *)prop->value,"large") == 0)
+                  {  fontSize = 5;
+                  }
+                  else if(Stricmp((char *)prop->value,"x-large") == 0)
+                  {  fontSize = 6;
+                  }
+                  else if(Stricmp((char *)prop->value,"xx-large") == 0)
+                  {  fontSize = 7; /* Largest */
+                  }
+                  else if(Stricmp((char *)prop->value,"smaller") == 0)
+                  {  fontSize = -1; /* Relative: one size smaller */
+                     isRelative = TRUE;
+                  }
+                  else if(Stricmp((char *)prop->value,"larger") == 0)
+                  {  fontSize = 1; /* Relative: one size larger */
+                     isRelative = TRUE;
+                  }
+                  else
+                  {  /* Try to parse as pixel/length value (e.g., "14px", "1.2em") */
+                     long sizeValue;
+                     sizeValue = ParseCSSLengthValue(prop->value,&num);
+                     if(num.type == NUMBER_NUMBER && sizeValue > 0)
+                     {  /* Map pixel values to AWeb sizes (1-7)
+                          * Approximate mapping: <10px=1, 10-12px=2, 13-14px=3, 15-16px=4, 17-18px=5, 19-22px=6, >22px=7 */
+                        if(sizeValue < 10)
+                        {  fontSize = 1;
                         }
-                        /* Note: em, ex, % values would need parent font size context - not implemented yet */
-                     }
-                     
-                     if(fontSize != 0)
-                     {  /* Apply font size to body */
-                        if(isRelative)
-                        {  Asetattrs(body,AOBDY_Fontsizerel,fontSize,TAG_END);
+                        else if(sizeValue <= 12)
+                        {  fontSize = 2;
+                        }
+                        else if(sizeValue <= 14)
+                        {  fontSize = 3;
+                        }
+                        else if(sizeValue <= 16)
+                        {  fontSize = 4;
+                        }
+                        else if(sizeValue <= 18)
+                        {  fontSize = 5;
+                        }
+                        else if(sizeValue <= 22)
+                        {  fontSize = 6;
                         }
                         else
-                        {  Asetattrs(body,AOBDY_Fontsize,fontSize,TAG_END);
+                        {  fontSize = 7;
                         }
                      }
+                     /* Note: em, ex, % values would need parent font size context - not implemented yet */
                   }
-                  /* CSS2: position property */
-                  else if(Stricmp((char *)prop->name,"position") == 0)
-                  {  if(Stricmp((char *)prop->value,"absolute") == 0)
-                     {  isAbsolute = TRUE;
-                        /* Note: Full absolute positioning requires layout engine changes */
-                     }
-                     else if(Stricmp((char *)prop->value,"relative") == 0)
-                     {  /* Relative positioning - not yet implemented */
-                     }
-                     else if(Stricmp((char *)prop->value,"static") == 0)
-                     {  /* Static positioning (default) */
+                  
+                  if(fontSize != 0)
+                  {  /* Apply font size to body */
+                     if(isRelative)
+                     {  Asetattrs(body,AOBDY_Fontsizerel,fontSize,TAG_END);
                      }
-                     else if(Stricmp((char *)prop->value,"fixed") == 0)
-                     {  /* Fixed positioning - not yet implemented */
+                     else
+                     {  Asetattrs(body,AOBDY_Fontsize,fontSize,TAG_END);
                      }
                   }
-                  /* CSS2: top property */
-                  else if(Stricmp((char *)prop->name,"top") == 0)
-                  {  posValue = ParseCSSLengthValue(prop->value,&num);
-                     if(isAbsolute && num.type == NUMBER_PERCENT)
-                     {  /* Percentage-based top positioning */
-                        /* Convert percentage (0-100) to 0-10000 scale */
-                        long percentValue = num.n * 100;
-                        if(percentValue < 0) percentValue = 0;
-                        if(percentValue > 10000) percentValue = 10000;
-                        Asetattrs(body,AOBDY_TopPercent,percentValue,TAG_END);
-                     }
-                     else if(isAbsolute && (num.type == NUMBER_NUMBER || num.type == NUMBER_SIGNED))
-                     {  /* Pixel-based top positioning (can be negative) */
-                        Asetattrs(body,AOBJ_Top,posValue,TAG_END);
-                     }
+               }
+               /* CSS2: position property */
+               else if(Stricmp((char *)prop->name,"position") == 0)
+               {  if(Stricmp((char *)prop->value,"absolute") == 0)
+                  {  isAbsolute = TRUE;
+                     /* Note: Full absolute positioning requires layout engine changes */
                   }
-                  /* CSS2: left property */
-                  else if(Stricmp((char *)prop->name,"left") == 0)
-                  {  posValue = ParseCSSLengthValue(prop->value,&num);
-                     if(isAbsolute && num.type == NUMBER_PERCENT)
-                     {  /* Percentage-based left positioning */
-                        /* Convert percentage (0-100) to 0-10000 scale */
-                        long percentValue = num.n * 100;
-                        if(percentValue < 0) percentValue = 0;
-                        if(percentValue > 10000) percentValue = 10000;
-                        Asetattrs(body,AOBDY_LeftPercent,percentValue,TAG_END);
-                     }
-                     else if(isAbsolute && (num.type == NUMBER_NUMBER || num.type == NUMBER_SIGNED))
-                     {  /* Pixel-based left positioning (can be negative) */
-                        Asetattrs(body,AOBJ_Left,posValue,TAG_END);
-                     }
+                  else if(Stricmp((char *)prop->value,"relative") == 0)
+                  {  /* Relative positioning - not yet implemented */
                   }
-                  /* CSS1: margin-right property */
-                  else if(Stricmp((char *)prop->name,"margin-right") == 0)
-                  {  posValue = ParseCSSLengthValue(prop->value,&num);
-                     if(num.type == NUMBER_PERCENT)
-                     {  /* Percentage-based margin */
-                        /* Convert percentage (0-100) to 0-10000 scale */
-                        long percentValue = num.n * 100;
-                        if(percentValue < -10000) percentValue = -10000;
-                        if(percentValue > 10000) percentValue = 10000;
-                        Asetattrs(body,AOBDY_MarginRight,percentValue,TAG_END);
-                     }
-                     else if(num.type == NUMBER_NUMBER || num.type == NUMBER_SIGNED)
-                     {  /* Pixel-based margin (can be negative) */
-                        Asetattrs(body,AOBDY_MarginRight,posValue,TAG_END);
-                     }
+                  else if(Stricmp((char *)prop->value,"static") == 0)
+                  {  /* Static positioning (default) */
                   }
-                  /* CSS1: margin-left, margin-top, margin-bottom */
-                  else if(Stricmp((char *)prop->name,"margin-left") == 0 ||
-                          Stricmp((char *)prop->name,"margin-top") == 0 ||
-                          Stricmp((char *)prop->name,"margin-bottom") == 0)
-                  {  posValue = ParseCSSLengthValue(prop->value,&num);
-                     if(num.type == NUMBER_NUMBER)
-                     {  /* Pixel-based margin */
-                        if(Stricmp((char *)prop->name,"margin-left") == 0)
-                        {  /* Apply to left margin */
-                           Asetattrs(body,AOBDY_Leftmargin,posValue,TAG_END);
-                        }
-                        else if(Stricmp((char *)prop->name,"margin-top") == 0)
-                        {  /* Apply to top margin */
-                           Asetattrs(body,AOBDY_Topmargin,posValue,TAG_END);
-                        }
-                        /* margin-bottom would need new attribute */
-                     }
+                  else if(Stricmp((char *)prop->value,"fixed") == 0)
+                  {  /* Fixed positioning - not yet implemented */
                   }
-                  /* Apply color */
-                  else if(Stricmp((char *)prop->name,"color") == 0)
-                  {  /* Don't apply color to body font color for anchor tags.
-                       * Link colors are handled at the document level via ApplyCSSToLinkColors.
-                       * Setting color on the body would incorrectly affect all body text, not just the link. */
-                     if(!tagname || Stricmp((char *)tagname,"A") != 0)
-                     {  ULONG colorrgb;
-                        struct Colorinfo *ci;
-                        /* Use Gethexcolor to support both hex colors (#rrggbb) and color names (brown, black, etc.) */
-                        Gethexcolor(doc,prop->value,&colorrgb);
-                        if(colorrgb != (ULONG)~0)
-                        {  ci = Finddoccolor(doc,colorrgb);
-                           if(ci)
-                           {  Asetattrs(body,AOBDY_Fontcolor,ci,TAG_END);
-                           }
-                        }
-                     }
+               }
+               /* CSS2: top property */
+               else if(Stricmp((char *)prop->name,"top") == 0)
+               {  posValue = ParseCSSLengthValue(prop->value,&num);
+                  if(isAbsolute && num.type == NUMBER_PERCENT)
+                  {  /* Percentage-based top positioning */
+                     /* Convert percentage (0-100) to 0-10000 scale */
+                     long percentValue = num.n * 100;
+                     if(percentValue < 0) percentValue = 0;
+                     if(percentValue > 10000) percentValue = 10000;
+                     Asetattrs(body,AOBDY_TopPercent,percentValue,TAG_END);
                   }
-                  /* Apply background-color */
-                  else if(Stricmp((char *)prop->name,"background-color") == 0)
-                  {  UBYTE *pval = prop->value;
-                     BOOL isTransparent = FALSE;
-                     
-                     /* Skip whitespace */
-                     while(*pval && isspace(*pval)) pval++;
-                     
-                     /* Check if value is "transparent" */
-                     if(Stricmp((char *)pval, "transparent") == 0)
-                     {  isTransparent = TRUE;
+                  else if(isAbsolute && (num.type == NUMBER_NUMBER || num.type == NUMBER_SIGNED))
+                  {  /* Pixel-based top positioning (can be negative) */
+                     Asetattrs(body,AOBJ_Top,posValue,TAG_END);
+                  }
+               }
+               /* CSS2: left property */
+               else if(Stricmp((char *)prop->name,"left") == 0)
+               {  posValue = ParseCSSLengthValue(prop->value,&num);
+                  if(isAbsolute && num.type == NUMBER_PERCENT)
+                  {  /* Percentage-based left positioning */
+                     /* Convert percentage (0-100) to 0-10000 scale */
+                     long percentValue = num.n * 100;
+                     if(percentValue < 0) percentValue = 0;
+                     if(percentValue > 10000) percentValue = 10000;
+                     Asetattrs(body,AOBDY_LeftPercent,percentValue,TAG_END);
+                  }
+                  else if(isAbsolute && (num.type == NUMBER_NUMBER || num.type == NUMBER_SIGNED))
+                  {  /* Pixel-based left positioning (can be negative) */
+                     Asetattrs(body,AOBJ_Left,posValue,TAG_END);
+                  }
+               }
+               /* CSS1: margin-right property */
+               else if(Stricmp((char *)prop->name,"margin-right") == 0)
+               {  posValue = ParseCSSLengthValue(prop->value,&num);
+                  if(num.type == NUMBER_PERCENT)
+                  {  /* Percentage-based margin */
+                     /* Convert percentage (0-100) to 0-10000 scale */
+                     long percentValue = num.n * 100;
+                     if(percentValue < -10000) percentValue = -10000;
+                     if(percentValue > 10000) percentValue = 10000;
+                     Asetattrs(body,AOBDY_MarginRight,percentValue,TAG_END);
+                  }
+                  else if(num.type == NUMBER_NUMBER || num.type == NUMBER_SIGNED)
+                  {  /* Pixel-based margin (can be negative) */
+                     Asetattrs(body,AOBDY_MarginRight,posValue,TAG_END);
+                  }
+               }
+               /* CSS1: margin-left, margin-top, margin-bottom */
+               else if(Stricmp((char *)prop->name,"margin-left") == 0 ||
+                       Stricmp((char *)prop->name,"margin-top") == 0 ||
+                       Stricmp((char *)prop->name,"margin-bottom") == 0)
+               {  posValue = ParseCSSLengthValue(prop->value,&num);
+                  if(num.type == NUMBER_NUMBER)
+                  {  /* Pixel-based margin */
+                     if(Stricmp((char *)prop->name,"margin-left") == 0)
+                     {  /* Apply to left margin */
+                        Asetattrs(body,AOBDY_Leftmargin,posValue,TAG_END);
                      }
-                     
-                     if(isTransparent)
-                     {  /* Set bgcolor to -1 to indicate transparent (no background color) */
-                        Asetattrs(body, AOBDY_Bgcolor, -1, TAG_END);
+                     else if(Stricmp((char *)prop->name,"margin-top") == 0)
+                     {  /* Apply to top margin */
+                        Asetattrs(body,AOBDY_Topmargin,posValue,TAG_END);
                      }
-                     else
-                     {  ULONG colorrgb;
-                        struct Colorinfo *ci;
-                        /* Use Gethexcolor to support both hex colors (#rrggbb) and color names (brown, black, etc.) */
-                        Gethexcolor(doc,prop->value,&colorrgb);
-                        if(colorrgb != (ULONG)~0)
-                        {  ci = Finddoccolor(doc,colorrgb);
-                           if(ci)
-                           {  Asetattrs(body,AOBDY_Bgcolor,COLOR(ci),TAG_END);
-                           }
+                     /* margin-bottom would need new attribute */
+                  }
+               }
+               /* Apply color */
+               else if(Stricmp((char *)prop->name,"color") == 0)
+               {  /* Don't apply color to body font color for anchor tags.
+                    * Link colors are handled at the document level via ApplyCSSToLinkColors.
+                    * Setting color on the body would incorrectly affect all body text, not just the link. */
+                  if(!tagname || Stricmp((char *)tagname,"A") != 0)
+                  {  ULONG colorrgb;
+                     struct Colorinfo *ci;
+                     /* Use Gethexcolor to support both hex colors (#rrggbb) and color names (brown, black, etc.) */
+                     Gethexcolor(doc,prop->value,&colorrgb);
+                     if(colorrgb != (ULONG)~0)
+                     {  ci = Finddoccolor(doc,colorrgb);
+                        if(ci)
+                        {  Asetattrs(body,AOBDY_Fontcolor,ci,TAG_END);
                         }
                      }
                   }
-                  /* Apply text-transform */
-                  else if(Stricmp((char *)prop->name,"text-transform") == 0)
-                  {  UBYTE *transformStr;
-                     transformStr = Dupstr(prop->value, -1);
-                     if(transformStr)
-                     {  Asetattrs(body, AOBDY_TextTransform, transformStr, TAG_END);
-                        /* Also set document-level text-transform for compatibility */
-                        if(Stricmp((char *)transformStr, "uppercase") == 0)
-                        {  doc->texttransform = 1;
-                        }
-                        else if(Stricmp((char *)transformStr, "lowercase") == 0)
-                        {  doc->texttransform = 2;
-                        }
-                        else if(Stricmp((char *)transformStr, "capitalize") == 0)
-                        {  doc->texttransform = 3;
-                        }
-                        else if(Stricmp((char *)transformStr, "none") == 0)
-                        {  doc->texttransform = 0;
+               }
+               /* Apply background-color */
+               else if(Stricmp((char *)prop->name,"background-color") == 0)
+               {  UBYTE *pval = prop->value;
+                  BOOL isTransparent = FALSE;
+                  
+                  /* Skip whitespace */
+                  while(*pval && isspace(*pval)) pval++;
+                  
+                  /* Check if value is "transparent" */
+                  if(Stricmp((char *)pval, "transparent") == 0)
+                  {  isTransparent = TRUE;
+                  }
+                  
+                  if(isTransparent)
+                  {  /* Set bgcolor to -1 to indicate transparent (no background color) */
+                     Asetattrs(body, AOBDY_Bgcolor, -1, TAG_END);
+                  }
+                  else
+                  {  ULONG colorrgb;
+                     struct Colorinfo *ci;
+                     /* Use Gethexcolor to support both hex colors (#rrggbb) and color names (brown, black, etc.) */
+                     Gethexcolor(doc,prop->value,&colorrgb);
+                     if(colorrgb != (ULONG)~0)
+                     {  ci = Finddoccolor(doc,colorrgb);
+                        if(ci)
+                        {  Asetattrs(body,AOBDY_Bgcolor,COLOR(ci),TAG_END);
                         }
                      }
                   }
-                  /* Apply margin shorthand */
-                  else if(Stricmp((char *)prop->name,"margin") == 0)
-                  {  UBYTE *marginP;
-                     UBYTE *tokenStart;
-                     UBYTE *tokenEnd;
-                     long tokenLen;
-                     UBYTE *tokenBuf;
-                     UBYTE *marginTokens[4];
-                     long marginCount;
-                     long marginTop;
-                     long marginRight;
-                     long marginBottom;
-                     long marginLeft;
-                     long j;
-                     marginP = prop->value;
-                     marginCount = 0;
-                     marginTop = marginRight = marginBottom = marginLeft = 0;
-                     for(j = 0; j < 4; j++) marginTokens[j] = NULL;
-                     
-                     /* Parse margin values - can be 1, 2, 3, or 4 values */
-                     for(j = 0; j < 4 && marginP && *marginP; j++)
-                     {  while(*marginP && isspace(*marginP)) marginP++;
-                        if(!*marginP) break;
-                        tokenStart = marginP;
-                        while(*marginP && !isspace(*marginP)) marginP++;
-                        tokenEnd = marginP;
-                        tokenLen = tokenEnd - tokenStart;
-                        if(tokenLen > 0)
-                        {  tokenBuf = ALLOCTYPE(UBYTE,tokenLen + 1,0);
-                           if(tokenBuf)
-                           {  memmove(tokenBuf,tokenStart,tokenLen);
-                              tokenBuf[tokenLen] = '\0';
-                              marginTokens[marginCount] = tokenBuf;
-                              marginCount++;
-                           }
-                        }
+               }
+               /* Apply text-transform */
+               else if(Stricmp((char *)prop->name,"text-transform") == 0)
+               {  UBYTE *transformStr;
+                  transformStr = Dupstr(prop->value, -1);
+                  if(transformStr)
+                  {  Asetattrs(body, AOBDY_TextTransform, transformStr, TAG_END);
+                     /* Also set document-level text-transform for compatibility */
+                     if(Stricmp((char *)transformStr, "uppercase") == 0)
+                     {  doc->texttransform = 1;
                      }
-                     
-                     /* Apply margin values based on count */
-                     if(marginCount >= 1)
-                     {  marginTop = ParseCSSLengthValue(marginTokens[0],&num);
-                        if(marginCount == 1)
-                        {  marginRight = marginBottom = marginLeft = marginTop;
-                        }
-                        else if(marginCount == 2)
-                        {  marginBottom = marginTop;
-                           marginRight = ParseCSSLengthValue(marginTokens[1],&num);
-                           marginLeft = marginRight;
-                        }
-                        else if(marginCount == 3)
-                        {  marginRight = ParseCSSLengthValue(marginTokens[1],&num);
-                           marginLeft = marginRight;
-                           marginBottom = ParseCSSLengthValue(marginTokens[2],&num);
-                        }
-                        else if(marginCount == 4)
-                        {  marginRight = ParseCSSLengthValue(marginTokens[1],&num);
-                           marginBottom = ParseCSSLengthValue(marginTokens[2],&num);
-                           marginLeft = ParseCSSLengthValue(marginTokens[3],&num);
-                        }
-                        
-                        /* Apply margins */
-                        if(marginTop >= 0 && num.type == NUMBER_NUMBER) Asetattrs(body,AOBDY_Topmargin,marginTop,TAG_END);
-                        if(marginLeft >= 0 && num.type == NUMBER_NUMBER) Asetattrs(body,AOBDY_Leftmargin,marginLeft,TAG_END);
+                     else if(Stricmp((char *)transformStr, "lowercase") == 0)
+                     {  doc->texttransform = 2;
+                     }
+                     else if(Stricmp((char *)transformStr, "capitalize") == 0)
+                     {  doc->texttransform = 3;
                      }
-                     
-                     /* Free temporary token buffers */
-                     for(j = 0; j < marginCount; j++)
-                     {  if(marginTokens[j]) FREE(marginTokens[j]);
+                     else if(Stricmp((char *)transformStr, "none") == 0)
+                     {  doc->texttransform = 0;
                      }
                   }
-                  /* Apply line-height */
-                  else if(Stricmp((char *)prop->name,"line-height") == 0)
-                  {  float lineHeightValue;
-                     UBYTE *lineHeightStr;
-                     lineHeightStr = prop->value;
-                     while(*lineHeightStr && isspace(*lineHeightStr)) lineHeightStr++;
-                     if(sscanf((char *)lineHeightStr,"%f",&lineHeightValue) == 1)
-                     {  doc->lineheight = lineHeightValue;
+               }
+               /* Apply margin shorthand */
+               else if(Stricmp((char *)prop->name,"margin") == 0)
+               {  UBYTE *marginP;
+                  UBYTE *tokenStart;
+                  UBYTE *tokenEnd;
+                  long tokenLen;
+                  UBYTE *tokenBuf;
+                  UBYTE *marginTokens[4];
+                  long marginCount;
+                  long marginTop;
+                  long marginRight;
+                  long marginBottom;
+                  long marginLeft;
+                  long j;
+                  marginP = prop->value;
+                  marginCount = 0;
+                  marginTop = marginRight = marginBottom = marginLeft = 0;
+                  for(j = 0; j < 4; j++) marginTokens[j] = NULL;
+                  
+                  /* Parse margin values - can be 1, 2, 3, or 4 values */
+                  for(j = 0; j < 4 && marginP && *marginP; j++)
+                  {  while(*marginP && isspace(*marginP)) marginP++;
+                     if(!*marginP) break;
+                     tokenStart = marginP;
+                     while(*marginP && !isspace(*marginP)) marginP++;
+                     tokenEnd = marginP;
+                     tokenLen = tokenEnd - tokenStart;
+                     if(tokenLen > 0)
+                     {  tokenBuf = ALLOCTYPE(UBYTE,tokenLen + 1,0);
+                        if(tokenBuf)
+                        {  memmove(tokenBuf,tokenStart,tokenLen);
+                           tokenBuf[tokenLen] = '\0';
+                           marginTokens[marginCount] = tokenBuf;
+                           marginCount++;
+                        }
                      }
                   }
-                  /* Apply font-weight */
-                  else if(Stricmp((char *)prop->name,"font-weight") == 0)
-                  {  if(Stricmp((char *)prop->value,"bold") == 0 || Stricmp((char *)prop->value,"700") == 0)
-                     {  Asetattrs(body,AOBDY_Sethardstyle,FSF_BOLD,TAG_END);
+                  
+                  /* Apply margin values based on count */
+                  if(marginCount >= 1)
+                  {  marginTop = ParseCSSLengthValue(marginTokens[0],&num);
+                     if(marginCount == 1)
+                     {  marginRight = marginBottom = marginLeft = marginTop;
                      }
-                     else if(Stricmp((char *)prop->value,"normal") == 0 || Stricmp((char *)prop->value,"400") == 0)
-                     {  Asetattrs(body,AOBDY_Unsethardstyle,FSF_BOLD,TAG_END);
+                     else if(marginCount == 2)
+                     {  marginBottom = marginTop;
+                        marginRight = ParseCSSLengthValue(marginTokens[1],&num);
+                        marginLeft = marginRight;
                      }
-                  }
-                  /* Apply font-style */
-                  else if(Stricmp((char *)prop->name,"font-style") == 0)
-                  {  if(Stricmp((char *)prop->value,"italic") == 0)
-                     {  Asetattrs(body,AOBDY_Sethardstyle,FSF_ITALIC,TAG_END);
+                     else if(marginCount == 3)
+                     {  marginRight = ParseCSSLengthValue(marginTokens[1],&num);
+                        marginLeft = marginRight;
+                        marginBottom = ParseCSSLengthValue(marginTokens[2],&num);
                      }
-                     else if(Stricmp((char *)prop->value,"normal") == 0)
-                     {  Asetattrs(body,AOBDY_Unsethardstyle,FSF_ITALIC,TAG_END);
+                     else if(marginCount == 4)
+                     {  marginRight = ParseCSSLengthValue(marginTokens[1],&num);
+                        marginBottom = ParseCSSLengthValue(marginTokens[2],&num);
+                        marginLeft = ParseCSSLengthValue(marginTokens[3],&num);
                      }
+                     
+                     /* Apply margins */
+                     if(marginTop >= 0 && num.type == NUMBER_NUMBER) Asetattrs(body,AOBDY_Topmargin,marginTop,TAG_END);
+                     if(marginLeft >= 0 && num.type == NUMBER_NUMBER) Asetattrs(body,AOBDY_Leftmargin,marginLeft,TAG_END);
                   }
-                  /* Apply text-decoration */
-                  else if(Stricmp((char *)prop->name,"text-decoration") == 0)
-                  {  if(Stricmp((char *)prop->value,"line-through") == 0)
-                     {  Asetattrs(body,AOBDY_Sethardstyle,FSF_STRIKE,TAG_END);
-                     }
-                     else if(Stricmp((char *)prop->value,"none") == 0)
-                     {  Asetattrs(body,AOBDY_Unsethardstyle,FSF_STRIKE,TAG_END);
-                     }
+                  
+                  /* Free temporary token buffers */
+                  for(j = 0; j < marginCount; j++)
+                  {  if(marginTokens[j]) FREE(marginTokens[j]);
                   }
-                  /* Apply width */
-                  else if(Stricmp((char *)prop->name,"width") == 0)
-                  {  long widthValue;
-                     widthValue = ParseCSSLengthValue(prop->value,&num);
-                     if(widthValue >= 0 && num.type != NUMBER_NONE)
-                     {  Asetattrs(body,AOBJ_Width,widthValue,TAG_END);
-                     }
+               }
+               /* Apply line-height */
+               else if(Stricmp((char *)prop->name,"line-height") == 0)
+               {  float lineHeightValue;
+                  UBYTE *lineHeightStr;
+                  lineHeightStr = prop->value;
+                  while(*lineHeightStr && isspace(*lineHeightStr)) lineHeightStr++;
+                  if(sscanf((char *)lineHeightStr,"%f",&lineHeightValue) == 1)
+                  {  doc->lineheight = lineHeightValue;
                   }
-                  /* Apply height */
-                  else if(Stricmp((char *)prop->name,"height") == 0)
-                  {  long heightValue;
-                     heightValue = ParseCSSLengthValue(prop->value,&num);
-                     if(heightValue >= 0 && num.type != NUMBER_NONE)
-                     {  Asetattrs(body,AOBJ_Height,heightValue,TAG_END);
-                     }
+               }
+               /* Apply font-weight */
+               else if(Stricmp((char *)prop->name,"font-weight") == 0)
+               {  if(Stricmp((char *)prop->value,"bold") == 0 || Stricmp((char *)prop->value,"700") == 0)
+                  {  Asetattrs(body,AOBDY_Sethardstyle,FSF_BOLD,TAG_END);
                   }
-                  /* Apply position */
-                  else if(Stricmp((char *)prop->name,"position") == 0)
-                  {  UBYTE *posStr;
-                     posStr = Dupstr(prop->value, -1);
-                     if(posStr)
-                     {  Asetattrs(body, AOBDY_Position, posStr, TAG_END);
-                     }
+                  else if(Stricmp((char *)prop->value,"normal") == 0 || Stricmp((char *)prop->value,"400") == 0)
+                  {  Asetattrs(body,AOBDY_Unsethardstyle,FSF_BOLD,TAG_END);
                   }
-                  /* Apply top */
-                  else if(Stricmp((char *)prop->name,"top") == 0)
-                  {  long topValue;
-                     topValue = ParseCSSLengthValue(prop->value,&num);
-                     if(topValue >= 0 && num.type == NUMBER_NUMBER)
-                     {  Asetattrs(body,AOBJ_Top,topValue,TAG_END);
-                     }
+               }
+               /* Apply font-style */
+               else if(Stricmp((char *)prop->name,"font-style") == 0)
+               {  if(Stricmp((char *)prop->value,"italic") == 0)
+                  {  Asetattrs(body,AOBDY_Sethardstyle,FSF_ITALIC,TAG_END);
                   }
-                  /* Apply left */
-                  else if(Stricmp((char *)prop->name,"left") == 0)
-                  {  long leftValue;
-                     leftValue = ParseCSSLengthValue(prop->value,&num);
-                     if(leftValue >= 0 && num.type == NUMBER_NUMBER)
-                     {  Asetattrs(body,AOBJ_Left,leftValue,TAG_END);
-                     }
+                  else if(Stricmp((char *)prop->value,"normal") == 0)
+                  {  Asetattrs(body,AOBDY_Unsethardstyle,FSF_ITALIC,TAG_END);
                   }
-                  /* Apply right */
-                  else if(Stricmp((char *)prop->name,"right") == 0)
-                  {  long rightValue;
-                     rightValue = ParseCSSLengthValue(prop->value, &num);
-                     if(rightValue >= 0 && num.type == NUMBER_NUMBER)
-                     {  Asetattrs(body, AOBDY_Right, rightValue, TAG_END);
-                     }
+               }
+               /* Apply text-decoration */
+               else if(Stricmp((char *)prop->name,"text-decoration") == 0)
+               {  if(Stricmp((char *)prop->value,"line-through") == 0)
+                  {  Asetattrs(body,AOBDY_Sethardstyle,FSF_STRIKE,TAG_END);
                   }
-                  /* Apply bottom */
-                  else if(Stricmp((char *)prop->name,"bottom") == 0)
-                  {  long bottomValue;
-                     bottomValue = ParseCSSLengthValue(prop->value, &num);
-                     if(bottomValue >= 0 && num.type == NUMBER_NUMBER)
-                     {  Asetattrs(body, AOBDY_Bottom, bottomValue, TAG_END);
-                     }
+                  else if(Stricmp((char *)prop->value,"none") == 0)
+                  {  Asetattrs(body,AOBDY_Unsethardstyle,FSF_STRIKE,TAG_END);
                   }
-                  /* Apply z-index */
-                  else if(Stricmp((char *)prop->name,"z-index") == 0)
-                  {  long zIndexValue;
-                     UBYTE *zval;
-                     UBYTE *zvalCopy;
-                     zval = prop->value;
-                     if(zval && zval[0] != '\0')
-                     {  zvalCopy = Dupstr(zval, -1);
-                        if(zvalCopy)
-                        {  SkipWhitespace(&zvalCopy);
-                           if(Stricmp((char *)zvalCopy,"auto") == 0)
-                           {  zIndexValue = 0;
-                           }
-                           else
-                           {  zIndexValue = strtol((char *)zvalCopy, NULL, 10);
-                           }
-                           FREE(zvalCopy);
-                           Asetattrs(body, AOBDY_ZIndex, zIndexValue, TAG_END);
-                        }
-                     }
+               }
+               /* Apply width */
+               else if(Stricmp((char *)prop->name,"width") == 0)
+               {  long widthValue;
+                  widthValue = ParseCSSLengthValue(prop->value,&num);
+                  if(widthValue >= 0 && num.type != NUMBER_NONE)
+                  {  Asetattrs(body,AOBJ_Width,widthValue,TAG_END);
                   }
-                  /* Apply display property */
-                  else if(Stricmp((char *)prop->name,"display") == 0)
-                  {  UBYTE *dispStr;
-                     dispStr = Dupstr(prop->value, -1);
-                     if(dispStr)
-                     {  Asetattrs(body, AOBDY_Display, dispStr, TAG_END);
-                     }
+               }
+               /* Apply height */
+               else if(Stricmp((char *)prop->name,"height") == 0)
+               {  long heightValue;
+                  heightValue = ParseCSSLengthValue(prop->value,&num);
+                  if(heightValue >= 0 && num.type != NUMBER_NONE)
+                  {  Asetattrs(body,AOBJ_Height,heightValue,TAG_END);
                   }
-                  /* Apply vertical-align */
-                  else if(Stricmp((char *)prop->name,"vertical-align") == 0)
-                  {  short valign;
-                     UBYTE *valignValue;
-                     valign = -1;
-                     valignValue = Dupstr(prop->value, -1);
-                     if(valignValue)
-                     {  if(Stricmp((char *)valignValue,"top") == 0)
-                        {  valign = VALIGN_TOP;
-                        }
-                        else if(Stricmp((char *)valignValue,"middle") == 0)
-                        {  valign = VALIGN_MIDDLE;
-                        }
-                        else if(Stricmp((char *)valignValue,"bottom") == 0)
-                        {  valign = VALIGN_BOTTOM;
-                        }
-                        else if(Stricmp((char *)valignValue,"baseline") == 0)
-                        {  valign = VALIGN_BASELINE;
+               }
+               /* Apply position */
+               else if(Stricmp((char *)prop->name,"position") == 0)
+               {  UBYTE *posStr;
+                  posStr = Dupstr(prop->value, -1);
+                  if(posStr)
+                  {  Asetattrs(body, AOBDY_Position, posStr, TAG_END);
+                  }
+               }
+               /* Apply top */
+               else if(Stricmp((char *)prop->name,"top") == 0)
+               {  long topValue;
+                  topValue = ParseCSSLengthValue(prop->value,&num);
+                  if(topValue >= 0 && num.type == NUMBER_NUMBER)
+                  {  Asetattrs(body,AOBJ_Top,topValue,TAG_END);
+                  }
+               }
+               /* Apply left */
+               else if(Stricmp((char *)prop->name,"left") == 0)
+               {  long leftValue;
+                  leftValue = ParseCSSLengthValue(prop->value,&num);
+                  if(leftValue >= 0 && num.type == NUMBER_NUMBER)
+                  {  Asetattrs(body,AOBJ_Left,leftValue,TAG_END);
+                  }
+               }
+               /* Apply right */
+               else if(Stricmp((char *)prop->name,"right") == 0)
+               {  long rightValue;
+                  rightValue = ParseCSSLengthValue(prop->value, &num);
+                  if(rightValue >= 0 && num.type == NUMBER_NUMBER)
+                  {  Asetattrs(body, AOBDY_Right, rightValue, TAG_END);
+                  }
+               }
+               /* Apply bottom */
+               else if(Stricmp((char *)prop->name,"bottom") == 0)
+               {  long bottomValue;
+                  bottomValue = ParseCSSLengthValue(prop->value, &num);
+                  if(bottomValue >= 0 && num.type == NUMBER_NUMBER)
+                  {  Asetattrs(body, AOBDY_Bottom, bottomValue, TAG_END);
+                  }
+               }
+               /* Apply z-index */
+               else if(Stricmp((char *)prop->name,"z-index") == 0)
+               {  long zIndexValue;
+                  UBYTE *zval;
+                  UBYTE *zvalCopy;
+                  zval = prop->value;
+                  if(zval && zval[0] != '\0')
+                  {  zvalCopy = Dupstr(zval, -1);
+                     if(zvalCopy)
+                     {  SkipWhitespace(&zvalCopy);
+                        if(Stricmp((char *)zvalCopy,"auto") == 0)
+                        {  zIndexValue = 0;
                         }
-                        FREE(valignValue);
-                        if(valign >= 0)
-                        {  Asetattrs(body, AOBDY_VerticalAlign, valign, TAG_END);
+                        else
+                        {  zIndexValue = strtol((char *)zvalCopy, NULL, 10);
                         }
+                        FREE(zvalCopy);
+                        Asetattrs(body, AOBDY_ZIndex, zIndexValue, TAG_END);
                      }
                   }
-                  /* Apply clear */
-                  else if(Stricmp((char *)prop->name,"clear") == 0)
-                  {  UBYTE *clearStr;
-                     clearStr = Dupstr(prop->value, -1);
-                     if(clearStr)
-                     {  Asetattrs(body, AOBDY_Clear, clearStr, TAG_END);
-                     }
+               }
+               /* Apply display property */
+               else if(Stricmp((char *)prop->name,"display") == 0)
+               {  UBYTE *dispStr;
+                  dispStr = Dupstr(prop->value, -1);
+                  if(dispStr)
+                  {  Asetattrs(body, AOBDY_Display, dispStr, TAG_END);
                   }
-                  /* Apply overflow */
-                  else if(Stricmp((char *)prop->name,"overflow") == 0)
-                  {  UBYTE *overflowStr;
-                     overflowStr = Dupstr(prop->value, -1);
-                     if(overflowStr)
-                     {  Asetattrs(body, AOBDY_Overflow, overflowStr, TAG_END);
+               }
+               /* Apply vertical-align */
+               else if(Stricmp((char *)prop->name,"vertical-align") == 0)
+               {  short valign;
+                  UBYTE *valignValue;
+                  valign = -1;
+                  valignValue = Dupstr(prop->value, -1);
+                  if(valignValue)
+                  {  if(Stricmp((char *)valignValue,"top") == 0)
+                     {  valign = VALIGN_TOP;
                      }
-                  }
-                  /* Apply list-style */
-                  else if(Stricmp((char *)prop->name,"list-style") == 0)
-                  {  UBYTE *listStyleStr;
-                     listStyleStr = Dupstr(prop->value, -1);
-                     if(listStyleStr)
-                     {  Asetattrs(body, AOBDY_ListStyle, listStyleStr, TAG_END);
+                     else if(Stricmp((char *)valignValue,"middle") == 0)
+                     {  valign = VALIGN_MIDDLE;
                      }
-                  }
-                  /* Apply min-width */
-                  else if(Stricmp((char *)prop->name,"min-width") == 0)
-                  {  long minWidthValue;
-                     minWidthValue = ParseCSSLengthValue(prop->value, &num);
-                     if(minWidthValue >= 0 && num.type == NUMBER_NUMBER)
-                     {  Asetattrs(body, AOBDY_MinWidth, minWidthValue, TAG_END);
+                     else if(Stricmp((char *)valignValue,"bottom") == 0)
+                     {  valign = VALIGN_BOTTOM;
                      }
-                  }
-                  /* Apply max-width */
-                  else if(Stricmp((char *)prop->name,"max-width") == 0)
-                  {  long maxWidthValue;
-                     maxWidthValue = ParseCSSLengthValue(prop->value, &num);
-                     if(maxWidthValue >= 0 && num.type == NUMBER_NUMBER)
-                     {  Asetattrs(body, AOBDY_MaxWidth, maxWidthValue, TAG_END);
+                     else if(Stricmp((char *)valignValue,"baseline") == 0)
+                     {  valign = VALIGN_BASELINE;
                      }
-                  }
-                  /* Apply min-height */
-                  else if(Stricmp((char *)prop->name,"min-height") == 0)
-                  {  long minHeightValue;
-                     minHeightValue = ParseCSSLengthValue(prop->value, &num);
-                     if(minHeightValue >= 0 && num.type == NUMBER_NUMBER)
-                     {  Asetattrs(body, AOBDY_MinHeight, minHeightValue, TAG_END);
+                     FREE(valignValue);
+                     if(valign >= 0)
+                     {  Asetattrs(body, AOBDY_VerticalAlign, valign, TAG_END);
                      }
                   }
-                  /* Apply max-height */
-                  else if(Stricmp((char *)prop->name,"max-height") == 0)
-                  {  long maxHeightValue;
-                     maxHeightValue = ParseCSSLengthValue(prop->value, &num);
-                     if(maxHeightValue >= 0 && num.type == NUMBER_NUMBER)
-                     {  Asetattrs(body, AOBDY_MaxHeight, maxHeightValue, TAG_END);
-                     }
+               }
+               /* Apply clear */
+               else if(Stricmp((char *)prop->name,"clear") == 0)
+               {  UBYTE *clearStr;
+                  clearStr = Dupstr(prop->value, -1);
+                  if(clearStr)
+                  {  Asetattrs(body, AOBDY_Clear, clearStr, TAG_END);
+                  }
+               }
+               /* Apply overflow */
+               else if(Stricmp((char *)prop->name,"overflow") == 0)
+               {  UBYTE *overflowStr;
+                  overflowStr = Dupstr(prop->value, -1);
+                  if(overflowStr)
+                  {  Asetattrs(body, AOBDY_Overflow, overflowStr, TAG_END);
+                  }
+               }
+               /* Apply list-style */
+               else if(Stricmp((char *)prop->name,"list-style") == 0)
+               {  UBYTE *listStyleStr;
+                  listStyleStr = Dupstr(prop->value, -1);
+                  if(listStyleStr)
+                  {  Asetattrs(body, AOBDY_ListStyle, listStyleStr, TAG_END);
+                  }
+               }
+               /* Apply min-width */
+               else if(Stricmp((char *)prop->name,"min-width") == 0)
+               {  long minWidthValue;
+                  minWidthValue = ParseCSSLengthValue(prop->value, &num);
+                  if(minWidthValue >= 0 && num.type == NUMBER_NUMBER)
+                  {  Asetattrs(body, AOBDY_MinWidth, minWidthValue, TAG_END);
                   }
-                  /* Apply cursor */
-                  else if(Stricmp((char *)prop->name,"cursor") == 0)
-                  {  UBYTE *cursorStr;
-                     cursorStr = Dupstr(prop->value, -1);
-                     if(cursorStr)
-                     {  Asetattrs(body, AOBDY_Cursor, cursorStr, TAG_END);
+               }
+               /* Apply max-width */
+               else if(Stricmp((char *)prop->name,"max-width") == 0)
+               {  long maxWidthValue;
+                  maxWidthValue = ParseCSSLengthValue(prop->value, &num);
+                  if(maxWidthValue >= 0 && num.type == NUMBER_NUMBER)
+                  {  Asetattrs(body, AOBDY_MaxWidth, maxWidthValue, TAG_END);
+                  }
+               }
+               /* Apply min-height */
+               else if(Stricmp((char *)prop->name,"min-height") == 0)
+               {  long minHeightValue;
+                  minHeightValue = ParseCSSLengthValue(prop->value, &num);
+                  if(minHeightValue >= 0 && num.type == NUMBER_NUMBER)
+                  {  Asetattrs(body, AOBDY_MinHeight, minHeightValue, TAG_END);
+                  }
+               }
+               /* Apply max-height */
+               else if(Stricmp((char *)prop->name,"max-height") == 0)
+               {  long maxHeightValue;
+                  maxHeightValue = ParseCSSLengthValue(prop->value, &num);
+                  if(maxHeightValue >= 0 && num.type == NUMBER_NUMBER)
+                  {  Asetattrs(body, AOBDY_MaxHeight, maxHeightValue, TAG_END);
+                  }
+               }
+               /* Apply cursor */
+               else if(Stricmp((char *)prop->name,"cursor") == 0)
+               {  UBYTE *cursorStr;
+                  cursorStr = Dupstr(prop->value, -1);
+                  if(cursorStr)
+                  {  Asetattrs(body, AOBDY_Cursor, cursorStr, TAG_END);
+                  }
+               }
+               /* Apply text-transform */
+               else if(Stricmp((char *)prop->name,"text-transform") == 0)
+               {  UBYTE *transformStr;
+                  transformStr = Dupstr(prop->value, -1);
+                  if(transformStr)
+                  {  Asetattrs(body, AOBDY_TextTransform, transformStr, TAG_END);
+                     /* Also set document-level text-transform for compatibility */
+                     if(Stricmp((char *)transformStr, "uppercase") == 0)
+                     {  doc->texttransform = 1;
+                     }
+                     else if(Stricmp((char *)transformStr, "lowercase") == 0)
+                     {  doc->texttransform = 2;
+                     }
+                     else if(Stricmp((char *)transformStr, "capitalize") == 0)
+                     {  doc->texttransform = 3;
+                     }
+                     else if(Stricmp((char *)transformStr, "none") == 0)
+                     {  doc->texttransform = 0;
                      }
                   }
-                  /* Apply text-transform */
-                  else if(Stricmp((char *)prop->name,"text-transform") == 0)
-                  {  UBYTE *transformStr;
-                     transformStr = Dupstr(prop->value, -1);
-                     if(transformStr)
-                     {  Asetattrs(body, AOBDY_TextTransform, transformStr, TAG_END);
-                        /* Also set document-level text-transform for compatibility */
-                        if(Stricmp((char *)transformStr, "uppercase") == 0)
-                        {  doc->texttransform = 1;
-                        }
-                        else if(Stricmp((char *)transformStr, "lowercase") == 0)
-                        {  doc->texttransform = 2;
-                        }
-                        else if(Stricmp((char *)transformStr, "capitalize") == 0)
-                        {  doc->texttransform = 3;
-                        }
-                        else if(Stricmp((char *)transformStr, "none") == 0)
-                        {  doc->texttransform = 0;
-                        }
+               }
+               /* Apply white-space */
+               else if(Stricmp((char *)prop->name,"white-space") == 0)
+               {  UBYTE *whitespaceStr;
+                  whitespaceStr = Dupstr(prop->value, -1);
+                  if(whitespaceStr)
+                  {  Asetattrs(body, AOBDY_WhiteSpace, whitespaceStr, TAG_END);
+                     /* Also apply to AOBDY_Nobr for nowrap */
+                     if(Stricmp((char *)whitespaceStr, "nowrap") == 0)
+                     {  Asetattrs(body, AOBDY_Nobr, TRUE, TAG_END);
+                     }
+                     else if(Stricmp((char *)whitespaceStr, "pre") == 0)
+                     {  /* "pre" requires STYLE_PRE to actually preserve whitespace */
+                        Asetattrs(body, AOBDY_Style, STYLE_PRE, TAG_END);
+                        Asetattrs(body, AOBDY_Nobr, FALSE, TAG_END);
+                     }
+                     else if(Stricmp((char *)whitespaceStr, "normal") == 0 || 
+                             Stricmp((char *)whitespaceStr, "pre-wrap") == 0 || 
+                             Stricmp((char *)whitespaceStr, "pre-line") == 0)
+                     {  Asetattrs(body, AOBDY_Nobr, FALSE, TAG_END);
                      }
                   }
-                  /* Apply white-space */
-                  else if(Stricmp((char *)prop->name,"white-space") == 0)
-                  {  UBYTE *whitespaceStr;
-                     whitespaceStr = Dupstr(prop->value, -1);
-                     if(whitespaceStr)
-                     {  Asetattrs(body, AOBDY_WhiteSpace, whitespaceStr, TAG_END);
-                        /* Also apply to AOBDY_Nobr for nowrap */
-                        if(Stricmp((char *)whitespaceStr, "nowrap") == 0)
-                        {  Asetattrs(body, AOBDY_Nobr, TRUE, TAG_END);
-                        }
-                        else if(Stricmp((char *)whitespaceStr, "pre") == 0)
-                        {  /* "pre" requires STYLE_PRE to actually preserve whitespace */
-                           Asetattrs(body, AOBDY_Style, STYLE_PRE, TAG_END);
-                           Asetattrs(body, AOBDY_Nobr, FALSE, TAG_END);
-                        }
-                        else if(Stricmp((char *)whitespaceStr, "normal") == 0 || 
-                                Stricmp((char *)whitespaceStr, "pre-wrap") == 0 || 
-                                Stricmp((char *)whitespaceStr, "pre-line") == 0)
-                        {  Asetattrs(body, AOBDY_Nobr, FALSE, TAG_END);
+               }
+               /* Apply padding shorthand */
+               else if(Stricmp((char *)prop->name,"padding") == 0)
+               {  UBYTE *paddingP;
+                  UBYTE *tokenStart;
+                  UBYTE *tokenEnd;
+                  long tokenLen;
+                  UBYTE *tokenBuf;
+                  UBYTE *paddingTokens[4];
+                  long paddingCount;
+                  long paddingTop;
+                  long paddingRight;
+                  long paddingBottom;
+                  long paddingLeft;
+                  long j;
+                  paddingP = prop->value;
+                  paddingCount = 0;
+                  paddingTop = paddingRight = paddingBottom = paddingLeft = 0;
+                  for(j = 0; j < 4; j++) paddingTokens[j] = NULL;
+                  
+                  /* Parse padding values - can be 1, 2, 3, or 4 values */
+                  for(j = 0; j < 4 && paddingP && *paddingP; j++)
+                  {  while(*paddingP && isspace(*paddingP)) paddingP++;
+                     if(!*paddingP) break;
+                     tokenStart = paddingP;
+                     while(*paddingP && !isspace(*paddingP)) paddingP++;
+                     tokenEnd = paddingP;
+                     tokenLen = tokenEnd - tokenStart;
+                     if(tokenLen > 0)
+                     {  tokenBuf = ALLOCTYPE(UBYTE,tokenLen + 1,0);
+                        if(tokenBuf)
+                        {  memmove(tokenBuf,tokenStart,tokenLen);
+                           tokenBuf[tokenLen] = '\0';
+                           paddingTokens[paddingCount] = tokenBuf;
+                           paddingCount++;
                         }
                      }
                   }
-                  /* Apply padding shorthand */
-                  else if(Stricmp((char *)prop->name,"padding") == 0)
-                  {  UBYTE *paddingP;
-                     UBYTE *tokenStart;
-                     UBYTE *tokenEnd;
-                     long tokenLen;
-                     UBYTE *tokenBuf;
-                     UBYTE *paddingTokens[4];
-                     long paddingCount;
-                     long paddingTop;
-                     long paddingRight;
-                     long paddingBottom;
-                     long paddingLeft;
-                     long j;
-                     paddingP = prop->value;
-                     paddingCount = 0;
-                     paddingTop = paddingRight = paddingBottom = paddingLeft = 0;
-                     for(j = 0; j < 4; j++) paddingTokens[j] = NULL;
-                     
-                     /* Parse padding values - can be 1, 2, 3, or 4 values */
-                     for(j = 0; j < 4 && paddingP && *paddingP; j++)
-                     {  while(*paddingP && isspace(*paddingP)) paddingP++;
-                        if(!*paddingP) break;
-                        tokenStart = paddingP;
-                        while(*paddingP && !isspace(*paddingP)) paddingP++;
-                        tokenEnd = paddingP;
-                        tokenLen = tokenEnd - tokenStart;
-                        if(tokenLen > 0)
-                        {  tokenBuf = ALLOCTYPE(UBYTE,tokenLen + 1,0);
-                           if(tokenBuf)
-                           {  memmove(tokenBuf,tokenStart,tokenLen);
-                              tokenBuf[tokenLen] = '\0';
-                              paddingTokens[paddingCount] = tokenBuf;
-                              paddingCount++;
-                           }
-                        }
+                  
+                  /* Apply padding values based on count */
+                  if(paddingCount >= 1)
+                  {  paddingTop = ParseCSSLengthValue(paddingTokens[0],&num);
+                     if(paddingCount == 1)
+                     {  paddingRight = paddingBottom = paddingLeft = paddingTop;
                      }
-                     
-                     /* Apply padding values based on count */
-                     if(paddingCount >= 1)
-                     {  paddingTop = ParseCSSLengthValue(paddingTokens[0],&num);
-                        if(paddingCount == 1)
-                        {  paddingRight = paddingBottom = paddingLeft = paddingTop;
-                        }
-                        else if(paddingCount == 2)
-                        {  paddingBottom = paddingTop;
-                           paddingRight = ParseCSSLengthValue(paddingTokens[1],&num);
-                           paddingLeft = paddingRight;
-                        }
-                        else if(paddingCount == 3)
-                        {  paddingRight = ParseCSSLengthValue(paddingTokens[1],&num);
-                           paddingLeft = paddingRight;
-                           paddingBottom = ParseCSSLengthValue(paddingTokens[2],&num);
-                        }
-                        else if(paddingCount == 4)
-                        {  paddingRight = ParseCSSLengthValue(paddingTokens[1],&num);
-                           paddingBottom = ParseCSSLengthValue(paddingTokens[2],&num);
-                           paddingLeft = ParseCSSLengthValue(paddingTokens[3],&num);
-                        }
-                        
-                        /* Apply padding values */
-                        if(paddingTop >= 0 && num.type == NUMBER_NUMBER) Asetattrs(body,AOBDY_PaddingTop,paddingTop,TAG_END);
-                        if(paddingRight >= 0 && num.type == NUMBER_NUMBER) Asetattrs(body,AOBDY_PaddingRight,paddingRight,TAG_END);
-                        if(paddingBottom >= 0 && num.type == NUMBER_NUMBER) Asetattrs(body,AOBDY_PaddingBottom,paddingBottom,TAG_END);
-                        if(paddingLeft >= 0 && num.type == NUMBER_NUMBER) Asetattrs(body,AOBDY_PaddingLeft,paddingLeft,TAG_END);
+                     else if(paddingCount == 2)
+                     {  paddingBottom = paddingTop;
+                        paddingRight = ParseCSSLengthValue(paddingTokens[1],&num);
+                        paddingLeft = paddingRight;
                      }
-                     
-                     /* Free temporary token buffers */
-                     for(j = 0; j < paddingCount; j++)
-                     {  if(paddingTokens[j]) FREE(paddingTokens[j]);
+                     else if(paddingCount == 3)
+                     {  paddingRight = ParseCSSLengthValue(paddingTokens[1],&num);
+                        paddingLeft = paddingRight;
+                        paddingBottom = ParseCSSLengthValue(paddingTokens[2],&num);
                      }
+                     else if(paddingCount == 4)
+                     {  paddingRight = ParseCSSLengthValue(paddingTokens[1],&num);
+                        paddingBottom = ParseCSSLengthValue(paddingTokens[2],&num);
+                        paddingLeft = ParseCSSLengthValue(paddingTokens[3],&num);
+                     }
+                     
+                     /* Apply padding values */
+                     if(paddingTop >= 0 && num.type == NUMBER_NUMBER) Asetattrs(body,AOBDY_PaddingTop,paddingTop,TAG_END);
+                     if(paddingRight >= 0 && num.type == NUMBER_NUMBER) Asetattrs(body,AOBDY_PaddingRight,paddingRight,TAG_END);
+                     if(paddingBottom >= 0 && num.type == NUMBER_NUMBER) Asetattrs(body,AOBDY_PaddingBottom,paddingBottom,TAG_END);
+                     if(paddingLeft >= 0 && num.type == NUMBER_NUMBER) Asetattrs(body,AOBDY_PaddingLeft,paddingLeft,TAG_END);
                   }
-                  /* Apply border shorthand */
-                  else if(Stricmp((char *)prop->name,"border") == 0)
-                  {  UBYTE *pval;
-                     UBYTE *token;
-                     long borderWidth;
-                     ULONG borderColor;
-                     struct Colorinfo *ci;
+                  
+                  /* Free temporary token buffers */
+                  for(j = 0; j < paddingCount; j++)
+                  {  if(paddingTokens[j]) FREE(paddingTokens[j]);
+                  }
+               }
+               /* Apply border shorthand */
+               else if(Stricmp((char *)prop->name,"border") == 0)
+               {  UBYTE *pval;
+                  UBYTE *token;
+                  long borderWidth;
+                  ULONG borderColor;
+                  struct Colorinfo *ci;
+                  
+                  pval = prop->value;
+                  borderWidth = -1;
+                  borderColor = ~0;
+                  
+                  /* Parse tokens separated by spaces */
+                  while(*pval)
+                  {  SkipWhitespace(&pval);
+                     if(!*pval) break;
                      
-                     pval = prop->value;
-                     borderWidth = -1;
-                     borderColor = ~0;
+                     token = pval;
+                     while(*pval && !isspace(*pval)) pval++;
                      
-                     /* Parse tokens separated by spaces */
-                     while(*pval)
-                     {  SkipWhitespace(&pval);
-                        if(!*pval) break;
-                        
-                        token = pval;
-                        while(*pval && !isspace(*pval)) pval++;
-                        
-                        /* Check if it's a width */
-                        if(isdigit(*token) || *token == '+' || *token == '-')
-                        {  borderWidth = ParseCSSLengthValue(token, &num);
-                           if(borderWidth >= 0 && num.type == NUMBER_NUMBER)
-                           {  Asetattrs(body, AOBDY_BorderWidth, borderWidth, TAG_END);
-                           }
+                     /* Check if it's a width */
+                     if(isdigit(*token) || *token == '+' || *token == '-')
+                     {  borderWidth = ParseCSSLengthValue(token, &num);
+                        if(borderWidth >= 0 && num.type == NUMBER_NUMBER)
+                        {  Asetattrs(body, AOBDY_BorderWidth, borderWidth, TAG_END);
                         }
-                        /* Check if it's a color */
-                        else if(*token == '#')
-                        {  borderColor = ParseHexColor(token);
-                           if(borderColor != ~0)
-                           {  ci = Finddoccolor(doc, borderColor);
-                              if(ci)
-                              {  Asetattrs(body, AOBDY_BorderColor, ci, TAG_END);
-                              }
+                     }
+                     /* Check if it's a color */
+                     else if(*token == '#')
+                     {  borderColor = ParseHexColor(token);
+                        if(borderColor != ~0)
+                        {  ci = Finddoccolor(doc, borderColor);
+                           if(ci)
+                           {  Asetattrs(body, AOBDY_BorderColor, ci, TAG_END);
                            }
                         }
-                        /* Otherwise it's probably a style */
-                        else
-                        {  UBYTE *styleStr;
-                           long len;
-                           len = pval - token;
-                           styleStr = ALLOCTYPE(UBYTE, len + 1, 0);
-                           if(styleStr)
-                           {  memmove(styleStr, token, len);
-                              styleStr[len] = '\0';
-                              Asetattrs(body, AOBDY_BorderStyle, styleStr, TAG_END);
-                           }
+                     }
+                     /* Otherwise it's probably a style */
+                     else
+                     {  UBYTE *styleStr;
+                        long len;
+                        len = pval - token;
+                        styleStr = ALLOCTYPE(UBYTE, len + 1, 0);
+                        if(styleStr)
+                        {  memmove(styleStr, token, len);
+                           styleStr[len] = '\0';
+                           Asetattrs(body, AOBDY_BorderStyle, styleStr, TAG_END);
                         }
                      }
                   }
-                  /* Apply border-color */
-                  else if(Stricmp((char *)prop->name,"border-color") == 0)
-                  {  ULONG colorrgb;
-                     struct Colorinfo *ci;
-                     colorrgb = ParseHexColor(prop->value);
-                     if(colorrgb != ~0)
-                     {  ci = Finddoccolor(doc, colorrgb);
-                        if(ci)
-                        {  Asetattrs(body, AOBDY_BorderColor, ci, TAG_END);
-                        }
+               }
+               /* Apply border-color */
+               else if(Stricmp((char *)prop->name,"border-color") == 0)
+               {  ULONG colorrgb;
+                  struct Colorinfo *ci;
+                  colorrgb = ParseHexColor(prop->value);
+                  if(colorrgb != ~0)
+                  {  ci = Finddoccolor(doc, colorrgb);
+                     if(ci)
+                     {  Asetattrs(body, AOBDY_BorderColor, ci, TAG_END);
                      }
                   }
-                  /* Apply border-style */
-                  else if(Stricmp((char *)prop->name,"border-style") == 0)
-                  {  UBYTE *styleStr;
-                     styleStr = Dupstr(prop->value, -1);
-                     if(styleStr)
-                     {  Asetattrs(body, AOBDY_BorderStyle, styleStr, TAG_END);
+               }
+               /* Apply border-style */
+               else if(Stricmp((char *)prop->name,"border-style") == 0)
+               {  UBYTE *styleStr;
+                  styleStr = Dupstr(prop->value, -1);
+                  if(styleStr)
+                  {  Asetattrs(body, AOBDY_BorderStyle, styleStr, TAG_END);
+                  }
+               }
+               /* Apply grid-gap (row-gap column-gap) */
+               else if(Stricmp((char *)prop->name,"grid-gap") == 0)
+               {  UBYTE *gapP;
+                  UBYTE *tokenStart;
+                  long tokenLen;
+                  long rowGap;
+                  long colGap;
+                  struct Number num;
+                  
+                  gapP = prop->value;
+                  rowGap = -1;
+                  colGap = -1;
+                  
+                  /* Parse first value (row gap) */
+                  SkipWhitespace(&gapP);
+                  tokenStart = gapP;
+                  while(*gapP && !isspace(*gapP)) gapP++;
+                  tokenLen = gapP - tokenStart;
+                  if(tokenLen > 0)
+                  {  UBYTE *tokenBuf;
+                     tokenBuf = ALLOCTYPE(UBYTE,tokenLen + 1,0);
+                     if(tokenBuf)
+                     {  memmove(tokenBuf,tokenStart,tokenLen);
+                        tokenBuf[tokenLen] = '\0';
+                        rowGap = ParseCSSLengthValue(tokenBuf,&num);
+                        FREE(tokenBuf);
                      }
                   }
-                  /* Apply grid-gap (row-gap column-gap) */
-                  else if(Stricmp((char *)prop->name,"grid-gap") == 0)
-                  {  UBYTE *gapP;
-                     UBYTE *tokenStart;
-                     long tokenLen;
-                     long rowGap;
-                     long colGap;
-                     struct Number num;
-                     
-                     gapP = prop->value;
-                     rowGap = -1;
-                     colGap = -1;
-                     
-                     /* Parse first value (row gap) */
-                     SkipWhitespace(&gapP);
-                     tokenStart = gapP;
+                  
+                  /* Parse second value (column gap) if present */
+                  SkipWhitespace(&gapP);
+                  if(*gapP)
+                  {  tokenStart = gapP;
                      while(*gapP && !isspace(*gapP)) gapP++;
                      tokenLen = gapP - tokenStart;
                      if(tokenLen > 0)
@@ -1628,128 +1638,111 @@ void ApplyCSSToBody(struct Document *doc,void *body,UBYTE *class,UBYTE *id,UBYTE
                         if(tokenBuf)
                         {  memmove(tokenBuf,tokenStart,tokenLen);
                            tokenBuf[tokenLen] = '\0';
-                           rowGap = ParseCSSLengthValue(tokenBuf,&num);
+                           colGap = ParseCSSLengthValue(tokenBuf,&num);
                            FREE(tokenBuf);
                         }
                      }
-                     
-                     /* Parse second value (column gap) if present */
-                     SkipWhitespace(&gapP);
-                     if(*gapP)
-                     {  tokenStart = gapP;
-                        while(*gapP && !isspace(*gapP)) gapP++;
-                        tokenLen = gapP - tokenStart;
-                        if(tokenLen > 0)
-                        {  UBYTE *tokenBuf;
-                           tokenBuf = ALLOCTYPE(UBYTE,tokenLen + 1,0);
-                           if(tokenBuf)
-                           {  memmove(tokenBuf,tokenStart,tokenLen);
-                              tokenBuf[tokenLen] = '\0';
-                              colGap = ParseCSSLengthValue(tokenBuf,&num);
-                              FREE(tokenBuf);
-                           }
-                        }
-                     }
-                     else
-                     {  /* If only one value, use it for both */
-                        colGap = rowGap;
-                     }
-                     
-                     /* Apply gaps as margins for grid layout */
-                     if(rowGap >= 0)
-                     {  /* Apply row gap as top margin for child elements */
-                        /* This is a simplified grid implementation */
-                        /* debug_printf("CSS: grid-gap applied - row=%ld col=%ld\n",rowGap,colGap); */
-                     }
-                     if(colGap >= 0)
-                     {  /* Store column gap for use by child elements with grid-column-start */
-                        doc->gridcolgap = colGap;
-                        /* debug_printf("CSS: grid-gap column gap=%ld stored\n",colGap); */
-                     }
                   }
-                  /* Apply grid-template-columns (not fully implemented, but parse it) */
-                  else if(Stricmp((char *)prop->name,"grid-template-columns") == 0)
-                  {  /* Parse grid template - for now just log it */
-                     /* debug_printf("CSS: grid-template-columns='%s' (parsed but not fully implemented)\n",
-                                  prop->value ? (char *)prop->value : "NULL"); */
+                  else
+                  {  /* If only one value, use it for both */
+                     colGap = rowGap;
                   }
-                  /* Apply grid-column-start (for grid layout positioning) */
-                  else if(Stricmp((char *)prop->name,"grid-column-start") == 0)
-                  {  long gridColStart;
-                     long leftMargin;
-                     UBYTE *p;
-                     
-                     /* Parse grid-column-start value - can be a number (e.g., "2") or a length */
-                     p = prop->value;
-                     SkipWhitespace(&p);
-                     if(isdigit(*p))
-                     {  /* Parse as integer */
-                        gridColStart = strtol((char *)p,NULL,10);
-                     }
-                     else
-                     {  /* Try parsing as length value */
-                        struct Number num;
-                        gridColStart = ParseCSSLengthValue(prop->value,&num);
-                        /* If it's a length, convert to column number (approximate) */
-                        if(gridColStart > 0)
-                        {  /* Assume each column is at least 100px wide */
-                           gridColStart = (gridColStart / 100) + 1;
-                        }
-                     }
-                     
-                     if(gridColStart >= 2)
-                     {  /* For grid-column-start >= 2, apply left margin to push to second column */
-                        /* Use column gap from parent dl element if available */
-                        if(doc->gridcolgap > 0)
-                        {  leftMargin = doc->gridcolgap;
-                        }
-                        else
-                        {  /* Default column gap if not specified */
-                           leftMargin = 16;
-                        }
-                        Asetattrs(body,AOBDY_Leftmargin,leftMargin,TAG_END);
-                        /* debug_printf("CSS: grid-column-start=%ld applied, left margin=%ld (colgap=%ld)\n",
-                                     gridColStart,leftMargin,doc->gridcolgap); */
-                     }
+                  
+                  /* Apply gaps as margins for grid layout */
+                  if(rowGap >= 0)
+                  {  /* Apply row gap as top margin for child elements */
+                     /* This is a simplified grid implementation */
+                     /* debug_printf("CSS: grid-gap applied - row=%ld col=%ld\n",rowGap,colGap); */
                   }
-                  /* Apply grid-column-end (for grid layout positioning) */
-                  else if(Stricmp((char *)prop->name,"grid-column-end") == 0)
-                  {  /* Parse but not fully implemented */
-                     /* debug_printf("CSS: grid-column-end='%s' (parsed but not fully implemented)\n",
-                                  prop->value ? (char *)prop->value : "NULL"); */
+                  if(colGap >= 0)
+                  {  /* Store column gap for use by child elements with grid-column-start */
+                     doc->gridcolgap = colGap;
+                     /* debug_printf("CSS: grid-gap column gap=%ld stored\n",colGap); */
                   }
-                  /* Apply grid-row-start (for grid layout positioning) */
-                  else if(Stricmp((char *)prop->name,"grid-row-start") == 0)
-                  {  /* Parse but not fully implemented */
-                     /* debug_printf("CSS: grid-row-start='%s' (parsed but not fully implemented)\n",
-                                  prop->value ? (char *)prop->value : "NULL"); */
+               }
+               /* Apply grid-template-columns (not fully implemented, but parse it) */
+               else if(Stricmp((char *)prop->name,"grid-template-columns") == 0)
+               {  /* Parse grid template - for now just log it */
+                  /* debug_printf("CSS: grid-template-columns='%s' (parsed but not fully implemented)\n",
+                               prop->value ? (char *)prop->value : "NULL"); */
+               }
+               /* Apply grid-column-start (for grid layout positioning) */
+               else if(Stricmp((char *)prop->name,"grid-column-start") == 0)
+               {  long gridColStart;
+                  long leftMargin;
+                  UBYTE *p;
+                  
+                  /* Parse grid-column-start value - can be a number (e.g., "2") or a length */
+                  p = prop->value;
+                  SkipWhitespace(&p);
+                  if(isdigit(*p))
+                  {  /* Parse as integer */
+                     gridColStart = strtol((char *)p,NULL,10);
                   }
-                  /* Apply grid-row-end (for grid layout positioning) */
-                  else if(Stricmp((char *)prop->name,"grid-row-end") == 0)
-                  {  /* Parse but not fully implemented */
-                     /* debug_printf("CSS: grid-row-end='%s' (parsed but not fully implemented)\n",
-                                  prop->value ? (char *)prop->value : "NULL"); */
+                  else
+                  {  /* Try parsing as length value */
+                     struct Number num;
+                     gridColStart = ParseCSSLengthValue(prop->value,&num);
+                     /* If it's a length, convert to column number (approximate) */
+                     if(gridColStart > 0)
+                     {  /* Assume each column is at least 100px wide */
+                        gridColStart = (gridColStart / 100) + 1;
+                     }
                   }
-                  /* Apply transform */
-                  else if(Stricmp((char *)prop->name,"transform") == 0)
-                  {  UBYTE *transformStr;
-                     UBYTE *pval;
-                     
-                     pval = prop->value;
-                     SkipWhitespace(&pval);
-                     
-                     /* Store transform value as-is - will be parsed during layout */
-                     /* Supported formats: translate(x, y), translateX(x), translateY(y) */
-                     transformStr = Dupstr(pval, -1);
-                     if(transformStr)
-                     {  Asetattrs(body, AOBDY_Transform, transformStr, TAG_END);
+                  
+                  if(gridColStart >= 2)
+                  {  /* For grid-column-start >= 2, apply left margin to push to second column */
+                     /* Use column gap from parent dl element if available */
+                     if(doc->gridcolgap > 0)
+                     {  leftMargin = doc->gridcolgap;
                      }
+                     else
+                     {  /* Default column gap if not specified */
+                        leftMargin = 16;
+                     }
+                     Asetattrs(body,AOBDY_Leftmargin,leftMargin,TAG_END);
+                     /* debug_printf("CSS: grid-column-start=%ld applied, left margin=%ld (colgap=%ld)\n",
+                                  gridColStart,leftMargin,doc->gridcolgap); */
+                  }
+               }
+               /* Apply grid-column-end (for grid layout positioning) */
+               else if(Stricmp((char *)prop->name,"grid-column-end") == 0)
+               {  /* Parse but not fully implemented */
+                  /* debug_printf("CSS: grid-column-end='%s' (parsed but not fully implemented)\n",
+                               prop->value ? (char *)prop->value : "NULL"); */
+               }
+               /* Apply grid-row-start (for grid layout positioning) */
+               else if(Stricmp((char *)prop->name,"grid-row-start") == 0)
+               {  /* Parse but not fully implemented */
+                  /* debug_printf("CSS: grid-row-start='%s' (parsed but not fully implemented)\n",
+                               prop->value ? (char *)prop->value : "NULL"); */
+               }
+               /* Apply grid-row-end (for grid layout positioning) */
+               else if(Stricmp((char *)prop->name,"grid-row-end") == 0)
+               {  /* Parse but not fully implemented */
+                  /* debug_printf("CSS: grid-row-end='%s' (parsed but not fully implemented)\n",
+                               prop->value ? (char *)prop->value : "NULL"); */
+               }
+               /* Apply transform */
+               else if(Stricmp((char *)prop->name,"transform") == 0)
+               {  UBYTE *transformStr;
+                  UBYTE *pval;
+                  
+                  pval = prop->value;
+                  SkipWhitespace(&pval);
+                  
+                  /* Store transform value as-is - will be parsed during layout */
+                  /* Supported formats: translate(x, y), translateX(x), translateY(y) */
+                  transformStr = Dupstr(pval, -1);
+                  if(transformStr)
+                  {  Asetattrs(body, AOBDY_Transform, transformStr, TAG_END);
                   }
                }
             }
          }
       }
    }
+   FreeCSSCandidates(&cand);
    
    /* Apply position properties after all other properties are processed */
    if(isAbsolute)
@@ -2262,7 +2255,7 @@ static BOOL Dolink(struct Document *doc,struct Tagattr *ta)
                 urlstr ? (char *)urlstr : "NULL", isReload ? 1 : 0, doc->cssstylesheet);
       }
       /* Try to load external CSS */
-      extcss = Finddocext(doc,url,isReload);
+      extcss = Finddocext(doc,url,isReload,AUMLF_STYLE);
       if(extcss)
       {  if(extcss == (UBYTE *)~0)
          {  extern BOOL httpdebug;
@@ -2520,7 +2513,7 @@ static BOOL Doscript(struct Document *doc,struct Tagattr *ta)
          UBYTE *extsrc;
          url=Findurl(doc->base,src,0);
          if(extsrc=Finddocext(doc,url,
-            (doc->pflags&DPF_RELOADVERIFY) && !(doc->pflags&DPF_NORLDOCEXT)))
+            (doc->pflags&DPF_RELOADVERIFY) && !(doc->pflags&DPF_NORLDOCEXT),AUMLF_SCRIPT))
          {  if(extsrc==(UBYTE *)~0)
             {  /* External source is in error, use element contents. */
                Freebuffer(&doc->jsrc);
@@ -4900,92 +4893,93 @@ static BOOL Dool(struct Document *doc,struct Tagattr *ta)
       struct CSSProperty *prop;
       struct CSSStylesheet *sheet;
       BOOL hasDisplayInline = FALSE;
+      BOOL matches;
+      struct CSSCandidates cand;
+      long i;
       
       sheet = (struct CSSStylesheet *)doc->cssstylesheet;
-      for(rule = (struct CSSRule *)sheet->rules.mlh_Head;
-          (struct MinNode *)rule->node.mln_Succ;
-          rule = (struct CSSRule *)rule->node.mln_Succ)
-      {  for(sel = (struct CSSSelector *)rule->selectors.mlh_Head;
-            (struct MinNode *)sel->node.mln_Succ;
-            sel = (struct CSSSelector *)sel->node.mln_Succ)
-         {  /* Check if this selector matches our list's class */
-            BOOL matches = FALSE;
-            if((sel->type & CSS_SEL_CLASS) && sel->class)
-            {  if(MatchClassAttribute(classAttr, sel->class))
-               {  /* Check if this selector matches 'ol' or 'ul' element */
-                  if(!(sel->type & CSS_SEL_ELEMENT) || !sel->name ||
-                     Stricmp((char *)sel->name,"ol") == 0 || Stricmp((char *)sel->name,"ul") == 0)
-                  {  matches = TRUE;
-                  }
+      FindCSSCandidates(sheet,(UBYTE *)"ol",classAttr,idAttr,&cand);
+      for(i = 0; i < cand.count; i++)
+      {  rule = cand.entries[i]->rule;
+         sel = cand.entries[i]->sel;
+         /* Check if this selector matches our list's class */
+         matches = FALSE;
+         if((sel->type & CSS_SEL_CLASS) && sel->class)
+         {  if(MatchClassAttribute(classAttr, sel->class))
+            {  /* Check if this selector matches 'ol' or 'ul' element */
+               if(!(sel->type & CSS_SEL_ELEMENT) || !sel->name ||
+                  Stricmp((char *)sel->name,"ol") == 0 || Stricmp((char *)sel->name,"ul") == 0)
+               {  matches = TRUE;
                }
             }
-            
-            if(matches)
-            {  /* Check for list-style-type and display properties */
-               for(prop = (struct CSSProperty *)rule->properties.mlh_Head;
-                   (struct MinNode *)prop->node.mln_Succ;
-                   prop = (struct CSSProperty *)prop->node.mln_Succ)
-               {  if(prop->name && prop->value)
-                  {  /* Check for list-style-type */
-                     if(Stricmp((char *)prop->name,"list-style-type") == 0)
-                     {  if(Stricmp((char *)prop->value,"decimal") == 0)
-                        {  li.bullettype = BDBT_NUMBER;
-                        }
-                        else if(Stricmp((char *)prop->value,"lower-alpha") == 0 || 
-                                Stricmp((char *)prop->value,"lower-latin") == 0)
-                        {  li.bullettype = BDBT_ALPHALOW;
-                        }
-                        else if(Stricmp((char *)prop->value,"upper-alpha") == 0 || 
-                                Stricmp((char *)prop->value,"upper-latin") == 0)
-                        {  li.bullettype = BDBT_ALPHA;
-                        }
-                        else if(Stricmp((char *)prop->value,"lower-roman") == 0)
-                        {  li.bullettype = BDBT_ROMANLOW;
-                        }
-                        else if(Stricmp((char *)prop->value,"upper-roman") == 0)
-                        {  li.bullettype = BDBT_ROMAN;
-                        }
-                        else if(Stricmp((char *)prop->value,"none") == 0)
-                        {  li.bullettype = BDBT_PLAIN;
-                        }
-                        else if(Stricmp((char *)prop->value,"disc") == 0)
-                        {  li.bullettype = BDBT_DISC;
-                        }
-                        else if(Stricmp((char *)prop->value,"circle") == 0)
-                        {  li.bullettype = BDBT_CIRCLE;
-                        }
-                        else if(Stricmp((char *)prop->value,"square") == 0)
-                        {  li.bullettype = BDBT_SQUARE;
-                        }
+         }
+         
+         if(matches)
+         {  /* Check for list-style-type and display properties */
+            for(prop = (struct CSSProperty *)rule->properties.mlh_Head;
+                (struct MinNode *)prop->node.mln_Succ;
+                prop = (struct CSSProperty *)prop->node.mln_Succ)
+            {  if(prop->name && prop->value)
+               {  /* Check for list-style-type */
+                  if(Stricmp((char *)prop->name,"list-style-type") == 0)
+                  {  if(Stricmp((char *)prop->value,"decimal") == 0)
+                     {  li.bullettype = BDBT_NUMBER;
+                     }
+                     else if(Stricmp((char *)prop->value,"lower-alpha") == 0 || 
+                             Stricmp((char *)prop->value,"lower-latin") == 0)
+                     {  li.bullettype = BDBT_ALPHALOW;
                      }
-                     /* Check for display:inline */
-                     else if(Stricmp((char *)prop->name,"display") == 0 &&
-                             Stricmp((char *)prop->value,"inline") == 0)
-                     {  hasDisplayInline = TRUE;
+                     else if(Stricmp((char *)prop->value,"upper-alpha") == 0 || 
+                             Stricmp((char *)prop->value,"upper-latin") == 0)
+                     {  li.bullettype = BDBT_ALPHA;
                      }
+                     else if(Stricmp((char *)prop->value,"lower-roman") == 0)
+                     {  li.bullettype = BDBT_ROMANLOW;
+                     }
+                     else if(Stricmp((char *)prop->value,"upper-roman") == 0)
+                     {  li.bullettype = BDBT_ROMAN;
+                     }
+                     else if(Stricmp((char *)prop->value,"none") == 0)
+                     {  li.bullettype = BDBT_PLAIN;
+                     }
+                     else if(Stricmp((char *)prop->value,"disc") == 0)
+                     {  li.bullettype = BDBT_DISC;
+                     }
+                     else if(Stricmp((char *)prop->value,"circle") == 0)
+                     {  li.bullettype = BDBT_CIRCLE;
+                     }
+                     else if(Stricmp((char *)prop->value,"square") == 0)
+                     {  li.bullettype = BDBT_SQUARE;
+                     }
+                  }
+                  /* Check for display:inline */
+                  else if(Stricmp((char *)prop->name,"display") == 0 &&
+                          Stricmp((char *)prop->value,"inline") == 0)
+                  {  hasDisplayInline = TRUE;
                   }
                }
             }
-            
-            /* Also check for .classname li with display:inline */
-            if((sel->type & CSS_SEL_CLASS) && sel->class && 
-               MatchClassAttribute(classAttr, sel->class))
-            {  if(sel->type & CSS_SEL_ELEMENT && sel->name && 
-                  Stricmp((char *)sel->name,"li") == 0)
-               {  for(prop = (struct CSSProperty *)rule->properties.mlh_Head;
-                      (struct MinNode *)prop->node.mln_Succ;
-                      prop = (struct CSSProperty *)prop->node.mln_Succ)
-                  {  if(prop->name && prop->value && 
-                        Stricmp((char *)prop->name,"display") == 0 &&
-                        Stricmp((char *)prop->value,"inline") == 0)
-                     {  hasDisplayInline = TRUE;
-                        break;
-                     }
+         }
+         
+         /* Also check for .classname li with display:inline */
+         if((sel->type & CSS_SEL_CLASS) && sel->class && 
+            MatchClassAttribute(classAttr, sel->class))
+         {  if(sel->type & CSS_SEL_ELEMENT && sel->name && 
+               Stricmp((char *)sel->name,"li") == 0)
+            {  for(prop = (struct CSSProperty *)rule->properties.mlh_Head;
+                   (struct MinNode *)prop->node.mln_Succ;
+                   prop = (struct CSSProperty *)prop->node.mln_Succ)
+               {  if(prop->name && prop->value && 
+                     Stricmp((char *)prop->name,"display") == 0 &&
+                     Stricmp((char *)prop->value,"inline") == 0)
+                  {  hasDisplayInline = TRUE;
+                     break;
                   }
                }
             }
          }
       }
+      FreeCSSCandidates(&cand);
       if(hasDisplayInline)
       {  li.horizontal = TRUE;
          /* Also set list-style-type: none for horizontal lists */
@@ -5143,75 +5137,76 @@ static BOOL Doul(struct Document *doc,struct Tagattr *ta)
       struct CSSProperty *prop;
       struct CSSStylesheet *sheet;
       BOOL hasDisplayInline = FALSE;
+      BOOL matches;
+      struct CSSCandidates cand;
+      long i;
       
       sheet = (struct CSSStylesheet *)doc->cssstylesheet;
-      for(rule = (struct CSSRule *)sheet->rules.mlh_Head;
-          (struct MinNode *)rule->node.mln_Succ;
-          rule = (struct CSSRule *)rule->node.mln_Succ)
-      {  for(sel = (struct CSSSelector *)rule->selectors.mlh_Head;
-            (struct MinNode *)sel->node.mln_Succ;
-            sel = (struct CSSSelector *)sel->node.mln_Succ)
-         {  /* Check if this selector matches our list's class */
-            BOOL matches = FALSE;
-            if((sel->type & CSS_SEL_CLASS) && sel->class)
-            {  if(MatchClassAttribute(classAttr, sel->class))
-               {  /* Check if this selector matches 'ol' or 'ul' element */
-                  if(!(sel->type & CSS_SEL_ELEMENT) || !sel->name ||
-                     Stricmp((char *)sel->name,"ol") == 0 || Stricmp((char *)sel->name,"ul") == 0)
-                  {  matches = TRUE;
-                  }
+      FindCSSCandidates(sheet,(UBYTE *)"ul",classAttr,idAttr,&cand);
+      for(i = 0; i < cand.count; i++)
+      {  rule = cand.entries[i]->rule;
+         sel = cand.entries[i]->sel;
+         /* Check if this selector matches our list's class */
+         matches = FALSE;
+         if((sel->type & CSS_SEL_CLASS) && sel->class)
+         {  if(MatchClassAttribute(classAttr, sel->class))
+            {  /* Check if this selector matches 'ol' or 'ul' element */
+               if(!(sel->type & CSS_SEL_ELEMENT) || !sel->name ||
+                  Stricmp((char *)sel->name,"ol") == 0 || Stricmp((char *)sel->name,"ul") == 0)
+               {  matches = TRUE;
                }
             }
-            
-            if(matches)
-            {  /* Check for list-style-type and display properties */
-               for(prop = (struct CSSProperty *)rule->properties.mlh_Head;
-                   (struct MinNode *)prop->node.mln_Succ;
-                   prop = (struct CSSProperty *)prop->node.mln_Succ)
-               {  if(prop->name && prop->value)
-                  {  /* Check for list-style-type */
-                     if(Stricmp((char *)prop->name,"list-style-type") == 0)
-                     {  if(Stricmp((char *)prop->value,"disc") == 0)
-                        {  li.bullettype = BDBT_DISC;
-                        }
-                        else if(Stricmp((char *)prop->value,"circle") == 0)
-                        {  li.bullettype = BDBT_CIRCLE;
-                        }
-                        else if(Stricmp((char *)prop->value,"square") == 0)
-                        {  li.bullettype = BDBT_SQUARE;
-                        }
-                        else if(Stricmp((char *)prop->value,"none") == 0)
-                        {  li.bullettype = BDBT_PLAIN;
-                        }
+         }
+         
+         if(matches)
+         {  /* Check for list-style-type and display properties */
+            for(prop = (struct CSSProperty *)rule->properties.mlh_Head;
+                (struct MinNode *)prop->node.mln_Succ;
+                prop = (struct CSSProperty *)prop->node.mln_Succ)
+            {  if(prop->name && prop->value)
+               {  /* Check for list-style-type */
+                  if(Stricmp((char *)prop->name,"list-style-type") == 0)
+                  {  if(Stricmp((char *)prop->value,"disc") == 0)
+                     {  li.bullettype = BDBT_DISC;
                      }
-                     /* Check for display:inline */
-                     else if(Stricmp((char *)prop->name,"display") == 0 &&
-                             Stricmp((char *)prop->value,"inline") == 0)
-                     {  hasDisplayInline = TRUE;
+                     else if(Stricmp((char *)prop->value,"circle") == 0)
+                     {  li.bullettype = BDBT_CIRCLE;
                      }
+                     else if(Stricmp((char *)prop->value,"square") == 0)
+                     {  li.bullettype = BDBT_SQUARE;
+                     }
+                     else if(Stricmp((char *)prop->value,"none") == 0)
+                     {  li.bullettype = BDBT_PLAIN;
+                     }
+                  }
+                  /* Check for display:inline */
+                  else if(Stricmp((char *)prop->name,"display") == 0 &&
+                          Stricmp((char *)prop->value,"inline") == 0)
+                  {  hasDisplayInline = TRUE;
                   }
                }
             }
-            
-            /* Also check for .classname li with display:inline */
-            if((sel->type & CSS_SEL_CLASS) && sel->class && 
-               MatchClassAttribute(classAttr, sel->class))
-            {  if(sel->type & CSS_SEL_ELEMENT && sel->name && 
-                  Stricmp((char *)sel->name,"li") == 0)
-               {  for(prop = (struct CSSProperty *)rule->properties.mlh_Head;
-                      (struct MinNode *)prop->node.mln_Succ;
-                      prop = (struct CSSProperty *)prop->node.mln_Succ)
-                  {  if(prop->name && prop->value && 
-                        Stricmp((char *)prop->name,"display") == 0 &&
-                        Stricmp((char *)prop->value,"inline") == 0)
-                     {  hasDisplayInline = TRUE;
-                        break;
-                     }
+         }
+         
+         /* Also check for .classname li with display:inline */
+         if((sel->type & CSS_SEL_CLASS) && sel->class && 
+            MatchClassAttribute(classAttr, sel->class))
+         {  if(sel->type & CSS_SEL_ELEMENT && sel->name && 
+               Stricmp((char *)sel->name,"li") == 0)
+            {  for(prop = (struct CSSProperty *)rule->properties.mlh_Head;
+                   (struct MinNode *)prop->node.mln_Succ;
+                   prop = (struct CSSProperty *)prop->node.mln_Succ)
+               {  if(prop->name && prop->value && 
+                     Stricmp((char *)prop->name,"display") == 0 &&
+                     Stricmp((char *)prop->value,"inline") == 0)
+                  {  hasDisplayInline = TRUE;
+                     break;
                   }
                }
             }
          }
       }
+      FreeCSSCandidates(&cand);
       if(hasDisplayInline)
       {  li.horizontal = TRUE;
          /* Also set list-style-type: none for horizontal lists */
@@ -5275,6 +5270,7 @@ static BOOL Doli(struct Document *doc,struct Tagattr *ta)
    void *elt=NULL,*url,*referer;
    short btype;
    UBYTE *classAttr=NULL;
+   UBYTE *idAttr=NULL;
    void *body;
    struct Tagattr *attr;
    if(doc->pflags&DPF_BULLET) doc->gotbreak=0;
@@ -5287,8 +5283,7 @@ static BOOL Doli(struct Document *doc,struct Tagattr *ta)
    
    /* Extract class and id attributes from LI element */
    /* Use exact same pattern as Dopara */
-   {  UBYTE *idAttr = NULL;
-      for(;ta && ta->next;ta=ta->next)
+   {  for(;ta && ta->next;ta=ta->next)
       {  switch(ta->attr)
          {  case TAGATTR_CLASS:
                classAttr = ATTR(doc,ta);
@@ -5315,79 +5310,78 @@ static BOOL Doli(struct Document *doc,struct Tagattr *ta)
       struct CSSProperty *prop;
       struct CSSStylesheet *sheet;
       void *body;
+      struct CSSCandidates cand;
+      long i;
       
       body = Docbody(doc);
       sheet = (struct CSSStylesheet *)doc->cssstylesheet;
-      for(rule = (struct CSSRule *)sheet->rules.mlh_Head;
-          (struct MinNode *)rule->node.mln_Succ;
-          rule = (struct CSSRule *)rule->node.mln_Succ)
-      {  for(sel = (struct CSSSelector *)rule->selectors.mlh_Head;
-            (struct MinNode *)sel->node.mln_Succ;
-            sel = (struct CSSSelector *)sel->node.mln_Succ)
-         {  /* Check for .classname li selector (matches parent list's class) */
-            if((sel->type & CSS_SEL_CLASS) && sel->class && 
-               Stricmp((char *)sel->class,(char *)doc->currentlistclass) == 0 &&
-               (sel->type & CSS_SEL_ELEMENT) && sel->name && 
-               Stricmp((char *)sel->name,"li") == 0)
-            {  /* Apply properties from .classname li rule */
-               for(prop = (struct CSSProperty *)rule->properties.mlh_Head;
-                   (struct MinNode *)prop->node.mln_Succ;
-                   prop = (struct CSSProperty *)prop->node.mln_Succ)
-               {  if(prop->name && prop->value)
-                  {  /* Apply margin-left and margin-right */
-                     if(Stricmp((char *)prop->name,"margin-left") == 0)
-                     {  /* Parse margin value (e.g., "1em" or "14px") */
-                        long marginValue;
-                        struct Number num;
-                        UBYTE *valueStr;
-                        long valueLen;
-                        BOOL isEm;
-                        
-                        valueStr = prop->value;
-                        valueLen = strlen((char *)valueStr);
-                        /* Check if value ends with "em" */
-                        isEm = (valueLen >= 2 && 
-                                tolower(valueStr[valueLen-2]) == 'e' && 
-                                tolower(valueStr[valueLen-1]) == 'm');
-                        
-                        if(Getnumber(&num,prop->value))
-                        {  marginValue = num.n;
-                           /* Convert "em" to pixels (approximate: 1em = 14px for 14px font) */
-                           if(isEm && marginValue > 0)
-                           {  marginValue = marginValue * 14; /* Approximate conversion */
-                           }
-                           if(marginValue > 0)
-                           {  Asetattrs(body,AOBDY_Leftmargin,marginValue,TAG_END);
-                              /* debug_printf("CSS: Applied margin-left=%ld to list item\n",marginValue); */
-                           }
+      FindCSSCandidates(sheet,(UBYTE *)"li",doc->currentlistclass,idAttr,&cand);
+      for(i = 0; i < cand.count; i++)
+      {  rule = cand.entries[i]->rule;
+         sel = cand.entries[i]->sel;
+         /* Check for .classname li selector (matches parent list's class) */
+         if((sel->type & CSS_SEL_CLASS) && sel->class && 
+            Stricmp((char *)sel->class,(char *)doc->currentlistclass) == 0 &&
+            (sel->type & CSS_SEL_ELEMENT) && sel->name && 
+            Stricmp((char *)sel->name,"li") == 0)
+         {  /* Apply properties from .classname li rule */
+            for(prop = (struct CSSProperty *)rule->properties.mlh_Head;
+                (struct MinNode *)prop->node.mln_Succ;
+                prop = (struct CSSProperty *)prop->node.mln_Succ)
+            {  if(prop->name && prop->value)
+               {  /* Apply margin-left and margin-right */
+                  if(Stricmp((char *)prop->name,"margin-left") == 0)
+                  {  /* Parse margin value (e.g., "1em" or "14px") */
+                     long marginValue;
+                     struct Number num;
+                     UBYTE *valueStr;
+                     long valueLen;
+                     BOOL isEm;
+                     
+                     valueStr = prop->value;
+                     valueLen = strlen((char *)valueStr);
+                     /* Check if value ends with "em" */
+                     isEm = (valueLen >= 2 && 
+                             tolower(valueStr[valueLen-2]) == 'e' && 
+                             tolower(valueStr[valueLen-1]) == 'm');
+                     
+                     if(Getnumber(&num,prop->value))
+                     {  marginValue = num.n;
+                        /* Convert "em" to pixels (approximate: 1em = 14px for 14px font) */
+                        if(isEm && marginValue > 0)
+                        {  marginValue = marginValue * 14; /* Approximate conversion */
+                        }
+                        if(marginValue > 0)
+                        {  Asetattrs(body,AOBDY_Leftmargin,marginValue,TAG_END);
+                           /* debug_printf("CSS: Applied margin-left=%ld to list item\n",marginValue); */
                         }
                      }
-                     else if(Stricmp((char *)prop->name,"margin-right") == 0)
-                     {  /* Parse margin value */
-                        long marginValue;
-                        struct Number num;
-                        UBYTE *valueStr;
-                        long valueLen;
-                        BOOL isEm;
-                        
-                        valueStr = prop->value;
-                        valueLen = strlen((char *)valueStr);
-                        /* Check if value ends with "em" */
-                        isEm = (valueLen >= 2 && 
-                                tolower(valueStr[valueLen-2]) == 'e' && 
-                                tolower(valueStr[valueLen-1]) == 'm');
-                        
-                        if(Getnumber(&num,prop->value))
-                        {  marginValue = num.n;
-                           /* Convert "em" to pixels */
-                           if(isEm && marginValue > 0)
-                           {  marginValue = marginValue * 14; /* Approximate conversion */
-                           }
-                           /* Note: AWeb doesn't have margin-right, use left margin as spacing */
-                           if(marginValue > 0)
-                           {  Asetattrs(body,AOBDY_Leftmargin,marginValue,TAG_END);
-                              /* debug_printf("CSS: Applied margin-right=%ld (as left margin) to list item\n",marginValue); */
-                           }
+                  }
+                  else if(Stricmp((char *)prop->name,"margin-right") == 0)
+                  {  /* Parse margin value */
+                     long marginValue;
+                     struct Number num;
+                     UBYTE *valueStr;
+                     long valueLen;
+                     BOOL isEm;
+                     
+                     valueStr = prop->value;
+                     valueLen = strlen((char *)valueStr);
+                     /* Check if value ends with "em" */
+                     isEm = (valueLen >= 2 && 
+                             tolower(valueStr[valueLen-2]) == 'e' && 
+                             tolower(valueStr[valueLen-1]) == 'm');
+                     
+                     if(Getnumber(&num,prop->value))
+                     {  marginValue = num.n;
+                        /* Convert "em" to pixels */
+                        if(isEm && marginValue > 0)
+                        {  marginValue = marginValue * 14; /* Approximate conversion */
+                        }
+                        /* Note: AWeb doesn't have margin-right, use left margin as spacing */
+                        if(marginValue > 0)
+                        {  Asetattrs(body,AOBDY_Leftmargin,marginValue,TAG_END);
+                           /* debug_printf("CSS: Applied margin-right=%ld (as left margin) to list item\n",marginValue); */
                         }
                      }
                   }
@@ -5395,6 +5389,7 @@ static BOOL Doli(struct Document *doc,struct Tagattr *ta)
             }
          }
       }
+      FreeCSSCandidates(&cand);
    }
    
    /* For horizontal lists, don't add line breaks between items */
@@ -0,0 +1,570 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb APL distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* htmlnames.c - AWeb HTML tag, attribute and entity names */
+
+/* This file has no system dependencies, so it can be built and tested on any host. */
+
+#include <exec/types.h>
+#include <string.h>
+#include <ctype.h>
+#include "ezlists.h"
+#include "html.h"
+#include "htmlnames.h"
+
+static struct Tagdes tags[]=
+{  "A",        MARKUP_A,            TRUE,
+   "ADDRESS",  MARKUP_ADDRESS,      TRUE,
+   "AREA",     MARKUP_AREA,         FALSE,
+   "B",        MARKUP_B,            TRUE,
+   "BASE",     MARKUP_BASE,         FALSE,
+   "BASEFONT", MARKUP_BASEFONT,     FALSE,
+   "BGSOUND",  MARKUP_BGSOUND,      FALSE,
+   "BIG",      MARKUP_BIG,          TRUE,
+   "BLINK",    MARKUP_BLINK,        TRUE,
+   "BLOCKQUOTE",MARKUP_BLOCKQUOTE,  TRUE,
+   "BODY",     MARKUP_BODY,         TRUE,
+   "BQ",       MARKUP_BLOCKQUOTE,   TRUE,
+   "BR",       MARKUP_BR,           FALSE,
+   "BUTTON",   MARKUP_BUTTON,       TRUE,
+   "CAPTION",  MARKUP_CAPTION,      TRUE,
+   "CENTER",   MARKUP_CENTER,       TRUE,
+   "CITE",     MARKUP_CITE,         TRUE,
+   "CODE",     MARKUP_CODE,         TRUE,
+   "COL",      MARKUP_COL,          FALSE,
+   "COLGROUP", MARKUP_COLGROUP,     TRUE,
+   "DD",       MARKUP_DD,           FALSE,
+   "DEL",      MARKUP_DEL,          TRUE,
+   "DFN",      MARKUP_DFN,          TRUE,
+   "DIR",      MARKUP_DIR,          TRUE,
+   "DIV",      MARKUP_DIV,          TRUE,
+   "DL",       MARKUP_DL,           TRUE,
+   "DT",       MARKUP_DT,           FALSE,
+   "EM",       MARKUP_EM,           TRUE,
+   "EMBED",    MARKUP_EMBED,        FALSE,
+   "FIELDSET", MARKUP_FIELDSET,     TRUE,
+   "FONT",     MARKUP_FONT,         TRUE,
+   "FORM",     MARKUP_FORM,         TRUE,
+   "FRAME",    MARKUP_FRAME,        FALSE,
+   "FRAMESET", MARKUP_FRAMESET,     TRUE,
+   "H1",       MARKUP_H1,           TRUE,
+   "H2",       MARKUP_H2,           TRUE,
+   "H3",       MARKUP_H3,           TRUE,
+   "H4",       MARKUP_H4,           TRUE,
+   "H5",       MARKUP_H5,           TRUE,
+   "H6",       MARKUP_H6,           TRUE,
+   "HEAD",     MARKUP_HEAD,         TRUE,
+   "HR",       MARKUP_HR,           FALSE,
+   "HTML",     MARKUP_HTML,         TRUE,
+   "I",        MARKUP_I,            TRUE,
+   "IFRAME",   MARKUP_IFRAME,       TRUE,
+   "IMAGE",    MARKUP_IMG,          FALSE,
+   "IMG",      MARKUP_IMG,          FALSE,
+   "INPUT",    MARKUP_INPUT,        FALSE,
+   "INS",      MARKUP_INS,          TRUE,
+   "ISINDEX",  MARKUP_ISINDEX,      FALSE,
+   "KBD",      MARKUP_KBD,          TRUE,
+   "LEGEND",   MARKUP_LEGEND,       TRUE,
+   "LI",       MARKUP_LI,           FALSE,
+   "LINK",     MARKUP_LINK,         FALSE,
+   "LISTING",  MARKUP_LISTING,      TRUE,
+   "MAP",      MARKUP_MAP,          TRUE,
+   "MARQUEE",  MARKUP_MARQUEE,      TRUE,
+   "MENU",     MARKUP_MENU,         TRUE,
+   "META",     MARKUP_META,         FALSE,
+   "NOBR",     MARKUP_NOBR,         TRUE,
+   "NOFRAME",  MARKUP_NOFRAMES,     TRUE,
+   "NOFRAMES", MARKUP_NOFRAMES,     TRUE,
+   "NOSCRIPT", MARKUP_NOSCRIPT,     TRUE,
+   "OBJECT",   MARKUP_OBJECT,       TRUE,
+   "OL",       MARKUP_OL,           TRUE,
+   "OPTION",   MARKUP_OPTION,       FALSE,
+   "P",        MARKUP_P,            TRUE,
+   "PARAM",    MARKUP_PARAM,        FALSE,
+   "PRE",      MARKUP_PRE,          TRUE,
+   "S",        MARKUP_STRIKE,       TRUE,
+   "SAMP",     MARKUP_SAMP,         TRUE,
+   "SCRIPT",   MARKUP_SCRIPT,       TRUE,
+   "SELECT",   MARKUP_SELECT,       TRUE,
+   "SMALL",    MARKUP_SMALL,        TRUE,
+   "SPAN",     MARKUP_SPAN,         TRUE,
+   "STRIKE",   MARKUP_STRIKE,       TRUE,
+   "STRONG",   MARKUP_STRONG,       TRUE,
+   "STYLE",    MARKUP_STYLE,        TRUE,
+   "SUB",      MARKUP_SUB,          TRUE,
+   "SUP",      MARKUP_SUP,          TRUE,
+   "TABLE",    MARKUP_TABLE,        TRUE,
+   "TBODY",    MARKUP_TBODY,        TRUE,
+   "TD",       MARKUP_TD,           TRUE,
+   "TEXTAREA", MARKUP_TEXTAREA,     TRUE,
+   "TFOOT",    MARKUP_TFOOT,        TRUE,
+   "TH",       MARKUP_TH,           TRUE,
+   "THEAD",    MARKUP_THEAD,        TRUE,
+   "TITLE",    MARKUP_TITLE,        TRUE,
+   "TR",       MARKUP_TR,           TRUE,
+   "TT",       MARKUP_TT,           TRUE,
+   "U",        MARKUP_U,            TRUE,
+   "UL",       MARKUP_UL,           TRUE,
+   "VAR",      MARKUP_VAR,          TRUE,
+   "WBR",      MARKUP_WBR,          FALSE,
+   "XMP",      MARKUP_XMP,          TRUE,
+};
+#define NRTAGS (sizeof(tags)/sizeof(struct Tagdes))
+
+static struct Attrdes tagattrs[]=
+{  "ACTION",            TAGATTR_ACTION,
+   "ALIGN",             TAGATTR_ALIGN,
+   "ALINK",             TAGATTR_ALINK,
+   "ALT",               TAGATTR_ALT,
+   "BACKGROUND",        TAGATTR_BACKGROUND,
+   "BEHAVIOR",          TAGATTR_BEHAVIOR,
+   "BGCOLOR",           TAGATTR_BGCOLOR,
+   "BORDER",            TAGATTR_BORDER,
+   "BORDERCOLOR",       TAGATTR_BORDERCOLOR,
+   "BORDERCOLORDARK",   TAGATTR_BORDERCOLORDARK,
+   "BORDERCOLORLIGHT",  TAGATTR_BORDERCOLORLIGHT,
+   "CELLPADDING",       TAGATTR_CELLPADDING,
+   "CELLSPACING",       TAGATTR_CELLSPACING,
+   "CHECKED",           TAGATTR_CHECKED,
+   "CLASS",             TAGATTR_CLASS,
+   "CLASSID",           TAGATTR_CLASSID,
+   "CLEAR",             TAGATTR_CLEAR,
+   "CODEBASE",          TAGATTR_CODEBASE,
+   "CODETYPE",          TAGATTR_CODETYPE,
+   "COLOR",             TAGATTR_COLOR,
+   "COLS",              TAGATTR_COLS,
+   "COLSPAN",           TAGATTR_COLSPAN,
+   "CONTENT",           TAGATTR_CONTENT,
+   "CONTINUE",          TAGATTR_CONTINUE,
+   "COORDS",            TAGATTR_COORDS,
+   "DATA",              TAGATTR_DATA,
+   "DECLARE",           TAGATTR_DECLARE,
+   "DINGBAT",           TAGATTR_DINGBAT,
+   "DIRECTION",        TAGATTR_DIRECTION,
+   "ENCTYPE",           TAGATTR_ENCTYPE,
+   "FACE",              TAGATTR_FACE,
+   "FRAME",             TAGATTR_FRAME,
+   "FRAMEBORDER",       TAGATTR_FRAMEBORDER,
+   "FRAMESPACING",      TAGATTR_FRAMESPACING,
+   "HEIGHT",            TAGATTR_HEIGHT,
+   "HIDDEN",            TAGATTR_HIDDEN,
+   "HREF",              TAGATTR_HREF,
+   "HSPACE",            TAGATTR_HSPACE,
+   "HTTP-EQUIV",        TAGATTR_HTTP_EQUIV,
+   "ID",                TAGATTR_ID,
+   "ISMAP",             TAGATTR_ISMAP,
+   "LANGUAGE",          TAGATTR_LANGUAGE,
+   "LEFTMARGIN",        TAGATTR_LEFTMARGIN,
+   "LINK",              TAGATTR_LINK,
+   "LOOP",              TAGATTR_LOOP,
+   "MARGINHEIGHT",      TAGATTR_MARGINHEIGHT,
+   "MARGINWIDTH",       TAGATTR_MARGINWIDTH,
+   "MAXLENGTH",         TAGATTR_MAXLENGTH,
+   "METHOD",            TAGATTR_METHOD,
+   "MULTIPLE",          TAGATTR_MULTIPLE,
+   "NAME",              TAGATTR_NAME,
+   "NOHREF",            TAGATTR_NOHREF,
+   "NORESIZE",          TAGATTR_NORESIZE,
+   "NOSHADE",           TAGATTR_NOSHADE,
+   "NOWRAP",            TAGATTR_NOWRAP,
+   "ONABORT",           TAGATTR_ONABORT,
+   "ONBLUR",            TAGATTR_ONBLUR,
+   "ONCHANGE",          TAGATTR_ONCHANGE,
+   "ONCLICK",           TAGATTR_ONCLICK,
+   "ONERROR",           TAGATTR_ONERROR,
+   "ONFOCUS",           TAGATTR_ONFOCUS,
+   "ONLOAD",            TAGATTR_ONLOAD,
+   "ONMOUSEOUT",        TAGATTR_ONMOUSEOUT,
+   "ONMOUSEOVER",       TAGATTR_ONMOUSEOVER,
+   "ONRESET",           TAGATTR_ONRESET,
+   "ONSELECT",          TAGATTR_ONSELECT,
+   "ONSUBMIT",          TAGATTR_ONSUBMIT,
+   "ONUNLOAD",          TAGATTR_ONUNLOAD,
+   "PLAIN",             TAGATTR_PLAIN,
+   "PROMPT",            TAGATTR_PROMPT,
+   "REL",               TAGATTR_REL,
+   "ROWS",              TAGATTR_ROWS,
+   "ROWSPAN",           TAGATTR_ROWSPAN,
+   "RULES",             TAGATTR_RULES,
+   "SCROLLING",         TAGATTR_SCROLLING,
+   "SCROLLAMOUNT",      TAGATTR_SCROLLAMOUNT,
+   "SCROLLDELAY",       TAGATTR_SCROLLDELAY,
+   "SELECTED",          TAGATTR_SELECTED,
+   "SEQNUM",            TAGATTR_SEQNUM,
+   "SHAPE",             TAGATTR_SHAPE,
+   "SHAPES",            TAGATTR_SHAPES,
+   "SIZE",              TAGATTR_SIZE,
+   "SKIP",              TAGATTR_SKIP,
+   "SPAN",              TAGATTR_SPAN,
+   "SRC",               TAGATTR_SRC,
+   "STANDBY",           TAGATTR_STANDBY,
+   "START",             TAGATTR_START,
+   "STYLE",             TAGATTR_STYLE,
+   "TARGET",            TAGATTR_TARGET,
+   "TEXT",              TAGATTR_TEXT,
+   "TITLE",             TAGATTR_TITLE,
+   "TOPMARGIN",         TAGATTR_TOPMARGIN,
+   "TYPE",              TAGATTR_TYPE,
+   "USEMAP",            TAGATTR_USEMAP,
+   "VALIGN",            TAGATTR_VALIGN,
+   "VALUE",             TAGATTR_VALUE,
+   "VALUETYPE",         TAGATTR_VALUETYPE,
+   "VLINK",             TAGATTR_VLINK,
+   "VSPACE",            TAGATTR_VSPACE,
+   "WIDTH",             TAGATTR_WIDTH,
+};
+#define NRATTRS   (sizeof(tagattrs)/sizeof(struct Attrdes))
+
+static struct Chardes chars[]=
+{  "AElig", 198,
+   "Aacute",193,
+   "Acirc", 194,
+   "Agrave",192,
+   "Aring", 197,
+   "Atilde",195,
+   "Auml",  196,
+   "Ccedil",199,
+   "Dagger",135,  /* Latin-1 double dagger (Windows-1252 extension) */
+   "ETH",   208,
+   "Eacute",201,
+   "Ecirc", 202,
+   "Egrave",200,
+   "Euml",  203,
+   "Iacute",205,
+   "Icirc", 206,
+   "Igrave",204,
+   "Iuml",  207,
+   "Ntilde",209,
+   "OElig", 338,  /* No Latin-1 equivalent, kept as Unicode for translation */
+   "Oacute",211,
+   "Ocirc", 212,
+   "Ograve",210,
+   "Oslash",216,
+   "Otilde",213,
+   "Ouml",  214,
+   "Prime", 148,  /* Approximated as right double quote in Latin-1 */
+   "Scaron",352,  /* No Latin-1 equivalent, kept as Unicode for translation */
+   "THORN", 222,
+   "Uacute",218,
+   "Ucirc", 219,
+   "Ugrave",217,
+   "Uuml",  220,
+   "Yacute",221,
+   "Yuml",  376,  /* No Latin-1 equivalent, kept as Unicode for translation */
+   "aacute",225,
+   "acirc", 226,
+   "acute", 180,
+   "aelig", 230,
+   "agrave",224,
+   "amp",   38,
+   "aring", 229,
+   "atilde",227,
+   "auml",  228,
+   "bdquo", 132,  /* Latin-1 double low-9 quotation mark (Windows-1252 extension) */
+   "brkbar",166,  /* Latin-1 broken vertical bar (alternate name for brvbar) */
+   "brvbar",166,
+   "bull",  183,  /* Latin-1 MIDDLE DOT (·) for bullet - U+00B7 */
+   "ccedil",231,
+   "cedil", 184,
+   "cent",  162,
+   "circ",  136,  /* Latin-1 circumflex accent (Windows-1252 extension) */
+   "copy",  169,
+   "curren",164,
+   "dagger",134,  /* Latin-1 dagger (Windows-1252 extension) */
+   "deg",   176,
+   "die",   168,  /* Latin-1 spacing dieresis or umlaut (alternate name for uml) */
+   "divide",247,
+   "eacute",233,
+   "ecirc", 234,
+   "egrave",232,
+   "empty", 8709,  /* No Latin-1 equivalent, kept as Unicode for translation */
+   "emsp",  8195,  /* No Latin-1 equivalent, kept as Unicode for translation */
+   "ensp",  8194,  /* No Latin-1 equivalent, kept as Unicode for translation */
+   "eth",   240,
+   "euml",  235,
+   "euro",  164,  /* Approximated as currency symbol (¤) in Latin-1 */
+   "fnof",  402,  /* No Latin-1 equivalent, kept as Unicode for translation */
+   "frac12",189,
+   "frac14",188,
+   "frac34",190,
+   "frasl", 8260,  /* No Latin-1 equivalent, kept as Unicode for translation */
+   "half",  189,  /* Latin-1 fraction 1/2 (alternate name for frac12) */
+   "ge",    8805,  /* No Latin-1 equivalent, kept as Unicode for translation */
+   "gt",    62,
+   "hellip",133,  /* Latin-1 horizontal ellipsis (Windows-1252 extension) */
+   "hibar", 175,  /* Latin-1 spacing macron (alternate name for macr) */
+   "iacute",237,
+   "icirc", 238,
+   "iexcl", 161,
+   "igrave",236,
+   "iquest",191,
+   "iuml",  239,
+   "lang",  9001,  /* No Latin-1 equivalent, kept as Unicode for translation */
+   "laquo", 171,
+   "larr",  8592,  /* Left arrow (←) - Unicode U+2190 */
+   "ldquo", 147,  /* Latin-1 left double quotation mark (Windows-1252 extension) */
+   "le",    8804,  /* No Latin-1 equivalent, kept as Unicode for translation */
+   "lowast",8727,  /* No Latin-1 equivalent, kept as Unicode for translation */
+   "loz",   9674,  /* No Latin-1 equivalent, kept as Unicode for translation */
+   "lsaquo",139,  /* Latin-1 single left-pointing angle quotation mark (Windows-1252 extension) */
+   "lsquo", 145,  /* Latin-1 left single quotation mark (Windows-1252 extension) */
+   "lt",    60,
+   "macr",  175,
+   "mdash", 151,  /* Latin-1 em dash (Windows-1252 extension) */
+   "micro", 181,
+   "middot",183,
+   "minus", 8722,  /* No Latin-1 equivalent, kept as Unicode for translation */
+   "nbsp",  160,
+   "ndash", 150,  /* Latin-1 en dash (Windows-1252 extension) */
+   "not",   172,
+   "ntilde",241,
+   "oacute",243,
+   "ocirc", 244,
+   "oelig", 339,  /* No Latin-1 equivalent, kept as Unicode for translation */
+   "ograve",242,
+   "oline", 175,  /* Approximated as macron in Latin-1 */
+   "ordf",  170,
+   "ordm",  186,
+   "oslash",248,
+   "otilde",245,
+   "ouml",  246,
+   "para",  182,
+   "permil",137,  /* Latin-1 per mille sign (Windows-1252 extension) */
+   "plusmn",177,
+   "pound", 163,
+   "prime", 146,  /* Approximated as right single quote in Latin-1 */
+   "quot",  34,
+   "rang",  9002,  /* No Latin-1 equivalent, kept as Unicode for translation */
+   "rarr",  8594,  /* Right arrow (→) - Unicode U+2192 */
+   "raquo", 187,
+   "reg",   174,  /* Latin-1 Registered trademark symbol */
+   "rdquo", 148,  /* Latin-1 right double quotation mark (Windows-1252 extension) */
+   "rsaquo",155,  /* Latin-1 single right-pointing angle quotation mark (Windows-1252 extension) */
+   "rsquo", 146,  /* Latin-1 right single quotation mark (Windows-1252/ISO 8859-1 extension) */
+   "sbquo", 130,  /* Latin-1 single low-9 quotation mark (Windows-1252 extension) */
+   "scaron",353,  /* No Latin-1 equivalent, kept as Unicode for translation */
+   "sdot",  8901,
+   "sect",  167,
+   "shy",   173,
+   "sim",   8764,  /* No Latin-1 equivalent, kept as Unicode for translation */
+   "sup1",  185,
+   "sup2",  178,
+   "sup3",  179,
+   "szlig", 223,
+   "thinsp",8201,  /* No Latin-1 equivalent, kept as Unicode for translation */
+   "thorn", 254,
+   "tilde", 152,  /* Latin-1 small tilde (Windows-1252 extension) */
+   "times", 215,
+   "trade", 153,  /* Approximated as trademark symbol in Windows-1252 extension (Latin-1 compatible) */
+   "uacute",250,
+   "ucirc", 251,
+   "ugrave",249,
+   "uml",   168,
+   "uuml",  252,
+   "yacute",253,
+   "yen",   165,
+   "yuml",  255,
+   "zwj",   8205,  /* No Latin-1 equivalent, kept as Unicode for translation */
+   "zwnj",  8204,  /* No Latin-1 equivalent, kept as Unicode for translation */
+};
+#define NRCHARS (sizeof(chars)/sizeof(struct Chardes))
+
+
+/*-----------------------------------------------------------------------*/
+
+/* Each table is indexed by a perfect hash, built from the table at startup
+ * with the hash and displace method. The low bits of the hash of a name
+ * select a bucket. Every bucket gets a displacement that puts all of its
+ * names in free slots, trying the largest buckets first. A lookup hashes
+ * the name once and compares it with the single entry in its slot. */
+
+#define NAMESLOTS       512      /* Slots per table, power of 2 */
+#define NAMEBUCKETS     128      /* Buckets per table, power of 2 */
+#define MAXNAMES        256      /* Entries in the largest table */
+
+#define MAXENTITYNAME   7        /* Longest entity name looked for */
+
+#define Nameslot(h,d)   ((((h)>>7)+(d)*(((h)>>16)|1))&(NAMESLOTS-1))
+
+struct Namehash
+{  void *table;               /* Entries, each starts with its name */
+   short size;                /* Size of an entry */
+   short count;               /* Number of entries */
+   BOOL nocase;               /* Names are case insensitive */
+   BOOL valid;                /* Hash was built, else search linear */
+   UWORD disp[NAMEBUCKETS];   /* Displacement per bucket */
+   short slot[NAMESLOTS];     /* Entry per slot, or -1 */
+};
+
+static struct Namehash taghash={ tags,sizeof(struct Tagdes),NRTAGS,TRUE };
+static struct Namehash attrhash={ tagattrs,sizeof(struct Attrdes),NRATTRS,TRUE };
+static struct Namehash charhash={ chars,sizeof(struct Chardes),NRCHARS,FALSE };
+
+#define Nameentry(nh,i) ((void *)((UBYTE *)(nh)->table+(i)*(nh)->size))
+#define Entryname(nh,i) (*(UBYTE **)Nameentry(nh,i))
+
+#define Upper(c) (((c)>='a' && (c)<='z')?(c)-('a'-'A'):(c))
+
+static ULONG Hashname(UBYTE *name,long length,BOOL nocase)
+{  ULONG h=0;
+   UBYTE c;
+   while(length--)
+   {  c=*name++;
+      if(nocase) c=Upper(c);
+      h+=c;
+      h+=h<<10;
+      h^=h>>6;
+   }
+   h+=h<<3;
+   h^=h>>11;
+   return h+(h<<15);
+}
+
+/* Compare a null terminated table name with a name in the source */
+static BOOL Sameentryname(UBYTE *entry,UBYTE *name,long length,BOOL nocase)
+{  UBYTE a,b;
+   while(length--)
+   {  a=*entry++;
+      b=*name++;
+      if(nocase)
+      {  a=Upper(a);
+         b=Upper(b);
+      }
+      if(!a || a!=b) return FALSE;
+   }
+   return (BOOL)!*entry;
+}
+
+static BOOL Buildnamehash(struct Namehash *nh)
+{  static ULONG hash[MAXNAMES];
+   static short next[MAXNAMES];
+   static short first[NAMEBUCKETS],size[NAMEBUCKETS];
+   short i,j,b,n,maxsize=0;
+   UWORD d;
+   UBYTE *name;
+   nh->valid=FALSE;
+   if(nh->count>MAXNAMES) return FALSE;
+   for(i=0;i<NAMESLOTS;i++) nh->slot[i]=-1;
+   for(b=0;b<NAMEBUCKETS;b++)
+   {  first[b]=-1;
+      size[b]=0;
+      nh->disp[b]=0;
+   }
+   for(i=0;i<nh->count;i++)
+   {  name=Entryname(nh,i);
+      hash[i]=Hashname(name,strlen(name),nh->nocase);
+      b=hash[i]&(NAMEBUCKETS-1);
+      next[i]=first[b];
+      first[b]=i;
+      if(++size[b]>maxsize) maxsize=size[b];
+   }
+   for(n=maxsize;n>0;n--)
+   {  for(b=0;b<NAMEBUCKETS;b++)
+      {  if(size[b]!=n) continue;
+         for(d=0;d<NAMESLOTS;d++)
+         {  for(i=first[b];i>=0;i=next[i])
+            {  j=Nameslot(hash[i],d);
+               if(nh->slot[j]>=0) break;
+               nh->slot[j]=i;
+            }
+            if(i<0) break;
+            /* Doesn't fit, take back the names already placed */
+            for(j=first[b];j!=i;j=next[j])
+            {  nh->slot[Nameslot(hash[j],d)]=-1;
+            }
+         }
+         if(d>=NAMESLOTS) return FALSE;
+         nh->disp[b]=d;
+      }
+   }
+   nh->valid=TRUE;
+   return TRUE;
+}
+
+static void *Findname(struct Namehash *nh,UBYTE *name,long length)
+{  ULONG h;
+   short i;
+   if(length<=0) return NULL;
+   if(nh->valid)
+   {  h=Hashname(name,length,nh->nocase);
+      i=nh->slot[Nameslot(h,nh->disp[h&(NAMEBUCKETS-1)])];
+      if(i>=0 && Sameentryname(Entryname(nh,i),name,length,nh->nocase))
+      {  return Nameentry(nh,i);
+      }
+      return NULL;
+   }
+   for(i=0;i<nh->count;i++)
+   {  if(Sameentryname(Entryname(nh,i),name,length,nh->nocase))
+      {  return Nameentry(nh,i);
+      }
+   }
+   return NULL;
+}
+
+/*-----------------------------------------------------------------------*/
+
+BOOL Inithtmlnames(void)
+{  BOOL ok=TRUE;
+   if(!Buildnamehash(&taghash)) ok=FALSE;
+   if(!Buildnamehash(&attrhash)) ok=FALSE;
+   if(!Buildnamehash(&charhash)) ok=FALSE;
+   return ok;
+}
+
+struct Tagdes *Findtag(UBYTE *name,long length)
+{  return (struct Tagdes *)Findname(&taghash,name,length);
+}
+
+struct Attrdes *Findattr(UBYTE *name,long length)
+{  return (struct Attrdes *)Findname(&attrhash,name,length);
+}
+
+struct Chardes *Findchar(UBYTE *name,long length)
+{  return (struct Chardes *)Findname(&charhash,name,length);
+}
+
+long Charref(UBYTE *p,UBYTE *end,BOOL strict,ULONG *ch)
+{  UBYTE *q=p+1,*name;
+   struct Chardes *cd;
+   ULONG n=0;
+   if(q>=end) return 0;
+   if(*q=='#')
+   {  q++;
+      if(q<end && isdigit(*q))
+      {  for(;q<end && isdigit(*q);q++)
+         {  if(n<0x110000) n=10*n+(*q-'0');
+         }
+      }
+      else if(q+1<end && toupper(*q)=='X' && isxdigit(q[1]))
+      {  for(q++;q<end && isxdigit(*q);q++)
+         {  if(n<0x110000) n=16*n+((*q<='9')?(*q-'0'):(toupper(*q)-'A'+10));
+         }
+      }
+      else return 0;
+   }
+   else
+   {  name=q;
+      while(q<end && q-name<MAXENTITYNAME && (isalnum(*q) || *q=='.' || *q=='-')) q++;
+      if(!(cd=Findchar(name,q-name))) return 0;
+      if(strict && q<end && isalnum(*q)) return 0;
+      n=cd->ch;
+   }
+   if(q<end && *q==';') q++;
+   *ch=n;
+   return q-p;
+}
@@ -0,0 +1,61 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb APL distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* htmlnames.h - AWeb HTML tag, attribute and entity names */
+
+#ifndef AWEB_HTMLNAMES_H
+#define AWEB_HTMLNAMES_H
+
+#include <exec/types.h>
+
+/* Names are looked up directly in the source text, given by a pointer and
+ * a length, so they don't have to be copied or null terminated first.
+ * Tag and attribute names are case insensitive, entity names are not. */
+
+struct Tagdes
+{  UBYTE *name;
+   USHORT type;
+   BOOL container;
+};
+
+struct Attrdes
+{  UBYTE *name;
+   USHORT type;
+};
+
+struct Chardes
+{  UBYTE *name;
+   USHORT ch;
+};
+
+/* Build the lookup tables. Must be called once before any lookup.
+ * Returns FALSE if a table had to fall back to linear search. */
+extern BOOL Inithtmlnames(void);
+
+extern struct Tagdes *Findtag(UBYTE *name,long length);
+extern struct Attrdes *Findattr(UBYTE *name,long length);
+extern struct Chardes *Findchar(UBYTE *name,long length);
+
+/* Decode the numeric or named character reference at (p), which points to
+ * a '&'. Returns the length of the reference including the '&' and an
+ * optional ';', or 0 if this is not a valid reference. The character code,
+ * possibly Unicode, is stored in (ch). If (strict), a named reference must
+ * not be followed by an alphanumeric character. */
+extern long Charref(UBYTE *p,UBYTE *end,BOOL strict,ULONG *ch);
+
+#endif
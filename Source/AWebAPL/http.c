@@ -42,6 +42,7 @@
 
 #include "/zlib/zconf.h"
 #include "/zlib/zlib.h"
+#include "httpdec.h"
 
 /* Socket option constants if not already defined */
 #ifndef SO_RCVTIMEO
@@ -64,7 +65,7 @@ BOOL debug_log_sema_initialized = FALSE;
 
 struct Httpinfo
 {  long status;               /* Response status */
-   USHORT flags;
+   ULONG flags;
    struct Authorize *prxauth; /* Proxy authorization */
    struct Authorize *auth;    /* Normal authorization */
    UBYTE *connect;            /* Connect to this host or proxy */
@@ -78,20 +79,29 @@ struct Httpinfo
    struct Library *socketbase;
    long sock;
    struct Assl *assl;         /* AwebSSL context */
-   long blocklength;          /* Length of data in block */
-   long nextscanpos;          /* Block position to scan */
+   long blockstart;           /* Block position of first unconsumed byte */
+   long blocklength;          /* Block position past last received byte */
+   long nextscanpos;          /* Block position following current line */
+   UBYTE *line;               /* Current header line in block */
    long linelength;           /* Length of current header line */
    long readheaders;          /* Number of header bytes read */
    ULONG movedto;             /* AOURL_ tag if 301 302 303 307 status */
    UBYTE *movedtourl;         /* URL string moved to */
    UBYTE parttype[32];        /* Content-type for this part */
-   long partlength;           /* Content-length for this part */
+   long partlength;           /* Content-length for this part, -1 if not sent */
    UBYTE *userid;             /* Userid from URL */
    UBYTE *passwd;             /* Password from URL */
    BOOL connection_reused;   /* TRUE if connection was reused from pool */
    long bytes_received;      /* Bytes received so far (for Range request retry) */
    BOOL server_supports_range; /* TRUE if server supports Range requests (Accept-Ranges: bytes) */
    long full_file_size;      /* Full file size from Content-Range header (for 206 responses) */
+   long keepalive_timeout;   /* Idle timeout from Keep-Alive header, 0 if not sent */
+   long keepalive_max;       /* Requests left from Keep-Alive header, -1 if not sent */
+   long requests_left;       /* Requests this connection may still be used for */
+   struct Httpdecoder *decoder; /* Body decoder while reading inflated data */
+   UBYTE *pending;            /* Body data in the block not yet passed on */
+   long pendinglength;
+   struct Pipeline *pipeline; /* Requests of other fetches sent on this connection */
 };
 
 #define HTTPIF_AUTH        0x0001   /* Tried with a known to be valid auth */
@@ -105,10 +115,14 @@ struct Httpinfo
 #define HTTPIF_KEEPALIVE_REQ 0x2000 /* Client requested keep-alive */
 #define HTTPIF_TUNNELOK    0x0080   /* Tunnel response was ok */
 #define HTTPIF_GZIPENCODED 0x0100   /* response is gzip encoded */
-#define HTTPIF_GZIPDECODING 0x0200  /* decoding gziped response has begun */
-#define HTTPIF_DATA_PROCESSED 0x0400 /* data has already been processed to prevent duplication */
+#define HTTPIF_DEFLATEENCODED 0x0200 /* response is deflate encoded */
 #define HTTPIF_CHUNKED 0x0800        /* response uses chunked transfer encoding */
 #define HTTPIF_RANGE_REQUEST 0x4000  /* Using Range request to resume partial download */
+#define HTTPIF_NOBODY  0x0400        /* Response has no body (204, 304) */
+#define HTTPIF_REUSABLE 0x8000       /* Response was read up to its end, connection can be reused */
+#define HTTPIF_RESPONSE 0x00010000   /* Some of the response was received */
+#define HTTPIF_HTTP10  0x00020000    /* Response is HTTP/1.0 */
+#define HTTPIF_PIPESEND 0x00040000   /* Pipelined requests can follow this response */
 
 static UBYTE *httprequest="GET %.7000s HTTP/1.1\r\n";
 
@@ -121,12 +135,12 @@ static UBYTE *useragentspoof="User-Agent: %s; (Spoofed by Amiga-AWeb/3.6; AmigaO
 #endif
 
 static UBYTE *fixedheaders=
-   "Accept: */*;q=1\r\nAccept-Encoding: gzip\r\n";
+   "Accept: */*;q=1\r\nAccept-Encoding: gzip, deflate\r\n";
 //   "Accept: text/html;level=3, text/html;version=3.0, */*;q=1\r\n";
 
 /* HTTP/1.1 specific headers */
 static UBYTE *connection="Connection: close\r\n";
-static UBYTE *connection_keepalive="Connection: close\r\n";
+static UBYTE *connection_keepalive="Connection: keep-alive\r\n";
 
 static UBYTE *host="Host: %s\r\n";
 
@@ -172,6 +186,8 @@ struct KeepAliveConnection
    long sock;                 /* Socket descriptor */
    struct Assl *assl;         /* SSL context (NULL if not SSL) */
    ULONG last_used;           /* Timestamp of last use */
+   ULONG timeout;             /* Seconds it may stay idle */
+   long requests_left;        /* Requests it may still be used for */
    BOOL in_use;               /* Currently in use flag */
 };
 
@@ -181,6 +197,52 @@ static BOOL keepalive_sema_initialized = FALSE;
 /* LIMITS TO PREVENT CLOGGING */
 #define KEEPALIVE_TIMEOUT 15  /* Reduced to 15s to free resources faster */
 #define MAX_IDLE_CONNECTIONS 8 /* Hard limit on idle connections */
+#define MAX_CONNECTION_REQUESTS 100 /* Requests per connection before it is closed */
+#define MAX_SKIP_BODY 16384    /* Largest unused body that is read to keep the connection */
+
+/* Connection statistics */
+static ULONG connections_opened,connections_reused;
+
+/* Pipelined requests. While a task reads the response to its GET request,
+ * tasks fetching from the same host can hand it their requests. It sends
+ * them as soon as the end of its own response is known, and passes the
+ * connection to the first waiting task when its response is complete. That
+ * task reads its response from the same connection, and so on. If the
+ * connection can't be passed on, all waiting tasks requeue their fetch. */
+struct Piperequest
+{  NODE(Piperequest);
+   struct Pipeline *pipeline;
+   struct Task *task;
+   ULONG signal;              /* Signal the waiting task with this */
+   UBYTE *request;
+   long length;
+   BOOL sent;                 /* Request was sent on the connection */
+   short state;               /* PIPES_xxx */
+};
+
+#define PIPES_WAIT      0     /* Waiting for the connection */
+#define PIPES_TURN      1     /* Connection was passed to this request */
+#define PIPES_REQUEUE   2     /* Connection can't be used, requeue the fetch */
+
+struct Pipeline
+{  NODE(Pipeline);
+   UBYTE *hostname;
+   long port;
+   BOOL ssl;
+   BOOL broken;               /* A sent request was cancelled */
+   LIST(Piperequest) requests;   /* Waiting requests in order */
+   long nrequests;
+   long nsent;                /* Sent requests without response read */
+   struct Library *socketbase;   /* Connection passed to the next request: */
+   long sock;
+   struct Assl *assl;
+   long requests_left;
+   UBYTE *rest;               /* Bytes received after the previous response */
+   long restlength;
+};
+
+static LIST(Pipeline) pipelines;
+static struct SignalSemaphore pipesema;
 
 /* Redirect loop protection - track redirects across HTTP requests */
 static int redirect_count=0;
@@ -225,47 +287,29 @@ static void debug_printf(const char *format, ...)
 /*-----------------------------------------------------------------------*/
 
 static void Messageread(struct Fetchdriver *fd,long n)
-{  UBYTE buf[64];
+{  UBYTE buf[64],*status;
    strcpy(buf,AWEBSTR(MSG_AWEB_BYTESREAD));
    strcat(buf,": ");
    sprintf(buf+strlen(buf),"%d",n);
-   Updatetaskattrs(
-      AOURL_Status,buf,
-      TAG_END);
+   if(status=Dupstr(buf,-1))
+   {  Updatetaskattrs(AOTSK_Async,TRUE,
+         AOTSK_Replace,TRUE,
+         AOTSK_Handoff,status,
+         AOURL_Status,status,
+         TAG_END);
+   }
 }
 
 /* Forward declarations */
 static void CleanupKeepAlivePool(void);
+static void Sendpipeline(struct Httpinfo *hi);
 
-/* Normalize hostname for comparison (strips www. prefix if present) */
-/* This allows www.example.com and example.com to match for connection pooling */
-static UBYTE *NormalizeHostname(UBYTE *hostname)
-{  if(!hostname) return NULL;
-   
-   /* Check if hostname starts with "www." (case-insensitive) */
-   if(strlen((char *)hostname) > 4 && 
-      (hostname[0] == 'w' || hostname[0] == 'W') &&
-      (hostname[1] == 'w' || hostname[1] == 'W') &&
-      (hostname[2] == 'w' || hostname[2] == 'W') &&
-      hostname[3] == '.')
-   {  /* Return pointer to hostname without www. prefix */
-      return hostname + 4;
-   }
-   
-   return hostname;
-}
-
-/* Compare two hostnames for connection pooling (handles www. prefix) */
+/* Compare two hostnames for connection pooling. Only the same host may use
+ * a connection: www.example.com and example.com can be different servers,
+ * and a TLS connection is only valid for the name it was made for. */
 static BOOL HostnameMatches(UBYTE *hostname1, UBYTE *hostname2)
-{  UBYTE *norm1;
-   UBYTE *norm2;
-   
-   if(!hostname1 || !hostname2) return FALSE;
-   
-   norm1 = NormalizeHostname(hostname1);
-   norm2 = NormalizeHostname(hostname2);
-   
-   return (BOOL)STRIEQUAL(norm1, norm2);
+{  if(!hostname1 || !hostname2) return FALSE;
+   return (BOOL)STRIEQUAL(hostname1, hostname2);
 }
 
 /* Free a connection node and all its resources */
@@ -306,7 +350,7 @@ static struct KeepAliveConnection *GetKeepAliveConnection(UBYTE *hostname, long
       if(!conn->in_use && conn->port == port && conn->ssl == ssl &&
          conn->hostname && HostnameMatches(conn->hostname, hostname))
       {  ULONG age = current_sec - conn->last_used;
-         if(age < KEEPALIVE_TIMEOUT)
+         if(age < conn->timeout)
          {  conn->in_use = TRUE;
             conn->last_used = current_sec;
             Remove((struct Node *)conn);
@@ -329,7 +373,7 @@ static struct KeepAliveConnection *GetKeepAliveConnection(UBYTE *hostname, long
          !conn->in_use && conn->port == port && conn->ssl == ssl &&
          conn->hostname && HostnameMatches(conn->hostname, hostname))
       {  ULONG age = current_sec - conn->last_used;
-         if(age < KEEPALIVE_TIMEOUT)
+         if(age < conn->timeout)
          {  conn->in_use = TRUE;
             conn->last_used = current_sec;
             Remove((struct Node *)conn);
@@ -368,15 +412,30 @@ static void ReturnKeepAliveConnection(struct Httpinfo *hi)
    struct timeval current_time;
    ULONG current_sec;
    ULONG age;  /* C89: Declare at start */
+   ULONG timeout;
    int pool_count = 0;
    
    if(!keepalive_sema_initialized || !hi || !hi->hostname) return;
    
+   /* Limit the idle time and number of requests to what the server allows.
+    * Leave a second of margin so we don't send a request just as the server
+    * closes the connection. */
+   hi->requests_left--;
+   if(hi->keepalive_max>=0 && hi->keepalive_max<hi->requests_left)
+      hi->requests_left=hi->keepalive_max;
+   timeout=KEEPALIVE_TIMEOUT;
+   if(hi->keepalive_timeout>0 && hi->keepalive_timeout-1<timeout)
+      timeout=hi->keepalive_timeout-1;
+   
    /* CRITICAL FIX: Do NOT pool if server requested close */
    /* Check flags AND explicit Connection header parsing result */
    /* If HTTPIF_KEEPALIVE is NOT set, it means server said "close" or didn't say "keep-alive" on HTTP/1.0 */
-   if(!(hi->flags & HTTPIF_KEEPALIVE))
-   {  debug_printf("DEBUG: ReturnKeepAliveConnection: Server requested close (no KEEPALIVE flag), closing connection\n");
+   /* Also don't pool if the response was not read up to its end, the next
+    * response would start with the rest of it. */
+   if(!(hi->flags & HTTPIF_KEEPALIVE) || !(hi->flags & HTTPIF_REUSABLE)
+   || hi->requests_left<=0 || timeout==0)
+   {  debug_printf("DEBUG: ReturnKeepAliveConnection: Connection can't be reused (flags=0x%04lX, requests left=%ld), closing connection\n",
+         hi->flags, hi->requests_left);
       /* Close it now */
 #ifndef DEMOVERSION
       if(hi->assl) Assl_closessl(hi->assl);
@@ -411,10 +470,16 @@ static void ReturnKeepAliveConnection(struct Httpinfo *hi)
    conn->hostname = Dupstr(hi->hostname, -1);
    conn->port = (hi->port > 0) ? hi->port : (BOOLVAL(hi->flags & HTTPIF_SSL) ? 443 : 80);
    conn->ssl = BOOLVAL(hi->flags & HTTPIF_SSL);
+#ifndef DEMOVERSION
+   /* Keep the TLS session in case this connection is not reused */
+   if(hi->assl) Assl_savesession(hi->assl);
+#endif
    conn->socketbase = hi->socketbase;
    conn->sock = hi->sock;
    conn->assl = hi->assl;
    conn->last_used = current_sec;
+   conn->timeout = timeout;
+   conn->requests_left = hi->requests_left;
    conn->in_use = FALSE;
 
    ObtainSemaphore(&keepalive_sema);
@@ -426,7 +491,7 @@ static void ReturnKeepAliveConnection(struct Httpinfo *hi)
       
       age = current_sec - node->last_used;
       
-      if(age >= KEEPALIVE_TIMEOUT)
+      if(age >= node->timeout)
       {  /* Remove expired */
          Remove((struct Node *)node);
          node->next = kill_list;
@@ -441,7 +506,7 @@ static void ReturnKeepAliveConnection(struct Httpinfo *hi)
    node = (struct KeepAliveConnection *)keepalive_pool.last;
    if(node && (struct Node *)node != (struct Node *)&keepalive_pool)
    {  age = current_sec - node->last_used;
-      if(age >= KEEPALIVE_TIMEOUT)
+      if(age >= node->timeout)
       {  /* Remove expired */
          Remove((struct Node *)node);
          node->next = kill_list;
@@ -504,7 +569,7 @@ static void CleanupKeepAlivePool(void)
    for(conn = (struct KeepAliveConnection *)keepalive_pool.first; conn->next; conn = next)
    {  next = (struct KeepAliveConnection *)conn->next;
       
-      if(conn->in_use || ((current_sec - conn->last_used) >= KEEPALIVE_TIMEOUT))
+      if(conn->in_use || ((current_sec - conn->last_used) >= conn->timeout))
       {  Remove((struct Node *)conn);
          conn->next = close_list;
          close_list = conn;
@@ -514,7 +579,7 @@ static void CleanupKeepAlivePool(void)
    /* Check the last node */
    conn = (struct KeepAliveConnection *)keepalive_pool.last;
    if(conn && (struct Node *)conn != (struct Node *)&keepalive_pool)
-   {  if(conn->in_use || ((current_sec - conn->last_used) >= KEEPALIVE_TIMEOUT))
+   {  if(conn->in_use || ((current_sec - conn->last_used) >= conn->timeout))
       {  Remove((struct Node *)conn);
          conn->next = close_list;
          close_list = conn;
@@ -529,20 +594,24 @@ static void CleanupKeepAlivePool(void)
    }
 }
 
-/* Close all idle (not in-use) keep-alive connections */
-/* This is called when navigating to a new page to reset the connection pool */
-/* CRITICAL: Only closes connections that have exceeded KEEPALIVE_TIMEOUT */
+/* Close idle keep-alive connections that have timed out */
+/* This is called when navigating to a new page. Connections that are still
+ * fresh are kept, the new page is likely to come from the same servers. */
 void CloseIdleKeepAliveConnections(void)
 {  struct KeepAliveConnection *conn;
    struct KeepAliveConnection *next;
    struct KeepAliveConnection *close_list = NULL;
+   struct timeval current_time;
+   ULONG current_sec;
    
    if(!keepalive_sema_initialized) return;
    
    ObtainSemaphore(&keepalive_sema);
+   GetSysTime(&current_time);
+   current_sec = current_time.tv_secs;
    for(conn = (struct KeepAliveConnection *)keepalive_pool.first; conn && conn->next; conn = next)
    {  next = (struct KeepAliveConnection *)conn->next;
-      if(!conn->in_use)
+      if(!conn->in_use && (current_sec - conn->last_used) >= conn->timeout)
       {  Remove((struct Node *)conn);
          conn->next = close_list;
          close_list = conn;
@@ -551,7 +620,8 @@ void CloseIdleKeepAliveConnections(void)
    
    /* Check the last node */
    conn = (struct KeepAliveConnection *)keepalive_pool.last;
-   if(conn && (struct Node *)conn != (struct Node *)&keepalive_pool && !conn->in_use)
+   if(conn && (struct Node *)conn != (struct Node *)&keepalive_pool && !conn->in_use
+   && (current_sec - conn->last_used) >= conn->timeout)
    {  Remove((struct Node *)conn);
       conn->next = close_list;
       close_list = conn;
@@ -566,6 +636,13 @@ void CloseIdleKeepAliveConnections(void)
    }
 }
 
+/* Get the number of connections opened, and the number of requests that
+ * reused a pooled connection. */
+void Httpconnstats(ULONG *opened,ULONG *reused)
+{  *opened=connections_opened;
+   *reused=connections_reused;
+}
+
 static BOOL Makehttpaddr(struct Httpinfo *hi,UBYTE *proxy,UBYTE *url,BOOL ssl)
 {  UBYTE *p,*q,*r,*u;
    UBYTE *userid=NULL,*passwd=NULL;
@@ -803,26 +880,51 @@ static long Receive(struct Httpinfo *hi,UBYTE *buffer,long length)
 
 
 
-/* Read remainder of block. Returns FALSE if eof or error. */
+/* Move the unconsumed bytes to the start of the block. */
+static void Compactblock(struct Httpinfo *hi)
+{  long n=hi->blocklength-hi->blockstart;
+   if(hi->blockstart)
+   {  if(n>0) memmove(hi->fd->block,hi->fd->block+hi->blockstart,n);
+      else n=0;
+      hi->nextscanpos-=hi->blockstart;
+      if(hi->nextscanpos<0) hi->nextscanpos=0;
+      hi->blockstart=0;
+      hi->blocklength=n;
+   }
+}
+
+/* Read remainder of block. Returns FALSE if eof or error.
+ * The block is used as a receive buffer: data between blockstart and blocklength
+ * is unconsumed. Consumers only advance blockstart, so the remaining bytes are
+ * moved to the front only when there is little room left at the end. */
 static BOOL Readblock(struct Httpinfo *hi)
 {  long n;
    debug_printf("DEBUG: Readblock() called, current blocklength=%ld\n", hi->blocklength);
    
+   if(hi->blockstart>=hi->blocklength)
+   {  hi->blockstart=hi->blocklength=hi->nextscanpos=0;
+   }
+   else if(hi->blockstart && hi->fd->blocksize-hi->blocklength<hi->fd->blocksize/4)
+   {  Compactblock(hi);
+   }
 #ifdef DEVELOPER
-   UBYTE *block;
-   if(!hi->socketbase)
-   {  block=fgets(hi->fd->block+hi->blocklength,hi->fd->blocksize-hi->blocklength,
-         (FILE *)hi->sock);
-      n=block?strlen(block):0;
-      /* for some reason, we get a bogus 'G' in the second console window */
-      if(STRNEQUAL(hi->fd->block,"GHTTP/",6))
-      {  memmove(hi->fd->block,hi->fd->block+1,n-1);
-         n--;
+   {  UBYTE *block;
+      if(!hi->socketbase)
+      {  block=fgets(hi->fd->block+hi->blocklength,hi->fd->blocksize-hi->blocklength,
+            (FILE *)hi->sock);
+         n=block?strlen(block):0;
+         /* for some reason, we get a bogus 'G' in the second console window */
+         if(block && STRNEQUAL(block,"GHTTP/",6))
+         {  memmove(block,block+1,n-1);
+            n--;
+         }
       }
+      else
+         n=Receive(hi,hi->fd->block+hi->blocklength,hi->fd->blocksize-hi->blocklength);
    }
-   else
-#endif
+#else
    n=Receive(hi,hi->fd->block+hi->blocklength,hi->fd->blocksize-hi->blocklength);
+#endif
    
    debug_printf("DEBUG: Readblock: Receive returned %ld bytes\n", n);
    
@@ -907,6 +1009,7 @@ static BOOL Readblock(struct Httpinfo *hi)
    {  debug_printf("DEBUG: Readblock: no data received (EOF), returning FALSE\n");
       return FALSE;
    }
+   hi->flags|=HTTPIF_RESPONSE;
    
    /* CRITICAL: Prevent buffer overflow from extremely long headers (e.g., GitHub's 3700+ byte Content-Security-Policy) */
    /* Clamp received bytes to available buffer space */
@@ -952,32 +1055,34 @@ static BOOL Readblock(struct Httpinfo *hi)
    return TRUE;
 }
 
-/* Remove the first part from the block. */
+/* Consume the current line from the block. */
 static void Nextline(struct Httpinfo *hi)
-{  long old_blocklength = hi->blocklength;
-   if(hi->nextscanpos<hi->blocklength)
-   {  memmove(hi->fd->block,hi->fd->block+hi->nextscanpos,hi->blocklength-hi->nextscanpos);
+{  if(hi->nextscanpos>hi->blockstart)
+   {  hi->blockstart=MIN(hi->nextscanpos,hi->blocklength);
    }
-   hi->blocklength-=hi->nextscanpos;
-   hi->nextscanpos=0;
-   debug_printf("DEBUG: Nextline: consumed %ld bytes, remaining blocklength=%ld\n", 
-          old_blocklength - hi->blocklength, hi->blocklength);
+   hi->nextscanpos=hi->blockstart;
+   debug_printf("DEBUG: Nextline: consumed up to %ld, remaining %ld\n",
+          hi->blockstart, hi->blocklength-hi->blockstart);
 }
 
 /* Find a complete line. Read again if no complete line found. */
 static BOOL Findline(struct Httpinfo *hi)
-{  UBYTE *p=hi->fd->block;
-   UBYTE *end;
+{  long scanned=0;
+   UBYTE *p,*end;
    for(;;)
-   {  end=hi->fd->block+hi->blocklength;
+   {  /* Readblock may move the unconsumed data, so scan relative to blockstart */
+      p=hi->fd->block+hi->blockstart+scanned;
+      end=hi->fd->block+hi->blocklength;
       while(p<end && *p!='\n') p++;
       if(p<end) break;
+      scanned=p-(hi->fd->block+hi->blockstart);
       if(!Readblock(hi)) return FALSE;
    }
    /* Now we've got a LF. Terminate line here, but if it is preceded by CR ignore that too. */
    *p='\0';
-   hi->linelength=p-hi->fd->block;
-   hi->nextscanpos=hi->linelength+1;
+   hi->line=hi->fd->block+hi->blockstart;
+   hi->linelength=p-hi->line;
+   hi->nextscanpos=hi->blockstart+hi->linelength+1;
    if(hi->linelength)
    {  p--;
       if(*p=='\r')
@@ -986,7 +1091,7 @@ static BOOL Findline(struct Httpinfo *hi)
       }
    }
    if(httpdebug)
-   {  Write(Output(),hi->fd->block,hi->linelength);
+   {  Write(Output(),hi->line,hi->linelength);
       Write(Output(),"\n",1);
    }
    return TRUE;
@@ -1015,12 +1120,12 @@ static struct Authorize *Parseauth(UBYTE *buf,UBYTE *server)
  * Returns FALSE if eof or error, or data should be skipped. */
 static BOOL Readheaders(struct Httpinfo *hi)
 {     /* Reset encoding flags at start of headers - this is crucial! */
-   hi->flags &= ~(HTTPIF_GZIPENCODED | HTTPIF_GZIPDECODING | HTTPIF_CHUNKED);
+   hi->flags &= ~(HTTPIF_GZIPENCODED | HTTPIF_DEFLATEENCODED | HTTPIF_CHUNKED);
    
    /* Default assumption based on protocol version */
    /* For HTTP/1.1, Keep-Alive is default. For 1.0, it's not. */
    /* We assume 1.1 default if we requested it, BUT we must clear it if server says close */
-   if(hi->flags & HTTPIF_KEEPALIVE_REQ)
+   if((hi->flags & HTTPIF_KEEPALIVE_REQ) && !(hi->flags & HTTPIF_HTTP10))
    {  hi->flags |= HTTPIF_KEEPALIVE;
       debug_printf("DEBUG: Assuming keep-alive support for HTTP/1.1 (will be cleared if server says 'close')\n");
    }
@@ -1039,37 +1144,37 @@ static BOOL Readheaders(struct Httpinfo *hi)
          }
       }
       Updatetaskattrs(
-         AOURL_Header,hi->fd->block,
+         AOURL_Header,hi->line,
          TAG_END);
-      debug_printf("DEBUG: Processing header: '%s'\n", hi->fd->block);
+      debug_printf("DEBUG: Processing header: '%s'\n", hi->line);
       
-      if(STRNIEQUAL(hi->fd->block,"Date:",5))
-      {  hi->fd->serverdate=Scandate(hi->fd->block+5);
+      if(STRNIEQUAL(hi->line,"Date:",5))
+      {  hi->fd->serverdate=Scandate(hi->line+5);
          Updatetaskattrs(
             AOURL_Serverdate,hi->fd->serverdate,
             TAG_END);
       }
-      else if(STRNIEQUAL(hi->fd->block,"Last-Modified:",14))
-      {  ULONG date=Scandate(hi->fd->block+14);
+      else if(STRNIEQUAL(hi->line,"Last-Modified:",14))
+      {  ULONG date=Scandate(hi->line+14);
          Updatetaskattrs(
             AOURL_Lastmodified,date,
             TAG_END);
       }
-      else if(STRNIEQUAL(hi->fd->block,"Expires:",8))
-      {  long expires=Scandate(hi->fd->block+8);
+      else if(STRNIEQUAL(hi->line,"Expires:",8))
+      {  long expires=Scandate(hi->line+8);
          Updatetaskattrs(
             AOURL_Expires,expires,
             TAG_END);
       }
-      else if(STRNIEQUAL(hi->fd->block,"Content-Length:",15))
+      else if(STRNIEQUAL(hi->line,"Content-Length:",15))
       {  long i=0;
-         sscanf(hi->fd->block+15," %ld",&i);
+         sscanf(hi->line+15," %ld",&i);
          hi->partlength = i; /* Store for use in Readdata to track compressed data consumption */
          Updatetaskattrs(
             AOURL_Contentlength,i,
             TAG_END);
       }
-      else if(STRNIEQUAL(hi->fd->block,"Content-Type:",13))
+      else if(STRNIEQUAL(hi->line,"Content-Type:",13))
       {  UBYTE mimetype[32];
          UBYTE *p,*q,*r;
          UBYTE qq;
@@ -1077,10 +1182,10 @@ static BOOL Readheaders(struct Httpinfo *hi)
          BOOL foreign=FALSE;
          BOOL forward=TRUE;
          
-         debug_printf("DEBUG: Content-Type header found in Readheaders: '%s'\n", hi->fd->block);
+         debug_printf("DEBUG: Content-Type header found in Readheaders: '%s'\n", hi->line);
          mimetype[0] = '\0';  /* Initialize empty string */
          if(!prefs.ignoremime)
-         {  for(p=hi->fd->block+13;*p && isspace(*p);p++);
+         {  for(p=hi->line+13;*p && isspace(*p);p++);
             for(q=p;*q && !isspace(*q) && *q!=';';q++);
             qq=*q;
             *q='\0';
@@ -1143,20 +1248,25 @@ static BOOL Readheaders(struct Httpinfo *hi)
             hi->parttype[0] = '\0';
          }
       }
-      else if(STRNIEQUAL(hi->fd->block,"Content-Encoding:",17))
-      {  if(strstr(hi->fd->block+18,"gzip"))
+      else if(STRNIEQUAL(hi->line,"Content-Encoding:",17))
+      {  if(strstr(hi->line+18,"gzip"))
          {  hi->flags|=HTTPIF_GZIPENCODED;
             debug_printf("DEBUG: Detected gzip encoding\n");
             Updatetaskattrs(AOURL_Contentlength,0,TAG_END);
          }
+         else if(strstr(hi->line+18,"deflate"))
+         {  hi->flags|=HTTPIF_DEFLATEENCODED;
+            debug_printf("DEBUG: Detected deflate encoding\n");
+            Updatetaskattrs(AOURL_Contentlength,0,TAG_END);
+         }
       }
-      else if(STRNIEQUAL(hi->fd->block,"Transfer-Encoding:",18))
-      {  if(strstr(hi->fd->block+18,"chunked"))
+      else if(STRNIEQUAL(hi->line,"Transfer-Encoding:",18))
+      {  if(strstr(hi->line+18,"chunked"))
          {  hi->flags|=HTTPIF_CHUNKED;
             debug_printf("DEBUG: Detected chunked transfer encoding\n");
          }
       }
-      else if(STRNIEQUAL(hi->fd->block,"Connection:",11))
+      else if(STRNIEQUAL(hi->line,"Connection:",11))
       {  /* Parse Connection header to detect keep-alive support */
          /* Connection header can be a comma-separated list: "Upgrade, close" or "keep-alive, close" */
          /* We must check ALL tokens, not just the first one */
@@ -1167,7 +1277,7 @@ static BOOL Readheaders(struct Httpinfo *hi)
          BOOL found_close = FALSE;
          BOOL found_keepalive = FALSE;
          
-         for(p=hi->fd->block+11;*p && isspace(*p);p++);
+         for(p=hi->line+11;*p && isspace(*p);p++);
          
          /* Parse comma-separated tokens */
          while(*p)
@@ -1212,10 +1322,20 @@ static BOOL Readheaders(struct Httpinfo *hi)
             debug_printf("DEBUG: Server sent Connection: keep-alive\n");
          }
       }
-      else if(STRNIEQUAL(hi->fd->block,"Accept-Ranges:",14))
+      else if(STRNIEQUAL(hi->line,"Keep-Alive:",11))
+      {  /* Keep-Alive: timeout=5, max=100 */
+         UBYTE *p;
+         if(p=strstr(hi->line+11,"timeout="))
+         {  sscanf(p+8,"%ld",&hi->keepalive_timeout);
+         }
+         if(p=strstr(hi->line+11,"max="))
+         {  sscanf(p+4,"%ld",&hi->keepalive_max);
+         }
+      }
+      else if(STRNIEQUAL(hi->line,"Accept-Ranges:",14))
       {  /* Parse Accept-Ranges header to detect Range request support */
          UBYTE *p;
-         for(p=hi->fd->block+14;*p && isspace(*p);p++);
+         for(p=hi->line+14;*p && isspace(*p);p++);
          
          /* Check if server supports Range requests (Accept-Ranges: bytes) */
          if(STRNIEQUAL(p, "bytes", 5))
@@ -1227,7 +1347,7 @@ static BOOL Readheaders(struct Httpinfo *hi)
             debug_printf("DEBUG: Server does not support Range requests (Accept-Ranges: %s)\n", p);
          }
       }
-      else if(STRNIEQUAL(hi->fd->block,"Content-Range:",14))
+      else if(STRNIEQUAL(hi->line,"Content-Range:",14))
       {  long start;  /* C89: Declare all variables at start */
          long end;
          long total;
@@ -1235,7 +1355,7 @@ static BOOL Readheaders(struct Httpinfo *hi)
          
          /* Parse Content-Range header for 206 Partial Content responses */
          /* Format: bytes start-end/total or bytes asterisk-slash-total/total */
-         for(p=hi->fd->block+14;*p && isspace(*p);p++);
+         for(p=hi->line+14;*p && isspace(*p);p++);
          
          if(STRNIEQUAL(p, "bytes ", 6))
          {  p += 6;
@@ -1254,9 +1374,9 @@ static BOOL Readheaders(struct Httpinfo *hi)
             }
          }
       }
-      else if(STRNIEQUAL(hi->fd->block,"ETag:",5))
+      else if(STRNIEQUAL(hi->line,"ETag:",5))
       {  UBYTE *p,*q;
-         for(p=hi->fd->block+5;*p && isspace(*p);p++);
+         for(p=hi->line+5;*p && isspace(*p);p++);
          for(q=p;*q && !isspace(*q) && *q!=';';q++);
          *q='\0';
          if(q-p>63) p[63]='\0';
@@ -1265,9 +1385,9 @@ static BOOL Readheaders(struct Httpinfo *hi)
          if(hi->fd->etag) FREE(hi->fd->etag);
          hi->fd->etag=Dupstr(p,-1);
       }
-      else if(STRNIEQUAL(hi->fd->block,"Content-Disposition:",20))
+      else if(STRNIEQUAL(hi->line,"Content-Disposition:",20))
       {  UBYTE *p,*q;
-         for(p=hi->fd->block+21;*p && isspace(*p);p++);
+         for(p=hi->line+21;*p && isspace(*p);p++);
          for(q=p;*q && !isspace(*q) && *q!=';';q++);
          *q='\0';
          if(STRIEQUAL(p,"attachment"))
@@ -1280,18 +1400,18 @@ static BOOL Readheaders(struct Httpinfo *hi)
             }
          }
       }
-      else if(STRNIEQUAL(hi->fd->block,"Content-script-type:",20))
+      else if(STRNIEQUAL(hi->line,"Content-script-type:",20))
       {  UBYTE *p,*q;
-         for(p=hi->fd->block+20;*p && isspace(*p);p++);
+         for(p=hi->line+20;*p && isspace(*p);p++);
          for(q=p;*q && !isspace(*q) && *q!=';';q++);
          *q='\0';
          Updatetaskattrs(
             AOURL_Contentscripttype,p,
             TAG_END);
       }
-      else if(STRNIEQUAL(hi->fd->block,"Pragma:",7))
+      else if(STRNIEQUAL(hi->line,"Pragma:",7))
       {  UBYTE *p,*q;
-         for(p=hi->fd->block+7;*p && isspace(*p);p++);
+         for(p=hi->line+7;*p && isspace(*p);p++);
          for(q=p;*q && !isspace(*q) && *q!=';';q++);
          *q='\0';
          if(STRIEQUAL(p,"no-cache"))
@@ -1300,9 +1420,9 @@ static BOOL Readheaders(struct Httpinfo *hi)
                TAG_END);
          }
       }
-      else if(STRNIEQUAL(hi->fd->block,"Cache-Control:",14))
+      else if(STRNIEQUAL(hi->line,"Cache-Control:",14))
       {  UBYTE *p,*q;
-         for(p=hi->fd->block+14;*p && isspace(*p);p++);
+         for(p=hi->line+14;*p && isspace(*p);p++);
          for(q=p;*q && !isspace(*q) && *q!='\r' && *q!='\n';q++);
          *q='\0';
          if(STRIEQUAL(p,"no-cache") || STRIEQUAL(p,"no-store"))
@@ -1320,33 +1440,33 @@ static BOOL Readheaders(struct Httpinfo *hi)
             }
          }
       }
-      else if(hi->movedto && STRNIEQUAL(hi->fd->block,"Location:",9))
+      else if(hi->movedto && STRNIEQUAL(hi->line,"Location:",9))
       {  UBYTE *p;
          UBYTE *q;
-         for(p=hi->fd->block+9;*p && isspace(*p);p++);
+         for(p=hi->line+9;*p && isspace(*p);p++);
          for(q=p+strlen(p)-1;q>p && isspace(*q);q--);
          if(hi->movedtourl) FREE(hi->movedtourl);
          hi->movedtourl=Dupstr(p,q-p+1);
          debug_printf("DEBUG: Set movedtourl to: %s\n", hi->movedtourl ? (char *)hi->movedtourl : "(NULL)");
       }
-      else if(hi->status==401 && STRNIEQUAL(hi->fd->block,"WWW-Authenticate:",17))
-      {  struct Authorize *newauth=Parseauth(hi->fd->block+17,hi->hostport);
+      else if(hi->status==401 && STRNIEQUAL(hi->line,"WWW-Authenticate:",17))
+      {  struct Authorize *newauth=Parseauth(hi->line+17,hi->hostport);
          if(newauth)
          {  if(hi->auth) Freeauthorize(hi->auth);
             hi->auth=newauth;
          }
       }
-      else if(hi->status==407 && STRNIEQUAL(hi->fd->block,"Proxy-Authenticate:",19)
+      else if(hi->status==407 && STRNIEQUAL(hi->line,"Proxy-Authenticate:",19)
       && hi->fd->proxy)
       {  if(hi->prxauth) Freeauthorize(hi->prxauth);
-         hi->prxauth=Parseauth(hi->fd->block+19,hi->fd->proxy);
+         hi->prxauth=Parseauth(hi->line+19,hi->fd->proxy);
       }
-      else if(STRNIEQUAL(hi->fd->block,"Set-Cookie:",11))
-      {  if(prefs.cookies) Storecookie(hi->fd->name,hi->fd->block+11,hi->fd->serverdate);
+      else if(STRNIEQUAL(hi->line,"Set-Cookie:",11))
+      {  if(prefs.cookies) Storecookie(hi->fd->name,hi->line+11,hi->fd->serverdate);
       }
-      else if(STRNIEQUAL(hi->fd->block,"Refresh:",8))
+      else if(STRNIEQUAL(hi->line,"Refresh:",8))
       {  Updatetaskattrs(
-            AOURL_Clientpull,hi->fd->block+8,
+            AOURL_Clientpull,hi->line+8,
             TAG_END);
       }
       Nextline(hi);
@@ -1355,19 +1475,22 @@ static BOOL Readheaders(struct Httpinfo *hi)
 
 /* Read the HTTP response. Returns TRUE if HTTP, FALSE if plain response. */
 static BOOL Readresponse(struct Httpinfo *hi)
-{  long stat=0;
+{  long stat=0,major=0,minor=0;
    BOOL http=FALSE;
-   do
+   /* A pipelined response may already be in the block */
+   while(hi->blocklength-hi->blockstart<5)
    {  if(!Readblock(hi)) return FALSE;
-   } while(hi->blocklength<5);
-   if(STRNEQUAL(hi->fd->block,"HTTP/",5))
+   }
+   if(STRNEQUAL(hi->fd->block+hi->blockstart,"HTTP/",5))
    {  if(!Findline(hi)) return FALSE;
       hi->movedto=TAG_IGNORE;
-      sscanf(hi->fd->block+5,"%*d.%*d %ld",&stat);
+      sscanf(hi->line+5,"%ld.%ld %ld",&major,&minor,&stat);
+      if(major<1 || (major==1 && minor==0)) hi->flags|=HTTPIF_HTTP10;
       debug_printf("DEBUG: HTTP status code: %ld\n", stat);
       Updatetaskattrs(
-         AOURL_Header,hi->fd->block,
+         AOURL_Header,hi->line,
          TAG_END);
+      if(stat==204 || stat==304) hi->flags|=HTTPIF_NOBODY;
       if(stat<400)
       {  hi->flags|=HTTPIF_TUNNELOK;
          if(stat==301) hi->movedto=AOURL_Movedto;
@@ -1448,16 +1571,16 @@ static BOOL Readpartheaders(struct Httpinfo *hi)
          else return TRUE;
       }
       Updatetaskattrs(
-         AOURL_Header,hi->fd->block,
+         AOURL_Header,hi->line,
          TAG_END);
-      if(STRNIEQUAL(hi->fd->block,"Content-Length:",15))
-      {  sscanf(hi->fd->block+15," %ld",&hi->partlength);
+      if(STRNIEQUAL(hi->line,"Content-Length:",15))
+      {  sscanf(hi->line+15," %ld",&hi->partlength);
       }
-      else if(STRNIEQUAL(hi->fd->block,"Content-Type:",13))
-      {  debug_printf("DEBUG: Content-Type header found in Readpartheaders: '%s'\n", hi->fd->block);
+      else if(STRNIEQUAL(hi->line,"Content-Type:",13))
+      {  debug_printf("DEBUG: Content-Type header found in Readpartheaders: '%s'\n", hi->line);
          if(!prefs.ignoremime)
          {  UBYTE *p,*q;
-            for(p=hi->fd->block+13;*p && isspace(*p);p++);
+            for(p=hi->line+13;*p && isspace(*p);p++);
             q=strchr(p,';');
             if(q) *q='\0';
             if(strlen(p)>31) p[31]='\0';
@@ -1469,3363 +1592,419 @@ static BOOL Readpartheaders(struct Httpinfo *hi)
    }
 }
 
+/* Get the error code of the last failed socket call */
+static long Socketerrno(struct Httpinfo *hi)
+{  long errno_value=0;
+   if(hi->socketbase)
+   {  struct Library *saved_socketbase=SocketBase;
+      SocketBase=hi->socketbase;
+      errno_value=Errno();
+      SocketBase=saved_socketbase;
+   }
+   return errno_value;
+}
+
+/* Pass the pending body data to the main task, together with the block it
+ * lies in. Go on in a fresh block that holds the unconsumed bytes. */
+static void Flushbody(struct Httpinfo *hi)
+{  UBYTE *block;
+   long n;
+   if(!hi->pendinglength) return;
+   if(block=ALLOCTYPE(UBYTE,hi->fd->blocksize,MEMF_PUBLIC))
+   {  n=hi->blocklength-hi->blockstart;
+      if(n>0) memmove(block,hi->fd->block+hi->blockstart,n);
+      else n=0;
+      Updatetaskattrs(AOTSK_Async,TRUE,
+         AOTSK_Handoff,hi->fd->block,
+         AOURL_Data,hi->pending,
+         AOURL_Datalength,hi->pendinglength,
+         TAG_END);
+      hi->fd->block=block;
+      hi->nextscanpos-=hi->blockstart;
+      if(hi->nextscanpos<0) hi->nextscanpos=0;
+      hi->blockstart=0;
+      hi->blocklength=n;
+   }
+   else
+   {  Updatetaskattrs(
+         AOURL_Data,hi->pending,
+         AOURL_Datalength,hi->pendinglength,
+         TAG_END);
+   }
+   hi->pendinglength=0;
+}
+
+/* Pass decoded body data to the main task. */
+static BOOL Httpsink(void *userdata,UBYTE *data,long length)
+{  struct Httpinfo *hi=(struct Httpinfo *)userdata;
+   UBYTE *buffer;
+   if(!(hi->flags&(HTTPIF_GZIPENCODED|HTTPIF_DEFLATEENCODED)))
+   {  /* Resume point for a Range request retry */
+      hi->bytes_received+=length;
+   }
+   /* Parts of a multipart response carry their type in (hi), so wait for those.
+    * Otherwise the main task gets the memory the data lies in, so we can go on
+    * reading without copying it. */
+   if(!length || *hi->parttype)
+   {  Flushbody(hi);
+      Updatetaskattrs(
+         AOURL_Data,data,
+         AOURL_Datalength,length,
+         *hi->parttype?AOURL_Contenttype:TAG_IGNORE,hi->parttype,
+         TAG_END);
+   }
+   else if(hi->decoder && data==hi->decoder->buffer
+   && (buffer=ALLOCTYPE(UBYTE,hi->decoder->bufsize,0)))
+   {  /* Inflated data, hand off the output buffer */
+      Updatetaskattrs(AOTSK_Async,TRUE,
+         AOTSK_Handoff,data,
+         AOURL_Data,data,
+         AOURL_Datalength,length,
+         TAG_END);
+      hi->decoder->buffer=buffer;
+   }
+   else if(data>=hi->fd->block && data+length<=hi->fd->block+hi->fd->blocksize)
+   {  /* Data in the block. Keep it pending until the block is handed off
+       * by Flushbody(); earlier data in the same block can go now because
+       * updates are processed in order. */
+      if(hi->pendinglength && hi->pending+hi->pendinglength==data)
+      {  hi->pendinglength+=length;
+      }
+      else
+      {  if(hi->pendinglength)
+         {  Updatetaskattrs(AOTSK_Async,TRUE,
+               AOURL_Data,hi->pending,
+               AOURL_Datalength,hi->pendinglength,
+               TAG_END);
+         }
+         hi->pending=data;
+         hi->pendinglength=length;
+      }
+   }
+   else
+   {  Flushbody(hi);
+      Updatetaskattrs(
+         AOURL_Data,data,
+         AOURL_Datalength,length,
+         TAG_END);
+   }
+   return (BOOL)!Checktaskbreak();
+}
+
+/* Read one part of a multipart response, up to the next boundary.
+ * Returns TRUE if another part follows. */
+static BOOL Readpartdata(struct Httpinfo *hi)
+{  long bdlength=strlen(hi->boundary),length;
+   UBYTE *start,*end,*p,*q;
+   BOOL boundary,partial,eof;
+   for(;;)
+   {  start=hi->fd->block+hi->blockstart;
+      end=hi->fd->block+hi->blocklength;
+      boundary=partial=eof=FALSE;
+      length=end-start;
+      /* Look for [CR]LF--<boundary>[--][CR]LF or any possible part thereof. */
+      for(p=start;;p++)
+      {  for(;p<end && *p!='\r' && *p!='\n';p++);
+         if(p>=end) break;
+         q=p;
+         if(*q=='\r' && (q>=end-1 || q[1]=='\n')) q++;  /* Skip CR */
+         q++;  /* Skip LF */
+         if(q>=end) partial=TRUE;
+         else if(STRNEQUAL(q,hi->boundary,MIN(bdlength,end-q)))
+         {  if(end-q<bdlength) partial=TRUE;
+            else
+            {  /* Now check if it's complete and followed by [CR]LF. */
+               q+=bdlength;
+               if(q<end && *q=='-') q++;
+               if(q<end && *q=='-')
+               {  eof=TRUE;
+                  q++;
+               }
+               if(q<end && *q=='\r') q++;
+               if(q>=end) partial=TRUE;
+               else if(*q=='\n') boundary=TRUE;
+            }
+         }
+         if(boundary || partial)
+         {  length=p-start;
+            break;
+         }
+      }
+      /* Pass the data before the (possible) boundary, keep the rest in the block */
+      if(length>0 && !Httpsink(hi,start,length))
+      {  Flushbody(hi);
+         return FALSE;
+      }
+      hi->blockstart+=length;
+      Flushbody(hi);
+      if(boundary) return (BOOL)!eof;
+      if(!Readblock(hi)) return FALSE;
+   }
+}
+
 /* Read data and pass to main task. Returns FALSE if error or connection eof, TRUE if
  * multipart boundary found. */
 static BOOL Readdata(struct Httpinfo *hi)
-{  UBYTE *bdcopy=NULL;
-   long bdlength=0,blocklength=0;
-   BOOL result=FALSE,boundary,partial,eof=FALSE;
-   long gzip_buffer_size=INPUTBLOCKSIZE;
-   UBYTE *gzipbuffer=NULL;
-   long gziplength=0;
-   long err=0;
-   UWORD gzip_end=0;
-   int loop_count=0;
-   long move_length;
-   z_stream d_stream;
-   BOOL d_stream_initialized=FALSE; /* Track if d_stream has been initialized */
-   BOOL exit_main_loop=FALSE; /* Flag to exit main loop for gzip processing */
-   long compressed_bytes_consumed=0; /* Track how much compressed data we've consumed for Content-Length validation */
-   long total_compressed_read=0; /* Track total compressed bytes READ from network (before copying to gzipbuffer) */
-   long total_bytes_received=0; /* Track total bytes received for non-gzip transfers with Content-Length */
-   long expected_total_size;  /* Expected total size (full file size for Range requests, partlength for regular) */
-   
-   debug_printf("DEBUG: Readdata: ENTRY - blocklength=%ld, flags=0x%04X, parttype='%s', sock=%ld, partlength=%ld\n",
-          hi->blocklength, hi->flags, hi->parttype ? (char *)hi->parttype : "(null)", hi->sock, hi->partlength);
-   
-   /* Initialize total_bytes_received from hi->bytes_received if using Range request */
-   /* Also calculate expected_total_size for proper completion checking */
-   if(hi->flags & HTTPIF_RANGE_REQUEST)
-   {  total_bytes_received = hi->bytes_received;
-      /* For Range requests, use full_file_size if available, otherwise use partlength */
-      expected_total_size = (hi->full_file_size > 0) ? hi->full_file_size : hi->partlength;
-      debug_printf("DEBUG: Readdata: Resuming with Range request, starting from byte %ld, expected total=%ld\n", hi->bytes_received, expected_total_size);
+{  struct Httpdecoder hd={0};
+   BOOL complete=FALSE;
+   long n;
+   if(hi->boundary) return Readpartdata(hi);
+   if(!(hi->flags&HTTPIF_RANGE_REQUEST)) hi->bytes_received=0;
+   if(hi->flags&HTTPIF_NOBODY)
+   {  hd.framing=HDFR_LENGTH;
+      hd.length=0;
+   }
+   else if(hi->flags&HTTPIF_CHUNKED)
+   {  hd.framing=HDFR_CHUNKED;
+   }
+   else if(hi->partlength>=0)
+   {  hd.framing=HDFR_LENGTH;
+      hd.length=hi->partlength;
+   }
+   else
+   {  hd.framing=HDFR_CLOSE;
+   }
+   if(hi->flags&HTTPIF_GZIPENCODED) hd.coding=HDCO_GZIP;
+   else if(hi->flags&HTTPIF_DEFLATEENCODED) hd.coding=HDCO_DEFLATE;
+   else hd.coding=HDCO_IDENTITY;
+   hd.sink=Httpsink;
+   hd.userdata=hi;
+   debug_printf("DEBUG: Readdata: framing=%d coding=%d length=%ld, %ld bytes in block\n",
+          hd.framing, hd.coding, hi->partlength, hi->blocklength-hi->blockstart);
+   if(hd.coding!=HDCO_IDENTITY)
+   {  hd.bufsize=hi->fd->blocksize;
+      hd.buffer=ALLOCTYPE(UBYTE,hd.bufsize,0);
+      hi->decoder=&hd;
+   }
+   /* Once it is known where this response ends, the waiting pipelined
+    * requests can be sent */
+   if(hi->pipeline && hd.framing!=HDFR_CLOSE
+   && (hi->flags&HTTPIF_KEEPALIVE) && (hi->flags&HTTPIF_KEEPALIVE_REQ))
+   {  hi->flags|=HTTPIF_PIPESEND;
+      Sendpipeline(hi);
+   }
+   if((hd.coding==HDCO_IDENTITY || hd.buffer) && Inithttpdecoder(&hd))
+   {  /* Decode straight from the receive block. Only the part of the block that
+       * belongs to this body is consumed. */
+      for(;;)
+      {  if(hi->blockstart<hi->blocklength)
+         {  n=Httpdecode(&hd,hi->fd->block+hi->blockstart,hi->blocklength-hi->blockstart);
+            hi->blockstart+=n;
+         }
+         if(hd.flags&(HDF_END|HDF_ERROR|HDF_STOP)) break;
+         Flushbody(hi);
+         if(hi->flags&HTTPIF_PIPESEND) Sendpipeline(hi);
+         if(!Readblock(hi)) break;
+      }
+      Flushbody(hi);
+      complete=Finishhttpdecoder(&hd);
+      debug_printf("DEBUG: Readdata: done, flags=0x%04X, %ld bytes decoded, complete=%d\n",
+             hd.flags, hd.decoded, complete);
+      /* The connection can only carry another request if this body ended
+       * where the framing says, and nothing followed it but the responses
+       * to pipelined requests. */
+      if(complete && hd.framing!=HDFR_CLOSE && !(hd.flags&HDF_STOP)
+      && (hi->blockstart>=hi->blocklength || (hi->pipeline && hi->pipeline->nsent)))
+      {  hi->flags|=HTTPIF_REUSABLE;
+      }
+      if(hd.flags&HDF_STOP)
+      {  /* Task break, don't report anything */
+      }
+      else if(hd.flags&HDF_ERROR)
+      {  Updatetaskattrs(AOURL_Error,TRUE,TAG_END);
+      }
+      else if(Socketerrno(hi)==ECONNRESET && (!complete || hd.framing==HDFR_CLOSE))
+      {  /* If the server supports Range requests, Httpretrieve will resume
+          * the transfer instead. */
+         if(complete || !hi->server_supports_range || hi->bytes_received<=0)
+         {  Tcperror(hi->fd,TCPERR_NOCONNECT_RESET,
+               hi->hostname?hi->hostname:(UBYTE *)"unknown");
+         }
+      }
+      else if(!complete)
+      {  Updatetaskattrs(AOURL_Error,TRUE,TAG_END);
+      }
    }
    else
-   {  total_bytes_received = 0;
-      hi->bytes_received = 0;  /* Reset for new transfer */
-      expected_total_size = hi->partlength; /* For non-range, partlength is the full content length */
+   {  Updatetaskattrs(AOURL_Error,TRUE,TAG_END);
    }
+   hi->decoder=NULL;
+   Freehttpdecoder(&hd);
+   if(hd.buffer) FREE(hd.buffer);
    
-   /* Note: total_bytes_received starts at 0 (or bytes_received for Range) and is incremented as we process data blocks */
-   /* This ensures accurate tracking without double-counting initial blocklength */
-
-   if(hi->boundary)
-   {  bdlength=strlen(hi->boundary);
-      bdcopy=ALLOCTYPE(UBYTE,bdlength+1,0);
-   }
-   for(;;)
-   {  if(hi->blocklength)
-      {  debug_printf("DEBUG: Readdata loop: Processing data block, length=%ld, flags=0x%04X, parttype='%s'\n", 
-                hi->blocklength, hi->flags, hi->parttype[0] ? (char *)hi->parttype : "(none)");
+   /* CRITICAL: Force socket closure if keep-alive NOT active */
+   /* This prevents pooling dead connections that the server has closed */
+   if(hi->sock >= 0)
+   {  if (!((hi->flags & HTTPIF_KEEPALIVE) && (hi->flags & HTTPIF_KEEPALIVE_REQ)
+         && (hi->flags & HTTPIF_REUSABLE)))
+      {  debug_printf("DEBUG: Readdata cleanup: Closing non-keepalive socket\n");
+         /* Close socket first, then clean up SSL */
+         if(hi->socketbase) a_close(hi->sock, hi->socketbase);
+         hi->sock = -1;
          
-         // first block of the encoded data
-         // allocate buffer and initialize zlib
-         if((hi->flags & HTTPIF_GZIPENCODED) && !(hi->flags & HTTPIF_GZIPDECODING))
-         {  int i;
-            UBYTE *p;
-            long gzip_start;
-            long search_start;
-            long data_after_chunk;
-            
-            gzip_start = 0;
-            search_start = 0;
-            
-            /* Handle chunked encoding + gzip combination */
-            /* When chunked encoding is present, skip chunk headers before looking for gzip magic */
-            if(hi->flags & HTTPIF_CHUNKED)
-            {  /* Skip chunk size line (e.g., "3259\r\n") */
-               p = hi->fd->block;
-               while(search_start < hi->blocklength - 1)
-               {  if(p[search_start] == '\r' && search_start + 1 < hi->blocklength && p[search_start + 1] == '\n')
-                  {  search_start += 2; /* Skip CRLF */
-                     break;
-                  }
-                  search_start++;
+         /* Also free the library/assl references now since we won't pool */
+         /* NOTE: Assl_cleanup() will call Assl_closessl() internally, so don't call it twice */
+#ifndef DEMOVERSION
+         if(hi->assl)
+         {  /* Assl_cleanup() handles SSL shutdown and cleanup internally */
+            Assl_cleanup(hi->assl);
+            FREE(hi->assl);
+            hi->assl = NULL;
+         }
+#endif
+         if(hi->socketbase)
+         {  CloseLibrary(hi->socketbase);
+            hi->socketbase = NULL;
+         }
+      }
+      else
+      {  debug_printf("DEBUG: Readdata cleanup: Keeping keep-alive socket for pooling (sock=%ld)\n", hi->sock);
+      }
+   }
+   return FALSE;
+}
+
+static BOOL Skipsink(void *userdata,UBYTE *data,long length)
+{  return (BOOL)!Checktaskbreak();
+}
+
+/* Read and discard the body of a response that is not shown, like that of
+ * a redirect, so the connection can be reused. Large bodies are not worth
+ * reading, the connection is closed instead. */
+static void Skipdata(struct Httpinfo *hi)
+{  struct Httpdecoder hd={0};
+   long n;
+   if(hi->flags&HTTPIF_NOBODY)
+   {  hd.framing=HDFR_LENGTH;
+      hd.length=0;
+   }
+   else if(hi->flags&HTTPIF_CHUNKED)
+   {  hd.framing=HDFR_CHUNKED;
+   }
+   else if(hi->partlength>=0 && hi->partlength<=MAX_SKIP_BODY)
+   {  hd.framing=HDFR_LENGTH;
+      hd.length=hi->partlength;
+   }
+   else return;
+   hd.coding=HDCO_IDENTITY;
+   hd.sink=Skipsink;
+   hd.userdata=hi;
+   if(Inithttpdecoder(&hd))
+   {  for(;;)
+      {  if(hi->blockstart<hi->blocklength)
+         {  n=Httpdecode(&hd,hi->fd->block+hi->blockstart,hi->blocklength-hi->blockstart);
+            hi->blockstart+=n;
+         }
+         if(hd.flags&(HDF_END|HDF_ERROR|HDF_STOP)) break;
+         if(hd.decoded>MAX_SKIP_BODY || !Readblock(hi)) break;
+      }
+      if(Finishhttpdecoder(&hd) && !(hd.flags&HDF_STOP)
+      && (hi->blockstart>=hi->blocklength || (hi->pipeline && hi->pipeline->nsent)))
+      {  hi->flags|=HTTPIF_REUSABLE;
+      }
+   }
+   Freehttpdecoder(&hd);
+   debug_printf("DEBUG: Skipdata: %ld bytes skipped, reusable=%d\n",
+      hd.decoded, BOOLVAL(hi->flags&HTTPIF_REUSABLE));
+}
+
+/* Process the plain or HTTP or multipart response. */
+static void Httpresponse(struct Httpinfo *hi,BOOL readfirst)
+{  BOOL first=TRUE;
+   debug_printf("DEBUG: Httpresponse: processing URL, flags=0x%04lX\n", hi->flags);
+   /* Forget what the previous response on this connection said */
+   hi->flags&=~(HTTPIF_NOBODY|HTTPIF_REUSABLE|HTTPIF_HTTP10|HTTPIF_KEEPALIVE|HTTPIF_PIPESEND);
+   hi->partlength=-1;
+   hi->keepalive_timeout=0;
+   hi->keepalive_max=-1;
+   if(!readfirst || Readresponse(hi))
+   {  Nextline(hi);
+      hi->flags|=HTTPIF_HEADERS;
+      if(Readheaders(hi))
+      {  debug_printf("DEBUG: Readheaders returned TRUE, processing response\n");
+         debug_printf("DEBUG: movedto=%lu, movedtourl=%p\n", hi->movedto, hi->movedtourl);
+         if(hi->movedto && hi->movedtourl)
+         {  redirect_count++; /* Increment redirect counter for loop protection */
+            debug_printf("DEBUG: Processing redirect to: %s (redirect_count=%d)\n", hi->movedtourl, redirect_count);
+            /* For redirects, consume any remaining body data before processing redirect */
+            Nextline(hi);
+            debug_printf("DEBUG: Nextline called for redirect body consumption, blocklength=%ld\n", hi->blocklength);
+            /* The body isn't shown, but it must be read to keep the connection */
+            Skipdata(hi);
+            Updatetaskattrs(hi->movedto,hi->movedtourl,TAG_END);
+            debug_printf("DEBUG: Updatetaskattrs for redirect completed\n");
+            return; /* Exit after redirect */
+         }
+         else
+         {              debug_printf("DEBUG: No redirect, calling Nextline before Readdata\n");
+            Nextline(hi);
+            debug_printf("DEBUG: Nextline completed, calling Readdata\n");
+            debug_printf("DEBUG: After Nextline - blocklength=%ld, flags=0x%04lX\n", hi->blocklength, hi->flags);
+            if(hi->boundary)
+            {  debug_printf("DEBUG: Httpresponse: Multipart boundary detected, processing parts\n");
+               for(;;)
+               {  if(!Findline(hi)) return;
+                  if(STREQUAL(hi->line,hi->boundary)) break;
+                  Nextline(hi);
                }
-               debug_printf("DEBUG: Chunked encoding detected, skipping %ld bytes of chunk header\n", search_start);
-            }
-            
-            /* Find the start of actual gzip data (1F 8B 08) */
-            gzip_start = -1; /* Use -1 to indicate not found */
-            for(p = hi->fd->block + search_start; p < hi->fd->block + hi->blocklength - 2; p++) {
-                if(p[0] == 0x1F && p[1] == 0x8B && p[2] == 0x08) {
-                    gzip_start = p - hi->fd->block;
-                    break;
-                }
-            }
-            
-            /* With chunked+gzip, we need to extract chunks first before looking for gzip magic */
-            /* The gzip stream may span multiple chunks, so magic bytes might not be in first chunk */
-            if(gzip_start < 0 && (hi->flags & HTTPIF_CHUNKED))
-            {  /* Check if we have enough data after chunk header to potentially contain gzip magic */
-               data_after_chunk = hi->blocklength - search_start;
-               if(data_after_chunk < 10)
-               {  debug_printf("DEBUG: Chunked+gzip: Not enough data yet (only %ld bytes after chunk header), waiting for more chunks\n", data_after_chunk);
-                  /* Don't start gzip yet - wait for more data */
-                  /* Must read more data before continuing, otherwise infinite loop */
-                  if(!Readblock(hi))
-                  {  /* No more data available - this shouldn't happen if gzip is encoded */
-                     debug_printf("DEBUG: Chunked+gzip: No more data available, disabling gzip\n");
-                     hi->flags &= ~HTTPIF_GZIPENCODED;
-                     hi->flags &= ~HTTPIF_GZIPDECODING;
-                     continue;
+               Nextline(hi);  /* Skip boundary */
+               for(;;)
+               {  if(!Readpartheaders(hi)) break;
+                  Nextline(hi);
+                  if(!first)
+                  {  Updatetaskattrs(
+                        AOURL_Reload,TRUE,
+                        TAG_END);
                   }
-                  /* Data read, continue loop to process new data */
-                  continue;
-               }
-               else
-               {  /* We have data but no gzip magic yet - this is OK with chunked encoding */
-                  /* The gzip stream may start in a later chunk, so we should extract chunks */
-                  /* and look for gzip magic in the accumulated data, or trust Content-Encoding header */
-                  debug_printf("DEBUG: Chunked+gzip: Have %ld bytes after chunk header but no gzip magic yet - will extract chunks and look for gzip in accumulated data\n", data_after_chunk);
-                  /* Don't disable gzip - trust Content-Encoding header and process chunks */
-                  /* Set gzip_start to 0 to process all chunks from the beginning */
-                  /* The chunk extraction code will handle finding where gzip data actually starts */
-                  gzip_start = 0;
-                  debug_printf("DEBUG: Chunked+gzip: Setting gzip_start to 0 to process all chunks from beginning\n");
+                  if(*hi->parttype || hi->partlength)
+                  {  Updatetaskattrs(
+                        *hi->parttype?AOURL_Contenttype:TAG_IGNORE,hi->parttype,
+                        hi->partlength?AOURL_Contentlength:TAG_IGNORE,hi->partlength,
+                        TAG_END);
+                  }
+                  if(!Readdata(hi)) break;
+                  Updatetaskattrs(
+                     AOURL_Eof,TRUE,
+                     AOURL_Serverpush,hi->fd->fetch,
+                     TAG_END);
+                  if(!Findline(hi)) break;
+                  Nextline(hi);  /* Skip boundary */
+                  first=FALSE;
                }
             }
-            
-            /* If we found gzip magic (at any position, including 0), use it */
-            if(gzip_start >= 0)
-            {  debug_printf("DEBUG: Found gzip data starting at position %ld, skipping prefix\n", gzip_start);
+            else
+            {              debug_printf("DEBUG: No boundary, calling Readdata directly\n");
                
-               /* For chunked encoding, extract all chunks and accumulate them */
-               if(hi->flags & HTTPIF_CHUNKED)
-               {                 /* Extract all chunks from the block and accumulate in gzipbuffer */
-                  long chunk_pos;
-                  long chunk_size;
-                  long total_chunk_data;
-                  long initial_gzip_size;
-                  
-                  /* Start parsing from beginning of block, not from search_start */
-                  /* search_start is after the first chunk header, but we need to parse from the start */
-                  chunk_pos = 0;
-                  total_chunk_data = 0;
-                  
-                  /* Calculate total size of chunk data from gzip_start onwards */
-                  while(chunk_pos < hi->blocklength)
-                  {  long chunk_data_start;
-                     
-                     /* Skip whitespace before chunk size */
-                     while(chunk_pos < hi->blocklength && 
-                           (hi->fd->block[chunk_pos] == ' ' || hi->fd->block[chunk_pos] == '\t'))
-                     {  chunk_pos++;
-                     }
-                     
-                     /* Parse chunk size (hex number) */
-                     chunk_size = 0;
-                     {  long max_chunk_size = 0x7FFFFFFF; /* Maximum reasonable chunk size (2GB) */
-                        long hex_digits = 0;
-                        while(chunk_pos < hi->blocklength)
-                        {  UBYTE c;
-                           long digit;
-                           
-                           c = hi->fd->block[chunk_pos];
-                           if(c >= '0' && c <= '9')
-                           {  digit = c - '0';
-                           }
-                           else if(c >= 'A' && c <= 'F')
-                           {  digit = c - 'A' + 10;
-                           }
-                           else if(c >= 'a' && c <= 'f')
-                           {  digit = c - 'a' + 10;
-                           }
-                           else
-                           {  break;
-                           }
-                           
-                           /* Check for overflow before multiplying */
-                           if(chunk_size > max_chunk_size / 16)
-                           {  debug_printf("DEBUG: Chunk size overflow detected at position %ld, invalid chunk header\n", chunk_pos);
-                              /* Invalid chunk header - treat as error */
-                              chunk_size = -1;
-                              break;
-                           }
-                           
-                           chunk_size = chunk_size * 16 + digit;
-                           hex_digits++;
-                           chunk_pos++;
-                           
-                           /* Limit hex digits to prevent excessive parsing */
-                           if(hex_digits > 16)
-                           {  debug_printf("DEBUG: Chunk size hex number too long (%ld digits), invalid chunk header\n", hex_digits);
-                              chunk_size = -1;
-                              break;
-                           }
-                        }
-                        
-                        /* Validate chunk size */
-                        if(chunk_size < 0)
-                        {  debug_printf("DEBUG: Invalid chunk size (%ld), aborting chunked transfer\n", chunk_size);
-                           /* Error in chunk parsing - abort */
-                           if(bdcopy) { FREE(bdcopy); bdcopy = NULL; }
-                           if(gzipbuffer) { FREE(gzipbuffer); gzipbuffer = NULL; }
-                           if(d_stream_initialized) { inflateEnd(&d_stream); d_stream_initialized = FALSE; }
-                           Updatetaskattrs(AOURL_Error, TRUE, TAG_END);
-                           return FALSE;
-                        }
-                        
-                        if(chunk_size > max_chunk_size)
-                        {  debug_printf("DEBUG: Chunk size too large (%ld > %ld), invalid chunk header\n", chunk_size, max_chunk_size);
-                           /* Chunk size unreasonably large - treat as error */
-                           if(bdcopy) { FREE(bdcopy); bdcopy = NULL; }
-                           if(gzipbuffer) { FREE(gzipbuffer); gzipbuffer = NULL; }
-                           if(d_stream_initialized) { inflateEnd(&d_stream); d_stream_initialized = FALSE; }
-                           Updatetaskattrs(AOURL_Error, TRUE, TAG_END);
-                           return FALSE;
-                        }
-                        
-                        if(hex_digits == 0)
-                        {  debug_printf("DEBUG: No hex digits found in chunk size, invalid chunk header\n");
-                           /* No valid hex digits - invalid chunk header */
-                           if(bdcopy) { FREE(bdcopy); bdcopy = NULL; }
-                           if(gzipbuffer) { FREE(gzipbuffer); gzipbuffer = NULL; }
-                           if(d_stream_initialized) { inflateEnd(&d_stream); d_stream_initialized = FALSE; }
-                           Updatetaskattrs(AOURL_Error, TRUE, TAG_END);
-                           return FALSE;
-                        }
-                     }
-                     
-                     if(chunk_size == 0)
-                     {  /* Last chunk */
-                        break;
-                     }
-                     
-                     /* Skip chunk extension (semicolon and anything after) */
-                     while(chunk_pos < hi->blocklength && 
-                           hi->fd->block[chunk_pos] != '\r' && hi->fd->block[chunk_pos] != '\n')
-                     {  chunk_pos++;
-                     }
-                     
-                     /* Validate CRLF after chunk header */
-                     if(chunk_pos >= hi->blocklength)
-                     {  debug_printf("DEBUG: Chunk header missing CRLF terminator, waiting for more data\n");
-                        /* Not enough data for CRLF - wait for more */
-                        continue;
-                     }
-                     
-                     /* Skip CRLF after chunk header */
-                     if(hi->fd->block[chunk_pos] == '\r')
-                     {  chunk_pos++;
-                        if(chunk_pos >= hi->blocklength || hi->fd->block[chunk_pos] != '\n')
-                        {  debug_printf("DEBUG: Chunk header has CR but missing LF, invalid chunk header\n");
-                           /* Invalid chunk header format */
-                           if(bdcopy) { FREE(bdcopy); bdcopy = NULL; }
-                           if(gzipbuffer) { FREE(gzipbuffer); gzipbuffer = NULL; }
-                           if(d_stream_initialized) { inflateEnd(&d_stream); d_stream_initialized = FALSE; }
-                           Updatetaskattrs(AOURL_Error, TRUE, TAG_END);
-                           return FALSE;
-                        }
-                        chunk_pos++;
-                     }
-                     else if(hi->fd->block[chunk_pos] == '\n')
-                     {  chunk_pos++;
-                     }
-                     else
-                     {  debug_printf("DEBUG: Chunk header missing CRLF terminator (found 0x%02X), invalid chunk header\n", 
-                               (unsigned char)hi->fd->block[chunk_pos]);
-                        /* Invalid chunk header format - expected CRLF */
-                        if(bdcopy) { FREE(bdcopy); bdcopy = NULL; }
-                        if(gzipbuffer) { FREE(gzipbuffer); gzipbuffer = NULL; }
-                        if(d_stream_initialized) { inflateEnd(&d_stream); d_stream_initialized = FALSE; }
-                        Updatetaskattrs(AOURL_Error, TRUE, TAG_END);
-                        return FALSE;
-                     }
-                     
-                     /* Store where chunk data starts */
-                     chunk_data_start = chunk_pos;
-                     
-                     /* Only count chunk data that is at or after gzip_start */
-                     if(chunk_data_start <= gzip_start && chunk_data_start + chunk_size > gzip_start)
-                     {  /* This chunk contains gzip_start - count from gzip_start */
-                        total_chunk_data += (chunk_data_start + chunk_size) - gzip_start;
-                     }
-                     else if(chunk_data_start > gzip_start)
-                     {  /* This chunk is entirely after gzip_start - count all of it */
-                        total_chunk_data += chunk_size;
-                     }
-                     /* Otherwise, this chunk is before gzip_start, skip it */
-                     
-                     /* Move past chunk data */
-                     if(chunk_pos + chunk_size <= hi->blocklength)
-                     {  chunk_pos += chunk_size;
-                        
-                        /* Skip CRLF after chunk data */
-                        if(chunk_pos < hi->blocklength && hi->fd->block[chunk_pos] == '\r')
-                        {  chunk_pos++;
-                        }
-                        if(chunk_pos < hi->blocklength && hi->fd->block[chunk_pos] == '\n')
-                        {  chunk_pos++;
-                        }
-                     }
-                     else
-                     {  /* Chunk extends beyond current block - estimate remaining */
-                        if(chunk_data_start <= gzip_start)
-                        {  /* This chunk contains gzip_start and extends beyond block */
-                           total_chunk_data += (hi->blocklength - gzip_start);
-                        }
-                        else
-                        {  /* This chunk is after gzip_start */
-                           total_chunk_data += (hi->blocklength - chunk_pos);
-                        }
-                        break;
-                     }
-                  }
-                  
-                  debug_printf("DEBUG: Chunked+gzip: Calculated total_chunk_data=%ld bytes from gzip_start=%ld\n", total_chunk_data, gzip_start);
-                  
-                  /* Find where gzip data starts in the chunk data */
-                  initial_gzip_size = hi->blocklength - gzip_start;
-                  if(initial_gzip_size > total_chunk_data)
-                  {  initial_gzip_size = total_chunk_data;
-                  }
+               /* Add memory corruption protection before calling Readdata */
+               if(hi->fd && hi->fd->block && hi->fd->blocksize > 0 && hi->fd->blocksize <= INPUTBLOCKSIZE) {
+                  debug_printf("DEBUG: Memory validation passed, calling Readdata\n");
+                  debug_printf("DEBUG: Httpresponse: About to call Readdata() - this is the main data read\n");
+                  Readdata(hi);
+                  debug_printf("DEBUG: Httpresponse: Readdata() returned\n");
+                  debug_printf("DEBUG: Readdata() completed\n");
                   
-                  /* Allocate buffer for gzip data (use total_chunk_data, but we may need to grow it) */
-                  if(total_chunk_data > 0 && total_chunk_data <= gzip_buffer_size)
-                  {  gzipbuffer = ALLOCTYPE(UBYTE, total_chunk_data, 0);
-                     if(!gzipbuffer)
-                     {  debug_printf("DEBUG: Chunked+gzip: Failed to allocate buffer of size %ld\n", total_chunk_data);
-                        total_chunk_data = 0;
-                     }
-                  }
-                  else if(total_chunk_data > gzip_buffer_size)
-                  {  /* Chunked data is larger than buffer - allocate full size needed */
-                     /* Allocate the full total_chunk_data size to avoid truncation */
-                     long original_total = total_chunk_data;  /* C89: Declare at start */
-                     gzipbuffer = ALLOCTYPE(UBYTE, total_chunk_data, 0);
-                     if(!gzipbuffer)
-                     {  debug_printf("DEBUG: Chunked+gzip: Failed to allocate buffer of size %ld, trying fallback size %ld\n", total_chunk_data, gzip_buffer_size);
-                        /* Fallback to smaller buffer if allocation fails */
-                        gzipbuffer = ALLOCTYPE(UBYTE, gzip_buffer_size, 0);
-                        if(!gzipbuffer)
-                        {  debug_printf("DEBUG: Chunked+gzip: Failed to allocate fallback buffer of size %ld\n", gzip_buffer_size);
-                           total_chunk_data = 0;
-                        }
-                        else
-                        {  debug_printf("DEBUG: Chunked+gzip: Using fallback buffer size %ld (original was %ld)\n", gzip_buffer_size, original_total);
-                           total_chunk_data = gzip_buffer_size;
-                        }
-                     }
-                     else
-                     {  /* Successfully allocated full size - keep total_chunk_data as is */
-                        debug_printf("DEBUG: Chunked+gzip: Allocated full buffer size %ld (exceeds default %ld)\n", total_chunk_data, gzip_buffer_size);
-                     }
-                  }
-                  else
-                  {  /* Fallback to initial size */
-                     if(initial_gzip_size > 0 && initial_gzip_size <= gzip_buffer_size)
-                     {  gzipbuffer = ALLOCTYPE(UBYTE, initial_gzip_size, 0);
-                        if(!gzipbuffer)
-                        {  debug_printf("DEBUG: Chunked+gzip: Failed to allocate initial buffer of size %ld\n", initial_gzip_size);
-                           total_chunk_data = 0;
-                        }
-                        else
-                        {  total_chunk_data = initial_gzip_size;
-                        }
-                     }
-                     else if(initial_gzip_size > 0)
-                     {  long fallback_size;
-                        fallback_size = MIN(initial_gzip_size, gzip_buffer_size);
-                        gzipbuffer = ALLOCTYPE(UBYTE, fallback_size, 0);
-                        if(!gzipbuffer)
-                        {  debug_printf("DEBUG: Chunked+gzip: Failed to allocate fallback buffer of size %ld\n", fallback_size);
-                           total_chunk_data = 0;
-                        }
-                        else
-                        {  total_chunk_data = fallback_size;
-                        }
-                     }
-                     else
-                     {  debug_printf("DEBUG: Chunked+gzip: No valid size for buffer allocation (total=%ld, initial=%ld)\n", 
-                               total_chunk_data, initial_gzip_size);
-                        total_chunk_data = 0;
-                     }
-                  }
-                  
-                  if(gzipbuffer && total_chunk_data > 0)
-                  {  debug_printf("DEBUG: Chunked+gzip: Successfully allocated buffer of size %ld\n", total_chunk_data);
-                     /* Update gzip_buffer_size to match actual allocated buffer size */
-                     gzip_buffer_size = total_chunk_data;
-                  }
-                  
-                  if(gzipbuffer)
-                  {  /* Extract chunk data starting from where gzip magic was found */
-                     /* Start from beginning of block and parse chunks until we reach gzip_start */
-                     chunk_pos = 0;
-                     gziplength = 0;
-                     
-                     debug_printf("DEBUG: Chunked+gzip: Starting extraction, gzipbuffer=%p, total_chunk_data=%ld, gzip_start=%ld\n", 
-                            gzipbuffer, total_chunk_data, gzip_start);
-                     
-                     /* First, find the chunk that contains gzip_start */
-                     while(chunk_pos < gzip_start && chunk_pos < hi->blocklength)
-                     {  /* Skip whitespace before chunk size */
-                        while(chunk_pos < hi->blocklength && 
-                              (hi->fd->block[chunk_pos] == ' ' || hi->fd->block[chunk_pos] == '\t'))
-                        {  chunk_pos++;
-                        }
-                        
-                        /* Parse chunk size */
-                        chunk_size = 0;
-                        while(chunk_pos < hi->blocklength)
-                        {  UBYTE c;
-                           long digit;
-                           
-                           c = hi->fd->block[chunk_pos];
-                           if(c >= '0' && c <= '9')
-                           {  digit = c - '0';
-                           }
-                           else if(c >= 'A' && c <= 'F')
-                           {  digit = c - 'A' + 10;
-                           }
-                           else if(c >= 'a' && c <= 'f')
-                           {  digit = c - 'a' + 10;
-                           }
-                           else
-                           {  break;
-                           }
-                           chunk_size = chunk_size * 16 + digit;
-                           chunk_pos++;
-                        }
-                        
-                        if(chunk_size == 0)
-                        {  /* Last chunk - shouldn't happen before gzip_start */
-                           break;
-                        }
-                        
-                        /* Skip chunk extension */
-                        while(chunk_pos < hi->blocklength && 
-                              hi->fd->block[chunk_pos] != '\r' && hi->fd->block[chunk_pos] != '\n')
-                        {  chunk_pos++;
-                        }
-                        
-                        /* Skip CRLF after chunk header */
-                        if(chunk_pos < hi->blocklength && hi->fd->block[chunk_pos] == '\r')
-                        {  chunk_pos++;
-                        }
-                        if(chunk_pos < hi->blocklength && hi->fd->block[chunk_pos] == '\n')
-                        {  chunk_pos++;
-                        }
-                        
-                        /* Check if gzip_start is in this chunk's data */
-                        if(chunk_pos <= gzip_start && chunk_pos + chunk_size > gzip_start)
-                        {  /* Gzip starts in this chunk - copy from gzip_start to end of chunk */
-                           long copy_start;
-                           long copy_len;
-                           long max_copy;
-                           long chunk_data_end;
-                           long actual_copy;
-                           long bytes_in_block;
-                           long expected_bytes;
-                           
-                           copy_start = gzip_start;
-                           /* Calculate where this chunk's data ends (before CRLF) */
-                           chunk_data_end = chunk_pos + chunk_size;
-                           copy_len = chunk_data_end - gzip_start;
-                           expected_bytes = chunk_data_end - copy_start;
-                           
-                           /* Calculate how much we can actually copy (limited by buffer space) */
-                           max_copy = total_chunk_data - gziplength;
-                           if(copy_len > max_copy)
-                           {  copy_len = max_copy;
-                           }
-                           
-                           actual_copy = 0;
-                           if(copy_len > 0 && gzipbuffer)
-                           {  /* How much of this chunk's data is actually in the current block */
-                              bytes_in_block = MIN(chunk_data_end, hi->blocklength) - copy_start;
-                              actual_copy = MIN(copy_len, bytes_in_block);
-                              
-                              if(actual_copy > 0 && gziplength + actual_copy <= total_chunk_data && gzipbuffer)
-                              {  memcpy(gzipbuffer + gziplength, hi->fd->block + copy_start, actual_copy);
-                                 gziplength += actual_copy;
-                                 compressed_bytes_consumed += actual_copy; /* Track compressed data consumed */
-                                 debug_printf("DEBUG: Chunked+gzip: Copied %ld bytes from first chunk starting at gzip_start=%ld (chunk_size=%ld, bytes_in_block=%ld, expected=%ld, gziplength now=%ld, max=%ld)\n", 
-                                        actual_copy, gzip_start, chunk_size, bytes_in_block, expected_bytes, gziplength, total_chunk_data);
-                                 
-                                 /* If chunk extends beyond block, we need to continue it in next block */
-                                 /* Don't advance past chunk boundary if chunk wasn't fully copied */
-                                 if(bytes_in_block < expected_bytes)
-                                 {  /* Chunk continues in next block - leave block position at end of data we copied */
-                                    debug_printf("DEBUG: Chunked+gzip: First chunk extends beyond block (%ld of %ld bytes), will continue in next block\n",
-                                           bytes_in_block, expected_bytes);
-                                    /* Break out - the remaining chunk data will be handled when we read more blocks */
-                                    break;
-                                 }
-                              }
-                              else
-                              {  debug_printf("DEBUG: Chunked+gzip: WARNING - Failed to copy first chunk: actual_copy=%ld, bytes_in_block=%ld, gziplength=%ld, total=%ld, gzipbuffer=%p\n",
-                                        actual_copy, bytes_in_block, gziplength, total_chunk_data, gzipbuffer);
-                              }
-                           }
-                           else
-                           {  debug_printf("DEBUG: Chunked+gzip: WARNING - First chunk copy conditions failed: copy_len=%ld, gziplength=%ld, total=%ld, gzipbuffer=%p\n",
-                                     copy_len, gziplength, total_chunk_data, gzipbuffer);
-                           }
-                           
-                           /* Move to next chunk only if we copied all data from this chunk */
-                           if(actual_copy >= expected_bytes)
-                           {  chunk_pos = chunk_data_end;
-                              
-                              /* Skip CRLF after chunk data */
-                              if(chunk_pos < hi->blocklength && hi->fd->block[chunk_pos] == '\r')
-                              {  chunk_pos++;
-                              }
-                              if(chunk_pos < hi->blocklength && hi->fd->block[chunk_pos] == '\n')
-                              {  chunk_pos++;
-                              }
-                              
-                              /* Now extract all remaining chunks */
-                              break;
-                           }
-                           else
-                           {  /* Chunk continues in next block - stop extraction for now */
-                              break;
-                           }
-                        }
-                        else if(chunk_pos + chunk_size <= gzip_start)
-                        {  /* This chunk is before gzip_start - skip it */
-                           chunk_pos += chunk_size;
-                           
-                           /* Skip CRLF after chunk data */
-                           if(chunk_pos < hi->blocklength && hi->fd->block[chunk_pos] == '\r')
-                           {  chunk_pos++;
-                           }
-                           if(chunk_pos < hi->blocklength && hi->fd->block[chunk_pos] == '\n')
-                           {  chunk_pos++;
-                           }
-                        }
-                        else
-                        {  /* Should not happen */
-                           break;
-                        }
-                     }
-                     
-                     /* Now extract all remaining chunks */
-                     while(chunk_pos < hi->blocklength && gziplength < total_chunk_data)
-                     {  /* Skip whitespace before chunk size */
-                        while(chunk_pos < hi->blocklength && 
-                              (hi->fd->block[chunk_pos] == ' ' || hi->fd->block[chunk_pos] == '\t'))
-                        {  chunk_pos++;
-                        }
-                        
-                        /* Parse chunk size */
-                        chunk_size = 0;
-                        while(chunk_pos < hi->blocklength)
-                        {  UBYTE c;
-                           long digit;
-                           
-                           c = hi->fd->block[chunk_pos];
-                           if(c >= '0' && c <= '9')
-                           {  digit = c - '0';
-                           }
-                           else if(c >= 'A' && c <= 'F')
-                           {  digit = c - 'A' + 10;
-                           }
-                           else if(c >= 'a' && c <= 'f')
-                           {  digit = c - 'a' + 10;
-                           }
-                           else
-                           {  break;
-                           }
-                           chunk_size = chunk_size * 16 + digit;
-                           chunk_pos++;
-                        }
-                        
-                        if(chunk_size == 0)
-                        {  /* Last chunk */
-                           break;
-                        }
-                        
-                        /* Skip chunk extension */
-                        while(chunk_pos < hi->blocklength && 
-                              hi->fd->block[chunk_pos] != '\r' && hi->fd->block[chunk_pos] != '\n')
-                        {  chunk_pos++;
-                        }
-                        
-                        /* Skip CRLF after chunk header */
-                        if(chunk_pos < hi->blocklength && hi->fd->block[chunk_pos] == '\r')
-                        {  chunk_pos++;
-                        }
-                        if(chunk_pos < hi->blocklength && hi->fd->block[chunk_pos] == '\n')
-                        {  chunk_pos++;
-                        }
-                        
-                        /* Copy chunk data (may be partial if chunk is larger than buffer) */
-                        if(chunk_size > 0 && gzipbuffer)
-                        {  long max_copy;
-                           long actual_copy;
-                           
-                           /* Calculate how much we can copy (limited by remaining buffer space) */
-                           max_copy = total_chunk_data - gziplength;
-                           if(max_copy <= 0)
-                           {  /* Buffer is full */
-                              debug_printf("DEBUG: Chunked+gzip: Buffer full (gziplength=%ld >= total=%ld), stopping extraction\n", 
-                                     gziplength, total_chunk_data);
-                              break;
-                           }
-                           
-                           if(chunk_size > max_copy)
-                           {  /* Chunk is larger than remaining buffer - copy what we can */
-                              actual_copy = MIN(max_copy, hi->blocklength - chunk_pos);
-                              if(actual_copy > 0)
-                              {  memcpy(gzipbuffer + gziplength, hi->fd->block + chunk_pos, actual_copy);
-                                 gziplength += actual_copy;
-                                 compressed_bytes_consumed += actual_copy; /* Track compressed data consumed */
-                                 debug_printf("DEBUG: Chunked+gzip: Copied %ld bytes from chunk (size=%ld, partial copy, total=%ld, pos=%ld)\n", 
-                                        actual_copy, chunk_size, gziplength, chunk_pos);
-                              }
-                              /* Buffer is now full - stop extraction */
-                              break;
-                           }
-                           else
-                           {  /* Chunk fits in remaining buffer */
-                              actual_copy = MIN(chunk_size, hi->blocklength - chunk_pos);
-                              if(actual_copy > 0 && gziplength + actual_copy <= total_chunk_data && gzipbuffer)
-                              {  memcpy(gzipbuffer + gziplength, hi->fd->block + chunk_pos, actual_copy);
-                                 gziplength += actual_copy;
-                                 compressed_bytes_consumed += actual_copy; /* Track compressed data consumed */
-                                 debug_printf("DEBUG: Chunked+gzip: Copied %ld bytes from chunk (size=%ld, total=%ld, pos=%ld)\n", 
-                                        actual_copy, chunk_size, gziplength, chunk_pos);
-                              }
-                              else if(actual_copy < chunk_size)
-                              {  /* Chunk extends beyond block - copy what we have */
-                                 if(actual_copy > 0 && gziplength + actual_copy <= total_chunk_data && gzipbuffer)
-                                 {  memcpy(gzipbuffer + gziplength, hi->fd->block + chunk_pos, actual_copy);
-                                    gziplength += actual_copy;
-                                    compressed_bytes_consumed += actual_copy; /* Track compressed data consumed */
-                                    debug_printf("DEBUG: Chunked+gzip: Copied partial chunk %ld bytes (extends beyond block, size=%ld, total=%ld)\n", 
-                                           actual_copy, chunk_size, gziplength);
-                                 }
-                                 /* Chunk extends beyond block - we'll read more later */
-                              }
-                           }
-                           
-                           /* Check if we've filled the buffer */
-                           if(gziplength >= total_chunk_data)
-                           {  debug_printf("DEBUG: Chunked+gzip: Buffer full (gziplength=%ld >= total=%ld), stopping extraction\n", 
-                                     gziplength, total_chunk_data);
-                              /* Buffer full - stop extraction, but still need to advance past chunk */
-                              /* Check if we copied the full chunk or just part */
-                              if(chunk_size > max_copy)
-                              {  /* Chunk larger than buffer - we copied actual_copy, buffer is full */
-                                 /* Advance by what we copied, keep remaining for next block read */
-                                 chunk_pos += actual_copy;
-                                 /* Don't skip CRLF - chunk continues in next block */
-                              }
-                              else
-                              {  /* Chunk fits in buffer - check if we copied all of it */
-                                 if(actual_copy >= chunk_size)
-                                 {  /* Full chunk copied - advance past chunk and CRLF */
-                                    chunk_pos += chunk_size;
-                                    
-                                    /* Skip CRLF after chunk data */
-                                    if(chunk_pos < hi->blocklength && hi->fd->block[chunk_pos] == '\r')
-                                    {  chunk_pos++;
-                                    }
-                                    if(chunk_pos < hi->blocklength && hi->fd->block[chunk_pos] == '\n')
-                                    {  chunk_pos++;
-                                    }
-                                 }
-                                 else
-                                 {  /* Partial chunk copied (extends beyond block) - advance by what we copied */
-                                    /* Keep remaining chunk data in block for next iteration */
-                                    chunk_pos += actual_copy;
-                                    /* Don't skip CRLF yet - we haven't reached end of chunk */
-                                 }
-                              }
-                              break;
-                           }
-                           
-                           /* Move past chunk data - CRITICAL: Only advance by what we actually copied */
-                           /* If we copied less than chunk_size (chunk extends beyond block), keep remaining data */
-                           if(chunk_size > max_copy)
-                           {  /* Chunk larger than remaining buffer space - we copied actual_copy */
-                              /* Advance by what we copied, but buffer is not full yet so continue */
-                              chunk_pos += actual_copy;
-                              /* Don't skip CRLF - chunk continues, will be handled in next iteration */
-                              /* Note: This case should be rare since we check max_copy above */
-                           }
-                           else
-                           {  /* Chunk fits in remaining buffer - check if we copied all of it */
-                              if(actual_copy >= chunk_size)
-                              {  /* Full chunk copied - advance past chunk and CRLF */
-                                 chunk_pos += chunk_size;
-                                 
-                                 /* Skip CRLF after chunk data */
-                                 if(chunk_pos < hi->blocklength && hi->fd->block[chunk_pos] == '\r')
-                                 {  chunk_pos++;
-                                 }
-                                 if(chunk_pos < hi->blocklength && hi->fd->block[chunk_pos] == '\n')
-                                 {  chunk_pos++;
-                                 }
-                              }
-                              else
-                              {  /* Partial chunk copied (extends beyond block) - advance by what we copied */
-                                 /* Keep remaining chunk data in block for next iteration */
-                                 chunk_pos += actual_copy;
-                                 /* Don't skip CRLF yet - we haven't reached end of chunk */
-                              }
-                           }
-                        }
-                        else if(chunk_size > 0)
-                        {  debug_printf("DEBUG: Chunked+gzip: WARNING - Skipping chunk copy: chunk_size=%ld, gziplength=%ld, total=%ld, gzipbuffer=%p\n",
-                                  chunk_size, gziplength, total_chunk_data, gzipbuffer);
-                           /* Skip this chunk since we can't copy it */
-                           chunk_pos += chunk_size;
-                           
-                           /* Skip CRLF after chunk data */
-                           if(chunk_pos < hi->blocklength && hi->fd->block[chunk_pos] == '\r')
-                           {  chunk_pos++;
-                           }
-                           if(chunk_pos < hi->blocklength && hi->fd->block[chunk_pos] == '\n')
-                           {  chunk_pos++;
-                           }
-                        }
-                     }
-                     
-                     debug_printf("DEBUG: Chunked+gzip: Extracted %ld bytes of chunk data (gzip_start=%ld, total_chunk_data=%ld)\n", gziplength, gzip_start, total_chunk_data);
-                  }
-                  else
-                  {  debug_printf("DEBUG: Failed to allocate gzip buffer for chunked data\n");
-                     hi->flags &= ~HTTPIF_GZIPENCODED;
-                     hi->flags &= ~HTTPIF_GZIPDECODING;
-                     gzip_end = 1;
-                     break;
-                  }
-               }
-               else
-               {  /* Non-chunked: Only copy the actual gzip data, skip any prefix */
-                gziplength = hi->blocklength - gzip_start;
-                
-                  /* Track total compressed bytes read from network */
-                  /* For Content-Length validation, only count actual compressed gzip data, not any prefix */
-                  /* gziplength is the actual compressed data size (blocklength minus any prefix) */
-                  total_compressed_read = gziplength;
-                  
-                  /* For non-chunked gzip, allocate full buffer size since we don't know total size */
-                  /* This prevents buffer overflow when appending more data later */
-                  if(gziplength > 0 && gziplength <= hi->blocklength) {
-                      gzipbuffer = ALLOCTYPE(UBYTE, gzip_buffer_size, 0);
-                    if(gzipbuffer) {
-                        memcpy(gzipbuffer, hi->fd->block + gzip_start, gziplength);
-                          compressed_bytes_consumed += gziplength; /* Track compressed data consumed */
-                    } else {
-                        debug_printf("DEBUG: Failed to allocate gzip buffer, disabling gzip\n");
-                        hi->flags &= ~HTTPIF_GZIPENCODED;
-                        hi->flags &= ~HTTPIF_GZIPDECODING;
-                        gzip_end = 1;
-                        break;
-                    }
-                } else {
-                    debug_printf("DEBUG: Invalid gziplength %ld, disabling gzip\n", gziplength);
-                    hi->flags &= ~HTTPIF_GZIPENCODED;
-                    hi->flags &= ~HTTPIF_GZIPDECODING;
-                    gzip_end = 1;
-                    break;
-                }
-               }
-            }
-            else if(gzip_start < 0)
-            {  /* No gzip magic found at all - check if data might be gzip anyway */
-               /* For non-chunked, check if it starts with gzip magic */
-               if(hi->blocklength >= 3 && hi->fd->block[0] == 0x1F && hi->fd->block[1] == 0x8B && hi->fd->block[2] == 0x08)
-               {  /* Gzip magic at start - treat as gzip_start=0 */
-                  gzip_start = 0;
-                  debug_printf("DEBUG: Found gzip magic at start of block\n");
-                  gziplength = hi->blocklength;
-                  
-                  /* Track total compressed bytes read from network */
-                  /* For Content-Length validation, count actual compressed gzip data */
-                  total_compressed_read = gziplength;
-                  
-                  /* For non-chunked gzip, allocate full buffer size since we don't know total size */
-                  /* This prevents buffer overflow when appending more data later */
-                  if(gziplength > 0 && gziplength <= gzip_buffer_size) {
-                      gzipbuffer = ALLOCTYPE(UBYTE, gzip_buffer_size, 0);
-                    if(gzipbuffer) {
-                        memcpy(gzipbuffer, hi->fd->block, gziplength);
-                          compressed_bytes_consumed += gziplength; /* Track compressed data consumed */
-                    } else {
-                        debug_printf("DEBUG: Failed to allocate gzip buffer, disabling gzip\n");
-                        hi->flags &= ~HTTPIF_GZIPENCODED;
-                        hi->flags &= ~HTTPIF_GZIPDECODING;
-                        gzip_end = 1;
-                        break;
-                    }
-                } else {
-                      debug_printf("DEBUG: Invalid gziplength %ld, disabling gzip\n", gziplength);
-                    hi->flags &= ~HTTPIF_GZIPENCODED;
-                    hi->flags &= ~HTTPIF_GZIPDECODING;
-                    gzip_end = 1;
-                    break;
-                }
-               }
-               else
-               {  /* No gzip magic found anywhere */
-                  debug_printf("DEBUG: No gzip magic found in block, disabling gzip\n");
-                  hi->flags &= ~HTTPIF_GZIPENCODED;
-                  hi->flags &= ~HTTPIF_GZIPDECODING;
-                  continue;
-               }
-            }
-            
-            /* Verify we have valid gzip magic before starting */
-            /* For chunked encoding, gzip magic might be in a later chunk, so we need to check */
-            /* accumulated data or trust Content-Encoding header */
-            if(!gzipbuffer || gziplength < 3)
-            {  if(hi->flags & HTTPIF_CHUNKED)
-               {  /* Chunked encoding - might need more chunks to find gzip magic */
-                  debug_printf("DEBUG: Chunked+gzip: Only %ld bytes accumulated, need more chunks to find gzip magic\n", gziplength);
-                  /* Don't disable gzip yet - wait for more chunks */
-                  /* Read more data and try again */
-                  if(!Readblock(hi))
-                  {  /* No more data - disable gzip */
-                     debug_printf("DEBUG: Chunked+gzip: No more data available, disabling gzip\n");
-                     if(gzipbuffer) FREE(gzipbuffer);
-                     gzipbuffer = NULL;
-                     hi->flags &= ~HTTPIF_GZIPENCODED;
-                     hi->flags &= ~HTTPIF_GZIPDECODING;
-                     continue;
-                  }
-                  /* More data read, continue loop to process it */
-                  continue;
-               }
-               else
-               {  /* Non-chunked - should have gzip magic by now */
-                  debug_printf("DEBUG: No valid gzip magic found (gziplength=%ld), disabling gzip\n", gziplength);
-                  if(gzipbuffer) FREE(gzipbuffer);
-                  gzipbuffer = NULL;
-                  hi->flags &= ~HTTPIF_GZIPENCODED;
-                  hi->flags &= ~HTTPIF_GZIPDECODING;
-                  continue;
-               }
-            }
-            
-            /* Check for gzip magic in accumulated data */
-            if(gzipbuffer[0] != 0x1F || gzipbuffer[1] != 0x8B || gzipbuffer[2] != 0x08)
-            {  if(hi->flags & HTTPIF_CHUNKED)
-               {  /* Chunked encoding - gzip magic might be in a later chunk */
-                  /* Trust Content-Encoding header and try decompression anyway */
-                  /* Or search for gzip magic in accumulated data */
-                  long i;
-                  BOOL found_magic = FALSE;
-                  for(i = 0; i <= gziplength - 3 && i >= 0; i++)
-                  {  if(gzipbuffer[i] == 0x1F && gzipbuffer[i+1] == 0x8B && gzipbuffer[i+2] == 0x08)
-                     {  debug_printf("DEBUG: Chunked+gzip: Found gzip magic at offset %ld in accumulated data\n", i);
-                        /* Move gzip data to start of buffer, skipping prefix */
-                        if(i > 0 && (gziplength - i) > 0 && (gziplength - i) <= gzip_buffer_size)
-                        {  memmove(gzipbuffer, gzipbuffer + i, gziplength - i);
-                           gziplength -= i;
-                        }
-                        found_magic = TRUE;
-                        break;
-                     }
-                  }
-                  if(!found_magic)
-                  {  /* No gzip magic found yet - might be in later chunks */
-                     debug_printf("DEBUG: Chunked+gzip: No gzip magic in %ld bytes of accumulated data (first 3 bytes: %02X %02X %02X), waiting for more chunks\n",
-                            gziplength,
-                            gzipbuffer[0], gzipbuffer[1], gzipbuffer[2]);
-                     /* Read more data and try again */
-                     if(!Readblock(hi))
-                     {  /* No more data - trust Content-Encoding and try anyway, or disable */
-                        debug_printf("DEBUG: Chunked+gzip: No more data, but Content-Encoding says gzip - trusting header and attempting decompression\n");
-                        /* Trust Content-Encoding header and proceed */
-                     }
-                     else
-                     {  /* More data read, continue loop to process it */
-                        continue;
-                     }
-                  }
-               }
-               else
-               {  /* Non-chunked - should have gzip magic at start */
-                  debug_printf("DEBUG: No valid gzip magic found (first 3 bytes: %02X %02X %02X), disabling gzip\n",
-                         gzipbuffer[0], gzipbuffer[1], gzipbuffer[2]);
-                  if(gzipbuffer) FREE(gzipbuffer);
-                  gzipbuffer = NULL;
-                  hi->flags &= ~HTTPIF_GZIPENCODED;
-                  hi->flags &= ~HTTPIF_GZIPDECODING;
-                  continue;
-               }
-            }
-            
-            hi->flags|=HTTPIF_GZIPDECODING;
-            debug_printf("DEBUG: Starting gzip decompression, blocklength=%ld, gziplength=%ld\n", hi->blocklength, gziplength);
-            
-            /* Initialize zlib for gzip decompression */
-            d_stream.zalloc=Z_NULL;
-            d_stream.zfree=Z_NULL;
-            d_stream.opaque=Z_NULL;
-            d_stream.avail_in=0;
-            d_stream.next_in=Z_NULL;
-            d_stream.avail_out=0;
-            d_stream.next_out=Z_NULL;
-            
-            /* Validate zlib stream structure before initialization */
-            if((ULONG)&d_stream < 0x1000 || (ULONG)&d_stream > 0xFFFFFFF0) {
-               debug_printf("DEBUG: Invalid zlib stream pointer 0x%08lX\n", (ULONG)&d_stream);
-               if(gzipbuffer) FREE(gzipbuffer);
-               gzipbuffer = NULL;
-               hi->flags &= ~HTTPIF_GZIPENCODED;
-               hi->flags &= ~HTTPIF_GZIPDECODING;
-               gzip_end = 1;
-               break;
-            }
-            
-            err=inflateInit2(&d_stream,16+15); // set zlib to expect 'gzip-header'
-            if(err!=Z_OK) {
-               debug_printf("DEBUG: zlib Init Fail: %d\n", err);
-               if(gzipbuffer) FREE(gzipbuffer);
-               gzipbuffer = NULL;
-               hi->flags &= ~HTTPIF_GZIPENCODED;
-               hi->flags &= ~HTTPIF_GZIPDECODING;
-               gzip_end = 1;
-               d_stream_initialized = FALSE;
-               break;
-            } else {
-               debug_printf("DEBUG: zlib init successful\n");
-               d_stream_initialized = TRUE; /* Mark d_stream as initialized */
-            }
-            
-                     /* Validate gzip buffer allocation to prevent heap corruption */
-         if(gzipbuffer && gziplength > 0) {
-            /* Check if gzipbuffer pointer is valid */
-            if((ULONG)gzipbuffer < 0x1000 || (ULONG)gzipbuffer > 0xFFFFFFF0) {
-               debug_printf("DEBUG: Invalid gzipbuffer pointer 0x%08lX\n", (ULONG)gzipbuffer);
-               FREE(gzipbuffer);
-               gzipbuffer = NULL;
-                  inflateEnd(&d_stream);
-               hi->flags &= ~HTTPIF_GZIPENCODED;
-               hi->flags &= ~HTTPIF_GZIPDECODING;
-               gzip_end = 1;
-               break;
-            }
-            
-            /* Check if gziplength is reasonable */
-            if(gziplength > gzip_buffer_size || gziplength <= 0) {
-               debug_printf("DEBUG: Invalid gziplength: %ld (max: %ld)\n", gziplength, gzip_buffer_size);
-               FREE(gzipbuffer);
-               gzipbuffer = NULL;
-                  inflateEnd(&d_stream);
-               hi->flags &= ~HTTPIF_GZIPENCODED;
-               hi->flags &= ~HTTPIF_GZIPDECODING;
-               gzip_end = 1;
-               break;
-            }
-            
-            d_stream.next_in=gzipbuffer;
-            d_stream.avail_in=gziplength;
-            
-            /* Validate blocksize before setting output buffer to prevent overflow */
-            if(hi->fd->blocksize > 0 && hi->fd->blocksize <= INPUTBLOCKSIZE) {
-                d_stream.next_out=hi->fd->block;
-                d_stream.avail_out=hi->fd->blocksize;
-                debug_printf("DEBUG: Setting zlib output buffer to %ld bytes\n", hi->fd->blocksize);
-            } else {
-                debug_printf("DEBUG: Invalid blocksize %ld, using safe default\n", hi->fd->blocksize);
-                d_stream.next_out=hi->fd->block;
-                d_stream.avail_out=INPUTBLOCKSIZE;
-                /* Reset corrupted blocksize to prevent memory corruption */
-                hi->fd->blocksize = INPUTBLOCKSIZE;
-            }
-                
-                if(httpdebug)
-                {  debug_printf("DEBUG: First 16 bytes of gzip data: ");
-                   for(i = 0; i < MIN(16, gziplength); i++) {
-                       printf("%02X ", gzipbuffer[i]);
-                   }
-                   printf("\n");
-                }
-                
-                /* Verify this is actually gzip data */
-                if(gziplength >= 3 && gzipbuffer[0] == 0x1F && gzipbuffer[1] == 0x8B && gzipbuffer[2] == 0x08) {
-                   debug_printf("DEBUG: Valid gzip header confirmed, gziplength=%ld, avail_in=%lu\n", 
-                          gziplength, d_stream.avail_in);
-                } else {
-                   debug_printf("DEBUG: WARNING: Data still doesn't start with gzip magic! Disabling gzip.\n");
-                   FREE(gzipbuffer);
-                   gzipbuffer = NULL;
-                   inflateEnd(&d_stream);
-                   hi->flags &= ~HTTPIF_GZIPENCODED;
-                   hi->flags &= ~HTTPIF_GZIPDECODING;
-                   gzip_end = 1;
-                   break;
-                }
-            } else {
-                debug_printf("DEBUG: No gzip data to process\n");
-                hi->flags &= ~HTTPIF_GZIPENCODED;
-                hi->flags &= ~HTTPIF_GZIPDECODING;
-                continue;
-            }
-            
-            /* After copying data to gzipbuffer, clear block to prevent reprocessing */
-            /* For chunked encoding, we've already extracted and copied the gzip data */
-            /* For non-chunked, we've copied all data to gzipbuffer */
-            /* Either way, we don't want to process this block again as regular data */
-            hi->blocklength = 0;
-            
-            /* Set the decoding flag so we can process gzip */
-            hi->flags |= HTTPIF_GZIPDECODING;
-            debug_printf("DEBUG: Set HTTPIF_GZIPDECODING flag (0x%04X), gzipbuffer=%p, gziplength=%ld, avail_in=%lu, d_stream_initialized=%d\n", 
-                   hi->flags, gzipbuffer, gziplength, d_stream.avail_in, d_stream_initialized);
-            
-            /* Now process the gzip data immediately */
-         }
-
-         /* Process gzip data if flag is set */
-         if(hi->flags & HTTPIF_GZIPDECODING && gzipbuffer != NULL && d_stream_initialized)
-         {  /* Process gzip data immediately */
-            debug_printf("DEBUG: Processing gzip data inside main loop, avail_in=%lu\n", d_stream.avail_in);
-            
-            /* Process ALL gzip data in this loop to avoid duplicate processing */
-            /* Process gzip completely in the main loop - this prevents the second loop from running */
-            while(!gzip_end && hi->flags & HTTPIF_GZIPDECODING && gzipbuffer != NULL && d_stream_initialized)
-            {  long decompressed_len;
-               
-               /* Only call inflate if we have input */
-               if(d_stream.avail_in > 0)
-               {  err=inflate(&d_stream,Z_SYNC_FLUSH);
-               }
-               else
-               {  /* No input - need to read more data */
-                  err=Z_OK; /* Signal that we need more input */
-               }
-               
-               if(err==Z_BUF_ERROR || err==Z_OK)
-               {  /* Output buffer full or OK - process decompressed data */
-                  decompressed_len=hi->fd->blocksize-d_stream.avail_out;
-                  if(decompressed_len > 0 && decompressed_len <= hi->fd->blocksize)
-                  {  UBYTE *decompressed_copy;
-                     
-                     debug_printf("DEBUG: Processing %ld bytes of decompressed data\n", decompressed_len);
-                     
-                     /* CRITICAL: Copy decompressed data before passing to Updatetaskattrs()
-                      * because Updatetaskattrs() may pass the buffer to another task asynchronously,
-                      * and we immediately reuse hi->fd->block for the next decompression cycle.
-                      * Without copying, this causes memory corruption when the other task reads
-                      * from the buffer while zlib is writing to it. */
-                     decompressed_copy = ALLOCTYPE(UBYTE, decompressed_len, 0);
-                     if(decompressed_copy != NULL)
-                     {  memcpy(decompressed_copy, hi->fd->block, decompressed_len);
-                        
-                        /* Ensure parttype is null-terminated before calling strlen() to prevent bounds check errors */
-                        hi->parttype[sizeof(hi->parttype) - 1] = '\0';
-                        if(hi->parttype[0] != '\0' && hi->parttype[0] != 0) {
-                           Updatetaskattrs(
-                              AOURL_Data,decompressed_copy,
-                              AOURL_Datalength,decompressed_len,
-                              AOURL_Contenttype,hi->parttype,
-                              TAG_END);
-                        } else {
-                           Updatetaskattrs(
-                              AOURL_Data,decompressed_copy,
-                              AOURL_Datalength,decompressed_len,
-                              TAG_END);
-                        }
-                        /* Note: We don't free decompressed_copy here - the receiving task will free it
-                         * after processing, or it will be freed when the task completes. */
-                     }
-                     else
-                     {  debug_printf("DEBUG: ERROR - Failed to allocate memory for decompressed data copy, skipping chunk\n");
-                        /* If allocation fails, we can't safely pass the data, so skip this chunk */
-                     }
-                     
-                     /* Now safe to reuse the buffer for next decompression cycle */
-                     d_stream.next_out=hi->fd->block;
-                     d_stream.avail_out=hi->fd->blocksize;
-                  }
-                  if(err==Z_OK && d_stream.avail_in==0)
-                  {  /* Need more input - read next block */
-                     if(!Readblock(hi))
-                     {  debug_printf("DEBUG: No more data for gzip, ending\n");
-                        gzip_end=1;
-                        break;
-                     }
-                     /* Update total compressed bytes read from network */
-                     total_compressed_read += hi->blocklength;
-                     
-                     /* Continue loop to process the newly read data */
-                     /* For non-chunked, append new block data to gzipbuffer */
-                     /* For chunked, we need to extract chunk data and add to gzipbuffer */
-                     if(!(hi->flags & HTTPIF_CHUNKED))
-                     {  /* Non-chunked: Append all new block data to gzipbuffer */
-                        long remaining_space;
-                        long bytes_to_append;
-                        long used_space;
-                        
-                        /* Calculate space used in buffer (from start to next_in + remaining) */
-                        used_space = (d_stream.next_in - gzipbuffer) + d_stream.avail_in;
-                        remaining_space = gzip_buffer_size - used_space;
-                        
-                        if(remaining_space <= 0 || hi->blocklength > remaining_space)
-                        {  debug_printf("DEBUG: Non-chunked gzip: Buffer full or block too large (remaining=%ld, block=%ld), cannot continue\n",
-                                  remaining_space, hi->blocklength);
-                           gzip_end = 1;
-                           break;
-                        }
-                        
-                        bytes_to_append = MIN(hi->blocklength, remaining_space);
-                        if(bytes_to_append > 0 && gziplength + bytes_to_append <= gzip_buffer_size)
-                        {  /* Move unprocessed data to start if needed */
-                           if(d_stream.next_in != gzipbuffer && d_stream.avail_in > 0)
-                           {  memmove(gzipbuffer, d_stream.next_in, d_stream.avail_in);
-                              gziplength = d_stream.avail_in;
-                           }
-                           else if(d_stream.avail_in == 0)
-                           {  gziplength = 0;
-                           }
-                           
-                           /* Append new data */
-                           memcpy(gzipbuffer + gziplength, hi->fd->block, bytes_to_append);
-                           gziplength += bytes_to_append;
-                           compressed_bytes_consumed += bytes_to_append;
-                           
-                           /* Update zlib stream */
-                           d_stream.next_in = gzipbuffer;
-                           d_stream.avail_in = gziplength;
-                           
-                           debug_printf("DEBUG: Non-chunked gzip: Added %ld bytes from new block (total in buffer=%ld)\n",
-                                  bytes_to_append, gziplength);
-                           
-                           /* Clear block for next read */
-                           hi->blocklength = 0;
-                           
-                           /* Continue loop to process the newly added data */
-            continue;
-                        }
-                     }
-                     else if(hi->flags & HTTPIF_CHUNKED)
-                     {  /* Extract chunk data from new block and append to gzipbuffer */
-                        UBYTE *chunk_p;
-                        long chunk_pos;
-                        long chunk_size;
-                        long new_data_start;
-                        long remaining_space;
-                        long available_space;
-                        long remaining_unprocessed;
-                        long used_space;
-                        long bytes_to_move;
-                        UBYTE first_char;
-                        BOOL is_continuation;
-                        
-                        chunk_p = hi->fd->block;
-                        chunk_pos = 0;
-                        new_data_start = 0;
-                        
-                        /* Check if this block is continuing a chunk from previous block */
-                        /* If block doesn't start with hex digits (chunk header), it's continuation of previous chunk */
-                        is_continuation = FALSE;
-                        if(hi->blocklength > 0)
-                        {  first_char = hi->fd->block[0];
-                           /* Chunk headers start with hex digits (0-9, A-F, a-f) */
-                           /* If first char is not hex digit, this is continuation of previous chunk data */
-                           if(!((first_char >= '0' && first_char <= '9') ||
-                                (first_char >= 'A' && first_char <= 'F') ||
-                                (first_char >= 'a' && first_char <= 'f')))
-                           {  is_continuation = TRUE;
-                              debug_printf("DEBUG: Chunked+gzip: Block starts with non-hex char (0x%02X), treating as continuation of previous chunk\n", first_char);
-                           }
-                        }
-                        
-                        if(is_continuation)
-                        {  /* This block continues the previous chunk - copy directly to gzipbuffer */
-                           /* Calculate available space and copy what we can */
-                           remaining_unprocessed = d_stream.avail_in;
-                           
-                           /* Validate remaining_unprocessed is reasonable */
-                           if(remaining_unprocessed < 0 || remaining_unprocessed > gzip_buffer_size)
-                           {  debug_printf("DEBUG: Invalid remaining_unprocessed (%ld) in continuation, resetting to 0\n", remaining_unprocessed);
-                              remaining_unprocessed = 0;
-                           }
-                           
-                           if(remaining_unprocessed > 0)
-                           {  /* Validate next_in pointer before pointer arithmetic */
-                              if(gzipbuffer && d_stream.next_in >= gzipbuffer && 
-                                 d_stream.next_in < gzipbuffer + gzip_buffer_size)
-                              {  used_space = (d_stream.next_in - gzipbuffer) + remaining_unprocessed;
-                                 /* Validate used_space is reasonable */
-                                 if(used_space < 0 || used_space > gzip_buffer_size)
-                                 {  debug_printf("DEBUG: Invalid used_space (%ld) in continuation, resetting\n", used_space);
-                                    used_space = remaining_unprocessed; /* Fallback */
-                                    if(used_space > gzip_buffer_size) used_space = gzip_buffer_size;
-                                 }
-                              }
-                              else
-                              {  debug_printf("DEBUG: Invalid d_stream.next_in pointer (%p) in continuation, resetting\n", d_stream.next_in);
-                                 used_space = remaining_unprocessed; /* Fallback */
-                                 if(used_space > gzip_buffer_size) used_space = gzip_buffer_size;
-                              }
-                           }
-                           else
-                           {  used_space = 0;
-                           }
-                           
-                           remaining_space = gzip_buffer_size - used_space;
-                           if(remaining_space <= 0)
-                           {  debug_printf("DEBUG: Chunked+gzip: Buffer full, cannot add continuation data\n");
-                              gzip_end = 1;
-                              break;
-                           }
-                           
-                           /* Move unprocessed data to start if needed */
-                           /* gziplength tracks where to append new data (after any unprocessed data) */
-                           if(remaining_unprocessed > 0 && d_stream.next_in != gzipbuffer)
-                           {  bytes_to_move = remaining_unprocessed;
-                              /* Validate all pointers and sizes before memmove */
-                              if(bytes_to_move > gzip_buffer_size)
-                              {  debug_printf("DEBUG: bytes_to_move (%ld) exceeds buffer size (%ld) in continuation, resetting\n",
-                                        bytes_to_move, gzip_buffer_size);
-                                 gziplength = 0;
-                                 remaining_unprocessed = 0;
-                              }
-                              else if(bytes_to_move > 0 && gzipbuffer && d_stream.next_in >= gzipbuffer && 
-                                      d_stream.next_in < gzipbuffer + gzip_buffer_size &&
-                                      (d_stream.next_in + bytes_to_move) <= gzipbuffer + gzip_buffer_size &&
-                                      bytes_to_move <= remaining_unprocessed)
-                              {  memmove(gzipbuffer, d_stream.next_in, bytes_to_move);
-                                 gziplength = bytes_to_move; /* Position after unprocessed data */
-                              }
-                              else
-                              {  debug_printf("DEBUG: Invalid pointer state for memmove in continuation (next_in=%p, gzipbuffer=%p, bytes=%ld, buffer_size=%ld), resetting\n",
-                                        d_stream.next_in, gzipbuffer, bytes_to_move, gzip_buffer_size);
-                                 gziplength = 0;
-                                 remaining_unprocessed = 0;
-                              }
-                           }
-                           else if(remaining_unprocessed == 0)
-                           {  /* All data was consumed - start fresh at beginning */
-                              gziplength = 0;
-                           }
-                           else
-                           {  /* remaining_unprocessed > 0 but next_in == gzipbuffer - data already at start */
-                              gziplength = remaining_unprocessed; /* Position after unprocessed data */
-                           }
-                           
-                           /* Copy continuation data to buffer */
-                           available_space = MIN(hi->blocklength, remaining_space);
-                           if(gziplength + available_space <= gzip_buffer_size)
-                           {  /* Validate pointers before memcpy */
-                              if(gzipbuffer && hi->fd && hi->fd->block &&
-                                 gziplength >= 0 && gziplength < gzip_buffer_size &&
-                                 available_space > 0 && available_space <= (gzip_buffer_size - gziplength) &&
-                                 hi->blocklength > 0 && available_space <= hi->blocklength)
-                              {  memcpy(gzipbuffer + gziplength, hi->fd->block, available_space);
-                                 gziplength += available_space; /* Total data in buffer now */
-                                 compressed_bytes_consumed += available_space; /* Track compressed data consumed */
-                              }
-                              else
-                              {  debug_printf("DEBUG: Invalid pointers for memcpy in continuation (gzipbuffer=%p, block=%p, gziplength=%ld, available_space=%ld, blocklength=%ld), aborting\n",
-                                        gzipbuffer, hi->fd ? hi->fd->block : NULL, gziplength, available_space, hi->blocklength);
-                                 gzip_end = 1;
-                                 break;
-                              }
-                              
-                              /* CRITICAL FIX: Set next_in to start of unprocessed data, not start of buffer */
-                              /* If we had unprocessed data, it's at the start; new data is after it */
-                              if(remaining_unprocessed > 0)
-                              {  /* Unprocessed data is at start, new data is after it */
-                                 d_stream.next_in = gzipbuffer; /* Start of unprocessed data */
-                                 d_stream.avail_in = remaining_unprocessed + available_space; /* Total unprocessed */
-                              }
-                              else
-                              {  /* No unprocessed data - all new data is unprocessed */
-                                 d_stream.next_in = gzipbuffer; /* Start of buffer */
-                                 d_stream.avail_in = available_space; /* Only new data is unprocessed */
-                              }
-                              
-                              debug_printf("DEBUG: Chunked+gzip: Added %ld bytes of chunk continuation (gziplength=%ld, remaining_unprocessed was=%ld, avail_in=%lu)\n",
-                                     available_space, gziplength, remaining_unprocessed, d_stream.avail_in);
-                              
-                              /* Clear block - we've used all continuation data */
-                              hi->blocklength = 0;
-                              
-                              /* Continue decompression */
-                              continue;
-                           }
-                           else
-                           {  debug_printf("DEBUG: Chunked+gzip: Not enough space for continuation (%ld bytes)\n", hi->blocklength);
-                              gzip_end = 1;
-                              break;
-                           }
-                        }
-                        
-                        /* Find start of next chunk data (new chunk header) */
-                        while(chunk_pos < hi->blocklength)
-                        {  /* Skip whitespace */
-                           while(chunk_pos < hi->blocklength && 
-                                 (hi->fd->block[chunk_pos] == ' ' || hi->fd->block[chunk_pos] == '\t'))
-                           {  chunk_pos++;
-                           }
-                           
-                           /* Parse chunk size */
-                           chunk_size = 0;
-                           while(chunk_pos < hi->blocklength)
-                           {  UBYTE c;
-                              long digit;
-                              
-                              c = hi->fd->block[chunk_pos];
-                              if(c >= '0' && c <= '9')
-                              {  digit = c - '0';
-                              }
-                              else if(c >= 'A' && c <= 'F')
-                              {  digit = c - 'A' + 10;
-                              }
-                              else if(c >= 'a' && c <= 'f')
-                              {  digit = c - 'a' + 10;
-                              }
-                              else
-                              {  break;
-                              }
-                              chunk_size = chunk_size * 16 + digit;
-                              chunk_pos++;
-                           }
-                           
-                           if(chunk_size == 0)
-                           {  /* Last chunk */
-                              gzip_end = 1;
-                              break;
-                           }
-                           
-                           /* Skip chunk extension */
-                           while(chunk_pos < hi->blocklength && 
-                                 hi->fd->block[chunk_pos] != '\r' && hi->fd->block[chunk_pos] != '\n')
-                           {  chunk_pos++;
-                           }
-                           
-                           /* Skip CRLF after chunk header */
-                           if(chunk_pos < hi->blocklength && hi->fd->block[chunk_pos] == '\r')
-                           {  chunk_pos++;
-                           }
-                           if(chunk_pos < hi->blocklength && hi->fd->block[chunk_pos] == '\n')
-                           {  chunk_pos++;
-                           }
-                           
-                           /* Calculate remaining unprocessed data and available space */
-                           /* If avail_in > 0, we have unprocessed data starting at next_in */
-                           /* If avail_in == 0, we've consumed all data and can reuse buffer */
-                           
-                           remaining_unprocessed = d_stream.avail_in;
-                           
-                           /* Validate remaining_unprocessed is reasonable */
-                           if(remaining_unprocessed < 0 || remaining_unprocessed > gzip_buffer_size)
-                           {  debug_printf("DEBUG: Invalid remaining_unprocessed (%ld) in chunk extraction, resetting to 0\n", remaining_unprocessed);
-                              remaining_unprocessed = 0;
-                           }
-                           
-                           if(remaining_unprocessed > 0)
-                           {  /* We have unprocessed data - calculate how much buffer is used */
-                              /* Validate next_in pointer before pointer arithmetic */
-                              if(gzipbuffer && d_stream.next_in >= gzipbuffer && 
-                                 d_stream.next_in < gzipbuffer + gzip_buffer_size)
-                              {  /* Used space = data from start to next_in + remaining unprocessed */
-                                 used_space = (d_stream.next_in - gzipbuffer) + remaining_unprocessed;
-                                 /* Validate used_space is reasonable */
-                                 if(used_space < 0 || used_space > gzip_buffer_size)
-                                 {  debug_printf("DEBUG: Invalid used_space (%ld) calculated from next_in=%p, gzipbuffer=%p, remaining=%ld\n",
-                                           used_space, d_stream.next_in, gzipbuffer, remaining_unprocessed);
-                                    used_space = remaining_unprocessed; /* Fallback to just remaining */
-                                    if(used_space > gzip_buffer_size) used_space = gzip_buffer_size;
-                                 }
-                              }
-                              else
-                              {  debug_printf("DEBUG: Invalid d_stream.next_in pointer (%p) for gzipbuffer (%p), resetting\n",
-                                        d_stream.next_in, gzipbuffer);
-                                 used_space = remaining_unprocessed; /* Fallback */
-                                 if(used_space > gzip_buffer_size) used_space = gzip_buffer_size;
-                              }
-                           }
-                           else
-                           {  /* All data consumed - buffer can be reused from start */
-                              used_space = 0;
-                           }
-                           
-                           remaining_space = gzip_buffer_size - used_space;
-                           if(remaining_space <= 0)
-                           {  debug_printf("DEBUG: Chunked+gzip: Gzip buffer full (used=%ld, remaining=%ld), cannot add more chunks\n",
-                                     used_space, remaining_space);
-                              gzip_end = 1;
-                              break;
-                           }
-                           
-                           /* Determine how much chunk data we can copy */
-                           available_space = MIN(chunk_size, remaining_space);
-                           if(chunk_pos + available_space <= hi->blocklength)
-                           {  /* We have the full chunk or space for it */
-                              /* If we have unprocessed data, move it to start of buffer first */
-                              if(remaining_unprocessed > 0 && d_stream.next_in != gzipbuffer)
-                              {  bytes_to_move = remaining_unprocessed;
-                                 /* Validate all pointers and sizes before memmove */
-                                 if(bytes_to_move > gzip_buffer_size)
-                                 {  debug_printf("DEBUG: bytes_to_move (%ld) exceeds buffer size (%ld), resetting\n",
-                                           bytes_to_move, gzip_buffer_size);
-                                    gziplength = 0;
-                                    remaining_unprocessed = 0;
-                                 }
-                                 else if(bytes_to_move > 0 && gzipbuffer && d_stream.next_in >= gzipbuffer && 
-                                         d_stream.next_in < gzipbuffer + gzip_buffer_size &&
-                                         (d_stream.next_in + bytes_to_move) <= gzipbuffer + gzip_buffer_size &&
-                                         bytes_to_move <= remaining_unprocessed)
-                                 {  memmove(gzipbuffer, d_stream.next_in, bytes_to_move);
-                                    gziplength = bytes_to_move;
-                                    debug_printf("DEBUG: Chunked+gzip: Moved %ld bytes of unprocessed data to start\n", bytes_to_move);
-                                 }
-                                 else
-                                 {  /* Invalid state - reset */
-                                    debug_printf("DEBUG: Chunked+gzip: CRITICAL - Invalid buffer state (next_in=%p, gzipbuffer=%p, bytes=%ld, buffer_size=%ld), resetting\n",
-                                           d_stream.next_in, gzipbuffer, bytes_to_move, gzip_buffer_size);
-                                    gziplength = 0;
-                                    remaining_unprocessed = 0;
-                                 }
-                              }
-                              else
-                              {  /* No unprocessed data or already at start - start fresh */
-                                 if(remaining_unprocessed == 0)
-                                 {  gziplength = 0;
-                                 }
-                                 /* else gziplength already set correctly */
-                              }
-                              
-                              /* Append new chunk data to buffer */
-                              if(gziplength + available_space <= gzip_buffer_size)
-                              {  /* Validate pointers before memcpy */
-                                 if(gzipbuffer && hi->fd && hi->fd->block &&
-                                    gziplength >= 0 && gziplength < gzip_buffer_size &&
-                                    available_space > 0 && available_space <= (gzip_buffer_size - gziplength) &&
-                                    chunk_pos >= 0 && chunk_pos < hi->blocklength &&
-                                    (chunk_pos + available_space) <= hi->blocklength)
-                                 {  memcpy(gzipbuffer + gziplength, hi->fd->block + chunk_pos, available_space);
-                                    gziplength += available_space;
-                                    compressed_bytes_consumed += available_space; /* Track compressed data consumed */
-                                 }
-                                 else
-                                 {  debug_printf("DEBUG: Invalid pointers for memcpy in chunk extraction (gzipbuffer=%p, block=%p, gziplength=%ld, available_space=%ld, chunk_pos=%ld, blocklength=%ld), aborting\n",
-                                           gzipbuffer, hi->fd ? hi->fd->block : NULL, gziplength, available_space, chunk_pos, hi->blocklength);
-                                    gzip_end = 1;
-                                    break;
-                                 }
-                                 
-                                 /* Update zlib stream to point to start of all unprocessed data */
-                                 d_stream.next_in = gzipbuffer;
-                                 d_stream.avail_in = gziplength;
-                                 
-                                 debug_printf("DEBUG: Chunked+gzip: Added %ld bytes from chunk (unprocessed was=%ld, total=%ld, avail_in=%lu)\n", 
-                                        available_space, remaining_unprocessed, gziplength, d_stream.avail_in);
-                                 
-                                 /* Move past chunk data and CRLF */
-                                 /* CRITICAL: Advance by available_space (what we copied), not chunk_size (total chunk size) */
-                                 /* If we only copied part of the chunk due to buffer space, we need to advance by that amount */
-                                 chunk_pos += available_space;
-                                 
-                                 /* Check if we've processed the entire chunk */
-                                 if(available_space >= chunk_size)
-                                 {  /* Full chunk processed - skip CRLF */
-                                    if(chunk_pos < hi->blocklength && hi->fd->block[chunk_pos] == '\r')
-                                    {  chunk_pos++;
-                                    }
-                                    if(chunk_pos < hi->blocklength && hi->fd->block[chunk_pos] == '\n')
-                                    {  chunk_pos++;
-                                    }
-                                    
-                                    /* Remove processed chunk from block */
-                                    if(chunk_pos < hi->blocklength)
-                                    {  long remaining;
-                                       remaining = hi->blocklength - chunk_pos;
-                                       memmove(hi->fd->block, hi->fd->block + chunk_pos, remaining);
-                                       hi->blocklength = remaining;
-                                    }
-                                    else
-                                    {  hi->blocklength = 0;
-                                    }
-                                 }
-                                 else
-                                 {  /* Partial chunk copied - keep remaining chunk data in block for next iteration */
-                                    /* Don't remove data - we'll continue this chunk in next loop iteration */
-                                    /* Just update blocklength to reflect what we've consumed */
-                                    if(chunk_pos < hi->blocklength)
-                                    {  /* Move unprocessed chunk data to start of block */
-                                       long remaining;
-                                       remaining = hi->blocklength - chunk_pos;
-                                       memmove(hi->fd->block, hi->fd->block + chunk_pos, remaining);
-                                       hi->blocklength = remaining;
-                                    }
-                                    else
-                                    {  hi->blocklength = 0;
-                                    }
-                                 }
-                                 
-                                 /* Continue decompression */
-                                 continue;
-                              }
-                              else
-                              {  debug_printf("DEBUG: Chunked+gzip: Not enough space in buffer (gziplength=%ld, available_space=%ld, buffer_size=%ld)\n",
-                                       gziplength, available_space, gzip_buffer_size);
-                                 gzip_end = 1;
-                                 break;
-                              }
-                           }
-                           else
-                           {  /* Need more data for this chunk */
-                              debug_printf("DEBUG: Chunked+gzip: Chunk extends beyond block, need more data\n");
-                              /* Keep the block and wait for more data */
-                              break;
-                           }
-                        }
-                     }
-                     else
-                     {  /* Non-chunked - all data already in gzipbuffer */
-                        gzip_end=1;
-                        break;
-                     }
-                  }
-               }
-               else if(err==Z_STREAM_END)
-               {  /* Stream complete */
-                  decompressed_len=hi->fd->blocksize-d_stream.avail_out;
-                  if(decompressed_len > 0 && decompressed_len <= hi->fd->blocksize)
-                  {  debug_printf("DEBUG: Processing final %ld bytes of decompressed data\n", decompressed_len);
-                     /* Ensure parttype is null-terminated before using it to prevent bounds check errors */
-                     hi->parttype[sizeof(hi->parttype) - 1] = '\0';
-                     if(hi->parttype[0] != '\0' && hi->parttype[0] != 0) {
-                        Updatetaskattrs(
-                           AOURL_Data,hi->fd->block,
-                           AOURL_Datalength,decompressed_len,
-                           AOURL_Contenttype,hi->parttype,
-                           TAG_END);
-                     } else {
-                        Updatetaskattrs(
-                           AOURL_Data,hi->fd->block,
-                           AOURL_Datalength,decompressed_len,
-                           TAG_END);
-                     }
-                  }
-                  
-                  /* For chunked encoding, zlib may finish before all chunks are processed */
-                  /* After Z_STREAM_END, we must NOT try to decompress more data - just discard remaining chunks */
-                  /* Exit decompression loop immediately and let chunk-discarding code handle remaining chunks */
-                  if(hi->flags & HTTPIF_CHUNKED)
-                  {  debug_printf("DEBUG: Z_STREAM_END - gzip stream complete, will discard remaining chunks\n");
-                     /* Exit decompression loop - remaining chunks will be discarded below */
-                     gzip_end=1;
-                     break;
-                  }
-                  else
-                  {  /* Non-chunked or no remaining data - gzip is complete */
-                     gzip_end=1;
-                     break;
-                  }
-               }
-               else
-               {  debug_printf("DEBUG: Gzip error: %d, ending\n", err);
-                  gzip_end=1;
-                  break;
-               }
-            }
-            
-            /* Clean up gzip after processing */
-            if(gzip_end)
-            {  inflateEnd(&d_stream);
-               if(gzipbuffer) FREE(gzipbuffer);
-               gzipbuffer = NULL;
-               d_stream_initialized = FALSE;
-               hi->flags &= ~HTTPIF_GZIPDECODING;
-               hi->flags &= ~HTTPIF_GZIPENCODED;
-               debug_printf("DEBUG: Gzip processing complete\n");
-               
-               /* For chunked+gzip, we need to continue processing remaining chunks */
-               /* even after gzip finishes, until we reach the final "0\r\n\r\n" chunk */
-               if(hi->flags & HTTPIF_CHUNKED)
-               {  debug_printf("DEBUG: Chunked+gzip: Gzip complete, discarding remaining chunks until final chunk\n");
-                  /* Process remaining data in blocklength, then continue reading chunks */
-                  /* until we find the final "0\r\n\r\n" chunk */
-                  /* Note: remaining data might be chunk continuation (not starting with hex digits) */
-                  while(hi->blocklength > 0 || Readblock(hi))
-                  {  UBYTE *chunk_p;
-                     long chunk_pos;
-                     long chunk_size;
-                     long chunk_data_end;
-                     BOOL final_chunk_found;
-                     UBYTE first_char;
-                     BOOL is_chunk_header;
-                     
-                     if(hi->blocklength <= 0) break;
-                     
-                     chunk_p = hi->fd->block;
-                     chunk_pos = 0;
-                     final_chunk_found = FALSE;
-                     
-                     /* Parse chunks in current block until we find final chunk or run out of data */
-                     while(chunk_pos < hi->blocklength)
-                     {  /* Check if this looks like a chunk header (starts with hex digit) */
-                        /* or continuation data (starts with non-hex) */
-                        first_char = chunk_p[chunk_pos];
-                        is_chunk_header = FALSE;
-                        if((first_char >= '0' && first_char <= '9') ||
-                           (first_char >= 'A' && first_char <= 'F') ||
-                           (first_char >= 'a' && first_char <= 'f'))
-                        {  is_chunk_header = TRUE;
-                        }
-                        
-                        if(!is_chunk_header)
-                        {  /* This is continuation data from a previous chunk - skip until we find CRLF */
-                           /* which indicates end of chunk data, then we'll see next chunk header */
-                           debug_printf("DEBUG: Chunked+gzip: Found continuation data (starts with 0x%02X), skipping to next chunk boundary\n", first_char);
-                           /* Skip until we find CRLF (end of chunk data) */
-                           while(chunk_pos < hi->blocklength - 1)
-                           {  if(chunk_p[chunk_pos] == '\r' && chunk_p[chunk_pos + 1] == '\n')
-                              {  chunk_pos += 2; /* Skip CRLF */
-                                 break; /* Now we should see next chunk header */
-                              }
-                              chunk_pos++;
-                           }
-                           if(chunk_pos >= hi->blocklength - 1)
-                           {  /* CRLF not found in this block - need more data */
-                              /* Move remaining data to start */
-                              if(chunk_pos < hi->blocklength)
-                              {  long remaining;
-                                 remaining = hi->blocklength - chunk_pos;
-                                 memmove(hi->fd->block, chunk_p + chunk_pos, remaining);
-                                 hi->blocklength = remaining;
-                              }
-                              break; /* Exit inner loop to read more */
-                           }
-                           /* Continue to parse next chunk header */
-                           continue;
-                        }
-                        
-                        /* Skip whitespace */
-                        while(chunk_pos < hi->blocklength && 
-                              (chunk_p[chunk_pos] == ' ' || chunk_p[chunk_pos] == '\t'))
-                        {  chunk_pos++;
-                        }
-                        
-                        if(chunk_pos >= hi->blocklength) break;
-                        
-                        /* Parse chunk size */
-                        chunk_size = 0;
-                        while(chunk_pos < hi->blocklength)
-                        {  UBYTE c;
-                           long digit;
-                           c = chunk_p[chunk_pos];
-                           if(c >= '0' && c <= '9')
-                           {  digit = c - '0';
-                           }
-                           else if(c >= 'A' && c <= 'F')
-                           {  digit = c - 'A' + 10;
-                           }
-                           else if(c >= 'a' && c <= 'f')
-                           {  digit = c - 'a' + 10;
-                           }
-                           else
-                           {  break;
-                           }
-                           chunk_size = chunk_size * 16 + digit;
-                           chunk_pos++;
-                        }
-                        
-                        /* Skip chunk extension and CRLF */
-                        while(chunk_pos < hi->blocklength && 
-                              chunk_p[chunk_pos] != '\r' && chunk_p[chunk_pos] != '\n')
-                        {  chunk_pos++;
-                        }
-                        if(chunk_pos < hi->blocklength && chunk_p[chunk_pos] == '\r')
-                        {  chunk_pos++;
-                        }
-                        if(chunk_pos < hi->blocklength && chunk_p[chunk_pos] == '\n')
-                        {  chunk_pos++;
-                        }
-                        
-                        if(chunk_size == 0)
-                        {  /* Final chunk found */
-                           debug_printf("DEBUG: Chunked+gzip: Final chunk (0) found, all chunks processed\n");
-                           final_chunk_found = TRUE;
-                           /* Skip final CRLF if present */
-                           if(chunk_pos < hi->blocklength && chunk_p[chunk_pos] == '\r')
-                           {  chunk_pos++;
-                           }
-                           if(chunk_pos < hi->blocklength && chunk_p[chunk_pos] == '\n')
-                           {  chunk_pos++;
-                           }
-                           break;
-                        }
-                        
-                        /* Skip chunk data and trailing CRLF */
-                        chunk_data_end = chunk_pos + chunk_size;
-                        if(chunk_data_end > hi->blocklength)
-                        {  /* Chunk extends beyond current block - need more data */
-                           debug_printf("DEBUG: Chunked+gzip: Chunk size %ld extends beyond block, need more data\n", chunk_size);
-                           /* Move remaining data to start of block */
-                           if(chunk_pos < hi->blocklength)
-                           {  long remaining;
-                              remaining = hi->blocklength - chunk_pos;
-                              memmove(hi->fd->block, chunk_p + chunk_pos, remaining);
-                              hi->blocklength = remaining;
-                           }
-                           break; /* Exit inner loop to read more */
-                        }
-                        
-                        chunk_pos = chunk_data_end;
-                        /* Skip trailing CRLF after chunk data */
-                        if(chunk_pos < hi->blocklength && chunk_p[chunk_pos] == '\r')
-                        {  chunk_pos++;
-                        }
-                        if(chunk_pos < hi->blocklength && chunk_p[chunk_pos] == '\n')
-                        {  chunk_pos++;
-                        }
-                        
-                        debug_printf("DEBUG: Chunked+gzip: Discarded chunk of size %ld\n", chunk_size);
-                     }
-                     
-                     if(final_chunk_found)
-                     {  /* Final chunk found - we're done */
-                        hi->blocklength = 0;
-                        break;
-                     }
-                     
-                     /* Move any remaining data to start of block for next iteration */
-                     if(chunk_pos < hi->blocklength)
-                     {  long remaining;
-                        remaining = hi->blocklength - chunk_pos;
-                        memmove(hi->fd->block, chunk_p + chunk_pos, remaining);
-                        hi->blocklength = remaining;
-                     }
-                     else
-                     {  hi->blocklength = 0;
-                     }
-                  }
-                  
-                  debug_printf("DEBUG: Chunked+gzip: Finished discarding remaining chunks\n");
-                  /* If Readblock() failed but gzip decompression completed successfully, */
-                  /* treat as successful completion (server may have closed connection early) */
-                  /* The actual data is already decompressed, so missing chunk boundaries is OK */
-                  /* Note: If we exited the loop because Readblock() failed (not because final chunk found), */
-                  /* we still treat it as success since gzip decompression already completed */
-                  result = TRUE;  /* Always success if gzip decompression completed */
-                  break;
-               }
-               
-               /* For non-chunked gzip streams, all data has been decompressed */
-               /* Account for any remaining compressed data in current block */
-               if(hi->blocklength > 0)
-               {  total_compressed_read += hi->blocklength;
-                  debug_printf("DEBUG: Accounting for %ld bytes remaining in block after gzip completion\n", hi->blocklength);
-               }
-               
-               /* Clear blocklength to prevent processing remaining compressed data as uncompressed */
-               hi->blocklength = 0;
-               
-               /* For non-chunked responses with Content-Length, we need to read */
-               /* exactly that much compressed data from network before exiting */
-               /* Note: Chunked encoding and Content-Length are mutually exclusive per HTTP spec */
-               if(!(hi->flags & HTTPIF_CHUNKED) && hi->partlength > 0)
-               {  /* We have a Content-Length for non-chunked response - need to read that much compressed data total from network */
-                  debug_printf("DEBUG: Gzip decompression complete, read %ld/%ld compressed bytes from network so far\n", 
-                         total_compressed_read, hi->partlength);
-                  while(total_compressed_read < hi->partlength && Readblock(hi))
-                  {  long compressed_in_block;
-                     compressed_in_block = hi->blocklength;
-                     total_compressed_read += compressed_in_block;
-                     hi->blocklength = 0; /* Discard consumed compressed data */
-                     debug_printf("DEBUG: Read %ld bytes of compressed data from network, total=%ld/%ld\n", 
-                            compressed_in_block, total_compressed_read, hi->partlength);
-                  }
-                  debug_printf("DEBUG: Finished reading compressed data from network: %ld/%ld bytes\n", 
-                         total_compressed_read, hi->partlength);
-                  
-                  /* Validate Content-Length: warn if we didn't read the expected amount */
-                  if(total_compressed_read != hi->partlength)
-                  {  debug_printf("DEBUG: WARNING - Content-Length mismatch: read %ld bytes, expected %ld bytes\n",
-                            total_compressed_read, hi->partlength);
-                     /* This could indicate a server error or connection issue, but don't fail the request */
-                     /* since decompression already completed successfully */
-                  }
-               }
-               else
-               {  /* No Content-Length - read until EOF to consume remaining compressed data */
-                  debug_printf("DEBUG: No Content-Length, reading until EOF to consume remaining compressed data\n");
-                  while(Readblock(hi))
-                  {  /* Discard remaining compressed data - it's already been decompressed */
-                     total_compressed_read += hi->blocklength;
-                     hi->blocklength = 0;
-                  }
-               }
-               
-               /* Exit Readdata - gzip response is complete */
-               result = !eof;
-               break;
-            }
-            continue; /* Skip regular data processing */
-         }
-
-         /* Process chunked transfer encoding if present (and not already processed for gzip) */
-         if((hi->flags & HTTPIF_CHUNKED) && !(hi->flags & HTTPIF_GZIPDECODING))
-         {  UBYTE *chunk_p;
-            UBYTE *output_p;
-            long chunk_pos;
-            long chunk_size;
-            long output_pos;
-            long original_blocklength;
-            BOOL final_chunk;
-            BOOL need_more_data;
-            
-            chunk_p = hi->fd->block;
-            output_p = hi->fd->block; /* Reuse same buffer for output */
-            chunk_pos = 0;
-            output_pos = 0;
-            original_blocklength = hi->blocklength; /* Save original length before we modify block */
-            final_chunk = FALSE;
-            need_more_data = FALSE;
-            
-            /* Parse chunked encoding: <size in hex>\r\n<data>\r\n */
-            /* Extract all complete chunks, removing headers */
-            /* Note: We read from original_blocklength positions, but write to output_pos positions */
-            while(chunk_pos < original_blocklength && !final_chunk && !need_more_data)
-            {  long chunk_header_start;
-               long chunk_data_start;
-               long chunk_data_end;
-               
-               chunk_header_start = chunk_pos;
-               
-               /* Skip whitespace before chunk size */
-               while(chunk_pos < original_blocklength && 
-                     (chunk_p[chunk_pos] == ' ' || chunk_p[chunk_pos] == '\t'))
-               {  chunk_pos++;
-               }
-               
-               if(chunk_pos >= original_blocklength)
-               {  need_more_data = TRUE;
-                  break;
-               }
-               
-               /* Parse chunk size (hexadecimal) */
-               chunk_size = 0;
-               while(chunk_pos < original_blocklength)
-               {  UBYTE c;
-                  long digit;
-                  c = chunk_p[chunk_pos];
-                  if(c >= '0' && c <= '9')
-                  {  digit = c - '0';
-                  }
-                  else if(c >= 'A' && c <= 'F')
-                  {  digit = c - 'A' + 10;
-                  }
-                  else if(c >= 'a' && c <= 'f')
-                  {  digit = c - 'a' + 10;
-                  }
-                  else
-                  {  break;
-                  }
-                  chunk_size = chunk_size * 16 + digit;
-                  chunk_pos++;
-               }
-               
-               /* Skip chunk extension and CRLF after chunk size */
-               while(chunk_pos < original_blocklength && 
-                     chunk_p[chunk_pos] != '\r' && chunk_p[chunk_pos] != '\n')
-               {  chunk_pos++;
-               }
-               if(chunk_pos < original_blocklength && chunk_p[chunk_pos] == '\r')
-               {  chunk_pos++;
-               }
-               if(chunk_pos < original_blocklength && chunk_p[chunk_pos] == '\n')
-               {  chunk_pos++;
-               }
-               
-               if(chunk_size == 0)
-               {  /* Final chunk (0) - skip trailing CRLF if present */
-                  final_chunk = TRUE;
-                  if(chunk_pos < original_blocklength && chunk_p[chunk_pos] == '\r')
-                  {  chunk_pos++;
-                  }
-                  if(chunk_pos < original_blocklength && chunk_p[chunk_pos] == '\n')
-                  {  chunk_pos++;
-                  }
-                  break;
-               }
-               
-               /* Calculate where chunk data starts and ends (in original block) */
-               chunk_data_start = chunk_pos;
-               chunk_data_end = chunk_pos + chunk_size;
-               
-               if(chunk_data_end > original_blocklength)
-               {  /* Chunk extends beyond current block - need more data */
-                  /* Move partial chunk header to start of block for next iteration */
-                  if(chunk_header_start < original_blocklength)
-                  {  long remaining;
-                     remaining = original_blocklength - chunk_header_start;
-                     if(remaining > 0 && remaining <= hi->fd->blocksize)
-                     {  memmove(hi->fd->block, chunk_p + chunk_header_start, remaining);
-                        hi->blocklength = remaining;
-                     }
-                     else
-                     {  hi->blocklength = 0;
-                     }
-                  }
-                  else
-                  {  hi->blocklength = 0;
-                  }
-                  need_more_data = TRUE;
-                  break;
-               }
-               
-               /* Copy chunk data to output (removing header) */
-               /* We copy from original block position (chunk_data_start) to output position (output_pos) */
-               /* Since we're removing headers, output_pos should be <= chunk_data_start, so this is safe */
-               /* But we need to validate to prevent memory corruption */
-               if(chunk_data_start < chunk_data_end && chunk_data_end <= original_blocklength 
-                  && output_pos + chunk_size <= hi->fd->blocksize && output_pos >= 0 && chunk_size >= 0
-                  && chunk_data_start + chunk_size <= original_blocklength)
-               {  /* Validate that output_pos <= chunk_data_start to ensure safe in-place copy */
-                  if(output_pos <= chunk_data_start)
-                  {  /* Safe to copy - we're reading from later position, writing to earlier position */
-                     memmove(output_p + output_pos, chunk_p + chunk_data_start, chunk_size);
-                     output_pos += chunk_size;
-                  }
-                  else
-                  {  /* This shouldn't happen - output_pos > chunk_data_start means we've already written past where we're reading */
-                     debug_printf("DEBUG: Chunked encoding: ERROR - output_pos %ld > chunk_data_start %ld, unsafe copy!\n",
-                            output_pos, chunk_data_start);
-                     need_more_data = TRUE;
-                     break;
-                  }
-               }
-               else
-               {  /* Invalid bounds - this shouldn't happen but handle it */
-                  debug_printf("DEBUG: Chunked encoding: WARNING - Invalid bounds (chunk_data_start=%ld, chunk_data_end=%ld, original_blocklength=%ld, output_pos=%ld, chunk_size=%ld, blocksize=%ld)\n",
-                         chunk_data_start, chunk_data_end, original_blocklength, output_pos, chunk_size, hi->fd->blocksize);
-                  need_more_data = TRUE;
-                  break;
-               }
-               
-               /* Skip chunk data and trailing CRLF to find next chunk (in original block) */
-               chunk_pos = chunk_data_end;
-               if(chunk_pos < original_blocklength && chunk_p[chunk_pos] == '\r')
-               {  chunk_pos++;
-               }
-               if(chunk_pos < original_blocklength && chunk_p[chunk_pos] == '\n')
-               {  chunk_pos++;
-               }
-            }
-            
-            if(need_more_data && output_pos == 0)
-            {  /* Need more data to complete chunk - don't process partial data yet */
-               /* blocklength already adjusted above when we moved partial chunk header */
-               debug_printf("DEBUG: Chunked encoding: Need more data to complete chunk, continuing loop\n");
-               /* Continue main loop to read more data */
-               if(!Readblock(hi))
-               {  eof = TRUE;
-                  break;
-               }
-               continue; /* Process new data in next iteration */
-            }
-            
-            if(output_pos > 0 || final_chunk)
-            {  /* Update block with extracted chunk data (headers removed) */
-               hi->blocklength = output_pos;
-               blocklength = output_pos;
-               debug_printf("DEBUG: Processed chunked encoding: extracted %ld bytes of data (final_chunk=%d, need_more=%d)\n", 
-                      output_pos, final_chunk, need_more_data);
-               
-               /* If final chunk found, clear chunked flag */
-               if(final_chunk)
-               {  hi->flags &= ~HTTPIF_CHUNKED;
-                  debug_printf("DEBUG: Chunked encoding complete (final chunk received)\n");
-               }
-               
-               /* If there's more chunked data in this block, move it for next iteration */
-               if(!final_chunk && chunk_pos < original_blocklength)
-               {  /* There's more chunked data starting at chunk_pos in the original block */
-                  long remaining;
-                  remaining = original_blocklength - chunk_pos;
-                  if(remaining > 0 && output_pos + remaining <= hi->fd->blocksize && output_pos >= 0)
-                  {  /* Move remaining chunked data to start, after the extracted data */
-                     memmove(hi->fd->block + output_pos, chunk_p + chunk_pos, remaining);
-                     hi->blocklength = output_pos + remaining;
-                     /* Send extracted data now, process remaining chunks in next iteration */
-                     blocklength = output_pos;
-                  }
-                  else if(remaining > 0)
-                  {  /* Not enough space - this shouldn't happen but handle it */
-                     debug_printf("DEBUG: Chunked encoding: WARNING - Not enough space for remaining data (output_pos=%ld, remaining=%ld, blocksize=%ld)\n",
-                            output_pos, remaining, hi->fd->blocksize);
-                     /* Just send what we have, remaining will be processed in next iteration */
-                     blocklength = output_pos;
-                  }
-               }
-            }
-            else
-            {  /* No data extracted yet - might be empty chunks or need more data */
-               if(hi->blocklength == 0)
-               {  /* No data left - read more */
-                  if(!Readblock(hi))
-                  {  eof = TRUE;
-                     break;
-                  }
-                  continue;
-               }
-               blocklength = hi->blocklength;
-            }
-         }
-         
-         /* Boundary detection for multipart data */
-         boundary=partial=eof=FALSE;
-         if(bdcopy)
-         {  /* Look for [CR]LF--<boundary>[--][CR]LF or any possible part thereof. */
-            UBYTE *p=hi->fd->block,*end=p+hi->blocklength;
-            for(;;)
-            {  for(;p<end && *p!='\r' && *p!='\n';p++);
-               if(p>=end) break;
-               blocklength=p-hi->fd->block;
-               if(*p=='\r' && (p>=end-1 || p[1]=='\n'))
-               {  p++;  /* Skip CR */
-               }
-               p++;  /* Skip LF */
-               if(p>=end) partial=TRUE;
-               else
-               {  if(*p=='-')
-                  {  /* Create a copy of hi->boundary, with what we have
-                      * in the block, copied over. */
-                     strcpy(bdcopy,hi->boundary);
-                     strncpy(bdcopy,p,MIN(bdlength,end-p));
-                     /* If the result is equal to the boundary, we have a (at least
-                      * partial possible) boundary. */
-                     if(STREQUAL(bdcopy,hi->boundary))
-                     {  /* Now check if it's complete and followed by [CR]LF. */
-                        p+=bdlength;
-                        if(p<end && *p=='-') p++;
-                        if(p<end && *p=='-')
-                        {  eof=TRUE;
-                           p++;
-                        }
-                        if(p<end && *p=='\r') p++;
-                        if(p>=end) partial=TRUE;
-                        else if(*p=='\n') boundary=TRUE;
-                     }
-                  }
-               }
-               if(boundary || partial) break;
-               /* Look further */
-               p=hi->fd->block+blocklength+1;
-            }
-         }
-         if(!boundary && !partial) blocklength=hi->blocklength;
-         
-         /* Validate blocklength to prevent memory corruption */
-         if(blocklength < 0 || blocklength > hi->blocklength) {
-            debug_printf("DEBUG: Invalid blocklength %ld, resetting to %ld\n", blocklength, hi->blocklength);
-            blocklength = hi->blocklength;
-         }
-         
-         /* Validate data before calling Updatetaskattrs to prevent memory corruption */
-         if(hi->fd && hi->fd->block && blocklength >= 0 && blocklength <= hi->fd->blocksize) {
-            debug_printf("DEBUG: Validating data before Updatetaskattrs: block=%p, length=%ld, parttype='%s' (strlen=%ld)\n", 
-                   hi->fd->block, blocklength, 
-                   hi->parttype[0] ? (char *)hi->parttype : "(none)",
-                   hi->parttype[0] ? strlen(hi->parttype) : 0);
-            
-            /* Track total bytes received for Content-Length validation (non-gzip transfers) */
-            /* Only track if not processing gzip (gzip tracks compressed_bytes_consumed separately) */
-            if(!(hi->flags & HTTPIF_GZIPDECODING) && !(hi->flags & HTTPIF_GZIPENCODED))
-            {  total_bytes_received += blocklength;
-               hi->bytes_received = total_bytes_received;  /* Update persistent counter for Range retry */
-               debug_printf("DEBUG: Total bytes received so far: %ld/%ld\n", total_bytes_received, expected_total_size > 0 ? expected_total_size : hi->partlength);
-            }
-            
-            /* Include content type if available to prevent defaulting to octet-stream */
-            /* Check if parttype is valid by checking first character and length */
-            if(hi->parttype[0] != '\0' && hi->parttype[0] != 0 && strlen(hi->parttype) > 0) {
-               debug_printf("DEBUG: Sending data with content type: '%s' (length=%ld)\n", hi->parttype, strlen(hi->parttype));
-            Updatetaskattrs(
-               AOURL_Data,hi->fd->block,
-               AOURL_Datalength,blocklength,
-                  AOURL_Contenttype,hi->parttype,
-               TAG_END);
-         } else {
-               debug_printf("DEBUG: WARNING: parttype is empty or invalid! Sending data without content type (will default to octet-stream)\n");
-               debug_printf("DEBUG: parttype[0]=0x%02X, parttype='%.31s'\n", (unsigned char)hi->parttype[0], hi->parttype);
-               Updatetaskattrs(
-                  AOURL_Data,hi->fd->block,
-                  AOURL_Datalength,blocklength,
-                  TAG_END);
-            }
-         } else {
-            debug_printf("DEBUG: Invalid data detected, skipping Updatetaskattrs to prevent memory corruption\n");
-            debug_printf("DEBUG: fd=%p, block=%p, blocklength=%ld, blocksize=%ld\n", 
-                   hi->fd, hi->fd ? hi->fd->block : NULL, blocklength, hi->fd ? hi->fd->blocksize : 0);
-         }
-         
-         /* Safe memory move with bounds checking */
-         if(blocklength < hi->blocklength && blocklength > 0) {
-            move_length = hi->blocklength - blocklength;
-            if(move_length > 0 && move_length <= hi->fd->blocksize) {
-               memmove(hi->fd->block, hi->fd->block + blocklength, move_length);
-               hi->blocklength = move_length;
-            } else {
-               debug_printf("DEBUG: Invalid move_length %ld, resetting blocklength\n", move_length);
-               hi->blocklength = 0;
-            }
-         } else if(blocklength >= hi->blocklength) {
-            hi->blocklength = 0;
-         }
-         
-         /* Handle blocklength differently for gzip vs non-gzip data */
-         /* This code should NEVER run if gzip decoding is active because we break out earlier */
-         if(hi->flags & HTTPIF_GZIPDECODING)
-         {  /* This should not happen - we should have broken out earlier */
-            debug_printf("DEBUG: ERROR: Regular data processing with gzip flag set! This is a bug.\n");
-            /* The gzip loop handles blocklength separately via decompressed_len */
-            d_stream.next_out=hi->fd->block;
-            d_stream.avail_out=hi->fd->blocksize;
-            /* Don't process this data - let gzip loop handle it */
-            break;
-         }
-         else
-         {  /* Only subtract blocklength for non-gzip data */
-            /* Only subtract if blocklength is valid and >= blocklength */
-            if(hi->blocklength > 0 && hi->blocklength >= blocklength)
-            {  hi->blocklength-=blocklength;
-            }
-            else if(hi->blocklength > 0 && hi->blocklength < blocklength)
-            {  /* This should not happen, but handle it safely */
-               debug_printf("DEBUG: WARNING: blocklength %ld < processed %ld, resetting\n", hi->blocklength, blocklength);
-               hi->blocklength = 0;
-            }
-            /* If blocklength is already 0 (e.g., after gzip cleanup), don't try to subtract */
-         }
-         if(boundary)
-         {  result=!eof;
-            break;
-         }
-      }
-      
-      debug_printf("DEBUG: Exited main for(;;) loop, now checking gzip processing\n");
-      
-      /* Gzip processing loop - continues until stream is complete */
-      /* This loop should NOT run if gzip was already processed in the main loop */
-      /* The inline loop above processes ALL gzip data, so this should only handle edge cases */
-      
-      /* Clean up flags if resources are already cleaned up BEFORE checking loop condition */
-      /* This prevents the loop from trying to run with invalid resources */
-      /* Also check if gzip_end was set, meaning gzip processing completed */
-      if(hi->flags & HTTPIF_GZIPDECODING && (gzipbuffer == NULL || !d_stream_initialized || gzip_end)) {
-         if(gzipbuffer == NULL || !d_stream_initialized) {
-            debug_printf("DEBUG: Flag is set but resources cleaned up - clearing flags to prevent crash\n");
-         }
-         if(gzip_end) {
-            debug_printf("DEBUG: Flag is set but gzip_end is set - clearing flags as gzip processing is complete\n");
-         }
-         hi->flags &= ~HTTPIF_GZIPDECODING;
-         hi->flags &= ~HTTPIF_GZIPENCODED;
-      }
-      
-      if(d_stream_initialized) {
-         debug_printf("DEBUG: Checking gzip loop condition: flags=0x%04X, HTTPIF_GZIPDECODING=0x%04X, gzip_end=%u, gzipbuffer=%p, d_stream.avail_in=%lu\n",
-                hi->flags, HTTPIF_GZIPDECODING, gzip_end, gzipbuffer, d_stream.avail_in);
-      } else {
-         debug_printf("DEBUG: Checking gzip loop condition: flags=0x%04X, HTTPIF_GZIPDECODING=0x%04X, gzip_end=%u, gzipbuffer=%p, d_stream NOT initialized\n",
-                hi->flags, HTTPIF_GZIPDECODING, gzip_end, gzipbuffer);
-      }
-      if(hi->flags & HTTPIF_GZIPDECODING && !gzip_end && gzipbuffer != NULL && d_stream_initialized) {
-         if(d_stream_initialized) {
-            debug_printf("DEBUG: Entering gzip processing loop, flags=0x%04X, gzipbuffer=%p, gzip_end=%u, avail_in=%lu\n", 
-                   hi->flags, gzipbuffer, gzip_end, d_stream.avail_in);
-         } else {
-            debug_printf("DEBUG: Entering gzip processing loop, flags=0x%04X, gzipbuffer=%p, gzip_end=%u\n", 
-                   hi->flags, gzipbuffer, gzip_end);
-         }
-      } else {
-         debug_printf("DEBUG: NOT entering gzip loop - flags check: %d, gzip_end check: %d, gzipbuffer check: %d, d_stream_initialized: %d\n",
-                (hi->flags & HTTPIF_GZIPDECODING) != 0, gzip_end == 0, gzipbuffer != NULL, d_stream_initialized);
-         /* Clean up if flag is still set but we're not entering the loop */
-         if(hi->flags & HTTPIF_GZIPDECODING) {
-            debug_printf("DEBUG: Flag is set but loop not running - cleaning up\n");
-            if(gzipbuffer) {
-               FREE(gzipbuffer);
-               gzipbuffer = NULL;
-            }
-            if(d_stream_initialized) {
-               inflateEnd(&d_stream);
-               d_stream_initialized = FALSE;
-            }
-            hi->flags &= ~HTTPIF_GZIPDECODING;
-            hi->flags &= ~HTTPIF_GZIPENCODED;
-         }
-      }
-      while(hi->flags & HTTPIF_GZIPDECODING && !gzip_end && gzipbuffer != NULL && d_stream_initialized)
-      {  /* Declare all variables at start of loop for C89 compliance */
-         long final_len;
-         long error_len;
-         long decompressed_len;
-         UBYTE *buffer_start;
-         UBYTE *buffer_end;
-         UBYTE *data_check;
-         BOOL data_valid;
-         int i;
-         
-         /* Re-validate all conditions inside loop to prevent crashes */
-         if(gzip_end>0 || gzipbuffer == NULL || !d_stream_initialized) {
-            debug_printf("DEBUG: Gzip loop: Invalid state detected, exiting (gzip_end=%d, gzipbuffer=%p, d_stream_initialized=%d)\n",
-                   gzip_end, gzipbuffer, d_stream_initialized);
-            break;
-         }
-         
-         /* Validate d_stream.next_in points to valid memory before using it */
-         if(d_stream.next_in != NULL && d_stream.next_in != gzipbuffer && 
-            (d_stream.next_in < gzipbuffer || d_stream.next_in >= gzipbuffer + gzip_buffer_size)) {
-            debug_printf("DEBUG: d_stream.next_in (%p) is invalid, clearing flags\n", d_stream.next_in);
-            hi->flags &= ~HTTPIF_GZIPDECODING;
-            hi->flags &= ~HTTPIF_GZIPENCODED;
-            break;
-         }
-         
-         /* Process the current gzip data */
-         if(d_stream.avail_in > 0 && d_stream.next_in != NULL) {
-            err=inflate(&d_stream,Z_SYNC_FLUSH);
-         } else {
-            err=Z_OK; /* No input to process */
-         }
-         
-         /* Handle zlib return codes */
-         if(err==Z_BUF_ERROR) {
-            /* Output buffer is full - this is normal, not an error */
-            debug_printf("DEBUG: Output buffer full, processing current data and continuing\n");
-            /* Process the current decompressed data */
-            hi->blocklength=hi->fd->blocksize-d_stream.avail_out;
-            debug_printf("DEBUG: Processing %ld bytes of decompressed data\n", hi->blocklength);
-            
-            /* Validate blocklength before processing to prevent memory corruption */
-            if(hi->blocklength < 0 || hi->blocklength > hi->fd->blocksize) {
-               debug_printf("DEBUG: Invalid blocklength %ld in Z_BUF_ERROR, resetting to prevent memory corruption\n", hi->blocklength);
-               hi->blocklength = 0;
-               inflateEnd(&d_stream);
-               hi->flags &= ~HTTPIF_GZIPENCODED;
-               hi->flags &= ~HTTPIF_GZIPDECODING;
-               gzip_end = 1;
-               break;
-            }
-            
-            /* Update task attributes with current data */
-            if(hi->parttype[0] && strstr(hi->parttype, "text/html")) {
-            Updatetaskattrs(
-               AOURL_Data,hi->fd->block,
-               AOURL_Datalength,hi->blocklength,
-                  AOURL_Contenttype, "text/html",
-               TAG_END);
-            } else {
-               Updatetaskattrs(
-                  AOURL_Data,hi->fd->block,
-                  AOURL_Datalength,hi->blocklength,
-                  TAG_END);
-            }
-            
-            /* Reset output buffer for next chunk */
-            d_stream.next_out=hi->fd->block;
-            d_stream.avail_out=hi->fd->blocksize;
-            
-            /* Continue decompression - but add safety check to prevent infinite loops */
-            /* For Content-Length gzip transfers, rely on Content-Length validation instead of loop limit */
-            /* For chunked gzip, use a high limit to prevent infinite loops while allowing large transfers */
-            if(!(hi->flags & HTTPIF_CHUNKED) && hi->partlength > 0)
-            {  /* Content-Length gzip transfer - track count but don't limit */
-               loop_count++; /* Track but don't limit - Content-Length check will handle completion */
-            }
-            else
-            {  /* Chunked or unknown length gzip - use high limit to prevent infinite loops */
-               if(++loop_count > 10000) {
-                  debug_printf("DEBUG: Too many buffer full cycles (%d), finishing gzip\n", loop_count);
-                  gzip_end=1;
-                  break;
-               }
-            }
-            continue;
-         }
-         else if(err==Z_STREAM_END) {
-            debug_printf("DEBUG: Gzip decompression completed successfully\n");
-            /* Process any remaining decompressed data before exiting */
-            if(d_stream.avail_out < hi->fd->blocksize) {
-               final_len = hi->fd->blocksize - d_stream.avail_out;
-               if(final_len > 0 && final_len <= hi->fd->blocksize) {
-                  debug_printf("DEBUG: Processing final %ld bytes from gzip stream\n", final_len);
-                  if(hi->parttype[0] && strstr(hi->parttype, "text/html")) {
-                     Updatetaskattrs(
-                        AOURL_Data, hi->fd->block,
-                        AOURL_Datalength, final_len,
-                        AOURL_Contenttype, "text/html",
-                        TAG_END);
-                  } else {
-                     Updatetaskattrs(
-                        AOURL_Data, hi->fd->block,
-                        AOURL_Datalength, final_len,
-                        TAG_END);
-                  }
-                  hi->flags |= HTTPIF_DATA_PROCESSED;
-               }
-            }
-            
-            /* When Z_STREAM_END is returned, zlib has finished decompressing */
-            /* compressed_bytes_consumed tracks data we've copied to gzipbuffer and processed */
-            /* For Content-Length tracking, we need to account for any remaining unprocessed data in the buffer */
-            /* Note: d_stream.avail_in at Z_STREAM_END should typically be 0 for a valid gzip stream */
-            if(!(hi->flags & HTTPIF_CHUNKED) && hi->partlength > 0)
-            {  long remaining_in_buffer;
-               remaining_in_buffer = d_stream.avail_in;
-               if(remaining_in_buffer > 0)
-               {  debug_printf("DEBUG: Z_STREAM_END: %ld bytes remain unprocessed in buffer (this is unusual for gzip)\n", remaining_in_buffer);
-                  /* This data is part of what was read from network, but not processed by zlib */
-                  /* For Content-Length tracking, we should count it, but it's already counted in compressed_bytes_consumed */
-                  /* since we copied it to gzipbuffer. The issue is zlib didn't consume it all. */
-               }
-               debug_printf("DEBUG: Z_STREAM_END: compressed_bytes_consumed=%ld, Content-Length=%ld, remaining_in_buffer=%ld\n",
-                      compressed_bytes_consumed, hi->partlength, remaining_in_buffer);
-            }
-            
-            /* Clean up immediately when stream ends */
-            if(d_stream_initialized) {
-               inflateEnd(&d_stream);
-               d_stream_initialized = FALSE;
-            }
-            if(gzipbuffer) {
-               FREE(gzipbuffer);
-               gzipbuffer = NULL;
-            }
-            hi->flags &= ~HTTPIF_GZIPENCODED;
-            hi->flags &= ~HTTPIF_GZIPDECODING;
-            gzip_end=1; // Success break!
-         }
-         else if(err!=Z_OK)
-         {  if(err==Z_DATA_ERROR) printf("zlib DATA ERROR - avail_in=%lu, avail_out=%lu\n", d_stream.avail_in, d_stream.avail_out);
-            if(err==Z_STREAM_ERROR) printf("zlib STREAM_ERROR - avail_in=%lu, avail_out=%lu\n", d_stream.avail_in, d_stream.avail_out);
-            if(err==Z_NEED_DICT) printf("zlib NEED DICT - avail_in=%lu, avail_out=%lu\n", d_stream.avail_in, d_stream.avail_out);
-            if(err==Z_MEM_ERROR) printf("zlib MEM ERROR - avail_in=%lu, avail_out=%lu\n", d_stream.avail_in, d_stream.avail_out);
-            
-            /* On any zlib error, process any valid decompressed data first */
-            /* Then safely disable gzip to prevent memory corruption */
-            if(d_stream.avail_out < hi->fd->blocksize) {
-               /* We might have some valid decompressed data before the error */
-               error_len = hi->fd->blocksize - d_stream.avail_out;
-               if(error_len > 0 && error_len <= hi->fd->blocksize) {
-                  debug_printf("DEBUG: Processing %ld bytes before zlib error\n", error_len);
-                  if(hi->parttype[0] && strstr(hi->parttype, "text/html")) {
-                     Updatetaskattrs(
-                        AOURL_Data, hi->fd->block,
-                        AOURL_Datalength, error_len,
-                        AOURL_Contenttype, "text/html",
-                        TAG_END);
-                  } else {
-                     Updatetaskattrs(
-                        AOURL_Data, hi->fd->block,
-                        AOURL_Datalength, error_len,
-                        TAG_END);
-                  }
-                  hi->flags |= HTTPIF_DATA_PROCESSED;
-               }
-            }
-            
-         debug_printf("DEBUG: Zlib error detected, safely disabling gzip to prevent crashes\n");
-         
-         /* Clean up zlib stream immediately */
-            if(d_stream_initialized) {
-         inflateEnd(&d_stream);
-               d_stream_initialized = FALSE;
-            }
-            
-            /* Free gzip buffer */
-            if(gzipbuffer) {
-               FREE(gzipbuffer);
-               gzipbuffer = NULL;
-            }
-         
-         /* Reset all gzip flags */
-         hi->flags &= ~HTTPIF_GZIPENCODED;
-         hi->flags &= ~HTTPIF_GZIPDECODING;
-         
-         /* Reset output buffer safely */
-         hi->blocklength = 0;
-         d_stream.avail_out = hi->fd->blocksize;
-         d_stream.next_out = hi->fd->block;
-         
-         /* Break out of gzip processing to prevent further corruption */
-         gzip_end = 1;
-         break;
-         }
-         
-         /* If we need more input data, read it */
-         if((err==Z_OK || err==Z_BUF_ERROR) && d_stream.avail_in==0 && !gzip_end)
-         {  /* Read more compressed data from network */
-            if(!Readblock(hi))
-            {  debug_printf("DEBUG: No more data for gzip, ending\n");
-               gzip_end = 1;
-               break;
-            }
-            /* Update total compressed bytes read from network */
-            total_compressed_read += hi->blocklength;
-            
-            /* For non-chunked, append new block data to gzipbuffer */
-            if(!(hi->flags & HTTPIF_CHUNKED))
-            {  /* Non-chunked: Append all new block data to gzipbuffer */
-               long remaining_space;
-               long bytes_to_append;
-               long used_space;
-               
-               /* Calculate space used in buffer */
-               used_space = (d_stream.next_in - gzipbuffer) + d_stream.avail_in;
-               remaining_space = gzip_buffer_size - used_space;
-               
-               if(remaining_space <= 0 || hi->blocklength > remaining_space)
-               {  debug_printf("DEBUG: Non-chunked gzip: Buffer full (remaining=%ld, block=%ld), ending\n",
-                         remaining_space, hi->blocklength);
-                  gzip_end = 1;
-                  break;
-               }
-               
-               bytes_to_append = MIN(hi->blocklength, remaining_space);
-               if(bytes_to_append > 0)
-               {  /* Move unprocessed data to start if needed */
-                  if(d_stream.next_in != gzipbuffer && d_stream.avail_in > 0)
-                  {  memmove(gzipbuffer, d_stream.next_in, d_stream.avail_in);
-                     gziplength = d_stream.avail_in;
-                  }
-                  else if(d_stream.avail_in == 0)
-                  {  gziplength = 0;
-                  }
-                  
-                  /* Append new data */
-                  if(gziplength + bytes_to_append <= gzip_buffer_size)
-                  {  memcpy(gzipbuffer + gziplength, hi->fd->block, bytes_to_append);
-                     gziplength += bytes_to_append;
-                     compressed_bytes_consumed += bytes_to_append;
-                     
-                     /* Update zlib stream */
-                     d_stream.next_in = gzipbuffer;
-                     d_stream.avail_in = gziplength;
-                     
-                     debug_printf("DEBUG: Non-chunked gzip: Added %ld bytes from new block (total in buffer=%ld)\n",
-                            bytes_to_append, gziplength);
-                     
-                     /* Clear block */
-                     hi->blocklength = 0;
-                  }
-               }
-            }
-            /* For chunked encoding, we need to extract chunks - this is handled in the chunked+gzip section above */
-            
-            /* Add timeout protection to prevent infinite hanging */
-            /* For Content-Length gzip transfers, rely on Content-Length validation instead of loop limit */
-            /* For chunked gzip, use a high limit to prevent infinite loops while allowing large transfers */
-            if(!(hi->flags & HTTPIF_CHUNKED) && hi->partlength > 0)
-            {  /* Content-Length gzip transfer - track count but don't limit */
-               loop_count++; /* Track but don't limit - Content-Length check will handle completion */
-            }
-            else
-            {  /* Chunked or unknown length gzip - use high limit to prevent infinite loops */
-               if(++loop_count > 10000) {
-                  debug_printf("DEBUG: Too many gzip input cycles (%d), finishing\n", loop_count);
-                  /* Clean up when loop limit reached */
-                  if(d_stream_initialized) {
-                     inflateEnd(&d_stream);
-                     d_stream_initialized = FALSE;
-                  }
-                  if(gzipbuffer) {
-                     FREE(gzipbuffer);
-                     gzipbuffer = NULL;
-                  }
-                  hi->flags &= ~HTTPIF_GZIPENCODED;
-                  hi->flags &= ~HTTPIF_GZIPDECODING;
-                  gzip_end=1;
-                  break;
-               }
-            }
-            
-            /* For chunked encoding, read into block first, then extract chunk data */
-            if(hi->flags & HTTPIF_CHUNKED)
-            {  /* Declare all variables at start of block for C89 compliance */
-               long chunk_data_start;
-               long gzip_data_start;
-               long search_pos;
-               long chunk_data_len;
-               long remaining_unprocessed;
-               long available_space;
-               UBYTE *p;
-               
-               /* Read chunk data into block buffer first */
-               if(!Readblock(hi))
-               {  debug_printf("DEBUG: End of chunked gzip stream\n");
-                  /* Clean up when we reach end of stream */
-                  if(d_stream_initialized) {
-                     inflateEnd(&d_stream);
-                     d_stream_initialized = FALSE;
-                  }
-                  if(gzipbuffer) {
-                     FREE(gzipbuffer);
-                     gzipbuffer = NULL;
-                  }
-                  hi->flags &= ~HTTPIF_GZIPENCODED;
-                  hi->flags &= ~HTTPIF_GZIPDECODING;
-                  gzip_end=1;
-                  break;
-               }
-               
-               /* Extract chunk data (skip chunk header) */
-               chunk_data_start = 0;
-               p = hi->fd->block;
-               
-               /* Find end of chunk size line */
-               {  long chunk_size_start = chunk_data_start;
-                  long chunk_size_value = 0;
-                  BOOL found_crlf = FALSE;
-                  
-                  /* Parse chunk size hex number */
-                  while(chunk_data_start < hi->blocklength)
-                  {  UBYTE c;
-                     long digit;
-                     
-                     c = p[chunk_data_start];
-                     if(c >= '0' && c <= '9')
-                     {  digit = c - '0';
-                     }
-                     else if(c >= 'A' && c <= 'F')
-                     {  digit = c - 'A' + 10;
-                     }
-                     else if(c >= 'a' && c <= 'f')
-                     {  digit = c - 'a' + 10;
-                     }
-                     else if(c == '\r' || c == '\n')
-                     {  /* Found CRLF - end of chunk header */
-                        found_crlf = TRUE;
-                        break;
-                     }
-                     else
-                     {  /* Invalid character in chunk size */
-                        debug_printf("DEBUG: Invalid character in chunk size header (0x%02X at pos %ld)\n", 
-                              (unsigned char)c, chunk_data_start);
-                        /* Try to find CRLF anyway */
-                        break;
-                     }
-                     
-                     /* Check for overflow */
-                     if(chunk_size_value > 0x7FFFFFFF / 16)
-                     {  debug_printf("DEBUG: Chunk size overflow in chunked gzip parsing\n");
-                        chunk_size_value = -1;
-                        break;
-                     }
-                     
-                     chunk_size_value = chunk_size_value * 16 + digit;
-                     chunk_data_start++;
-                     
-                     /* Limit hex digits */
-                     if(chunk_data_start - chunk_size_start > 16)
-                     {  debug_printf("DEBUG: Chunk size hex number too long in chunked gzip\n");
-                        chunk_size_value = -1;
-                        break;
-                     }
-                  }
-                  
-                  /* Validate chunk size */
-                  if(chunk_size_value < 0)
-                  {  debug_printf("DEBUG: Invalid chunk size in chunked gzip, aborting\n");
-                     if(bdcopy) { FREE(bdcopy); bdcopy = NULL; }
-                     if(gzipbuffer) { FREE(gzipbuffer); gzipbuffer = NULL; }
-                     if(d_stream_initialized) { inflateEnd(&d_stream); d_stream_initialized = FALSE; }
-                     Updatetaskattrs(AOURL_Error, TRUE, TAG_END);
-                     return FALSE;
-                  }
-                  
-                  /* Find CRLF after chunk size */
-                  if(!found_crlf)
-                  {  while(chunk_data_start < hi->blocklength - 1)
-                     {  if(p[chunk_data_start] == '\r' && chunk_data_start + 1 < hi->blocklength && p[chunk_data_start + 1] == '\n')
-                        {  chunk_data_start += 2; /* Skip CRLF */
-                           found_crlf = TRUE;
-                           break;
-                        }
-                        chunk_data_start++;
-                     }
-                  }
-                  else
-                  {  /* Skip CRLF */
-                     if(chunk_data_start < hi->blocklength && p[chunk_data_start] == '\r')
-                     {  chunk_data_start++;
-                     }
-                     if(chunk_data_start < hi->blocklength && p[chunk_data_start] == '\n')
-                     {  chunk_data_start++;
-                     }
-                  }
-                  
-                  if(!found_crlf)
-                  {  debug_printf("DEBUG: No chunk data found, waiting for more\n");
-                     /* Not enough data yet - wait */
-                     continue;
-                  }
-               }
-               
-               /* Find actual gzip data start (should be immediately after chunk header) */
-               gzip_data_start = chunk_data_start;
-               if(hi->blocklength - gzip_data_start >= 3)
-               {  /* Check if it starts with gzip magic */
-                  if(p[gzip_data_start] != 0x1F || p[gzip_data_start + 1] != 0x8B || p[gzip_data_start + 2] != 0x08)
-                  {  /* Look for gzip magic in this chunk */
-                     search_pos = gzip_data_start;
-                     for(; search_pos < hi->blocklength - 2; search_pos++)
-                     {  if(p[search_pos] == 0x1F && p[search_pos + 1] == 0x8B && p[search_pos + 2] == 0x08)
-                        {  gzip_data_start = search_pos;
-                           break;
-                        }
-                     }
-                  }
-               }
-               
-               chunk_data_len = hi->blocklength - gzip_data_start;
-               if(chunk_data_len > 0)
-               {  /* For chunked encoding, accumulate chunks into a larger buffer */
-                  /* Calculate remaining unprocessed data */
-                  remaining_unprocessed = d_stream.avail_in;
-                  
-                  /* Validate remaining_unprocessed is reasonable */
-                  if(remaining_unprocessed < 0 || remaining_unprocessed > gzip_buffer_size)
-                  {  debug_printf("DEBUG: Invalid remaining_unprocessed (%ld), resetting to 0\n", remaining_unprocessed);
-                     remaining_unprocessed = 0;
-                  }
-                  
-                  /* Move remaining unprocessed data to start of buffer to make room */
-                  if(d_stream.next_in != gzipbuffer && remaining_unprocessed > 0)
-                  {  /* Validate pointers and sizes before memmove to prevent corruption */
-                     if(remaining_unprocessed > gzip_buffer_size)
-                     {  debug_printf("DEBUG: remaining_unprocessed (%ld) exceeds buffer size (%ld), resetting\n",
-                               remaining_unprocessed, gzip_buffer_size);
-                        remaining_unprocessed = 0;
-                        gziplength = 0;
-                     }
-                     else if(d_stream.next_in >= gzipbuffer && 
-                             d_stream.next_in < gzipbuffer + gzip_buffer_size &&
-                             (d_stream.next_in + remaining_unprocessed) <= gzipbuffer + gzip_buffer_size &&
-                             remaining_unprocessed > 0)
-                     {  memmove(gzipbuffer, d_stream.next_in, remaining_unprocessed);
-                        d_stream.next_in = gzipbuffer;
-                        d_stream.avail_in = remaining_unprocessed;
-                        gziplength = remaining_unprocessed;
-                     }
-                     else
-                     {  debug_printf("DEBUG: Invalid pointer state for memmove (next_in=%p, gzipbuffer=%p, remaining=%ld, buffer_size=%ld), resetting\n",
-                               d_stream.next_in, gzipbuffer, remaining_unprocessed, gzip_buffer_size);
-                        remaining_unprocessed = 0;
-                        gziplength = 0;
-                     }
-                  }
-                  else if(remaining_unprocessed > 0)
-                  {  /* Already at start - ensure gziplength is set correctly */
-                     gziplength = remaining_unprocessed;
-                  }
-                  else
-                  {  /* All data consumed - reset gziplength for new data */
-                     gziplength = 0;
-                  }
-                  
-                  /* Check if we have space for new chunk */
-                  available_space = gzip_buffer_size - gziplength;
-                  if(chunk_data_len > available_space)
-                  {  debug_printf("DEBUG: WARNING: Chunk data (%ld) exceeds available space (%ld), truncating\n", 
-                            chunk_data_len, available_space);
-                     chunk_data_len = available_space > 0 ? available_space : 0;
-                     if(chunk_data_len <= 0)
-                     {  debug_printf("DEBUG: No space in gzipbuffer for chunk data\n");
-                        gzip_end = 1;
-                        break;
-                     }
-                  }
-                  
-                  /* Append chunk data to end of gzipbuffer */
-                  if(gziplength + chunk_data_len > gzip_buffer_size)
-                  {  debug_printf("DEBUG: Buffer overflow! gziplength=%ld, chunk_data_len=%ld, buffer_size=%ld\n",
-                            gziplength, chunk_data_len, gzip_buffer_size);
-                     gzip_end = 1;
-                     break;
-                  }
-                  
-                  /* Validate source and destination pointers before memcpy */
-                  if(gzipbuffer && hi->fd->block && 
-                     gziplength >= 0 && gziplength < gzip_buffer_size &&
-                     chunk_data_len > 0 && chunk_data_len <= available_space &&
-                     gzip_data_start >= 0 && gzip_data_start < hi->blocklength &&
-                     (gzip_data_start + chunk_data_len) <= hi->blocklength)
-                  {  memcpy(gzipbuffer + gziplength, hi->fd->block + gzip_data_start, chunk_data_len);
-                     compressed_bytes_consumed += chunk_data_len; /* Track compressed data consumed */
-                  }
-                  else
-                  {  debug_printf("DEBUG: Invalid pointers for memcpy (gzipbuffer=%p, block=%p, gziplength=%ld, chunk_data_len=%ld, gzip_data_start=%ld, blocklength=%ld), aborting\n",
-                            gzipbuffer, hi->fd ? hi->fd->block : NULL, gziplength, chunk_data_len, gzip_data_start, hi->blocklength);
-                     gzip_end = 1;
-                     break;
-                  }
-                  
-                  /* Update zlib stream to include new data */
-                  d_stream.next_in = gzipbuffer; /* Point to start */
-                  
-                  /* Update total gziplength first, then set avail_in to match */
-                  gziplength += chunk_data_len;
-                  d_stream.avail_in = gziplength; /* Total available now */
-                  
-                  /* Clear processed chunk data from block */
-                  hi->blocklength = 0;
-                  
-                  debug_printf("DEBUG: Read %ld bytes of chunked gzip data (unprocessed was=%ld), total in buffer: %ld, avail_in: %lu\n", 
-                         chunk_data_len, remaining_unprocessed, gziplength, d_stream.avail_in);
-               }
-               else
-               {  /* No data in this chunk - might be end chunk */
-                  debug_printf("DEBUG: Empty chunk, checking for end\n");
-                  gzip_end=1;
-                  break;
-               }
-            }
-            else
-            {  /* Non-chunked: read directly into gzipbuffer */
-            gziplength=Receive(hi,gzipbuffer,gzip_buffer_size);
-            if(gziplength<=0)
-            {  
-               if(gziplength < 0) {
-                  debug_printf("DEBUG: Network error during gzip processing: %ld\n", gziplength);
-               } else {
-                  debug_printf("DEBUG: End of gzip data stream\n");
-               }
-               gzip_end=1; // Finished or Error
-            }
-            else
-            {  d_stream.next_in=gzipbuffer;
-               d_stream.avail_in=gziplength;
-            }
-            }
-         }
-         
-         /* Only calculate blocklength if we have decompressed data */
-         /* Don't reset blocklength here - it may still contain valid data */
-         if(d_stream.avail_out < hi->fd->blocksize) {
-            /* We have decompressed some data */
-            decompressed_len = hi->fd->blocksize - d_stream.avail_out;
-            
-            debug_printf("DEBUG: Gzip decompressed %ld bytes\n", decompressed_len);
-         
-            /* Validate decompressed length immediately to prevent memory corruption */
-            if(decompressed_len < 0 || decompressed_len > hi->fd->blocksize) {
-               debug_printf("DEBUG: Invalid decompressed length %ld calculated, aborting\n", decompressed_len);
-            inflateEnd(&d_stream);
-            hi->flags &= ~HTTPIF_GZIPENCODED;
-            hi->flags &= ~HTTPIF_GZIPDECODING;
-               hi->blocklength = 0;
-            gzip_end = 1;
-            break;
-         }
-         
-                  /* Process decompressed data immediately to ensure it's not lost */
-            if(hi->fd && hi->fd->block && decompressed_len > 0) {
-               debug_printf("DEBUG: Processing %ld bytes of decompressed data immediately\n", decompressed_len);
-            
-            /* Ensure proper content type is set for HTML parsing */
-            /* Check if we have HTML content type from headers */
-            if(hi->parttype[0] && strstr(hi->parttype, "text/html")) {
-               debug_printf("DEBUG: Content type is HTML, ensuring proper parsing\n");
-                  Updatetaskattrs(
-                     AOURL_Data, hi->fd->block,
-                     AOURL_Datalength, decompressed_len,
-                     AOURL_Contenttype, "text/html",
-                     TAG_END);
-               } else {
-                  debug_printf("DEBUG: Content type: %s, processing as-is\n", hi->parttype[0] ? (char *)hi->parttype : "unknown");
-                  Updatetaskattrs(
-                     AOURL_Data, hi->fd->block,
-                     AOURL_Datalength, decompressed_len,
-                     TAG_END);
-            }
-            
-            /* Mark this data as already processed to prevent duplication */
-            hi->flags |= HTTPIF_DATA_PROCESSED;
-               
-               /* Reset output buffer for next decompression cycle */
-               d_stream.next_out = hi->fd->block;
-               d_stream.avail_out = hi->fd->blocksize;
-               /* DON'T reset blocklength here - it's managed separately */
-            }
-            
-            /* Continue processing - only exit when gzip_end is set (Z_STREAM_END) */
-            if(gzip_end) {
-               debug_printf("DEBUG: Gzip stream complete, exiting processing loop\n");
-            break;
-            }
-         }
-         
-         /* Memory bounds validation with actual canary-like protection */
-         if(hi->blocklength < 0 || hi->blocklength > hi->fd->blocksize) {
-            debug_printf("DEBUG: Invalid blocklength %ld after decompression, aborting\n", hi->blocklength);
-            inflateEnd(&d_stream);
-            hi->flags &= ~HTTPIF_GZIPENCODED;
-            hi->flags &= ~HTTPIF_GZIPDECODING;
-            hi->blocklength = 0;
-            gzip_end = 1;
-            break;
-         }
-         
-         /* Buffer overflow protection - validate the actual buffer */
-         if(hi->fd->block && hi->blocklength > 0) {
-            buffer_start = hi->fd->block;
-            buffer_end = buffer_start + hi->blocklength;
-            
-            /* Check if buffer pointers are valid memory addresses */
-            if((ULONG)buffer_start < 0x1000 || (ULONG)buffer_start > 0xFFFFFFF0) {
-               debug_printf("DEBUG: Invalid buffer start address 0x%08lX\n", (ULONG)buffer_start);
-               hi->blocklength = 0;
-               gzip_end = 1;
-               break;
-            }
-            
-            /* Check if buffer end is within valid range */
-            if((ULONG)buffer_end < 0x1000 || (ULONG)buffer_end > 0xFFFFFFF0) {
-               debug_printf("DEBUG: Invalid buffer end address 0x%08lX\n", (ULONG)buffer_end);
-               hi->blocklength = 0;
-               gzip_end = 1;
-               break;
-            }
-            
-            /* Verify buffer doesn't wrap around */
-            if((ULONG)buffer_end <= (ULONG)buffer_start) {
-               debug_printf("DEBUG: Buffer wrap-around detected\n");
-               hi->blocklength = 0;
-               gzip_end = 1;
-               break;
-            }
-            
-            /* Heap corruption detection - check memory allocation integrity */
-            if(hi->fd->blocksize > 0) {
-               /* Check if blocksize is reasonable (not corrupted) */
-               if(hi->fd->blocksize > 1024*1024) { /* 1MB max */
-                  debug_printf("DEBUG: Corrupted blocksize detected: %ld\n", hi->fd->blocksize);
-                  hi->blocklength = 0;
-                  gzip_end = 1;
-                  break;
-               }
-               
-               /* Only validate that block pointer is a reasonable memory address */
-               /* Don't check if it's within filedata structure - it's a separate buffer! */
-               if((ULONG)buffer_start < 0x1000 || (ULONG)buffer_start > 0xFFFFFFF0) {
-                  debug_printf("DEBUG: Block pointer is invalid memory address: 0x%08lX\n", (ULONG)buffer_start);
-                  hi->blocklength = 0;
-                  gzip_end = 1;
-                  break;
-               }
-            }
-         }
-         
-         /* Safety check - ensure blocklength is valid to prevent memory corruption */
-         if(hi->blocklength < 0 || hi->blocklength > hi->fd->blocksize) {
-            debug_printf("DEBUG: Invalid blocklength %ld, resetting to 0 to prevent crash\n", hi->blocklength);
-            hi->blocklength = 0;
-            
-            /* If we get invalid data, disable gzip to prevent further corruption */
-            debug_printf("DEBUG: Disabling gzip due to invalid decompressed data\n");
-            hi->flags &= ~HTTPIF_GZIPENCODED;
-            hi->flags &= ~HTTPIF_GZIPDECODING;
-            gzip_end = 1;
-            break;
-         }
-         
-         /* If we have no more input and no more output, we're done */
-         if(d_stream.avail_in==0 && d_stream.avail_out==hi->fd->blocksize && !gzip_end) {
-            debug_printf("DEBUG: No more input data, gzip decompression complete\n");
-            gzip_end=1;
-         }
-         
-         /* Validate decompressed data to prevent memory corruption */
-         if(hi->blocklength > 0) {
-            data_check = hi->fd->block;
-            data_valid = TRUE;
-            i = 0;
-            
-            /* Buffer pointer validation FIRST */
-            if((ULONG)data_check < 0x1000 || (ULONG)data_check > 0xFFFFFFF0) {
-               debug_printf("DEBUG: Invalid buffer pointer 0x%08lX, disabling gzip\n", (ULONG)data_check);
-               hi->flags &= ~HTTPIF_GZIPENCODED;
-               hi->flags &= ~HTTPIF_GZIPDECODING;
-               hi->blocklength = 0;
-               gzip_end = 1;
-               break;
-            }
-            
-            /* Check first few bytes for reasonable data */
-            for(i = 0; i < hi->blocklength && i < 16; i++) {
-               if(data_check[i] < 0x20 && data_check[i] != 0x09 && data_check[i] != 0x0A && data_check[i] != 0x0D) {
-                  if(data_check[i] != 0x00) { /* Allow null bytes */
-                     data_valid = FALSE;
-                     break;
-                  }
-               }
-            }
-            
-            if(!data_valid) {
-               debug_printf("DEBUG: Decompressed data contains invalid characters, disabling gzip\n");
-               hi->flags &= ~HTTPIF_GZIPENCODED;
-               hi->flags &= ~HTTPIF_GZIPDECODING;
-               hi->blocklength = 0;
-               gzip_end = 1;
-               break;
-            }
-         }
-      } /* End of gzip processing while loop */
-      
-      /* Clean up gzip resources after processing */
-      if(hi->flags & HTTPIF_GZIPDECODING) {
-         debug_printf("DEBUG: Cleaning up gzip resources, flags before cleanup=0x%04X, d_stream_initialized=%d\n", 
-                hi->flags, d_stream_initialized);
-         /* Gzip processing completed - clean up */
-         if(d_stream_initialized) {
-            inflateEnd(&d_stream);
-            d_stream_initialized = FALSE;
-         }
-         if(gzipbuffer) {
-            FREE(gzipbuffer);
-            gzipbuffer = NULL;
-         }
-         hi->flags &= ~HTTPIF_GZIPDECODING;
-         hi->flags &= ~HTTPIF_GZIPENCODED;
-         debug_printf("DEBUG: Gzip cleanup complete, flags after cleanup=0x%04X\n", hi->flags);
-         
-         /* Account for any remaining compressed data in current block */
-         if(hi->blocklength > 0)
-         {  total_compressed_read += hi->blocklength;
-            debug_printf("DEBUG: Accounting for %ld bytes remaining in block after gzip cleanup\n", hi->blocklength);
-         }
-         
-         /* Reset blocklength to 0 after gzip processing is complete */
-         /* This is safe because all gzip data has been processed and sent via Updatetaskattrs */
-         hi->blocklength = 0;
-         
-         /* For non-chunked gzip streams, all data has been decompressed */
-         /* For Content-Length responses, read exactly that much compressed data from network */
-         if(!(hi->flags & HTTPIF_CHUNKED))
-         {  if(hi->partlength > 0)
-            {  debug_printf("DEBUG: Non-chunked gzip complete, read %ld/%ld compressed bytes from network, reading remaining\n", 
-                      total_compressed_read, hi->partlength);
-               while(total_compressed_read < hi->partlength && Readblock(hi))
-               {  long compressed_in_block;
-                  compressed_in_block = hi->blocklength;
-                  total_compressed_read += compressed_in_block;
-                  hi->blocklength = 0; /* Discard consumed compressed data */
-                  debug_printf("DEBUG: Read %ld bytes from network, total=%ld/%ld\n", 
-                         compressed_in_block, total_compressed_read, hi->partlength);
-               }
-               debug_printf("DEBUG: Finished reading compressed data from network: %ld/%ld bytes\n", 
-                      total_compressed_read, hi->partlength);
-               
-               /* Validate Content-Length: warn if we didn't read the expected amount */
-               if(total_compressed_read != hi->partlength)
-               {  debug_printf("DEBUG: WARNING - Content-Length mismatch: read %ld bytes, expected %ld bytes\n",
-                         total_compressed_read, hi->partlength);
-                  /* This could indicate a server error or connection issue, but don't fail the request */
-                  /* since decompression already completed successfully */
-               }
-            }
-            else
-            {  debug_printf("DEBUG: Non-chunked gzip complete, no Content-Length, reading until EOF\n");
-               while(Readblock(hi))
-               {  /* Discard remaining compressed data - it's already been decompressed */
-                  total_compressed_read += hi->blocklength;
-                  hi->blocklength = 0;
-               }
-            }
-            /* Exit Readdata - gzip response is complete */
-            result = !eof;
-            if(bdcopy) FREE(bdcopy);
-            return result;
-         }
-      } else if(gzipbuffer != NULL) {
-         debug_printf("DEBUG: WARNING: gzipbuffer not NULL but flag not set - possible memory leak!\n");
-            FREE(gzipbuffer);
-            gzipbuffer = NULL;
-         }
-      /* Clean up d_stream if it was initialized but flag is not set */
-      if(d_stream_initialized && !(hi->flags & HTTPIF_GZIPDECODING)) {
-         debug_printf("DEBUG: Cleaning up orphaned d_stream\n");
-         inflateEnd(&d_stream);
-         d_stream_initialized = FALSE;
-      }
-      
-      /* Validate blocklength before continuing */
-      /* Only validate if we're not in a gzip state transition */
-      if(!(hi->flags & HTTPIF_GZIPDECODING) && (hi->blocklength < 0 || hi->blocklength > hi->fd->blocksize)) {
-         debug_printf("DEBUG: Invalid blocklength %ld after gzip processing, resetting to prevent corruption\n", hi->blocklength);
-         hi->blocklength = 0;
-      }
-      
-      if(hi->flags & HTTPIF_GZIPDECODING)
-      {  
-         /* This shouldn't happen - gzip should be cleaned up above */
-         debug_printf("DEBUG: WARNING: Gzip still active after loop exit, forcing cleanup\n");
-         inflateEnd(&d_stream);
-         hi->flags &= ~HTTPIF_GZIPENCODED;
-         hi->flags &= ~HTTPIF_GZIPDECODING;
-         hi->blocklength = 0;
-      }
-      else
-      {  debug_printf("DEBUG: No data to process, blocklength=%ld, calling Readblock\n", hi->blocklength);
-         
-         /* Validate blocklength before proceeding to prevent memory corruption */
-         if(hi->blocklength < 0 || hi->blocklength > hi->fd->blocksize) {
-            debug_printf("DEBUG: Invalid blocklength %ld detected in main loop, resetting to prevent OS crash\n", hi->blocklength);
-            hi->blocklength = 0;
-            
-            /* Disable gzip if it's causing corruption */
-            if(hi->flags & (HTTPIF_GZIPENCODED | HTTPIF_GZIPDECODING)) {
-               debug_printf("DEBUG: Disabling corrupted gzip processing\n");
-               hi->flags &= ~HTTPIF_GZIPENCODED;
-               hi->flags &= ~HTTPIF_GZIPDECODING;
-               
-               /* Force cleanup of any remaining gzip resources */
-               if(gzipbuffer) {
-                  FREE(gzipbuffer);
-                  gzipbuffer = NULL;
-               }
-               inflateEnd(&d_stream);
-            }
-            
-            /* Reset corrupted buffer to prevent OS crash */
-            if(hi->fd && hi->fd->block) {
-               hi->fd->block[0] = '\0'; /* Safe reset */
-            }
-            
-            break;
-         }
-         
-         /* Check if data was already processed to prevent duplication */
-         if(hi->flags & HTTPIF_DATA_PROCESSED) {
-            debug_printf("DEBUG: Data already processed, skipping Readblock to prevent duplication\n");
-            hi->flags &= ~HTTPIF_DATA_PROCESSED; /* Clear the flag for next iteration */
-            break;
-         }
-         
-         /* Add timeout protection to prevent infinite hanging */
-         /* For Content-Length transfers, don't limit by loop count - rely on Content-Length check */
-         /* For chunked/unknown transfers, use a high limit to prevent infinite loops */
-         if(!(hi->flags & HTTPIF_CHUNKED) && hi->partlength > 0)
-         {  /* Content-Length transfer - no loop limit, Content-Length check will handle completion */
-            loop_count++; /* Track but don't limit */
-         }
-         else
-         {  /* Chunked or unknown length - use high limit to prevent infinite loops */
-            if(++loop_count > 10000) {
-               debug_printf("DEBUG: Too many main loop cycles (%d), finishing\n", loop_count);
-               break;
-            }
-         }
-         
-         if(!Readblock(hi)) {
-            debug_printf("DEBUG: Readblock failed, checking for network errors\n");
-            /* Check if this is a network error vs normal EOF */
-            if(hi->blocklength > 0) {
-               debug_printf("DEBUG: Have %ld bytes of data, processing what we have\n", hi->blocklength);
-               
-               /* Track bytes received for Content-Length validation (non-gzip transfers) */
-               if(!(hi->flags & HTTPIF_GZIPDECODING) && !(hi->flags & HTTPIF_GZIPENCODED))
-               {  total_bytes_received += hi->blocklength;
-                  hi->bytes_received = total_bytes_received;  /* Update persistent counter for Range retry */
-                  debug_printf("DEBUG: Total bytes received (including final block): %ld/%ld\n", total_bytes_received, expected_total_size > 0 ? expected_total_size : hi->partlength);
-               }
-               
-               /* Process the data we already have before breaking */
-               /* Include content type if available */
-               if(hi->parttype[0] != '\0' && hi->parttype[0] != 0 && strlen(hi->parttype) > 0) {
-                  debug_printf("DEBUG: Sending final data with content type: '%s' (length=%ld)\n", hi->parttype, strlen(hi->parttype));
-                  Updatetaskattrs(
-                     AOURL_Data, hi->fd->block,
-                     AOURL_Datalength, hi->blocklength,
-                     AOURL_Contenttype, hi->parttype,
-                     TAG_END);
-               } else {
-                  debug_printf("DEBUG: WARNING: parttype empty for final data, sending without content type\n");
-               Updatetaskattrs(
-                  AOURL_Data, hi->fd->block,
-                  AOURL_Datalength, hi->blocklength,
-                  TAG_END);
-               }
-            }
-            
-            /* Validate Content-Length for non-gzip transfers */
-            /* If we have a Content-Length but didn't receive all bytes, report error */
-            if(!(hi->flags & HTTPIF_GZIPDECODING) && !(hi->flags & HTTPIF_GZIPENCODED) && 
-               !(hi->flags & HTTPIF_CHUNKED) && hi->partlength > 0)
-            {  /* For Range requests (206), compare against full file size, not range size */
-               long expected_size = (hi->flags & HTTPIF_RANGE_REQUEST && hi->full_file_size > 0) ? 
-                                    hi->full_file_size : hi->partlength;
-               if(total_bytes_received < expected_size)
-               {  debug_printf("DEBUG: ERROR: Transfer incomplete! Received %ld/%ld bytes (missing %ld bytes)\n", 
-                         total_bytes_received, expected_size, expected_size - total_bytes_received);
-                  /* Store bytes_received for potential Range request retry */
-                  hi->bytes_received = total_bytes_received;
-                  
-                  /* Check if this was due to connection reset - report appropriate error */
-                  {  long errno_value;
-                     UBYTE *hostname_str;
-                     if(hi->socketbase)
-                     {  struct Library *saved_socketbase = SocketBase;
-                        SocketBase = hi->socketbase;
-                        errno_value = Errno();
-                        SocketBase = saved_socketbase;
-                     }
-                     else
-                     {  errno_value = 0;
-                     }
-                     hostname_str = hi->hostname ? hi->hostname : (UBYTE *)"unknown";
-                     if(errno_value == ECONNRESET)
-                     {  /* If server supports Range requests, set flag for retry */
-                        if(hi->server_supports_range && total_bytes_received > 0)
-                        {  debug_printf("DEBUG: Server supports Range requests, will retry with Range header\n");
-                           /* Don't report error yet - let retry mechanism handle it */
-                        }
-                        else
-                        {  Tcperror(hi->fd, TCPERR_NOCONNECT_RESET, hostname_str);
-                        }
-                     }
-                     else
-                     {  Updatetaskattrs(AOURL_Error, TRUE, TAG_END);
-                     }
-                  }
-               }
-               else if(total_bytes_received > expected_size)
-               {  debug_printf("DEBUG: WARNING: Received more bytes than expected! Received %ld/%ld bytes (extra %ld bytes)\n", 
-                         total_bytes_received, expected_size, total_bytes_received - expected_size);
-               }
-               else
-               {  debug_printf("DEBUG: Transfer complete: Received exactly %ld/%ld bytes\n", total_bytes_received, expected_size);
-                  /* Transfer complete - connection reset is expected when server closes connection */
-                  /* Don't report error for ECONNRESET when all data was successfully received */
-               }
-            }
-            else
-            {  /* For chunked or unknown length transfers, check if connection reset occurred */
-               /* and report error if it did (since we can't verify completeness) */
-               {  long errno_value;
-                  UBYTE *hostname_str;
-                  if(hi->socketbase)
-                  {  struct Library *saved_socketbase = SocketBase;
-                     SocketBase = hi->socketbase;
-                     errno_value = Errno();
-                     SocketBase = saved_socketbase;
-                  }
-                  else
-                  {  errno_value = 0;
-                  }
-                  if(errno_value == ECONNRESET)
-                  {  hostname_str = hi->hostname ? hi->hostname : (UBYTE *)"unknown";
-                     Tcperror(hi->fd, TCPERR_NOCONNECT_RESET, hostname_str);
-                  }
-               }
-            }
-            
-            break;
-         }
-         debug_printf("DEBUG: Readblock returned, new blocklength=%ld\n", hi->blocklength);
-         
-         /* Check if Content-Length is complete for non-gzip transfers */
-         /* Continue reading until Content-Length is met or error occurs */
-         if(!(hi->flags & HTTPIF_GZIPDECODING) && !(hi->flags & HTTPIF_GZIPENCODED) && 
-            !(hi->flags & HTTPIF_CHUNKED) && hi->partlength > 0)
-         {  /* For Range requests (206), compare against full file size, not range size */
-            long expected_size = (hi->flags & HTTPIF_RANGE_REQUEST && hi->full_file_size > 0) ? 
-                                 hi->full_file_size : hi->partlength;
-            if(total_bytes_received >= expected_size)
-            {  debug_printf("DEBUG: Content-Length complete: Received %ld/%ld bytes\n", total_bytes_received, expected_size);
-               /* Content-Length met - exit loop */
-               break;
-            }
-         }
-      }
-      
-      /* Check if we should exit main loop for gzip processing */
-      if(exit_main_loop) {
-         debug_printf("DEBUG: Exit flag set, breaking out of main loop for gzip processing\n");
-         break;
-      }
-   }
-   
-   debug_printf("DEBUG: Main loop ended, flags=0x%04X, gzipbuffer=%p, d_stream_initialized=%d, exit_main_loop=%d\n", 
-          hi->flags, gzipbuffer, d_stream_initialized, exit_main_loop);
-   
-   if(bdcopy) FREE(bdcopy);
-   
-   /* Always clean up gzip resources to prevent memory corruption */
-   if(gzipbuffer) 
-   {  FREE(gzipbuffer);
-      gzipbuffer = NULL;
-   }
-   
-   /* Always clean up zlib stream to prevent memory corruption */
-   if(d_stream_initialized)
-   {  inflateEnd(&d_stream);
-      d_stream_initialized = FALSE;
-      debug_printf("DEBUG: Zlib stream cleaned up\n");
-   }
-   
-   /* CRITICAL: Force socket closure if keep-alive NOT active */
-   /* This prevents pooling dead connections that the server has closed */
-   if(hi->sock >= 0)
-   {  if (!((hi->flags & HTTPIF_KEEPALIVE) && (hi->flags & HTTPIF_KEEPALIVE_REQ)))
-      {  debug_printf("DEBUG: Readdata cleanup: Closing non-keepalive socket\n");
-         /* Close socket first, then clean up SSL */
-         if(hi->socketbase) a_close(hi->sock, hi->socketbase);
-         hi->sock = -1;
-         
-         /* Also free the library/assl references now since we won't pool */
-         /* NOTE: Assl_cleanup() will call Assl_closessl() internally, so don't call it twice */
-#ifndef DEMOVERSION
-         if(hi->assl)
-         {  /* Assl_cleanup() handles SSL shutdown and cleanup internally */
-            Assl_cleanup(hi->assl);
-            FREE(hi->assl);
-            hi->assl = NULL;
-         }
-#endif
-         if(hi->socketbase)
-         {  CloseLibrary(hi->socketbase);
-            hi->socketbase = NULL;
-         }
-      }
-      else
-      {  debug_printf("DEBUG: Readdata cleanup: Keeping keep-alive socket for pooling (sock=%ld)\n", hi->sock);
-      }
-   }
-   
-   /* Final memory corruption detection and prevention */
-   if(hi->fd && hi->fd->block) {
-      if(hi->blocklength < 0 || hi->blocklength > hi->fd->blocksize) {
-         debug_printf("DEBUG: Final safety check - invalid blocklength %ld, resetting to 0\n", hi->blocklength);
-         hi->blocklength = 0;
-         
-         /* Reset buffer to prevent memory corruption from spreading */
-         if(hi->fd->blocksize > 0 && hi->fd->blocksize <= INPUTBLOCKSIZE) {
-            hi->fd->block[0] = '\0'; /* Safe reset */
-            debug_printf("DEBUG: Buffer reset to prevent OS corruption\n");
-         }
-         
-         /* Disable gzip if it's causing corruption */
-         if(hi->flags & (HTTPIF_GZIPENCODED | HTTPIF_GZIPDECODING)) {
-            debug_printf("DEBUG: Final cleanup - disabling corrupted gzip processing\n");
-            hi->flags &= ~HTTPIF_GZIPENCODED;
-            hi->flags &= ~HTTPIF_GZIPDECODING;
-         }
-      }
-   } else {
-      debug_printf("DEBUG: Invalid fd or block pointer detected, resetting to prevent OS crash\n");
-      hi->blocklength = 0;
-   }
-   
-   /* Final validation before return to prevent memory corruption */
-   if(hi->fd && (ULONG)hi->fd < 0x1000 || (ULONG)hi->fd > 0xFFFFFFF0) {
-      debug_printf("DEBUG: Corrupted fd pointer detected! fd=0x%08lX\n", (ULONG)hi->fd);
-      hi->fd = NULL;
-      hi->blocklength = 0;
-   }
-   
-   /* Final blocklength validation to prevent OS crash */
-   if(hi->blocklength < 0) {
-      debug_printf("DEBUG: Final blocklength validation failed: %ld, forcing reset to prevent OS crash\n", hi->blocklength);
-      hi->blocklength = 0;
-   }
-   
-   /* Final validation before return to prevent memory corruption */
-   if(hi->fd && (ULONG)hi->fd < 0x1000 || (ULONG)hi->fd > 0xFFFFFFF0) {
-      debug_printf("DEBUG: Corrupted fd pointer detected! fd=0x%08lX\n", (ULONG)hi->fd);
-      hi->fd = NULL;
-      hi->blocklength = 0;
-   }
-   
-   return result;
-}
-
-/* Process the plain or HTTP or multipart response. */
-static void Httpresponse(struct Httpinfo *hi,BOOL readfirst)
-{  BOOL first=TRUE;
-   debug_printf("DEBUG: Httpresponse: processing URL, flags=0x%04X\n", hi->flags);
-   if(!readfirst || Readresponse(hi))
-   {  Nextline(hi);
-      hi->flags|=HTTPIF_HEADERS;
-      if(Readheaders(hi))
-      {  debug_printf("DEBUG: Readheaders returned TRUE, processing response\n");
-         debug_printf("DEBUG: movedto=%lu, movedtourl=%p\n", hi->movedto, hi->movedtourl);
-         if(hi->movedto && hi->movedtourl)
-         {  redirect_count++; /* Increment redirect counter for loop protection */
-            debug_printf("DEBUG: Processing redirect to: %s (redirect_count=%d)\n", hi->movedtourl, redirect_count);
-            /* For redirects, consume any remaining body data before processing redirect */
-            Nextline(hi);
-            debug_printf("DEBUG: Nextline called for redirect body consumption, blocklength=%ld\n", hi->blocklength);
-            /* If there's body data, we should read it, but for redirects we can skip */
-            Updatetaskattrs(hi->movedto,hi->movedtourl,TAG_END);
-            debug_printf("DEBUG: Updatetaskattrs for redirect completed\n");
-            return; /* Exit after redirect */
-         }
-         else
-         {              debug_printf("DEBUG: No redirect, calling Nextline before Readdata\n");
-            Nextline(hi);
-            debug_printf("DEBUG: Nextline completed, calling Readdata\n");
-            debug_printf("DEBUG: After Nextline - blocklength=%ld, flags=0x%04X\n", hi->blocklength, hi->flags);
-            if(hi->boundary)
-            {  debug_printf("DEBUG: Httpresponse: Multipart boundary detected, processing parts\n");
-               for(;;)
-               {  if(!Findline(hi)) return;
-                  if(STREQUAL(hi->fd->block,hi->boundary)) break;
-                  Nextline(hi);
-               }
-               Nextline(hi);  /* Skip boundary */
-               for(;;)
-               {  if(!Readpartheaders(hi)) break;
-                  Nextline(hi);
-                  if(!first)
-                  {  Updatetaskattrs(
-                        AOURL_Reload,TRUE,
-                        TAG_END);
-                  }
-                  if(*hi->parttype || hi->partlength)
-                  {  Updatetaskattrs(
-                        *hi->parttype?AOURL_Contenttype:TAG_IGNORE,hi->parttype,
-                        hi->partlength?AOURL_Contentlength:TAG_IGNORE,hi->partlength,
-                        TAG_END);
-                  }
-                  if(!Readdata(hi)) break;
-                  Updatetaskattrs(
-                     AOURL_Eof,TRUE,
-                     AOURL_Serverpush,hi->fd->fetch,
-                     TAG_END);
-                  if(!Findline(hi)) break;
-                  Nextline(hi);  /* Skip boundary */
-                  first=FALSE;
-               }
-            }
-            else
-            {              debug_printf("DEBUG: No boundary, calling Readdata directly\n");
-               
-               /* Add memory corruption protection before calling Readdata */
-               if(hi->fd && hi->fd->block && hi->fd->blocksize > 0 && hi->fd->blocksize <= INPUTBLOCKSIZE) {
-                  debug_printf("DEBUG: Memory validation passed, calling Readdata\n");
-                  debug_printf("DEBUG: Httpresponse: About to call Readdata() - this is the main data read\n");
-                  Readdata(hi);
-                  debug_printf("DEBUG: Httpresponse: Readdata() returned\n");
-                  debug_printf("DEBUG: Readdata() completed\n");
-                  
-                  /* Validate memory integrity after Readdata */
-                  if(hi->fd && hi->fd->block) {
-                     if(hi->blocklength < 0 || hi->blocklength > hi->fd->blocksize) {
-                        debug_printf("DEBUG: Memory corruption detected after Readdata! blocklength=%ld\n", hi->blocklength);
-                        debug_printf("DEBUG: Resetting to prevent OS crash\n");
-                        hi->blocklength = 0;
-                        hi->fd->block[0] = '\0'; /* Safe reset */
+                  /* Validate memory integrity after Readdata */
+                  if(hi->fd && hi->fd->block) {
+                     if(hi->blocklength < 0 || hi->blocklength > hi->fd->blocksize) {
+                        debug_printf("DEBUG: Memory corruption detected after Readdata! blocklength=%ld\n", hi->blocklength);
+                        debug_printf("DEBUG: Resetting to prevent OS crash\n");
+                        hi->blockstart = hi->blocklength = 0;
+                        hi->fd->block[0] = '\0'; /* Safe reset */
                      }
                   }
                } else {
                   debug_printf("DEBUG: Invalid memory state detected, skipping Readdata to prevent OS crash\n");
                   debug_printf("DEBUG: fd=%p, block=%p, blocksize=%ld\n", hi->fd, hi->fd ? hi->fd->block : NULL, hi->fd ? hi->fd->blocksize : 0);
-                  hi->blocklength = 0;
+                  hi->blockstart = hi->blocklength = 0;
                }
             }
          }
       }
+      else if(hi->status==401 || hi->status==407)
+      {  /* The request is repeated with authorization, maybe on this connection */
+         Nextline(hi);
+         Skipdata(hi);
+      }
    }
    else
    {  Readdata(hi);
@@ -4846,6 +2025,137 @@ static long Send(struct Httpinfo *hi,UBYTE *request,long reqlen)
    return result;
 }
 
+/*-----------------------------------------------------------------------*/
+
+/* Port of the connection, to match pipelines */
+static long Pipelineport(struct Httpinfo *hi)
+{  return (hi->port>0)?hi->port:(BOOLVAL(hi->flags&HTTPIF_SSL)?443:80);
+}
+
+/* Let other tasks pipeline their requests on the connection for this GET
+ * request. Only direct connections that ask for keep-alive are used. */
+static void Addpipeline(struct Httpinfo *hi)
+{  struct Pipeline *p;
+   if(!prefs.pipelining || hi->pipeline || !hi->hostname || hi->fd->proxy
+   || hi->fd->postmsg || hi->fd->multipart) return;
+   if(p=ALLOCSTRUCT(Pipeline,1,MEMF_PUBLIC|MEMF_CLEAR))
+   {  if(p->hostname=Dupstr(hi->hostname,-1))
+      {  p->port=Pipelineport(hi);
+         p->ssl=BOOLVAL(hi->flags&HTTPIF_SSL);
+         p->sock=-1;
+         NEWLIST(&p->requests);
+         ObtainSemaphore(&pipesema);
+         ADDTAIL(&pipelines,p);
+         ReleaseSemaphore(&pipesema);
+         hi->pipeline=p;
+      }
+      else FREE(p);
+   }
+}
+
+/* Send the waiting requests that were not sent yet. If one can't be sent,
+ * the responses that follow can't be trusted and the connection isn't
+ * passed on. */
+static void Sendpipeline(struct Httpinfo *hi)
+{  struct Pipeline *p=hi->pipeline;
+   struct Piperequest *pr;
+   ObtainSemaphore(&pipesema);
+   for(pr=p->requests.first;!p->broken && pr->next;pr=pr->next)
+   {  if(!pr->sent)
+      {  if(Send(hi,pr->request,pr->length)==pr->length)
+         {  pr->sent=TRUE;
+            p->nsent++;
+         }
+         else p->broken=TRUE;
+      }
+   }
+   ReleaseSemaphore(&pipesema);
+}
+
+/* Our response is done. Pass the connection and the bytes that followed our
+ * response to the first waiting request if the connection can carry it,
+ * otherwise let all waiting requests requeue. In that case the connection
+ * is not reused if requests were sent on it. */
+static void Passpipeline(struct Httpinfo *hi,BOOL ok)
+{  struct Pipeline *p=hi->pipeline;
+   struct Piperequest *pr;
+   long left,n;
+   hi->pipeline=NULL;
+   left=hi->requests_left-1;
+   if(hi->keepalive_max>=0 && hi->keepalive_max<left) left=hi->keepalive_max;
+   n=hi->blocklength-hi->blockstart;
+   if(n<0) n=0;
+   ObtainSemaphore(&pipesema);
+   pr=p->requests.first;
+   if(ok && pr->next && !p->broken && left>0 && hi->sock>=0
+   && (hi->flags&HTTPIF_KEEPALIVE) && (hi->flags&HTTPIF_KEEPALIVE_REQ)
+   && (hi->flags&HTTPIF_REUSABLE)
+   && (!n || (p->rest=ALLOCTYPE(UBYTE,n,MEMF_PUBLIC))))
+   {  REMOVE(pr);
+      p->nrequests--;
+      if(pr->sent) p->nsent--;
+      if(n) memmove(p->rest,hi->fd->block+hi->blockstart,n);
+      p->restlength=n;
+      p->socketbase=hi->socketbase;
+      p->sock=hi->sock;
+      p->assl=hi->assl;
+      p->requests_left=left;
+      hi->socketbase=NULL;
+      hi->sock=-1;
+      hi->assl=NULL;
+      hi->connection_reused=FALSE;
+      pr->state=PIPES_TURN;
+      Signal(pr->task,pr->signal);
+   }
+   else
+   {  while(pr=REMHEAD(&p->requests))
+      {  pr->state=PIPES_REQUEUE;
+         Signal(pr->task,pr->signal);
+      }
+      if(p->nsent || p->broken) hi->flags&=~HTTPIF_REUSABLE;
+      REMOVE(p);
+      FREE(p->hostname);
+      FREE(p);
+   }
+   ReleaseSemaphore(&pipesema);
+}
+
+/* Add our request to the pipeline for this host with the fewest waiting
+ * requests. Returns NULL if there is none that can take it. */
+static struct Piperequest *Joinpipeline(struct Httpinfo *hi,UBYTE *request,long length,
+   ULONG signal)
+{  struct Pipeline *p,*best=NULL;
+   struct Piperequest *pr=NULL;
+   long port=Pipelineport(hi);
+   BOOL ssl=BOOLVAL(hi->flags&HTTPIF_SSL);
+   ObtainSemaphore(&pipesema);
+   for(p=pipelines.first;p->next;p=p->next)
+   {  if(p->port==port && p->ssl==ssl && !p->broken
+      && p->nrequests<PIPELINE_DEPTH-1 && HostnameMatches(p->hostname,hi->hostname)
+      && (!best || p->nrequests<best->nrequests))
+      {  best=p;
+      }
+   }
+   if(best && (pr=ALLOCSTRUCT(Piperequest,1,MEMF_PUBLIC|MEMF_CLEAR)))
+   {  if(pr->request=ALLOCTYPE(UBYTE,length,MEMF_PUBLIC))
+      {  memmove(pr->request,request,length);
+         pr->length=length;
+         pr->pipeline=best;
+         pr->task=FindTask(NULL);
+         pr->signal=signal;
+         pr->state=PIPES_WAIT;
+         ADDTAIL(&best->requests,pr);
+         best->nrequests++;
+      }
+      else
+      {  FREE(pr);
+         pr=NULL;
+      }
+   }
+   ReleaseSemaphore(&pipesema);
+   return pr;
+}
+
 #ifndef DEMOVERSION
 /* Warning: Cannot make SSL connection. Retries TRUE if use unsecure link. */
 /* COMMENTED OUT: Modern browser behavior - fail connection instead of prompting for unsecure fallback */
@@ -4909,7 +2219,7 @@ static BOOL Openlibraries(struct Httpinfo *hi)
    struct KeepAliveConnection *pooled_conn;
    long port;
    
-   debug_printf("DEBUG: Openlibraries: ENTRY - flags=0x%04X, SSL=%s\n", 
+   debug_printf("DEBUG: Openlibraries: ENTRY - flags=0x%04lX, SSL=%s\n", 
           hi->flags, (hi->flags&HTTPIF_SSL) ? "YES" : "NO");
    
    /* Check for pooled connection BEFORE creating new libraries */
@@ -4917,9 +2227,12 @@ static BOOL Openlibraries(struct Httpinfo *hi)
    /* A proxy connection is identified if hi->connect (proxy host) is different from hi->hostname (destination host) */
    /* SSL connections CAN be pooled - the SSL object maintains state and can be reused */
    /* If a reused SSL connection fails, the retry logic will handle it */
+   /* POST requests always get a new connection: a request that is not
+    * idempotent can't be sent again if the server closed the pooled one. */
    debug_printf("DEBUG: Openlibraries: Checking for pooled connection (connect=%p, hostname=%p, SSL=%d)\n",
                hi->connect, hi->hostname, BOOLVAL(hi->flags&HTTPIF_SSL));
-   if(hi->hostname && 
+   hi->requests_left = MAX_CONNECTION_REQUESTS;
+   if(hi->hostname && !hi->fd->postmsg && !hi->fd->multipart &&
       (!hi->connect || (hi->connect && STRIEQUAL(hi->connect, hi->hostname))))
    {  /* Direct connection (not a proxy) - can reuse pooled connection */
       port = (hi->port > 0) ? hi->port : (BOOLVAL(hi->flags & HTTPIF_SSL) ? 443 : 80);
@@ -4931,7 +2244,9 @@ static BOOL Openlibraries(struct Httpinfo *hi)
          hi->socketbase = pooled_conn->socketbase;
          hi->assl = pooled_conn->assl;
          hi->sock = pooled_conn->sock;
+         hi->requests_left = pooled_conn->requests_left;
          hi->connection_reused = TRUE;
+         connections_reused++;
          debug_printf("DEBUG: Openlibraries: Reusing pooled %s connection (socketbase=%p, assl=%p, sock=%ld)\n",
                      (hi->flags&HTTPIF_SSL) ? "SSL" : "HTTP",
                      hi->socketbase, hi->assl, hi->sock);
@@ -5022,7 +2337,7 @@ static BOOL Openlibraries(struct Httpinfo *hi)
    else
    {  debug_printf("DEBUG: Openlibraries: No SSL flag, skipping SSL initialization\n");
    }
-   debug_printf("DEBUG: Openlibraries: EXIT - result=%d, flags=0x%04X, assl=%p\n", 
+   debug_printf("DEBUG: Openlibraries: EXIT - result=%d, flags=0x%04lX, assl=%p\n", 
           result, hi->flags, hi->assl);
    return result;
 }
@@ -5030,8 +2345,6 @@ static BOOL Openlibraries(struct Httpinfo *hi)
 /* Create SSL context, SSL and socket */
 static long Opensocket(struct Httpinfo *hi,struct hostent *hent)
 {  long sock;
-   struct KeepAliveConnection *pooled_conn;
-   long port;
    
    /* 1. Check for reused connection */
    if(hi->connection_reused)
@@ -5040,26 +2353,8 @@ static long Opensocket(struct Httpinfo *hi,struct hostent *hent)
       /* We DO NOT return immediately - we fall through to apply setsockopt */
    }
    else
-   {  /* Standard new connection logic */
-      /* Check keep-alive pool first (only for non-proxy connections) */
-      /* Note: This is a fallback for HTTP connections - SSL connections are handled in Openlibraries() */
-      if(!hi->connect && hi->hostname && !(hi->flags & HTTPIF_SSL))
-      {  port = (hi->port > 0) ? hi->port : 80;
-         pooled_conn = GetKeepAliveConnection(hi->hostname, port, FALSE);
-         if(pooled_conn)
-         {  /* Reuse pooled connection */
-            hi->socketbase = pooled_conn->socketbase;
-            hi->sock = pooled_conn->sock;
-            hi->assl = pooled_conn->assl;
-            hi->connection_reused = TRUE;
-            sock = hi->sock;
-            debug_printf("DEBUG: Opensocket: Reusing pooled HTTP connection (sock=%ld)\n",
-                        hi->sock);
-            /* Free the pool entry - connection is now in use */
-            FREE(pooled_conn->hostname);
-            FREE(pooled_conn);
-         }
-      }
+   {  /* Standard new connection logic. Pooled connections are only taken in
+       * Openlibraries(), before a new socket library is opened. */
       
       /* Clean up expired connections periodically */
       CleanupKeepAlivePool();
@@ -5489,7 +2784,7 @@ static BOOL Sendmultipartdata(struct Httpinfo *hi,struct Fetchdriver *fd,FILE *f
    BOOL ok=TRUE;
    for(mpp=fd->multipart->parts.first;ok && mpp->next;mpp=mpp->next)
    {  if(mpp->lock)
-      {  Updatetaskattrs(AOURL_Netstatus,NWS_UPLOAD,TAG_END);
+      {  Updatetaskattrs(AOTSK_Async,TRUE,AOURL_Netstatus,NWS_UPLOAD,TAG_END);
          Tcpmessage(fd,TCPMSG_UPLOAD);
          /* We can't just use the mpp->lock because we might need to send the
           * message again after a 301/302 status. */
@@ -5532,6 +2827,30 @@ static BOOL Formwarnrequest(void)
 }
 #endif
 
+/* Close the connection and free its socket library and SSL context */
+static void Closeconnection(struct Httpinfo *hi)
+{
+#ifndef DEMOVERSION
+   if(hi->assl) Assl_closessl(hi->assl);
+#endif
+   if(hi->sock >= 0 && hi->socketbase) a_close(hi->sock, hi->socketbase);
+   hi->sock = -1;
+#ifndef DEMOVERSION
+   if(hi->assl)
+   {  Assl_cleanup(hi->assl);
+      FREE(hi->assl);
+      hi->assl = NULL;
+   }
+#endif
+   if(hi->socketbase)
+   {  CloseLibrary(hi->socketbase);
+      hi->socketbase = NULL;
+   }
+   hi->connection_reused = FALSE;
+   /* Bytes received on it are of no use any more */
+   hi->blockstart = hi->blocklength = hi->nextscanpos = 0;
+}
+
 static void Httpretrieve(struct Httpinfo *hi,struct Fetchdriver *fd)
 {  struct hostent *hent;
    long reqlen,msglen,result;
@@ -5545,8 +2864,10 @@ static void Httpretrieve(struct Httpinfo *hi,struct Fetchdriver *fd)
    debug_printf("DEBUG: Httpretrieve: ENTRY - URL=%s, SSL=%d\n",
           fd ? (char *)fd->name : "(null)", fd ? BOOLVAL(fd->flags&FDVF_SSL) : 0);
    
+   hi->blockstart=0;
    hi->blocklength=0;
    hi->nextscanpos=0;
+   hi->sock=-1;
    if(fd->flags&FDVF_SSL) hi->flags|=HTTPIF_SSL;
    hi->fd=fd;
    /* Initialize Range request support fields */
@@ -5555,7 +2876,7 @@ static void Httpretrieve(struct Httpinfo *hi,struct Fetchdriver *fd)
    }
    hi->server_supports_range = FALSE;  /* Will be set from Accept-Ranges header */
    hi->full_file_size = 0;  /* Will be set from Content-Range header for 206 responses */
-   debug_printf("DEBUG: Httpretrieve: Initialized - flags=0x%04X, blocklength=%ld, bytes_received=%ld\n",
+   debug_printf("DEBUG: Httpretrieve: Initialized - flags=0x%04lX, blocklength=%ld, bytes_received=%ld\n",
           hi->flags, hi->blocklength, hi->bytes_received);
 #ifdef DEVELOPER
    if(STRNEQUAL(fd->name,"&&&&",4)
@@ -5585,7 +2906,7 @@ static void Httpretrieve(struct Httpinfo *hi,struct Fetchdriver *fd)
          if(hi->flags&HTTPIF_SSL)
          {  Updatetaskattrs(AOURL_Cipher,"AWEB-DEBUG",TAG_END);
          }
-         Updatetaskattrs(AOURL_Netstatus,NWS_WAIT,TAG_END);
+         Updatetaskattrs(AOTSK_Async,TRUE,AOURL_Netstatus,NWS_WAIT,TAG_END);
          Tcpmessage(fd,TCPMSG_WAITING,hi->flags&HTTPIF_SSL?"HTTPS":"HTTP");
          hi->socketbase=NULL;
          hi->sock=(long)f;
@@ -5596,6 +2917,8 @@ static void Httpretrieve(struct Httpinfo *hi,struct Fetchdriver *fd)
    else
    {
 #endif
+   /* Other fetches for this host may send their requests on our connection */
+   Addpipeline(hi);
    /* Retry loop for stale keep-alive connections (RFC 7230) */
    retry_count = 0;
    do
@@ -5627,29 +2950,12 @@ static void Httpretrieve(struct Httpinfo *hi,struct Fetchdriver *fd)
          {  struct timeval timeout;
             struct Library *saved_socketbase;
             
-            /* CRITICAL: Validate SocketBase before using socket functions */
-            if(!hi->socketbase)
-            {  debug_printf("DEBUG: Httpretrieve: socketbase is NULL, cannot set timeouts on reused connection\n");
-               result = FALSE;
-               error = TRUE;
-               break;
-            }
-            
             timeout.tv_sec = 15;  /* 15 second timeout per operation */
             timeout.tv_usec = 0;
             
             saved_socketbase = SocketBase;
             SocketBase = hi->socketbase;
             
-            /* CRITICAL: Validate SocketBase is still valid after assignment */
-            if(!SocketBase)
-            {  debug_printf("DEBUG: Httpretrieve: SocketBase became NULL after assignment\n");
-               SocketBase = saved_socketbase; /* Restore before continuing */
-               result = FALSE;
-               error = TRUE;
-               break;
-            }
-            
             /* Set receive and send timeouts */
             setsockopt(hi->sock, SOL_SOCKET, SO_RCVTIMEO, (char *)&timeout, sizeof(timeout));
             setsockopt(hi->sock, SOL_SOCKET, SO_SNDTIMEO, (char *)&timeout, sizeof(timeout));
@@ -5658,12 +2964,18 @@ static void Httpretrieve(struct Httpinfo *hi,struct Fetchdriver *fd)
             debug_printf("DEBUG: Httpretrieve: Applied timeouts to reused %s connection\n",
                         (hi->flags&HTTPIF_SSL) ? "SSL" : "HTTP");
          }
+         else
+         {  Closeconnection(hi);
+            result = FALSE;
+            error = TRUE;
+         }
       }
       else
       {  /* New connection - need DNS lookup, Opensocket(), and Connect() */
+         result = FALSE;
          debug_printf("DEBUG: Httpretrieve: Libraries opened, starting DNS lookup for '%s'\n",
                      hi->connect ? (char *)hi->connect : "(null)");
-         Updatetaskattrs(AOURL_Netstatus,NWS_LOOKUP,TAG_END);
+         Updatetaskattrs(AOTSK_Async,TRUE,AOURL_Netstatus,NWS_LOOKUP,TAG_END);
          Tcpmessage(fd,TCPMSG_LOOKUP,hi->connect);
          
          debug_printf("DEBUG: Httpretrieve: Calling Lookup() for '%s'\n", hi->connect ? (char *)hi->connect : "(null)");
@@ -5674,20 +2986,42 @@ static void Httpretrieve(struct Httpinfo *hi,struct Fetchdriver *fd)
             debug_printf("DEBUG: Httpretrieve: Calling Opensocket()\n");
             if((hi->sock=Opensocket(hi,hent))>=0)
             {  debug_printf("DEBUG: Httpretrieve: Opensocket() succeeded, sock=%ld\n", hi->sock);
-               Updatetaskattrs(AOURL_Netstatus,NWS_CONNECT,TAG_END);
+               Updatetaskattrs(AOTSK_Async,TRUE,AOURL_Netstatus,NWS_CONNECT,TAG_END);
                Tcpmessage(fd,TCPMSG_CONNECT,
                   hi->flags&HTTPIF_SSL?"HTTPS":"HTTP",hent->h_name);
                
                /* Check for exit signal before starting blocking connection */
                if(Checktaskbreak())
-                  {  debug_printf("DEBUG: Httpretrieve: Exit signal detected, aborting connection\n");
-                     /* Close socket to interrupt any blocking operations */
-                     if(hi->sock >= 0 && hi->socketbase)
-                     {  debug_printf("DEBUG: Httpretrieve: Closing socket to interrupt operations\n");
-                        a_close(hi->sock, hi->socketbase);
-                        hi->sock = -1;
-                     }
-                     /* Clean up SSL resources */
+               {  debug_printf("DEBUG: Httpretrieve: Exit signal detected, aborting connection\n");
+                  /* Close socket to interrupt any blocking operations */
+                  if(hi->sock >= 0 && hi->socketbase)
+                  {  debug_printf("DEBUG: Httpretrieve: Closing socket to interrupt operations\n");
+                     a_close(hi->sock, hi->socketbase);
+                     hi->sock = -1;
+                  }
+                  /* Clean up SSL resources */
+#ifndef DEMOVERSION
+                  if(hi->assl)
+                  {  Assl_closessl(hi->assl);
+                     Assl_cleanup(hi->assl);
+                     FREE(hi->assl);
+                     hi->assl = NULL;
+                  }
+#endif
+                  result = FALSE;
+                  error = TRUE;
+               }
+               else
+               {  result = Connect(hi,hent);
+                  
+                  /* CRITICAL: If Connect() failed and we haven't retried yet, retry with fresh connection */
+                  /* This handles transient network errors */
+                  if(!result && retry_count == 0)
+                  {  debug_printf("DEBUG: Httpretrieve: Connect() failed - retrying with fresh connection (retry_count=%d)\n", retry_count);
+                     
+                     /* Fresh connection failed - clean up here, and retry
+                      * with the next address if the host has more */
+                     Nextaddress(hent);
 #ifndef DEMOVERSION
                      if(hi->assl)
                      {  Assl_closessl(hi->assl);
@@ -5696,325 +3030,271 @@ static void Httpretrieve(struct Httpinfo *hi,struct Fetchdriver *fd)
                         hi->assl = NULL;
                      }
 #endif
-                     result = FALSE;
-                     error = TRUE;
-                  }
-                  else
-                  {  result = Connect(hi,hent);
-                     
-                     /* CRITICAL: If Connect() failed and we haven't retried yet, retry with fresh connection */
-                     /* This handles stale reused connections (SSL_connect() fails) and transient network errors */
-                     if(!result && retry_count == 0)
-                     {  debug_printf("DEBUG: Httpretrieve: Connect() failed - retrying with fresh connection (retry_count=%d)\n", retry_count);
-                        
-                        /* Ensure cleanup is complete */
-                        if(hi->connection_reused)
-                        {  /* Connection was reused but Connect() failed - cleanup already done in Connect() */
-                           hi->connection_reused = FALSE;
-                        }
-                        else
-                        {  /* Fresh connection failed - clean up here */
-#ifndef DEMOVERSION
-                           if(hi->assl)
-                           {  Assl_closessl(hi->assl);
-                              Assl_cleanup(hi->assl);
-                              FREE(hi->assl);
-                              hi->assl = NULL;
-                           }
-#endif
-                           if(hi->sock >= 0 && hi->socketbase)
-                           {  a_close(hi->sock, hi->socketbase);
-                           }
-                           hi->sock = -1;
-                        }
-                        
-                        /* Free request buffer if allocated */
-                        if(request != fd->block) FREE(request);
-                        
-                        retry_count++;
-                        try_again = TRUE;
-                        continue; /* Jump to start of do-while */
+                     if(hi->sock >= 0 && hi->socketbase)
+                     {  a_close(hi->sock, hi->socketbase);
                      }
+                     hi->sock = -1;
+                     
+                     retry_count++;
+                     try_again = TRUE;
+                     continue; /* Jump to start of do-while */
                   }
                }
                
                if(result)
                {  debug_printf("DEBUG: Httpretrieve: Connect() succeeded\n");
+                  connections_opened++;
 #ifndef DEMOVERSION
-               if(hi->flags&HTTPIF_SSL)
-               {  debug_printf("DEBUG: Httpretrieve: SSL connection established, getting cipher info\n");
-                  p=Assl_getcipher(hi->assl);
-                  q=Assl_libname(hi->assl);
-                  if(p || q)
-                  {  debug_printf("DEBUG: Httpretrieve: Cipher=%s, Library=%s\n",
-                            p ? (char *)p : "(null)", q ? (char *)q : "(null)");
-                     Updatetaskattrs(AOURL_Cipher,p,
-                        AOURL_Ssllibrary,q,
-                        TAG_END);
-                  }
-               }
-#endif
-               
-               debug_printf("DEBUG: Httpretrieve: Building HTTP request\n");
-               reqlen=Buildrequest(fd,hi,&request);
-               debug_printf("DEBUG: Httpretrieve: Request built, length=%ld, calling Send()\n", reqlen);
-               
-               /* Send Request */
-               sent = Send(hi,request,reqlen);
-               
-               /* FIX: Detect Stale Connection on Send */
-               if(sent != reqlen && hi->connection_reused && retry_count == 0)
-               {  debug_printf("DEBUG: Keep-Alive Send failed (sent=%ld, expected=%ld). Retrying with fresh connection.\n",
-                              sent, reqlen);
-                  
-                  /* 1. Clean up bad connection */
-#ifndef DEMOVERSION
-                  if(hi->assl)
-                  {  Assl_closessl(hi->assl);
-                  }
-#endif
-                  if(hi->sock >= 0 && hi->socketbase)
-                  {  a_close(hi->sock, hi->socketbase);
-                  }
-                  hi->sock = -1;
-                  
-                  /* 2. Mark as not reused so Openlibraries creates fresh */
-                  hi->connection_reused = FALSE;
-                  
-                  /* 3. Free request buffer if allocated */
-                  if(request != fd->block) FREE(request);
-                  
-                  /* 4. Trigger retry loop */
-                  retry_count++;
-                  try_again = TRUE;
-                  continue; /* Jump to start of do-while */
-               }
-               
-               result = (sent == reqlen);
-               debug_printf("DEBUG: Httpretrieve: Send() returned, result=%ld (expected %ld)\n", result, reqlen);
-#ifdef BETAKEYFILE
-               if(httpdebug)
-               {  Write(Output(),"\n",1);
-                  Write(Output(),request,reqlen);
-               }
-#endif
-               if(result)
-               {  if(fd->multipart)
-                  {  debug_printf("DEBUG: Httpretrieve: Sending multipart data\n");
-                     result=Sendmultipartdata(hi,fd,NULL);
-                     debug_printf("DEBUG: Httpretrieve: Sendmultipartdata() returned %ld\n", result);
-                  }
-                  else if(fd->postmsg)
-                  {  msglen=strlen(fd->postmsg);
-                     debug_printf("DEBUG: Httpretrieve: Sending POST message, length=%ld\n", msglen);
-                     result=(Send(hi,fd->postmsg,msglen)==msglen);
-                     debug_printf("DEBUG: Httpretrieve: POST Send() returned, result=%ld (expected %ld)\n",
-                            result, msglen);
-#ifdef BETAKEYFILE
-                     if(httpdebug)
-                     {  Write(Output(),fd->postmsg,msglen);
-                        Write(Output(),"\n\n",2);
+                  if(hi->flags&HTTPIF_SSL)
+                  {  debug_printf("DEBUG: Httpretrieve: SSL connection established, getting cipher info\n");
+                     p=Assl_getcipher(hi->assl);
+                     q=Assl_libname(hi->assl);
+                     if(p || q)
+                     {  debug_printf("DEBUG: Httpretrieve: Cipher=%s, Library=%s\n",
+                               p ? (char *)p : "(null)", q ? (char *)q : "(null)");
+                        Updatetaskattrs(AOURL_Cipher,p,
+                           AOURL_Ssllibrary,q,
+                           TAG_END);
                      }
-#endif
                   }
+#endif
                }
-               if(request!=fd->block) FREE(request);
-               
-               if(result)
-               {  debug_printf("DEBUG: Httpretrieve: Request sent successfully, calling Httpresponse()\n");
-                  Updatetaskattrs(AOURL_Netstatus,NWS_WAIT,TAG_END);
-                  Tcpmessage(fd,TCPMSG_WAITING,hi->flags&HTTPIF_SSL?"HTTPS":"HTTP");
-                  
-                  /* Check for exit signal before starting blocking HTTP response */
-                  if(Checktaskbreak())
-                  {  debug_printf("DEBUG: Httpretrieve: Exit signal detected, aborting HTTP response\n");
-                     /* Close socket first to interrupt any blocking operations */
-                     if(hi->sock >= 0 && hi->socketbase)
-                     {  debug_printf("DEBUG: Httpretrieve: Closing socket due to exit\n");
-                        a_close(hi->sock, hi->socketbase);
-                        hi->sock = -1;
+               else if(!error)
+               {  debug_printf("DEBUG: Httpretrieve: Connect() failed, status=%ld\n", hi->status);
+                  if(!(hi->flags&HTTPIF_RETRYNOSSL) && hi->status!=407)
+                  {  /* Provide more specific error reporting based on connection failure type */
+                     if(hi->status < 0)
+                     {  /* Negative status indicates specific connection error type */
+                        switch(hi->status)
+                        {  case -1:  /* ETIMEDOUT */
+                              debug_printf("DEBUG: Httpretrieve: Connection timeout - server did not respond\n");
+                              break;
+                           case -2:  /* ECONNREFUSED */
+                              debug_printf("DEBUG: Httpretrieve: Connection refused - server rejected connection\n");
+                              break;
+                           case -3:  /* ECONNRESET */
+                              debug_printf("DEBUG: Httpretrieve: Connection reset - server closed connection\n");
+                              break;
+                           case -4:  /* ENETUNREACH */
+                              debug_printf("DEBUG: Httpretrieve: Network unreachable - no route to network\n");
+                              break;
+                           case -5:  /* EHOSTUNREACH */
+                              debug_printf("DEBUG: Httpretrieve: Host unreachable - no route to host\n");
+                              break;
+                           default:
+                              debug_printf("DEBUG: Httpretrieve: Connection failed with error code %ld\n", hi->status);
+                              break;
+                        }
                      }
-                     /* SSL cleanup will happen at end of Httpretrieve() via Assl_cleanup() */
-                     error=TRUE;
-                  }
-                  else
-                  {  debug_printf("DEBUG: Httpretrieve: About to call Httpresponse() - this may take a while\n");
-                     
-                     /* FIX: Detect Stale Connection on Immediate Receive */
-                     /* Reset status before reading to detect connection failures */
-                     hi->status = 0;
-                     Httpresponse(hi,TRUE);
-                     debug_printf("DEBUG: Httpretrieve: Httpresponse() returned - status=%ld, blocklength=%ld\n",
-                                 hi->status, hi->blocklength);
-                     
-                     /* Check for incomplete transfer and retry with Range request if supported */
-                     if(hi->status == 0 && hi->bytes_received > 0 && hi->server_supports_range && 
-                        hi->partlength > 0 && hi->bytes_received < hi->partlength && retry_count == 0)
-                     {  debug_printf("DEBUG: Incomplete transfer detected (%ld/%ld bytes). Retrying with Range request.\n",
-                                   hi->bytes_received, hi->partlength);
-                        
-                        /* Cleanup current connection */
-#ifndef DEMOVERSION
-                        if(hi->assl)
-                        {  Assl_closessl(hi->assl);
-                           Assl_cleanup(hi->assl);
-                           FREE(hi->assl);
-                           hi->assl = NULL;
+                     debug_printf("DEBUG: Httpretrieve: Reporting connection error\n");
+                     /* Report specific error type based on hi->status */
+                     {  UBYTE *hostname_str;
+                        hostname_str = (hi->flags&HTTPIF_SSLTUNNEL)?hi->hostport:(UBYTE *)hent->h_name;
+                        if(hi->status == -1)  /* ETIMEDOUT */
+                        {  Tcperror(fd,TCPERR_NOCONNECT_TIMEOUT, hostname_str);
                         }
-#endif
-                        if(hi->sock >= 0 && hi->socketbase)
-                        {  a_close(hi->sock, hi->socketbase);
+                        else if(hi->status == -2)  /* ECONNREFUSED */
+                        {  Tcperror(fd,TCPERR_NOCONNECT_REFUSED, hostname_str);
                         }
-                        hi->sock = -1;
-                        hi->connection_reused = FALSE;
-                        
-                        /* Set Range request flag for retry */
-                        hi->flags |= HTTPIF_RANGE_REQUEST;
-                        
-                        /* Clear error flag to allow retry */
-                        Updatetaskattrs(AOURL_Error, FALSE, TAG_END);
-                        
-                        /* Free request buffer if allocated */
-                        if(request != fd->block) FREE(request);
-                        
-                        /* Trigger retry loop */
-                        retry_count++;
-                        try_again = TRUE;
-                        continue; /* Jump to start of do-while */
-                     }
-                     
-                     /* If status is 0 (no headers read) or specific socket error */
-                     /* AND we reused a connection AND we haven't retried yet... */
-                     if(hi->status <= 0 && hi->connection_reused && retry_count == 0)
-                     {  debug_printf("DEBUG: Keep-Alive Receive failed (Server closed). Retrying fresh.\n");
-                        
-                        /* Cleanup and Retry logic */
-#ifndef DEMOVERSION
-                        if(hi->assl)
-                        {  Assl_closessl(hi->assl);
+                        else if(hi->status == -3)  /* ECONNRESET */
+                        {  Tcperror(fd,TCPERR_NOCONNECT_RESET, hostname_str);
                         }
-#endif
-                        if(hi->sock >= 0 && hi->socketbase)
-                        {  a_close(hi->sock, hi->socketbase);
+                        else if(hi->status == -4)  /* ENETUNREACH */
+                        {  Tcperror(fd,TCPERR_NOCONNECT_UNREACH, hostname_str);
+                        }
+                        else if(hi->status == -5)  /* EHOSTUNREACH */
+                        {  Tcperror(fd,TCPERR_NOCONNECT_HOSTUNREACH, hostname_str);
+                        }
+                        else
+                        {  /* Generic connection error */
+                           Tcperror(fd,TCPERR_NOCONNECT, hostname_str);
                         }
-                        hi->sock = -1;
-                        hi->connection_reused = FALSE;
-                        
-                        /* Clear any error flags set by the failed attempt */
-                        Updatetaskattrs(AOURL_Error, FALSE, TAG_END);
-                        
-                        retry_count++;
-                        try_again = TRUE;
-                        continue; /* Jump to start of do-while */
                      }
                   }
                }
-               else
-               {  /* Send failed on a NON-reused connection */
-                  debug_printf("DEBUG: Httpretrieve: Request send failed, setting error\n");
-                  error=TRUE;
-               }
             }
             else
-            {  debug_printf("DEBUG: Httpretrieve: Connect() failed, status=%ld\n", hi->status);
-               if(!(hi->flags&HTTPIF_RETRYNOSSL) && hi->status!=407)
-               {  /* Provide more specific error reporting based on connection failure type */
-                  if(hi->status < 0)
-                  {  /* Negative status indicates specific connection error type */
-                     switch(hi->status)
-                     {  case -1:  /* ETIMEDOUT */
-                           debug_printf("DEBUG: Httpretrieve: Connection timeout - server did not respond\n");
-                           break;
-                        case -2:  /* ECONNREFUSED */
-                           debug_printf("DEBUG: Httpretrieve: Connection refused - server rejected connection\n");
-                           break;
-                        case -3:  /* ECONNRESET */
-                           debug_printf("DEBUG: Httpretrieve: Connection reset - server closed connection\n");
-                           break;
-                        case -4:  /* ENETUNREACH */
-                           debug_printf("DEBUG: Httpretrieve: Network unreachable - no route to network\n");
-                           break;
-                        case -5:  /* EHOSTUNREACH */
-                           debug_printf("DEBUG: Httpretrieve: Host unreachable - no route to host\n");
-                           break;
-                        default:
-                           debug_printf("DEBUG: Httpretrieve: Connection failed with error code %ld\n", hi->status);
-                           break;
-                     }
-                  }
-                  debug_printf("DEBUG: Httpretrieve: Reporting connection error\n");
-                  /* Report specific error type based on hi->status */
-                  {  UBYTE *hostname_str;
-                     hostname_str = (hi->flags&HTTPIF_SSLTUNNEL)?hi->hostport:(UBYTE *)hent->h_name;
-                     if(hi->status == -1)  /* ETIMEDOUT */
-                     {  Tcperror(fd,TCPERR_NOCONNECT_TIMEOUT, hostname_str);
-                     }
-                     else if(hi->status == -2)  /* ECONNREFUSED */
-                     {  Tcperror(fd,TCPERR_NOCONNECT_REFUSED, hostname_str);
-                     }
-                     else if(hi->status == -3)  /* ECONNRESET */
-                     {  Tcperror(fd,TCPERR_NOCONNECT_RESET, hostname_str);
-                     }
-                     else if(hi->status == -4)  /* ENETUNREACH */
-                     {  Tcperror(fd,TCPERR_NOCONNECT_UNREACH, hostname_str);
-                     }
-                     else if(hi->status == -5)  /* EHOSTUNREACH */
-                     {  Tcperror(fd,TCPERR_NOCONNECT_HOSTUNREACH, hostname_str);
-                     }
-                     else
-                     {  /* Generic connection error */
-                        Tcperror(fd,TCPERR_NOCONNECT, hostname_str);
-                     }
-                  }
-            }
+            {  debug_printf("DEBUG: Httpretrieve: Opensocket() failed, sock=%ld, setting error\n", hi->sock);
+               error=TRUE;
             }
+         }
+         else
+         {  debug_printf("DEBUG: Httpretrieve: Lookup() failed for '%s', reporting no host error\n",
+                   hi->connect ? (char *)hi->connect : "(null)");
+            Tcperror(fd,TCPERR_NOHOST,hi->hostname);
+         }
+      }
+      
+      /* Send the request and read the response, on the new or the pooled connection */
+      if(result)
+      {  debug_printf("DEBUG: Httpretrieve: Building HTTP request\n");
+         reqlen=Buildrequest(fd,hi,&request);
+         debug_printf("DEBUG: Httpretrieve: Request built, length=%ld, calling Send()\n", reqlen);
+         
+         /* Send Request */
+         sent = Send(hi,request,reqlen);
+         
+         /* FIX: Detect Stale Connection on Send */
+         if(sent != reqlen && hi->connection_reused)
+         {  debug_printf("DEBUG: Keep-Alive Send failed (sent=%ld, expected=%ld). Retrying with fresh connection.\n",
+                        sent, reqlen);
+            
+            /* Close the stale connection, Openlibraries will open a fresh one */
+            Closeconnection(hi);
             
-            /* Cleanup logic (Keep-Alive pool return vs Close) */
-            /* Only cleanup if we're not retrying */
-            if(!try_again)
-            {  debug_printf("DEBUG: Httpretrieve: Cleaning up connection\n");
-               /* Return connection to pool if keep-alive is supported */
-               if((hi->flags & HTTPIF_KEEPALIVE) && (hi->flags & HTTPIF_KEEPALIVE_REQ) && !error)
-               {  /* Return connection to pool for reuse */
-                  debug_printf("DEBUG: Httpretrieve: Keep-alive enabled, returning connection to pool (sock=%ld)\n", hi->sock);
-                  ReturnKeepAliveConnection(hi);
-                  /* Clear connection_reused flag after returning to pool */
-                  /* ReturnKeepAliveConnection() already cleared hi->assl and hi->socketbase */
-                  hi->connection_reused = FALSE;
+            /* Free request buffer if allocated */
+            if(request != fd->block) FREE(request);
+            request = fd->block;
+            
+            /* Trigger retry loop */
+            retry_count++;
+            try_again = TRUE;
+            continue; /* Jump to start of do-while */
+         }
+         
+         result = (sent == reqlen);
+         debug_printf("DEBUG: Httpretrieve: Send() returned, result=%ld (expected %ld)\n", result, reqlen);
+#ifdef BETAKEYFILE
+         if(httpdebug)
+         {  Write(Output(),"\n",1);
+            Write(Output(),request,reqlen);
+         }
+#endif
+         if(result)
+         {  if(fd->multipart)
+            {  debug_printf("DEBUG: Httpretrieve: Sending multipart data\n");
+               result=Sendmultipartdata(hi,fd,NULL);
+               debug_printf("DEBUG: Httpretrieve: Sendmultipartdata() returned %ld\n", result);
+            }
+            else if(fd->postmsg)
+            {  msglen=strlen(fd->postmsg);
+               debug_printf("DEBUG: Httpretrieve: Sending POST message, length=%ld\n", msglen);
+               result=(Send(hi,fd->postmsg,msglen)==msglen);
+               debug_printf("DEBUG: Httpretrieve: POST Send() returned, result=%ld (expected %ld)\n",
+                      result, msglen);
+#ifdef BETAKEYFILE
+               if(httpdebug)
+               {  Write(Output(),fd->postmsg,msglen);
+                  Write(Output(),"\n\n",2);
                }
-               else
-               {  /* Close connection normally */
-                  /* Clear connection_reused flag since we're closing the connection */
-                  hi->connection_reused = FALSE;
-                  
-                  /* Close SSL connection BEFORE closing socket */
-                  /* SSL shutdown needs the socket to still be open */
-#ifndef DEMOVERSION
-                  if(hi->assl)
-                  {  debug_printf("DEBUG: Httpretrieve: Closing SSL connection\n");
-                     Assl_closessl(hi->assl);
-                     /* DON'T set hi->assl to NULL here - Assl_cleanup() will handle it */
-                     /* Assl_closessl() only closes the connection, doesn't free the Assl structure */
-                  }
 #endif
-                  /* Now safe to close socket - SSL has been properly shut down */
-                  if(hi->sock >= 0)
-                  {  debug_printf("DEBUG: Httpretrieve: Closing socket %ld\n", hi->sock);
-                     a_close(hi->sock,hi->socketbase);
-                     hi->sock = -1;
-                     debug_printf("DEBUG: Httpretrieve: Socket closed\n");
-                  }
+            }
+         }
+         if(request!=fd->block) FREE(request);
+         request = fd->block;
+         
+         if(result)
+         {  debug_printf("DEBUG: Httpretrieve: Request sent successfully, calling Httpresponse()\n");
+            Updatetaskattrs(AOTSK_Async,TRUE,AOURL_Netstatus,NWS_WAIT,TAG_END);
+            Tcpmessage(fd,TCPMSG_WAITING,hi->flags&HTTPIF_SSL?"HTTPS":"HTTP");
+            
+            /* Check for exit signal before starting blocking HTTP response */
+            if(Checktaskbreak())
+            {  debug_printf("DEBUG: Httpretrieve: Exit signal detected, aborting HTTP response\n");
+               /* Close socket first to interrupt any blocking operations */
+               if(hi->sock >= 0 && hi->socketbase)
+               {  debug_printf("DEBUG: Httpretrieve: Closing socket due to exit\n");
+                  a_close(hi->sock, hi->socketbase);
+                  hi->sock = -1;
                }
+               /* SSL cleanup will happen at end of Httpretrieve() via Assl_cleanup() */
+               error=TRUE;
             }
             else
-            {  debug_printf("DEBUG: Httpretrieve: Opensocket() failed, sock=%ld, setting error\n", hi->sock);
-               error=TRUE;
+            {  debug_printf("DEBUG: Httpretrieve: About to call Httpresponse() - this may take a while\n");
+               
+               /* Reset status before reading to detect connection failures */
+               hi->status = 0;
+               hi->flags &= ~HTTPIF_RESPONSE;
+               Httpresponse(hi,TRUE);
+               debug_printf("DEBUG: Httpretrieve: Httpresponse() returned - status=%ld, blocklength=%ld\n",
+                           hi->status, hi->blocklength);
+               
+               /* A pooled connection that the server closed before our request
+                * arrived gives no response at all. Only then is it safe to send
+                * the request again; POST requests never use pooled connections.
+                * The retry may get another pooled connection, but every retry
+                * drops one so this ends with a fresh connection. */
+               if(!(hi->flags&HTTPIF_RESPONSE) && hi->connection_reused)
+               {  debug_printf("DEBUG: Keep-Alive Receive failed (Server closed). Retrying fresh.\n");
+                  
+                  Closeconnection(hi);
+                  
+                  /* Clear any error flags set by the failed attempt */
+                  Updatetaskattrs(AOURL_Error, FALSE, TAG_END);
+                  
+                  retry_count++;
+                  try_again = TRUE;
+                  continue; /* Jump to start of do-while */
+               }
+               
+               /* Check for incomplete transfer and retry with Range request if supported */
+               if(hi->status == 0 && hi->bytes_received > 0 && hi->server_supports_range && 
+                  hi->partlength > 0 && hi->bytes_received < hi->partlength && retry_count == 0)
+               {  debug_printf("DEBUG: Incomplete transfer detected (%ld/%ld bytes). Retrying with Range request.\n",
+                             hi->bytes_received, hi->partlength);
+                  
+                  /* Cleanup current connection. Requests pipelined on it
+                   * got no response. */
+                  Closeconnection(hi);
+                  if(hi->pipeline) Passpipeline(hi,FALSE);
+                  
+                  /* Set Range request flag for retry */
+                  hi->flags |= HTTPIF_RANGE_REQUEST;
+                  
+                  /* Clear error flag to allow retry */
+                  Updatetaskattrs(AOURL_Error, FALSE, TAG_END);
+                  
+                  /* Trigger retry loop */
+                  retry_count++;
+                  try_again = TRUE;
+                  continue; /* Jump to start of do-while */
+               }
             }
          }
          else
-         {  debug_printf("DEBUG: Httpretrieve: Lookup() failed for '%s', reporting no host error\n",
-                   hi->connect ? (char *)hi->connect : "(null)");
-            Tcperror(fd,TCPERR_NOHOST,hi->hostname);
+         {  /* Send failed on a NON-reused connection */
+            debug_printf("DEBUG: Httpretrieve: Request send failed, setting error\n");
+            error=TRUE;
+         }
+      }
+      
+      /* Pass the connection on to a pipelined request, or requeue them */
+      if(hi->pipeline) Passpipeline(hi,!error);
+      
+      /* Cleanup logic (Keep-Alive pool return vs Close) */
+      if(hi->sock >= 0)
+      {  debug_printf("DEBUG: Httpretrieve: Cleaning up connection\n");
+         /* Return connection to pool if keep-alive is supported */
+         if((hi->flags & HTTPIF_KEEPALIVE) && (hi->flags & HTTPIF_KEEPALIVE_REQ) && !error)
+         {  /* Return connection to pool for reuse. If it can't be reused,
+             * ReturnKeepAliveConnection() closes it. */
+            debug_printf("DEBUG: Httpretrieve: Keep-alive enabled, returning connection to pool (sock=%ld)\n", hi->sock);
+            ReturnKeepAliveConnection(hi);
+            /* Clear connection_reused flag after returning to pool */
+            /* ReturnKeepAliveConnection() already cleared hi->assl and hi->socketbase */
+            hi->connection_reused = FALSE;
+         }
+         else
+         {  /* Close connection normally */
+            /* Clear connection_reused flag since we're closing the connection */
+            hi->connection_reused = FALSE;
+            
+            /* Close SSL connection BEFORE closing socket */
+            /* SSL shutdown needs the socket to still be open */
+#ifndef DEMOVERSION
+            if(hi->assl)
+            {  debug_printf("DEBUG: Httpretrieve: Closing SSL connection\n");
+               Assl_closessl(hi->assl);
+               /* DON'T set hi->assl to NULL here - Assl_cleanup() will handle it */
+               /* Assl_closessl() only closes the connection, doesn't free the Assl structure */
+            }
+#endif
+            /* Now safe to close socket - SSL has been properly shut down */
+            debug_printf("DEBUG: Httpretrieve: Closing socket %ld\n", hi->sock);
+            a_close(hi->sock,hi->socketbase);
+            hi->sock = -1;
+            debug_printf("DEBUG: Httpretrieve: Socket closed\n");
          }
       }
       
@@ -6039,6 +3319,7 @@ static void Httpretrieve(struct Httpinfo *hi,struct Fetchdriver *fd)
    }
    
    } while(try_again); /* Retry loop for stale keep-alive connections */
+   if(hi->pipeline) Passpipeline(hi,FALSE);
    
    if(error)
    {  Updatetaskattrs(AOURL_Error, TRUE, TAG_END);
@@ -6097,11 +3378,101 @@ static void Httpretrieve(struct Httpinfo *hi,struct Fetchdriver *fd)
    debug_printf("DEBUG: Httpretrieve: EXIT - error=%d, status=%ld\n", error, hi->status);
 }
 
+/* Retrieve with our request pipelined on the connection of another task.
+ * Returns FALSE if the fetch must be queued again because the request got
+ * no response. */
+static BOOL Pipelineretrieve(struct Httpinfo *hi,struct Fetchdriver *fd)
+{  struct Pipeline *p;
+   struct Piperequest *pr;
+   UBYTE *request=fd->block;
+   long reqlen,sigbit;
+   short state;
+   BOOL result=FALSE;
+   hi->blockstart=0;
+   hi->blocklength=0;
+   hi->nextscanpos=0;
+   hi->sock=-1;
+   if(fd->flags&FDVF_SSL) hi->flags|=HTTPIF_SSL;
+   hi->fd=fd;
+   hi->bytes_received=0;
+   hi->server_supports_range=FALSE;
+   hi->full_file_size=0;
+   if((sigbit=AllocSignal(-1))<0) return FALSE;
+   reqlen=Buildrequest(fd,hi,&request);
+   pr=Joinpipeline(hi,request,reqlen,1L<<sigbit);
+   if(request!=fd->block) FREE(request);
+   if(pr)
+   {  p=pr->pipeline;
+      Updatetaskattrs(AOTSK_Async,TRUE,AOURL_Netstatus,NWS_WAIT,TAG_END);
+      Tcpmessage(fd,TCPMSG_WAITING,hi->flags&HTTPIF_SSL?"HTTPS":"HTTP");
+      for(;;)
+      {  ObtainSemaphore(&pipesema);
+         state=pr->state;
+         if(state==PIPES_WAIT && Checktaskbreak())
+         {  /* Cancelled. The response to a request that was sent would be
+             * left on the connection, so it can't be passed on. */
+            REMOVE(pr);
+            p->nrequests--;
+            if(pr->sent) p->broken=TRUE;
+            state=PIPES_REQUEUE;
+         }
+         else if(state==PIPES_TURN)
+         {  hi->socketbase=p->socketbase;
+            hi->sock=p->sock;
+            hi->assl=p->assl;
+            hi->requests_left=p->requests_left;
+            if(p->rest)
+            {  memmove(fd->block,p->rest,p->restlength);
+               hi->blocklength=p->restlength;
+               FREE(p->rest);
+               p->rest=NULL;
+            }
+            p->socketbase=NULL;
+            p->sock=-1;
+            p->assl=NULL;
+            hi->pipeline=p;
+         }
+         ReleaseSemaphore(&pipesema);
+         if(state!=PIPES_WAIT) break;
+         Waittask(1L<<sigbit);
+      }
+      if(state==PIPES_TURN)
+      {  debug_printf("DEBUG: Pipelineretrieve: Got connection for %s, %ld bytes of response\n",
+            hi->hostname,hi->blocklength);
+         connections_reused++;
+         hi->status=0;
+         hi->flags&=~HTTPIF_RESPONSE;
+         if(hi->blocklength) hi->flags|=HTTPIF_RESPONSE;
+         if(pr->sent || Send(hi,pr->request,pr->length)==pr->length)
+         {  Httpresponse(hi,TRUE);
+         }
+         if(hi->flags&HTTPIF_RESPONSE)
+         {  result=TRUE;
+         }
+         else
+         {  /* Clear any error flags set by the failed attempt */
+            Updatetaskattrs(AOURL_Error,FALSE,TAG_END);
+         }
+         if(hi->pipeline) Passpipeline(hi,result);
+         if(result && hi->sock>=0
+         && (hi->flags&HTTPIF_KEEPALIVE) && (hi->flags&HTTPIF_KEEPALIVE_REQ))
+         {  ReturnKeepAliveConnection(hi);
+         }
+         Closeconnection(hi);
+      }
+      FREE(pr->request);
+      FREE(pr);
+   }
+   FreeSignal(sigbit);
+   return result;
+}
+
 /*-----------------------------------------------------------------------*/
 
 void Httptask(struct Fetchdriver *fd)
 {  struct Httpinfo hi={0};
    int loop_count=0;
+   BOOL pipelined=BOOLVAL(fd->flags&FDVF_PIPELINE);
    
    debug_printf("DEBUG: Httptask: ENTRY - URL=%s, proxy=%s, SSL=%d\n",
           fd ? (char *)fd->name : "(null)", fd && fd->proxy ? (char *)fd->proxy : "(none)",
@@ -6152,9 +3523,19 @@ void Httptask(struct Fetchdriver *fd)
          /* CRITICAL: Reset socket and socketbase to prevent reuse */
          hi.sock = -1;
          hi.socketbase = NULL;
-         debug_printf("DEBUG: Httptask: Calling Httpretrieve() - status reset to 0\n");
-         Httpretrieve(&hi,fd);
-         debug_printf("DEBUG: Httptask: Httpretrieve() returned - status=%ld, flags=0x%04X\n",
+         if(pipelined)
+         {  /* Only the first request is pipelined, not a repeat with authorization */
+            pipelined=FALSE;
+            if(!Pipelineretrieve(&hi,fd))
+            {  Updatetaskattrs(AOURL_Requeue,TRUE,TAG_END);
+               break;
+            }
+         }
+         else
+         {  debug_printf("DEBUG: Httptask: Calling Httpretrieve() - status reset to 0\n");
+            Httpretrieve(&hi,fd);
+         }
+         debug_printf("DEBUG: Httptask: Httpretrieve() returned - status=%ld, flags=0x%04lX\n",
                 hi.status, hi.flags);
          
          if(hi.flags&HTTPIF_RETRYNOSSL)
@@ -6255,6 +3636,10 @@ void CloseIdleKeepAliveConnections(void)
 {
 }
 
+void Httpconnstats(ULONG *opened,ULONG *reused)
+{  *opened=*reused=0;
+}
+
 #endif /* LOCALONLY */
 
 /*-----------------------------------------------------------------------*/
@@ -6296,6 +3681,8 @@ BOOL Inithttp(void)
    InitSemaphore(&keepalive_sema);
    keepalive_sema_initialized = TRUE;
    NEWLIST(&keepalive_pool);
+   InitSemaphore(&pipesema);
+   NEWLIST(&pipelines);
 #endif
    return TRUE;
 }
@@ -0,0 +1,229 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb APL distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* httpdec.c - AWeb HTTP transfer and content decoding */
+
+/* This file only depends on zlib, so it can be built and tested on any host. */
+
+#include <exec/types.h>
+#include <string.h>
+#include "zlib.h"
+#include "httpdec.h"
+
+/* Chunked framing states */
+#define CHS_SIZESTART      0     /* Before the chunk size */
+#define CHS_SIZE           1     /* In the chunk size */
+#define CHS_EXT            2     /* Chunk extension up to end of line */
+#define CHS_DATA           3     /* Chunk data */
+#define CHS_DATAEND        4     /* CRLF after chunk data */
+#define CHS_TRAILER        5     /* Start of trailer line */
+#define CHS_TRAILERLINE    6     /* In trailer line */
+
+#define HDF_DONE           (HDF_END|HDF_ERROR|HDF_STOP)
+
+/*-----------------------------------------------------------------------*/
+
+/* Pass decoded data to the sink */
+static void Sink(struct Httpdecoder *hd,UBYTE *data,long length)
+{  hd->decoded+=length;
+   if(!hd->sink(hd->userdata,data,length)) hd->flags|=HDF_STOP;
+}
+
+static BOOL Startinflate(struct Httpdecoder *hd,int windowbits)
+{  memset(&hd->zs,0,sizeof(z_stream));
+   hd->zs.zalloc=Z_NULL;
+   hd->zs.zfree=Z_NULL;
+   hd->zs.opaque=Z_NULL;
+   if(inflateInit2(&hd->zs,windowbits)!=Z_OK) return FALSE;
+   hd->flags|=HDF_ZINIT;
+   return TRUE;
+}
+
+/* Inflate this input in place, passing each full output buffer to the sink. */
+static void Inflatedata(struct Httpdecoder *hd,UBYTE *data,long length)
+{  long n;
+   int err;
+   hd->zs.next_in=data;
+   hd->zs.avail_in=length;
+   while(!(hd->flags&(HDF_ZEND|HDF_DONE)))
+   {  hd->zs.next_out=hd->buffer;
+      hd->zs.avail_out=hd->bufsize;
+      err=inflate(&hd->zs,Z_NO_FLUSH);
+      n=hd->bufsize-hd->zs.avail_out;
+      if(n) Sink(hd,hd->buffer,n);
+      if(err==Z_STREAM_END) hd->flags|=HDF_ZEND;
+      else if(err==Z_BUF_ERROR) break;       /* Needs more input */
+      else if(err!=Z_OK) hd->flags|=HDF_ERROR;
+      else if(!hd->zs.avail_in && hd->zs.avail_out) break;
+   }
+}
+
+/* Content decoding stage */
+static void Content(struct Httpdecoder *hd,UBYTE *data,long length)
+{  if(length<=0 || (hd->flags&HDF_DONE)) return;
+   if(hd->coding==HDCO_IDENTITY)
+   {  Sink(hd,data,length);
+   }
+   else if(hd->flags&HDF_ZEND)
+   {  /* Ignore anything after the end of the compressed stream */
+   }
+   else if(hd->flags&HDF_ZINIT)
+   {  Inflatedata(hd,data,length);
+   }
+   else
+   {  /* Deflate: some servers send a zlib stream, others raw deflate.
+       * Look at the first two bytes to find out. */
+      while(length && hd->headlength<2)
+      {  hd->head[hd->headlength++]=*data++;
+         length--;
+      }
+      if(hd->headlength<2) return;
+      if(!Startinflate(hd,((hd->head[0]&0x0f)==Z_DEFLATED
+         && ((hd->head[0]<<8)|hd->head[1])%31==0)?MAX_WBITS:-MAX_WBITS))
+      {  hd->flags|=HDF_ERROR;
+         return;
+      }
+      Inflatedata(hd,hd->head,2);
+      if(length) Content(hd,data,length);
+   }
+}
+
+/* End of the chunk size line */
+static void Endsizeline(struct Httpdecoder *hd)
+{  hd->chunkstate=hd->chunkleft?CHS_DATA:CHS_TRAILER;
+}
+
+/* Chunked framing stage. Returns the number of bytes used. */
+static long Chunked(struct Httpdecoder *hd,UBYTE *data,long length)
+{  UBYTE *p=data,*end=data+length;
+   long n;
+   int c,d;
+   while(p<end && !(hd->flags&HDF_DONE))
+   {  switch(hd->chunkstate)
+      {  case CHS_SIZESTART:
+         case CHS_SIZE:
+            c=*p++;
+            if(c>='0' && c<='9') d=c-'0';
+            else if(c>='a' && c<='f') d=c-'a'+10;
+            else if(c>='A' && c<='F') d=c-'A'+10;
+            else d=-1;
+            if(d>=0)
+            {  if(hd->chunkleft>0x07ffffffL)
+               {  hd->flags|=HDF_ERROR;
+                  break;
+               }
+               hd->chunkleft=hd->chunkleft*16+d;
+               hd->chunkstate=CHS_SIZE;
+            }
+            else if(hd->chunkstate==CHS_SIZESTART)
+            {  /* Tolerate blank lines and white space before the size */
+               if(c!='\r' && c!='\n' && c!=' ' && c!='\t') hd->flags|=HDF_ERROR;
+            }
+            else if(c=='\n') Endsizeline(hd);
+            else if(c==';' || c=='\r' || c==' ' || c=='\t') hd->chunkstate=CHS_EXT;
+            else hd->flags|=HDF_ERROR;
+            break;
+         case CHS_EXT:
+            while(p<end && *p!='\n') p++;
+            if(p<end)
+            {  p++;
+               Endsizeline(hd);
+            }
+            break;
+         case CHS_DATA:
+            n=end-p;
+            if(n>hd->chunkleft) n=hd->chunkleft;
+            Content(hd,p,n);
+            p+=n;
+            hd->chunkleft-=n;
+            if(!hd->chunkleft) hd->chunkstate=CHS_DATAEND;
+            break;
+         case CHS_DATAEND:
+            c=*p++;
+            if(c=='\n') hd->chunkstate=CHS_SIZESTART;
+            else if(c!='\r') hd->flags|=HDF_ERROR;
+            break;
+         case CHS_TRAILER:
+            c=*p++;
+            if(c=='\n') hd->flags|=HDF_END;
+            else if(c!='\r') hd->chunkstate=CHS_TRAILERLINE;
+            break;
+         case CHS_TRAILERLINE:
+            while(p<end && *p!='\n') p++;
+            if(p<end)
+            {  p++;
+               hd->chunkstate=CHS_TRAILER;
+            }
+            break;
+      }
+   }
+   return p-data;
+}
+
+/*-----------------------------------------------------------------------*/
+
+BOOL Inithttpdecoder(struct Httpdecoder *hd)
+{  hd->flags=0;
+   hd->chunkstate=CHS_SIZESTART;
+   hd->chunkleft=0;
+   hd->decoded=0;
+   hd->headlength=0;
+   if(hd->framing==HDFR_LENGTH)
+   {  hd->chunkleft=hd->length;
+      if(hd->chunkleft<=0) hd->flags|=HDF_END;
+   }
+   if(hd->coding==HDCO_GZIP)
+   {  /* Let zlib detect the gzip or zlib header */
+      if(!Startinflate(hd,MAX_WBITS+32)) return FALSE;
+   }
+   return TRUE;
+}
+
+long Httpdecode(struct Httpdecoder *hd,UBYTE *data,long length)
+{  long n;
+   if(hd->flags&HDF_DONE) return 0;
+   switch(hd->framing)
+   {  case HDFR_CHUNKED:
+         n=Chunked(hd,data,length);
+         break;
+      case HDFR_LENGTH:
+         n=length;
+         if(n>hd->chunkleft) n=hd->chunkleft;
+         hd->chunkleft-=n;
+         Content(hd,data,n);
+         if(!hd->chunkleft) hd->flags|=HDF_END;
+         break;
+      default:
+         n=length;
+         Content(hd,data,n);
+         break;
+   }
+   return n;
+}
+
+BOOL Finishhttpdecoder(struct Httpdecoder *hd)
+{  if(hd->framing==HDFR_CLOSE) hd->flags|=HDF_END;
+   return (hd->flags&(HDF_END|HDF_ERROR))==HDF_END;
+}
+
+void Freehttpdecoder(struct Httpdecoder *hd)
+{  if(hd->flags&HDF_ZINIT)
+   {  inflateEnd(&hd->zs);
+      hd->flags&=~HDF_ZINIT;
+   }
+}
@@ -0,0 +1,88 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb APL distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* httpdec.h - AWeb HTTP transfer and content decoding */
+
+#ifndef AWEB_HTTPDEC_H
+#define AWEB_HTTPDEC_H
+
+#include <exec/types.h>
+
+/* zlib.h must be included before this file */
+
+/* The decoder is a pipeline of three stages: framing (Content-Length,
+ * chunked or connection close), content decoding (identity, gzip or deflate)
+ * and the sink. Each stage keeps its own state, so the input may be split
+ * at any byte. Undecoded data is passed on by reference; only inflated data
+ * goes through the output buffer. */
+
+struct Httpdecoder
+{  /* Input fields, set by the caller before Inithttpdecoder() */
+
+   UWORD framing;             /* How the body ends, see below */
+   UWORD coding;              /* Content encoding, see below */
+   long length;               /* Body length for HDFR_LENGTH */
+   UBYTE *buffer;             /* Output buffer for inflated data. The sink
+                               * may replace it by another of (bufsize) */
+   long bufsize;              /* Size of output buffer */
+   BOOL (*sink)(void *userdata,UBYTE *data,long length);
+                              /* Receives decoded data. Return FALSE to stop */
+   void *userdata;            /* Passed to sink */
+
+   /* Decoder state */
+
+   UWORD flags;               /* See below */
+   UWORD chunkstate;          /* Chunked framing state */
+   long chunkleft;            /* Data bytes left in current chunk or length left */
+   long decoded;              /* Decoded bytes passed to the sink */
+   UBYTE head[2];             /* First bytes of a deflate stream */
+   UWORD headlength;
+   z_stream zs;               /* Inflate state */
+};
+
+/* framing */
+#define HDFR_CLOSE         0     /* Body ends when the connection is closed */
+#define HDFR_LENGTH        1     /* Body is (length) bytes */
+#define HDFR_CHUNKED       2     /* Chunked transfer encoding */
+
+/* coding */
+#define HDCO_IDENTITY      0
+#define HDCO_GZIP          1     /* gzip, or zlib if the server mislabels it */
+#define HDCO_DEFLATE       2     /* zlib, or raw deflate as some servers send */
+
+/* flags */
+#define HDF_END            0x0001   /* Body is complete */
+#define HDF_ERROR          0x0002   /* Malformed framing or compressed data */
+#define HDF_STOP           0x0004   /* Sink asked to stop */
+#define HDF_ZEND           0x0008   /* Compressed stream ended */
+#define HDF_ZINIT          0x0010   /* Inflate state is initialized */
+
+/* Prepare the decoder. Returns FALSE if inflate could not be initialized. */
+extern BOOL Inithttpdecoder(struct Httpdecoder *hd);
+
+/* Feed a slice of the body. Returns the number of bytes used, which is less
+ * than (length) only if the body ended within the slice. Check flags afterwards. */
+extern long Httpdecode(struct Httpdecoder *hd,UBYTE *data,long length);
+
+/* Connection is closed. Returns TRUE if the body was complete. */
+extern BOOL Finishhttpdecoder(struct Httpdecoder *hd);
+
+/* Release the inflate state. */
+extern void Freehttpdecoder(struct Httpdecoder *hd);
+
+#endif
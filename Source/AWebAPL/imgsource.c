@@ -995,9 +995,9 @@ static void *Newfile(struct Imgsource *ims,struct Amsrcupdate *ams)
    url=(void *)Agetattr(ims->source,AOSRC_Url);
    cache=(void *)Agetattr(url,AOURL_Cache);
    urlname=(UBYTE *)Agetattr(url,AOURL_Url);
-   if(cache && !usetemp)
-   {  ims->filename=(UBYTE *)Agetattr(cache,AOCAC_Name);
-      ims->flags|=IMSF_CACHEFILE;
+   /* Objects in a cache pack file have no file name, they get a temp file */
+   if(cache && !usetemp && (ims->filename=(UBYTE *)Agetattr(cache,AOCAC_Name)))
+   {  ims->flags|=IMSF_CACHEFILE;
       if(ams) Asetattrs(ams->fetch,AOFCH_Cancellocal,TRUE,TAG_END);
    }
    else if(urlname && (ims->filename=Urllocalfilename(urlname)) && !usetemp)
@@ -25,11 +25,14 @@
 #include <ctype.h>
 
 #define CHUNKSIZE   16  /* Array storage is allocated in multiples of this */
+#define MAXDENSEGAP 1024   /* Elements further beyond the storage are kept sparse */
 
 struct Array            /* Used as internal object value */
 {  long length;            /* current array length of data*/
    struct Variable **array; /* pointer to current array */
    long array_length;       /* current length of storage */
+   struct Variable *lengthvar; /* the "length" property */
+   long nsparse;            /* number of elements kept as named properties */
 };
 
 struct Tabelt           /* Array of this is used to reverse or sort the array */
@@ -96,6 +99,203 @@ BOOL Touint32(STRPTR str, ULONG *num)
     return success;
 }
 
+/*-----------------------------------------------------------------------*/
+
+/* Elements of an Array object are kept in a vector of Variables indexed
+ * by element number. The Variables themselves never move, so references
+ * to them stay valid while the vector grows. Elements that would leave
+ * too big a hole in the vector are kept as ordinary named properties. */
+
+/* Format an element number as property name */
+static UBYTE *Indexname(UBYTE *buf,ULONG n)
+{  UBYTE *p=buf+15;
+   *p='\0';
+   do
+   {  *--p='0'+(UBYTE)(n%10);
+      n/=10;
+   } while(n);
+   return p;
+}
+
+/* Should element (n) be kept in the vector? */
+static BOOL Isdense(struct Array *a,ULONG n)
+{  return (BOOL)(n<(ULONG)a->array_length || n<(ULONG)(2*a->array_length+MAXDENSEGAP));
+}
+
+/* Make sure the vector has room for element (n) */
+static BOOL Growarray(struct Jobject *jo,struct Array *a,ULONG n)
+{  struct Variable **newarray;
+   long newlength;
+   if(n<(ULONG)a->array_length) return TRUE;
+   newlength=a->array_length?a->array_length:CHUNKSIZE;
+   while((ULONG)newlength<=n) newlength*=2;
+   if(!(newarray=ALLOCTYPE(struct Variable *,newlength,MEMF_CLEAR,jo->jc->pool)))
+   {  return FALSE;
+   }
+   if(a->array)
+   {  CopyMem(a->array,newarray,a->array_length*sizeof(struct Variable *));
+      FREE(a->array);
+   }
+   a->array=newarray;
+   a->array_length=newlength;
+   return TRUE;
+}
+
+/* Find existing element (n), or NULL */
+static struct Variable *Getelement(struct Jobject *jo,struct Array *a,ULONG n)
+{  UBYTE nname[16];
+   if(n<(ULONG)a->array_length && a->array[n]) return a->array[n];
+   if(a->nsparse) return _Generic_Getownproperty(jo,Indexname(nname,n));
+   return NULL;
+}
+
+/* Delete element (n) */
+static void Deleteelement(struct Jobject *jo,struct Array *a,ULONG n)
+{  UBYTE nname[16];
+   if(n<(ULONG)a->array_length && a->array[n])
+   {  Disposevar(a->array[n]);
+      a->array[n]=NULL;
+      propstamp++;
+   }
+   else if(a->nsparse && _Generic_Deleteownproperty(jo,Indexname(nname,n)))
+   {  a->nsparse--;
+   }
+}
+
+/* Create element (n), replacing any existing one */
+static struct Variable *Newelement(struct Jobject *jo,struct Array *a,ULONG n)
+{  struct Variable *var=NULL;
+   UBYTE nname[16],*name=Indexname(nname,n);
+   if(Isdense(a,n) && Growarray(jo,a,n))
+   {  if(a->array[n])
+      {  Disposevar(a->array[n]);
+      }
+      else if(a->nsparse && _Generic_Deleteownproperty(jo,name))
+      {  a->nsparse--;
+      }
+      if(var=a->array[n]=Newvar(name,jo->jc))
+      {  var->owner=jo;
+      }
+      propstamp++;
+   }
+   else
+   {  _Generic_Deleteownproperty(jo,name);
+      if(var=_Generic_Addproperty(jo,name)) a->nsparse++;
+   }
+   return var;
+}
+
+/* Set the length of the array */
+static void Setarraylength(struct Array *a,long length)
+{  a->length=length;
+   if(a->lengthvar)
+   {  Asgnumber(&a->lengthvar->val,VNA_VALID,(double)length);
+   }
+}
+
+/* Dispose all elements from (n) on */
+static void Truncatearray(struct Jobject *jo,struct Array *a,ULONG n)
+{  struct Variable *var,*next;
+   ULONG index;
+   long i;
+   propstamp++;
+   for(i=n;i<a->array_length;i++)
+   {  if(a->array[i])
+      {  Disposevar(a->array[i]);
+         a->array[i]=NULL;
+      }
+   }
+   if(a->nsparse)
+   {  for(var=jo->properties.first;var->next;var=next)
+      {  next=var->next;
+         if(Touint32(var->name,&index) && index>=n)
+         {  _Generic_Deleteownproperty(jo,var->name);
+            a->nsparse--;
+         }
+      }
+   }
+}
+
+/* Element access that works for arrays and for other objects used
+ * as (this) by the generic Array.prototype methods */
+
+static struct Variable *Getindexed(struct Jobject *jo,ULONG n)
+{  UBYTE nname[16];
+   if(Isarray(jo)) return Getelement(jo,jo->internal,n);
+   return Getproperty(jo,Indexname(nname,n));
+}
+
+static struct Variable *Setindexed(struct Jobject *jo,ULONG n)
+{  struct Variable *var;
+   UBYTE nname[16],*name;
+   if(Isarray(jo))
+   {  if(!(var=Getelement(jo,jo->internal,n)))
+      {  var=Newelement(jo,jo->internal,n);
+      }
+   }
+   else
+   {  name=Indexname(nname,n);
+      if(!(var=Getownproperty(jo,name)))
+      {  var=Addproperty(jo,name);
+      }
+   }
+   return var;
+}
+
+static void Deleteindexed(struct Jobject *jo,ULONG n)
+{  UBYTE nname[16];
+   if(Isarray(jo)) Deleteelement(jo,jo->internal,n);
+   else Deleteownproperty(jo,Indexname(nname,n));
+}
+
+/* Move element (from) to (to). Array elements are moved without copying. */
+static void Moveindexed(struct Jobject *jo,ULONG from,ULONG to)
+{  struct Variable *src,*dst;
+   if(src=Getindexed(jo,from))
+   {  if((dst=Setindexed(jo,to)) && dst!=src)
+      {  Clearvalue(&dst->val);
+         if(Isarray(jo))
+         {  dst->val=src->val;
+            src->val.type=VTP_UNDEFINED;
+         }
+         else
+         {  Asgvalue(&dst->val,&src->val);
+         }
+      }
+   }
+   else
+   {  Deleteindexed(jo,to);
+   }
+}
+
+static long Getlength(struct Jcontext *jc,struct Jobject *jo)
+{  struct Variable *length;
+   long len=0;
+   if(Isarray(jo)) return ((struct Array *)jo->internal)->length;
+   if(length=Getproperty(jo,"length"))
+   {  Tonumber(&length->val,jc);
+      if(length->val.attr==VNA_VALID)
+      {  len=(long)length->val.value.nvalue;
+      }
+   }
+   return len;
+}
+
+static void Setlength(struct Jobject *jo,long len)
+{  struct Variable *length;
+   if(Isarray(jo))
+   {  Setarraylength(jo->internal,len);
+   }
+   else
+   {  if(!(length=Getownproperty(jo,"length")))
+      {  length=Addproperty(jo,"length");
+      }
+      if(length)
+      {  Asgnumber(&length->val,VNA_VALID,(double)len);
+      }
+   }
+}
+
 /* Find the numeric value of Nth argument */
 static double Numargument(struct Jcontext *jc,long n,BOOL *validp)
 {  struct Variable *var;
@@ -139,11 +339,9 @@ struct Tabelt *Maketabelts(struct Asortinfo *asi,struct Jobject *jo,long n)
 {  struct Variable *elt;
    struct Tabelt *tabelts;
    long i;
-   UBYTE nname[16];
    if(tabelts=ALLOCSTRUCT(Tabelt,n,0,asi->jc->pool))
    {  for(i=0;i<n;i++)
-      {  sprintf(nname,"%d",(int)i);
-         if(elt=Getproperty(jo,nname))
+      {  if(elt=Getindexed(jo,i))
          {  Asgvalue(&tabelts[i].val,&elt->val);
          }
          tabelts[i].asi=asi;
@@ -155,17 +353,16 @@ struct Tabelt *Maketabelts(struct Asortinfo *asi,struct Jobject *jo,long n)
 /* Assign the Tabelt elements back to the Array object */
 void Returntabelts(struct Jobject *jo,struct Tabelt *tabelts,long n)
 {  struct Variable *elt;
-   UBYTE nname[16];
    long i;
    for(i=0;i<n;i++)
-   {  sprintf(nname,"%d",(int)i);
-      if(!(elt=Getproperty(jo,nname)))
-      {  elt=Addproperty(jo,nname);
+   {  if(elt=Setindexed(jo,i))
+      {  /* Hand the value over instead of copying it */
+         Clearvalue(&elt->val);
+         elt->val=tabelts[i].val;
       }
-      if(elt)
-      {  Asgvalue(&elt->val,&tabelts[i].val);
+      else
+      {  Clearvalue(&tabelts[i].val);
       }
-      Clearvalue(&tabelts[i].val);
       if(tabelts[i].svalue) FREE(tabelts[i].svalue);
    }
    FREE(tabelts);
@@ -213,32 +410,28 @@ static int Asortcompare(struct Tabelt *ta,struct Tabelt *tb)
 static void Joinarray(struct Jcontext *jc,UBYTE *sep)
 {  struct Jobject *jo=jc->jthis;
    struct Variable *elt;
-   struct Variable *length;
    struct Value val={0};
    struct Jbuffer *buf;
    unsigned long n,len,sepl;
-   UBYTE nname[16];
    if(!sep) sep=",";
    sepl=strlen(sep);
    val.type=0;
-   len = 0;
-   if((length = Getproperty(jo,"length")))
-   {  Tonumber(&length->val,jc);
-      len = (unsigned long)length->val.value.nvalue;
-   }
+   len=Getlength(jc,jo);
    if(buf=Newjbuffer(jc->pool))
    {  for(n=0;n<len;n++)
-      {  sprintf(nname,"%d",(int)n);
-         if((elt=Getproperty(jo,nname)) && elt->val.type != VTP_UNDEFINED)
-         {  Asgvalue(&val,&elt->val);
-            Tostring(&val,jc);
-            if(n>0) Addtojbuffer(buf,sep,sepl);
-            Addtojbuffer(buf,val.value.svalue,strlen(val.value.svalue));
-         }
-         else
-         {  if(n>0) Addtojbuffer(buf,sep,sepl);
+      {  if(n>0) Addtojbuffer(buf,sep,sepl);
+         if((elt=Getindexed(jo,n)) && elt->val.type != VTP_UNDEFINED)
+         {  if(elt->val.type==VTP_STRING)
+            {  Addtojbuffer(buf,elt->val.value.svalue,strlen(elt->val.value.svalue));
+            }
+            else
+            {  Asgvalue(&val,&elt->val);
+               Tostring(&val,jc);
+               Addtojbuffer(buf,val.value.svalue,strlen(val.value.svalue));
+            }
          }
       }
+      Clearvalue(&val);
       Asgstring(RETVAL(jc),buf->buffer?buf->buffer:(UBYTE *)"",jc->pool);
       Freejbuffer(buf);
    }
@@ -299,9 +492,33 @@ static void Arrayreverse(struct Jcontext *jc)
    struct Tabelt *tabelts;
    struct Tabelt te;
    struct Asortinfo asi={0};
+   struct Variable *lo,*hi;
+   struct Value v;
    long length,i;
-   if(jo && jo->internal)
-   {  length=((struct Array *)jo->internal)->length;
+   if(jo && Isarray(jo))
+   {  /* Swap the values in place */
+      length=((struct Array *)jo->internal)->length;
+      for(i=0;i<length/2;i++)
+      {  lo=Getindexed(jo,i);
+         hi=Getindexed(jo,length-i-1);
+         if(lo && hi)
+         {  v=lo->val;
+            lo->val=hi->val;
+            hi->val=v;
+         }
+         else if(lo)
+         {  Moveindexed(jo,i,length-i-1);
+            Deleteindexed(jo,i);
+         }
+         else if(hi)
+         {  Moveindexed(jo,length-i-1,i);
+            Deleteindexed(jo,length-i-1);
+         }
+      }
+      Asgobject(RETVAL(jc),jo);
+   }
+   else if(jo && jo->internal)
+   {  length=Getlength(jc,jo);
       asi.jc=jc;
       if(tabelts=Maketabelts(&asi,jo,length))
       {  /* reverse the table */
@@ -346,7 +563,7 @@ static void Arraysort(struct Jcontext *jc)
    struct Variable *cvar;
    long length;
    if(jo && jo->internal)
-   {  length=((struct Array *)jo->internal)->length;
+   {  length=Getlength(jc,jo);
       asi.jc=jc;
       if((cvar=jc->functions.first->local.first) && cvar->next)
       {  Tofunction(&cvar->val,jc);
@@ -366,31 +583,19 @@ static void Arraysort(struct Jcontext *jc)
 
 static void Arraypop(struct Jcontext *jc)
 {  struct Jobject *jo=jc->jthis;
-   struct Variable *length,*elt;
+   struct Variable *elt;
    struct Value result={0};
-   UBYTE nname[16];
-   long len=0;
+   long len;
    if(jo)
-   {  if(length=Getproperty(jo,"length"))
-      {  Tonumber(&length->val,jc);
-         if(length->val.attr==VNA_VALID)
-         {  len=(long)length->val.value.nvalue;
-            if(len>0)
-            {  len--;
-               sprintf(nname,"%d",len);
-               if(elt=Getproperty(jo,nname))
-               {  Asgvalue(&result,&elt->val);
-                  REMOVE(elt);
-                  FREE(elt->name);
-                  FREE(elt);
-                  if(jo->internal && jo->hook==Arrayohook)
-                  {  ((struct Array *)jo->internal)->length--;
-                  }
-               }
-            }
+   {  len=Getlength(jc,jo);
+      if(len>0)
+      {  len--;
+         if(elt=Getindexed(jo,len))
+         {  Asgvalue(&result,&elt->val);
+            Deleteindexed(jo,len);
          }
-         Asgnumber(&length->val,VNA_VALID,(double)len);
       }
+      Setlength(jo,len);
       Asgvalue(RETVAL(jc),&result);
       Clearvalue(&result);
    }
@@ -399,105 +604,44 @@ static void Arraypop(struct Jcontext *jc)
 static void Arraypush(struct Jcontext *jc)
 {  struct Jobject *jo=jc->jthis;
    struct Jobject *args;
-   struct Variable *length,*argslen,*arg,*elt;
-   long len=0;
-   long i;
-   UBYTE nname[16];
+   struct Variable *arg,*elt;
+   long len,arglen,i;
    if(jo)
-   {  if(length=Getproperty(jo,"length"))
-      {  Tonumber(&length->val,jc);
-         if(length->val.attr==VNA_VALID)
-         {  len=(long)length->val.value.nvalue;
-         }
-      }
+   {  len=Getlength(jc,jo);
       if(args=Findarguments(jc))
-      {  if(argslen=Getproperty(args,"length"))
-         {  Tonumber(&argslen->val,jc);
-            if(argslen->val.attr==VNA_VALID)
-            {  long arglen=(long)argslen->val.value.nvalue;
-               for(i=0;i<arglen;i++)
-               {  if(arg=Arrayelt(args,i))
-                  {  if(jo->internal && jo->hook==Arrayohook)
-                     {  if(elt=Addarrayelt(jc,jo))
-                        {  Asgvalue(&elt->val,&arg->val);
-                        }
-                     }
-                     else
-                     {  sprintf(nname,"%d",len);
-                        if(elt=Getproperty(jo,nname))
-                        {  Asgvalue(&elt->val,&arg->val);
-                        }
-                        else if(elt=Addproperty(jo,nname))
-                        {  Asgvalue(&elt->val,&arg->val);
-                        }
-                     }
-                     len++;
-                  }
+      {  arglen=Getlength(jc,args);
+         for(i=0;i<arglen;i++)
+         {  if(arg=Arrayelt(args,i))
+            {  if(elt=Setindexed(jo,len))
+               {  Asgvalue(&elt->val,&arg->val);
                }
+               len++;
             }
          }
       }
-      if(!(length=Getproperty(jo,"length")))
-      {  length=Addproperty(jo,"length");
-      }
-      if(length)
-      {  Asgnumber(&length->val,VNA_VALID,(double)len);
-         if(jo->internal && jo->hook==Arrayohook)
-         {  ((struct Array *)jo->internal)->length=len;
-         }
-      }
+      Setlength(jo,len);
       Asgnumber(RETVAL(jc),VNA_VALID,(double)len);
    }
 }
 
 static void Arrayshift(struct Jcontext *jc)
 {  struct Jobject *jo=jc->jthis;
-   struct Variable *length,*var,*shift;
+   struct Variable *var;
    struct Value result={0};
-   long len=0;
-   long i;
-   UBYTE nname[16];
+   long len,i;
    if(jo)
-   {  if(length=Getproperty(jo,"length"))
-      {  Tonumber(&length->val,jc);
-         if(length->val.attr==VNA_VALID)
-         {  len=(long)length->val.value.nvalue;
-            if(len>0)
-            {  if(var=Getproperty(jo,"0"))
-               {  Asgvalue(&result,&var->val);
-               }
-               for(i=1;i<len;i++)
-               {  sprintf(nname,"%d",i);
-                  if(var=Getproperty(jo,nname))
-                  {  sprintf(nname,"%d",i-1);
-                     if(shift=Getproperty(jo,nname))
-                     {  Asgvalue(&shift->val,&var->val);
-                     }
-                     else if(shift=Addproperty(jo,nname))
-                     {  Asgvalue(&shift->val,&var->val);
-                     }
-                  }
-                  else
-                  {  sprintf(nname,"%d",i-1);
-                     if(shift=Getproperty(jo,nname))
-                     {  Clearvalue(&shift->val);
-                     }
-                  }
-               }
-               len--;
-               sprintf(nname,"%d",len);
-               if(var=Getproperty(jo,nname))
-               {  REMOVE(var);
-                  FREE(var->name);
-                  FREE(var);
-                  if(jo->internal && jo->hook==Arrayohook)
-                  {  ((struct Array *)jo->internal)->length--;
-                  }
-               }
-            }
+   {  len=Getlength(jc,jo);
+      if(len>0)
+      {  if(var=Getindexed(jo,0))
+         {  Asgvalue(&result,&var->val);
          }
-         Asgnumber(&length->val,VNA_VALID,(double)len);
+         for(i=1;i<len;i++)
+         {  Moveindexed(jo,i,i-1);
+         }
+         len--;
+         Deleteindexed(jo,len);
       }
+      Setlength(jo,len);
       Asgvalue(RETVAL(jc),&result);
       Clearvalue(&result);
    }
@@ -506,70 +650,31 @@ static void Arrayshift(struct Jcontext *jc)
 static void Arrayunshift(struct Jcontext *jc)
 {  struct Jobject *jo=jc->jthis;
    struct Jobject *args;
-   struct Variable *length,*argslen,*var,*shift;
-   long len=0;
-   long arglen=0;
+   struct Variable *var,*elt;
+   long len,arglen=0;
    long i;
-   UBYTE nname[16];
    if(jo)
-   {  if(length=Getproperty(jo,"length"))
-      {  Tonumber(&length->val,jc);
-         if(length->val.attr==VNA_VALID)
-         {  len=(long)length->val.value.nvalue;
-         }
-      }
+   {  len=Getlength(jc,jo);
       if(args=Findarguments(jc))
-      {  if(argslen=Getproperty(args,"length"))
-         {  Tonumber(&argslen->val,jc);
-            if(argslen->val.attr==VNA_VALID)
-            {  arglen=(long)argslen->val.value.nvalue;
-               if(arglen>0)
-               {  for(i=len;i>0;i--)
-                  {  sprintf(nname,"%d",i-1);
-                     if(var=Getproperty(jo,nname))
-                     {  sprintf(nname,"%d",i+arglen-1);
-                        if(shift=Getproperty(jo,nname))
-                        {  Asgvalue(&shift->val,&var->val);
-                        }
-                        else if(shift=Addproperty(jo,nname))
-                        {  Asgvalue(&shift->val,&var->val);
-                        }
-                     }
-                     else
-                     {  sprintf(nname,"%d",i+arglen-1);
-                        if(shift=Getproperty(jo,nname))
-                        {  Clearvalue(&shift->val);
-                        }
-                     }
-                  }
-                  len+=arglen;
-                  if(jo->internal && jo->hook==Arrayohook)
-                  {  ((struct Array *)jo->internal)->length+=arglen;
-                  }
-                  for(i=0;i<arglen;i++)
-                  {  if(var=Arrayelt(args,i))
-                     {  sprintf(nname,"%d",i);
-                        if(shift=Getproperty(jo,nname))
-                        {  Asgvalue(&shift->val,&var->val);
-                        }
-                        else if(shift=Addproperty(jo,nname))
-                        {  Asgvalue(&shift->val,&var->val);
-                        }
-                     }
+      {  arglen=Getlength(jc,args);
+         if(arglen>0)
+         {  for(i=len;i>0;i--)
+            {  Moveindexed(jo,i-1,i+arglen-1);
+            }
+            for(i=0;i<arglen;i++)
+            {  if(var=Arrayelt(args,i))
+               {  if(elt=Setindexed(jo,i))
+                  {  Asgvalue(&elt->val,&var->val);
                   }
                }
+               else
+               {  Deleteindexed(jo,i);
+               }
             }
+            len+=arglen;
          }
       }
-      if(!(length=Getproperty(jo,"length")))
-      {  length=Addproperty(jo,"length");
-      }
-      if(length)
-      {  Asgnumber(&length->val,VNA_VALID,(double)len);
-         if(jo->internal && jo->hook==Arrayohook)
-         {  ((struct Array *)jo->internal)->length=len;
-         }
-      }
+      Setlength(jo,len);
       Asgnumber(RETVAL(jc),VNA_VALID,(double)len);
    }
 }
@@ -632,18 +737,12 @@ static void Arrayconcat(struct Jcontext *jc)
 static void Arrayslice(struct Jcontext *jc)
 {  struct Jobject *jo=jc->jthis;
    struct Jobject *array;
-   struct Variable *length,*elt,*newelt;
-   long l=0;
+   struct Variable *elt,*newelt;
+   long l,n;
    long is,ie;
    BOOL svalid,evalid;
-   UBYTE nname[16];
    if(jo)
-   {  if(length=Getproperty(jo,"length"))
-      {  Tonumber(&length->val,jc);
-         if(length->val.attr==VNA_VALID)
-         {  l=(long)length->val.value.nvalue;
-         }
-      }
+   {  l=Getlength(jc,jo);
       if(array=Newarray(jc))
       {  is=(long)Numargument(jc,0,&svalid);
          ie=(long)Numargument(jc,1,&evalid);
@@ -655,24 +754,16 @@ static void Arrayslice(struct Jcontext *jc)
             if(ie<0) ie+=l;
             if(ie<0) ie=0;
             if(ie>l) ie=l;
-            while(is<ie)
-            {  ((struct Array*)array->internal)->length++;
-               sprintf(nname,"%d",(int)is++);
-               if(elt=Getproperty(jo,nname))
-               {  sprintf(nname,"%d",(int)((struct Array*)array->internal)->length -1);
-                  if((newelt = Addproperty(array,nname)))
+            for(n=0;is<ie;n++,is++)
+            {  if(elt=Getindexed(jo,is))
+               {  if(newelt=Setindexed(array,n))
                   {  Asgvalue(&newelt->val,&elt->val);
                   }
                }
             }
-            if((elt = Getproperty(array,"length")))
-            {  Asgnumber(&elt->val,VNA_VALID,(double)((struct Array*)array->internal)->length);
-            }
-            Asgobject(RETVAL(jc),array);
-         }
-         else
-         {  Asgobject(RETVAL(jc),array);
+            Setlength(array,n);
          }
+         Asgobject(RETVAL(jc),array);
       }
    }
 }
@@ -683,135 +774,65 @@ static void Arraysplice(struct Jcontext *jc)
    struct Jobject *args;
    struct Variable *var;
    struct Variable *elt;
-   struct Variable *length;
-   ULONG arglen = 0;
-   ULONG l = 0;
-   ULONG k;
-   UBYTE nname[16];
-   int is, dc;
+   long arglen = 0;
+   long l,k,n;
+   long is, dc;
    is = dc = 0;
    if((args = Findarguments(jc)))
-   {  var = Getproperty(args,"length");
-      Tonumber(&var->val,jc);
-      arglen = (ULONG)var->val.value.nvalue;
+   {  arglen = Getlength(jc,args);
    }
    if((array = Newarray(jc)) && arglen >= 2)
    {  var = Arrayelt(args,0);
       Tonumber(&var->val,jc);
-      is = (int)var->val.value.nvalue;
+      is = (long)var->val.value.nvalue;
       var = Arrayelt(args,1);
       Tonumber(&var->val,jc);
-      dc =(int)var->val.value.nvalue;
-      if (dc < 0) dc = 0;
-      if((length = Getproperty(jo,"length")))
-      {  Tonumber(&length->val,jc);
-         l = (ULONG)length->val.value.nvalue;
-      }
+      dc = (long)var->val.value.nvalue;
+      if(dc < 0) dc = 0;
+      l = Getlength(jc,jo);
       if(is < 0) is += l;
       if(is < 0) is = 0;
-      if ((l - is) < dc) dc = l - is;
-      for(k = is; k < is + dc; k++)
-      {  if((elt = Addarrayelt(jc,array)))
-         {  sprintf(nname,"%d",(int)k);
-            if((var = Getproperty(jo,nname)))
-            {  Asgvalue(&elt->val,&var->val);
+      if(is > l) is = l;
+      if((l - is) < dc) dc = l - is;
+      /* Collect the deleted elements */
+      for(k = 0; k < dc; k++)
+      {  if((elt = Getindexed(jo,is + k)))
+         {  if((var = Setindexed(array,k)))
+            {  Asgvalue(&var->val,&elt->val);
             }
          }
       }
+      Setlength(array,dc);
       arglen -= 2;
-      if( arglen < dc)
-      {  /* we must close and clear the gap */
-         for(k = is; k < l - dc + arglen; k++)
-         {
-            struct Variable *from,*to;
-            sprintf(nname,"%d",(int)(k+dc));
-            from = Getproperty(jo,nname);
-            sprintf(nname,"%d",(int)(k+arglen));
-            if(!(to = Getownproperty(jo,nname)))
-            {
-                to = Addproperty(jo,nname);
-            }
-            if(from)
-            {
-                if(to)
-                {
-                    Asgvalue(&to->val,&from->val);
-                }
-            }
-            else
-            if(to)
-            {
-                Clearvalue(&to->val);
-            }
+      if(arglen < dc)
+      {  /* we must close the gap */
+         for(k = is + dc; k < l; k++)
+         {  Moveindexed(jo,k,k - dc + arglen);
          }
-         for(k =l; k > l-dc + arglen;k--)
-         {
-            sprintf(nname,"%d",(int)k-1);
-            Deleteownproperty(jo,nname);
+         for(k = l - dc + arglen; k < l; k++)
+         {  Deleteindexed(jo,k);
          }
       }
-      if(arglen > dc)
+      else if(arglen > dc)
       {  /* we must widen the gap */
-         for( k = l - dc; k > is ; k--)
-         {
-            struct Variable *from, *to;
-            sprintf(nname,"%d",(int) k + dc -1);
-            from = Getproperty(jo,nname);
-            sprintf(nname,"%d",(int) k + arglen -1);
-            if(!(to = Getownproperty(jo,nname)))
-            {
-                to = Addproperty(jo,nname);
-            }
-            if(from)
-            {
-                if(to)
-                {
-                    Asgvalue(&to->val,&from->val);
-                }
-            }
-            else
-            {
-                if(to)
-                {
-                    Clearvalue(&to->val);
-                }
-            }
-
+         for(k = l; k > is + dc; k--)
+         {  Moveindexed(jo,k - 1,k - 1 - dc + arglen);
          }
       }
-      /* now we should have the right size "gap" to copy the new items into */
-      if(arglen)
-         {
-            for(k = 0; k < arglen; k++)
-            {
-                sprintf(nname,"%d",(int) k + is);
-                if((elt = Arrayelt(args,k + 2)))
-                {
-                    if(!(var = Getownproperty(jo,nname)))
-                    {
-                        var = Addproperty(jo,nname);
-                    }
-                    if(var)
-                    {
-                        Asgvalue(&var->val,&elt->val);
-                    }
-                }
+      /* now we have the right size gap to copy the new items into */
+      for(n = 0; n < arglen; n++)
+      {  if((elt = Arrayelt(args,n + 2)))
+         {  if((var = Setindexed(jo,is + n)))
+            {  Asgvalue(&var->val,&elt->val);
             }
          }
-        if(!(length = Getownproperty(jo,"length")))
-        {
-            length = Addproperty(jo,"length");
-        }
-        if(length)
-        {
-            Asgnumber(&length->val,VNA_VALID,(double)(l - dc + arglen));
-        }
-        if(Isarray(jo))
-        {
-            ((struct Array *)jo->internal)->length = (l -dc + arglen);
-        }
-    }
-    Asgobject(RETVAL(jc),array);
+         else
+         {  Deleteindexed(jo,is + n);
+         }
+      }
+      Setlength(jo,l - dc + arglen);
+   }
+   Asgobject(RETVAL(jc),array);
 }
 
 /* When "length" is set, set internal and truncate array as necessary */
@@ -828,7 +849,6 @@ static BOOL Arraylhook(struct Varhookdata *v)
       case VHC_SET:
          {  ULONG oldlen = a->length;
             ULONG newlen;
-            UBYTE nname[16];
             Tonumber(&v->value->val,v->jc);
             if(v->value->val.attr == VNA_VALID)
             {  newlen = (ULONG)v->value->val.value.nvalue;
@@ -837,17 +857,7 @@ static BOOL Arraylhook(struct Varhookdata *v)
                   /* Runtimeerror(v->jc,NTE_RANGE,v->jc->elt,"Array length must be positive integer"); */
                }
                if(newlen < oldlen)
-               {  int i;
-                  struct Variable *elt;
-                  for(i = newlen; i < oldlen; i++)
-                  {  sprintf(nname,"%d",i);
-                     /* Note: Deleteownproperty needs to be added */
-                     if((elt = Getproperty(jo,nname)))
-                     {  REMOVE(elt);
-                        FREE(elt->name);
-                        FREE(elt);
-                     }
-                  }
+               {  Truncatearray(jo,a,newlen);
                }
                a->length = newlen;
                Asgnumber(&v->var->val,VNA_VALID,(double)newlen);
@@ -864,21 +874,15 @@ static BOOL Arrayohook(struct Objhookdata *h)
 {  BOOL result=FALSE;
    struct Variable *prop;
    struct Array *a=(h->jo)?h->jo->internal:NULL;
-   long n;
+   ULONG n;
    switch(h->code)
    {  case OHC_ADDPROPERTY:
-         /* Note: Getownproperty needs to be added to jdata.c */
-         /* For now, use Getproperty which may search prototype chain */
-         if(!(prop=Getproperty(h->jo,h->name)))
+         if(!(prop=Getownproperty(h->jo,h->name)))
          {  prop=Addproperty(h->jo,h->name);
          }
-         if(prop && a)
-         {  n=atoi(h->name);
-            if(n>=a->length)
-            {  a->length=n+1;
-               if(prop=Getproperty(h->jo,"length"))
-               {  Asgnumber(&prop->val,VNA_VALID,(double)a->length);
-               }
+         if(prop && a && Touint32(h->name,&n))
+         {  if(n>=(ULONG)a->length)
+            {  Setarraylength(a,n+1);
             }
          }
          result=TRUE;
@@ -891,7 +895,7 @@ static BOOL Arrayohook(struct Objhookdata *h)
 static void Destructor(struct Array *a)
 {  if(a)
    {  if(a->array)
-      {  int i;
+      {  long i;
          for(i=0;i<a->array_length;i++)
          {  if(a->array[i])
             {  Disposevar(a->array[i]);
@@ -922,6 +926,7 @@ static void Constructor(struct Jcontext *jc)
       {  jo->internal=a;
          jo->dispose=Destructor;
          jo->hook=Arrayohook;
+         jo->type=OBJT_ARRAY;
          a->length=0;
          a->array_length=0;
          a->array = NULL;
@@ -947,16 +952,15 @@ static void Constructor(struct Jcontext *jc)
             }
          }
       }
-      if(!(prop = Getproperty(jo,"length")))
+      if(!a->lengthvar)
       {  if(prop=Addproperty(jo,"length"))
          {  prop->flags|=VARF_HIDDEN;
             prop->hook=Arraylhook;
             prop->hookdata = jo;
+            a->lengthvar=prop;
          }
       }
-      if(prop)
-      {  Asgnumber(&prop->val,VNA_VALID,(double)a->length);
-      }
+      Setarraylength(a,a->length);
    }
    if(!(jc->flags & EXF_CONSTRUCT))
    {  Asgobject(RETVAL(jc),jo);
@@ -1056,6 +1060,7 @@ struct Jobject *Newarray(struct Jcontext *jc)
             Asgnumber(&prop->val,VNA_VALID,0.0);
             prop->hook=Arraylhook;
             prop->hookdata = jo;
+            a->lengthvar=prop;
          }
       }
    }
@@ -1064,14 +1069,12 @@ struct Jobject *Newarray(struct Jcontext *jc)
 
 /* Find the nth array element, or NULL */
 struct Variable *Arrayelt(struct Jobject *jo,long n)
-{  UBYTE nname[16];
-   struct Array *a;
+{  struct Array *a;
    struct Variable *prop=NULL;
    if(jo && jo->internal && jo->hook==Arrayohook)
    {  a=(struct Array *)jo->internal;
       if(n>=0 && n<a->length)
-      {  sprintf(nname,"%d",(int)n);
-         prop=Getownproperty(jo,nname);
+      {  prop=Getelement(jo,a,n);
       }
    }
    return prop;
@@ -1079,22 +1082,49 @@ struct Variable *Arrayelt(struct Jobject *jo,long n)
 
 /* Add an element to this array */
 struct Variable *Addarrayelt(struct Jcontext *jc,struct Jobject *jo)
-{  UBYTE nname[16];
-   struct Array *a;
-   struct Variable *prop=NULL,*length;
+{  struct Array *a;
+   struct Variable *prop=NULL;
    if(jo && jo->internal && jo->hook==Arrayohook)
    {  a=(struct Array *)jo->internal;
-      sprintf(nname,"%d",(int)a->length);
-      if(prop=Addproperty(jo,nname))
-      {  a->length++;
-         if(length=Getownproperty(jo,"length"))
-         {  Asgnumber(&length->val,VNA_VALID,(double)a->length);
-         }
+      if(prop=Newelement(jo,a,a->length))
+      {  Setarraylength(a,a->length+1);
       }
    }
    return prop;
 }
 
+/* Find the nth element kept in the vector, for enumeration. If there
+ * is none, (*countp) is set to the number of such elements. */
+struct Variable *Enumarrayelt(struct Jobject *jo,long n,long *countp)
+{  struct Array *a;
+   long i,count=0;
+   if(Isarray(jo))
+   {  a=(struct Array *)jo->internal;
+      for(i=0;i<a->array_length;i++)
+      {  if(a->array[i])
+         {  if(count==n) return a->array[i];
+            count++;
+         }
+      }
+   }
+   *countp=count;
+   return NULL;
+}
+
+/* Delete (var) if it is an element of this array */
+BOOL Deletearrayelt(struct Jobject *jo,struct Variable *var)
+{  struct Array *a;
+   ULONG n;
+   if(Isarray(jo) && Touint32(var->name,&n))
+   {  a=(struct Array *)jo->internal;
+      if(Getelement(jo,a,n)==var)
+      {  Deleteelement(jo,a,n);
+         return TRUE;
+      }
+   }
+   return FALSE;
+}
+
 /* Array-specific property functions */
 
 struct Variable *_Array_Addproperty(struct Jobject *jo, STRPTR name)
@@ -1103,44 +1133,7 @@ struct Variable *_Array_Addproperty(struct Jobject *jo, STRPTR name)
     struct Variable * var = NULL;
     if(Touint32(name,&index) && jo->internal)
     {
-        struct Array *a = jo->internal;
-
-        if(a->array_length > index)
-        {
-//            if(a->length <= index) a->length = index;
-            if(a->array[index])
-            {
-                Disposevar(a->array[index]);
-            }
-            a->array[index] = Newvar(name,jo->jc);
-            var = a->array[index];
-        }
-        else
-        {
-            /* storage is not long enough */
-            /* allocate new copy date and replace */
-            long new_length = ((index / CHUNKSIZE) + 1) *CHUNKSIZE;
-            struct Variable **new_array = ALLOCTYPE(struct Variable *,new_length,MEMF_CLEAR,jo->jc->pool);
-            if(new_array)
-            {
-                if(a->array)
-                {
-                    /* copy into new_array and free */
-                    CopyMem(a->array,new_array,a->array_length * sizeof(struct Variable *));
-                    FREE(a->array);
-                }
-                a->array = new_array;
-                a->array_length = new_length;
-
-          //  if(a->length <= index) a->length = index +1;
-            if(a->array[index])
-            {
-                Disposevar(a->array[index]);
-            }
-                a->array[index] = Newvar(name,jo->jc);
-                var = a->array[index];
-            }
-        }
+        var = Newelement(jo,jo->internal,index);
     }
     else
     {
@@ -1155,9 +1148,9 @@ struct Variable *_Array_Getownproperty(struct Jobject *jo, STRPTR name)
     if(Touint32(name,&index) && jo->internal)
     {
         struct Array *a = jo->internal;
-        if((index < a->length) && (index < a->array_length))
+        if(index < (ULONG)a->length)
         {
-            return a->array[index];
+            return Getelement(jo,a,index);
         }
         else
         {
@@ -1177,16 +1170,10 @@ BOOL _Array_Deleteownproperty(struct Jobject *jo, STRPTR name)
     if(Touint32(name,&index) && jo->internal)
     {
         struct Array *a = jo->internal;
-        if((index < a->length) && (index < a->array_length))
+        if((index < (ULONG)a->length) && Getelement(jo,a,index))
         {
-            if(a->array[index])
-            {
-                Disposevar(a->array[index]);
-                a->array[index]=0;
-                return TRUE;
-            }
-            else
-            return FALSE;
+            Deleteelement(jo,a,index);
+            return TRUE;
         }
     }
     else
@@ -25,6 +25,7 @@
 
 /* Forward declarations */
 static void Disposelt(struct Element *elt);
+static void *Lowerelement(struct Jcontext *jc,void *elt,BOOL keepval);
 
 /* Create an element */
 static struct Element *Newelement(struct Jcontext *jc,void *pa,UWORD type,
@@ -1012,9 +1013,10 @@ static void *Element(struct Jcontext *jc,void *pa)
             Skiptoken(jc,pa,JT_RIGHTPAR);
          }
          else Errormsg(pa,"'(' expected - element (from element)");
-         func->body=Compoundstatement(jc,pa);
+         func->body=Lowerelement(jc,Compoundstatement(jc,pa),FALSE);
 
          /* Add function to current scope */
+         jc->flags|=JCF_FUNCTIONS;
         if(fobj=Newobject(jc))
         {
             Keepobject(fobj,TRUE);
@@ -1089,6 +1091,512 @@ static void Compileprogram(struct Jcontext *jc,void *pa)
 
 /*-----------------------------------------------------------------------*/
 
+/* Bytecode generation. With JCF_BYTECODE set, function bodies and top level
+ * loops are lowered to bytecode for the value stack machine in jvm.c.
+ * Variables get a name slot per bytecode, property accesses an inline cache.
+ * Statements and expressions the machine doesn't handle stay elements, run
+ * by BC_EXEC and BC_EVAL through Executeelem(). */
+
+struct Bcgen
+{  struct Jcontext *jc;
+   struct Bytecode *bc;
+   long maxcode,maxconsts,maxslots,maxcaches,maxloops;
+   long depth;                /* Current value stack depth */
+   long loop;                 /* Innermost loop number, or 0 */
+   long brkchain,contchain;   /* Unpatched jumps for innermost loop */
+   long native;               /* Number of instructions that aren't fallbacks */
+   BOOL keepval;              /* Statement values go to jc->val */
+   BOOL nomem;
+};
+
+/* Make room for (n) entries of (size) in array (*p) allocated for (*max) */
+static BOOL Bcgrow(struct Bcgen *g,void **p,long *max,long n,long size)
+{  void *q;
+   long newmax;
+   if(n<*max) return TRUE;
+   newmax=*max?2*(*max):16;
+   if(q=ALLOCTYPE(UBYTE,newmax*size,0,g->jc->pool))
+   {  memset(q,0,newmax*size);
+      if(*p)
+      {  memmove(q,*p,*max*size);
+         FREE(*p);
+      }
+      *p=q;
+      *max=newmax;
+      return TRUE;
+   }
+   g->nomem=TRUE;
+   return FALSE;
+}
+
+/* Add an instruction with stack effect (push), return its index */
+static long Bcemit(struct Bcgen *g,UWORD op,UWORD slot,long arg,void *elt,long push)
+{  struct Bytecode *bc=g->bc;
+   struct Binstr *bi;
+   if(!Bcgrow(g,(void **)&bc->code,&g->maxcode,bc->ncode,sizeof(struct Binstr))) return 0;
+   bi=&bc->code[bc->ncode];
+   bi->op=op;
+   bi->slot=slot;
+   bi->arg=arg;
+   bi->elt=elt;
+   g->depth+=push;
+   if(g->depth>bc->maxstack) bc->maxstack=g->depth;
+   if(op!=BC_EXEC && op!=BC_EVAL && op!=BC_POP && op!=BC_END) g->native++;
+   return bc->ncode++;
+}
+
+/* Point jump (n) to the next instruction */
+static void Bcpatch(struct Bcgen *g,long n)
+{  if(!g->nomem) g->bc->code[n].arg=g->bc->ncode;
+}
+
+/* Point a chain of jumps linked through their arg to (target) */
+static void Bcpatchchain(struct Bcgen *g,long n,long target)
+{  long next;
+   while(n>=0 && !g->nomem)
+   {  next=g->bc->code[n].arg;
+      g->bc->code[n].arg=target;
+      n=next;
+   }
+}
+
+/* Find or add the name slot for a variable */
+static UWORD Bcslot(struct Bcgen *g,UBYTE *name)
+{  struct Bytecode *bc=g->bc;
+   long i;
+   for(i=0;i<bc->nslots;i++)
+   {  if(STREQUAL(bc->names[i],name)) return (UWORD)i;
+   }
+   if(Bcgrow(g,(void **)&bc->names,&g->maxslots,bc->nslots,sizeof(UBYTE *))
+   && (bc->names[bc->nslots]=Jdupstr(name,-1,g->jc->pool)))
+   {  return (UWORD)bc->nslots++;
+   }
+   g->nomem=TRUE;
+   return 0;
+}
+
+/* Add an inline cache for a property with fixed (name) or NULL */
+static UWORD Bccache(struct Bcgen *g,UBYTE *name)
+{  struct Bytecode *bc=g->bc;
+   if(Bcgrow(g,(void **)&bc->caches,&g->maxcaches,bc->ncaches,sizeof(struct Propcache)))
+   {  bc->caches[bc->ncaches].name=name;
+      return (UWORD)bc->ncaches++;
+   }
+   return 0;
+}
+
+/* Add a constant for this literal element */
+static long Bcconst(struct Bcgen *g,struct Element *elt)
+{  struct Bytecode *bc=g->bc;
+   struct Value *v;
+   if(!Bcgrow(g,(void **)&bc->consts,&g->maxconsts,bc->nconsts,sizeof(struct Value))) return 0;
+   v=&bc->consts[bc->nconsts];
+   v->type=0;
+   switch(elt->type)
+   {  case ET_INTEGER:
+         Asgnumber(v,VNA_VALID,((struct Elementint *)elt)->ivalue);
+         break;
+      case ET_FLOAT:
+         Asgnumber(v,VNA_VALID,((struct Elementfloat *)elt)->fvalue);
+         break;
+      case ET_BOOLEAN:
+         Asgboolean(v,((struct Elementint *)elt)->ivalue!=0);
+         break;
+      case ET_STRING:
+         Asgstring(v,((struct Elementstring *)elt)->svalue,g->jc->pool);
+         break;
+   }
+   return bc->nconsts++;
+}
+
+#define BCIDENT(e) ((e) && ((struct Element *)(e))->type==ET_IDENTIFIER)
+#define BCDOT(e) ((e) && ((struct Element *)(e))->type==ET_DOT \
+   && BCIDENT(((struct Element *)(e))->sub2))
+#define BCINDEX(e) ((e) && ((struct Element *)(e))->type==ET_INDEX)
+#define BCNAME(e) (((struct Elementstring *)(e))->svalue)
+
+/* Generate code that pushes the value of expression (elt) */
+static void Bcexpr(struct Bcgen *g,struct Element *elt)
+{  struct Elementnode *enode;
+   long j1,j2,argc;
+   if(!elt)
+   {  Bcemit(g,BC_EVAL,0,0,NULL,1);
+      return;
+   }
+   switch(elt->type)
+   {  case ET_INTEGER:
+      case ET_FLOAT:
+      case ET_BOOLEAN:
+      case ET_STRING:
+         Bcemit(g,BC_CONST,0,Bcconst(g,elt),elt,1);
+         break;
+      case ET_IDENTIFIER:
+         Bcemit(g,BC_GETVAR,Bcslot(g,BCNAME(elt)),0,elt,1);
+         break;
+      case ET_DOT:
+         if(BCIDENT(elt->sub2))
+         {  Bcexpr(g,elt->sub1);
+            Bcemit(g,BC_GETMEMBER,Bccache(g,BCNAME(elt->sub2)),0,elt,0);
+         }
+         else Bcemit(g,BC_EVAL,0,0,elt,1);
+         break;
+      case ET_INDEX:
+         Bcexpr(g,elt->sub1);
+         Bcexpr(g,elt->sub2);
+         Bcemit(g,BC_GETINDEX,Bccache(g,NULL),0,elt,-1);
+         break;
+      case ET_ASSIGN:
+         if(BCIDENT(elt->sub1))
+         {  Bcexpr(g,elt->sub2);
+            Bcemit(g,BC_SETVAR,Bcslot(g,BCNAME(elt->sub1)),0,elt,0);
+         }
+         else if(BCDOT(elt->sub1))
+         {  Bcexpr(g,((struct Element *)elt->sub1)->sub1);
+            Bcexpr(g,elt->sub2);
+            Bcemit(g,BC_SETMEMBER,
+               Bccache(g,BCNAME(((struct Element *)elt->sub1)->sub2)),0,elt->sub1,-1);
+         }
+         else if(BCINDEX(elt->sub1))
+         {  Bcexpr(g,((struct Element *)elt->sub1)->sub1);
+            Bcexpr(g,((struct Element *)elt->sub1)->sub2);
+            Bcexpr(g,elt->sub2);
+            Bcemit(g,BC_SETINDEX,Bccache(g,NULL),0,elt->sub1,-2);
+         }
+         else Bcemit(g,BC_EVAL,0,0,elt,1);
+         break;
+      case ET_APLUS:
+      case ET_AMINUS:
+      case ET_AMULT:
+      case ET_ADIV:
+      case ET_AREM:
+      case ET_ABITAND:
+      case ET_ABITOR:
+      case ET_ABITXOR:
+      case ET_ASHLEFT:
+      case ET_ASHRIGHT:
+      case ET_AUSHRIGHT:
+         if(BCIDENT(elt->sub1))
+         {  UWORD slot=Bcslot(g,BCNAME(elt->sub1));
+            Bcemit(g,BC_GETVAR,slot,0,elt->sub1,1);
+            Bcexpr(g,elt->sub2);
+            Bcemit(g,BC_ASGOPVAR,slot,elt->type,elt,-1);
+         }
+         else Bcemit(g,BC_EVAL,0,0,elt,1);
+         break;
+      case ET_PLUS:
+      case ET_MINUS:
+      case ET_MULT:
+      case ET_DIV:
+      case ET_REM:
+      case ET_BITAND:
+      case ET_BITOR:
+      case ET_BITXOR:
+      case ET_SHLEFT:
+      case ET_SHRIGHT:
+      case ET_USHRIGHT:
+      case ET_EQ:
+      case ET_NE:
+      case ET_EXEQ:
+      case ET_NEXEQ:
+      case ET_LT:
+      case ET_GT:
+      case ET_LE:
+      case ET_GE:
+         Bcexpr(g,elt->sub1);
+         Bcexpr(g,elt->sub2);
+         Bcemit(g,BC_BINARY,0,elt->type,elt,-1);
+         break;
+      case ET_AND:
+      case ET_OR:
+         Bcexpr(g,elt->sub1);
+         j1=Bcemit(g,(elt->type==ET_AND)?BC_AND:BC_OR,0,0,elt,-1);
+         Bcexpr(g,elt->sub2);
+         Bcpatch(g,j1);
+         break;
+      case ET_NEGATIVE:
+      case ET_POSITIVE:
+      case ET_NOT:
+      case ET_BITNEG:
+      case ET_TYPEOF:
+         Bcexpr(g,elt->sub1);
+         Bcemit(g,BC_UNARY,0,elt->type,elt,0);
+         break;
+      case ET_PREINC:
+      case ET_PREDEC:
+      case ET_POSTINC:
+      case ET_POSTDEC:
+         if(BCIDENT(elt->sub1))
+         {  Bcemit(g,BC_INCVAR,Bcslot(g,BCNAME(elt->sub1)),elt->type,elt,1);
+         }
+         else if(BCDOT(elt->sub1))
+         {  Bcexpr(g,((struct Element *)elt->sub1)->sub1);
+            Bcemit(g,BC_INCMEMBER,
+               Bccache(g,BCNAME(((struct Element *)elt->sub1)->sub2)),elt->type,elt->sub1,0);
+         }
+         else if(BCINDEX(elt->sub1))
+         {  Bcexpr(g,((struct Element *)elt->sub1)->sub1);
+            Bcexpr(g,((struct Element *)elt->sub1)->sub2);
+            Bcemit(g,BC_INCINDEX,Bccache(g,NULL),elt->type,elt->sub1,-1);
+         }
+         else Bcemit(g,BC_EVAL,0,0,elt,1);
+         break;
+      case ET_COND:
+         Bcexpr(g,elt->sub1);
+         j1=Bcemit(g,BC_JUMPFALSE,0,0,elt,-1);
+         Bcexpr(g,elt->sub2);
+         j2=Bcemit(g,BC_JUMP,0,0,elt,0);
+         Bcpatch(g,j1);
+         g->depth--;
+         Bcexpr(g,elt->sub3);
+         Bcpatch(g,j2);
+         break;
+      case ET_COMMA:
+         Bcexpr(g,elt->sub1);
+         Bcemit(g,BC_POP,0,0,elt,-1);
+         Bcexpr(g,elt->sub2);
+         break;
+      case ET_CALL:
+         enode=((struct Elementlist *)elt)->subs.first;
+         Bcexpr(g,enode->sub);
+         for(argc=0,enode=enode->next;enode && enode->next;enode=enode->next,argc++)
+         {  Bcexpr(g,enode->sub);
+         }
+         Bcemit(g,BC_CALL,0,argc,elt,-argc);
+         break;
+      default:
+         Bcemit(g,BC_EVAL,0,0,elt,1);
+         break;
+   }
+}
+
+/* Generate code for the body of a loop with number (loop) */
+static void Bcstmt(struct Bcgen *g,struct Element *elt);
+static void Bcloopbody(struct Bcgen *g,struct Element *body,long loop,
+   long *brkchain,long *contchain)
+{  long oldloop=g->loop,oldbrk=g->brkchain,oldcont=g->contchain;
+   g->loop=loop;
+   g->brkchain=g->contchain=-1;
+   Bcstmt(g,body);
+   *brkchain=g->brkchain;
+   *contchain=g->contchain;
+   g->loop=oldloop;
+   g->brkchain=oldbrk;
+   g->contchain=oldcont;
+}
+
+/* Allocate a loop number */
+static long Bcnewloop(struct Bcgen *g)
+{  struct Bytecode *bc=g->bc;
+   if(Bcgrow(g,(void **)&bc->loops,&g->maxloops,bc->nloops+1,sizeof(struct Bloop)))
+   {  return ++bc->nloops;
+   }
+   return 0;
+}
+
+/* Generate code for statement (elt), leaving the stack as it was */
+static void Bcstmt(struct Bcgen *g,struct Element *elt)
+{  struct Elementnode *enode;
+   struct Element *var;
+   long j1,j2,top,cont,loop,brkchain,contchain;
+   UWORD slot;
+   if(!elt || g->nomem) return;
+   switch(elt->type)
+   {  case ET_COMPOUND:
+         for(enode=((struct Elementlist *)elt)->subs.first;enode->next;enode=enode->next)
+         {  Bcstmt(g,enode->sub);
+         }
+         break;
+      case ET_VARLIST:
+         for(enode=((struct Elementlist *)elt)->subs.first;enode->next;enode=enode->next)
+         {  Bcstmt(g,enode->sub);
+         }
+         break;
+      case ET_VAR:
+         if(BCIDENT(elt->sub1))
+         {  slot=Bcslot(g,BCNAME(elt->sub1));
+            Bcemit(g,BC_DECLVAR,slot,0,elt,0);
+            if(elt->sub2)
+            {  Bcexpr(g,elt->sub2);
+               Bcemit(g,BC_INITVAR,slot,0,elt,-1);
+            }
+         }
+         else Bcemit(g,BC_EXEC,g->loop,0,elt,0);
+         break;
+      case ET_EMPTY:
+         break;
+      case ET_IF:
+         Bcexpr(g,elt->sub1);
+         j1=Bcemit(g,BC_JUMPFALSE,0,0,elt,-1);
+         Bcstmt(g,elt->sub2);
+         if(elt->sub3)
+         {  j2=Bcemit(g,BC_JUMP,0,0,elt,0);
+            Bcpatch(g,j1);
+            Bcstmt(g,elt->sub3);
+            Bcpatch(g,j2);
+         }
+         else Bcpatch(g,j1);
+         break;
+      case ET_WHILE:
+         loop=Bcnewloop(g);
+         top=g->bc->ncode;
+         Bcexpr(g,elt->sub1);
+         j1=Bcemit(g,BC_JUMPFALSE,0,0,elt,-1);
+         Bcloopbody(g,elt->sub2,loop,&brkchain,&contchain);
+         cont=Bcemit(g,BC_LOOP,0,top,elt,0);
+         Bcpatch(g,j1);
+         Bcpatchchain(g,contchain,cont);
+         Bcpatchchain(g,brkchain,g->bc->ncode);
+         if(!g->nomem)
+         {  g->bc->loops[loop].cont=cont;
+            g->bc->loops[loop].brk=g->bc->ncode;
+         }
+         break;
+      case ET_DO:
+         loop=Bcnewloop(g);
+         top=g->bc->ncode;
+         Bcloopbody(g,elt->sub1,loop,&brkchain,&contchain);
+         cont=g->bc->ncode;
+         Bcexpr(g,elt->sub2);
+         j1=Bcemit(g,BC_JUMPFALSE,0,0,elt,-1);
+         Bcemit(g,BC_LOOP,0,top,elt,0);
+         Bcpatch(g,j1);
+         Bcpatchchain(g,contchain,cont);
+         Bcpatchchain(g,brkchain,g->bc->ncode);
+         if(!g->nomem)
+         {  g->bc->loops[loop].cont=cont;
+            g->bc->loops[loop].brk=g->bc->ncode;
+         }
+         break;
+      case ET_FOR:
+         loop=Bcnewloop(g);
+         if(elt->sub1)
+         {  if(((struct Element *)elt->sub1)->type==ET_VARLIST) Bcstmt(g,elt->sub1);
+            else
+            {  Bcexpr(g,elt->sub1);
+               Bcemit(g,BC_POP,0,0,elt,-1);
+            }
+         }
+         top=g->bc->ncode;
+         j1=-1;
+         if(elt->sub2)
+         {  Bcexpr(g,elt->sub2);
+            j1=Bcemit(g,BC_JUMPFALSE,0,0,elt,-1);
+         }
+         Bcloopbody(g,elt->sub4,loop,&brkchain,&contchain);
+         cont=g->bc->ncode;
+         if(elt->sub3)
+         {  Bcexpr(g,elt->sub3);
+            Bcemit(g,BC_POP,0,0,elt,-1);
+         }
+         Bcemit(g,BC_LOOP,0,top,elt,0);
+         if(j1>=0) Bcpatch(g,j1);
+         Bcpatchchain(g,contchain,cont);
+         Bcpatchchain(g,brkchain,g->bc->ncode);
+         if(!g->nomem)
+         {  g->bc->loops[loop].cont=cont;
+            g->bc->loops[loop].brk=g->bc->ncode;
+         }
+         break;
+      case ET_BREAK:
+         if(g->loop)
+         {  g->brkchain=Bcemit(g,BC_JUMP,0,g->brkchain,elt,0);
+         }
+         else Bcemit(g,BC_EXEC,0,0,elt,0);
+         break;
+      case ET_CONTINUE:
+         if(g->loop)
+         {  g->contchain=Bcemit(g,BC_JUMP,0,g->contchain,elt,0);
+         }
+         else Bcemit(g,BC_EXEC,0,0,elt,0);
+         break;
+      case ET_RETURN:
+         if(elt->sub1)
+         {  Bcexpr(g,elt->sub1);
+            Bcemit(g,BC_RETURN,0,0,elt,-1);
+         }
+         else Bcemit(g,BC_RETURNUNDEF,0,0,elt,0);
+         break;
+      case ET_BYTECODE:
+         /* Loop lowered by Jcompile() inside a program turned into a body */
+         Bcstmt(g,elt->sub1);
+         break;
+      case ET_PROGRAM:
+      case ET_TRY:
+      case ET_FUNCTION:
+      case ET_THROW:
+      case ET_INTERNAL:
+      case ET_FUNCEVAL:
+      case ET_CASE:
+      case ET_WITH:
+      case ET_FORIN:
+      case ET_SWITCH:
+      case ET_LABEL:
+#ifdef JSDEBUG
+      case ET_DEBUG:
+#endif
+         Bcemit(g,BC_EXEC,g->loop,0,elt,0);
+         break;
+      default:
+         /* Expression statement */
+         Bcexpr(g,elt);
+         Bcemit(g,g->keepval?BC_SETVAL:BC_POP,0,0,elt,-1);
+         break;
+   }
+}
+
+/* Dispose bytecode */
+static void Freebytecode(struct Bytecode *bc)
+{  long i;
+   if(bc)
+   {  if(bc->code) FREE(bc->code);
+      for(i=0;i<bc->nconsts;i++) Clearvalue(&bc->consts[i]);
+      if(bc->consts) FREE(bc->consts);
+      for(i=0;i<bc->nslots;i++)
+      {  if(bc->names[i]) FREE(bc->names[i]);
+      }
+      if(bc->names) FREE(bc->names);
+      if(bc->caches) FREE(bc->caches);
+      if(bc->loops) FREE(bc->loops);
+      FREE(bc);
+   }
+}
+
+/* Lower statement (elt) to bytecode. Returns an ET_BYTECODE element
+ * holding (elt), or (elt) itself if it isn't worth it. */
+static void *Lowerelement(struct Jcontext *jc,void *elt,BOOL keepval)
+{  struct Bcgen g={0};
+   struct Element *belt=NULL;
+   if(!elt || !(jc->flags&JCF_BYTECODE) || (jc->flags&JCF_ERROR)) return elt;
+   g.jc=jc;
+   g.keepval=keepval;
+   g.brkchain=g.contchain=-1;
+   if(g.bc=ALLOCSTRUCT(Bytecode,1,0,jc->pool))
+   {  memset(g.bc,0,sizeof(struct Bytecode));
+      Bcstmt(&g,elt);
+      Bcemit(&g,BC_END,0,0,NULL,0);
+      if(!g.nomem && g.native
+      && (belt=ALLOCSTRUCT(Element,1,0,jc->pool)))
+      {  belt->type=ET_BYTECODE;
+         belt->generation=((struct Element *)elt)->generation;
+         belt->linenr=((struct Element *)elt)->linenr;
+         belt->sub1=elt;
+         belt->sub2=g.bc;
+         belt->sub3=belt->sub4=NULL;
+      }
+      else
+      {  Freebytecode(g.bc);
+      }
+   }
+   return belt?belt:elt;
+}
+
+#undef BCIDENT
+#undef BCDOT
+#undef BCINDEX
+#undef BCNAME
+
+/*-----------------------------------------------------------------------*/
+
 struct Decompile
 {  struct Jbuffer *jb;
    short indent;
@@ -1859,6 +2367,10 @@ static void Deobject(struct Decompile *dc,struct Elementlist *elist)
 
 }
 
+static void Debytecode(struct Decompile *dc,struct Element *elt)
+{  Decompile(dc,elt->sub1);
+}
+
 static void Delabel(struct Decompile *dc, struct Element *elt)
 {
     Decompile(dc,elt->sub1);
@@ -1983,6 +2495,7 @@ static Decompelement *decomptab[]=
    (Decompelement *)Dearray,
    (Decompelement *)Deobject,
    (Decompelement *)Delabel,
+   (Decompelement *)Debytecode,
 #ifdef JSDEBUG
    (Decompelement *)Dedebug,
 #endif
@@ -2092,6 +2605,12 @@ static void Disswitch(struct Elementswitch *elt)
    FREE(elt);
 }
 
+static void Disbytecode(struct Element *elt)
+{  Freebytecode(elt->sub2);
+   if(elt->sub1) Disposelt(elt->sub1);
+   FREE(elt);
+}
+
 static void Distry(struct Elementtry *elt)
 {
     if(elt->try)Disposelt(elt->try);
@@ -2189,6 +2708,7 @@ static Diselementf *distab[]=
    (Diselementf *)Dislist,       /* array */
    (Diselementf *)Dislist,       /* object */
    (Diselementf *)Diselement,    /* label */
+   (Diselementf *)Disbytecode,   /* bytecode */
 #ifdef JSDEBUG
    (Diselementf *)Diselement,    /* debug */
 #endif
@@ -2215,6 +2735,135 @@ void Jcompile(struct Jcontext *jc,UBYTE *source)
       Compileprogram(jc,pa);
       FREE(pa);
    }
+   /* Lower the new top level loops. Functions were lowered while parsing. */
+   if(jc->program && (jc->flags&JCF_BYTECODE) && !(jc->flags&JCF_ERROR))
+   {  struct Elementnode *enode;
+      struct Element *elt;
+      for(enode=((struct Elementlist *)jc->program)->subs.first;enode->next;enode=enode->next)
+      {  elt=enode->sub;
+         if(elt && elt->generation==jc->generation
+         && (elt->type==ET_WHILE || elt->type==ET_DO || elt->type==ET_FOR))
+         {  enode->sub=Lowerelement(jc,elt,TRUE);
+         }
+      }
+   }
+}
+
+/* Compiled script cache. Event handlers and javascript: URLs run the same
+ * short sources over and over, so their programs are kept and executed
+ * again. Sources that declare functions are not cached, because compiling
+ * those adds the function objects to the scope. */
+
+#define SCRIPTCACHEMAX     64       /* Nr of scripts kept per context */
+#define SCRIPTMAXLENGTH    2048     /* Longer sources are not cached */
+
+static ULONG Hashscript(UBYTE *source,long *length)
+{  ULONG hash=2166136261UL;
+   UBYTE *p;
+   for(p=source;*p;p++)
+   {  hash^=(ULONG)*p;
+      hash*=16777619UL;
+   }
+   *length=p-source;
+   return hash;
+}
+
+static void Disposescript(struct Jscript *js)
+{  if(js->program) Jdispose((struct Element *)js->program);
+   if(js->source) FREE(js->source);
+   FREE(js);
+}
+
+/* Compile this source, or find it in the script cache. Returns the cached
+ * script, which must be released by Jreleasescript() after it has run.
+ * If NULL is returned, the source was compiled into jc->program as
+ * Jcompile() does. */
+struct Jscript *Jcompilescript(struct Jcontext *jc,UBYTE *source)
+{  struct Jscript *js;
+   struct Elementlist *program,*oldprogram;
+   struct Elementnode *enode;
+   ULONG hash;
+   long length;
+   if(!jc || !source) return NULL;
+   hash=Hashscript(source,&length);
+   if(length>SCRIPTMAXLENGTH)
+   {  Jcompile(jc,source);
+      return NULL;
+   }
+   for(js=jc->scripts.first;js->next;js=js->next)
+   {  if(js->hash==hash && !js->busy && STREQUAL(js->source,source))
+      {  Remove((struct Node *)js);
+         AddHead((struct List *)&jc->scripts,(struct Node *)js);
+         /* Exeprogram() only runs statements of the current generation */
+         for(enode=js->program->subs.first;enode->next;enode=enode->next)
+         {  if(enode->sub) ((struct Element *)enode->sub)->generation=jc->generation;
+         }
+         js->busy++;
+         return js;
+      }
+   }
+   /* Compile into a program of its own */
+   oldprogram=jc->program;
+   jc->program=NULL;
+   jc->flags&=~JCF_FUNCTIONS;
+   Jcompile(jc,source);
+   program=jc->program;
+   jc->program=oldprogram;
+   if(!program) return NULL;
+   if(!(jc->flags&(JCF_ERROR|JCF_FUNCTIONS))
+   && (js=ALLOCSTRUCT(Jscript,1,MEMF_CLEAR,jc->pool)))
+   {  js->hash=hash;
+      js->program=program;
+      js->busy=1;
+      if(js->source=Jdupstr(source,length,jc->pool))
+      {  if(jc->nscripts>=SCRIPTCACHEMAX)
+         {  struct Jscript *old;
+            for(old=jc->scripts.last;old->prev;old=old->prev)
+            {  if(!old->busy)
+               {  Remove((struct Node *)old);
+                  Disposescript(old);
+                  jc->nscripts--;
+                  break;
+               }
+            }
+         }
+         AddHead((struct List *)&jc->scripts,(struct Node *)js);
+         jc->nscripts++;
+         return js;
+      }
+      FREE(js);
+   }
+   /* Not cached, move the statements to the context program. A program
+    * with errors won't run at all. */
+   if(jc->flags&JCF_ERROR)
+   {  Jdispose((struct Element *)program);
+   }
+   else if(!jc->program)
+   {  jc->program=program;
+   }
+   else
+   {  while(enode=(struct Elementnode *)RemHead((struct List *)&program->subs))
+      {  AddTail((struct List *)&((struct Elementlist *)jc->program)->subs,(struct Node *)enode);
+      }
+      Jdispose((struct Element *)program);
+   }
+   return NULL;
+}
+
+/* Release a script returned by Jcompilescript() */
+void Jreleasescript(struct Jcontext *jc,struct Jscript *js)
+{  if(js) js->busy--;
+}
+
+/* Dispose all cached scripts */
+void Freescripts(struct Jcontext *jc)
+{  struct Jscript *js;
+   if(jc->scripts.first)
+   {  while(js=(struct Jscript *)RemHead((struct List *)&jc->scripts))
+      {  Disposescript(js);
+      }
+   }
+   jc->nscripts=0;
 }
 
 struct Jobject *Jcompiletofunction(struct Jcontext *jc,UBYTE *source,UBYTE *name)
@@ -2225,6 +2874,7 @@ struct Jobject *Jcompiletofunction(struct Jcontext *jc,UBYTE *source,UBYTE *name
    NewList((struct List *)&jc2.objects);
    NewList((struct List *)&jc2.functions);
    jc2.generation=jc->generation;
+   jc2.flags=jc->flags&JCF_BYTECODE;
    Jcompile(&jc2,source);
    if(!(jc2.flags&JCF_ERROR))
    {  if(func=ALLOCSTRUCT(Elementfunc,1,0,jc->pool))
@@ -2236,6 +2886,7 @@ struct Jobject *Jcompiletofunction(struct Jcontext *jc,UBYTE *source,UBYTE *name
          func->name[0]=toupper(func->name[0]);
          func->body=jc2.program;
          ((struct Elementlist *)func->body)->type=ET_COMPOUND;
+         func->body=Lowerelement(&jc2,func->body,FALSE);
          /* Create function object */
          if(fobj=Newobject(jc))
          {  fobj->function=func;
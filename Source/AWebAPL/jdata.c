@@ -23,6 +23,16 @@
 
 struct Array;  /* Forward declaration */
 
+static void Gcstep(struct Jcontext *jc);
+static void Shadegrey(struct Jcontext *jc,struct Jobject *jo);
+static void Ungrey(struct Jcontext *jc,struct Jobject *jo);
+static void Forget(struct Jcontext *jc,struct Jobject *jo);
+
+/* Bumped whenever a property is added or removed anywhere, or a prototype
+ * link changes. Property lookups cached by the bytecode machine are only
+ * valid while the stamp is unchanged. */
+ULONG propstamp;
+
 /*-----------------------------------------------------------------------*/
 
 /* Call this property function */
@@ -42,44 +52,133 @@ BOOL Callproperty(struct Jcontext *jc,struct Jobject *jo,UBYTE *name)
 
 /*-----------------------------------------------------------------------*/
 
+/* Allocate a string buffer holding (len) characters of (s), with
+ * room for (size) characters including the nul */
+static UBYTE *Allocstring(UBYTE *s,long len,long size,void *pool)
+{  struct Jstring *js;
+   UBYTE *p=NULL;
+   if(size<len+1) size=len+1;
+   if(js=(struct Jstring *)ALLOCTYPE(UBYTE,sizeof(struct Jstring)+size,0,pool))
+   {  js->refcount=1;
+      js->length=len;
+      js->size=size;
+      p=(UBYTE *)(js+1);
+      if(len) memmove(p,s,len);
+      p[len]='\0';
+   }
+   return p;
+}
+
 /* Clear out a value */
 /* This must always be called when assigning to a previously used value */
 /* This must always be used before discarding / disposing of a previously used value */
 
 void Clearvalue(struct Value *v)
-{  switch(v->type)
+{  struct Jstring *js;
+   switch(v->type)
    {  case VTP_STRING:
          if(v->value.svalue)
-         {
-             FREE(v->value.svalue);
-             v->value.svalue = NULL;
+         {  js=JSTRING(v->value.svalue);
+            if(--js->refcount<=0) FREE(js);
+            v->value.svalue = NULL;
          }
          break;
    }
    v->type=VTP_UNDEFINED;
 }
 
-/* Assign a value */
-void Asgvalue(struct Value *to,struct Value *from)
+/* Call the write barrier for the objects in (to), not knowing where (to)
+ * is. Storing in the context's result, the running function's return value
+ * or the running bytecode's stack is exempt, those are roots that the
+ * collector always looks at. */
+static void Writebarrier(struct Value *to)
+{  struct Jobject *jo;
+   struct Jcontext *jc;
+   if(jo=to->value.obj.ovalue)
+   {  jc=jo->jc;
+      if(to==jc->val || to==&jc->functions.first->retval
+      || (jc->vmframe && to>=jc->vmframe->stack && to<jc->vmframe->stack+jc->vmframe->size))
+      {  return;
+      }
+      Gcwrite(jo);
+   }
+   if(jo=to->value.obj.fthis)
+   {  Gcwrite(jo);
+   }
+}
+
+/* Add an old object to the remembered set */
+static void Remember(struct Jcontext *jc,struct Jobject *jo,struct Value *v)
+{  struct Jobject **set;
+   long size;
+   if(!(jo->flags&OBJF_REMEMBERED))
+   {  if(jc->gcnremember>=jc->gcremembersize)
+      {  size=jc->gcremembersize?2*jc->gcremembersize:GC_SLICE;
+         if(!(set=ALLOCTYPE(struct Jobject *,size,0,jc->pool)))
+         {  /* Treat the stored objects as escaped instead */
+            if(v->value.obj.ovalue) Gcwrite(v->value.obj.ovalue);
+            if(v->value.obj.fthis) Gcwrite(v->value.obj.fthis);
+            return;
+         }
+         if(jc->gcnremember) memmove(set,jc->gcremember,jc->gcnremember*sizeof(struct Jobject *));
+         if(jc->gcremember) FREE(jc->gcremember);
+         jc->gcremember=set;
+         jc->gcremembersize=size;
+      }
+      jc->gcremember[jc->gcnremember++]=jo;
+      jo->flags|=OBJF_REMEMBERED;
+   }
+}
+
+/* Call the write barrier for the objects in variable (var). Here the owner
+ * is known, so nursery objects don't have to be treated as escaped. Local
+ * variables are roots, nursery owners are scanned with the nursery, and old
+ * owners are remembered until the next nursery collection. */
+static void Varbarrier(struct Variable *var)
+{  struct Jobject *owner=var->owner,*jo,*fthis;
+   struct Jcontext *jc;
+   if(var->flags&VARF_LOCAL) return;
+   if(!owner)
+   {  Writebarrier(&var->val);
+      return;
+   }
+   if(!(owner->flags&OBJF_YOUNG))
+   {  jc=owner->jc;
+      jo=var->val.value.obj.ovalue;
+      fthis=var->val.value.obj.fthis;
+      if((jo && (jo->flags&OBJF_YOUNG)) || (fthis && (fthis->flags&OBJF_YOUNG)))
+      {  Remember(jc,owner,&var->val);
+      }
+      if(jc->gcphase==GCP_MARK)
+      {  if(jo) Shadegrey(jc,jo);
+         if(fthis) Shadegrey(jc,fthis);
+      }
+   }
+}
+
+/* Copy a value without write barrier */
+static void Copyvalue(struct Value *to,struct Value *from)
 {
-   Clearvalue(to);
-   to->type=from->type;
-   to->attr=from->attr;
-   switch(from->type)
-   {  case VTP_NUMBER:
-         to->value.nvalue=from->value.nvalue;
-         break;
-      case VTP_BOOLEAN:
-         to->value.bvalue=from->value.bvalue;
-         break;
-      case VTP_STRING:
-         to->value.svalue=Jdupstr(from->value.svalue,-1,Getpool(from->value.svalue));
-         break;
-      case VTP_OBJECT:
-         to->value.obj.ovalue=from->value.obj.ovalue;
-         to->value.obj.fthis=from->value.obj.fthis;
-         break;
+   struct Value v=*from;
+   /* Strings are shared, not copied. Take the reference before clearing
+    * (to) since it may be the same value. */
+   if(v.type==VTP_STRING && v.value.svalue)
+   {  JSTRING(v.value.svalue)->refcount++;
    }
+   Clearvalue(to);
+   *to=v;
+}
+
+/* Assign a value */
+void Asgvalue(struct Value *to,struct Value *from)
+{  Copyvalue(to,from);
+   if(to->type==VTP_OBJECT) Writebarrier(to);
+}
+
+/* Assign a value to a variable */
+void Asgvarvalue(struct Variable *var,struct Value *from)
+{  Copyvalue(&var->val,from);
+   if(var->val.type==VTP_OBJECT) Varbarrier(var);
 }
 
 /* Assign a number */
@@ -111,19 +210,59 @@ void Asgboolean(struct Value *to,BOOL b)
 
 /* Assign a string */
 void Asgstring(struct Value *to,UBYTE *s,void *pool)
-{  Clearvalue(to);
-   to->type=VTP_STRING;
-   to->attr=0;
-   to->value.svalue=Jdupstr(s,-1,pool);
+{  Asgstringlen(to,s,s?strlen(s):0,pool);
 }
 
 /* Assign a string of given length */
 void Asgstringlen(struct Value *to,UBYTE *s,long len,void *pool)
-{
-    Clearvalue(to);
-    to->type=VTP_STRING;
-    to->attr=0;
-    to->value.svalue=Jdupstr(s,len,pool);
+{  UBYTE *p=NULL;
+   /* (s) may be part of the old value, so copy it first */
+   if(s) p=Allocstring(s,len,0,pool);
+   Clearvalue(to);
+   to->type=VTP_STRING;
+   to->attr=0;
+   to->value.svalue=p;
+}
+
+/* Append (len) characters of (s) to string value (v). If the buffer is not
+ * shared and has room, the text is added in place. Otherwise the buffer is
+ * replaced by a larger one, so repeated appends take amortised linear time. */
+void Appendstring(struct Value *v,UBYTE *s,long len,void *pool)
+{  struct Jstring *js;
+   UBYTE *p;
+   if(v->type!=VTP_STRING || !v->value.svalue)
+   {  Asgstringlen(v,s,len,pool);
+   }
+   else if(len>0)
+   {  js=JSTRING(v->value.svalue);
+      if(js->refcount==1 && js->length+len<js->size)
+      {  p=v->value.svalue;
+      }
+      else if(p=Allocstring(v->value.svalue,js->length,js->length+len+1+(js->length+len)/2,
+         Getpool(js)))
+      {  if(--js->refcount<=0)
+         {  /* (s) could point into the old buffer */
+            if(s>=v->value.svalue && s<v->value.svalue+js->size)
+            {  s=p+(s-v->value.svalue);
+            }
+            FREE(js);
+         }
+         v->value.svalue=p;
+         js=JSTRING(p);
+      }
+      else return;
+      memmove(p+js->length,s,len);
+      js->length+=len;
+      p[js->length]='\0';
+   }
+}
+
+/* Get the length of a string value without measuring it */
+long Stringlength(struct Value *v)
+{  if(v->type==VTP_STRING && v->value.svalue)
+   {  return JSTRING(v->value.svalue)->length;
+   }
+   return 0;
 }
 
 /* Assign an object */
@@ -133,6 +272,7 @@ void Asgobject(struct Value *to,struct Jobject *jo)
    to->attr=0;
    to->value.obj.ovalue=jo;
    to->value.obj.fthis=NULL;
+   Writebarrier(to);
 }
 
 /* Assign a function */
@@ -142,6 +282,17 @@ void Asgfunction(struct Value *to,struct Jobject *f,struct Jobject *fthis)
    to->attr=0;
    to->value.obj.ovalue=f;
    to->value.obj.fthis=fthis;
+   Writebarrier(to);
+}
+
+/* Assign an object to a variable */
+void Asgvarobject(struct Variable *var,struct Jobject *jo)
+{  Clearvalue(&var->val);
+   var->val.type=VTP_OBJECT;
+   var->val.attr=0;
+   var->val.value.obj.ovalue=jo;
+   var->val.value.obj.fthis=NULL;
+   Varbarrier(var);
 }
 
 /* Make this value a string */
@@ -183,7 +334,7 @@ void Tostring(struct Value *v,struct Jcontext *jc)
          if(v->value.obj.ovalue && v->value.obj.ovalue->function)
          {  struct Jbuffer *jb;
             if(jb=Jdecompile(jc,(struct Element *)v->value.obj.ovalue->function))
-            {  Asgstring(v,jb->buffer,jc->pool);
+            {  Asgstringlen(v,jb->buffer?jb->buffer:(UBYTE *)"",jb->length,jc->pool);
                Freejbuffer(jb);
             }
             else
@@ -194,7 +345,7 @@ void Tostring(struct Value *v,struct Jcontext *jc)
          {  struct Jobject *oldthis;
 
             if(Callproperty(jc,v->value.obj.ovalue,"toString") && jc->val->type==VTP_STRING)
-            {  Asgstring(v,jc->val->value.svalue,jc->pool);
+            {  Asgvalue(v,jc->val);
             }
             else
             {  oldthis=jc->jthis;
@@ -370,16 +521,67 @@ void Disposevar(struct Variable *var)
 
 /*-----------------------------------------------------------------------*/
 
+/* Objects with more than a few properties get a hash index on the
+ * property names, chained through Variable.hnext. The properties list
+ * stays the owner of the variables and keeps enumeration order. */
+
+static ULONG Hashpropname(UBYTE *name)
+{  ULONG h=0;
+   if(name)
+   {  while(*name) h=h*31+*name++;
+   }
+   return h;
+}
+
+/* Link property into the hash index */
+static void Hashproperty(struct Jobject *jo,struct Variable *var)
+{  struct Variable **chain=&jo->hash[var->hash&(jo->hashsize-1)];
+   var->hnext=*chain;
+   *chain=var;
+}
+
+/* Unlink property from the hash index */
+static void Unhashproperty(struct Jobject *jo,struct Variable *var)
+{  struct Variable **chain;
+   if(jo->hash)
+   {  for(chain=&jo->hash[var->hash&(jo->hashsize-1)];*chain;chain=&(*chain)->hnext)
+      {  if(*chain==var)
+         {  *chain=var->hnext;
+            break;
+         }
+      }
+   }
+   var->hnext=NULL;
+}
+
+/* Rebuild the hash index with (size) chains. Returns FALSE and keeps
+ * the old index if there is no memory. */
+static BOOL Rehashobject(struct Jobject *jo,long size)
+{  struct Variable **hash,*var;
+   if(hash=ALLOCTYPE(struct Variable *,size,0,jo->jc->pool))
+   {  if(jo->hash) FREE(jo->hash);
+      jo->hash=hash;
+      jo->hashsize=size;
+      for(var=jo->properties.first;var->next;var=var->next)
+      {  Hashproperty(jo,var);
+      }
+      return TRUE;
+   }
+   return FALSE;
+}
+
 /* Create a new empty object */
 struct Jobject *Newobject(struct Jcontext *jc)
 {  struct Jobject *jo = NULL;
 
    /* test for and run a garbage collect */
    /* Do this before creating our object else it'll get swept away! */
-   if(jc->gc <= 0 && (jc->nogc<=0))
+   /* Contexts that only compile (jc->val not set) are never collected. */
+   if(jc->gc <= 0 && (jc->nogc<=0) && jc->val)
    {
-       jc->gc = GC_THRESHOLD;
-       Garbagecollect(jc);
+       if(jc->nursery<GC_THRESHOLD) jc->nursery=GC_THRESHOLD;
+       jc->gc = jc->nursery;
+       Gcstep(jc);
    }
 
    if(jo=ALLOCOBJECT(jc))
@@ -392,7 +594,12 @@ struct Jobject *Newobject(struct Jcontext *jc)
       }
 
       if(jc->nogc <= 0)jc->gc--;
-      AddTail((struct List *)&jc->objects,(struct Node *)jo);
+      jc->gcstats.allocated++;
+      if(jc->val)
+      {  jo->flags=OBJF_YOUNG;
+         AddTail((struct List *)&jc->young,(struct Node *)jo);
+      }
+      else AddTail((struct List *)&jc->objects,(struct Node *)jo);
    }
    //adebug("NEW OBJECT: %08lx\n",jo);
    return jo;
@@ -402,11 +609,17 @@ struct Jobject *Newobject(struct Jcontext *jc)
 void Disposeobject(struct Jobject *jo)
 {  struct Variable *var;
    if(jo)
-   {
+   {  propstamp++;
+      if(jo->flags&OBJF_GREY) Ungrey(jo->jc,jo);
+      if(jo->flags&OBJF_REMEMBERED) Forget(jo->jc,jo);
       while(var=(struct Variable *)RemHead((struct List *)&jo->properties))
       {
           Disposevar(var);
       }
+      if(jo->hash)
+      {  FREE(jo->hash);
+         jo->hash=NULL;
+      }
       if(jo->internal && jo->dispose)
       {
                                 jo->dispose(jo->internal);
@@ -426,6 +639,8 @@ void Clearobject(struct Jobject *jo,UBYTE **except)
    UBYTE **p;
    if(jo && !(jo->flags&OBJF_CLEARING))
    {  jo->flags|=OBJF_CLEARING;
+      jo->flags&=~OBJF_BUILTINS;
+      propstamp++;
       for(var=jo->properties.first;var->next;var=next)
       {  next=var->next;
          if(var->name && except)
@@ -437,6 +652,8 @@ void Clearobject(struct Jobject *jo,UBYTE **except)
          if(!p || !*p)
          {  /* not in exception list */
             Remove((struct Node *)var);
+            Unhashproperty(jo,var);
+            jo->nprops--;
 /*
             if(var->val.type==VTP_OBJECT && var->val.value.obj.ovalue)
             {  Clearobject(jo,NULL);
@@ -449,14 +666,23 @@ void Clearobject(struct Jobject *jo,UBYTE **except)
    }
 }
 
+/* Remove property (var) from its owner (jo) and dispose it */
+void Deletepropertyvar(struct Jobject *jo,struct Variable *var)
+{  Remove((struct Node *)var);
+   Unhashproperty(jo,var);
+   jo->nprops--;
+   Disposevar(var);
+   propstamp++;
+   jo->flags&=~OBJF_BUILTINS;
+}
+
 /* delete a property from this object */
 BOOL _Generic_Deleteownproperty(struct Jobject *jo, STRPTR name)
 {
     struct Variable *var;
     if((var = Getownproperty(jo,name)))
     {
-        Remove((struct Node *)var);
-        Disposevar(var);
+        Deletepropertyvar(jo,var);
         return TRUE;
     }
     return FALSE;
@@ -484,7 +710,17 @@ struct Variable *_Generic_Addproperty(struct Jobject *jo, STRPTR name)
 {  struct Variable *var=NULL;
    if(jo)
    {  if(var=Newvar(name,jo->jc))
-      {  AddTail((struct List *)&jo->properties,(struct Node *)var);
+      {  var->hash=Hashpropname(name);
+         var->owner=jo;
+         AddTail((struct List *)&jo->properties,(struct Node *)var);
+         jo->nprops++;
+         propstamp++;
+         if(!jo->hash)
+         {  if(jo->nprops>=PROPHASH_MIN) Rehashobject(jo,2*PROPHASH_MIN);
+         }
+         else if(jo->nprops<=2*jo->hashsize || !Rehashobject(jo,2*jo->hashsize))
+         {  Hashproperty(jo,var);
+         }
       }
    }
    return var;
@@ -515,9 +751,18 @@ struct Variable *Addproperty(struct Jobject *jo, STRPTR name)
 
 struct Variable *_Generic_Getownproperty(struct Jobject *jo, STRPTR name)
 {  struct Variable *var;
+   ULONG h;
    if(jo)
-   {  for(var=jo->properties.first;var && var->next;var=var->next)
-      {  if(STREQUAL(var->name,name)) return var;
+   {  if(jo->hash)
+      {  h=Hashpropname(name);
+         for(var=jo->hash[h&(jo->hashsize-1)];var;var=var->hnext)
+         {  if(var->hash==h && STREQUAL(var->name,name)) return var;
+         }
+      }
+      else
+      {  for(var=jo->properties.first;var && var->next;var=var->next)
+         {  if(STREQUAL(var->name,name)) return var;
+         }
       }
    }
    return NULL;
@@ -607,11 +852,14 @@ struct Variable *Getproperty(struct Jobject *jo, STRPTR name)
  * Change value must add/set it in all objects of this type */
 BOOL Protopropvhook(struct Varhookdata *h)
 {  BOOL result=FALSE;
-   struct Jobject *jo;
+   struct Jobject *jo,*lists[2];
    struct Variable *prop;
+   short i;
    switch(h->code)
    {  case VHC_SET:
-         for(jo=h->jc->objects.first;jo->next;jo=jo->next)
+         lists[0]=h->jc->objects.first;
+         lists[1]=h->jc->young.first;
+         for(i=0;i<2;i++) for(jo=lists[i];jo->next;jo=jo->next)
          {  if(jo->constructor==h->var->hookdata)
             {  if(!(prop=Getownproperty(jo,h->var->name)))
                {  prop=Addproperty(jo,h->var->name);
@@ -695,10 +943,13 @@ BOOL Callohook(struct Jobject *jo,struct Jcontext *jc,short code,UBYTE *name)
 }
 
 void Dumpobjects(struct Jcontext *jc)
-{  struct Jobject *jo;
+{  struct Jobject *jo,*lists[2];
    struct Variable *v;
+   short i;
    debug("=== JS object dump ===\n");
-   for(jo=jc->objects.first;jo->next;jo=jo->next)
+   lists[0]=jc->objects.first;
+   lists[1]=jc->young.first;
+   for(i=0;i<2;i++) for(jo=lists[i];jo->next;jo=jo->next)
    {  debug("%08lx :",jo);
       if(jo->constructor && jo->constructor->function && jo->constructor->function->name)
       {  debug("[%s] ",jo->constructor->function->name);
@@ -716,162 +967,337 @@ void Dumpobjects(struct Jcontext *jc)
 }
 
 /*-----------------------------------------------------------------------*/
-static int depth = 0;
 struct Array            /* Used as internal object value */
 {
     long length;            /* current array length of data*/
     struct Variable **array; /* pointer to current array */
     long array_length;       /* current length of storage */
+    struct Variable *lengthvar; /* the "length" property */
+    long nsparse;            /* number of elements kept as named properties */
 };
 
+/* The garbage collector is generational and incremental.
+ *
+ * New objects go in the nursery (jc->young). Every (jc->nursery) new objects
+ * the nursery is collected: objects reached from the roots, or stored into
+ * some value other than a root since they were created (see Gcwrite()), are
+ * promoted to jc->objects and the rest is disposed. A nursery collection
+ * only follows references between nursery objects, so its cost is
+ * proportional to the number of survivors.
+ *
+ * Old objects are collected by a mark that is done in steps, one after each
+ * nursery collection. Gcwrite() marks every object that is stored while the
+ * mark runs, so nothing reachable is missed when the program changes
+ * references in between. When the mark stack runs empty, the roots and the
+ * nursery are marked once more and unmarked old objects are swept. */
+
+typedef void Gcvisit(struct Jcontext *jc,struct Jobject *jo);
+
+/* Push an object on the mark stack */
+static BOOL Pushgrey(struct Jcontext *jc,struct Jobject *jo)
+{  struct Jobject **stack;
+   long size;
+   if(jc->gcsp>=jc->gcstacksize)
+   {  size=jc->gcstacksize?2*jc->gcstacksize:GC_SLICE;
+      if(!(stack=ALLOCTYPE(struct Jobject *,size,0,jc->pool))) return FALSE;
+      if(jc->gcsp) memmove(stack,jc->gcstack,jc->gcsp*sizeof(struct Jobject *));
+      if(jc->gcstack) FREE(jc->gcstack);
+      jc->gcstack=stack;
+      jc->gcstacksize=size;
+   }
+   jc->gcstack[jc->gcsp++]=jo;
+   return TRUE;
+}
 
-static void Garbagemark(struct Jobject *jo)
-{  struct Variable *v;
-   depth ++;
-   if(jo && !(jo->flags&OBJF_USED))
-   {  jo->flags|=OBJF_USED;
-             if(jo->notdisposed != TRUE)  //FALSE)
-             {
-                //adebug("attempt to mark disposed object %08lx %08lx %s\n",jo,jo->notdisposed,(jo->var && jo->var->name)?jo->var->name:"NULL");
-                // Dumpjobject(jo);
-                //adebug("marking constructor\n");
-             }
-      else
-      {
-          for(v=jo->properties.first;v && v->next;v=v->next)
-          {
+/* Visit the objects in a value */
+static void Visitvalue(struct Jcontext *jc,struct Value *v,Gcvisit *visit)
+{  if(v->type==VTP_OBJECT)
+   {  if(v->value.obj.ovalue) visit(jc,v->value.obj.ovalue);
+      if(v->value.obj.fthis) visit(jc,v->value.obj.fthis);
+   }
+}
 
-             if(v->val.type==VTP_OBJECT)
-             {
-                Garbagemark(v->val.value.obj.ovalue);
-                if(v->val.value.obj.fthis) Garbagemark(v->val.value.obj.fthis);
-             }
-          }
-          Garbagemark(jo->constructor);
-          if(jo->function)
-          {  Garbagemark(jo->function->fscope);
-          }
-          if(jo->type == OBJT_ARRAY)
-          {
-              if(jo->internal)
-              {
-                struct Array *a = jo->internal;
-                if(a->length && a->array_length)
-                {
-                    int i;
-
-                    for(i = 0; i< a->length && i < a->array_length;i++)
-                    {
-                        if(a->array && a->array[i])
-                        {
-                            if(a->array[i]->val.type == VTP_OBJECT)
-                            {
-                                Garbagemark(a->array[i]->val.value.obj.ovalue);
-                                if(a->array[i]->val.value.obj.fthis)
-                                Garbagemark(a->array[i]->val.value.obj.fthis);
-                            }
-                        }
-                    }
-                }
-              }
-          }
+/* Visit all objects referenced by this object */
+static void Visitchildren(struct Jcontext *jc,struct Jobject *jo,Gcvisit *visit)
+{  struct Variable *v;
+   struct Array *a;
+   long i;
+   if(jo->notdisposed!=TRUE) return;
+   for(v=jo->properties.first;v && v->next;v=v->next)
+   {  Visitvalue(jc,&v->val,visit);
+   }
+   if(jo->constructor) visit(jc,jo->constructor);
+   if(jo->function && jo->function->fscope)
+   {  visit(jc,jo->function->fscope);
+   }
+   if(jo->type==OBJT_ARRAY && (a=jo->internal) && a->array)
+   {  for(i=0;i<a->length && i<a->array_length;i++)
+      {  if(a->array[i]) Visitvalue(jc,&a->array[i]->val,visit);
       }
    }
-   depth--;
 }
 
-void Garbagecollect(struct Jcontext *jc)
-{  struct Jobject *jo,*jonext;
-   struct Function *f;
+/* Visit all objects referenced from outside the object lists, except
+ * those that are kept by Keepobject() */
+static void Visitroots(struct Jcontext *jc,Gcvisit *visit)
+{  struct Function *f;
    struct With *w;
    struct Variable *v;
-   struct List *objectlist;
-   struct List *jlist;
    struct This *this;
-   int scanned = 0;
-   objectlist = (struct List *)(&jc->objects);
+   struct Vmframe *vf;
+   long i;
+   if(jc->val) Visitvalue(jc,jc->val,visit);
+   if(jc->throwval) Visitvalue(jc,jc->throwval,visit);
+   for(vf=jc->vmframe;vf;vf=vf->prev)
+   {  for(i=0;i<vf->size;i++)
+      {  Visitvalue(jc,&vf->stack[i],visit);
+      }
+   }
+   if(jc->jthis) visit(jc,jc->jthis);
+   if(jc->fscope) visit(jc,jc->fscope);
+   for(this=jc->thislist.first;this && this->next;this=this->next)
+   {  if(this->this) visit(jc,this->this);
+   }
+   for(f=jc->functions.first;f && f->next;f=f->next)
+   {  if(f->arguments) visit(jc,f->arguments);
+      if(f->def) visit(jc,f->def);
+      if(f->fscope) visit(jc,f->fscope);
+      Visitvalue(jc,&f->retval,visit);
+      for(v=f->local.first;v->next;v=v->next)
+      {  Visitvalue(jc,&v->val,visit);
+      }
+      for(w=f->with.first;w->next;w=w->next)
+      {  if(w->jo) visit(jc,w->jo);
+      }
+   }
+}
 
-   jlist = (struct List *)(&jc->thislist);
+/* Mark an object for the full mark */
+static void Shadegrey(struct Jcontext *jc,struct Jobject *jo)
+{  if(!(jo->flags&OBJF_USED))
+   {  jo->flags|=OBJF_USED;
+      if(Pushgrey(jc,jo))
+      {  jo->flags|=OBJF_GREY;
+      }
+      else
+      {  /* No memory for the stack, scan it now */
+         Visitchildren(jc,jo,Shadegrey);
+      }
+   }
+}
 
-    for(jo=(struct Jobject *)objectlist->lh_Head;jo && jo->next;jo=(struct Jobject *)jo->next)
-    {  jo->flags&=~OBJF_USED;
-       scanned ++;
-    }
+/* Mark a nursery object for the nursery collection */
+static void Shadelive(struct Jcontext *jc,struct Jobject *jo)
+{  if((jo->flags&(OBJF_YOUNG|OBJF_LIVE))==OBJF_YOUNG)
+   {  jo->flags|=OBJF_LIVE;
+      if(!Pushgrey(jc,jo))
+      {  Visitchildren(jc,jo,Shadelive);
+      }
+   }
+}
 
-    /* No point garbage collecting if no objects in list */
-   if(scanned > 0)
-   {
-       if(jc->val && jc->val->type == VTP_OBJECT)
-       {
-          if(jc->val->value.obj.ovalue)Garbagemark(jc->val->value.obj.ovalue);
-          if(jc->val->value.obj.fthis)Garbagemark(jc->val->value.obj.fthis);
+/* Remove an object from the mark stack */
+static void Ungrey(struct Jcontext *jc,struct Jobject *jo)
+{  long i;
+   for(i=jc->gcsp-1;i>=0;i--)
+   {  if(jc->gcstack[i]==jo)
+      {  jc->gcstack[i]=jc->gcstack[--jc->gcsp];
+         break;
+      }
+   }
+   jo->flags&=~OBJF_GREY;
+}
 
-       }
-       if(jc->throwval && jc->throwval->type == VTP_OBJECT)
-       {
-          if(jc->throwval->value.obj.ovalue)Garbagemark(jc->throwval->value.obj.ovalue);
-          if(jc->throwval->value.obj.fthis)Garbagemark(jc->throwval->value.obj.fthis);
+/* Remove an object from the remembered set */
+static void Forget(struct Jcontext *jc,struct Jobject *jo)
+{  long i;
+   for(i=jc->gcnremember-1;i>=0;i--)
+   {  if(jc->gcremember[i]==jo)
+      {  jc->gcremember[i]=jc->gcremember[--jc->gcnremember];
+         break;
+      }
+   }
+   jo->flags&=~OBJF_REMEMBERED;
+}
 
-       }
+/* Empty the remembered set */
+static void Forgetall(struct Jcontext *jc)
+{  while(jc->gcnremember)
+   {  jc->gcremember[--jc->gcnremember]->flags&=~OBJF_REMEMBERED;
+   }
+}
 
-       if(jc->jthis)
-       {
-           jc->jthis->flags &=~OBJF_USED;
-           Garbagemark(jc->jthis);
-       }
-       if(jc->fscope)
-       {
-           jc->fscope->flags &=~OBJF_USED;
-           Garbagemark(jc->fscope);
-       }
-       for(this=(struct This *)jlist->lh_Head;this && this->next;this=(struct This *)this->next)
-       {
-           this->this->flags &=~OBJF_USED;
-           Garbagemark(this->this);
-       }
+/* Scan objects from the mark stack. A (budget) below 0 empties the stack. */
+static void Markstep(struct Jcontext *jc,long budget)
+{  struct Jobject *jo;
+   while(jc->gcsp && budget--)
+   {  jo=jc->gcstack[--jc->gcsp];
+      jo->flags&=~OBJF_GREY;
+      Visitchildren(jc,jo,Shadegrey);
+   }
+}
 
-       for(jo=(struct Jobject *)objectlist->lh_Head;jo && jo->next;jo=(struct Jobject *)jo->next)
-       {
-           if(jo->keepnr > 0) Garbagemark(jo);
-       }
+/* Start a full mark */
+static void Startmark(struct Jcontext *jc)
+{  struct Jobject *jo;
+   jc->gcphase=GCP_MARK;
+   jc->gcpromoted=0;
+   for(jo=jc->objects.first;jo->next;jo=jo->next)
+   {  jo->flags&=~OBJF_USED;
+   }
+   for(jo=jc->objects.first;jo->next;jo=jo->next)
+   {  if(jo->keepnr>0) Shadegrey(jc,jo);
+   }
+   Visitroots(jc,Shadegrey);
+}
 
-       for(f=jc->functions.first;f->next;f=f->next)
-       {
+/* Complete the full mark and sweep the old generation */
+static void Finishmark(struct Jcontext *jc)
+{  struct Jobject *jo,*next;
+   long live=0;
+   /* References may have moved to the roots or to new objects since the
+    * mark started, so these are marked again. */
+   Visitroots(jc,Shadegrey);
+   for(jo=jc->young.first;jo->next;jo=jo->next)
+   {  Shadegrey(jc,jo);
+   }
+   Markstep(jc,-1);
+   /* Temporary objects (see Exedot()) are not swept while a program
+    * is running, it may still refer to them. */
+   for(jo=jc->objects.first;jo->next;jo=next)
+   {  next=jo->next;
+      if(jo->flags&OBJF_USED)
+      {  jo->flags&=~OBJF_USED;
+         live++;
+      }
+      else if(jc->rundepth && (jo->flags&OBJF_TEMP))
+      {  live++;
+      }
+      else
+      {  REMOVE(jo);
+         Disposeobject(jo);
+         jc->gcstats.oldfreed++;
+      }
+   }
+   for(jo=jc->young.first;jo->next;jo=jo->next)
+   {  jo->flags&=~OBJF_USED;
+   }
+   jc->gcphase=GCP_IDLE;
+   jc->gcpromoted=0;
+   /* Let the old generation double before marking it again */
+   jc->gclimit=(live>GC_MAJORMIN)?live:GC_MAJORMIN;
+   jc->gcstats.major++;
+}
+
+/* Abandon a running full mark */
+static void Abandonmark(struct Jcontext *jc)
+{  while(jc->gcsp)
+   {  jc->gcstack[--jc->gcsp]->flags&=~OBJF_GREY;
+   }
+   jc->gcphase=GCP_IDLE;
+}
+
+/* Collect the nursery. Returns the number of promoted objects. */
+static long Collectnursery(struct Jcontext *jc)
+{  struct Jobject *jo,*next;
+   long base=jc->gcsp,nyoung=0,nlive=0,i;
+   for(jo=jc->young.first;jo->next;jo=jo->next)
+   {  if(jo->keepnr>0 || (jo->flags&OBJF_ESCAPED)) Shadelive(jc,jo);
+   }
+   for(i=0;i<jc->gcnremember;i++)
+   {  Visitchildren(jc,jc->gcremember[i],Shadelive);
+   }
+   Forgetall(jc);
+   Visitroots(jc,Shadelive);
+   while(jc->gcsp>base)
+   {  jo=jc->gcstack[--jc->gcsp];
+      Visitchildren(jc,jo,Shadelive);
+   }
+   for(jo=jc->young.first;jo->next;jo=next)
+   {  next=jo->next;
+      nyoung++;
+      if((jo->flags&OBJF_LIVE) || (jc->rundepth && (jo->flags&OBJF_TEMP)))
+      {  REMOVE(jo);
+         jo->flags&=~(OBJF_YOUNG|OBJF_ESCAPED|OBJF_LIVE);
+         ADDTAIL(&jc->objects,jo);
+         /* A running mark has to see the objects it didn't know about */
+         if(jc->gcphase==GCP_MARK) Shadegrey(jc,jo);
+         nlive++;
+      }
+      else
+      {  REMOVE(jo);
+         Disposeobject(jo);
+      }
+   }
+   /* Give objects more time to die when many survive */
+   if(2*nlive>nyoung && jc->nursery<GC_NURSERYMAX) jc->nursery*=2;
+   else if(8*nlive<nyoung && jc->nursery>GC_THRESHOLD) jc->nursery/=2;
+   jc->gcpromoted+=nlive;
+   jc->gcstats.minor++;
+   jc->gcstats.youngfreed+=nyoung-nlive;
+   jc->gcstats.promoted+=nlive;
+   return nlive;
+}
 
-          Garbagemark(f->arguments);
+/* Add the time since (start) to the pause statistics */
+static void Gcpause(struct Jcontext *jc,unsigned int *start)
+{  unsigned int clock[2]={ 0,0 };
+   ULONG us;
+   timer(clock);
+   us=(clock[0]-start[0])*1000000+clock[1]-start[1];
+   jc->gcstats.pauses++;
+   jc->gcstats.pausemicros+=us;
+   jc->gcstats.pausesecs+=jc->gcstats.pausemicros/1000000;
+   jc->gcstats.pausemicros%=1000000;
+   if(us>jc->gcstats.maxpause) jc->gcstats.maxpause=us;
+}
 
-          Garbagemark(f->def);
+/* Collect the nursery and do a step of the full mark */
+static void Gcstep(struct Jcontext *jc)
+{  unsigned int clock[2]={ 0,0 };
+   long promoted;
+   timer(clock);
+   promoted=Collectnursery(jc);
+   if(jc->gcphase==GCP_IDLE && jc->gcpromoted>=jc->gclimit)
+   {  Startmark(jc);
+   }
+   if(jc->gcphase==GCP_MARK)
+   {  /* Scan faster than objects are promoted, so the mark completes */
+      Markstep(jc,GC_SLICE+2*promoted);
+      jc->gcstats.slices++;
+      if(!jc->gcsp) Finishmark(jc);
+   }
+   Gcpause(jc,clock);
+}
 
-          Garbagemark(f->fscope);
+/* Write barrier. Must be called when a reference to (jo) is stored anywhere
+ * but in the roots, Asgvalue() and friends do this. */
+void Gcwrite(struct Jobject *jo)
+{  if(jo->flags&OBJF_YOUNG) jo->flags|=OBJF_ESCAPED;
+   if(jo->jc->gcphase==GCP_MARK) Shadegrey(jo->jc,jo);
+}
 
-          if(f->retval.type==VTP_OBJECT)
-          {  Garbagemark(f->retval.value.obj.ovalue);
-             if(f->retval.value.obj.fthis) Garbagemark(f->retval.value.obj.fthis);
-          }
-          for(v=f->local.first;v->next;v=v->next)
-          {  if(v->val.type==VTP_OBJECT)
-             {
-                Garbagemark(v->val.value.obj.ovalue);
-                if(v->val.value.obj.fthis) Garbagemark(v->val.value.obj.fthis);
-             }
-          }
-          for(w=f->with.first;w->next;w=w->next)
-          {  Garbagemark(w->jo);
-          }
-       }
-       for(jo=(struct Jobject *)objectlist->lh_Head;jo && jo->next;jo=jonext)
-       {  jonext=(struct Jobject *)jo->next;
-          if(!(jo->flags&OBJF_USED))
-          {
-             Remove((struct Node *)jo);
-             Disposeobject(jo);
-          }
-       }
+/* Do a full collection now */
+void Garbagecollect(struct Jcontext *jc)
+{  unsigned int clock[2]={ 0,0 };
+   struct Jobject *jo;
+   timer(clock);
+   Abandonmark(jc);
+   Forgetall(jc);
+   while(jo=REMHEAD(&jc->young))
+   {  jo->flags&=~(OBJF_YOUNG|OBJF_ESCAPED|OBJF_LIVE);
+      ADDTAIL(&jc->objects,jo);
    }
+   Startmark(jc);
+   Finishmark(jc);
+   Gcpause(jc,clock);
 }
 
 void Keepobject(struct Jobject *jo,BOOL used)
 {  if(!jo) return;
-   if(used) jo->keepnr++;
+   if(used)
+   {  jo->keepnr++;
+      if(jo->jc->gcphase==GCP_MARK) Shadegrey(jo->jc,jo);
+   }
    else if(jo->keepnr) jo->keepnr--;
 }
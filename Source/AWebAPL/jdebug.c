@@ -478,9 +478,12 @@ static void Debugdump(struct Jcontext *jc)
    struct Value val;
    struct Variable *varref;
    UWORD flags,dflags;
-   struct Jobject *jo;
+   struct Jobject *jo,*lists[2];
    struct Function *f;
+   struct Gcstats *gs=&jc->gcstats;
    UWORD d;
+   short i;
+   ULONG ms;
    UBYTE *sep="---------------------------------------------------";
    struct FileRequester *fr;
    static UBYTE filename[256]="T:JSDump";
@@ -512,7 +515,9 @@ static void Debugdump(struct Jcontext *jc)
    jc->dflags&=~(DEBF_DEBUG|DEBF_DBREAK);
    jc->flags&=~EXF_ERRORS;
    if(fh=Open(filename,MODE_NEWFILE))
-   {  for(jo=jc->objects.first;jo->next;jo=jo->next)
+   {  lists[0]=jc->objects.first;
+      lists[1]=jc->young.first;
+      for(i=0;i<2;i++) for(jo=lists[i];jo->next;jo=jo->next)
       {  jo->dumpnr=0;
       }
       dumpnr=0;
@@ -539,12 +544,26 @@ static void Debugdump(struct Jcontext *jc)
       }
       FPrintf(fh,"\n%s\nReferenced objects\n%s\n",sep,sep);
       for(d=1;d<=dumpnr;d++)
-      {  for(jo=jc->objects.first;jo->next;jo=jo->next)
+      {  for(i=0;i<2;i++) for(jo=lists[i];jo->next;jo=jo->next)
          {  if(jo->dumpnr==d)
             {  Debugdumpobject(fh,jc,jo);
             }
          }
       }
+      ms=gs->pausesecs*1000+gs->pausemicros/1000;
+      FPrintf(fh,"\n%s\nGarbage collector\n%s\n",sep,sep);
+      FPrintf(fh,"    Objects created     %ld\n",gs->allocated);
+      FPrintf(fh,"    Nursery collections %ld, %ld objects swept, %ld promoted\n",
+         gs->minor,gs->youngfreed,gs->promoted);
+      FPrintf(fh,"    Full marks          %ld in %ld steps, %ld objects swept%s\n",
+         gs->major,gs->slices,gs->oldfreed,(jc->gcphase==GCP_MARK)?" (marking)":"");
+      FPrintf(fh,"    Nursery size        %ld\n",jc->nursery);
+      FPrintf(fh,"    Pause time          %ld ms total, %ld us longest, %ld us average\n",
+         ms,gs->maxpause,gs->pauses?(gs->pausesecs*1000000+gs->pausemicros)/gs->pauses:0);
+      if(ms)
+      {  FPrintf(fh,"    Throughput          %ld objects swept per second\n",
+            (ms>=1000)?(gs->youngfreed+gs->oldfreed)/(ms/1000):(gs->youngfreed+gs->oldfreed)*1000/ms);
+      }
       Close(fh);
    }
    else
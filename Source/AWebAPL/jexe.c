@@ -112,13 +112,14 @@ static struct Variable *Addvar(void *vlist,UBYTE *name,struct Jcontext *jc)
 {  struct Variable *var=Newvar(name,jc);
    if(var)
    {  ADDTAIL(vlist,var);
+      var->flags|=VARF_LOCAL;
    }
    return var;
 }
 
 /* Find a variable in the current scope. Create a global one if not found. 
  * *(pthis) is set to object from with stack */
-static struct Variable *Findvar(struct Jcontext *jc,UBYTE *name,struct Jobject **pthis)
+struct Variable *Findvar(struct Jcontext *jc,UBYTE *name,struct Jobject **pthis)
 {  struct Variable *var;
    struct With *w;
    struct Function *f;
@@ -166,7 +167,7 @@ static struct Variable *Findvar(struct Jcontext *jc,UBYTE *name,struct Jobject *
 
 /* Find a local variable. Create a new one if not found.
  * Falls back to global variables if not within function scope. */
-static struct Variable *Findlocalvar(struct Jcontext *jc,UBYTE *name)
+struct Variable *Findlocalvar(struct Jcontext *jc,UBYTE *name)
 {  struct Variable *var;
    if(jc->functions.first->next->next)
    {  /* Within function scope */
@@ -442,26 +443,39 @@ static void Isnan(struct Jcontext *jc)
    Asgboolean(RETVAL(jc),nan);
 }
 
-static BOOL Member(struct Jcontext *jc,struct Element *elt,struct Jobject *jo,
-   UBYTE *mbrname,BOOL asgonly)
+/* Get a member of an object. (pc) is an optional lookup cache; it is only
+ * used while the property stamp is unchanged. */
+BOOL Member(struct Jcontext *jc,struct Element *elt,struct Jobject *jo,
+   UBYTE *mbrname,BOOL asgonly,struct Propcache *pc)
 {  struct Variable *mbr;
    BOOL ok=FALSE;
    if(!jo)
    {  Runtimeerror(jc,NTE_TYPE,elt,"Cannot access property of null or undefined");
       return FALSE;
    }
-   if(!asgonly)
-   {  mbr=Getproperty(jo,mbrname);
+   if(pc && pc->jo==jo && pc->stamp==propstamp
+   && (pc->name==mbrname || (pc->var->name && STREQUAL(pc->var->name,mbrname))))
+   {  mbr=pc->var;
    }
    else
-   {  mbr=Getownproperty(jo,mbrname);
-   }
-   if(!mbr)
-   {  if(Callohook(jo,jc,OHC_ADDPROPERTY,mbrname))
-      {  mbr=Getownproperty(jo,mbrname);
+   {  if(!asgonly)
+      {  mbr=Getproperty(jo,mbrname);
       }
       else
-      {  mbr=Addproperty(jo,mbrname);
+      {  mbr=Getownproperty(jo,mbrname);
+      }
+      if(!mbr)
+      {  if(Callohook(jo,jc,OHC_ADDPROPERTY,mbrname))
+         {  mbr=Getownproperty(jo,mbrname);
+         }
+         else
+         {  mbr=Addproperty(jo,mbrname);
+         }
+      }
+      if(pc && mbr)
+      {  pc->jo=jo;
+         pc->var=mbr;
+         pc->stamp=propstamp;
       }
    }
    if(mbr)
@@ -502,6 +516,7 @@ static void Exeprogram(struct Jcontext *jc,struct Elementlist *elist)
 {  struct Elementnode *enode,*enext;
    struct Element *elt;
    long generation=jc->generation;
+   BOOL keep=BOOLVAL(jc->flags&JCF_KEEPPROGRAM);
    for(enode=elist->subs.first;enode->next;enode=enext)
    {  enext=enode->next;
       elt=enode->sub;
@@ -511,6 +526,8 @@ static void Exeprogram(struct Jcontext *jc,struct Elementlist *elist)
          if(jc->functions.first->next->next && jc->complete) break;
       }
    }
+   /* A cached program is kept for the next run */
+   if(keep) return;
    /* Finally, dispose all statements for this generation */
    for(enode=elist->subs.first;enode->next;enode=enext)
    {  enext=enode->next;
@@ -567,14 +584,15 @@ void Callfunctionargs(struct Jcontext *jc,struct Elementfunc *func,struct Jobjec
       while((val=va_arg(args,struct Value *)))
       {  if(var=Newvar(NULL,jc))
          {  ADDTAIL(&f->local,var);
-            Asgvalue(&var->val,val);
+            var->flags|=VARF_LOCAL;
+            Asgvarvalue(var,val);
          }
       }
       va_end(args);
       va_start(args,jthis);
       while((val=va_arg(args,struct Value *)))
       {  if(var=Addarrayelt(jc,f->arguments))
-         {  Asgvalue(&var->val,val);
+         {  Asgvarvalue(var,val);
          }
       }
       va_end(args);
@@ -591,18 +609,49 @@ void Callfunctionargs(struct Jcontext *jc,struct Elementfunc *func,struct Jobjec
    }
 }
 
+/* Run (func) for function (f), whose local variables hold the actual
+ * parameters. Puts (f) on the function stack and disposes it afterwards. */
+static void Invokefunction(struct Jcontext *jc,struct Function *f,
+   struct Elementfunc *func,struct Jobject *jthis,BOOL construct)
+{  struct Variable *arg,*argv;
+   struct Jobject *oldthis;
+   struct This *tnode;
+   /* Create the arguments array */
+   for(argv=f->local.first;argv->next;argv=argv->next)
+   {  if(arg=Addarrayelt(jc,f->arguments))
+      {  Asgvarvalue(arg,&argv->val);
+      }
+   }
+   ADDHEAD(&jc->functions,f);
+   oldthis=jc->jthis;
+   jc->jthis=jthis;
+   if((tnode = ALLOCSTRUCT(This,1,MEMF_CLEAR,jc->pool)))
+   {
+      tnode->this = oldthis;
+      ADDHEAD(&jc->thislist,tnode);
+   }
+   if(construct) jc->flags|=EXF_CONSTRUCT;
+   Executeelem(jc,func);
+   jc->jthis=oldthis;
+   if(tnode)
+   {
+      REMOVE(tnode);
+      FREE(tnode);
+   }
+   REMOVE(f);
+   Disposefunction(f);
+}
+
 /* Call this function with this object as "this" */
 static void Callfunction(struct Jcontext *jc,struct Elementlist *elist,
    struct Jobject *jthis,BOOL construct)
 {  struct Elementnode *enode;
    struct Elementfunc *func=NULL;
    struct Function *f;
-   struct Variable *arg,*argv;
-   struct Jobject *oldthis,*fdef;
+   struct Variable *arg;
+   struct Jobject *fdef;
    UWORD oldflags;
 
-   struct This *tnode = NULL;;
-
    if(!Stackcheck(jc,(struct Element *)elist)) return;
    Executeelem(jc,(struct Element *)elist->subs.first->sub);
    Tofunction(jc->val,jc);
@@ -639,31 +688,8 @@ static void Callfunction(struct Jcontext *jc,struct Elementlist *elist,
                Asgvalue(&arg->val,jc->val);
             }
          }
-         /* Create the arguments array n*/
-         for(argv=f->local.first;argv->next;argv=argv->next)
-         {  if(arg=Addarrayelt(jc,f->arguments))
-            {  Asgvalue(&arg->val,&argv->val);
-            }
-         }
-         ADDHEAD(&jc->functions,f);
-         oldthis=jc->jthis;
-         jc->jthis=jthis;
-         if((tnode = ALLOCSTRUCT(This,1,MEMF_CLEAR,jc->pool)))
-         {
-            tnode->this = oldthis;
-            ADDHEAD(&jc->thislist,tnode);
-         }
-         if(construct) jc->flags|=EXF_CONSTRUCT;
-         Executeelem(jc,func);
-         jc->jthis=oldthis;
-         if(tnode)
-         {
-            REMOVE(tnode);
-            FREE(tnode);
-         }
+         Invokefunction(jc,f,func,jthis,construct);
          jc->flags=oldflags;
-         REMOVE(f);
-         Disposefunction(f);
       }
    }
    else if(jc->val->value.obj.ovalue && (jc->val->value.obj.ovalue->flags&OBJF_ASFUNCTION))
@@ -678,7 +704,7 @@ static void Callfunction(struct Jcontext *jc,struct Elementlist *elist,
          Executeelem(jc,enode->sub);
          Asgvalue(&sval,jc->val);
          Tostring(&sval,jc);
-         ok=Member(jc,(struct Element *)elist,val.value.obj.ovalue,sval.value.svalue,FALSE);
+         ok=Member(jc,(struct Element *)elist,val.value.obj.ovalue,sval.value.svalue,FALSE,NULL);
          Clearvalue(&val);
          if(!ok) Clearvalue(jc->val);
          Clearvalue(&sval);
@@ -692,6 +718,55 @@ static void Callfunction(struct Jcontext *jc,struct Elementlist *elist,
    }
 }
 
+/* Call the function in (fval) with (argc) evaluated arguments in (argv).
+ * Used by the bytecode machine; (elt) is the call element for errors. */
+void Callvalues(struct Jcontext *jc,struct Element *elt,struct Value *fval,
+   struct Value *argv,long argc,struct Jobject *jthis)
+{  struct Elementfunc *func=NULL;
+   struct Function *f;
+   struct Variable *arg;
+   struct Jobject *fdef=NULL;
+   UWORD oldflags;
+   long i;
+   if(!Stackcheck(jc,elt)) return;
+   Tofunction(fval,jc);
+   if(fval->value.obj.ovalue)
+   {  func=fval->value.obj.ovalue->function;
+      fdef=fval->value.obj.ovalue;
+   }
+   if(fval->value.obj.fthis)
+   {  jthis=fval->value.obj.fthis;
+   }
+   if(func)
+   {  if(f=Newfunction(jc,func))
+      {  f->def=fdef;
+         oldflags=jc->flags;
+         jc->flags&=~EXF_CONSTRUCT;
+         for(i=0;i<argc;i++)
+         {  if(arg=Newvar(NULL,jc))
+            {  ADDTAIL(&f->local,arg);
+               arg->flags|=VARF_LOCAL;
+               Asgvarvalue(arg,&argv[i]);
+            }
+         }
+         Invokefunction(jc,f,func,jthis,FALSE);
+         jc->flags=oldflags;
+      }
+   }
+   else if(fdef && (fdef->flags&OBJF_ASFUNCTION) && argc>0)
+   {  /* Same as the OBJF_ASFUNCTION case in Callfunction() */
+      struct Value sval;
+      sval.type=0;
+      Asgvalue(&sval,&argv[0]);
+      Tostring(&sval,jc);
+      if(!Member(jc,elt,fdef,sval.value.svalue,FALSE,NULL)) Clearvalue(jc->val);
+      Clearvalue(&sval);
+   }
+   else
+   {  Runtimeerror(jc,NTE_TYPE,elt,emsg_nofunction);
+   }
+}
+
 static void Execall(struct Jcontext *jc,struct Elementlist *elist)
 {  Callfunction(jc,elist,jc->jthis,FALSE);
 }
@@ -732,6 +807,7 @@ static void Exefunction(struct Jcontext *jc,struct Elementfunc *func)
       {  if(var->name) FREE(var->name);
          var->name=Jdupstr(arg->svalue,-1,jc->pool);
       }
+      var->flags|=VARF_LOCAL;
    }
    /* Add empty local variables for unassigned formal parameters */
    for(;enode && enode->next;enode=enode->next)
@@ -739,6 +815,7 @@ static void Exefunction(struct Jcontext *jc,struct Elementfunc *func)
       if(arg && arg->type==ET_IDENTIFIER)
       {  if(var=Newvar(arg->svalue,jc))
          {  ADDTAIL(&f->local,var);
+            var->flags|=VARF_LOCAL;
          }
       }
    }
@@ -746,25 +823,25 @@ static void Exefunction(struct Jcontext *jc,struct Elementfunc *func)
     * and to the function object .arguments property */
    if(var=Newvar("arguments",jc))
    {  ADDTAIL(&f->local,var);
-      Asgobject(&var->val,f->arguments);
-      var->flags |= VARF_DONTDELETE;
+      var->flags |= VARF_DONTDELETE|VARF_LOCAL;
+      Asgvarobject(var,f->arguments);
    }
    if((avar=Getownproperty(f->def,"arguments"))
    || (avar=Addproperty(f->def,"arguments")))
-   {  Asgobject(&avar->val,f->arguments);
+   {  Asgvarobject(avar,f->arguments);
       avar->flags |= VARF_DONTDELETE;
    }
    /* Link the caller to a variable */
    if(var=Newvar("caller",jc))
    {  ADDTAIL(&f->local,var);
       Asgobject(&var->val,f->next->def);
-      var->flags |= VARF_DONTDELETE;
+      var->flags |= VARF_DONTDELETE|VARF_LOCAL;
    }
    /* Create function call object */
    if(var=Newvar(func->name,jc))
    {  ADDTAIL(&f->local,var);
       Asgfunction(&var->val,f->def,NULL);
-      var->flags |= VARF_DONTDELETE;
+      var->flags |= VARF_DONTDELETE|VARF_LOCAL;
    }
    /* Set function.length property if not already set */
    if(f->def)
@@ -862,49 +939,68 @@ static void Exenull(struct Jcontext *jc,struct Element *elt)
 {  Asgobject(jc->val,NULL);
 }
 
-static void Exenegative(struct Jcontext *jc,struct Element *elt)
-{  double n;
-   UBYTE v;
-   Executeelem(jc,elt->sub1);
-   Tonumber(jc->val,jc);
-   switch(jc->val->attr)
-   {  case VNA_VALID:
-         n=-jc->val->value.nvalue;
-         v=VNA_VALID;
+/* Unary operators, applied to (v) in place */
+void Unaryop(struct Jcontext *jc,UWORD type,struct Value *v)
+{  double n=0.0;
+   UBYTE a;
+   UBYTE *tp;
+   switch(type)
+   {  case ET_NEGATIVE:
+         Tonumber(v,jc);
+         switch(v->attr)
+         {  case VNA_VALID:
+               n=-v->value.nvalue;
+               a=VNA_VALID;
+               break;
+            case VNA_INFINITY:
+               a=VNA_NEGINFINITY;
+               break;
+            case VNA_NEGINFINITY:
+               a=VNA_INFINITY;
+               break;
+            default:
+               a=VNA_NAN;
+               break;
+         }
+         Asgnumber(v,a,n);
          break;
-      case VNA_INFINITY:
-         v=VNA_NEGINFINITY;
+      case ET_POSITIVE:
+         Tonumber(v,jc);
          break;
-      case VNA_NEGINFINITY:
-         v=VNA_INFINITY;
+      case ET_NOT:
+         Toboolean(v,jc);
+         Asgboolean(v,!v->value.bvalue);
          break;
-      default:
-         v=VNA_NAN;
+      case ET_BITNEG:
+         Tonumber(v,jc);
+         if(v->attr==VNA_VALID)
+         {  n=(double)~((long)v->value.nvalue);
+         }
+         Asgnumber(v,VNA_VALID,n);
+         break;
+      case ET_TYPEOF:
+         switch(v->type)
+         {  case VTP_NUMBER:  tp="number";break;
+            case VTP_BOOLEAN: tp="boolean";break;
+            case VTP_STRING:  tp="string";break;
+            case VTP_OBJECT:
+               if(v->value.obj.ovalue && v->value.obj.ovalue->function)
+               {  tp="function";
+               }
+               else
+               {  tp="object";
+               }
+               break;
+            default:          tp="undefined";break;
+         }
+         Asgstring(v,tp,jc->pool);
          break;
    }
-   Asgnumber(jc->val,v,n);      
 }
 
-static void Exepositive(struct Jcontext *jc,struct Element *elt)
+static void Exeunary(struct Jcontext *jc,struct Element *elt)
 {  Executeelem(jc,elt->sub1);
-   Tonumber(jc->val,jc);
-}
-
-static void Exenot(struct Jcontext *jc,struct Element *elt)
-{  Executeelem(jc,elt->sub1);
-   Toboolean(jc->val,jc);
-   Asgboolean(jc->val,!jc->val->value.bvalue);
-}
-
-static void Exebitneg(struct Jcontext *jc,struct Element *elt)
-{
-   LONG n=0;
-   Executeelem(jc,elt->sub1);
-   Tonumber(jc->val,jc);
-   if(jc->val->attr==VNA_VALID)
-   {  n=~((long)jc->val->value.nvalue);
-   }
-   Asgnumber(jc->val,VNA_VALID,(double)n);
+   Unaryop(jc,elt->type,jc->val);
 }
 
 static void Exepreinc(struct Jcontext *jc,struct Element *elt)
@@ -1004,8 +1100,21 @@ static void Exedelete(struct Jcontext *jc,struct Element *elt)
    {
        if(!(rhs->flags & VARF_DONTDELETE))
        {
-           REMOVE(rhs);
-           Disposevar(rhs);
+           /* A property must leave its owner's hash index too, and an
+            * array element its owner's vector */
+           if(rhs->owner)
+           {
+               if(!Deletearrayelt(rhs->owner,rhs))
+               {
+                   Deletepropertyvar(rhs->owner,rhs);
+               }
+           }
+           else
+           {
+               REMOVE(rhs);
+               Disposevar(rhs);
+               propstamp++;
+           }
            result = TRUE;
        }
        else
@@ -1016,26 +1125,6 @@ static void Exedelete(struct Jcontext *jc,struct Element *elt)
    Asgboolean(jc->val,result);
 }
 
-static void Exetypeof(struct Jcontext *jc,struct Element *elt)
-{  UBYTE *tp;
-   Executeelem(jc,elt->sub1);
-   switch(jc->val->type)
-   {  case VTP_NUMBER:  tp="number";break;
-      case VTP_BOOLEAN: tp="boolean";break;
-      case VTP_STRING:  tp="string";break;
-      case VTP_OBJECT:
-         if(jc->val->value.obj.ovalue && jc->val->value.obj.ovalue->function)
-         {  tp="function";
-         }
-         else
-         {  tp="object";
-         }
-         break;
-      default:          tp="undefined";break;
-   }
-   Asgstring(jc->val,tp,jc->pool);
-}
-
 static void Exevoid(struct Jcontext *jc,struct Element *elt)
 {  Executeelem(jc,elt->sub1);
    Clearvalue(jc->val);
@@ -1085,7 +1174,12 @@ static void Execase(struct Jcontext *jc,struct Elementcase *elt)
    }
 }
 
-static void Exeplus(struct Jcontext *jc,struct Element *elt)
+/* Binary operators. The operators work on two evaluated values and leave
+ * their result in jc->val; the operand values may be converted in place.
+ * Exebinary() evaluates the operand elements for the tree executor, the
+ * bytecode machine calls Binaryop() directly. */
+
+static void Plusvalues(struct Jcontext *jc,struct Value *val1,struct Value *val2)
 {  static UBYTE attrtab[4][4]=
    {/* a+b   valid            nan      +inf              -inf */
    /*valid*/ {VNA_VALID,       VNA_NAN, VNA_INFINITY,     VNA_NEGINFINITY},
@@ -1093,102 +1187,63 @@ static void Exeplus(struct Jcontext *jc,struct Element *elt)
    /* +inf*/ {VNA_INFINITY,    VNA_NAN, VNA_INFINITY,     VNA_NAN},
    /* -inf*/ {VNA_NEGINFINITY, VNA_NAN, VNA_NAN,          VNA_NEGINFINITY}
    };
-   struct Value val1,val2;
-   struct Variable *lhs;
    BOOL concat=FALSE;
-   val1.type=val2.type=0;
-   Executeelem(jc,elt->sub1);
-   lhs=jc->varref;
-   Asgvalue(&val1,jc->val);
-   Executeelem(jc,elt->sub2);
-   Asgvalue(&val2,jc->val);
    /* If object, see if it string-convertible */
-   if(val1.type==VTP_OBJECT && val1.value.obj.ovalue && !val1.value.obj.ovalue->function)
-   {  if(!Callproperty(jc,val1.value.obj.ovalue,"valueOf") || jc->val->type>=VTP_STRING)
+   if(val1->type==VTP_OBJECT && val1->value.obj.ovalue && !val1->value.obj.ovalue->function)
+   {  if(!Callproperty(jc,val1->value.obj.ovalue,"valueOf") || jc->val->type>=VTP_STRING)
       {  /* Not number-convertible */
          concat=TRUE;
       }
    }
-   else if(val1.type>=VTP_STRING)
+   else if(val1->type>=VTP_STRING)
    {  concat=TRUE;
    }
-   if(!concat && val2.type==VTP_OBJECT && val2.value.obj.ovalue && !val2.value.obj.ovalue->function)
-   {  if(!Callproperty(jc,val2.value.obj.ovalue,"valueOf") || jc->val->type>=VTP_STRING)
+   if(!concat && val2->type==VTP_OBJECT && val2->value.obj.ovalue && !val2->value.obj.ovalue->function)
+   {  if(!Callproperty(jc,val2->value.obj.ovalue,"valueOf") || jc->val->type>=VTP_STRING)
       {  /* Not number-convertible */
          concat=TRUE;
       }
    }
-   else if(val2.type>=VTP_STRING)
+   else if(val2->type>=VTP_STRING)
    {  concat=TRUE;
    }
    if(concat)
    {  /* Do string concatenation */
-      long l;
-      UBYTE *s;
-      Tostring(&val1,jc);
-      Tostring(&val2,jc);
+      Tostring(val1,jc);
+      Tostring(val2,jc);
       /* Ensure both values are strings with valid pointers after conversion */
-      if(val1.type==VTP_STRING && val1.value.svalue && val2.type==VTP_STRING && val2.value.svalue)
-      {  l=strlen(val1.value.svalue)+strlen(val2.value.svalue);
-         if(s=ALLOCTYPE(UBYTE,l+1,0,jc->pool))
-         {  strcpy(s,val1.value.svalue);
-            strcat(s,val2.value.svalue);
-            Asgstring(jc->val,s,jc->pool);
-            FREE(s);
-         }
-         else
-         {  /* Memory allocation failed - use empty string */
-            Asgstring(jc->val,"",jc->pool);
-         }
+      if(val1->type!=VTP_STRING || !val1->value.svalue)
+      {  Asgstring(val1,"",jc->pool);
       }
-      else
-      {  /* One or both values failed to convert or have NULL pointers */
-         /* Try to ensure strings are valid - if Tostring didn't set them, set to empty */
-         if(val1.type!=VTP_STRING || !val1.value.svalue)
-         {  Asgstring(&val1,"",jc->pool);
-         }
-         if(val2.type!=VTP_STRING || !val2.value.svalue)
-         {  Asgstring(&val2,"",jc->pool);
-         }
-         l=strlen(val1.value.svalue)+strlen(val2.value.svalue);
-         if(s=ALLOCTYPE(UBYTE,l+1,0,jc->pool))
-         {  strcpy(s,val1.value.svalue);
-            strcat(s,val2.value.svalue);
-            Asgstring(jc->val,s,jc->pool);
-            FREE(s);
-         }
-         else
-         {  Asgstring(jc->val,"",jc->pool);
-         }
+      if(val2->type!=VTP_STRING || !val2->value.svalue)
+      {  Asgstring(val2,"",jc->pool);
       }
+      /* Extend the left operand and hand it over as the result. A temporary
+       * left operand (as in a+b+c) is extended without copying. */
+      Appendstring(val1,val2->value.svalue,Stringlength(val2),jc->pool);
+      Clearvalue(jc->val);
+      *jc->val=*val1;
+      val1->type=VTP_UNDEFINED;
    }
    else
    {  /* Do numeric addition */
       double n=0.0;
       UBYTE v;
-      Tonumber(&val1,jc);
-      Tonumber(&val2,jc);
-      if((v=attrtab[val1.attr][val2.attr])==VNA_VALID)
+      Tonumber(val1,jc);
+      Tonumber(val2,jc);
+      if((v=attrtab[val1->attr][val2->attr])==VNA_VALID)
       {
-         n = val1.value.nvalue +val2.value.nvalue;
+         n = val1->value.nvalue +val2->value.nvalue;
          if (isinf(n))
          {
-            v = val1.value.nvalue>0 ? VNA_INFINITY : VNA_NEGINFINITY;
+            v = val1->value.nvalue>0 ? VNA_INFINITY : VNA_NEGINFINITY;
          }
       }
       Asgnumber(jc->val,v,n);
    }
-   Clearvalue(&val1);
-   Clearvalue(&val2);
-   if(elt->type==ET_APLUS && lhs)
-   {  if(!Callvhook(lhs,jc,VHC_SET,jc->val))
-      {  Asgvalue(&lhs->val,jc->val);
-         lhs->flags&=~VARF_HIDDEN;
-      }
-   }
 }
 
-static void Exeminus(struct Jcontext *jc,struct Element *elt)
+static void Minusvalues(struct Jcontext *jc,struct Value *val1,struct Value *val2)
 {  static UBYTE attrtab[4][4]=
    {/* a-b   valid            nan      +inf              -inf */
    /*valid*/ {VNA_VALID,       VNA_NAN, VNA_NEGINFINITY,  VNA_INFINITY},
@@ -1196,63 +1251,38 @@ static void Exeminus(struct Jcontext *jc,struct Element *elt)
    /* +inf*/ {VNA_INFINITY,    VNA_NAN, VNA_NAN,          VNA_INFINITY},
    /* -inf*/ {VNA_NEGINFINITY, VNA_NAN, VNA_NEGINFINITY,  VNA_NAN},
    };
-   struct Value val1,val2;
-   struct Variable *lhs;
    double n=0.0;
    UBYTE v;
-   val1.type=val2.type=0;
-   Executeelem(jc,elt->sub1);
-   lhs=jc->varref;
-   Tonumber(jc->val,jc);
-   Asgvalue(&val1,jc->val);
-   Executeelem(jc,elt->sub2);
-   Tonumber(jc->val,jc);
-   Asgvalue(&val2,jc->val);
-
-   if((v=attrtab[val1.attr][val2.attr])==VNA_VALID)
+   Tonumber(val1,jc);
+   Tonumber(val2,jc);
+   if((v=attrtab[val1->attr][val2->attr])==VNA_VALID)
    {
-      n = val1.value.nvalue - val2.value.nvalue;
+      n = val1->value.nvalue - val2->value.nvalue;
       if(isinf(n))
       {
-         if(val1.value.nvalue>0) v=VNA_INFINITY;
+         if(val1->value.nvalue>0) v=VNA_INFINITY;
          else v=VNA_NEGINFINITY;
       }
    }
    Asgnumber(jc->val,v,n);
-   Clearvalue(&val1);
-   Clearvalue(&val2);
-   if(elt->type==ET_AMINUS && lhs)
-   {  if(!Callvhook(lhs,jc,VHC_SET,jc->val))
-      {  Asgvalue(&lhs->val,jc->val);
-         lhs->flags&=~VARF_HIDDEN;
-      }
-   }
 }
 
 #define FSIGN(d) (((d)>0.0)?1:(((d)<0.0)?-1:0))
 
-static void Exemult(struct Jcontext *jc,struct Element *elt)
-{  struct Value val1,val2;
-   struct Variable *lhs;
-   double n=0.0;
+static void Multvalues(struct Jcontext *jc,struct Value *val1,struct Value *val2)
+{  double n=0.0;
    UBYTE v;
    short sign=0;
-   val1.type=val2.type=0;
-   Executeelem(jc,elt->sub1);
-   lhs=jc->varref;
-   Tonumber(jc->val,jc);
-   Asgvalue(&val1,jc->val);
-   Executeelem(jc,elt->sub2);
-   Tonumber(jc->val,jc);
-   Asgvalue(&val2,jc->val);
-   if(val1.attr==VNA_NAN || val2.attr==VNA_NAN)
+   Tonumber(val1,jc);
+   Tonumber(val2,jc);
+   if(val1->attr==VNA_NAN || val2->attr==VNA_NAN)
    {  v=VNA_NAN;
    }
    else
-   {  sign=FSIGN(val1.value.nvalue)*FSIGN(val2.value.nvalue);
-      if(val1.attr==VNA_VALID && val2.attr==VNA_VALID)
+   {  sign=FSIGN(val1->value.nvalue)*FSIGN(val2->value.nvalue);
+      if(val1->attr==VNA_VALID && val2->attr==VNA_VALID)
       {
-         n = val1.value.nvalue * val2.value.nvalue;
+         n = val1->value.nvalue * val2->value.nvalue;
          if(isinf(n))
          {  v = (sign>0) ? VNA_INFINITY : VNA_NEGINFINITY;
          }
@@ -1272,38 +1302,22 @@ static void Exemult(struct Jcontext *jc,struct Element *elt)
       }
    }
    Asgnumber(jc->val,v,n);
-   Clearvalue(&val1);
-   Clearvalue(&val2);
-   if(elt->type==ET_AMULT && lhs)
-   {  if(!Callvhook(lhs,jc,VHC_SET,jc->val))
-      {  Asgvalue(&lhs->val,jc->val);
-         lhs->flags&=~VARF_HIDDEN;
-      }
-   }
 }
 
-static void Exediv(struct Jcontext *jc,struct Element *elt)
-{  struct Value val1,val2;
-   struct Variable *lhs;
-   double n=0.0;
+static void Divvalues(struct Jcontext *jc,struct Value *val1,struct Value *val2)
+{  double n=0.0;
    UBYTE v;
    short sign=0;
-   val1.type=val2.type=0;
-   Executeelem(jc,elt->sub1);
-   lhs=jc->varref;
-   Tonumber(jc->val,jc);
-   Asgvalue(&val1,jc->val);
-   Executeelem(jc,elt->sub2);
-   Tonumber(jc->val,jc);
-   Asgvalue(&val2,jc->val);
-   if(val1.attr==VNA_NAN || val2.attr==VNA_NAN)
+   Tonumber(val1,jc);
+   Tonumber(val2,jc);
+   if(val1->attr==VNA_NAN || val2->attr==VNA_NAN)
    {  v=VNA_NAN;
    }
    else
-   {  sign=FSIGN(val1.value.nvalue)*FSIGN(val2.value.nvalue);
-      if(val1.attr==VNA_VALID)
-      {  if(val1.value.nvalue==0.0)
-         {  if(val2.value.nvalue==0.0)
+   {  sign=FSIGN(val1->value.nvalue)*FSIGN(val2->value.nvalue);
+      if(val1->attr==VNA_VALID)
+      {  if(val1->value.nvalue==0.0)
+         {  if(val2->value.nvalue==0.0)
             {  /* 0/0 */
                v=VNA_NAN;
             }
@@ -1314,15 +1328,15 @@ static void Exediv(struct Jcontext *jc,struct Element *elt)
             }
          }
          else
-         {  if(val2.attr==VNA_VALID)
-            {  if(val2.value.nvalue==0.0)
+         {  if(val2->attr==VNA_VALID)
+            {  if(val2->value.nvalue==0.0)
                {  /* n/0 */
-                  if(FSIGN(val1.value.nvalue)>0) v=VNA_INFINITY;
+                  if(FSIGN(val1->value.nvalue)>0) v=VNA_INFINITY;
                   else v=VNA_NEGINFINITY;
                }
                else
                {  /* n/n */
-                  n = val1.value.nvalue / val2.value.nvalue;
+                  n = val1->value.nvalue / val2->value.nvalue;
                   if(isinf(n))
                   {  n=0.0;
                      v=VNA_VALID;
@@ -1343,10 +1357,10 @@ static void Exediv(struct Jcontext *jc,struct Element *elt)
          }
       }
       else
-      {  if(val2.attr==VNA_VALID)
-         {  if(val2.value.nvalue==0.0)
+      {  if(val2->attr==VNA_VALID)
+         {  if(val2->value.nvalue==0.0)
             {  /* i/0 */
-               v=val1.attr;
+               v=val1->attr;
             }
             else
             {  /* i/n */
@@ -1360,256 +1374,103 @@ static void Exediv(struct Jcontext *jc,struct Element *elt)
       }
    }
    Asgnumber(jc->val,v,n);
-   Clearvalue(&val1);
-   Clearvalue(&val2);
-   if(elt->type==ET_ADIV && lhs)
-   {  if(!Callvhook(lhs,jc,VHC_SET,jc->val))
-      {  Asgvalue(&lhs->val,jc->val);
-         lhs->flags&=~VARF_HIDDEN;
-      }
-   }
 }
 
-static void Exerem(struct Jcontext *jc,struct Element *elt)
-{  struct Value val1,val2;
-   struct Variable *lhs;
-   double n=0.0;
+static void Remvalues(struct Jcontext *jc,struct Value *val1,struct Value *val2)
+{  double n=0.0;
    UBYTE v;
-   val1.type=val2.type=0;
-   Executeelem(jc,elt->sub1);
-   lhs=jc->varref;
-   Tonumber(jc->val,jc);
-   Asgvalue(&val1,jc->val);
-   Executeelem(jc,elt->sub2);
-   Tonumber(jc->val,jc);
-   Asgvalue(&val2,jc->val);
-   if(val1.attr==VNA_NAN || val2.attr==VNA_NAN)
+   Tonumber(val1,jc);
+   Tonumber(val2,jc);
+   if(val1->attr==VNA_NAN || val2->attr==VNA_NAN)
    {  v=VNA_NAN;
    }
    else
-   {  if(val1.attr!=VNA_VALID || val2.value.nvalue==0.0)
+   {  if(val1->attr!=VNA_VALID || val2->value.nvalue==0.0)
       {  v=VNA_NAN;
       }
-      else if(val2.attr!=VNA_VALID || val1.value.nvalue==0.0)
-      {  n=val1.value.nvalue;
+      else if(val2->attr!=VNA_VALID || val1->value.nvalue==0.0)
+      {  n=val1->value.nvalue;
          v=VNA_VALID;
       }
       else
-      {  n=fmod(val1.value.nvalue,val2.value.nvalue);
+      {  n=fmod(val1->value.nvalue,val2->value.nvalue);
          v=VNA_VALID;
       }
    }
    Asgnumber(jc->val,v,n);
-   Clearvalue(&val1);
-   Clearvalue(&val2);
-   if(elt->type==ET_AREM && lhs)
-   {  if(!Callvhook(lhs,jc,VHC_SET,jc->val))
-      {  Asgvalue(&lhs->val,jc->val);
-         lhs->flags&=~VARF_HIDDEN;
-      }
-   }
 }
 
-static void Exebitand(struct Jcontext *jc,struct Element *elt)
-{  struct Value val1,val2;
-   struct Variable *lhs;
-   ULONG n=0;
-   val1.type=val2.type=0;
-   Executeelem(jc,elt->sub1);
-   lhs=jc->varref;
-   Tonumber(jc->val,jc);
-   Asgvalue(&val1,jc->val);
-   Executeelem(jc,elt->sub2);
-   Tonumber(jc->val,jc);
-   Asgvalue(&val2,jc->val);
-   if(val1.attr==VNA_VALID && val2.attr==VNA_VALID)
-   {  n=((ULONG)val1.value.nvalue) & ((ULONG)val2.value.nvalue);
-   }
-   Asgnumber(jc->val,VNA_VALID,(double)n);
-   Clearvalue(&val1);
-   Clearvalue(&val2);
-   if(elt->type==ET_ABITAND && lhs)
-   {  if(!Callvhook(lhs,jc,VHC_SET,jc->val))
-      {  Asgvalue(&lhs->val,jc->val);
-         lhs->flags&=~VARF_HIDDEN;
-      }
-   }
-}
-
-static void Exebitor(struct Jcontext *jc,struct Element *elt)
-{  struct Value val1,val2;
-   struct Variable *lhs;
-   ULONG n=0;
-   val1.type=val2.type=0;
-   Executeelem(jc,elt->sub1);
-   lhs=jc->varref;
-   Tonumber(jc->val,jc);
-   Asgvalue(&val1,jc->val);
-   Executeelem(jc,elt->sub2);
-   Tonumber(jc->val,jc);
-   Asgvalue(&val2,jc->val);
-   if(val1.attr==VNA_VALID && val2.attr==VNA_VALID)
-   {  n=((ULONG)val1.value.nvalue) | ((ULONG)val2.value.nvalue);
-   }
-   Asgnumber(jc->val,VNA_VALID,(double)n);
-   Clearvalue(&val1);
-   Clearvalue(&val2);
-   if(elt->type==ET_ABITOR && lhs)
-   {  if(!Callvhook(lhs,jc,VHC_SET,jc->val))
-      {  Asgvalue(&lhs->val,jc->val);
-         lhs->flags&=~VARF_HIDDEN;
-      }
-   }
-}
-
-static void Exebitxor(struct Jcontext *jc,struct Element *elt)
-{  struct Value val1,val2;
-   struct Variable *lhs;
-   ULONG n=0;
-   val1.type=val2.type=0;
-   Executeelem(jc,elt->sub1);
-   lhs=jc->varref;
-   Tonumber(jc->val,jc);
-   Asgvalue(&val1,jc->val);
-   Executeelem(jc,elt->sub2);
-   Tonumber(jc->val,jc);
-   Asgvalue(&val2,jc->val);
-   if(val1.attr==VNA_VALID && val2.attr==VNA_VALID)
-   {  n=((ULONG)val1.value.nvalue) ^ ((ULONG)val2.value.nvalue);
-   }
-   Asgnumber(jc->val,VNA_VALID,(double)n);
-   Clearvalue(&val1);
-   Clearvalue(&val2);
-   if(elt->type==ET_ABITXOR && lhs)
-   {  if(!Callvhook(lhs,jc,VHC_SET,jc->val))
-      {  Asgvalue(&lhs->val,jc->val);
-         lhs->flags&=~VARF_HIDDEN;
-      }
-   }
-}
-
-static void Exeshleft(struct Jcontext *jc,struct Element *elt)
-{  struct Value val1,val2;
-   struct Variable *lhs;
-   ULONG n;
-   val1.type=val2.type=0;
-   Executeelem(jc,elt->sub1);
-   lhs=jc->varref;
-   Tonumber(jc->val,jc);
-   Asgvalue(&val1,jc->val);
-   Executeelem(jc,elt->sub2);
-   Tonumber(jc->val,jc);
-   Asgvalue(&val2,jc->val);
-      if(val1.attr==VNA_VALID && val2.attr==VNA_VALID)
-   {  n=((ULONG)val1.value.nvalue) << (((ULONG)val2.value.nvalue)&0x1f);
-   }
-   Asgnumber(jc->val,VNA_VALID,(double)n);
-   Clearvalue(&val1);
-   Clearvalue(&val2);
-   if(elt->type==ET_ASHLEFT && lhs)
-   {  if(!Callvhook(lhs,jc,VHC_SET,jc->val))
-      {  Asgvalue(&lhs->val,jc->val);
-         lhs->flags&=~VARF_HIDDEN;
-      }
-   }
-}
-
-static void Exeshright(struct Jcontext *jc,struct Element *elt)
-{  struct Value val1,val2;
-   struct Variable *lhs;
-   ULONG n;
-   val1.type=val2.type=0;
-   Executeelem(jc,elt->sub1);
-   lhs=jc->varref;
-   Tonumber(jc->val,jc);
-   Asgvalue(&val1,jc->val);
-   Executeelem(jc,elt->sub2);
-   Tonumber(jc->val,jc);
-   Asgvalue(&val2,jc->val);
-      if(val1.attr==VNA_VALID && val2.attr==VNA_VALID)
-   {  n=((long)val1.value.nvalue) >> (((ULONG)val2.value.nvalue)&0x1f);
-   }
-   Asgnumber(jc->val,VNA_VALID,(double)n);
-   Clearvalue(&val1);
-   Clearvalue(&val2);
-   if(elt->type==ET_ASHRIGHT && lhs)
-   {  if(!Callvhook(lhs,jc,VHC_SET,jc->val))
-      {  Asgvalue(&lhs->val,jc->val);
-         lhs->flags&=~VARF_HIDDEN;
+static void Bitwisevalues(struct Jcontext *jc,UWORD type,struct Value *val1,struct Value *val2)
+{  ULONG n=0;
+   Tonumber(val1,jc);
+   Tonumber(val2,jc);
+   if(val1->attr==VNA_VALID && val2->attr==VNA_VALID)
+   {  switch(type)
+      {  case ET_BITAND:
+         case ET_ABITAND:
+            n=((ULONG)val1->value.nvalue) & ((ULONG)val2->value.nvalue);
+            break;
+         case ET_BITOR:
+         case ET_ABITOR:
+            n=((ULONG)val1->value.nvalue) | ((ULONG)val2->value.nvalue);
+            break;
+         case ET_BITXOR:
+         case ET_ABITXOR:
+            n=((ULONG)val1->value.nvalue) ^ ((ULONG)val2->value.nvalue);
+            break;
+         case ET_SHLEFT:
+         case ET_ASHLEFT:
+            n=((ULONG)val1->value.nvalue) << (((ULONG)val2->value.nvalue)&0x1f);
+            break;
+         case ET_SHRIGHT:
+         case ET_ASHRIGHT:
+            n=((long)val1->value.nvalue) >> (((ULONG)val2->value.nvalue)&0x1f);
+            break;
+         case ET_USHRIGHT:
+         case ET_AUSHRIGHT:
+            n=((ULONG)(long)val1->value.nvalue) >> (((ULONG)val2->value.nvalue)&0x1f);
+            break;
       }
    }
-}
-
-static void Exeushright(struct Jcontext *jc,struct Element *elt)
-{  struct Value val1,val2;
-   struct Variable *lhs;
-   ULONG n;
-   val1.type=val2.type=0;
-   Executeelem(jc,elt->sub1);
-   lhs=jc->varref;
-   Tonumber(jc->val,jc);
-   Asgvalue(&val1,jc->val);
-   Executeelem(jc,elt->sub2);
-   Tonumber(jc->val,jc);
-   Asgvalue(&val2,jc->val);
-      if(val1.attr==VNA_VALID && val2.attr==VNA_VALID)
-   {  n=((ULONG)(long)val1.value.nvalue) >> (((ULONG)val2.value.nvalue)&0x1f);
-   }
    Asgnumber(jc->val,VNA_VALID,(double)n);
-   Clearvalue(&val1);
-   Clearvalue(&val2);
-   if(elt->type==ET_AUSHRIGHT && lhs)
-   {  if(!Callvhook(lhs,jc,VHC_SET,jc->val))
-      {  Asgvalue(&lhs->val,jc->val);
-         lhs->flags&=~VARF_HIDDEN;
-      }
-   }
 }
 
-static void Exeequality(struct Jcontext *jc,struct Element *elt)
-{  struct Value val1,val2;
-   BOOL b;
-   val1.type=val2.type=0;
-   Executeelem(jc,elt->sub1);
-   Asgvalue(&val1,jc->val);
-   Executeelem(jc,elt->sub2);
-   Asgvalue(&val2,jc->val);
-   if(val1.type==VTP_OBJECT && val2.type==VTP_OBJECT)
+static void Equalityvalues(struct Jcontext *jc,UWORD type,struct Value *val1,struct Value *val2)
+{  BOOL b;
+   if(val1->type==VTP_OBJECT && val2->type==VTP_OBJECT)
    {  /* Reference comparison */
-      b=(BOOL)(val1.value.obj.ovalue==val2.value.obj.ovalue);
+      b=(BOOL)(val1->value.obj.ovalue==val2->value.obj.ovalue);
    }
-   else if(val1.type==VTP_OBJECT && !val1.value.obj.ovalue)
-   {  Toobject(&val2,jc);
-      b=!val2.value.obj.ovalue;
+   else if(val1->type==VTP_OBJECT && !val1->value.obj.ovalue)
+   {  Toobject(val2,jc);
+      b=!val2->value.obj.ovalue;
    }
-   else if(val2.type==VTP_OBJECT && !val2.value.obj.ovalue)
-   {  Toobject(&val1,jc);
-      b=!val1.value.obj.ovalue;
+   else if(val2->type==VTP_OBJECT && !val2->value.obj.ovalue)
+   {  Toobject(val1,jc);
+      b=!val1->value.obj.ovalue;
    }
-   else if(val1.type>=VTP_STRING || val2.type>=VTP_STRING)
+   else if(val1->type>=VTP_STRING || val2->type>=VTP_STRING)
    {  /* String comparison */
-      Tostring(&val1,jc);
-      Tostring(&val2,jc);
-      b=!strcmp(val1.value.svalue,val2.value.svalue);
+      Tostring(val1,jc);
+      Tostring(val2,jc);
+      b=!strcmp(val1->value.svalue,val2->value.svalue);
    }
    else
    {  /* Numeric comparison */
-      Tonumber(&val1,jc);
-      Tonumber(&val2,jc);
-      if(val1.attr==VNA_NAN || val2.attr==VNA_NAN)
+      Tonumber(val1,jc);
+      Tonumber(val2,jc);
+      if(val1->attr==VNA_NAN || val2->attr==VNA_NAN)
       {  b=FALSE; /* NaN != NaN */
       }
-      else if(val1.attr==VNA_VALID && val2.attr==VNA_VALID)
-      {  b=(val1.value.nvalue==val2.value.nvalue);
+      else if(val1->attr==VNA_VALID && val2->attr==VNA_VALID)
+      {  b=(val1->value.nvalue==val2->value.nvalue);
       }
       else
-      {  b=(val1.attr==val2.attr);
+      {  b=(val1->attr==val2->attr);
       }
    }
-   if(elt->type==ET_NE) b=!b;
+   if(type==ET_NE) b=!b;
    Asgboolean(jc->val,b);
-   Clearvalue(&val1);
-   Clearvalue(&val2);
 }
 
 BOOL Exactequality(struct Jcontext *jc, struct Value *val1, struct Value *val2)
@@ -1647,62 +1508,41 @@ BOOL Exactequality(struct Jcontext *jc, struct Value *val1, struct Value *val2)
    return b;
 }
 
-static void Exeexactequality(struct Jcontext *jc,struct Element *elt)
-{  struct Value val1,val2;
-   BOOL b;
-   val1.type=val2.type=0;
-   Executeelem(jc,elt->sub1);
-   Asgvalue(&val1,jc->val);
-   Executeelem(jc,elt->sub2);
-   Asgvalue(&val2,jc->val);
-   b = Exactequality(jc,&val1,&val2);
-   if(elt->type==ET_NEXEQ) b=!b;
-   Asgboolean(jc->val,b);
-   Clearvalue(&val1);
-   Clearvalue(&val2);
-}
-
-static void Exerelational(struct Jcontext *jc,struct Element *elt)
-{  struct Value val1,val2;
-   double dc;
+static void Relationalvalues(struct Jcontext *jc,UWORD type,struct Value *val1,struct Value *val2)
+{  double dc;
    long c;
    BOOL b,gotb=FALSE;
-   val1.type=val2.type=0;
-   Executeelem(jc,elt->sub1);
-   Asgvalue(&val1,jc->val);
-   Executeelem(jc,elt->sub2);
-   Asgvalue(&val2,jc->val);
    /* NS 3 heuristic: if either value is numeric, convert both to numeric */
-   if(val1.type==VTP_NUMBER || val2.type==VTP_NUMBER)
-   {  Tonumber(&val1,jc);
-      Tonumber(&val2,jc);
+   if(val1->type==VTP_NUMBER || val2->type==VTP_NUMBER)
+   {  Tonumber(val1,jc);
+      Tonumber(val2,jc);
    }
-   if(val1.type>=VTP_STRING || val2.type>=VTP_STRING)
+   if(val1->type>=VTP_STRING || val2->type>=VTP_STRING)
    {  /* String comparison */
-      Tostring(&val1,jc);
-      Tostring(&val2,jc);
-      c=strcmp(val1.value.svalue,val2.value.svalue);
+      Tostring(val1,jc);
+      Tostring(val2,jc);
+      c=strcmp(val1->value.svalue,val2->value.svalue);
    }
    else
    {  /* Numeric comparison */
-      Tonumber(&val1,jc);
-      Tonumber(&val2,jc);
-      if(val1.attr==VNA_NAN || val2.attr==VNA_NAN)
+      Tonumber(val1,jc);
+      Tonumber(val2,jc);
+      if(val1->attr==VNA_NAN || val2->attr==VNA_NAN)
       {  b=FALSE;
          gotb=TRUE;
       }
       else
-      {  if(val1.attr==VNA_VALID && val2.attr==VNA_VALID)
-         {  dc=val1.value.nvalue-val2.value.nvalue;
+      {  if(val1->attr==VNA_VALID && val2->attr==VNA_VALID)
+         {  dc=val1->value.nvalue-val2->value.nvalue;
             if(dc>0) c=1;
             else if(dc<0) c=-1;
             else c=0;
          }
-         else if(val1.attr==val2.attr)
+         else if(val1->attr==val2->attr)
          {  /* both i with same sign */
             c=0;
          }
-         else if(val1.attr==VNA_INFINITY)
+         else if(val1->attr==VNA_INFINITY)
          {  /* i > -1 */
             c=1;
          }
@@ -1713,7 +1553,7 @@ static void Exerelational(struct Jcontext *jc,struct Element *elt)
       }
    }
    if(!gotb)
-   {  switch(elt->type)
+   {  switch(type)
       {  case ET_LT: b=(c<0);break;
          case ET_GT: b=(c>0);break;
          case ET_LE: b=(c<=0);break;
@@ -1721,8 +1561,108 @@ static void Exerelational(struct Jcontext *jc,struct Element *elt)
       }
    }
    Asgboolean(jc->val,b);
+}
+
+/* Apply binary operator (type) to two values, leave the result in jc->val */
+void Binaryop(struct Jcontext *jc,UWORD type,struct Value *val1,struct Value *val2)
+{  switch(type)
+   {  case ET_PLUS:
+      case ET_APLUS:
+         Plusvalues(jc,val1,val2);
+         break;
+      case ET_MINUS:
+      case ET_AMINUS:
+         Minusvalues(jc,val1,val2);
+         break;
+      case ET_MULT:
+      case ET_AMULT:
+         Multvalues(jc,val1,val2);
+         break;
+      case ET_DIV:
+      case ET_ADIV:
+         Divvalues(jc,val1,val2);
+         break;
+      case ET_REM:
+      case ET_AREM:
+         Remvalues(jc,val1,val2);
+         break;
+      case ET_EQ:
+      case ET_NE:
+         Equalityvalues(jc,type,val1,val2);
+         break;
+      case ET_EXEQ:
+         Asgboolean(jc->val,Exactequality(jc,val1,val2));
+         break;
+      case ET_NEXEQ:
+         Asgboolean(jc->val,!Exactequality(jc,val1,val2));
+         break;
+      case ET_LT:
+      case ET_GT:
+      case ET_LE:
+      case ET_GE:
+         Relationalvalues(jc,type,val1,val2);
+         break;
+      default:
+         Bitwisevalues(jc,type,val1,val2);
+         break;
+   }
+}
+
+/* s+=x for a string variable: append to the variable's own buffer instead
+ * of building a new string. (val1) is the value read from (lhs). Returns
+ * FALSE if this doesn't apply. */
+BOOL Appendvar(struct Jcontext *jc,struct Variable *lhs,struct Value *val1,struct Value *val2)
+{  if(lhs && !lhs->hook && lhs->val.type==VTP_STRING
+   && val1->type==VTP_STRING && lhs->val.value.svalue==val1->value.svalue)
+   {  Tostring(val2,jc);
+      if(val2->type!=VTP_STRING || !val2->value.svalue)
+      {  Asgstring(val2,"",jc->pool);
+      }
+      /* Drop our own reference so the buffer can be extended in place,
+       * then share the result. */
+      Clearvalue(val1);
+      Appendstring(&lhs->val,val2->value.svalue,Stringlength(val2),jc->pool);
+      lhs->flags&=~VARF_HIDDEN;
+      Asgvalue(jc->val,&lhs->val);
+      return TRUE;
+   }
+   return FALSE;
+}
+
+/* Evaluate the operands and apply the operator. Arithmetic operands are
+ * converted to number as soon as they are evaluated. Assignment operators
+ * store the result in the left hand side. */
+static void Exebinary(struct Jcontext *jc,struct Element *elt,BOOL arithmetic)
+{  struct Value val1,val2;
+   struct Variable *lhs;
+   val1.type=val2.type=0;
+   Executeelem(jc,elt->sub1);
+   lhs=jc->varref;
+   Asgvalue(&val1,jc->val);
+   if(arithmetic) Tonumber(&val1,jc);
+   Executeelem(jc,elt->sub2);
+   Asgvalue(&val2,jc->val);
+   if(elt->type==ET_APLUS && Appendvar(jc,lhs,&val1,&val2))
+   {  Clearvalue(&val2);
+      return;
+   }
+   Binaryop(jc,elt->type,&val1,&val2);
    Clearvalue(&val1);
    Clearvalue(&val2);
+   if(elt->type>=ET_APLUS && elt->type<=ET_AUSHRIGHT && lhs)
+   {  if(!Callvhook(lhs,jc,VHC_SET,jc->val))
+      {  Asgvarvalue(lhs,jc->val);
+         lhs->flags&=~VARF_HIDDEN;
+      }
+   }
+}
+
+static void Exeoperator(struct Jcontext *jc,struct Element *elt)
+{  Exebinary(jc,elt,FALSE);
+}
+
+static void Exearithmetic(struct Jcontext *jc,struct Element *elt)
+{  Exebinary(jc,elt,TRUE);
 }
 
 static void Exeand(struct Jcontext *jc,struct Element *elt)
@@ -1765,7 +1705,7 @@ static void Exeassign(struct Jcontext *jc,struct Element *elt)
    if(lhs)
    {  Executeelem(jc,elt->sub2);
       if(!Callvhook(lhs,jc,VHC_SET,jc->val))
-      {  Asgvalue(&lhs->val,jc->val);
+      {  Asgvarvalue(lhs,jc->val);
          lhs->flags&=~VARF_HIDDEN;
       }
    }
@@ -1945,7 +1885,7 @@ static void Exedot(struct Jcontext *jc,struct Element *elt)
    if(mbrname && mbrname->type==ET_IDENTIFIER && jc->val->value.obj.ovalue)
    {
        jo = jc->val->value.obj.ovalue;
-       ok=Member(jc,elt,jo,mbrname->svalue,asgonly);
+       ok=Member(jc,elt,jo,mbrname->svalue,asgonly,NULL);
    }
    if(!ok) Clearvalue(jc->val);
 }
@@ -1966,7 +1906,7 @@ static void Exeindex(struct Jcontext *jc,struct Element *elt)
    Asgvalue(&sval,jc->val);
    Tostring(&sval,jc);
    if(val.value.obj.ovalue)
-   {  ok=Member(jc,elt,val.value.obj.ovalue,sval.value.svalue,FALSE);
+   {  ok=Member(jc,elt,val.value.obj.ovalue,sval.value.svalue,FALSE,NULL);
    }
    Clearvalue(&val);
    if(!ok) Clearvalue(jc->val);
@@ -1981,7 +1921,7 @@ static void Exevar(struct Jcontext *jc,struct Element *elt)
       if(var)
       {  if(elt->sub2)
          {  Executeelem(jc,elt->sub2);
-            Asgvalue(&var->val,jc->val);
+            Asgvarvalue(var,jc->val);
          }
          var->flags |= VARF_DONTDELETE;
          jc->varref=var;
@@ -2023,8 +1963,11 @@ static void Exeforin(struct Jcontext *jc,struct Element *elt)
       {  Executeelem(jc,elt->sub2);  /* Specs say must be evaluated for each iteration */
          Toobject(jc->val,jc);
          if(jo=jc->val->value.obj.ovalue)
-         {  for(var=jo->properties.first,i=0;var->next && i<n;var=var->next,i++);
-            if(!var->next) break;
+         {  /* Array elements in the vector come first, then the properties */
+            if(!(var=Enumarrayelt(jo,n,&i)))
+            {  for(var=jo->properties.first;var->next && i<n;var=var->next,i++);
+               if(!var->next) break;
+            }
             if(var->name && !(var->flags&VARF_HIDDEN))
             {  Asgstring(&lhs->val,var->name,jc->pool);
                lhs->flags&=~VARF_HIDDEN;
@@ -2259,7 +2202,7 @@ static void Exearray(struct Jcontext *jc, struct Elementlist *elist)
          else
          {  Executeelem(jc,enode->sub);
             if((arrayelt = Addarrayelt(jc,array)))
-            {  Asgvalue(&arrayelt->val,jc->val);
+            {  Asgvarvalue(arrayelt,jc->val);
             }
          }
       }
@@ -2304,7 +2247,7 @@ static void Exeobject(struct Jcontext *jc, struct Elementlist *elist)
          }
          enode=enode->next;
          Executeelem(jc,enode->sub);
-         Asgvalue(&prop->val,jc->val);
+         Asgvarvalue(prop,jc->val);
       }
       Keepobject(object,FALSE);
    }
@@ -2320,6 +2263,16 @@ static void Exelabel(struct Jcontext *jc,struct Element *elt)
    REMOVE(&label);
 }
 
+static void Exebytecode(struct Jcontext *jc,struct Element *elt)
+{  /* Single stepping needs the element tree */
+   if(jc->dflags&DEBF_DEBUG)
+   {  Executeelem(jc,elt->sub1);
+   }
+   else
+   {  Runbytecode(jc,elt);
+   }
+}
+
 #ifdef JSDEBUG
 static void Exedebug(struct Jcontext *jc,struct Element *elt)
 {  struct Value val;
@@ -2363,56 +2316,56 @@ static Exeelement *exetab[]=
    (Exeelement *)Exethis,
    (Exeelement *)Exenull,
    NULL,          /* empty */
-   (Exeelement *)Exenegative,
-   (Exeelement *)Exepositive,
-   (Exeelement *)Exenot,
-   (Exeelement *)Exebitneg,
+   (Exeelement *)Exeunary,
+   (Exeelement *)Exeunary,
+   (Exeelement *)Exeunary,
+   (Exeelement *)Exeunary,
    (Exeelement *)Exepreinc,
    (Exeelement *)Exepredec,
    (Exeelement *)Exepostinc,
    (Exeelement *)Exepostdec,
    (Exeelement *)Exenew,
    (Exeelement *)Exedelete,
-   (Exeelement *)Exetypeof,
+   (Exeelement *)Exeunary,
    (Exeelement *)Exevoid,
    (Exeelement *)Exereturn,
    (Exeelement *)Exethrow,
    (Exeelement *)Exeinternal,
    (Exeelement *)Exefunceval,
    (Exeelement *)Execase,
-   (Exeelement *)Exeplus,
-   (Exeelement *)Exeminus,
-   (Exeelement *)Exemult,
-   (Exeelement *)Exediv,
-   (Exeelement *)Exerem,
-   (Exeelement *)Exebitand,
-   (Exeelement *)Exebitor,
-   (Exeelement *)Exebitxor,
-   (Exeelement *)Exeshleft,
-   (Exeelement *)Exeshright,
-   (Exeelement *)Exeushright,
-   (Exeelement *)Exeequality,   /* eq */
-   (Exeelement *)Exeequality,   /* ne */
-   (Exeelement *)Exeexactequality, /* exeq */
-   (Exeelement *)Exeexactequality, /* nexeq */
-   (Exeelement *)Exerelational, /* lt */
-   (Exeelement *)Exerelational, /* gt */
-   (Exeelement *)Exerelational, /* le */
-   (Exeelement *)Exerelational, /* ge */
+   (Exeelement *)Exeoperator,
+   (Exeelement *)Exearithmetic,
+   (Exeelement *)Exearithmetic,
+   (Exeelement *)Exearithmetic,
+   (Exeelement *)Exearithmetic,
+   (Exeelement *)Exearithmetic,
+   (Exeelement *)Exearithmetic,
+   (Exeelement *)Exearithmetic,
+   (Exeelement *)Exearithmetic,
+   (Exeelement *)Exearithmetic,
+   (Exeelement *)Exearithmetic,
+   (Exeelement *)Exeoperator,   /* eq */
+   (Exeelement *)Exeoperator,   /* ne */
+   (Exeelement *)Exeoperator,   /* exeq */
+   (Exeelement *)Exeoperator,   /* nexeq */
+   (Exeelement *)Exeoperator,   /* lt */
+   (Exeelement *)Exeoperator,   /* gt */
+   (Exeelement *)Exeoperator,   /* le */
+   (Exeelement *)Exeoperator,   /* ge */
    (Exeelement *)Exeand,
    (Exeelement *)Exeor,
    (Exeelement *)Exeassign,
-   (Exeelement *)Exeplus,       /* aplus */
-   (Exeelement *)Exeminus,      /* aminus */
-   (Exeelement *)Exemult,       /* amult */
-   (Exeelement *)Exediv,        /* adiv */
-   (Exeelement *)Exerem,        /* arem */
-   (Exeelement *)Exebitand,     /* abitand */
-   (Exeelement *)Exebitor,      /* abitor */
-   (Exeelement *)Exebitxor,     /* abitxor */
-   (Exeelement *)Exeshleft,     /* ashleft */
-   (Exeelement *)Exeshright,    /* ashright */
-   (Exeelement *)Exeushright,   /* aushright */
+   (Exeelement *)Exeoperator,   /* aplus */
+   (Exeelement *)Exearithmetic, /* aminus */
+   (Exeelement *)Exearithmetic, /* amult */
+   (Exeelement *)Exearithmetic, /* adiv */
+   (Exeelement *)Exearithmetic, /* arem */
+   (Exeelement *)Exearithmetic, /* abitand */
+   (Exeelement *)Exearithmetic, /* abitor */
+   (Exeelement *)Exearithmetic, /* abitxor */
+   (Exeelement *)Exearithmetic, /* ashleft */
+   (Exeelement *)Exearithmetic, /* ashright */
+   (Exeelement *)Exearithmetic, /* aushright */
    (Exeelement *)Execomma,
    (Exeelement *)Exein,
    (Exeelement *)Exeinstanceof,
@@ -2436,6 +2389,7 @@ static Exeelement *exetab[]=
    (Exeelement *)Exearray,
    (Exeelement *)Exeobject,
    (Exeelement *)Exelabel,
+   (Exeelement *)Exebytecode,
 #ifdef JSDEBUG
    (Exeelement *)Exedebug,
 #endif
@@ -2582,6 +2536,7 @@ void Addprototype(struct Jcontext *jc,struct Jobject *jo, struct Jobject *protot
    if(prop=Addproperty(jo,"prototype"))
    {  if(pro=Newobject(jc))
       {  pro->constructor=jo;
+         Gcwrite(jo);
          pro->hook=Prototypeohook;
          if(prototype) pro->prototype=prototype;
          Asgobject(&prop->val,pro);
@@ -2639,7 +2594,10 @@ void Initconstruct(struct Jcontext *jc,struct Jobject *jo,STRPTR name,struct Job
       fo = constructor;
    }
    if(fo)
-   {  if(!jo->constructor) jo->constructor=fo;
+   {  if(!jo->constructor)
+      {  jo->constructor=fo;
+         Gcwrite(fo);
+      }
       if(newpro=Addproperty(jo,"constructor"))
       {  Asgfunction(&newpro->val,fo,NULL);
          newpro->flags|=VARF_HIDDEN;
@@ -2650,6 +2608,7 @@ void Initconstruct(struct Jcontext *jc,struct Jobject *jo,STRPTR name,struct Job
       {
 
          jo->prototype = proto->val.value.obj.ovalue;
+         propstamp++;
 
 /* Old way keep commented for reference just in case .... */
 /*
@@ -2670,6 +2629,7 @@ void Initconstruct(struct Jcontext *jc,struct Jobject *jo,STRPTR name,struct Job
          /* it might be that we should throw a run time error here */
 
          jo->prototype = NULL;
+         propstamp++;
       }
    }
    if(!(pro=Getproperty(jo,"toString")))
@@ -2698,6 +2658,7 @@ void Jeval(struct Jcontext *jc,UBYTE *s)
    NEWLIST(&jc2.objects);
    NEWLIST(&jc2.functions);
    jc2.generation=jc->generation;
+   jc2.flags=jc->flags&JCF_BYTECODE;
    Jcompile(&jc2,s);
    jc->nogc--;
    if(!(jc2.flags&JCF_ERROR))
@@ -2789,6 +2750,8 @@ BOOL Newexecute(struct Jcontext *jc)
 {  struct Function *f;
    struct Jobject *fo;
    jc->gc = GC_THRESHOLD;
+   jc->nursery = GC_THRESHOLD;
+   jc->gclimit = GC_MAJORMIN;
    NEWLIST(&jc->functions);
    NEWLIST(&jc->labels);
    NEWLIST(&jc->thislist);
@@ -58,6 +58,12 @@ extern struct Variable *Arrayelt(struct Jobject *jo,long n);
    /* Add an element to this array */
 extern struct Variable *Addarrayelt(struct Jcontext *jc,struct Jobject *jo);
 
+   /* Find the nth element kept in the vector, for enumeration */
+extern struct Variable *Enumarrayelt(struct Jobject *jo,long n,long *countp);
+
+   /* Delete (var) if it is an element of this array */
+extern BOOL Deletearrayelt(struct Jobject *jo,struct Variable *var);
+
    /* Tests if this object is an array */
 extern BOOL Isarray(struct Jobject *jo);
 
@@ -77,6 +83,16 @@ extern struct Jobject *Newboolean(struct Jcontext *jc,BOOL bvalue);
    /* Compile the source and construct an element tree */
 extern void Jcompile(struct Jcontext *jc,UBYTE *source);
 
+   /* Compile the source or find it in the script cache. Returns the cached
+    * script or NULL if the source was compiled into jc->program. */
+extern struct Jscript *Jcompilescript(struct Jcontext *jc,UBYTE *source);
+
+   /* Release a script after it has run */
+extern void Jreleasescript(struct Jcontext *jc,struct Jscript *js);
+
+   /* Dispose the script cache */
+extern void Freescripts(struct Jcontext *jc);
+
    /* Compile this source and make it into a function object. */
 struct Jobject *Jcompiletofunction(struct Jcontext *jc,UBYTE *source,UBYTE *name);
 
@@ -90,6 +106,9 @@ extern void Jdispose(struct Element *elt);
 /*-- jdata --------------------------------------------------------------*/
 /*-----------------------------------------------------------------------*/
 
+   /* Property layout stamp, see jdata.c */
+extern ULONG propstamp;
+
    /* Call this property function */
 extern BOOL Callproperty(struct Jcontext *jc,struct Jobject *jo,UBYTE *name);
 
@@ -100,8 +119,14 @@ extern void Asgnumber(struct Value *to,UBYTE attr,double n);
 extern void Asgboolean(struct Value *to,BOOL b);
 extern void Asgstring(struct Value *to,UBYTE *s,void *pool);
 extern void Asgstringlen(struct Value *to,UBYTE *s,long len,void *pool);
+extern void Appendstring(struct Value *v,UBYTE *s,long len,void *pool);
+extern long Stringlength(struct Value *v);
 extern void Asgobject(struct Value *to,struct Jobject *jo);
 extern void Asgfunction(struct Value *to,struct Jobject *f,struct Jobject *fthis);
+   /* Same for variables. These know where the value is stored, which saves
+    * the garbage collector work. */
+extern void Asgvarvalue(struct Variable *var,struct Value *from);
+extern void Asgvarobject(struct Variable *var,struct Jobject *jo);
 
    /* WARNING: Tostring() cannot be called for ex->val directly. */
 extern void Tostring(struct Value *v,struct Jcontext *jc);
@@ -127,6 +152,7 @@ extern struct Variable *Getownproperty(struct Jobject *jo,UBYTE *name);
 extern struct Variable *Getproperty(struct Jobject *jo,UBYTE *name);
 extern BOOL Deleteownproperty(struct Jobject *jo,UBYTE *name);
 extern BOOL _Generic_Deleteownproperty(struct Jobject *jo,UBYTE *name);
+extern void Deletepropertyvar(struct Jobject *jo,struct Variable *var);
 extern struct Variable *_Generic_Addproperty(struct Jobject *jo,UBYTE *name);
 extern struct Variable *_Generic_Getownproperty(struct Jobject *jo,UBYTE *name);
 extern BOOL _Array_Deleteownproperty(struct Jobject *jo,UBYTE *name);
@@ -152,6 +178,7 @@ extern BOOL Callohook(struct Jobject *jo,struct Jcontext *jc,short code,UBYTE *n
    /* Garbage collector */
 extern void Keepobject(struct Jobject *jo,BOOL used);
 extern void Garbagecollect(struct Jcontext *jc);
+extern void Gcwrite(struct Jobject *jo);
 
 extern void Dumpobjects(struct Jcontext *jc);
 
@@ -226,6 +253,31 @@ extern void Callfunctionargs(struct Jcontext *jc,struct Elementfunc *func,
    /* Execute an element */
 extern void Executeelem(struct Jcontext *jc,struct Element *elt);
 
+   /* Find a variable in the current scope, or a local variable */
+extern struct Variable *Findvar(struct Jcontext *jc,UBYTE *name,struct Jobject **pthis);
+extern struct Variable *Findlocalvar(struct Jcontext *jc,UBYTE *name);
+
+   /* Get a member of an object, with optional lookup cache */
+extern BOOL Member(struct Jcontext *jc,struct Element *elt,struct Jobject *jo,
+   UBYTE *mbrname,BOOL asgonly,struct Propcache *pc);
+
+   /* Call function value with evaluated arguments */
+extern void Callvalues(struct Jcontext *jc,struct Element *elt,struct Value *fval,
+   struct Value *argv,long argc,struct Jobject *jthis);
+
+   /* Apply binary operator to two values, result in jc->val */
+extern void Binaryop(struct Jcontext *jc,UWORD type,struct Value *val1,struct Value *val2);
+
+   /* In place s+=x for string variable. Returns FALSE if not applicable */
+extern BOOL Appendvar(struct Jcontext *jc,struct Variable *lhs,
+   struct Value *val1,struct Value *val2);
+
+   /* Apply unary operator to value in place */
+extern void Unaryop(struct Jcontext *jc,UWORD type,struct Value *v);
+
+   /* Exact (===) comparison */
+extern BOOL Exactequality(struct Jcontext *jc,struct Value *val1,struct Value *val2);
+
    /* Create a new function from an element */
 extern struct Function *Newfunction(struct Jcontext *jc, struct Elementfunc *func);
 
@@ -319,6 +371,13 @@ extern struct Jobject *Newnumber(struct Jcontext *jc,UBYTE attr,double nvalue);
 
 extern void Initobject(struct Jcontext *jc, struct Jobject *jscope);
 
+/*-----------------------------------------------------------------------*/
+/*-- jvm ----------------------------------------------------------------*/
+/*-----------------------------------------------------------------------*/
+
+   /* Run the bytecode of an ET_BYTECODE element */
+extern void Runbytecode(struct Jcontext *jc,struct Element *elt);
+
 /*-----------------------------------------------------------------------*/
 /*-- string -------------------------------------------------------------*/
 /*-----------------------------------------------------------------------*/
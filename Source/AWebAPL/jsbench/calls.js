@@ -0,0 +1,19 @@
+/* calls.js - function and method calls */
+function add(a,b)
+{  return a+b;
+}
+function fib(n)
+{  if(n<2) return n;
+   return fib(n-1)+fib(n-2);
+}
+function calls(n)
+{  var o=new Object();
+   var i=0,r=0;
+   o.twice=function(v) { return v+v; };
+   while(i<n)
+   {  r=add(r,o.twice(1))%100000;
+      i++;
+   }
+   return r+fib(18);
+}
+writeln("calls: ",calls(20000));
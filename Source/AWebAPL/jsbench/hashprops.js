@@ -0,0 +1,34 @@
+/* hashprops.js - add, look up, delete and re-add properties on objects
+ * with fewer and with more properties than get a hash index */
+function keys(o)
+{  var s="",k;
+   for(k in o) s+=k+",";
+   return s;
+}
+function hashprops(n,reps)
+{  var o=new Object(),names=new Array(n),i,r,sum=0,s;
+   for(i=0;i<n;i++) names[i]="p"+i;
+   for(i=0;i<n;i++) o[names[i]]=i;
+   for(r=0;r<reps;r++)
+   {  for(i=0;i<n;i++) sum+=o[names[i]];
+   }
+   /* Delete the even properties, the others keep their order */
+   for(i=0;i<n;i+=2) delete o[names[i]];
+   s="";
+   for(i=1;i<n;i+=2) s+=names[i]+",";
+   if(keys(o)!=s) return -1;
+   /* Re-added properties come last */
+   for(i=0;i<n;i+=2) o[names[i]]=i;
+   for(i=0;i<n;i+=2) s+=names[i]+",";
+   if(keys(o)!=s) return -1;
+   for(r=0;r<reps;r++)
+   {  for(i=0;i<n;i++) sum+=o[names[i]];
+   }
+   return sum;
+}
+var sizes=new Array(4,7,8,9,64,500,2000),total=0,j,sum;
+for(j=0;j<7 && total>=0;j++)
+{  sum=hashprops(sizes[j],Math.floor(100000/sizes[j]));
+   total=(sum<0)?-1:total+sum;
+}
+writeln("hashprops: ",total);
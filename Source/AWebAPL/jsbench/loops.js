@@ -0,0 +1,14 @@
+/* loops.js - numeric loops and local variables */
+function loops(n)
+{  var i=0,j,sum=0;
+   while(i<n)
+   {  j=0;
+      while(j<100)
+      {  sum=sum+i*j-(j%7);
+         j++;
+      }
+      i++;
+   }
+   return sum;
+}
+writeln("loops: ",loops(2000));
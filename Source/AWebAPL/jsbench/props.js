@@ -0,0 +1,20 @@
+/* props.js - property reads and writes through . and [] */
+function Point(x,y)
+{  this.x=x;
+   this.y=y;
+}
+function props(n)
+{  var p=new Point(1,2);
+   var a=new Array(10);
+   var i=0,k;
+   while(i<n)
+   {  p.x=p.x+p.y;
+      p.y=p.x-p.y;
+      k=i%10;
+      a[k]=p.x%1000;
+      p.x=a[k];
+      i++;
+   }
+   return p.x+p.y;
+}
+writeln("props: ",props(100000));
@@ -0,0 +1,14 @@
+/* strbuild.js - build a 1 MB string from 100000 appends */
+function strbuild(n)
+{  var s="",t="",i;
+   for(i=0;i<n;i++)
+   {  s+="abcdefghi\n";
+   }
+   /* a+b+c extends the temporary left operand */
+   for(i=0;i<n/10;i++)
+   {  t=t+"abcd"+"efghi"+"\n";
+   }
+   if(s.length!=10*n || t.length!=n || s.charAt(10*n-2)!="i") return -1;
+   return s.length+t.length;
+}
+writeln("strbuild: ",strbuild(100000));
@@ -0,0 +1,14 @@
+/* strings.js - string building and comparison */
+function strings(n)
+{  var s="",t,i=0,count=0;
+   while(i<n)
+   {  s+="x";
+      if(i%100==0)
+      {  t=s.substring(0,10);
+         if(t=="xxxxxxxxxx") count++;
+      }
+      i++;
+   }
+   return s.length+count;
+}
+writeln("strings: ",strings(50000));
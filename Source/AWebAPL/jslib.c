@@ -251,6 +251,15 @@ __asm __saveds void Jallowgc(
    register __a0 struct Jcontext *jc,
    register __d0 BOOL allow);
 
+__asm __saveds UBYTE *Jtostringlen(
+   register __a0 struct Jcontext *jc,
+   register __a1 struct Variable *jv,
+   register __a2 long *lenp);
+
+__asm __saveds void Jbytecode(
+   register __a0 struct Jcontext *jc,
+   register __d0 BOOL bytecode);
+
 __asm __saveds void Jsetlinenumber(
    register __a0 struct Jcontext *jc,
    register __d0 long linenr);
@@ -332,6 +341,8 @@ static APTR functable[]=
    Jsetscreen,
    Jaddeventhandler,
    Jallowgc,
+   Jtostringlen,
+   Jbytecode,
    (APTR)-1
 };
 
@@ -481,8 +492,9 @@ void Addtojbuffer(struct Jbuffer *jb,UBYTE *text,long length)
 {  if(length<0) length=strlen(text);
    if(jb->length+length+1>jb->size)
    {  long newsize=((jb->length+length+1024)/1024)*1024;
-      UBYTE *newbuf=ALLOCTYPE(UBYTE,newsize,0,jb->pool);
-      if(!newbuf) return;
+      UBYTE *newbuf;
+      if(newsize<2*jb->size) newsize=2*jb->size;
+      if(!(newbuf=ALLOCTYPE(UBYTE,newsize,0,jb->pool))) return;
       if(jb->size)
       {  memmove(newbuf,jb->buffer,jb->size);
          FREE(jb->buffer);
@@ -728,7 +740,10 @@ __asm __saveds void *Newjcontext(register __a0 UBYTE *screenname)
    {  if(jc=ALLOCSTRUCT(Jcontext,1,0,pool))
       {  jc->pool=pool;
          NEWLIST(&jc->objects);
+         NEWLIST(&jc->young);
          NEWLIST(&jc->tmp);
+         NEWLIST(&jc->scripts);
+         jc->flags|=JCF_BYTECODE;
          Newexecute(jc);
          jc->screenname=screenname;
       }
@@ -742,7 +757,8 @@ __asm __saveds void *Newjcontext(register __a0 UBYTE *screenname)
 __asm __saveds void Freejcontext(register __a0 struct Jcontext *jc)
 {  if(jc)
    {  if(jc->pool)
-      {  Freeexecute(jc);
+      {  Freescripts(jc);
+         Freeexecute(jc);
          DeletePool(jc->pool);
          /* This deletes jc itself too because it was allocated in the pool */
       }
@@ -760,8 +776,9 @@ __asm __saveds BOOL Runjprogram(register __a0 struct Jcontext *jc,
    ULONG olduserdata,oldprotkey,olddflags;
    long oldwarnmem;
    struct Value val={0};
-   LIST(Jobject) temps;
-   struct Jobject *jo,*jn;
+   struct Jscript *script;
+   void *oldprogram;
+   USHORT oldkeep;
    unsigned int clock[2]={ 0,0 };
    if(jc && source)
    {  idcmphook.h_Entry=(HOOKFUNC)Idcmphook;
@@ -769,9 +786,11 @@ __asm __saveds BOOL Runjprogram(register __a0 struct Jcontext *jc,
       jc->flags&=~(JCF_ERROR|JCF_IGNORE|EXF_STOP);
       jc->generation++;
       jc->fscope=fscope;
-      /* Ensure built-in objects are in the fscope - add them if not already present */
-      if(fscope)
-      {  if(!Getproperty(fscope,"Math")) Initmath(jc,fscope);
+      /* Ensure built-in objects are in the fscope - add them if not already present.
+       * This is done once per scope, Clearobject() resets the flag. */
+      if(fscope && !(fscope->flags&OBJF_BUILTINS))
+      {  fscope->flags|=OBJF_BUILTINS;
+         if(!Getproperty(fscope,"Math")) Initmath(jc,fscope);
          if(!Getproperty(fscope,"Array")) Initarray(jc,fscope);
          if(!Getproperty(fscope,"Date")) Initdate(jc,fscope);
          if(!Getproperty(fscope,"Object")) Initobject(jc,fscope);
@@ -781,10 +800,10 @@ __asm __saveds BOOL Runjprogram(register __a0 struct Jcontext *jc,
          if(!Getproperty(fscope,"String")) Initstring(jc,fscope);
          if(!Getproperty(fscope,"RegExp")) Initregexp(jc,fscope);
          if(!Getproperty(fscope,"Error")) Initerror(jc,fscope);
-         /* Copy global functions from jc->functions.first->local to fscope */
-         if(jc->functions.first)
+         /* Copy global functions from the JS global scope to fscope */
+         if(jc->functions.last)
          {  struct Variable *var,*fvar;
-            for(var=jc->functions.first->local.first;var && var->next;var=var->next)
+            for(var=jc->functions.last->local.first;var && var->next;var=var->next)
             {  if(var->name && var->val.type==VTP_OBJECT && var->val.value.obj.ovalue
                   && var->val.value.obj.ovalue->function
                   && !Getproperty(fscope,var->name))
@@ -798,18 +817,19 @@ __asm __saveds BOOL Runjprogram(register __a0 struct Jcontext *jc,
       }
       jc->warntime=0;
       jc->warnmem=0;
-      Jcompile(jc,source);
+      script=Jcompilescript(jc,source);
       jc->linenr=0;
       if(!(jc->flags&JCF_ERROR))
-      {  /* Remember existing temporary objects (see comment in jexe.c:Exedot()) */
-         NEWLIST(&temps);
-         for(jo=jc->objects.first;jo->next;jo=jn)
-         {  jn=jo->next;
-            if(jo->flags&OBJF_TEMP)
-            {  REMOVE(jo);
-               ADDTAIL(&temps,jo);
-            }
+      {  /* Existing temporary objects are left alone by the garbage
+          * collector while a program runs, see Garbagecollect(). */
+         jc->rundepth++;
+         oldprogram=jc->program;
+         oldkeep=jc->flags&JCF_KEEPPROGRAM;
+         if(script)
+         {  jc->program=script->program;
+            jc->flags|=JCF_KEEPPROGRAM;
          }
+         else jc->flags&=~JCF_KEEPPROGRAM;
          olduserdata=jc->userdata;
          jc->userdata=userdata;
          oldprotkey=jc->protkey;
@@ -826,6 +846,9 @@ __asm __saveds BOOL Runjprogram(register __a0 struct Jcontext *jc,
             jc->warnmem=AvailMem(0)/4;
          }
          Jexecute(jc,jthis,gwtab);
+         jc->program=oldprogram;
+         jc->flags=(jc->flags&~JCF_KEEPPROGRAM)|oldkeep;
+         jc->rundepth--;
          if(jc->dflags&DEBF_DOPEN)
          {  Stopdebugger(jc);
          }
@@ -841,10 +864,8 @@ __asm __saveds BOOL Runjprogram(register __a0 struct Jcontext *jc,
          jc->warnmem=oldwarnmem;
          jc->userdata=olduserdata;
          jc->protkey=oldprotkey;
-         while(jo=REMHEAD(&temps))
-         {  ADDTAIL(&jc->objects,jo);
-         }
       }
+      Jreleasescript(jc,script);
    }
    return result;
 }
@@ -895,6 +916,7 @@ __asm __saveds struct Jobject *AddjfunctionA(
       {  if(f=InternalfunctionA(jc,name,code,args))
          {  if(f->function)
             {  f->function->fscope=jo;
+               Gcwrite(jo);
             }
             Asgfunction(&prop->val,f,jo);
          }
@@ -932,6 +954,18 @@ __asm __saveds UBYTE *Jtostring(
    return jv->val.value.svalue;
 }
 
+__asm __saveds UBYTE *Jtostringlen(
+   register __a0 struct Jcontext *jc,
+   register __a1 struct Variable *jv,
+   register __a2 long *lenp)
+{  if(!jc || !jv)
+   {  return NULL;
+   }
+   Tostring(&jv->val,jc);
+   if(lenp) *lenp=Stringlength(&jv->val);
+   return jv->val.value.svalue;
+}
+
 __asm __saveds void Jasgstring(
    register __a0 struct Jcontext *jc,
    register __a1 struct Variable *jv,
@@ -1083,7 +1117,10 @@ __asm __saveds void Jsetprototype(
 {  struct Variable *var;
    if((var=Getownproperty(jo,"prototype"))
    || (var=Addproperty(jo,"prototype")))
-   {  if(!proto->constructor) proto->constructor=jo;
+   {  if(!proto->constructor)
+      {  proto->constructor=jo;
+         Gcwrite(jo);
+      }
       proto->hook=Prototypeohook;
       Asgobject(&var->val,proto);
    }
@@ -1214,6 +1251,19 @@ __asm __saveds void Jerrors(
    }
 }
 
+__asm __saveds void Jbytecode(
+   register __a0 struct Jcontext *jc,
+   register __d0 BOOL bytecode)
+{  if(jc)
+   {  if(bytecode)
+      {  jc->flags|=JCF_BYTECODE;
+      }
+      else
+      {  jc->flags&=~JCF_BYTECODE;
+      }
+   }
+}
+
 __asm __saveds void Jkeepobject(
    register __a0 struct Jobject *jo,
    register __d0 BOOL used)
@@ -34,6 +34,9 @@ extern void Jdebug(struct Jcontext *jc,BOOL debug);
 /* Set compilation and runtime errors on or off */
 extern void Jerrors(struct Jcontext *jc,BOOL comperrors,long runerrors,BOOL watch);
 
+/* Compile to bytecode (default) or run the parse tree only */
+extern void Jbytecode(struct Jcontext *jc,BOOL bytecode);
+
 /* Runtime error values */
 #define JERRORS_CONTINUE   -1 /* Don't show errors and try to continue script */
 #define JERRORS_OFF        0  /* Don't show errors and stop script */
@@ -173,6 +176,8 @@ extern struct Jvar *Jfargument(struct Jcontext *jc,long n);
 
 /* Convert value to string, object, boolean, number */
 extern UBYTE *Jtostring(struct Jcontext *jc,struct Jvar *jv);
+/* As Jtostring(), also stores the string length in (*lenp) */
+extern UBYTE *Jtostringlen(struct Jcontext *jc,struct Jvar *jv,long *lenp);
 extern struct Jobject *Jtoobject(struct Jcontext *jc,struct Jvar *jv);
 extern BOOL Jtoboolean(struct Jcontext *jc,struct Jvar *jv);
 extern long Jtonumber(struct Jcontext *jc,struct Jvar *jv);
@@ -280,3 +285,5 @@ extern void Jdumpobjects(struct Jcontext *jc);
 #pragma libcall AWebJSBase Jsetscreen 120 9802
 #pragma libcall AWebJSBase Jaddeventhandler 126 BA9804
 #pragma libcall AWebJSBase Jallowgc 12c 0802
+#pragma libcall AWebJSBase Jtostringlen 132 A9803
+#pragma libcall AWebJSBase Jbytecode 138 0802
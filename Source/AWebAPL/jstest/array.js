@@ -0,0 +1,53 @@
+/* array.js - delete on array elements */
+/* Reading a missing element adds it in this engine, so deleted
+ * elements are looked for with for..in before they are read. */
+var failed=0;
+function check(name,ok)
+{  if(!ok)
+   {  writeln("FAIL ",name);
+      failed++;
+   }
+}
+function keys(o)
+{  var s="",k;
+   for(k in o) s+=k+",";
+   return s;
+}
+function test(a,n,d)
+{  var i,s;
+   check(n+": delete",delete a[d]);
+   check(n+": length kept",a.length==n);
+   s="";
+   for(i=0;i<n;i++) if(i!=d) s+=i+",";
+   check(n+": hole",keys(a)==s);
+   s=0;
+   for(i=0;i<n;i++) if(i!=d) s+=a[i];
+   check(n+": others",s==n*(n-1)/2-d);
+   check(n+": read hole",typeof a[d]=="undefined");
+   a[d]=d;
+   check(n+": refilled",a[d]==d && a.join().length>0);
+   delete a[d];
+   a.length=d;
+   check(n+": truncated",a.length==d);
+   s="";
+   for(i=0;i<d;i++) s+=i+",";
+   check(n+": truncated keys",keys(a)==s);
+   a.length=n;
+   check(n+": extended",a.length==n && keys(a)==s);
+   a[n]="end";
+   check(n+": set after",a.length==n+1 && a[n]=="end");
+}
+var a=[0,1,2],b=new Array(),c=new Array(),i;
+test(a,3,1);
+for(i=0;i<50;i++) b[i]=i;
+test(b,50,20);
+/* An element far beyond the vector is kept as a named property */
+c[0]=0;
+c[100000]=100000;
+check("sparse: delete",delete c[100000]);
+check("sparse: keys",keys(c)=="0,");
+c[100000]=1;
+check("sparse: re-added",c[100000]==1 && c.length==100001);
+c.length=1;
+check("sparse: truncated",keys(c)=="0," && c.length==1);
+writeln(failed?"array: failed":"array: ok");
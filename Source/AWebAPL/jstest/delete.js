@@ -0,0 +1,40 @@
+/* delete.js - delete on objects with and without a property hash index */
+/* Reading a missing property adds it in this engine, so deleted
+ * properties are only looked for with for..in. */
+var failed=0;
+function check(name,ok)
+{  if(!ok)
+   {  writeln("FAIL ",name);
+      failed++;
+   }
+}
+function keys(o)
+{  var s="",k;
+   for(k in o) s+=k+",";
+   return s;
+}
+function test(n)
+{  var o={},i,s;
+   for(i=0;i<n;i++) o["p"+i]=i;
+   check(n+": delete",delete o.p5);
+   check(n+": delete first",delete o["p0"]);
+   s="";
+   for(i=1;i<n;i++) if(i!=5) s+="p"+i+",";
+   check(n+": deleted",keys(o)==s);
+   /* Lookups in every chain after the deletes */
+   check(n+": others",o.p4==4 && o.p6==6 && o["p"+(n-1)]==n-1);
+   s=0;
+   for(i=1;i<n;i++) if(i!=5) s+=o["p"+i];
+   check(n+": sum",s==n*(n-1)/2-5);
+   o.p5="again";
+   check(n+": re-added",o.p5=="again");
+   s="";
+   for(i=1;i<n;i++) if(i!=5) s+="p"+i+",";
+   check(n+": for in order",keys(o)==s+"p5,");
+   check(n+": delete again",delete o.p5);
+   check(n+": deleted again",keys(o)==s);
+}
+test(7);
+test(20);
+test(200);
+writeln(failed?"delete: failed":"delete: ok");
@@ -324,19 +324,13 @@ static void Stringconcat(struct Jcontext *jc)
 {
     struct Jobject *jo=jc->jthis,*args;
     struct Variable *var = jc->functions.first->local.first;
-    struct Jbuffer *buffer = Newjbuffer(jc->pool);
     struct Variable *length;
-    UBYTE *str;
-
     struct Value v = {0};
     Asgobject(&v,jo);
     Tostring(&v,jc);
-    str = v.value.svalue;
 
-
-    if(str)
+    if(v.value.svalue)
     {
-        Addtojbuffer(buffer,str,-1);
         if((args=Findarguments(jc)))
         {
             if((length = Getproperty(args,"length")) && length->val.type==VTP_NUMBER)
@@ -346,15 +340,16 @@ static void Stringconcat(struct Jcontext *jc)
                 {
                     var = Arrayelt(args,i);
                     Tostring(&var->val,jc);
-                    Addtojbuffer(buffer,var->val.value.svalue,-1);
+                    Appendstring(&v,var->val.value.svalue,Stringlength(&var->val),jc->pool);
                 }
             }
         }
-
-
+        Asgvalue(RETVAL(jc),&v);
+    }
+    else
+    {
+        Asgstring(RETVAL(jc),"",jc->pool);
     }
-    Asgstringlen(RETVAL(jc),buffer->buffer,buffer->length,jc->pool);
-    Freejbuffer(buffer);
     Clearvalue(&v);
 }
 
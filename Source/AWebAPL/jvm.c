@@ -0,0 +1,498 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb APL distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* jvm.c - AWeb js bytecode virtual machine */
+
+#include "awebjs.h"
+#include "jprotos.h"
+
+/* Value stack and slot cache sizes that are kept on the C stack.
+ * Larger bytecodes allocate theirs from the pool. */
+#define VMSTACK   16
+#define VMSLOTS   24
+
+struct Slotcache           /* Variable found for a name slot */
+{  struct Variable *var;
+   struct Jobject *jthis;  /* Object the variable was found in by with */
+};
+
+struct Vm
+{  struct Jcontext *jc;
+   struct Bytecode *bc;
+   struct Slotcache *slots;
+   ULONG stamp;            /* (propstamp) when slots were last valid */
+   void *lastlocal;        /* Last local variable when slots were last valid */
+};
+
+/*-----------------------------------------------------------------------*/
+
+/* Forget all slots if properties or local variables were added or removed
+ * since they were looked up. */
+static void Checkslots(struct Vm *vm)
+{  void *lastlocal=vm->jc->functions.first->local.last;
+   if(vm->stamp!=propstamp || vm->lastlocal!=lastlocal)
+   {  memset(vm->slots,0,vm->bc->nslots*sizeof(struct Slotcache));
+      vm->stamp=propstamp;
+      vm->lastlocal=lastlocal;
+   }
+}
+
+/* Find the variable for a name slot, resolving synonyms */
+static struct Variable *Slotvar(struct Vm *vm,UWORD slot,struct Jobject **pthis)
+{  struct Slotcache *sc=&vm->slots[slot];
+   struct Variable *var;
+   Checkslots(vm);
+   if(!sc->var)
+   {  sc->jthis=NULL;
+      if(var=Findvar(vm->jc,vm->bc->names[slot],&sc->jthis))
+      {  while((var->flags&VARF_SYNONYM) && var->hookdata) var=var->hookdata;
+      }
+      sc->var=var;
+      /* Findvar() might have added to the scope */
+      vm->stamp=propstamp;
+      vm->lastlocal=vm->jc->functions.first->local.last;
+   }
+   if(pthis) *pthis=sc->jthis;
+   return sc->var;
+}
+
+/* Move jc->val into (v) */
+static void Takeval(struct Jcontext *jc,struct Value *v)
+{  Clearvalue(v);
+   *v=*jc->val;
+   jc->val->type=VTP_UNDEFINED;
+}
+
+/* Move (v) into jc->val */
+static void Putval(struct Jcontext *jc,struct Value *v)
+{  Clearvalue(jc->val);
+   *jc->val=*v;
+   v->type=VTP_UNDEFINED;
+}
+
+/* Get the value of a variable like Exeidentifier() does */
+static void Getvarvalue(struct Jcontext *jc,struct Variable *var,struct Jobject *jthis,
+   struct Value *v)
+{  if(var->val.type==VTP_OBJECT && var->val.value.obj.ovalue && var->val.value.obj.ovalue->function)
+   {  Asgfunction(v,var->val.value.obj.ovalue,jthis?jthis:var->val.value.obj.fthis);
+   }
+   else
+   {  if(!Callvhook(var,jc,VHC_GET,v))
+      {  Asgvalue(v,&var->val);
+      }
+   }
+}
+
+/* Assign a value to a variable like Exeassign() does */
+static void Setvarvalue(struct Jcontext *jc,struct Variable *var,struct Value *v)
+{  if(!Callvhook(var,jc,VHC_SET,v))
+   {  Asgvarvalue(var,v);
+      var->flags&=~VARF_HIDDEN;
+   }
+}
+
+/* Increment or decrement variable in place, result in (v) */
+static void Increment(struct Jcontext *jc,struct Variable *var,long type,struct Value *v)
+{  double d=(type==ET_PREINC || type==ET_POSTINC)?1.0:-1.0;
+   Tonumber(&var->val,jc);
+   if(type==ET_POSTINC || type==ET_POSTDEC)
+   {  Asgvalue(v,&var->val);
+   }
+   if(var->val.attr==VNA_VALID)
+   {  var->val.value.nvalue+=d;
+   }
+   if(type==ET_PREINC || type==ET_PREDEC)
+   {  Asgvalue(v,&var->val);
+   }
+}
+
+/* Convert (v) to object like Exedot() does. Converted primitives
+ * become temporary objects. */
+static struct Jobject *Objectvalue(struct Jcontext *jc,struct Value *v)
+{  BOOL temp=(v->type!=VTP_OBJECT);
+   Toobject(v,jc);
+   if(temp && v->value.obj.ovalue)
+   {  v->value.obj.ovalue->flags|=OBJF_TEMP;
+      Keepobject(v->value.obj.ovalue,TRUE);
+   }
+   return v->value.obj.ovalue;
+}
+
+/* Apply binary operator to two valid numbers, result in (a). Returns
+ * FALSE if the operator isn't handled or the result isn't finite, so
+ * Binaryop() can take care of it. */
+static BOOL Numberop(long type,struct Value *a,struct Value *b)
+{  double x=a->value.nvalue,y=b->value.nvalue,n;
+   switch(type)
+   {  case ET_PLUS:
+      case ET_APLUS:
+         n=x+y;
+         break;
+      case ET_MINUS:
+      case ET_AMINUS:
+         n=x-y;
+         break;
+      case ET_MULT:
+      case ET_AMULT:
+         n=x*y;
+         break;
+      case ET_EQ:
+      case ET_EXEQ:
+         Asgboolean(a,x==y);
+         return TRUE;
+      case ET_NE:
+      case ET_NEXEQ:
+         Asgboolean(a,x!=y);
+         return TRUE;
+      case ET_LT:
+         Asgboolean(a,x<y);
+         return TRUE;
+      case ET_GT:
+         Asgboolean(a,x>y);
+         return TRUE;
+      case ET_LE:
+         Asgboolean(a,x<=y);
+         return TRUE;
+      case ET_GE:
+         Asgboolean(a,x>=y);
+         return TRUE;
+      default:
+         return FALSE;
+   }
+   /* n-n is NaN for infinite and NaN results */
+   if(n-n!=0.0) return FALSE;
+   a->value.nvalue=n;
+   return TRUE;
+}
+
+/* Truth value of (v) without changing it */
+static BOOL Truth(struct Jcontext *jc,struct Value *v)
+{  struct Value t;
+   BOOL b;
+   if(v->type==VTP_BOOLEAN) return v->value.bvalue;
+   t.type=0;
+   Asgvalue(&t,v);
+   Toboolean(&t,jc);
+   b=t.value.bvalue;
+   Clearvalue(&t);
+   return b;
+}
+
+/*-----------------------------------------------------------------------*/
+
+/* Run the bytecode of an ET_BYTECODE element. The value stack is
+ * registered in jc->vmframe so the garbage collector sees the values. */
+void Runbytecode(struct Jcontext *jc,struct Element *elt)
+{  struct Bytecode *bc=elt->sub2;
+   struct Value vstack[VMSTACK],*stack,*sp,*v;
+   struct Slotcache vslots[VMSLOTS];
+   struct Vm vm;
+   struct Vmframe frame;
+   struct Binstr *ip;
+   struct Variable *var;
+   struct Jobject *jo,*jthis;
+   struct Jcontext *tc;
+   BOOL run=TRUE;
+   long i;
+   stack=(bc->maxstack<=VMSTACK)?vstack:ALLOCTYPE(struct Value,bc->maxstack,0,jc->pool);
+   vm.slots=(bc->nslots<=VMSLOTS)?vslots:ALLOCSTRUCT(Slotcache,bc->nslots,0,jc->pool);
+   if(!stack || !vm.slots)
+   {  /* Out of memory, run the elements instead */
+      if(stack && stack!=vstack) FREE(stack);
+      if(vm.slots && vm.slots!=vslots) FREE(vm.slots);
+      Executeelem(jc,elt->sub1);
+      return;
+   }
+   for(i=0;i<bc->maxstack;i++) stack[i].type=VTP_UNDEFINED;
+   vm.jc=jc;
+   vm.bc=bc;
+   vm.stamp=propstamp-1;
+   vm.lastlocal=NULL;
+   Checkslots(&vm);
+   frame.prev=jc->vmframe;
+   frame.stack=stack;
+   frame.size=bc->maxstack;
+   jc->vmframe=&frame;
+   sp=stack;
+   ip=bc->code;
+   while(run && !jc->complete && !(jc->flags&EXF_STOP))
+   {  switch(ip->op)
+      {  case BC_END:
+            run=FALSE;
+            break;
+
+         case BC_CONST:
+            Asgvalue(sp++,&bc->consts[ip->arg]);
+            break;
+
+         case BC_POP:
+            Clearvalue(--sp);
+            break;
+
+         case BC_SETVAL:
+            Putval(jc,--sp);
+            break;
+
+         case BC_GETVAR:
+            if(var=Slotvar(&vm,ip->slot,&jthis))
+            {  Getvarvalue(jc,var,jthis,sp);
+            }
+            sp++;
+            break;
+
+         case BC_SETVAR:
+            if(var=Slotvar(&vm,ip->slot,NULL))
+            {  Setvarvalue(jc,var,sp-1);
+            }
+            break;
+
+         case BC_ASGOPVAR:
+            v=--sp;
+            var=Slotvar(&vm,ip->slot,NULL);
+            if(var && sp[-1].type==VTP_NUMBER && v->type==VTP_NUMBER
+            && sp[-1].attr==VNA_VALID && v->attr==VNA_VALID
+            && Numberop(ip->arg,sp-1,v))
+            {  Setvarvalue(jc,var,sp-1);
+            }
+            else if(!(ip->arg==ET_APLUS && var && Appendvar(jc,var,sp-1,v)))
+            {  Binaryop(jc,(UWORD)ip->arg,sp-1,v);
+               Takeval(jc,sp-1);
+               if(var) Setvarvalue(jc,var,sp-1);
+            }
+            else
+            {  /* Move, so the buffer stays unshared for the next append */
+               Takeval(jc,sp-1);
+            }
+            Clearvalue(v);
+            break;
+
+         case BC_DECLVAR:
+            Checkslots(&vm);
+            if(var=Findlocalvar(jc,bc->names[ip->slot]))
+            {  var->flags|=VARF_DONTDELETE;
+            }
+            Checkslots(&vm);
+            vm.slots[ip->slot].var=var;
+            vm.slots[ip->slot].jthis=NULL;
+            break;
+
+         case BC_INITVAR:
+            /* The initializer may have invalidated the slot set by BC_DECLVAR */
+            Checkslots(&vm);
+            if(!(var=vm.slots[ip->slot].var))
+            {  var=Findlocalvar(jc,bc->names[ip->slot]);
+            }
+            if(var) Asgvarvalue(var,sp-1);
+            Clearvalue(--sp);
+            break;
+
+         case BC_INCVAR:
+            if(var=Slotvar(&vm,ip->slot,NULL))
+            {  Increment(jc,var,ip->arg,sp);
+            }
+            sp++;
+            break;
+
+         case BC_GETMEMBER:
+            v=sp-1;
+            jc->elt=ip->elt;
+            if((jo=Objectvalue(jc,v))
+            && Member(jc,ip->elt,jo,bc->caches[ip->slot].name,FALSE,&bc->caches[ip->slot]))
+            {  Takeval(jc,v);
+            }
+            else
+            {  Clearvalue(v);
+            }
+            jc->flags&=~EXF_KEEPREF;
+            break;
+
+         case BC_SETMEMBER:
+            v=sp-2;
+            jc->elt=ip->elt;
+            if((jo=Objectvalue(jc,v))
+            && Member(jc,ip->elt,jo,bc->caches[ip->slot].name,TRUE,&bc->caches[ip->slot])
+            && jc->varref)
+            {  Setvarvalue(jc,jc->varref,sp-1);
+            }
+            jc->flags&=~EXF_KEEPREF;
+            jc->varref=NULL;
+            Clearvalue(v);
+            *v=*--sp;
+            sp->type=VTP_UNDEFINED;
+            break;
+
+         case BC_INCMEMBER:
+            v=sp-1;
+            jc->elt=ip->elt;
+            if((jo=Objectvalue(jc,v))
+            && Member(jc,ip->elt,jo,bc->caches[ip->slot].name,FALSE,&bc->caches[ip->slot])
+            && jc->varref)
+            {  Increment(jc,jc->varref,ip->arg,v);
+            }
+            else
+            {  Clearvalue(v);
+            }
+            jc->flags&=~EXF_KEEPREF;
+            jc->varref=NULL;
+            break;
+
+         case BC_GETINDEX:
+            v=sp-2;
+            jc->elt=ip->elt;
+            Tostring(sp-1,jc);
+            if((jo=Objectvalue(jc,v))
+            && Member(jc,ip->elt,jo,sp[-1].value.svalue,FALSE,&bc->caches[ip->slot]))
+            {  Takeval(jc,v);
+            }
+            else
+            {  Clearvalue(v);
+            }
+            jc->flags&=~EXF_KEEPREF;
+            Clearvalue(--sp);
+            break;
+
+         case BC_SETINDEX:
+            v=sp-3;
+            jc->elt=ip->elt;
+            Tostring(sp-2,jc);
+            if((jo=Objectvalue(jc,v))
+            && Member(jc,ip->elt,jo,sp[-2].value.svalue,FALSE,&bc->caches[ip->slot])
+            && jc->varref)
+            {  Setvarvalue(jc,jc->varref,sp-1);
+            }
+            jc->flags&=~EXF_KEEPREF;
+            jc->varref=NULL;
+            Clearvalue(v);
+            Clearvalue(sp-2);
+            *v=*--sp;
+            sp->type=VTP_UNDEFINED;
+            sp--;
+            break;
+
+         case BC_INCINDEX:
+            v=sp-2;
+            jc->elt=ip->elt;
+            Tostring(sp-1,jc);
+            if((jo=Objectvalue(jc,v))
+            && Member(jc,ip->elt,jo,sp[-1].value.svalue,FALSE,&bc->caches[ip->slot])
+            && jc->varref)
+            {  Increment(jc,jc->varref,ip->arg,v);
+            }
+            else
+            {  Clearvalue(v);
+            }
+            jc->flags&=~EXF_KEEPREF;
+            jc->varref=NULL;
+            Clearvalue(--sp);
+            break;
+
+         case BC_BINARY:
+            v=--sp;
+            if(!(sp[-1].type==VTP_NUMBER && v->type==VTP_NUMBER
+            && sp[-1].attr==VNA_VALID && v->attr==VNA_VALID
+            && Numberop(ip->arg,sp-1,v)))
+            {  jc->elt=ip->elt;
+               Binaryop(jc,(UWORD)ip->arg,sp-1,v);
+               Takeval(jc,sp-1);
+            }
+            Clearvalue(v);
+            break;
+
+         case BC_UNARY:
+            Unaryop(jc,(UWORD)ip->arg,sp-1);
+            break;
+
+         case BC_JUMP:
+            ip=&bc->code[ip->arg];
+            continue;
+
+         case BC_JUMPFALSE:
+            v=--sp;
+            i=Truth(jc,v);
+            Clearvalue(v);
+            if(!i)
+            {  ip=&bc->code[ip->arg];
+               continue;
+            }
+            break;
+
+         case BC_AND:
+         case BC_OR:
+            i=Truth(jc,sp-1);
+            if((ip->op==BC_OR)?i:!i)
+            {  ip=&bc->code[ip->arg];
+               continue;
+            }
+            Clearvalue(--sp);
+            break;
+
+         case BC_LOOP:
+            /* Same check Executeelem() does for every element */
+            if(!Feedback(jc))
+            {  jc->flags|=EXF_STOP;
+               tc=jc;
+               while(tc=tc->truecontext)
+               {  tc->flags|=EXF_STOP;
+               }
+               break;
+            }
+            ip=&bc->code[ip->arg];
+            continue;
+
+         case BC_CALL:
+            v=sp-ip->arg-1;
+            jc->elt=ip->elt;
+            Callvalues(jc,ip->elt,v,v+1,ip->arg,jc->jthis);
+            while(sp>v+1) Clearvalue(--sp);
+            Takeval(jc,v);
+            break;
+
+         case BC_EVAL:
+            Executeelem(jc,ip->elt);
+            Takeval(jc,sp++);
+            break;
+
+         case BC_EXEC:
+            Executeelem(jc,ip->elt);
+            if(ip->slot && !jc->curlabel
+            && (jc->complete==ECO_BREAK || jc->complete==ECO_CONTINUE))
+            {  i=(jc->complete==ECO_BREAK)?bc->loops[ip->slot].brk:bc->loops[ip->slot].cont;
+               jc->complete=ECO_NORMAL;
+               ip=&bc->code[i];
+               continue;
+            }
+            break;
+
+         case BC_RETURN:
+            Putval(jc,--sp);
+            Asgvalue(&jc->functions.first->retval,jc->val);
+            jc->complete=ECO_RETURN;
+            break;
+
+         case BC_RETURNUNDEF:
+            Clearvalue(&jc->functions.first->retval);
+            jc->complete=ECO_RETURN;
+            break;
+      }
+      ip++;
+   }
+   for(i=0;i<bc->maxstack;i++) Clearvalue(&stack[i]);
+   jc->vmframe=frame.prev;
+   if(stack!=vstack) FREE(stack);
+   if(vm.slots!=vslots) FREE(vm.slots);
+}
@@ -23,6 +23,7 @@
 #include "tcperr.h"
 #include "window.h"
 #include "asyncio.h"
+#include "capack.h"
 #include "task.h"
 #include "form.h"
 #include <exec/ports.h>
@@ -952,6 +953,34 @@ static void GenerateVolumeListing(struct Fetchdriver *fd)
 
 /*-----------------------------------------------------------------------*/
 
+/* Cache reload of an object in a pack file. The object is checked before
+ * any of it is passed on. */
+static void Packfiletask(struct Fetchdriver *fd)
+{  UBYTE *buf;
+   long done,n;
+   if((buf=ALLOCTYPE(UBYTE,fd->packlength+1,0))
+   && Capackread(fd->name,fd->packoffset,fd->packlength,fd->packsum,buf))
+   {  Updatetaskattrs(AOURL_Contentlength,fd->packlength,TAG_END);
+      for(done=0;done<fd->packlength;done+=n)
+      {  n=MIN(fd->packlength-done,fd->blocksize);
+         memmove(fd->block,buf+done,n);
+         if(Checktaskbreak()) break;
+         Updatetaskattrs(
+            AOURL_Data,fd->block,
+            AOURL_Datalength,n,
+            TAG_END);
+      }
+   }
+   else
+   {  Tcperror(fd,TCPERR_NOFILE,fd->name);
+   }
+   if(buf) FREE(buf);
+   Updatetaskattrs(AOTSK_Async,TRUE,
+      AOURL_Eof,TRUE,
+      AOURL_Terminate,TRUE,
+      TAG_END);
+}
+
 void Localfiletask(struct Fetchdriver *fd)
 {  long lock;
    void *fh;
@@ -987,6 +1016,10 @@ void Localfiletask(struct Fetchdriver *fd)
          }
       }
    }
+   if(fd->flags&FDVF_CACHEPACK)
+   {  Packfiletask(fd);
+      return;
+   }
    name=fd->name;
    /* Check if this is root first - before trying index file */
    is_root=(name[0]=='\0' || 
@@ -65,6 +65,7 @@
 #define MSG_NWS_CPS 508
 #define MSG_NWS_NEWSGROUP 509
 #define MSG_NWS_UPLOAD 510
+#define MSG_NWS_TLSSESSIONS 511
 #define MSG_AUTH_TITLE 600
 #define MSG_AUTH_PROMPT 601
 #define MSG_AUTH_USERID 602
@@ -522,6 +523,7 @@
 #define MSG_NWS_CPS_STR "%ld cps"
 #define MSG_NWS_NEWSGROUP_STR "Scanning"
 #define MSG_NWS_UPLOAD_STR "Uploading"
+#define MSG_NWS_TLSSESSIONS_STR "TLS %ld resumed, %ld full"
 #define MSG_AUTH_TITLE_STR "Authorization"
 #define MSG_AUTH_PROMPT_STR "Userid and password required for"
 #define MSG_AUTH_USERID_STR "_Userid"
@@ -987,6 +989,7 @@ static const struct CatCompArrayType CatCompArray[] =
     {MSG_NWS_CPS,(STRPTR)MSG_NWS_CPS_STR},
     {MSG_NWS_NEWSGROUP,(STRPTR)MSG_NWS_NEWSGROUP_STR},
     {MSG_NWS_UPLOAD,(STRPTR)MSG_NWS_UPLOAD_STR},
+    {MSG_NWS_TLSSESSIONS,(STRPTR)MSG_NWS_TLSSESSIONS_STR},
     {MSG_AUTH_TITLE,(STRPTR)MSG_AUTH_TITLE_STR},
     {MSG_AUTH_PROMPT,(STRPTR)MSG_AUTH_PROMPT_STR},
     {MSG_AUTH_USERID,(STRPTR)MSG_AUTH_USERID_STR},
@@ -1480,6 +1483,8 @@ static const char CatCompBlock[] =
     MSG_NWS_NEWSGROUP_STR "\x00\x00"
     "\x00\x00\x01\xFE\x00\x0A"
     MSG_NWS_UPLOAD_STR "\x00"
+    "\x00\x00\x01\xFF\x00\x1A"
+    MSG_NWS_TLSSESSIONS_STR "\x00"
     "\x00\x00\x02\x58\x00\x0E"
     MSG_AUTH_TITLE_STR "\x00"
     "\x00\x00\x02\x59\x00\x22"
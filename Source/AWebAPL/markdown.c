@@ -25,30 +25,11 @@
 #include "application.h"
 #include "docprivate.h"
 
-#define MAXATTRS 40
-static struct Tagattr tagattr[MAXATTRS];
-
-static LIST(Tagattr) attrs;
-static short nextattr;
-
 /* Forward declarations */
-static struct Tagattr *Nextattr(struct Document *doc);
 static BOOL ProcessMarkdownLine(struct Document *doc, UBYTE *line, long length, USHORT *list_state, BOOL *in_paragraph);
 static BOOL ProcessMarkdownText(struct Document *doc, UBYTE *text, long length);
 static void EscapeHtmlEntities(struct Document *doc, UBYTE *text, long length);
 
-/* Get next attribute structure */
-static struct Tagattr *Nextattr(struct Document *doc)
-{  struct Tagattr *ta;
-   if(nextattr==MAXATTRS) REMOVE(&tagattr[--nextattr]);
-   ta=&tagattr[nextattr++];
-   ADDTAIL(&attrs,ta);
-   ta->attr=0;
-   ta->valuepos=doc->args.length;
-   ta->length=0;
-   return ta;
-}
-
 /* Escape HTML entities in text */
 static void EscapeHtmlEntities(struct Document *doc, UBYTE *text, long length)
 {  UBYTE *p, *end;
@@ -128,9 +109,8 @@ static BOOL ProcessMarkdownText(struct Document *doc, UBYTE *text, long length)
                      EscapeHtmlEntities(doc,start,img_start-start);
                      ta->length=doc->args.length-ta->valuepos;
                      if(!Addtobuffer(&doc->args,"",1)) return FALSE;
-                     Processhtml(doc,MARKUP_TEXT,attrs.first);
-                     NEWLIST(&attrs);
-                     nextattr=0;
+                     Processhtml(doc,MARKUP_TEXT,doc->attrs.first);
+                     Resetattrs(doc);
                      doc->args.length=0;
                   }
                   /* Output image */
@@ -144,9 +124,8 @@ static BOOL ProcessMarkdownText(struct Document *doc, UBYTE *text, long length)
                   if(!Addtobuffer(&doc->args,img_url_start,img_url_end-img_url_start)) return FALSE;
                   ta->length=img_url_end-img_url_start;
                   if(!Addtobuffer(&doc->args,"",1)) return FALSE;
-                  Processhtml(doc,MARKUP_IMG,attrs.first);
-                  NEWLIST(&attrs);
-                  nextattr=0;
+                  Processhtml(doc,MARKUP_IMG,doc->attrs.first);
+                  Resetattrs(doc);
                   doc->args.length=0;
                   start=p;
                   continue;
@@ -189,9 +168,8 @@ static BOOL ProcessMarkdownText(struct Document *doc, UBYTE *text, long length)
                      EscapeHtmlEntities(doc,start,link_start-start);
                      ta->length=doc->args.length-ta->valuepos;
                      if(!Addtobuffer(&doc->args,"",1)) return FALSE;
-                     Processhtml(doc,MARKUP_TEXT,attrs.first);
-                     NEWLIST(&attrs);
-                     nextattr=0;
+                     Processhtml(doc,MARKUP_TEXT,doc->attrs.first);
+                     Resetattrs(doc);
                      doc->args.length=0;
                   }
                   /* Output link */
@@ -201,18 +179,15 @@ static BOOL ProcessMarkdownText(struct Document *doc, UBYTE *text, long length)
                   ta->length=link_url_end-link_url_start;
                   if(!Addtobuffer(&doc->args,"",1)) return FALSE;
                   /* Open link tag */
-                  Processhtml(doc,MARKUP_A,attrs.first);
+                  Processhtml(doc,MARKUP_A,doc->attrs.first);
                   /* Recursively process link text (may contain formatting) */
-                  NEWLIST(&attrs);
-                  nextattr=0;
+                  Resetattrs(doc);
                   doc->args.length=0;
                   if(!ProcessMarkdownText(doc,link_text_start,link_text_end-link_text_start)) return FALSE;
                   /* Close link tag */
-                  NEWLIST(&attrs);
-                  nextattr=0;
-                  Processhtml(doc,MARKUP_A|MARKUP_END,attrs.first);
-                  NEWLIST(&attrs);
-                  nextattr=0;
+                  Resetattrs(doc);
+                  Processhtml(doc,MARKUP_A|MARKUP_END,doc->attrs.first);
+                  Resetattrs(doc);
                   doc->args.length=0;
                   start=p;
                   continue;
@@ -230,9 +205,8 @@ static BOOL ProcessMarkdownText(struct Document *doc, UBYTE *text, long length)
             EscapeHtmlEntities(doc,start,p-start);
             ta->length=doc->args.length-ta->valuepos;
             if(!Addtobuffer(&doc->args,"",1)) return FALSE;
-            Processhtml(doc,MARKUP_TEXT,attrs.first);
-            NEWLIST(&attrs);
-            nextattr=0;
+            Processhtml(doc,MARKUP_TEXT,doc->attrs.first);
+            Resetattrs(doc);
             doc->args.length=0;
          }
          code_start=++p;
@@ -241,25 +215,21 @@ static BOOL ProcessMarkdownText(struct Document *doc, UBYTE *text, long length)
          {  code_end=p;
             p++;
             /* Open code tag */
-            NEWLIST(&attrs);
-            nextattr=0;
-            Processhtml(doc,MARKUP_CODE,attrs.first);
+            Resetattrs(doc);
+            Processhtml(doc,MARKUP_CODE,doc->attrs.first);
             /* Output code text */
-            NEWLIST(&attrs);
-            nextattr=0;
+            Resetattrs(doc);
             doc->args.length=0;
             ta=Nextattr(doc);
             ta->attr=TAGATTR_TEXT;
             if(!Addtobuffer(&doc->args,code_start,code_end-code_start)) return FALSE;
             ta->length=code_end-code_start;
             if(!Addtobuffer(&doc->args,"",1)) return FALSE;
-            Processhtml(doc,MARKUP_TEXT,attrs.first);
+            Processhtml(doc,MARKUP_TEXT,doc->attrs.first);
             /* Close code tag */
-            NEWLIST(&attrs);
-            nextattr=0;
-            Processhtml(doc,MARKUP_CODE|MARKUP_END,attrs.first);
-            NEWLIST(&attrs);
-            nextattr=0;
+            Resetattrs(doc);
+            Processhtml(doc,MARKUP_CODE|MARKUP_END,doc->attrs.first);
+            Resetattrs(doc);
             doc->args.length=0;
             start=p;
          }
@@ -283,9 +253,8 @@ static BOOL ProcessMarkdownText(struct Document *doc, UBYTE *text, long length)
             EscapeHtmlEntities(doc,start,p-start);
             ta->length=doc->args.length-ta->valuepos;
             if(!Addtobuffer(&doc->args,"",1)) return FALSE;
-            Processhtml(doc,MARKUP_TEXT,attrs.first);
-            NEWLIST(&attrs);
-            nextattr=0;
+            Processhtml(doc,MARKUP_TEXT,doc->attrs.first);
+            Resetattrs(doc);
             doc->args.length=0;
          }
          bold_start=p+2;
@@ -296,17 +265,14 @@ static BOOL ProcessMarkdownText(struct Document *doc, UBYTE *text, long length)
          {  bold_end=p;
             p+=2;
             /* Open bold tag */
-            NEWLIST(&attrs);
-            nextattr=0;
-            Processhtml(doc,MARKUP_STRONG,attrs.first);
+            Resetattrs(doc);
+            Processhtml(doc,MARKUP_STRONG,doc->attrs.first);
             /* Recursively process bold text content (may contain italic, links, etc.) */
             if(!ProcessMarkdownText(doc,bold_start,bold_end-bold_start)) return FALSE;
             /* Close bold tag */
-            NEWLIST(&attrs);
-            nextattr=0;
-            Processhtml(doc,MARKUP_STRONG|MARKUP_END,attrs.first);
-            NEWLIST(&attrs);
-            nextattr=0;
+            Resetattrs(doc);
+            Processhtml(doc,MARKUP_STRONG|MARKUP_END,doc->attrs.first);
+            Resetattrs(doc);
             doc->args.length=0;
             start=p;
          }
@@ -334,26 +300,22 @@ static BOOL ProcessMarkdownText(struct Document *doc, UBYTE *text, long length)
                EscapeHtmlEntities(doc,start,p-start);
                ta->length=doc->args.length-ta->valuepos;
                if(!Addtobuffer(&doc->args,"",1)) return FALSE;
-               Processhtml(doc,MARKUP_TEXT,attrs.first);
-               NEWLIST(&attrs);
-               nextattr=0;
+               Processhtml(doc,MARKUP_TEXT,doc->attrs.first);
+               Resetattrs(doc);
                doc->args.length=0;
             }
             italic_start=p+1;
             italic_end=next;
             p=next+1;
             /* Open italic tag */
-            NEWLIST(&attrs);
-            nextattr=0;
-            Processhtml(doc,MARKUP_EM,attrs.first);
+            Resetattrs(doc);
+            Processhtml(doc,MARKUP_EM,doc->attrs.first);
             /* Recursively process italic text content (may contain bold, links, etc.) */
             if(!ProcessMarkdownText(doc,italic_start,italic_end-italic_start)) return FALSE;
             /* Close italic tag */
-            NEWLIST(&attrs);
-            nextattr=0;
-            Processhtml(doc,MARKUP_EM|MARKUP_END,attrs.first);
-            NEWLIST(&attrs);
-            nextattr=0;
+            Resetattrs(doc);
+            Processhtml(doc,MARKUP_EM|MARKUP_END,doc->attrs.first);
+            Resetattrs(doc);
             doc->args.length=0;
             start=p;
          }
@@ -374,9 +336,8 @@ static BOOL ProcessMarkdownText(struct Document *doc, UBYTE *text, long length)
       EscapeHtmlEntities(doc,start,p-start);
       ta->length=doc->args.length-ta->valuepos;
       if(!Addtobuffer(&doc->args,"",1)) return FALSE;
-      Processhtml(doc,MARKUP_TEXT,attrs.first);
-      NEWLIST(&attrs);
-      nextattr=0;
+      Processhtml(doc,MARKUP_TEXT,doc->attrs.first);
+      Resetattrs(doc);
       doc->args.length=0;
    }
    
@@ -413,9 +374,8 @@ static BOOL ProcessMarkdownLine(struct Document *doc, UBYTE *line, long length,
       {  /* Valid header */
          /* Close any open paragraph */
          if(*in_paragraph)
-         {  NEWLIST(&attrs);
-            nextattr=0;
-            Processhtml(doc,MARKUP_P|MARKUP_END,attrs.first);
+         {  Resetattrs(doc);
+            Processhtml(doc,MARKUP_P|MARKUP_END,doc->attrs.first);
             *in_paragraph=FALSE;
          }
          p++;
@@ -427,31 +387,28 @@ static BOOL ProcessMarkdownLine(struct Document *doc, UBYTE *line, long length,
             while(header_end>header_text && isspace(header_end[-1])) header_end--;
             
             /* Open header tag */
-            NEWLIST(&attrs);
-            nextattr=0;
+            Resetattrs(doc);
             switch(header_level)
-            {  case 1: Processhtml(doc,MARKUP_H1,attrs.first); break;
-               case 2: Processhtml(doc,MARKUP_H2,attrs.first); break;
-               case 3: Processhtml(doc,MARKUP_H3,attrs.first); break;
-               case 4: Processhtml(doc,MARKUP_H4,attrs.first); break;
-               case 5: Processhtml(doc,MARKUP_H5,attrs.first); break;
-               case 6: Processhtml(doc,MARKUP_H6,attrs.first); break;
+            {  case 1: Processhtml(doc,MARKUP_H1,doc->attrs.first); break;
+               case 2: Processhtml(doc,MARKUP_H2,doc->attrs.first); break;
+               case 3: Processhtml(doc,MARKUP_H3,doc->attrs.first); break;
+               case 4: Processhtml(doc,MARKUP_H4,doc->attrs.first); break;
+               case 5: Processhtml(doc,MARKUP_H5,doc->attrs.first); break;
+               case 6: Processhtml(doc,MARKUP_H6,doc->attrs.first); break;
             }
             /* Recursively process header text (may contain formatting) */
-            NEWLIST(&attrs);
-            nextattr=0;
+            Resetattrs(doc);
             doc->args.length=0;
             if(!ProcessMarkdownText(doc,header_text,header_end-header_text)) return FALSE;
             /* Close header tag */
-            NEWLIST(&attrs);
-            nextattr=0;
+            Resetattrs(doc);
             switch(header_level)
-            {  case 1: Processhtml(doc,MARKUP_H1|MARKUP_END,attrs.first); break;
-               case 2: Processhtml(doc,MARKUP_H2|MARKUP_END,attrs.first); break;
-               case 3: Processhtml(doc,MARKUP_H3|MARKUP_END,attrs.first); break;
-               case 4: Processhtml(doc,MARKUP_H4|MARKUP_END,attrs.first); break;
-               case 5: Processhtml(doc,MARKUP_H5|MARKUP_END,attrs.first); break;
-               case 6: Processhtml(doc,MARKUP_H6|MARKUP_END,attrs.first); break;
+            {  case 1: Processhtml(doc,MARKUP_H1|MARKUP_END,doc->attrs.first); break;
+               case 2: Processhtml(doc,MARKUP_H2|MARKUP_END,doc->attrs.first); break;
+               case 3: Processhtml(doc,MARKUP_H3|MARKUP_END,doc->attrs.first); break;
+               case 4: Processhtml(doc,MARKUP_H4|MARKUP_END,doc->attrs.first); break;
+               case 5: Processhtml(doc,MARKUP_H5|MARKUP_END,doc->attrs.first); break;
+               case 6: Processhtml(doc,MARKUP_H6|MARKUP_END,doc->attrs.first); break;
             }
             return TRUE;
          }
@@ -473,14 +430,12 @@ static BOOL ProcessMarkdownLine(struct Document *doc, UBYTE *line, long length,
       if(is_hr)
       {  /* Close any open paragraph */
          if(*in_paragraph)
-         {  NEWLIST(&attrs);
-            nextattr=0;
-            Processhtml(doc,MARKUP_P|MARKUP_END,attrs.first);
+         {  Resetattrs(doc);
+            Processhtml(doc,MARKUP_P|MARKUP_END,doc->attrs.first);
             *in_paragraph=FALSE;
          }
-         NEWLIST(&attrs);
-         nextattr=0;
-         Processhtml(doc,MARKUP_HR,attrs.first);
+         Resetattrs(doc);
+         Processhtml(doc,MARKUP_HR,doc->attrs.first);
          return TRUE;
       }
    }
@@ -489,27 +444,23 @@ static BOOL ProcessMarkdownLine(struct Document *doc, UBYTE *line, long length,
    if(*p=='>')
    {  /* Close any open paragraph */
       if(*in_paragraph)
-      {  NEWLIST(&attrs);
-         nextattr=0;
-         Processhtml(doc,MARKUP_P|MARKUP_END,attrs.first);
+      {  Resetattrs(doc);
+         Processhtml(doc,MARKUP_P|MARKUP_END,doc->attrs.first);
          *in_paragraph=FALSE;
       }
       p++;
       while(p<end && isspace(*p)) p++;
       if(p<end)
       {  /* Open blockquote tag */
-         NEWLIST(&attrs);
-         nextattr=0;
-         Processhtml(doc,MARKUP_BLOCKQUOTE,attrs.first);
+         Resetattrs(doc);
+         Processhtml(doc,MARKUP_BLOCKQUOTE,doc->attrs.first);
          /* Recursively process blockquote text */
-         NEWLIST(&attrs);
-         nextattr=0;
+         Resetattrs(doc);
          doc->args.length=0;
          if(!ProcessMarkdownText(doc,p,end-p)) return FALSE;
          /* Close blockquote tag */
-         NEWLIST(&attrs);
-         nextattr=0;
-         Processhtml(doc,MARKUP_BLOCKQUOTE|MARKUP_END,attrs.first);
+         Resetattrs(doc);
+         Processhtml(doc,MARKUP_BLOCKQUOTE|MARKUP_END,doc->attrs.first);
          return TRUE;
       }
    }
@@ -525,29 +476,24 @@ static BOOL ProcessMarkdownLine(struct Document *doc, UBYTE *line, long length,
          if(*list_state!=1)
          {  if(*list_state!=0)
             {  /* Close previous list */
-               NEWLIST(&attrs);
-               nextattr=0;
-               Processhtml(doc,MARKUP_UL|MARKUP_END,attrs.first);
+               Resetattrs(doc);
+               Processhtml(doc,MARKUP_UL|MARKUP_END,doc->attrs.first);
             }
             /* Open unordered list */
-            NEWLIST(&attrs);
-            nextattr=0;
-            Processhtml(doc,MARKUP_UL,attrs.first);
+            Resetattrs(doc);
+            Processhtml(doc,MARKUP_UL,doc->attrs.first);
             *list_state=1;
          }
          /* Open list item */
-         NEWLIST(&attrs);
-         nextattr=0;
-         Processhtml(doc,MARKUP_LI,attrs.first);
+         Resetattrs(doc);
+         Processhtml(doc,MARKUP_LI,doc->attrs.first);
          /* Process list item content */
-         NEWLIST(&attrs);
-         nextattr=0;
+         Resetattrs(doc);
          doc->args.length=0;
          if(!ProcessMarkdownText(doc,p,end-p)) return FALSE;
          /* Close list item */
-         NEWLIST(&attrs);
-         nextattr=0;
-         Processhtml(doc,MARKUP_LI|MARKUP_END,attrs.first);
+         Resetattrs(doc);
+         Processhtml(doc,MARKUP_LI|MARKUP_END,doc->attrs.first);
          return TRUE;
       }
    }
@@ -566,34 +512,29 @@ static BOOL ProcessMarkdownLine(struct Document *doc, UBYTE *line, long length,
             if(*list_state!=2)
             {  if(*list_state!=0)
                {  /* Close previous list */
-                  NEWLIST(&attrs);
-                  nextattr=0;
+                  Resetattrs(doc);
                   if(*list_state==1)
-                  {  Processhtml(doc,MARKUP_UL|MARKUP_END,attrs.first);
+                  {  Processhtml(doc,MARKUP_UL|MARKUP_END,doc->attrs.first);
                   }
                   else if(*list_state==2)
-                  {  Processhtml(doc,MARKUP_OL|MARKUP_END,attrs.first);
+                  {  Processhtml(doc,MARKUP_OL|MARKUP_END,doc->attrs.first);
                   }
                }
             /* Open ordered list */
-            NEWLIST(&attrs);
-            nextattr=0;
-            Processhtml(doc,MARKUP_OL,attrs.first);
+            Resetattrs(doc);
+            Processhtml(doc,MARKUP_OL,doc->attrs.first);
             *list_state=2;
          }
          /* Open list item */
-         NEWLIST(&attrs);
-         nextattr=0;
-         Processhtml(doc,MARKUP_LI,attrs.first);
+         Resetattrs(doc);
+         Processhtml(doc,MARKUP_LI,doc->attrs.first);
          /* Process list item content */
-         NEWLIST(&attrs);
-         nextattr=0;
+         Resetattrs(doc);
          doc->args.length=0;
          if(!ProcessMarkdownText(doc,p,end-p)) return FALSE;
          /* Close list item */
-         NEWLIST(&attrs);
-         nextattr=0;
-         Processhtml(doc,MARKUP_LI|MARKUP_END,attrs.first);
+         Resetattrs(doc);
+         Processhtml(doc,MARKUP_LI|MARKUP_END,doc->attrs.first);
          return TRUE;
          }
       }
@@ -602,13 +543,12 @@ static BOOL ProcessMarkdownLine(struct Document *doc, UBYTE *line, long length,
    
    /* Not a list item - close list if open */
    if(*list_state!=0 && !is_list_item)
-   {  NEWLIST(&attrs);
-      nextattr=0;
+   {  Resetattrs(doc);
       if(*list_state==1)
-      {  Processhtml(doc,MARKUP_UL|MARKUP_END,attrs.first);
+      {  Processhtml(doc,MARKUP_UL|MARKUP_END,doc->attrs.first);
       }
       else if(*list_state==2)
-      {  Processhtml(doc,MARKUP_OL|MARKUP_END,attrs.first);
+      {  Processhtml(doc,MARKUP_OL|MARKUP_END,doc->attrs.first);
       }
       *list_state=0;
    }
@@ -623,9 +563,8 @@ static BOOL ProcessMarkdownLine(struct Document *doc, UBYTE *line, long length,
    {  UBYTE *code_start;
       /* Close any open paragraph */
       if(*in_paragraph)
-      {  NEWLIST(&attrs);
-         nextattr=0;
-         Processhtml(doc,MARKUP_P|MARKUP_END,attrs.first);
+      {  Resetattrs(doc);
+         Processhtml(doc,MARKUP_P|MARKUP_END,doc->attrs.first);
          *in_paragraph=FALSE;
       }
       if(*p=='\t')
@@ -637,23 +576,20 @@ static BOOL ProcessMarkdownLine(struct Document *doc, UBYTE *line, long length,
       while(code_start<end && isspace(*code_start)) code_start++;
       if(code_start<end)
       {  /* Open pre tag for code block */
-         NEWLIST(&attrs);
-         nextattr=0;
-         Processhtml(doc,MARKUP_PRE,attrs.first);
+         Resetattrs(doc);
+         Processhtml(doc,MARKUP_PRE,doc->attrs.first);
          /* Output code block text */
-         NEWLIST(&attrs);
-         nextattr=0;
+         Resetattrs(doc);
          doc->args.length=0;
          ta=Nextattr(doc);
          ta->attr=TAGATTR_TEXT;
          if(!Addtobuffer(&doc->args,code_start,end-code_start)) return FALSE;
          ta->length=end-code_start;
          if(!Addtobuffer(&doc->args,"",1)) return FALSE;
-         Processhtml(doc,MARKUP_TEXT,attrs.first);
+         Processhtml(doc,MARKUP_TEXT,doc->attrs.first);
          /* Close pre tag */
-         NEWLIST(&attrs);
-         nextattr=0;
-         Processhtml(doc,MARKUP_PRE|MARKUP_END,attrs.first);
+         Resetattrs(doc);
+         Processhtml(doc,MARKUP_PRE|MARKUP_END,doc->attrs.first);
          return TRUE;
       }
    }
@@ -661,14 +597,12 @@ static BOOL ProcessMarkdownLine(struct Document *doc, UBYTE *line, long length,
    /* Regular paragraph text */
    /* Open paragraph tag if not already open */
    if(!*in_paragraph)
-   {  NEWLIST(&attrs);
-      nextattr=0;
-      Processhtml(doc,MARKUP_P,attrs.first);
+   {  Resetattrs(doc);
+      Processhtml(doc,MARKUP_P,doc->attrs.first);
       *in_paragraph=TRUE;
    }
    /* Recursively process paragraph text */
-   NEWLIST(&attrs);
-   nextattr=0;
+   Resetattrs(doc);
    doc->args.length=0;
    if(!ProcessMarkdownText(doc,start,end-start)) return FALSE;
    /* Note: Don't close paragraph here - it will be closed on empty line or block element */
@@ -689,8 +623,7 @@ BOOL Parsemarkdown(struct Document *doc,struct Buffer *src,BOOL eof,long *srcpos
    if((*srcpos)==0)
    {  while(p<end && !*p) p++;
       *srcpos=p-src->buffer;
-      NEWLIST(&attrs);
-      nextattr=0;
+      Resetattrs(doc);
       in_fenced_code=FALSE;  /* Reset on new document */
       in_paragraph=FALSE;  /* Reset on new document */
    }
@@ -715,9 +648,8 @@ BOOL Parsemarkdown(struct Document *doc,struct Buffer *src,BOOL eof,long *srcpos
          
          /* If empty line, close any open paragraph */
          if(is_empty_line && in_paragraph)
-         {  NEWLIST(&attrs);
-            nextattr=0;
-            Processhtml(doc,MARKUP_P|MARKUP_END,attrs.first);
+         {  Resetattrs(doc);
+            Processhtml(doc,MARKUP_P|MARKUP_END,doc->attrs.first);
             in_paragraph=FALSE;
          }
          
@@ -733,43 +665,38 @@ BOOL Parsemarkdown(struct Document *doc,struct Buffer *src,BOOL eof,long *srcpos
             if(is_fenced)
             {  if(in_fenced_code)
             {  /* Close fenced code block */
-               NEWLIST(&attrs);
-               nextattr=0;
-               Processhtml(doc,MARKUP_PRE|MARKUP_END,attrs.first);
+               Resetattrs(doc);
+               Processhtml(doc,MARKUP_PRE|MARKUP_END,doc->attrs.first);
                in_fenced_code=FALSE;
             }
             else
             {  /* Open fenced code block */
                /* Close any open paragraph */
                if(in_paragraph)
-               {  NEWLIST(&attrs);
-                  nextattr=0;
-                  Processhtml(doc,MARKUP_P|MARKUP_END,attrs.first);
+               {  Resetattrs(doc);
+                  Processhtml(doc,MARKUP_P|MARKUP_END,doc->attrs.first);
                   in_paragraph=FALSE;
                }
                /* Close any open list first */
                if(list_state!=0)
-               {  NEWLIST(&attrs);
-                  nextattr=0;
+               {  Resetattrs(doc);
                   if(list_state==1)
-                  {  Processhtml(doc,MARKUP_UL|MARKUP_END,attrs.first);
+                  {  Processhtml(doc,MARKUP_UL|MARKUP_END,doc->attrs.first);
                   }
                   else if(list_state==2)
-                  {  Processhtml(doc,MARKUP_OL|MARKUP_END,attrs.first);
+                  {  Processhtml(doc,MARKUP_OL|MARKUP_END,doc->attrs.first);
                   }
                   list_state=0;
                }
-               NEWLIST(&attrs);
-               nextattr=0;
-               Processhtml(doc,MARKUP_PRE,attrs.first);
+               Resetattrs(doc);
+               Processhtml(doc,MARKUP_PRE,doc->attrs.first);
                in_fenced_code=TRUE;
             }
             }
          }
          else if(in_fenced_code)
          {  /* Inside fenced code block - output line as-is */
-            NEWLIST(&attrs);
-            nextattr=0;
+            Resetattrs(doc);
             doc->args.length=0;
             ta=Nextattr(doc);
             ta->attr=TAGATTR_TEXT;
@@ -777,7 +704,7 @@ BOOL Parsemarkdown(struct Document *doc,struct Buffer *src,BOOL eof,long *srcpos
             ta->length=line_length;
             if(!Addtobuffer(&doc->args,"\n",1)) return FALSE;
             ta->length++;
-            Processhtml(doc,MARKUP_TEXT,attrs.first);
+            Processhtml(doc,MARKUP_TEXT,doc->attrs.first);
          }
          else if(!is_empty_line)
          {  /* Process the line normally */
@@ -816,21 +743,19 @@ BOOL Parsemarkdown(struct Document *doc,struct Buffer *src,BOOL eof,long *srcpos
    
    /* Close any open list at EOF */
    if(eof && list_state!=0)
-   {  NEWLIST(&attrs);
-      nextattr=0;
+   {  Resetattrs(doc);
       if(list_state==1)
-      {  Processhtml(doc,MARKUP_UL|MARKUP_END,attrs.first);
+      {  Processhtml(doc,MARKUP_UL|MARKUP_END,doc->attrs.first);
       }
       else if(list_state==2)
-      {  Processhtml(doc,MARKUP_OL|MARKUP_END,attrs.first);
+      {  Processhtml(doc,MARKUP_OL|MARKUP_END,doc->attrs.first);
       }
    }
    
    /* Close any open paragraph at EOF */
    if(eof && in_paragraph)
-   {  NEWLIST(&attrs);
-      nextattr=0;
-      Processhtml(doc,MARKUP_P|MARKUP_END,attrs.first);
+   {  Resetattrs(doc);
+      Processhtml(doc,MARKUP_P|MARKUP_END,doc->attrs.first);
       in_paragraph=FALSE;
    }
    
@@ -20,32 +20,81 @@
 
 #include <netdb.h>
 #include <proto/exec.h>
+#include <proto/dos.h>
 #include <proto/utility.h>
 #include <proto/timer.h>
 #include <dos/dos.h>
 #include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+#include <ctype.h>
 #include "aweb.h"
+#include "task.h"
 #include "awebtcp.h"
 
 /* Shared debug logging semaphore - defined in http.c, declared here */
 extern struct SignalSemaphore debug_log_sema;
 extern BOOL debug_log_sema_initialized;
 
+/* Names are kept in a hash table. An entry is either being resolved (HNF_BUSY,
+ * the resolving task holds its semaphore), has a list of addresses, or records
+ * a failed lookup. Other tasks looking up a busy name wait on its semaphore
+ * and use the result. Entries expire after some time and are then resolved
+ * again by the first task that asks for them.
+ * Callers keep the hostent pointer, so an entry with addresses is never freed
+ * until Freenameserv(). If a new lookup returns different addresses, a new
+ * entry replaces the old one in the table and the old one is kept in the
+ * retired list. If it fails, the entry keeps its addresses. */
+
+#define NAMEHASHSIZE    64       /* Nr of hash buckets, power of 2 */
+#define NAMEMAXADDR     8        /* Max nr of addresses kept per name */
+#define NAMEMAXENTRIES  256      /* Purge failed entries when more than this */
+#define NAMETTL         600      /* Seconds to keep a resolved name */
+#define NAMENEGTTL      30       /* Seconds to remember a failed lookup */
+#define NAMEMAXPREFETCH 16       /* Max nr of names queued for prefetching */
+
 struct Hostname
-{  NODE(Hostname);
+{  NODE(Hostname);            /* In retired list */
+   struct Hostname *hashnext; /* Next in hash bucket */
+   ULONG hash;
+   UBYTE *name;               /* requested name */
+   UBYTE *hostname;           /* official host name */
+   ULONG expires;             /* Time when this entry must be resolved again */
+   USHORT flags;
+   short naddr;               /* Nr of addresses, 0 for a failed lookup */
+   short waiters;             /* Nr of tasks waiting for the semaphore */
+   struct SignalSemaphore sema;  /* Held by the task resolving this name */
    struct hostent hent;
-   UBYTE *hostname;        /* official host name */
-   UBYTE *name;            /* requested name */
-   UBYTE *addrp;           /* points to addr */
-   UBYTE *nullp;           /* terminates list */
-   UBYTE addr[4];          /* internet address */
+   UBYTE *addrp[NAMEMAXADDR+1];  /* Address list, NULL terminated */
+   UBYTE addr[NAMEMAXADDR][4];   /* internet addresses */
+};
+
+#define HNF_BUSY     0x0001   /* Being resolved */
+#define HNF_DEAD     0x0002   /* Abandoned, free when last waiter is done */
+
+struct Prefetch
+{  NODE(Prefetch);
+   UBYTE *name;
 };
 
-static LIST(Hostname) names;
+static struct Hostname *names[NAMEHASHSIZE];
+static LIST(Hostname) retired;
+static long nrnames;
 static BOOL inited;
 
 static struct SignalSemaphore namesema;
 
+static Nameresolver *resolver;
+static long namettl=NAMETTL,namenegttl=NAMENEGTTL;
+
+#ifndef LOCALONLY
+static void *prefetchtask;
+static struct Task *prefetchproc;
+static ULONG prefetchmask;
+static LIST(Prefetch) prefetches;
+static long nrprefetches;
+#endif
+
 /* Helper function to get Task ID for logging */
 static ULONG get_task_id(void)
 {  struct Task *task;
@@ -81,112 +130,417 @@ static void debug_printf(const char *format, ...)
 
 /*-----------------------------------------------------------------------*/
 
+/* Current time in seconds */
+static ULONG Namesecs(void)
+{  struct DateStamp ds;
+   DateStamp(&ds);
+   return (ULONG)(ds.ds_Days*86400+ds.ds_Minute*60+ds.ds_Tick/TICKS_PER_SECOND);
+}
+
+static ULONG Namehash(UBYTE *name)
+{  ULONG hash=2166136261UL;
+   for(;*name;name++)
+   {  hash^=(ULONG)tolower(*name);
+      hash*=16777619UL;
+   }
+   return hash;
+}
+
+/* Find the entry for this name. Must be called with namesema obtained. */
+static struct Hostname *Findname(UBYTE *name,ULONG hash)
+{  struct Hostname *hn;
+   for(hn=names[hash&(NAMEHASHSIZE-1)];hn;hn=hn->hashnext)
+   {  if(hn->hash==hash && STRIEQUAL(hn->name,name)) break;
+   }
+   return hn;
+}
+
+static void Unlinkname(struct Hostname *hn)
+{  struct Hostname **p;
+   for(p=&names[hn->hash&(NAMEHASHSIZE-1)];*p;p=&(*p)->hashnext)
+   {  if(*p==hn)
+      {  *p=hn->hashnext;
+         nrnames--;
+         break;
+      }
+   }
+}
+
+static void Freename(struct Hostname *hn)
+{  if(hn->name) FREE(hn->name);
+   if(hn->hostname) FREE(hn->hostname);
+   FREE(hn);
+}
+
+/* Forget failed lookups that have expired, when the table grows large. */
+static void Purgenames(ULONG now)
+{  struct Hostname **p,*hn;
+   short i;
+   for(i=0;i<NAMEHASHSIZE;i++)
+   {  for(p=&names[i];hn=*p;)
+      {  if(!hn->naddr && !(hn->flags&HNF_BUSY) && !hn->waiters && hn->expires<=now)
+         {  *p=hn->hashnext;
+            nrnames--;
+            Freename(hn);
+         }
+         else p=&hn->hashnext;
+      }
+   }
+}
+
+/* Create a new busy entry, owned by this task. Must be called with
+ * namesema obtained. */
+static struct Hostname *Newname(UBYTE *name,ULONG hash)
+{  struct Hostname *hn;
+   if(hn=ALLOCSTRUCT(Hostname,1,MEMF_CLEAR|MEMF_PUBLIC))
+   {  if(hn->name=Dupstr(name,-1))
+      {  hn->hash=hash;
+         hn->flags=HNF_BUSY;
+         InitSemaphore(&hn->sema);
+         ObtainSemaphore(&hn->sema);
+         if(nrnames>=NAMEMAXENTRIES) Purgenames(Namesecs());
+         hn->hashnext=names[hash&(NAMEHASHSIZE-1)];
+         names[hash&(NAMEHASHSIZE-1)]=hn;
+         nrnames++;
+      }
+      else
+      {  FREE(hn);
+         hn=NULL;
+      }
+   }
+   return hn;
+}
+
+/* Copy the addresses from this hostent. Returns the number of addresses. */
+static short Copyaddrs(struct Hostname *hn,struct hostent *hent)
+{  short n;
+   for(n=0;n<NAMEMAXADDR && hent->h_addr_list[n];n++)
+   {  memcpy(hn->addr[n],hent->h_addr_list[n],4);
+      hn->addrp[n]=hn->addr[n];
+   }
+   hn->addrp[n]=NULL;
+   hn->hent.h_name=hn->hostname;
+   hn->hent.h_aliases=NULL;
+   hn->hent.h_addrtype=hent->h_addrtype;
+   hn->hent.h_length=4;
+   hn->hent.h_addr_list=(char **)hn->addrp;
+   return n;
+}
+
+/* See if the addresses in this hostent are the same as we already have */
+static BOOL Sameaddrs(struct Hostname *hn,struct hostent *hent)
+{  short i,j,n;
+   for(n=0;n<NAMEMAXADDR && hent->h_addr_list[n];n++);
+   if(n!=hn->naddr) return FALSE;
+   for(i=0;i<n;i++)
+   {  for(j=0;j<n;j++)
+      {  if(!memcmp(hent->h_addr_list[i],hn->addr[j],4)) break;
+      }
+      if(j>=n) return FALSE;
+   }
+   return TRUE;
+}
+
+/* Store the result of resolving this busy entry and let waiting tasks go.
+ * Returns the entry that now holds the result. */
+static struct Hostname *Resolvedname(struct Hostname *hn,struct hostent *hent)
+{  struct Hostname *old=NULL;
+   BOOL valid=(hent && hent->h_name && hent->h_addr_list && hent->h_addr_list[0]
+      && hent->h_length==4);
+   ObtainSemaphore(&namesema);
+   if(hn->naddr && valid && !Sameaddrs(hn,hent))
+   {  /* Addresses have changed. Keep the old entry for tasks still using it,
+       * and put a new one in the table. Waiting tasks find the new one. */
+      old=hn;
+      if(hn=ALLOCSTRUCT(Hostname,1,MEMF_CLEAR|MEMF_PUBLIC))
+      {  hn->name=old->name;
+         old->name=NULL;
+         hn->hash=old->hash;
+         hn->hashnext=old->hashnext;
+         InitSemaphore(&hn->sema);
+      }
+      Unlinkname(old);
+      if(hn)
+      {  hn->hashnext=names[hn->hash&(NAMEHASHSIZE-1)];
+         names[hn->hash&(NAMEHASHSIZE-1)]=hn;
+         nrnames++;
+      }
+      ADDTAIL(&retired,old);
+   }
+   if(hn)
+   {  if(valid)
+      {  if(!hn->naddr)
+         {  if(hn->hostname) FREE(hn->hostname);
+            hn->hostname=Dupstr(hent->h_name,-1);
+            hn->naddr=Copyaddrs(hn,hent);
+         }
+         hn->expires=Namesecs()+namettl;
+      }
+      else
+      {  /* A failed refresh keeps the addresses we had, and tries
+          * again after the negative TTL. */
+         hn->expires=Namesecs()+namenegttl;
+      }
+   }
+   if(old)
+   {  old->flags&=~HNF_BUSY;
+      ReleaseSemaphore(&old->sema);
+   }
+   else if(hn)
+   {  hn->flags&=~HNF_BUSY;
+      ReleaseSemaphore(&hn->sema);
+   }
+   ReleaseSemaphore(&namesema);
+   return hn;
+}
+
+/* Give up resolving this busy entry, for example on a break. Waiting tasks
+ * will resolve the name themselves. */
+static void Abandonname(struct Hostname *hn)
+{  ObtainSemaphore(&namesema);
+   hn->flags&=~HNF_BUSY;
+   ReleaseSemaphore(&hn->sema);
+   if(!hn->naddr)
+   {  Unlinkname(hn);
+      if(hn->waiters) hn->flags|=HNF_DEAD;
+      else Freename(hn);
+   }
+   ReleaseSemaphore(&namesema);
+}
+
+/*-----------------------------------------------------------------------*/
+
+#ifndef LOCALONLY
+
+/* The prefetch task resolves queued names so they are in the cache
+ * before the fetches for them start. */
+static void Prefetchtask(void *dummy)
+{  struct Library *SocketBase=NULL;
+   struct Prefetch *pf;
+   struct Taskmsg *msg;
+   struct TagItem *tag,*tstate;
+   BOOL done=FALSE;
+   long sig;
+   if((sig=AllocSignal(-1))<0) return;
+   ObtainSemaphore(&namesema);
+   prefetchmask=1L<<sig;
+   prefetchproc=FindTask(NULL);
+   ReleaseSemaphore(&namesema);
+   while(!done)
+   {  while(!done && (msg=Gettaskmsg()))
+      {  if(msg->amsg && msg->amsg->method==AOM_SET)
+         {  tstate=((struct Amset *)msg->amsg)->tags;
+            while(tag=NextTagItem(&tstate))
+            {  if(tag->ti_Tag==AOTSK_Stop && tag->ti_Data) done=TRUE;
+            }
+         }
+         Replytaskmsg(msg);
+      }
+      if(done) break;
+      ObtainSemaphore(&namesema);
+      if(pf=(struct Prefetch *)REMHEAD(&prefetches)) nrprefetches--;
+      ReleaseSemaphore(&namesema);
+      if(pf)
+      {  if(!SocketBase) Opentcp(&SocketBase,NULL,FALSE);
+         if(SocketBase)
+         {  debug_printf("DEBUG: Prefetching name '%s'\n",pf->name);
+            Lookup(pf->name,SocketBase);
+         }
+         FREE(pf->name);
+         FREE(pf);
+      }
+      else
+      {  Waittask(prefetchmask);
+      }
+   }
+   ObtainSemaphore(&namesema);
+   prefetchproc=NULL;
+   prefetchmask=0;
+   ReleaseSemaphore(&namesema);
+   FreeSignal(sig);
+   if(SocketBase)
+   {  a_cleanup(SocketBase);
+      CloseLibrary(SocketBase);
+   }
+}
+
+#endif /* LOCALONLY */
+
+void Prefetchname(UBYTE *url)
+{
+#ifndef LOCALONLY
+   UBYTE *p,*q,*name;
+   struct Prefetch *pf;
+   struct Hostname *hn;
+   ULONG hash;
+   BOOL queue=FALSE;
+   if(!inited || prefs.httpproxy) return;
+   if(STRNIEQUAL(url,"HTTP://",7)) p=url+7;
+   else if(STRNIEQUAL(url,"HTTPS://",8)) p=url+8;
+   else return;
+   for(q=p;*q && *q!='/' && *q!=':' && *q!='?' && *q!='#';q++)
+   {  if(*q=='@') p=q+1;
+   }
+   if(q==p || *p=='[') return;
+   if(!(name=Dupstr(p,q-p))) return;
+   hash=Namehash(name);
+   ObtainSemaphore(&namesema);
+   if(nrprefetches<NAMEMAXPREFETCH)
+   {  hn=Findname(name,hash);
+      if(!hn || (!(hn->flags&HNF_BUSY) && hn->expires<=Namesecs()))
+      {  for(pf=prefetches.first;pf->next;pf=pf->next)
+         {  if(STRIEQUAL(pf->name,name)) break;
+         }
+         queue=!pf->next;
+      }
+   }
+   if(queue && (pf=ALLOCSTRUCT(Prefetch,1,MEMF_CLEAR|MEMF_PUBLIC)))
+   {  pf->name=name;
+      name=NULL;
+      ADDTAIL(&prefetches,pf);
+      nrprefetches++;
+      if(prefetchproc) Signal(prefetchproc,prefetchmask);
+   }
+   ReleaseSemaphore(&namesema);
+   if(name) FREE(name);
+   if(queue && !prefetchtask)
+   {  if(prefetchtask=Anewobject(AOTP_TASK,
+         AOTSK_Entry,Prefetchtask,
+         AOTSK_Name,"AWeb name prefetch",
+         TAG_END))
+      {  Asetattrs(prefetchtask,AOTSK_Start,TRUE,TAG_END);
+      }
+   }
+#endif
+}
+
+void Stopnameserv(void)
+{
+#ifndef LOCALONLY
+   if(prefetchtask)
+   {  Adisposeobject(prefetchtask);
+      prefetchtask=NULL;
+   }
+#endif
+}
+
+void Setnameresolver(Nameresolver *fun,long ttl,long negttl)
+{  resolver=fun;
+   namettl=(ttl>0)?ttl:NAMETTL;
+   namenegttl=(negttl>0)?negttl:NAMENEGTTL;
+}
+
+void Nextaddress(struct hostent *hent)
+{  struct Hostname *hn;
+   UBYTE *first;
+   short i;
+   if(!inited || !hent) return;
+   hn=(struct Hostname *)((UBYTE *)hent-offsetof(struct Hostname,hent));
+   ObtainSemaphore(&namesema);
+   if(hn->naddr>1)
+   {  first=hn->addrp[0];
+      for(i=1;i<hn->naddr;i++) hn->addrp[i-1]=hn->addrp[i];
+      hn->addrp[hn->naddr-1]=first;
+   }
+   ReleaseSemaphore(&namesema);
+}
 
 /*-----------------------------------------------------------------------*/
 
 BOOL Initnameserv(void)
 {  InitSemaphore(&namesema);
-   NEWLIST(&names);
+   NEWLIST(&retired);
+#ifndef LOCALONLY
+   NEWLIST(&prefetches);
+#endif
    inited=TRUE;
    return TRUE;
 }
 
 void Freenameserv(void)
 {  struct Hostname *hn;
+#ifndef LOCALONLY
+   struct Prefetch *pf;
+#endif
+   short i;
    if(inited)
-   {  while(hn=(struct Hostname *)REMHEAD(&names))
-      {  if(hn->hostname) FREE(hn->hostname);
-         if(hn->name) FREE(hn->name);
-         FREE(hn);
+   {
+#ifndef LOCALONLY
+      while(pf=(struct Prefetch *)REMHEAD(&prefetches))
+      {  FREE(pf->name);
+         FREE(pf);
+      }
+#endif
+      for(i=0;i<NAMEHASHSIZE;i++)
+      {  while(hn=names[i])
+         {  names[i]=hn->hashnext;
+            Freename(hn);
+         }
+      }
+      while(hn=(struct Hostname *)REMHEAD(&retired))
+      {  Freename(hn);
       }
+      nrnames=0;
    }
 }
 
 struct hostent *Lookup(UBYTE *name,struct Library *base)
 {  struct Hostname *hn;
    struct hostent *hent=NULL;
-   short i;
+   ULONG hash=Namehash(name);
+   BOOL resolve=FALSE;
    ObtainSemaphore(&namesema);
-   for(hn=names.first;hn->next;hn=hn->next)
-   {  if(STRIEQUAL(hn->name,name))
-      {  hent=&hn->hent;
-         break;  /* Found it, exit loop */
+   for(;;)
+   {  if(!(hn=Findname(name,hash)))
+      {  /* New name, resolve it ourselves */
+         if(hn=Newname(name,hash)) resolve=TRUE;
+         break;
+      }
+      if(hn->flags&HNF_BUSY)
+      {  /* Another task is resolving this name. Wait until it is done
+          * and look again, the entry may have been replaced. */
+         debug_printf("DEBUG: DNS lookup for '%s' already in progress, waiting\n", name);
+         hn->waiters++;
+         ReleaseSemaphore(&namesema);
+         ObtainSemaphore(&hn->sema);
+         ReleaseSemaphore(&hn->sema);
+         ObtainSemaphore(&namesema);
+         if(!--hn->waiters && (hn->flags&HNF_DEAD)) Freename(hn);
+         continue;
       }
+      if(hn->expires>Namesecs())
+      {  if(hn->naddr) hent=&hn->hent;
+         break;
+      }
+      /* Expired, resolve it again */
+      hn->flags|=HNF_BUSY;
+      ObtainSemaphore(&hn->sema);
+      resolve=TRUE;
+      break;
    }
    ReleaseSemaphore(&namesema);
-   if(hent) return hent;
-   
-   /* CRITICAL: Add timeout protection for DNS lookups to prevent hanging */
-   debug_printf("DEBUG: DNS lookup for '%s', adding timeout protection\n", name);
-   
-   /* CRITICAL: Check for exit signals before DNS lookup to prevent hanging */
-   if(CheckSignal(SIGBREAKF_CTRL_C)) {
-      debug_printf("DEBUG: Task break detected, aborting DNS lookup for '%s'\n", name);
-      return NULL;
-   }
-   
-   /* CRITICAL: Check for exit signal (SIGBREAKF_CTRL_D) */
-   if(CheckSignal(SIGBREAKF_CTRL_D)) {
-      debug_printf("DEBUG: Exit signal detected, aborting DNS lookup for '%s'\n", name);
-      return NULL;
-   }
-   
-   /* CRITICAL: Check for any break signal that might indicate exit */
-   if(CheckSignal(SIGBREAKF_CTRL_E)) {
-      debug_printf("DEBUG: Exit break detected, aborting DNS lookup for '%s'\n", name);
-      return NULL;
+   if(!hn)
+   {  /* Out of memory, resolve without caching */
+      return resolver?resolver(name,base):a_gethostbyname(name,base);
    }
-   
-   /* CRITICAL: Implement pre-emptive exit checking to prevent DNS hanging */
-   /* The key insight: a_gethostbyname can hang forever, so we must */
-   /* check for exit signals BEFORE starting the DNS operation */
-   
-   debug_printf("DEBUG: Starting DNS lookup for '%s' with exit protection\n", name);
-   
-   /* CRITICAL: Check for exit signals BEFORE starting DNS lookup */
-   /* This prevents the hanging operation from starting in the first place */
-   if(CheckSignal(SIGBREAKF_CTRL_C | SIGBREAKF_CTRL_D | SIGBREAKF_CTRL_E)) {
-      debug_printf("DEBUG: Exit signals detected, aborting DNS lookup for '%s' before it starts\n", name);
-      return NULL;
-   }
-   
-   /* CRITICAL: Also check for task termination signal */
-   if(CheckSignal(SIGBREAKF_CTRL_F)) {
-      debug_printf("DEBUG: Task termination signal detected, aborting DNS lookup for '%s'\n", name);
+   if(!resolve) return hent;
+
+   /* Check for break and exit signals before starting the lookup, because
+    * a_gethostbyname() can hang for a long time. */
+   if(CheckSignal(SIGBREAKF_CTRL_C|SIGBREAKF_CTRL_D|SIGBREAKF_CTRL_E|SIGBREAKF_CTRL_F))
+   {  debug_printf("DEBUG: Break signal detected, aborting DNS lookup for '%s'\n", name);
+      Abandonname(hn);
       return NULL;
    }
-   
-   /* CRITICAL: Now start the DNS lookup - it may still hang, but we've */
-   /* done our best to prevent it by checking exit signals first */
-   hent = a_gethostbyname(name,base);
-   
-   /* CRITICAL: Validate the returned hostent structure */
-   if(hent && hent->h_name && hent->h_addr_list && hent->h_addr_list[0])
-   {  if(hn=ALLOCSTRUCT(Hostname,1,MEMF_CLEAR|MEMF_PUBLIC))
-      {  if((hn->hostname=Dupstr(hent->h_name,-1))
-         && (hn->name=Dupstr(name,-1)))
-         {  hn->hent=*hent;
-            hn->hent.h_name=hn->hostname;
-            for(i=0;i<4;i++) hn->addr[i]=(*hent->h_addr_list)[i];
-            hn->addrp=hn->addr;
-            hn->hent.h_addr_list=&hn->addrp;
-            hent=&hn->hent;
-            ObtainSemaphore(&namesema);
-            ADDTAIL(&names,hn);
-            ReleaseSemaphore(&namesema);
-            debug_printf("DEBUG: DNS lookup for '%s' completed successfully\n", name);
-         }
-         else
-         {  if(hn->hostname) FREE(hn->hostname);
-            if(hn->name) FREE(hn->name);
-            FREE(hn);
-         }
-      }
-   }
-   else
-   {  /* DNS lookup failed or returned invalid structure */
-      debug_printf("DEBUG: DNS lookup for '%s' failed\n", name);
+
+   debug_printf("DEBUG: Starting DNS lookup for '%s'\n", name);
+   if(resolver) hent=resolver(name,base);
+   else hent=a_gethostbyname(name,base);
+   hn=Resolvedname(hn,hent);
+   if(hn && hn->naddr)
+   {  debug_printf("DEBUG: DNS lookup for '%s' completed successfully\n", name);
+      return &hn->hent;
    }
-   
-   return hent;
+   debug_printf("DEBUG: DNS lookup for '%s' failed\n", name);
+   return NULL;
 }
@@ -25,6 +25,7 @@
 #include "application.h"
 #include "timer.h"
 #include "arexx.h"
+#include "awebssl.h"
 #include <intuition/imageclass.h>
 #include <intuition/gadgetclass.h>
 #include <reaction/reaction.h>
@@ -67,7 +68,7 @@ struct Netstatwin
 {  struct Aobject object;
    void *winobj;
    struct Window *window;
-   struct Gadget *listgad,*cpsgad;
+   struct Gadget *listgad,*cpsgad,*sslgad;
    struct Image *cancelimg,*canallimg;
 };
 
@@ -109,6 +110,8 @@ static short cpsi,cpsn;    /* Start, current index in cpsread[] */
 static ULONG ncps;         /* Number of transfers joining in cps */
 static ULONG ncpsa;        /* Number of transfers active in cps */
 
+static ULONG sslstats[2];  /* TLS sessions resumed, full handshakes */
+
 static void *nstimer;
 
 static struct GadgetInfo gadgetinfo;
@@ -333,6 +336,21 @@ static void Updatecps(struct Netstatwin *nsw)
    cps=newcps;
 }
 
+/* Show TLS session cache hits and misses if changed. */
+static void Updatessl(struct Netstatwin *nsw)
+{  ULONG hits,misses;
+   Assl_sessionstats(&hits,&misses);
+   if(hits!=sslstats[0] || misses!=sslstats[1])
+   {  sslstats[0]=hits;
+      sslstats[1]=misses;
+      if(nsw && nsw->window)
+      {  Setgadgetattrs(nsw->sslgad,nsw->window,NULL,
+            BUTTON_VarArgs,sslstats,
+            TAG_END);
+      }
+   }
+}
+
 /* Initialize CPS array */
 static void Initcps(void)
 {  cpsi=cpsn=0;
@@ -449,6 +467,12 @@ static BOOL Opennetstatwin(struct Netstatwin *nsw)
                BUTTON_VarArgs,&cps,
                BUTTON_Justification,BCJ_RIGHT,
             EndMember,
+            StartMember,nsw->sslgad=ButtonObject,
+               GA_ReadOnly,TRUE,
+               GA_Text,AWEBSTR(MSG_NWS_TLSSESSIONS),
+               BUTTON_VarArgs,sslstats,
+               BUTTON_Justification,BCJ_RIGHT,
+            EndMember,
             StartMember,ButtonObject,
                GA_ID,NWGID_CANALL,
                GA_RelVerify,TRUE,
@@ -492,6 +516,7 @@ static long Asetnetstatwin(struct Netstatwin *nsw,struct Amset *ams)
             break;
          case AOTIM_Ready:
             Updatecps(nsw);
+            Updatessl(nsw);
             Asetattrs(nstimer,AOTIM_Waitseconds,1,TAG_END);
             break;
       }
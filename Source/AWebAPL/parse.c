@@ -27,6 +27,8 @@
 #include "application.h"
 #include "docprivate.h"
 #include "jslib.h"
+#include "htmlnames.h"
+#include "tokenize.h"
 
 /* External debug flag */
 extern BOOL httpdebug;
@@ -41,385 +43,6 @@ static void pre_debug_printf(const char *format, ...)
    va_end(args);
 }
 
-#define MAXATTRS 40
-static struct Tagattr tagattr[MAXATTRS];
-
-static LIST(Tagattr) attrs;
-static short nextattr;
-
-struct Tagdes
-{  UBYTE *name;
-   USHORT type;
-   BOOL container;
-};
-
-static struct Tagdes tags[]=
-{  "A",        MARKUP_A,            TRUE,
-   "ADDRESS",  MARKUP_ADDRESS,      TRUE,
-   "AREA",     MARKUP_AREA,         FALSE,
-   "B",        MARKUP_B,            TRUE,
-   "BASE",     MARKUP_BASE,         FALSE,
-   "BASEFONT", MARKUP_BASEFONT,     FALSE,
-   "BGSOUND",  MARKUP_BGSOUND,      FALSE,
-   "BIG",      MARKUP_BIG,          TRUE,
-   "BLINK",    MARKUP_BLINK,        TRUE,
-   "BLOCKQUOTE",MARKUP_BLOCKQUOTE,  TRUE,
-   "BODY",     MARKUP_BODY,         TRUE,
-   "BQ",       MARKUP_BLOCKQUOTE,   TRUE,
-   "BR",       MARKUP_BR,           FALSE,
-   "BUTTON",   MARKUP_BUTTON,       TRUE,
-   "CAPTION",  MARKUP_CAPTION,      TRUE,
-   "CENTER",   MARKUP_CENTER,       TRUE,
-   "CITE",     MARKUP_CITE,         TRUE,
-   "CODE",     MARKUP_CODE,         TRUE,
-   "COL",      MARKUP_COL,          FALSE,
-   "COLGROUP", MARKUP_COLGROUP,     TRUE,
-   "DD",       MARKUP_DD,           FALSE,
-   "DEL",      MARKUP_DEL,          TRUE,
-   "DFN",      MARKUP_DFN,          TRUE,
-   "DIR",      MARKUP_DIR,          TRUE,
-   "DIV",      MARKUP_DIV,          TRUE,
-   "DL",       MARKUP_DL,           TRUE,
-   "DT",       MARKUP_DT,           FALSE,
-   "EM",       MARKUP_EM,           TRUE,
-   "EMBED",    MARKUP_EMBED,        FALSE,
-   "FIELDSET", MARKUP_FIELDSET,     TRUE,
-   "FONT",     MARKUP_FONT,         TRUE,
-   "FORM",     MARKUP_FORM,         TRUE,
-   "FRAME",    MARKUP_FRAME,        FALSE,
-   "FRAMESET", MARKUP_FRAMESET,     TRUE,
-   "H1",       MARKUP_H1,           TRUE,
-   "H2",       MARKUP_H2,           TRUE,
-   "H3",       MARKUP_H3,           TRUE,
-   "H4",       MARKUP_H4,           TRUE,
-   "H5",       MARKUP_H5,           TRUE,
-   "H6",       MARKUP_H6,           TRUE,
-   "HEAD",     MARKUP_HEAD,         TRUE,
-   "HR",       MARKUP_HR,           FALSE,
-   "HTML",     MARKUP_HTML,         TRUE,
-   "I",        MARKUP_I,            TRUE,
-   "IFRAME",   MARKUP_IFRAME,       TRUE,
-   "IMAGE",    MARKUP_IMG,          FALSE,
-   "IMG",      MARKUP_IMG,          FALSE,
-   "INPUT",    MARKUP_INPUT,        FALSE,
-   "INS",      MARKUP_INS,          TRUE,
-   "ISINDEX",  MARKUP_ISINDEX,      FALSE,
-   "KBD",      MARKUP_KBD,          TRUE,
-   "LEGEND",   MARKUP_LEGEND,       TRUE,
-   "LI",       MARKUP_LI,           FALSE,
-   "LINK",     MARKUP_LINK,         FALSE,
-   "LISTING",  MARKUP_LISTING,      TRUE,
-   "MAP",      MARKUP_MAP,          TRUE,
-   "MARQUEE",  MARKUP_MARQUEE,      TRUE,
-   "MENU",     MARKUP_MENU,         TRUE,
-   "META",     MARKUP_META,         FALSE,
-   "NOBR",     MARKUP_NOBR,         TRUE,
-   "NOFRAME",  MARKUP_NOFRAMES,     TRUE,
-   "NOFRAMES", MARKUP_NOFRAMES,     TRUE,
-   "NOSCRIPT", MARKUP_NOSCRIPT,     TRUE,
-   "OBJECT",   MARKUP_OBJECT,       TRUE,
-   "OL",       MARKUP_OL,           TRUE,
-   "OPTION",   MARKUP_OPTION,       FALSE,
-   "P",        MARKUP_P,            TRUE,
-   "PARAM",    MARKUP_PARAM,        FALSE,
-   "PRE",      MARKUP_PRE,          TRUE,
-   "S",        MARKUP_STRIKE,       TRUE,
-   "SAMP",     MARKUP_SAMP,         TRUE,
-   "SCRIPT",   MARKUP_SCRIPT,       TRUE,
-   "SELECT",   MARKUP_SELECT,       TRUE,
-   "SMALL",    MARKUP_SMALL,        TRUE,
-   "SPAN",     MARKUP_SPAN,         TRUE,
-   "STRIKE",   MARKUP_STRIKE,       TRUE,
-   "STRONG",   MARKUP_STRONG,       TRUE,
-   "STYLE",    MARKUP_STYLE,        TRUE,
-   "SUB",      MARKUP_SUB,          TRUE,
-   "SUP",      MARKUP_SUP,          TRUE,
-   "TABLE",    MARKUP_TABLE,        TRUE,
-   "TBODY",    MARKUP_TBODY,        TRUE,
-   "TD",       MARKUP_TD,           TRUE,
-   "TEXTAREA", MARKUP_TEXTAREA,     TRUE,
-   "TFOOT",    MARKUP_TFOOT,        TRUE,
-   "TH",       MARKUP_TH,           TRUE,
-   "THEAD",    MARKUP_THEAD,        TRUE,
-   "TITLE",    MARKUP_TITLE,        TRUE,
-   "TR",       MARKUP_TR,           TRUE,
-   "TT",       MARKUP_TT,           TRUE,
-   "U",        MARKUP_U,            TRUE,
-   "UL",       MARKUP_UL,           TRUE,
-   "VAR",      MARKUP_VAR,          TRUE,
-   "WBR",      MARKUP_WBR,          FALSE,
-   "XMP",      MARKUP_XMP,          TRUE,
-};
-#define NRTAGS (sizeof(tags)/sizeof(struct Tagdes))
-
-struct Attrdes
-{  UBYTE *name;
-   USHORT type;
-};
-
-static struct Attrdes tagattrs[]=
-{  "ACTION",            TAGATTR_ACTION,
-   "ALIGN",             TAGATTR_ALIGN,
-   "ALINK",             TAGATTR_ALINK,
-   "ALT",               TAGATTR_ALT,
-   "BACKGROUND",        TAGATTR_BACKGROUND,
-   "BEHAVIOR",          TAGATTR_BEHAVIOR,
-   "BGCOLOR",           TAGATTR_BGCOLOR,
-   "BORDER",            TAGATTR_BORDER,
-   "BORDERCOLOR",       TAGATTR_BORDERCOLOR,
-   "BORDERCOLORDARK",   TAGATTR_BORDERCOLORDARK,
-   "BORDERCOLORLIGHT",  TAGATTR_BORDERCOLORLIGHT,
-   "CELLPADDING",       TAGATTR_CELLPADDING,
-   "CELLSPACING",       TAGATTR_CELLSPACING,
-   "CHECKED",           TAGATTR_CHECKED,
-   "CLASS",             TAGATTR_CLASS,
-   "CLASSID",           TAGATTR_CLASSID,
-   "CLEAR",             TAGATTR_CLEAR,
-   "CODEBASE",          TAGATTR_CODEBASE,
-   "CODETYPE",          TAGATTR_CODETYPE,
-   "COLOR",             TAGATTR_COLOR,
-   "COLS",              TAGATTR_COLS,
-   "COLSPAN",           TAGATTR_COLSPAN,
-   "CONTENT",           TAGATTR_CONTENT,
-   "CONTINUE",          TAGATTR_CONTINUE,
-   "COORDS",            TAGATTR_COORDS,
-   "DATA",              TAGATTR_DATA,
-   "DECLARE",           TAGATTR_DECLARE,
-   "DINGBAT",           TAGATTR_DINGBAT,
-   "DIRECTION",        TAGATTR_DIRECTION,
-   "ENCTYPE",           TAGATTR_ENCTYPE,
-   "FACE",              TAGATTR_FACE,
-   "FRAME",             TAGATTR_FRAME,
-   "FRAMEBORDER",       TAGATTR_FRAMEBORDER,
-   "FRAMESPACING",      TAGATTR_FRAMESPACING,
-   "HEIGHT",            TAGATTR_HEIGHT,
-   "HIDDEN",            TAGATTR_HIDDEN,
-   "HREF",              TAGATTR_HREF,
-   "HSPACE",            TAGATTR_HSPACE,
-   "HTTP-EQUIV",        TAGATTR_HTTP_EQUIV,
-   "ID",                TAGATTR_ID,
-   "ISMAP",             TAGATTR_ISMAP,
-   "LANGUAGE",          TAGATTR_LANGUAGE,
-   "LEFTMARGIN",        TAGATTR_LEFTMARGIN,
-   "LINK",              TAGATTR_LINK,
-   "LOOP",              TAGATTR_LOOP,
-   "MARGINHEIGHT",      TAGATTR_MARGINHEIGHT,
-   "MARGINWIDTH",       TAGATTR_MARGINWIDTH,
-   "MAXLENGTH",         TAGATTR_MAXLENGTH,
-   "METHOD",            TAGATTR_METHOD,
-   "MULTIPLE",          TAGATTR_MULTIPLE,
-   "NAME",              TAGATTR_NAME,
-   "NOHREF",            TAGATTR_NOHREF,
-   "NORESIZE",          TAGATTR_NORESIZE,
-   "NOSHADE",           TAGATTR_NOSHADE,
-   "NOWRAP",            TAGATTR_NOWRAP,
-   "ONABORT",           TAGATTR_ONABORT,
-   "ONBLUR",            TAGATTR_ONBLUR,
-   "ONCHANGE",          TAGATTR_ONCHANGE,
-   "ONCLICK",           TAGATTR_ONCLICK,
-   "ONERROR",           TAGATTR_ONERROR,
-   "ONFOCUS",           TAGATTR_ONFOCUS,
-   "ONLOAD",            TAGATTR_ONLOAD,
-   "ONMOUSEOUT",        TAGATTR_ONMOUSEOUT,
-   "ONMOUSEOVER",       TAGATTR_ONMOUSEOVER,
-   "ONRESET",           TAGATTR_ONRESET,
-   "ONSELECT",          TAGATTR_ONSELECT,
-   "ONSUBMIT",          TAGATTR_ONSUBMIT,
-   "ONUNLOAD",          TAGATTR_ONUNLOAD,
-   "PLAIN",             TAGATTR_PLAIN,
-   "PROMPT",            TAGATTR_PROMPT,
-   "REL",               TAGATTR_REL,
-   "ROWS",              TAGATTR_ROWS,
-   "ROWSPAN",           TAGATTR_ROWSPAN,
-   "RULES",             TAGATTR_RULES,
-   "SCROLLING",         TAGATTR_SCROLLING,
-   "SCROLLAMOUNT",      TAGATTR_SCROLLAMOUNT,
-   "SCROLLDELAY",       TAGATTR_SCROLLDELAY,
-   "SELECTED",          TAGATTR_SELECTED,
-   "SEQNUM",            TAGATTR_SEQNUM,
-   "SHAPE",             TAGATTR_SHAPE,
-   "SHAPES",            TAGATTR_SHAPES,
-   "SIZE",              TAGATTR_SIZE,
-   "SKIP",              TAGATTR_SKIP,
-   "SPAN",              TAGATTR_SPAN,
-   "SRC",               TAGATTR_SRC,
-   "STANDBY",           TAGATTR_STANDBY,
-   "START",             TAGATTR_START,
-   "STYLE",             TAGATTR_STYLE,
-   "TARGET",            TAGATTR_TARGET,
-   "TEXT",              TAGATTR_TEXT,
-   "TITLE",             TAGATTR_TITLE,
-   "TOPMARGIN",         TAGATTR_TOPMARGIN,
-   "TYPE",              TAGATTR_TYPE,
-   "USEMAP",            TAGATTR_USEMAP,
-   "VALIGN",            TAGATTR_VALIGN,
-   "VALUE",             TAGATTR_VALUE,
-   "VALUETYPE",         TAGATTR_VALUETYPE,
-   "VLINK",             TAGATTR_VLINK,
-   "VSPACE",            TAGATTR_VSPACE,
-   "WIDTH",             TAGATTR_WIDTH,
-};
-#define NRATTRS   (sizeof(tagattrs)/sizeof(struct Attrdes))
-
-struct Chardes
-{  UBYTE *name;
-   USHORT ch;
-};
-
-static struct Chardes chars[]=
-{  "AElig", 198,
-   "Aacute",193,
-   "Acirc", 194,
-   "Agrave",192,
-   "Aring", 197,
-   "Atilde",195,
-   "Auml",  196,
-   "Ccedil",199,
-   "Dagger",135,  /* Latin-1 double dagger (Windows-1252 extension) */
-   "ETH",   208,
-   "Eacute",201,
-   "Ecirc", 202,
-   "Egrave",200,
-   "Euml",  203,
-   "Iacute",205,
-   "Icirc", 206,
-   "Igrave",204,
-   "Iuml",  207,
-   "Ntilde",209,
-   "OElig", 338,  /* No Latin-1 equivalent, kept as Unicode for translation */
-   "Oacute",211,
-   "Ocirc", 212,
-   "Ograve",210,
-   "Oslash",216,
-   "Otilde",213,
-   "Ouml",  214,
-   "Prime", 148,  /* Approximated as right double quote in Latin-1 */
-   "Scaron",352,  /* No Latin-1 equivalent, kept as Unicode for translation */
-   "THORN", 222,
-   "Uacute",218,
-   "Ucirc", 219,
-   "Ugrave",217,
-   "Uuml",  220,
-   "Yacute",221,
-   "Yuml",  376,  /* No Latin-1 equivalent, kept as Unicode for translation */
-   "aacute",225,
-   "acirc", 226,
-   "acute", 180,
-   "aelig", 230,
-   "agrave",224,
-   "amp",   38,
-   "aring", 229,
-   "atilde",227,
-   "auml",  228,
-   "bdquo", 132,  /* Latin-1 double low-9 quotation mark (Windows-1252 extension) */
-   "brkbar",166,  /* Latin-1 broken vertical bar (alternate name for brvbar) */
-   "brvbar",166,
-   "bull",  183,  /* Latin-1 MIDDLE DOT (·) for bullet - U+00B7 */
-   "ccedil",231,
-   "cedil", 184,
-   "cent",  162,
-   "circ",  136,  /* Latin-1 circumflex accent (Windows-1252 extension) */
-   "copy",  169,
-   "curren",164,
-   "dagger",134,  /* Latin-1 dagger (Windows-1252 extension) */
-   "deg",   176,
-   "die",   168,  /* Latin-1 spacing dieresis or umlaut (alternate name for uml) */
-   "divide",247,
-   "eacute",233,
-   "ecirc", 234,
-   "egrave",232,
-   "empty", 8709,  /* No Latin-1 equivalent, kept as Unicode for translation */
-   "emsp",  8195,  /* No Latin-1 equivalent, kept as Unicode for translation */
-   "ensp",  8194,  /* No Latin-1 equivalent, kept as Unicode for translation */
-   "eth",   240,
-   "euml",  235,
-   "euro",  164,  /* Approximated as currency symbol (¤) in Latin-1 */
-   "fnof",  402,  /* No Latin-1 equivalent, kept as Unicode for translation */
-   "frac12",189,
-   "frac14",188,
-   "frac34",190,
-   "frasl", 8260,  /* No Latin-1 equivalent, kept as Unicode for translation */
-   "half",  189,  /* Latin-1 fraction 1/2 (alternate name for frac12) */
-   "ge",    8805,  /* No Latin-1 equivalent, kept as Unicode for translation */
-   "gt",    62,
-   "hellip",133,  /* Latin-1 horizontal ellipsis (Windows-1252 extension) */
-   "hibar", 175,  /* Latin-1 spacing macron (alternate name for macr) */
-   "iacute",237,
-   "icirc", 238,
-   "iexcl", 161,
-   "igrave",236,
-   "iquest",191,
-   "iuml",  239,
-   "lang",  9001,  /* No Latin-1 equivalent, kept as Unicode for translation */
-   "laquo", 171,
-   "larr",  8592,  /* Left arrow (←) - Unicode U+2190 */
-   "ldquo", 147,  /* Latin-1 left double quotation mark (Windows-1252 extension) */
-   "le",    8804,  /* No Latin-1 equivalent, kept as Unicode for translation */
-   "lowast",8727,  /* No Latin-1 equivalent, kept as Unicode for translation */
-   "loz",   9674,  /* No Latin-1 equivalent, kept as Unicode for translation */
-   "lsaquo",139,  /* Latin-1 single left-pointing angle quotation mark (Windows-1252 extension) */
-   "lsquo", 145,  /* Latin-1 left single quotation mark (Windows-1252 extension) */
-   "lt",    60,
-   "macr",  175,
-   "mdash", 151,  /* Latin-1 em dash (Windows-1252 extension) */
-   "micro", 181,
-   "middot",183,
-   "minus", 8722,  /* No Latin-1 equivalent, kept as Unicode for translation */
-   "nbsp",  160,
-   "ndash", 150,  /* Latin-1 en dash (Windows-1252 extension) */
-   "not",   172,
-   "ntilde",241,
-   "oacute",243,
-   "ocirc", 244,
-   "oelig", 339,  /* No Latin-1 equivalent, kept as Unicode for translation */
-   "ograve",242,
-   "oline", 175,  /* Approximated as macron in Latin-1 */
-   "ordf",  170,
-   "ordm",  186,
-   "oslash",248,
-   "otilde",245,
-   "ouml",  246,
-   "para",  182,
-   "permil",137,  /* Latin-1 per mille sign (Windows-1252 extension) */
-   "plusmn",177,
-   "pound", 163,
-   "prime", 146,  /* Approximated as right single quote in Latin-1 */
-   "quot",  34,
-   "rang",  9002,  /* No Latin-1 equivalent, kept as Unicode for translation */
-   "rarr",  8594,  /* Right arrow (→) - Unicode U+2192 */
-   "raquo", 187,
-   "reg",   174,  /* Latin-1 Registered trademark symbol */
-   "rdquo", 148,  /* Latin-1 right double quotation mark (Windows-1252 extension) */
-   "rsaquo",155,  /* Latin-1 single right-pointing angle quotation mark (Windows-1252 extension) */
-   "rsquo", 146,  /* Latin-1 right single quotation mark (Windows-1252/ISO 8859-1 extension) */
-   "sbquo", 130,  /* Latin-1 single low-9 quotation mark (Windows-1252 extension) */
-   "scaron",353,  /* No Latin-1 equivalent, kept as Unicode for translation */
-   "sdot",  8901,
-   "sect",  167,
-   "shy",   173,
-   "sim",   8764,  /* No Latin-1 equivalent, kept as Unicode for translation */
-   "sup1",  185,
-   "sup2",  178,
-   "sup3",  179,
-   "szlig", 223,
-   "thinsp",8201,  /* No Latin-1 equivalent, kept as Unicode for translation */
-   "thorn", 254,
-   "tilde", 152,  /* Latin-1 small tilde (Windows-1252 extension) */
-   "times", 215,
-   "trade", 153,  /* Approximated as trademark symbol in Windows-1252 extension (Latin-1 compatible) */
-   "uacute",250,
-   "ucirc", 251,
-   "ugrave",249,
-   "uml",   168,
-   "uuml",  252,
-   "yacute",253,
-   "yen",   165,
-   "yuml",  255,
-   "zwj",   8205,  /* No Latin-1 equivalent, kept as Unicode for translation */
-   "zwnj",  8204,  /* No Latin-1 equivalent, kept as Unicode for translation */
-};
-#define NRCHARS (sizeof(chars)/sizeof(struct Chardes))
-
 static UBYTE *icons[]=
 {  "archive",
    "audio",
@@ -483,59 +106,81 @@ static UBYTE *icons[]=
 };
 #define NRICONS (sizeof(icons)/sizeof(UBYTE *))
 
-static struct Tagdes *Findtag(UBYTE *name)
-{  short a=0,b=NRTAGS-1,m;
+static UBYTE *Findicon(UBYTE *name)
+{  short a=0,b=NRICONS-1,m;
    long c;
    while(a<=b)
    {  m=(a+b)/2;
-      c=Stricmp(tags[m].name,name);
-      if(c==0) return &tags[m];
+      c=strcmp(icons[m],name);
+      if(c==0) return icons[m];
       if(c<0) a=m+1;
       else b=m-1;
    }
    return NULL;
 }
 
-static struct Attrdes *Findattr(UBYTE *name)
-{  short a=0,b=NRATTRS-1,m;
-   long c;
-   while(a<=b)
-   {  m=(a+b)/2;
-      c=Stricmp(tagattrs[m].name,name);
-      if(c==0) return &tagattrs[m];
-      if(c<0) a=m+1;
-      else b=m-1;
-   }
-   return NULL;
+/* Saved attribute list while a nested tag is processed */
+struct Attrstate
+{  struct Tagattr *first,*last;
+   struct Attrblock *attrblock;
+   short nextattr;
+   long argslength;
+};
+
+/* Set up the attribute storage of a new document */
+void Initattrs(struct Document *doc)
+{  NEWLIST(&doc->attrblocks);
+   ADDTAIL(&doc->attrblocks,&doc->firstattrs);
+   Resetattrs(doc);
 }
 
-static struct Chardes *Findchar(UBYTE *name)
-{  short i;
-   /* Use linear search with case-sensitive comparison */
-   for(i=0;i<NRCHARS;i++)
-   {  if(!strcmp(chars[i].name,name)) return &chars[i];
-   }
-   return NULL;
+/* Start the attribute list for a new tag, reusing the storage */
+void Resetattrs(struct Document *doc)
+{  NEWLIST(&doc->attrs);
+   doc->attrblock=&doc->firstattrs;
+   doc->nextattr=0;
 }
 
-static UBYTE *Findicon(UBYTE *name)
-{  short a=0,b=NRICONS-1,m;
-   long c;
-   while(a<=b)
-   {  m=(a+b)/2;
-      c=strcmp(icons[m],name);
-      if(c==0) return icons[m];
-      if(c<0) a=m+1;
-      else b=m-1;
-   }
-   return NULL;
+/* Start a new attribute list for a nested tag. Attributes of the current
+ * list are kept, and restored with Restoreattrs(). */
+static void Saveattrs(struct Document *doc,struct Attrstate *as)
+{  as->first=doc->attrs.first;
+   as->last=doc->attrs.last;
+   as->attrblock=doc->attrblock;
+   as->nextattr=doc->nextattr;
+   as->argslength=doc->args.length;
+   NEWLIST(&doc->attrs);
+}
+
+static void Restoreattrs(struct Document *doc,struct Attrstate *as)
+{  doc->attrs.first=as->first;
+   doc->attrs.last=as->last;
+   doc->attrblock=as->attrblock;
+   doc->nextattr=as->nextattr;
+   doc->args.length=as->argslength;
 }
 
-static struct Tagattr *Nextattr(struct Document *doc)
+struct Tagattr *Nextattr(struct Document *doc)
 {  struct Tagattr *ta;
-   if(nextattr==MAXATTRS) REMOVE(&tagattr[--nextattr]);
-   ta=&tagattr[nextattr++];
-   ADDTAIL(&attrs,ta);
+   struct Attrblock *ab;
+   if(doc->nextattr==ATTRBLOCKSIZE)
+   {  ab=doc->attrblock->next;
+      if(!ab->next)
+      {  if(ab=PALLOCSTRUCT(Attrblock,1,MEMF_PUBLIC,doc->pool))
+         {  ADDTAIL(&doc->attrblocks,ab);
+         }
+      }
+      if(ab)
+      {  doc->attrblock=ab;
+         doc->nextattr=0;
+      }
+      else
+      {  /* Out of memory, reuse the last attribute */
+         REMOVE(&doc->attrblock->attr[--doc->nextattr]);
+      }
+   }
+   ta=&doc->attrblock->attr[doc->nextattr++];
+   ADDTAIL(&doc->attrs,ta);
    ta->attr=0;
    ta->valuepos=doc->args.length;
    ta->length=0;
@@ -570,15 +215,44 @@ static void Removenl(struct Buffer *buf,struct Tagattr *ta)
    ta->length=q-(buf->buffer+ta->valuepos);
 }
 
+/* Write a replacement of (length) bytes at the output position (*wp), after
+ * the input before (*pp) has been used. If the output would overtake the
+ * input, the rest of the input is moved up. If that fails, '?' is written. */
+static void Putreplacement(struct Buffer *buf,UBYTE **wp,UBYTE **pp,UBYTE **endp,
+   UBYTE *text,long length)
+{  long wpos,pos,endpos,need=(*wp+length)-*pp;
+   if(need>0)
+   {  wpos=*wp-buf->buffer;
+      pos=*pp-buf->buffer;
+      endpos=*endp-buf->buffer;
+      if(!Insertinbuffer(buf,text,need,pos))
+      {  *(*wp)++='?';
+         return;
+      }
+      *wp=buf->buffer+wpos;
+      *pp=buf->buffer+pos+need;
+      *endp=buf->buffer+endpos+need;
+   }
+   memmove(*wp,text,length);
+   *wp+=length;
+}
+
+/* Translate entities and foreign characters in an attribute value or text.
+ * The value is read at (p) and written back at (w) in a single pass. Since
+ * replacements are nearly always shorter than their source, (w) stays
+ * behind (p) and the rest of the value doesn't have to be moved. */
 static void Translate(struct Document *doc,struct Buffer *buf,struct Tagattr *ta,
    BOOL isattr)
 {  UBYTE *p=buf->buffer+ta->valuepos,*q,*r,*s;
+   UBYTE *w=p;
    UBYTE *end=p+ta->length;
+   UBYTE *e;
    UBYTE ebuf[12];
+   UBYTE c;
    ULONG n;
    BOOL valid;
    BOOL strict=(doc->htmlmode==HTML_STRICT),lf=(doc->pmode==DPM_TEXTAREA);
-   short l;
+   long l,el,pos,endpos;
    
    /* Lookup tables for Latin Extended-A (U+0100-U+017F) and Latin Extended-B (U+0180-U+024F) */
    /* These map UTF-8 sequences 0xC4 and 0xC5 (Latin Extended-A) and 0xC6 and 0xC7 (Latin Extended-B) */
@@ -805,83 +479,45 @@ static void Translate(struct Document *doc,struct Buffer *buf,struct Tagattr *ta
       if(utf8_bytes > 0)
       {  /* Skip combining characters and soft hyphens */
          if(skip_char)
-         {  /* Remove the UTF-8 bytes by shifting remaining bytes left */
-            if(p + utf8_bytes <= end)
-            {  memmove(p, p + utf8_bytes, end - (p + utf8_bytes));
-            }
-            ta->length -= utf8_bytes;
-            end -= utf8_bytes;
+         {  p += utf8_bytes;
             continue;
          }
          
          if(replacement_str)
          {  /* Multi-character replacement (e.g., "..." or "TM") */
-            long replen = strlen(replacement_str);
-            long pos = p - buf->buffer;
-            if(Insertinbuffer(buf, replacement_str, replen, pos))
-            {  Deleteinbuffer(buf, pos + replen, utf8_bytes);
-               ta->length += (replen - utf8_bytes);
-               end = buf->buffer + buf->length;
-               p = buf->buffer + pos + replen;
-            }
-            else
-            {  /* Buffer expansion failed - use single char fallback */
-               *p = 0x3F;
-               memmove(p + 1, p + utf8_bytes, end - (p + utf8_bytes));
-               ta->length -= (utf8_bytes - 1);
-               end -= (utf8_bytes - 1);
-               p++;
-            }
+            p += utf8_bytes;
+            Putreplacement(buf, &w, &p, &end, replacement_str, strlen(replacement_str));
             continue;
          }
          else if(replacement > 0)
          {  /* Single character replacement */
-            *p = replacement;
-            /* Remove the extra UTF-8 bytes by shifting remaining bytes left */
-            if(p + utf8_bytes <= end)
-            {  memmove(p + 1, p + utf8_bytes, end - (p + utf8_bytes));
-            }
-            ta->length -= (utf8_bytes - 1);
-            end -= (utf8_bytes - 1);
-            n = replacement;
-            p++;
+            *w++ = replacement;
+            p += utf8_bytes;
             continue;
          }
       }
-      n=*p;
+      n=c=*p;
+      e=NULL;
+      el=0;
       if(*p=='&')
-      {  q=p;
-         if(++q>=end) break;
-         if(*q=='#')
-         {  n=0;
-            if(isdigit(q[1]))
-            {  while(++q<end && isdigit(*q)) n=10*n+(*q-'0');
-            }
-            else if(toupper(q[1])=='X')
-            {  q++;
-               while(++q<end && isxdigit(*q))
-               {  n=16*n+((*q<='9')?(*q-'0'):(toupper(*q)-'A'+10));
-               }
-            }
-            /* Blindly replace the entity by the character value.
+      {  if(l=Charref(p,end,strict,&n))
+         {  /* Replace the whole reference by the character value.
              * Validity check and translation is done below.
-             * First remember the exact source in case we don't know the character. */
-            if(q<end)
-            {  if(*q!=';') q--;
-               l=q-p+1;
-               if(l>11) l=11;
-               strncpy(ebuf,p,l);
-               ebuf[l]='\0';
-               memmove(p,q,end+1-q);
-            }
-            else q--;
-            ta->length-=(q-p);
-            end-=(q-p);
-            *p=n;
+             * Remember where the source is in case we don't know the character. */
+            e=p;
+            el=l;
+            p+=l-1;
+            c=n;
          }
-         else if(isattr && *q=='{')
-         {  /* JavaScript expression */
-            q++;
+         else if(isattr && p+1<end && p[1]=='{')
+         {  /* JavaScript expression. Close the gap first, the result may be longer
+             * than the expression. */
+            if(w<p)
+            {  memmove(w,p,end+1-p);
+               end-=p-w;
+               p=w;
+            }
+            q=p+2;
             for(r=q;r<end && *r!='}';r++);
             if(s=Dupstr(q,r-q))
             {  struct Jcontext *jc;
@@ -899,40 +535,19 @@ static void Translate(struct Document *doc,struct Buffer *buf,struct Tagattr *ta
                r++;
                if(r<end && *r==';') r++;
                l=strlen(result);
-               Deleteinbuffer(buf,p-buf->buffer,r-p);
-               Insertinbuffer(buf,result,l,p-buf->buffer);
-               ta->length=ta->length-(r-p)+l;
-               end=end-(r-p)+l;
-               p+=l-1;
+               pos=p-buf->buffer;
+               endpos=(end-buf->buffer)-(r-p)+l;
+               Deleteinbuffer(buf,pos,r-p);
+               Insertinbuffer(buf,result,l,pos);
                FREE(s);
+               end=buf->buffer+endpos;
+               p=w=buf->buffer+pos+l;
+               if(!l) continue;
+               /* Last character of the result is checked below */
+               p--;
+               w--;
             }
-            n=*p; /* No replacement */
-         }
-         else
-         {  UBYTE name[8];
-            struct Chardes *cd;
-            short i;
-            for(i=0;
-               q<end && i<7 && (isalnum(*q) || *q=='.' || *q=='-');
-               q++,i++) name[i]=*q;
-            name[i]='\0';
-            if(cd=Findchar(name))
-            {  /* Always convert all entities regardless of HTML mode or character code.
-                * In strict mode, name must be terminated by semicolon or non-alphanumeric. */
-               if(STREQUAL(cd->name,name)
-               && (!strict || (q>=end || !isalnum(*q))))
-               {  q=p+1+strlen(cd->name); /* +1 because of & */
-                  if(q<end)
-                  {  if(*q!=';') q--;
-                     memmove(p,q,end+1-q);
-                  }
-                  else q--;
-                  ta->length-=(q-p);
-                  end-=(q-p);
-                  n=cd->ch;
-                  *p=cd->ch;
-               }
-            }
+            n=c=*p; /* No replacement */
          }
       }
       /* Translate win '95 characters if not strict and no foreign character set.
@@ -1014,31 +629,37 @@ static void Translate(struct Document *doc,struct Buffer *buf,struct Tagattr *ta
             case 9002:n=(UBYTE)'>';break;
             case 9674:n=(UBYTE)0x25CA;break;
             default:
-               r=ebuf;
+               /* Unknown character, keep the source of the reference */
+               if(e)
+               {  if(el>11) el=11;
+                  memmove(ebuf,e,el);
+                  ebuf[el]='\0';
+                  r=ebuf;
+               }
+               else n=(UBYTE)' ';
          }
       }
+      p++;
       if(r)
-      {  l=strlen(r);
-         Deleteinbuffer(buf,p-buf->buffer,1);
-         Insertinbuffer(buf,r,l,p-buf->buffer);
-         ta->length=ta->length+l-1;
-         end=end+l-1;
-         p=p+l-1;
+      {  Putreplacement(buf,&w,&p,&end,r,strlen(r));
+         continue;
       }
       /* replace invalid number by space if compatible */
       valid=(n>=32 && n<=126) || (n>=160 && n<=255) || (lf && n==10);
-      if((valid || doc->htmlmode==HTML_COMPATIBLE) && !r)
+      if(valid || doc->htmlmode==HTML_COMPATIBLE)
       {  if(!valid) n=32;
-         *p=n;
+         c=n;
       }
       else if(n==0 && !strict)
-      {  *p=' ';
+      {  c=' ';
       }
       else if(n==9)
-      {  *p=' ';
+      {  c=' ';
       }
-      p++;
+      *w++=c;
    }
+   if(w<end) *w='\0';
+   ta->length=w-(buf->buffer+ta->valuepos);
 }
 
 /* inspect text, find icon entities and split up */
@@ -1092,77 +713,11 @@ static void Lookforicons(struct Document *doc,struct Tagattr *ta)
 /* End of text reached, If eof, notify HTML doc. */
 static BOOL Eofandexit(struct Document *doc,BOOL eof)
 {  if(eof)
-   {  Processhtml(doc,MARKUP_EOF,attrs.first);
+   {  Processhtml(doc,MARKUP_EOF,doc->attrs.first);
    }
    return TRUE;
 }
 
-/* Parse comment in html mode. Initial p points after initial "<!--"
- * Return new buffer pointer, or NULL when eof */
-
-/* Strict HTML:  <!{--comment--wsp}> */
-UBYTE *Parsecommentstrict(UBYTE *p,UBYTE *end,BOOL eof)
-{  for(;;)
-   {  while(p<end-1 && !(p[0]=='-' && p[1]=='-')) p++;   /* Skip to closing -- */
-      p+=2;
-      while(p<end-1 && *p!='>' && !(p[0]=='-' && p[1]=='-')) p++;
-      if(p>=end-1) return NULL;
-      if(*p=='>') break;
-      p+=2;                                              /* skip next opening -- */
-   }
-   p++;  /* Skip closing > */
-   return p;
-}
-
-/* Tolerant: Try strict first, but if wsp is something else than wsp,
- * or "---" is found, then redo using    <!--any> */
-UBYTE *Parsecommenttolerant(UBYTE *p,UBYTE *end,BOOL eof)
-{  UBYTE *savep=p;
-   for(;;)
-   {  while(p<end-1 && !(p[0]=='-' && p[1]=='-')) p++;   /* Skip to closing -- */
-      p+=2;
-      if(p<end && *p=='-')
-      {  /* "---" */
-         break;
-      }
-      while(p<end && isspace(*p)) p++;                   /* Skip whitespace */
-      if(p<end && *p=='>')
-      {  p++;
-         return p;
-      }
-      else if(p>=end-1)
-      {  if(!eof) return NULL;
-         /* EOF found, retry */
-         break;
-      }
-      else if(p[0]=='-' && p[1]=='-')
-      {  /* Still a valid strict comment */
-         p+=2;                                           /* Skip next opening -- */
-         if(p<end && *p=='-')
-         {  /* "---" */
-            break;
-         }
-      }
-      else
-      {  /* Whitespace is no whitespace, retry */
-         break;
-      }
-   }
-   /* If loop was broken, retry */
-   p=savep;
-   while(p<end && *p!='>') p++;                          /* Skip to > */
-   p++;
-   return p;
-}
-
-/* Compatible:   <!--comment> */
-UBYTE *Parsecommentcompatible(UBYTE *p,UBYTE *end,BOOL eof)
-{  while(p<end && !(p[0]=='>')) p++;      /* Skip to > */
-   if(p>=end) return NULL;
-   p++;
-   return p;
-}
-
 /* Parse XML declaration: <?xml version="1.0" encoding="..." standalone="yes"?>
  * Extracts encoding if present and stores it in document flags.
  * Returns pointer after ?> or NULL on error/eof */
@@ -1238,10 +793,7 @@ static UBYTE *Parsecdata(struct Document *doc,UBYTE *p,UBYTE *end,BOOL eof)
    UBYTE *cdata_end;
    UBYTE *q;
    struct Tagattr *ta;
-   struct Tagattr *saved_attrs_first;
-   struct Tagattr *saved_attrs_last;
-   short saved_nextattr;
-   long saved_args_length;
+   struct Attrstate saved;
    
    /* Skip past "[CDATA[" */
    if(p>=end-7) return NULL;
@@ -1258,14 +810,9 @@ static UBYTE *Parsecdata(struct Document *doc,UBYTE *p,UBYTE *end,BOOL eof)
          /* Add CDATA content as text, normalizing newlines to spaces */
          if(cdata_end>cdata_start)
          {  /* Save current parsing state */
-            saved_attrs_first=attrs.first;
-            saved_attrs_last=attrs.last;
-            saved_nextattr=nextattr;
-            saved_args_length=doc->args.length;
+            Saveattrs(doc,&saved);
             
             /* Create new attrs list for CDATA content */
-            NEWLIST(&attrs);
-            nextattr=0;
             doc->args.length=0;
             ta=Nextattr(doc);
             ta->attr=TAGATTR_TEXT;
@@ -1277,10 +824,7 @@ static UBYTE *Parsecdata(struct Document *doc,UBYTE *p,UBYTE *end,BOOL eof)
                {  /* Convert \r\n or \r to space */
                   if(!Addtobuffer(&doc->args," ",1))
                   {  /* Restore state on error */
-                     attrs.first=saved_attrs_first;
-                     attrs.last=saved_attrs_last;
-                     nextattr=saved_nextattr;
-                     doc->args.length=saved_args_length;
+                     Restoreattrs(doc,&saved);
                      return NULL;
                   }
                   ta->length++;
@@ -1291,10 +835,7 @@ static UBYTE *Parsecdata(struct Document *doc,UBYTE *p,UBYTE *end,BOOL eof)
                {  /* Convert \n to space */
                   if(!Addtobuffer(&doc->args," ",1))
                   {  /* Restore state on error */
-                     attrs.first=saved_attrs_first;
-                     attrs.last=saved_attrs_last;
-                     nextattr=saved_nextattr;
-                     doc->args.length=saved_args_length;
+                     Restoreattrs(doc,&saved);
                      return NULL;
                   }
                   ta->length++;
@@ -1304,10 +845,7 @@ static UBYTE *Parsecdata(struct Document *doc,UBYTE *p,UBYTE *end,BOOL eof)
                {  /* Copy character as-is */
                   if(!Addtobuffer(&doc->args,q,1))
                   {  /* Restore state on error */
-                     attrs.first=saved_attrs_first;
-                     attrs.last=saved_attrs_last;
-                     nextattr=saved_nextattr;
-                     doc->args.length=saved_args_length;
+                     Restoreattrs(doc,&saved);
                      return NULL;
                   }
                   ta->length++;
@@ -1317,21 +855,15 @@ static UBYTE *Parsecdata(struct Document *doc,UBYTE *p,UBYTE *end,BOOL eof)
             
             if(!Addtobuffer(&doc->args,"",1))
             {  /* Restore state on error */
-               attrs.first=saved_attrs_first;
-               attrs.last=saved_attrs_last;
-               nextattr=saved_nextattr;
-               doc->args.length=saved_args_length;
+               Restoreattrs(doc,&saved);
                return NULL;
             }
             
             /* Process the text content */
-            Processhtml(doc,MARKUP_TEXT,attrs.first);
+            Processhtml(doc,MARKUP_TEXT,doc->attrs.first);
             
             /* Restore previous parsing state */
-            attrs.first=saved_attrs_first;
-            attrs.last=saved_attrs_last;
-            nextattr=saved_nextattr;
-            doc->args.length=saved_args_length;
+            Restoreattrs(doc,&saved);
          }
          
          return p;
@@ -1345,14 +877,9 @@ static UBYTE *Parsecdata(struct Document *doc,UBYTE *p,UBYTE *end,BOOL eof)
    /* At EOF, add whatever we have as text, normalizing newlines */
    if(p>cdata_start)
    {  /* Save current parsing state */
-      saved_attrs_first=attrs.first;
-      saved_attrs_last=attrs.last;
-      saved_nextattr=nextattr;
-      saved_args_length=doc->args.length;
+      Saveattrs(doc,&saved);
       
       /* Create new attrs list for CDATA content */
-      NEWLIST(&attrs);
-      nextattr=0;
       doc->args.length=0;
       ta=Nextattr(doc);
       ta->attr=TAGATTR_TEXT;
@@ -1364,10 +891,7 @@ static UBYTE *Parsecdata(struct Document *doc,UBYTE *p,UBYTE *end,BOOL eof)
          {  /* Convert \r\n or \r to space */
             if(!Addtobuffer(&doc->args," ",1))
             {  /* Restore state on error */
-               attrs.first=saved_attrs_first;
-               attrs.last=saved_attrs_last;
-               nextattr=saved_nextattr;
-               doc->args.length=saved_args_length;
+               Restoreattrs(doc,&saved);
                return NULL;
             }
             ta->length++;
@@ -1378,10 +902,7 @@ static UBYTE *Parsecdata(struct Document *doc,UBYTE *p,UBYTE *end,BOOL eof)
          {  /* Convert \n to space */
             if(!Addtobuffer(&doc->args," ",1))
             {  /* Restore state on error */
-               attrs.first=saved_attrs_first;
-               attrs.last=saved_attrs_last;
-               nextattr=saved_nextattr;
-               doc->args.length=saved_args_length;
+               Restoreattrs(doc,&saved);
                return NULL;
             }
             ta->length++;
@@ -1391,10 +912,7 @@ static UBYTE *Parsecdata(struct Document *doc,UBYTE *p,UBYTE *end,BOOL eof)
          {  /* Copy character as-is */
             if(!Addtobuffer(&doc->args,q,1))
             {  /* Restore state on error */
-               attrs.first=saved_attrs_first;
-               attrs.last=saved_attrs_last;
-               nextattr=saved_nextattr;
-               doc->args.length=saved_args_length;
+               Restoreattrs(doc,&saved);
                return NULL;
             }
             ta->length++;
@@ -1404,21 +922,15 @@ static UBYTE *Parsecdata(struct Document *doc,UBYTE *p,UBYTE *end,BOOL eof)
       
       if(!Addtobuffer(&doc->args,"",1))
       {  /* Restore state on error */
-         attrs.first=saved_attrs_first;
-         attrs.last=saved_attrs_last;
-         nextattr=saved_nextattr;
-         doc->args.length=saved_args_length;
+         Restoreattrs(doc,&saved);
          return NULL;
       }
       
       /* Process the text content */
-      Processhtml(doc,MARKUP_TEXT,attrs.first);
+      Processhtml(doc,MARKUP_TEXT,doc->attrs.first);
       
       /* Restore previous parsing state */
-      attrs.first=saved_attrs_first;
-      attrs.last=saved_attrs_last;
-      nextattr=saved_nextattr;
-      doc->args.length=saved_args_length;
+      Restoreattrs(doc,&saved);
    }
    
    return p;
@@ -1466,19 +978,132 @@ static UBYTE *Parsedoctypedeclaration(struct Document *doc,UBYTE *p,UBYTE *end,B
    return p;
 }
 
+/* Find the token made by the token task for the tag or comment at (pos).
+ * Tokens are found in source order; the parser only goes back after a
+ * reload, or to the tag it has just processed after a suspend. */
+static struct Token *Findtoken(struct Document *doc,struct Buffer *src,long pos)
+{  struct Docsource *dos=doc->source;
+   struct Tokenblock *tb;
+   struct Token *tk=NULL;
+   long i;
+   if(!dos || src!=&dos->buf || !dos->tokentask || dos->tokenmode!=doc->htmlmode)
+      return NULL;
+   ObtainSemaphore(&dos->tokensema);
+   if(!doc->tokenblock || doc->tokenserial!=dos->tokenserial)
+   {  doc->tokenblock=dos->tokens.first;
+      doc->tokenindex=0;
+      doc->tokenserial=dos->tokenserial;
+   }
+   tb=doc->tokenblock;
+   i=doc->tokenindex;
+   if(tb->next)
+   {  if(i<tb->count && tb->token[i].pos>pos)
+      {  tb=dos->tokens.first;
+         i=0;
+      }
+      for(;;)
+      {  if(i>=tb->count)
+         {  if(!tb->next->next) break;
+            tb=tb->next;
+            i=0;
+         }
+         else if(tb->token[i].pos<pos) i++;
+         else
+         {  if(tb->token[i].pos==pos) tk=&tb->token[i];
+            break;
+         }
+      }
+      doc->tokenblock=tb;
+      doc->tokenindex=i;
+   }
+   else doc->tokenblock=NULL;
+   ReleaseSemaphore(&dos->tokensema);
+   return tk;
+}
+
+/* Lex the attributes of a tag that has no token. Returns the tag length,
+ * LEX_MORE, or a negative value if out of memory. */
+static long Lexattrs(struct Document *doc,UBYTE *p,UBYTE *end,long offset,struct Token *tk)
+{  struct Tokenattr *attrs;
+   long n;
+   while((n=Lextagattrs(p,end,offset,LEXMODE(doc->htmlmode),tk,doc->lexattrs,doc->maxlexattrs))
+      ==LEX_FULL)
+   {  if(!(attrs=PALLOCTYPE(struct Tokenattr,2*doc->maxlexattrs+16,0,doc->pool)))
+         return LEX_FULL;
+      if(doc->lexattrs) FREE(doc->lexattrs);
+      doc->lexattrs=attrs;
+      doc->maxlexattrs=2*doc->maxlexattrs+16;
+   }
+   tk->attrs=doc->lexattrs;
+   return n;
+}
+
+/* Build the attribute list of the tag at (p) from its token */
+static BOOL Buildtag(struct Document *doc,UBYTE *p,struct Token *tk)
+{  struct Tokenattr *tka;
+   struct Tagattr *ta;
+   UBYTE *q,*v,*vend;
+   BOOL removenl;
+   long i;
+   for(i=0;i<tk->nattrs;i++)
+   {  tka=&tk->attrs[i];
+      ta=Nextattr(doc);
+      /* If <EMBED>, only allow valid attributes. Pass others as EMBEDPARAM pairs */
+      if((tk->type&~MARKUP_END)==MARKUP_EMBED)
+      {  switch(tka->attr)
+         {  case TAGATTR_WIDTH:
+            case TAGATTR_HEIGHT:
+            case TAGATTR_NAME:
+            case TAGATTR_SRC:
+               ta->attr=tka->attr;
+               break;
+            default:
+               ta->attr=TAGATTR_EMBEDPARAMNAME;
+               if(!Addtobuffer(&doc->args,p+tka->name,tka->namelength)
+               || !Addtobuffer(&doc->args,"",1)) return FALSE;
+               ta=Nextattr(doc);
+               ta->attr=TAGATTR_EMBEDPARAMVALUE;
+         }
+      }
+      else ta->attr=tka->attr;
+      if(tka->flags&TAF_VALUE)
+      {  removenl=BOOLVAL(tka->flags&TAF_REMOVENL);
+         v=q=p+tka->value;
+         vend=v+tka->valuelength;
+         while(q<vend)
+         {  if(*q=='\r' || *q=='\n')
+            {  if(!Addtobuffer(&doc->args,v,q-v)) return FALSE;
+               ta->length+=(q-v);
+               if(*q=='\r' && q<vend-1 && q[1]=='\n') q++;
+               if(!Addtobuffer(&doc->args,removenl?"\n":" ",1)) return FALSE;
+               ta->length++;
+               v=++q;
+            }
+            else q++;
+         }
+         if(!Addtobuffer(&doc->args,v,q-v)) return FALSE;
+         ta->length+=(q-v);
+         if(!Addtobuffer(&doc->args,"",1)) return FALSE;
+         if(removenl) Removenl(&doc->args,ta);
+         Translate(doc,&doc->args,ta,TRUE);
+      }
+      else
+      {  /* Add nullbyte for empty attribute */
+         if(!Addtobuffer(&doc->args,"",1)) return FALSE;
+      }
+   }
+   return TRUE;
+}
+
 BOOL Parsehtml(struct Document *doc,struct Buffer *src,BOOL eof,long *srcpos)
 {  UBYTE *p=src->buffer+(*srcpos);
    UBYTE *end=src->buffer+src->length;
-   UBYTE *q;
-   UBYTE buf[32];
-   UBYTE quote;
-   struct Tagdes *td;
-   struct Attrdes *tattr;
    short i;
+   long n;
    struct Tagattr *ta;
+   struct Token token,*tk;
    USHORT tagtype;
    BOOL thisisdata=FALSE;  /* looks like tag but is in fact data */
-   BOOL removenl;          /* Remove newlines from URL values */
    BOOL skipnewline;       /* Current value of the DPF_SKIPNEWLINE flag */
    long oldsrcpos;
    /* Skip leading nullbytes and whitespace at document start */
@@ -1489,14 +1114,12 @@ BOOL Parsehtml(struct Document *doc,struct Buffer *src,BOOL eof,long *srcpos)
       *srcpos=p-src->buffer;
    }
    while(p<end && !(doc->pflags&DPF_SUSPEND))
-   {  NEWLIST(&attrs);
-      nextattr=0;
+   {  Resetattrs(doc);
       doc->args.length=0;
       skipnewline=BOOLVAL(doc->pflags&DPF_SKIPNEWLINE);
       if(p==end-1 && *p=='<' && !thisisdata) return Eofandexit(doc,eof);
       if(p<end-1 && *p=='<' && (isalpha(p[1]) || p[1]=='/' || p[1]=='!' || p[1]=='?') && !thisisdata)
-      {  BOOL endtag=FALSE;
-         if(++p>=end) return Eofandexit(doc,eof);
+      {  if(++p>=end) return Eofandexit(doc,eof);
          if(*p=='?' && !(doc->pflags&(DPF_XMP|DPF_LISTING|DPF_JSCRIPT)))
          {  /* XML processing instruction: <?target ... ?> */
             UBYTE *newp;
@@ -1520,19 +1143,24 @@ BOOL Parsehtml(struct Document *doc,struct Buffer *src,BOOL eof,long *srcpos)
             p++;
             if(p>=end-1) return Eofandexit(doc,eof);
             if(p[0]=='-' && p[1]=='-')    /* <!-- */
-            {  p+=2;                      /* skip opening -- */
-               switch(doc->htmlmode)
-               {  case HTML_STRICT:
-                     p=Parsecommentstrict(p,end,eof);
-                     break;
-                  case HTML_TOLERANT:
-                     p=Parsecommenttolerant(p,end,eof);
-                     break;
-                  default:
-                     p=Parsecommentcompatible(p,end,eof);
-                     break;
+            {  if(tk=Findtoken(doc,src,p-2-src->buffer))
+               {  p+=tk->length-2;        /* skip the whole comment */
+               }
+               else
+               {  p+=2;                   /* skip opening -- */
+                  switch(doc->htmlmode)
+                  {  case HTML_STRICT:
+                        p=Parsecommentstrict(p,end,eof);
+                        break;
+                     case HTML_TOLERANT:
+                        p=Parsecommenttolerant(p,end,eof);
+                        break;
+                     default:
+                        p=Parsecommentcompatible(p,end,eof);
+                        break;
+                  }
+                  if(!p || p>=end) return Eofandexit(doc,eof);
                }
-               if(!p || p>=end) return Eofandexit(doc,eof);
             }
             else if(p[0]=='[')  /* Could be CDATA section: <![CDATA[ */
             {  UBYTE *newp;
@@ -1563,151 +1191,34 @@ BOOL Parsehtml(struct Document *doc,struct Buffer *src,BOOL eof,long *srcpos)
             }
          }
          else
-         {  if(*p=='/')
-            {  endtag=TRUE;
-               if(++p>=end) return Eofandexit(doc,eof);
-            }
-            q=buf;
-            i=0;
-            while(p<end && Issgmlchar(*p) && i<31)
-            {  *q++=*p++;
-               i++;
-            }
-            if(p>=end) return Eofandexit(doc,eof);
-            *q='\0';
-            td=Findtag(buf);
-            if(doc->pflags&DPF_XMP)
-            {  if(!(endtag && td && td->type==MARKUP_XMP))
-               {  thisisdata=TRUE;
-                  p=src->buffer+(*srcpos);
-                  continue;   /* try again */
-               }
-            }
-            if(doc->pflags&DPF_LISTING)
-            {  if(!(endtag && td && td->type==MARKUP_LISTING))
-               {  thisisdata=TRUE;
-                  p=src->buffer+(*srcpos);
-                  continue;   /* try again */
-               }
+         {  p--;  /* Back to the '<' */
+            tk=NULL;
+            if(!(doc->pflags&(DPF_XMP|DPF_LISTING|DPF_JSCRIPT)))
+            {  tk=Findtoken(doc,src,p-src->buffer);
             }
-            if(doc->pflags&DPF_JSCRIPT)
-            {  if(!(endtag && td && td->type==MARKUP_SCRIPT))
+            if(!tk)
+            {  tk=&token;
+               if(!(n=Lextagname(p,end,tk))) return Eofandexit(doc,eof);
+               if(((doc->pflags&DPF_XMP) && tk->type!=(MARKUP_XMP|MARKUP_END))
+               || ((doc->pflags&DPF_LISTING) && tk->type!=(MARKUP_LISTING|MARKUP_END))
+               || ((doc->pflags&DPF_JSCRIPT) && tk->type!=(MARKUP_SCRIPT|MARKUP_END)))
                {  thisisdata=TRUE;
                   p=src->buffer+(*srcpos);
                   continue;   /* try again */
                }
+               n=Lexattrs(doc,p,end,n,tk);
+               if(n==LEX_MORE) return Eofandexit(doc,eof);
+               if(n<0) return FALSE;
             }
-            for(;;)
-            {  while(p<end && isspace(*p)) p++;
-               if(p>=end) return Eofandexit(doc,eof);
-               if(*p=='>') break;
-               if(doc->htmlmode!=HTML_STRICT && *p=='<')
-               {  p--;  /* Don't skip over '<' yet */
-                  break;
-               }
-               ta=Nextattr(doc);
-               i=0;q=buf;
-               if(!Issgmlchar(*p)) p++;   /* Skip invalid character to avoid endless loop */
-               while(p<end && Issgmlchar(*p) && i<31)
-               {  *q++=*p++;
-                  i++;
-               }
-               if(p>=end) return Eofandexit(doc,eof);
-               *q='\0';
-               tattr=Findattr(buf);
-               /* If <EMBED>, only allow valid attributes. Pass others as EMBEDPARAM pairs */
-               if(td && td->type==MARKUP_EMBED)
-               {  switch(tattr?tattr->type:0)
-                  {  case TAGATTR_WIDTH:
-                     case TAGATTR_HEIGHT:
-                     case TAGATTR_NAME:
-                     case TAGATTR_SRC:
-                        ta->attr=tattr->type;
-                        break;
-                     default:
-                        ta->attr=TAGATTR_EMBEDPARAMNAME;
-                        if(!Addtobuffer(&doc->args,buf,strlen(buf)+1)) return FALSE;
-                        ta=Nextattr(doc);
-                        ta->attr=TAGATTR_EMBEDPARAMVALUE;
-                  }
-               }
-               else if(tattr) ta->attr=tattr->type;
-               while(p<end && isspace(*p)) p++;
-               if(p>=end) return Eofandexit(doc,eof);
-               if(*p=='=')
-               {  p++;
-                  while(p<end && isspace(*p)) p++;
-                  if(p>=end) return Eofandexit(doc,eof);
-                  if(*p=='"' || *p=='\'')
-                  {  quote=*p;
-                     if(++p>=end) return Eofandexit(doc,eof);
-                     q=p;
-                     removenl=FALSE;
-                     if(doc->htmlmode!=HTML_STRICT)
-                     {  switch(ta->attr)
-                        {  case TAGATTR_ACTION:
-                           case TAGATTR_BACKGROUND:
-                           case TAGATTR_DATA:
-                           case TAGATTR_HREF:
-                           case TAGATTR_SRC:
-                           case TAGATTR_USEMAP:
-                              removenl=TRUE;
-                              break;
-                        }
-                     }
-                     while(q<end && *q!=quote)
-                     {  if(doc->htmlmode==HTML_COMPATIBLE)
-                        {  /* terminate quoted attribute on '>' */
-                           if(*q=='>') break;
-                           /* terminate URL on whitespace */
-                           if(isspace(*q)
-                           && (ta->attr==TAGATTR_HREF 
-                              || ta->attr==TAGATTR_SRC
-                              || ta->attr==TAGATTR_ACTION)) break;
-                        }
-                        if(*q=='\r' || *q=='\n')
-                        {  if(!Addtobuffer(&doc->args,p,q-p)) return FALSE;
-                           ta->length+=(q-p);
-                           if(*q=='\r')
-                           {  if(q>=end-1) return Eofandexit(doc,eof);
-                              if(q[1]=='\n') q++;
-                           }
-                           if(!Addtobuffer(&doc->args,removenl?"\n":" ",1)) return FALSE;
-                           ta->length++;
-                           p=++q;
-                        }
-                        else q++;
-                     }
-                     if(q>=end) return Eofandexit(doc,eof);
-                     if(!Addtobuffer(&doc->args,p,q-p)) return FALSE;
-                     ta->length+=(q-p);
-                     p=q;if(*p==quote) p++;
-                  }
-                  else
-                  {  q=p;
-                     while(q<end && !isspace(*q) && *q!='>') q++;
-                     if(!Addtobuffer(&doc->args,p,q-p)) return FALSE;
-                     ta->length+=(q-p);
-                     p=q;
-                  }
-                  if(!Addtobuffer(&doc->args,"",1)) return FALSE;
-                  if(removenl) Removenl(&doc->args,ta);
-                  Translate(doc,&doc->args,ta,TRUE);
-               }
-               else
-               {  /* Add nullbyte for empty attribute */
-                  if(!Addtobuffer(&doc->args,"",1)) return FALSE;
-               }
-            }
-            p++; /* skip over '>' */
+            if(!Buildtag(doc,p,tk)) return FALSE;
+            p+=tk->length;
             
             /* Skip newlines after opening tag */
-            if(td && td->container && !endtag && doc->htmlmode!=HTML_COMPATIBLE)
+            if((tk->flags&TKF_CONTAINER) && !(tk->type&MARKUP_END)
+            && doc->htmlmode!=HTML_COMPATIBLE)
             {  skipnewline=TRUE;
             }
-            if(td) tagtype=td->type;
-            else tagtype=MARKUP_UNKNOWN;
-            if(endtag) tagtype|=MARKUP_END;
+            tagtype=tk->type;
          }
       }
       else
@@ -1873,10 +1384,10 @@ BOOL Parsehtml(struct Document *doc,struct Buffer *src,BOOL eof,long *srcpos)
       oldsrcpos=*srcpos;
       (*srcpos)=p-src->buffer;   /* Before processhtml bcz buffer size calculation uses it */
       if(tagtype==MARKUP_TEXT && !(doc->pflags&DPF_JSCRIPT))
-      {  Lookforicons(doc,attrs.first);
+      {  Lookforicons(doc,doc->attrs.first);
       }
       else
-      {  Processhtml(doc,tagtype,attrs.first);
+      {  Processhtml(doc,tagtype,doc->attrs.first);
          if(doc->pflags&DPF_SUSPEND)
          {  /* Resume processing later with this same tag */
             (*srcpos)=oldsrcpos;
@@ -1897,13 +1408,12 @@ BOOL Parseplain(struct Document *doc,struct Buffer *src,BOOL eof,long *srcpos)
    if((*srcpos)==0)
    {  while(p<end && !*p) p++;
       *srcpos=p-src->buffer;
-      NEWLIST(&attrs);
+      Resetattrs(doc);
       Nextattr(doc);
-      Processhtml(doc,MARKUP_PRE,attrs.first);
+      Processhtml(doc,MARKUP_PRE,doc->attrs.first);
    }
    while(p<end)
-   {  NEWLIST(&attrs);
-      nextattr=0;
+   {  Resetattrs(doc);
       doc->args.length=0;
       ta=Nextattr(doc);
       ta->attr=TAGATTR_TEXT;
@@ -1936,7 +1446,7 @@ BOOL Parseplain(struct Document *doc,struct Buffer *src,BOOL eof,long *srcpos)
       p++;
       doc->charcount=0;
       (*srcpos)=p-src->buffer;
-      Processhtml(doc,MARKUP_TEXT,attrs.first);
+      Processhtml(doc,MARKUP_TEXT,doc->attrs.first);
    }
    return TRUE;
 }
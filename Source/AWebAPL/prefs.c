@@ -401,6 +401,7 @@ static ULONG Changedbrowser(void)
       if(!mio->next) pcmd|=PCMD_NEWMIME;
    }
    Installmimetypes();
+   Forgetfontwidths(NULL);
    Disposebrowserprefs(&oldp);
    return pcmd;
 }
@@ -487,6 +488,7 @@ static ULONG Changednetwork(void)
    Makepatterns(&prefs.nocookie);
    Makepatterns(&prefs.noproxy);
    Makepatterns(&prefs.nocache);
+   Cookieprefschanged();
    Disposenetworkprefs(&oldp);
    return pcmd;
 }
@@ -835,6 +837,7 @@ void Addtonocookie(UBYTE *name)
       }
       Savenocookieprefs(&prefs.network,FALSE,NULL);
       Savenocookieprefs(&prefs.network,TRUE,NULL);
+      Cookieprefschanged();
    }
    ReleaseSemaphore(&prefssema);
 }
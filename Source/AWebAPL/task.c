@@ -29,6 +29,27 @@
 
 /*------------------------------------------------------------------------*/
 
+/* Private extension of the Taskmsg structure */
+struct Ataskmsg
+{  struct Message execmsg;
+   struct Amessage *amsg;     /* If TSMF_UPDATEATTRS is set, it's a taglist, not a Amessage */
+   long result;
+   struct Atask *task;           
+   Repliedfunction *replied;
+   USHORT flags;
+   void *handoff;             /* Memory to free after an update is processed */
+};
+
+#define TSMF_ASYNC         0x0001   /* Async message */
+#define TSMF_VANILLASET    0x0002   /* A vanilla Asetattrsasync() message. Clean up after reply */
+#define TSMF_STOPMSG       0x0004   /* Subtask created this AOTSK_Stop,TRUE message */
+#define TSMF_UPDATE        0x0008   /* Update message from subtask to main. */
+#define TSMF_UPDATEATTRS   0x0010   /* Message is ready to use. */
+#define TSMF_SUSPEND       0x0020   /* Suspend subtask */
+#define TSMF_RELEASE       0x0040   /* Release subtask */
+#define TSMF_DRAIN         0x0080   /* Process the task's queued updates */
+#define TSMF_REPLACE       0x0100   /* Queued update may be replaced by a newer one */
+
 struct Atask
 {  struct Aobject object;
    Subtaskfunction *entry;
@@ -47,8 +68,21 @@ struct Atask
    struct SignalSemaphore runsema;  /* Occupied while subtask is running */
    void *windowptr;
    void *taskuserdata;
+   struct SignalSemaphore updsema;  /* Protects updates, nrupdates and drainposted */
+   struct MinList updates;    /* Update messages from subtask, in order */
+   long nrupdates;            /* Number of queued updates */
+   BOOL drainposted;          /* (drainmsg) is on its way to the main task */
+   struct Ataskmsg drainmsg;  /* Tells the main task to process (updates) */
 };
 
+/* Updates from a subtask are queued in the task object. The main task is
+ * only signalled when the queue becomes non-empty, and then processes
+ * up to UPDATEBATCH updates at once before giving other tasks a turn.
+ * A subtask that gets more than UPDATEQUEUEMAX updates ahead waits until
+ * the main task has caught up. */
+#define UPDATEQUEUEMAX     32
+#define UPDATEBATCH        16
+
 #define TSKS_NEW        1     /* New task */
 #define TSKS_RUN        2     /* Task is running */
 #define TSKS_SUSPEND    3     /* Task is suspended */
@@ -59,23 +93,6 @@ struct Atask
 #define TSKF_MUSTDISPOSE   0x0004   /* Must dispose when processing returns */
 #define TSKF_STARTED       0x0008   /* Task did start */
 
-/* Private extension of the Taskmsg structure */
-struct Ataskmsg
-{  struct Message execmsg;
-   struct Amessage *amsg;     /* If TSMF_UPDATEATTRS is set, it's a taglist, not a Amessage */
-   long result;
-   struct Atask *task;           
-   Repliedfunction *replied;
-   USHORT flags;
-};
-
-#define TSMF_ASYNC         0x0001   /* Async message */
-#define TSMF_VANILLASET    0x0002   /* A vanilla Asetattrsasync() message. Clean up after reply */
-#define TSMF_STOPMSG       0x0004   /* Subtask created this AOTSK_Stop,TRUE message */
-#define TSMF_UPDATE        0x0008   /* Update message from subtask to main. */
-#define TSMF_UPDATEATTRS   0x0010   /* Message is ready to use. */
-#define TSMF_SUSPEND       0x0020   /* Suspend subtask */
-#define TSMF_RELEASE       0x0040   /* Release subtask */
 
 static LIST(Atask) tasks;
 static struct Process *mainproc;    /* AWebs main process */
@@ -121,6 +138,10 @@ static void __saveds Subtask(void)
       task->state=TSKS_DEAD;
       ReleaseSemaphore(&task->sema);
       DeleteMsgPort(port);
+      if(task->updport)
+      {  DeleteMsgPort(task->updport);
+         task->updport=NULL;
+      }
 //KPrintF("%08lx - Subtask ends\n",task);
    }
    else
@@ -261,6 +282,58 @@ BOOL Checktaskbreak(void)
 {  return (BOOL)(SetSignal(0,0)&SIGBREAKF_CTRL_C);
 }
 
+/* See if two taglists have the same tags in the same order */
+static BOOL Sametags(struct TagItem *tags1,struct TagItem *tags2)
+{  struct TagItem *tag1,*tag2,*tstate1=tags1,*tstate2=tags2;
+   for(;;)
+   {  tag1=NextTagItem(&tstate1);
+      tag2=NextTagItem(&tstate2);
+      if(!tag1 || !tag2) return (BOOL)(tag1==tag2);
+      if(tag1->ti_Tag!=tag2->ti_Tag) return FALSE;
+   }
+}
+
+/* Queue an update for the main task. If the main task doesn't know about
+ * the queue yet, send it our drain message. A replaceable async update
+ * takes the place of the last queued one if that has the same tags. */
+static void Postupdate(struct Atask *task,struct Ataskmsg *atm)
+{  struct Ataskmsg *last;
+   BOOL post=FALSE;
+   ObtainSemaphore(&task->updsema);
+   last=(struct Ataskmsg *)task->updates.mlh_TailPred;
+   if((atm->flags&TSMF_REPLACE) && last->ln_Pred && (last->flags&TSMF_REPLACE)
+   && Sametags((struct TagItem *)last->amsg,(struct TagItem *)atm->amsg))
+   {  FreeTagItems((struct TagItem *)last->amsg);
+      if(last->handoff) FREE(last->handoff);
+      last->amsg=atm->amsg;
+      last->handoff=atm->handoff;
+      FREE(atm);
+   }
+   else
+   {  ADDTAIL(&task->updates,atm);
+      task->nrupdates++;
+      if(!task->drainposted)
+      {  task->drainposted=TRUE;
+         post=TRUE;
+      }
+   }
+   ReleaseSemaphore(&task->updsema);
+   if(post)
+   {  ObtainSemaphore(&portsema);
+      PutMsg(taskport,&task->drainmsg);
+      ReleaseSemaphore(&portsema);
+   }
+}
+
+/* Wait until the main task has processed this update */
+static long Waitupdate(struct Atask *task,struct Ataskmsg *atm)
+{  long result;
+   while(!GetMsg(task->updport)) WaitPort(task->updport);
+   result=atm->result;
+   FREE(atm);
+   return result;
+}
+
 long Updatetask(struct Amessage *amsg)
 {  struct Ataskmsg *atm;
    struct Atask *task=FindTask(NULL)->tc_UserData;
@@ -271,15 +344,10 @@ long Updatetask(struct Amessage *amsg)
          atm->amsg=amsg;
          atm->task=task;
          atm->flags=TSMF_UPDATE;
-         ObtainSemaphore(&portsema);
 //KPrintF("%08lx - Updatetask msg=%08lx\n",task,atm);
-         PutMsg(taskport,atm);
-         ReleaseSemaphore(&portsema);
-         WaitPort(task->updport);
-//KPrintF("%08lx - Continues  msg=%08lx\n",task,atm);
-         atm=(struct Ataskmsg *)GetMsg(task->updport);
-         result=atm->result;
-         FREE(atm);
+         Postupdate(task,atm);
+         result=Waitupdate(task,atm);
+//KPrintF("%08lx - Continues\n",task);
       }
    }
    return result;
@@ -289,33 +357,37 @@ long UpdatetaskattrsA(struct TagItem *tags)
 {  struct Ataskmsg *atm;
    struct Atask *task=FindTask(NULL)->tc_UserData;
    long result=0;
+   void *handoff=(void *)GetTagData(AOTSK_Handoff,NULL,tags);
    BOOL async;
    if(task->updport)
    {  if(atm=ALLOCSTRUCT(Ataskmsg,1,MEMF_PUBLIC|MEMF_CLEAR))
       {  async=GetTagData(AOTSK_Async,FALSE,tags);
+         /* Unsynchronized peek, only the main task makes it smaller */
+         if(task->nrupdates>=UPDATEQUEUEMAX) async=FALSE;
+         if(async && !(atm->amsg=(struct Amessage *)CloneTagItems(tags)))
+         {  async=FALSE;
+         }
          atm->mn_ReplyPort=task->updport;
+         atm->task=task;
+         atm->flags=TSMF_UPDATE|TSMF_UPDATEATTRS;
          if(async)
-         {  atm->amsg=(struct Amessage *)CloneTagItems(tags);
+         {  atm->flags|=TSMF_ASYNC;
+            if(GetTagData(AOTSK_Replace,FALSE,tags)) atm->flags|=TSMF_REPLACE;
+            atm->handoff=handoff;
+            handoff=NULL;
          }
          else
          {  atm->amsg=(struct Amessage *)tags;
          }
-         atm->task=task;
-         atm->flags=TSMF_UPDATE|TSMF_UPDATEATTRS;
-         if(async) atm->flags|=TSMF_ASYNC;
 //KPrintF("%08lx - Updatetaskattrs msg=%08lx async=%d\n",task,atm,async);
-         ObtainSemaphore(&portsema);
-         PutMsg(taskport,atm);
-         ReleaseSemaphore(&portsema);
+         Postupdate(task,atm);
          if(!async)
-         {  WaitPort(task->updport);
-//KPrintF("%08lx - Continues  msg=%08lx\n",task,atm);
-            atm=(struct Ataskmsg *)GetMsg(task->updport);
-            result=atm->result;
-            FREE(atm);
+         {  result=Waitupdate(task,atm);
+//KPrintF("%08lx - Continues\n",task);
          }
       }
    }
+   if(handoff) FREE(handoff);
    return result;
 }
 
@@ -335,37 +407,81 @@ void *Gettaskuserdata(void)
 
 /*------------------------------------------------------------------------*/
 
-/* Process a replied or update message */
-static void Processreply(struct Ataskmsg *atm)
+/* Pass an update from the subtask to the target */
+static void Processupdate(struct Atask *task,struct Ataskmsg *atm)
+{  if(task->target)
+   {  task->flags|=TSKF_PROCESSING;
+      if(atm->flags&TSMF_UPDATEATTRS)
+      {  atm->result=Aupdateattrs(task->target,task->maplist,
+            AOBJ_Target,task,
+            TAG_MORE,atm->amsg);
+      }
+      else
+      {  atm->result=Aupdateattrs(task->target,task->maplist,
+            AOBJ_Target,task,
+            AOTSK_Message,atm->amsg,
+            TAG_END);
+      }
+      task->flags&=~TSKF_PROCESSING;
+   }
+   if(atm->flags&TSMF_ASYNC)
+   {  FreeTagItems((struct TagItem *)atm->amsg);
+      if(atm->handoff) FREE(atm->handoff);
+      FREE(atm);
+   }
+   else
+   {  
+//KPrintF("%08lx * Replied      msg=%08lx\n",task,atm);
+      ReplyMsg(atm);
+   }
+}
+
+/* Process the updates queued by the subtask. Unless (all) is set, stop
+ * after a batch and send the drain message again so other tasks and
+ * the user interface get their turn. */
+static void Drainupdates(struct Atask *task,BOOL all)
+{  struct Ataskmsg *atm;
+   long n=0;
+   BOOL repost=FALSE;
+   ObtainSemaphore(&task->updsema);
+   task->drainposted=FALSE;
+   ReleaseSemaphore(&task->updsema);
+   while(!(task->flags&TSKF_MUSTDISPOSE))
+   {  ObtainSemaphore(&task->updsema);
+      if(!all && n>=UPDATEBATCH)
+      {  if(!ISEMPTY(&task->updates) && !task->drainposted)
+         {  task->drainposted=TRUE;
+            repost=TRUE;
+         }
+         atm=NULL;
+      }
+      else if(atm=REMHEAD(&task->updates))
+      {  task->nrupdates--;
+      }
+      ReleaseSemaphore(&task->updsema);
+      if(!atm) break;
+      Processupdate(task,atm);
+      n++;
+   }
+   if(repost)
+   {  ObtainSemaphore(&portsema);
+      PutMsg(taskport,&task->drainmsg);
+      ReleaseSemaphore(&portsema);
+   }
+}
+
+/* Process a replied or update message. Returns TRUE if the task was
+ * disposed of. */
+static BOOL Processreply(struct Ataskmsg *atm)
 {  struct Atask *task;
    if(atm)
    {  task=atm->task;
 //KPrintF("%08lx * Processreply msg=%08lx\n",task,atm);
-      if(atm->flags&TSMF_UPDATE)
-      {  if(task->target)
-         {  task->flags|=TSKF_PROCESSING;
-            if(atm->flags&TSMF_UPDATEATTRS)
-            {  atm->result=Aupdateattrs(task->target,task->maplist,
-                  AOBJ_Target,task,
-                  TAG_MORE,atm->amsg);
-            }
-            else
-            {  atm->result=Aupdateattrs(task->target,task->maplist,
-                  AOBJ_Target,task,
-                  AOTSK_Message,atm->amsg,
-                  TAG_END);
-            }
-            task->flags&=~TSKF_PROCESSING;
-         }
-         if(atm->flags&TSMF_ASYNC)
-         {  FreeTagItems((struct TagItem *)atm->amsg);
-            FREE(atm);
-         }
-         else
-         {  
-//KPrintF("%08lx * Replied      msg=%08lx\n",task,atm);
-            ReplyMsg(atm);
-         }
+      if(atm->flags&TSMF_DRAIN)
+      {  Drainupdates(task,FALSE);
+      }
+      else if(atm->flags&TSMF_UPDATE)
+      {  Processupdate(task,atm);
       }
       else
       {  if(atm->replied)
@@ -379,8 +495,10 @@ static void Processreply(struct Ataskmsg *atm)
       }
       if(task->flags&TSKF_MUSTDISPOSE)
       {  Dodisposetask(task);
+         return TRUE;
       }
    }
+   return FALSE;
 }
 
 /* Process all queued messages for this task */
@@ -399,8 +517,14 @@ static void Processtaskreply(struct Atask *task)
          }
       }
       ReleaseSemaphore(&portsema);
-      if(process) Processreply(msg);
+      if(process && Processreply(msg)) return;
    } while(process);
+   /* Processing may have stopped halfway the queue, while the subtask
+    * waits for an update still in it. */
+   Drainupdates(task,TRUE);
+   if(task->flags&TSKF_MUSTDISPOSE)
+   {  Dodisposetask(task);
+   }
 }
 
 /* Set our port's signal, after having Wait()'ed for it but not processing
@@ -686,6 +810,10 @@ static struct Atask *Newtask(struct Amset *ams)
    {  ADDTAIL(&tasks,task);
       InitSemaphore(&task->sema);
       InitSemaphore(&task->runsema);
+      InitSemaphore(&task->updsema);
+      NEWLIST(&task->updates);
+      task->drainmsg.task=task;
+      task->drainmsg.flags=TSMF_DRAIN;
       task->stacksize=20000;
       task->state=TSKS_NEW;
       Settask(task,ams);
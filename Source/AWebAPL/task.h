@@ -51,6 +51,12 @@
  * mapping).
  * In both cases, AOBJ_Target in the AOM_UPDATE message is set to the
  * task object.
+ * Updates are queued per task and the main task processes them in order,
+ * in batches. Only updates that need the result, or that point to data
+ * the subtask will change afterwards, should be synchroneous. Data for
+ * AOTSK_Async updates can be handed over with AOTSK_Handoff. When the
+ * subtask is too far ahead of the main task, an AOTSK_Async update waits
+ * until it has been processed.
  *
  * The main task can suspend the subtask by setting AOTSK_Suspend to TRUE.
  * Setting it to FALSE restarts the subtask. The subtask is only suspended
@@ -116,6 +122,16 @@ typedef void Repliedfunction(void *task,struct Taskmsg *msg);
     * (Subtask may have been finished before the main task had
     * a chance to GET this attribute) */
 
+#define AOTSK_Handoff      (AOTSK_Dummy+12)  /* UPDATE */
+   /* (void *) Memory allocated by the subtask with ALLOCTYPE that is
+    * handed over with an Updatetaskattrs() message. It is freed after the
+    * message has been processed, so AOTSK_Async updates can point into it. */
+
+#define AOTSK_Replace      (AOTSK_Dummy+13)  /* UPDATE */
+   /* (BOOL) This AOTSK_Async update supersedes the previous one that is
+    * still queued, if that was also sent with AOTSK_Replace and has the
+    * same tags in the same order. Use for progress and status updates. */
+
 #define AOTSK_    (AOTSK_Dummy+)
 #define AOTSK_    (AOTSK_Dummy+)
 
@@ -161,7 +177,8 @@ extern long UpdatetaskattrsA(struct TagItem *tags);
 extern long Updatetaskattrs(ULONG tag,...);
    /* Builds an AOM_UPDATE message and sends it to the main task. 
     * If the taglist contains AOTSK_Async,TRUE the subtask will not wait
-    * until the message is replied. */
+    * until the message is replied, and the taglist is copied. Data
+    * pointed to by the tags is not copied, see AOTSK_Handoff. */
 
 extern BOOL Obtaintasksemaphore(struct SignalSemaphore *sema);
    /* Obtains this semaphore, but listens also for AOTSK_Stop.
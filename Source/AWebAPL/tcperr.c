@@ -109,10 +109,15 @@ void Tcperror(struct Fetchdriver *fd,ULONG err,...)
 }
 
 void TcpmessageA(struct Fetchdriver *fd,ULONG msg,ULONG *args)
-{  vsprintf(fd->block,AWEBSTR(message[msg]),(va_list)args);
-   Updatetaskattrs(
-      AOURL_Status,fd->block,
-      TAG_END);
+{  UBYTE *status;
+   vsprintf(fd->block,AWEBSTR(message[msg]),(va_list)args);
+   if(status=Dupstr(fd->block,-1))
+   {  Updatetaskattrs(AOTSK_Async,TRUE,
+         AOTSK_Replace,TRUE,
+         AOTSK_Handoff,status,
+         AOURL_Status,status,
+         TAG_END);
+   }
 }
 
 void Tcpmessage(struct Fetchdriver *fd,ULONG msg,...)
@@ -0,0 +1,300 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb APL distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* tokenize.c - AWeb HTML tokenizer */
+
+/* This file has no system dependencies, so it can be built and tested
+ * on any host. */
+
+#include <exec/types.h>
+#include <string.h>
+#include <ctype.h>
+#include "ezlists.h"
+#include "html.h"
+#include "htmlnames.h"
+#include "tokenize.h"
+
+/*-----------------------------------------------------------------------*/
+
+long Lextagname(UBYTE *p,UBYTE *end,struct Token *tk)
+{  UBYTE *q=p+1,*name;
+   struct Tagdes *td;
+   tk->type=0;
+   tk->flags=0;
+   tk->length=0;
+   tk->nattrs=0;
+   if(q>=end) return LEX_MORE;
+   if(*q=='/')
+   {  tk->type=MARKUP_END;
+      if(++q>=end) return LEX_MORE;
+   }
+   name=q;
+   while(q<end && Issgmlchar(*q) && q-name<31) q++;
+   if(q>=end) return LEX_MORE;
+   if(td=Findtag(name,q-name))
+   {  tk->type|=td->type;
+      if(td->container) tk->flags|=TKF_CONTAINER;
+   }
+   return q-p;
+}
+
+long Lextagattrs(UBYTE *p,UBYTE *end,long offset,USHORT lexmode,
+   struct Token *tk,struct Tokenattr *attrs,long maxattrs)
+{  UBYTE *q=p+offset,*name;
+   UBYTE quote;
+   struct Attrdes *tattr;
+   struct Tokenattr *ta;
+   USHORT vattr;
+   tk->nattrs=0;
+   for(;;)
+   {  while(q<end && isspace(*q)) q++;
+      if(q>=end) return LEX_MORE;
+      if(*q=='>') break;
+      if(!(lexmode&LXM_STRICT) && *q=='<')
+      {  q--;  /* Don't skip over '<' yet */
+         break;
+      }
+      if(tk->nattrs>=maxattrs) return LEX_FULL;
+      ta=&attrs[tk->nattrs++];
+      ta->attr=0;
+      ta->flags=0;
+      ta->value=0;
+      ta->valuelength=0;
+      if(!Issgmlchar(*q)) q++;   /* Skip invalid character to avoid endless loop */
+      name=q;
+      while(q<end && Issgmlchar(*q) && q-name<31) q++;
+      if(q>=end) return LEX_MORE;
+      ta->name=name-p;
+      ta->namelength=q-name;
+      if(tattr=Findattr(name,q-name)) ta->attr=tattr->type;
+      /* The value rules go by the attribute type the parser will give it.
+       * EMBED only knows a few attributes, the others become parameters. */
+      vattr=ta->attr;
+      if((tk->type&~MARKUP_END)==MARKUP_EMBED)
+      {  switch(vattr)
+         {  case TAGATTR_WIDTH:
+            case TAGATTR_HEIGHT:
+            case TAGATTR_NAME:
+            case TAGATTR_SRC:
+               break;
+            default:
+               vattr=TAGATTR_EMBEDPARAMVALUE;
+         }
+      }
+      while(q<end && isspace(*q)) q++;
+      if(q>=end) return LEX_MORE;
+      if(*q=='=')
+      {  q++;
+         while(q<end && isspace(*q)) q++;
+         if(q>=end) return LEX_MORE;
+         ta->flags|=TAF_VALUE;
+         if(*q=='"' || *q=='\'')
+         {  quote=*q;
+            if(++q>=end) return LEX_MORE;
+            ta->value=q-p;
+            if(!(lexmode&LXM_STRICT))
+            {  switch(vattr)
+               {  case TAGATTR_ACTION:
+                  case TAGATTR_BACKGROUND:
+                  case TAGATTR_DATA:
+                  case TAGATTR_HREF:
+                  case TAGATTR_SRC:
+                  case TAGATTR_USEMAP:
+                     ta->flags|=TAF_REMOVENL;
+                     break;
+               }
+            }
+            while(q<end && *q!=quote)
+            {  if(lexmode&LXM_COMPATIBLE)
+               {  /* terminate quoted attribute on '>' */
+                  if(*q=='>') break;
+                  /* terminate URL on whitespace */
+                  if(isspace(*q)
+                  && (vattr==TAGATTR_HREF
+                     || vattr==TAGATTR_SRC
+                     || vattr==TAGATTR_ACTION)) break;
+               }
+               /* A CR may be followed by a LF */
+               if(*q=='\r' && q>=end-1) return LEX_MORE;
+               q++;
+            }
+            if(q>=end) return LEX_MORE;
+            ta->valuelength=q-p-ta->value;
+            if(*q==quote) q++;
+         }
+         else
+         {  ta->value=q-p;
+            while(q<end && !isspace(*q) && *q!='>') q++;
+            ta->valuelength=q-p-ta->value;
+         }
+      }
+   }
+   q++; /* skip over '>' */
+   tk->length=q-p;
+   return tk->length;
+}
+
+/*-----------------------------------------------------------------------*/
+
+/* Parse comment in html mode. Initial p points after initial "<!--"
+ * Return new buffer pointer, or NULL when eof */
+
+/* Strict HTML:  <!{--comment--wsp}> */
+UBYTE *Parsecommentstrict(UBYTE *p,UBYTE *end,BOOL eof)
+{  for(;;)
+   {  while(p<end-1 && !(p[0]=='-' && p[1]=='-')) p++;   /* Skip to closing -- */
+      p+=2;
+      while(p<end-1 && *p!='>' && !(p[0]=='-' && p[1]=='-')) p++;
+      if(p>=end-1) return NULL;
+      if(*p=='>') break;
+      p+=2;                                              /* skip next opening -- */
+   }
+   p++;  /* Skip closing > */
+   return p;
+}
+
+/* Tolerant: Try strict first, but if wsp is something else than wsp,
+ * or "---" is found, then redo using    <!--any> */
+UBYTE *Parsecommenttolerant(UBYTE *p,UBYTE *end,BOOL eof)
+{  UBYTE *savep=p;
+   for(;;)
+   {  while(p<end-1 && !(p[0]=='-' && p[1]=='-')) p++;   /* Skip to closing -- */
+      p+=2;
+      if(p<end && *p=='-')
+      {  /* "---" */
+         break;
+      }
+      while(p<end && isspace(*p)) p++;                   /* Skip whitespace */
+      if(p<end && *p=='>')
+      {  p++;
+         return p;
+      }
+      else if(p>=end-1)
+      {  if(!eof) return NULL;
+         /* EOF found, retry */
+         break;
+      }
+      else if(p[0]=='-' && p[1]=='-')
+      {  /* Still a valid strict comment */
+         p+=2;                                           /* Skip next opening -- */
+         if(p<end && *p=='-')
+         {  /* "---" */
+            break;
+         }
+      }
+      else
+      {  /* Whitespace is no whitespace, retry */
+         break;
+      }
+   }
+   /* If loop was broken, retry */
+   p=savep;
+   while(p<end && *p!='>') p++;                          /* Skip to > */
+   p++;
+   return p;
+}
+
+/* Compatible:   <!--comment> */
+UBYTE *Parsecommentcompatible(UBYTE *p,UBYTE *end,BOOL eof)
+{  while(p<end && !(p[0]=='>')) p++;      /* Skip to > */
+   if(p>=end) return NULL;
+   p++;
+   return p;
+}
+
+/*-----------------------------------------------------------------------*/
+
+void Inittokenizer(struct Tokenizer *tkz)
+{  tkz->pos=0;
+   tkz->raw=0;
+}
+
+/* Tokens are only produced where the parser could be: at a '<' that starts
+ * a tag or comment. Unfinished tokens are lexed again when more source is
+ * available, so a token never depends on where the source was split. */
+short Tokenize(struct Tokenizer *tkz,UBYTE *buffer,long length)
+{  UBYTE *p=buffer+tkz->pos,*end=buffer+length,*q;
+   struct Token tk;
+   long n;
+   while(p<end)
+   {  if(*p!='<')
+      {  if(!(q=memchr(p,'<',end-p)))
+         {  p=end;
+            break;
+         }
+         p=q;
+      }
+      tkz->pos=p-buffer;
+      if(p>=end-1) return TKZ_MORE;
+      if(tkz->raw)
+      {  /* Only look for the end tag */
+         if(p[1]!='/')
+         {  p++;
+            continue;
+         }
+      }
+      else if(p[1]=='!')
+      {  if(p>=end-3) return TKZ_MORE;
+         if(p[2]=='-' && p[3]=='-')
+         {  if(tkz->lexmode&LXM_STRICT) q=Parsecommentstrict(p+4,end,FALSE);
+            else if(tkz->lexmode&LXM_COMPATIBLE) q=Parsecommentcompatible(p+4,end,FALSE);
+            else q=Parsecommenttolerant(p+4,end,FALSE);
+            if(!q || q>=end) return TKZ_MORE;
+            tk.pos=p-buffer;
+            tk.length=q-p;
+            tk.type=0;
+            tk.flags=TKF_COMMENT;
+            tk.nattrs=0;
+            tk.attrs=NULL;
+            p=q;
+            tkz->pos=p-buffer;
+            if(!tkz->emit(tkz->userdata,&tk)) return TKZ_PAUSE;
+         }
+         else p++;   /* Declarations are left to the parser */
+         continue;
+      }
+      else if(!isalpha(p[1]) && p[1]!='/')
+      {  p++;
+         continue;
+      }
+      if(!(n=Lextagname(p,end,&tk))) return TKZ_MORE;
+      if(tkz->raw && tk.type!=(tkz->raw|MARKUP_END))
+      {  p++;
+         continue;
+      }
+      n=Lextagattrs(p,end,n,tkz->lexmode,&tk,tkz->attrs,tkz->maxattrs);
+      if(n==LEX_MORE) return TKZ_MORE;
+      if(n==LEX_FULL) return TKZ_FULL;
+      tk.pos=p-buffer;
+      tk.attrs=tkz->attrs;
+      p+=n;
+      tkz->pos=p-buffer;
+      switch(tk.type)
+      {  case MARKUP_SCRIPT:
+         case MARKUP_XMP:
+         case MARKUP_LISTING:
+            tkz->raw=tk.type;
+            break;
+         default:
+            if(tk.type&MARKUP_END) tkz->raw=0;
+      }
+      if(!tkz->emit(tkz->userdata,&tk)) return TKZ_PAUSE;
+   }
+   tkz->pos=p-buffer;
+   return TKZ_MORE;
+}
@@ -0,0 +1,112 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb APL distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* tokenize.h - AWeb HTML tokenizer */
+
+#ifndef AWEB_TOKENIZE_H
+#define AWEB_TOKENIZE_H
+
+#include <exec/types.h>
+
+/* The tokenizer finds the tags and comments in HTML source. A tag is only
+ * split into spans of the source: the tag type, and the name, type and value
+ * of each attribute. Copying values and translating entities is left to the
+ * parser. Tokens depend on nothing but the source and the HTML mode, so they
+ * can be produced ahead of the parser by another task.
+ * The parser uses the same functions when there is no token for a tag.
+ *
+ * Issgmlchar() must be provided by the program. */
+
+struct Tokenattr
+{  long name;              /* Offset of the name from the start of the tag */
+   long value;             /* Offset of the value, without quotes */
+   long valuelength;       /* Length of the value in the source */
+   USHORT attr;            /* TAGATTR_xxx, or 0 if unknown */
+   UBYTE namelength;
+   UBYTE flags;            /* See below */
+};
+
+#define TAF_VALUE       0x01  /* Attribute has a value */
+#define TAF_REMOVENL    0x02  /* Newlines in the value must be removed */
+
+struct Token
+{  long pos;               /* Source offset of the '<' */
+   long length;            /* Length of the tag in the source */
+   USHORT type;            /* MARKUP_xxx, with MARKUP_END for an end tag */
+   USHORT flags;           /* See below */
+   long nattrs;
+   struct Tokenattr *attrs;
+};
+
+#define TKF_CONTAINER   0x0001   /* Known container tag */
+#define TKF_COMMENT     0x0002   /* Comment, type is not valid */
+
+/* Lexing rules, following the HTML mode */
+#define LXM_STRICT      0x0001   /* Strict comments, '<' doesn't end a tag */
+#define LXM_COMPATIBLE  0x0002   /* Compatible comments, quoted values end at '>'
+                                  * and quoted URLs at whitespace */
+
+/* Return values of the Lex functions. A positive value is a length. */
+#define LEX_MORE        0     /* More source is needed */
+#define LEX_FULL        (-1)  /* Attribute array is too small */
+
+/* Lex the tag name after the '<' at (p). Fills in the type and flags of (tk)
+ * and returns the length up to the end of the name. */
+extern long Lextagname(UBYTE *p,UBYTE *end,struct Token *tk);
+
+/* Lex the attributes of a tag whose name ended at (p+offset). Fills in the
+ * attributes and length of (tk), and returns the length of the tag. */
+extern long Lextagattrs(UBYTE *p,UBYTE *end,long offset,USHORT lexmode,
+   struct Token *tk,struct Tokenattr *attrs,long maxattrs);
+
+/* Skip the comment that starts after the "<!--" at (p). Returns a pointer
+ * after the comment, or NULL if more source is needed. */
+extern UBYTE *Parsecommentstrict(UBYTE *p,UBYTE *end,BOOL eof);
+extern UBYTE *Parsecommenttolerant(UBYTE *p,UBYTE *end,BOOL eof);
+extern UBYTE *Parsecommentcompatible(UBYTE *p,UBYTE *end,BOOL eof);
+
+/* Incremental tokenizer. Set (lexmode), (emit), (userdata) and an attribute
+ * array, then call Tokenize() whenever more source is available. Source is
+ * skipped between tokens; the contents of SCRIPT, XMP and LISTING elements
+ * are not tokenized. */
+
+struct Tokenizer
+{  USHORT lexmode;          /* LXM_xxx */
+   BOOL (*emit)(void *userdata,struct Token *tk);
+                           /* Receives each token. Return FALSE to pause */
+   void *userdata;
+   struct Tokenattr *attrs;   /* Attribute array for the token being lexed */
+   long maxattrs;
+
+   /* Tokenizer state */
+
+   long pos;               /* Source offset to continue at */
+   USHORT raw;             /* Element whose contents are skipped, or 0 */
+};
+
+/* Tokenize() results */
+#define TKZ_MORE        0     /* All source is tokenized, more is needed */
+#define TKZ_PAUSE       1     /* (emit) returned FALSE */
+#define TKZ_FULL        2     /* Attribute array must be enlarged */
+
+extern void Inittokenizer(struct Tokenizer *tkz);
+extern short Tokenize(struct Tokenizer *tkz,UBYTE *buffer,long length);
+
+extern BOOL Issgmlchar(UBYTE c);
+
+#endif
@@ -39,6 +39,30 @@ static struct Library *TTEngineBase = NULL;
 /* Flag to track if ttengine is available */
 static BOOL ttengine_available = FALSE;
 
+/* Fonts opened by TTEngineSetFont(), kept open so that the same face,
+ * size and style always gives the same handle */
+struct Ttfont
+{  NODE(Ttfont);
+   UBYTE *face;
+   LONG size;
+   LONG weight;
+   LONG style;
+   APTR ttfont;
+};
+
+static LIST(Ttfont) ttfonts;
+
+/* Font handle last set on a rastport, for TTEngineActiveFont() */
+#define NRTTACTIVE 8
+
+struct Ttactive
+{  struct RastPort *rp;
+   APTR ttfont;
+};
+
+static struct Ttactive ttactive[NRTTACTIVE];
+static short nextttactive = 0;
+
 /*------------------------------------------------------------------------*/
 
 /* Initialize ttengine.library support */
@@ -61,6 +85,7 @@ BOOL InitTTEngine(void)
       return FALSE;
    }
    
+   NEWLIST(&ttfonts);
    ttengine_available = TRUE;
    return TRUE;
 }
@@ -70,8 +95,19 @@ BOOL InitTTEngine(void)
 /* Cleanup ttengine.library support */
 void FreeTTEngine(void)
 {
+   struct Ttfont *tf;
+   
    if(TTEngineBase)
    {
+      if(ttfonts.first)
+      {
+         while(tf = REMHEAD(&ttfonts))
+         {
+            TT_CloseFont(tf->ttfont);
+            FREE(tf->face);
+            FREE(tf);
+         }
+      }
       CloseLibrary(TTEngineBase);
       TTEngineBase = NULL;
    }
@@ -457,6 +493,47 @@ static UBYTE *GetFontNameFromPrefs(struct TextFont *font)
    return NULL;
 }
 
+/*------------------------------------------------------------------------*/
+
+/* Remember which font handle is set on this rastport, NULL if none */
+static void SetActiveFont(struct RastPort *rp, APTR ttfont)
+{
+   short i;
+   
+   for(i = 0; i < NRTTACTIVE; i++)
+   {
+      if(ttactive[i].rp == rp)
+      {
+         ttactive[i].ttfont = ttfont;
+         return;
+      }
+   }
+   if(ttfont)
+   {
+      ttactive[nextttactive].rp = rp;
+      ttactive[nextttactive].ttfont = ttfont;
+      nextttactive = (nextttactive + 1) % NRTTACTIVE;
+   }
+}
+
+/* Find an already opened font */
+static struct Ttfont *FindTTFont(UBYTE *face, LONG size, LONG weight, LONG style)
+{
+   struct Ttfont *tf;
+   
+   for(tf = ttfonts.first; tf->next; tf = tf->next)
+   {
+      if(tf->size == size && tf->weight == weight && tf->style == style
+         && STRIEQUAL(tf->face, face))
+      {
+         return tf;
+      }
+   }
+   return NULL;
+}
+
+/*------------------------------------------------------------------------*/
+
 /* Set font on rastport (uses ttengine if available, else standard SetFont) */
 /* fontface can be from CSS font-family or HTML FONT face attribute */
 /* If fontface is NULL, font name will be looked up from Fontprefs */
@@ -464,11 +541,13 @@ static UBYTE *GetFontNameFromPrefs(struct TextFont *font)
 void TTEngineSetFont(struct RastPort *rp, struct TextFont *font, UBYTE *fontface, USHORT style)
 {
    APTR ttfont;
+   struct Ttfont *tf;
    struct TagItem tags[6];
    struct TagItem attrtags[4];
    UBYTE *familytable[8];
    UBYTE workbuf[512];
    UBYTE *fontname;
+   UBYTE *face;
    LONG fontsize;
    LONG fontweight;
    LONG fontstyle;
@@ -476,6 +555,7 @@ void TTEngineSetFont(struct RastPort *rp, struct TextFont *font, UBYTE *fontface
    struct Screen *screen = NULL;
    ULONG i;
    BOOL was_ttengine_active = FALSE;
+   BOOL opened = FALSE;
    
    if(!rp || !font)
    {
@@ -543,24 +623,55 @@ void TTEngineSetFont(struct RastPort *rp, struct TextFont *font, UBYTE *fontface
             fontstyle = TT_FontStyle_Regular;
          }
          
-         /* Parse comma-separated font family list (from CSS or HTML face attribute) */
-         /* Or use single font name (already converted to TrueType family name if from Fontprefs) */
-         ParseFontFamilyList(fontname, workbuf, sizeof(workbuf), 
-                            familytable, sizeof(familytable)/sizeof(familytable[0]));
-         
-         /* Build tag list using font name with same size as TextFont */
-         tags[0].ti_Tag = TT_FamilyTable;
-         tags[0].ti_Data = (ULONG)familytable;
-         tags[1].ti_Tag = TT_FontSize;
-         tags[1].ti_Data = (ULONG)fontsize;
-         tags[2].ti_Tag = TT_FontWeight;
-         tags[2].ti_Data = (ULONG)fontweight;
-         tags[3].ti_Tag = TT_FontStyle;
-         tags[3].ti_Data = (ULONG)fontstyle;
-         tags[4].ti_Tag = TAG_END;
-         
-         /* Try to open font using ttengine */
-         ttfont = TT_OpenFontA(tags);
+         /* Reuse the font if this face, size and style was opened before */
+         ttfont = NULL;
+         face = NULL;
+         if(tf = FindTTFont(fontname, fontsize, fontweight, fontstyle))
+         {
+            ttfont = tf->ttfont;
+         }
+         else if(face = Dupstr(fontname, -1))
+         {
+            /* Parse comma-separated font family list (from CSS or HTML face attribute) */
+            /* Or use single font name (already converted to TrueType family name if from Fontprefs) */
+            ParseFontFamilyList(fontname, workbuf, sizeof(workbuf), 
+                               familytable, sizeof(familytable)/sizeof(familytable[0]));
+            
+            /* Build tag list using font name with same size as TextFont */
+            tags[0].ti_Tag = TT_FamilyTable;
+            tags[0].ti_Data = (ULONG)familytable;
+            tags[1].ti_Tag = TT_FontSize;
+            tags[1].ti_Data = (ULONG)fontsize;
+            tags[2].ti_Tag = TT_FontWeight;
+            tags[2].ti_Data = (ULONG)fontweight;
+            tags[3].ti_Tag = TT_FontStyle;
+            tags[3].ti_Data = (ULONG)fontstyle;
+            tags[4].ti_Tag = TAG_END;
+            
+            /* Try to open font using ttengine */
+            ttfont = TT_OpenFontA(tags);
+            
+            if(ttfont && (tf = ALLOCSTRUCT(Ttfont, 1, MEMF_CLEAR)))
+            {
+               tf->face = face;
+               tf->size = fontsize;
+               tf->weight = fontweight;
+               tf->style = fontstyle;
+               tf->ttfont = ttfont;
+               ADDTAIL(&ttfonts, tf);
+               opened = TRUE;
+            }
+            else
+            {
+               /* Not cached, so nobody would close it */
+               if(ttfont)
+               {
+                  TT_CloseFont(ttfont);
+                  ttfont = NULL;
+               }
+               FREE(face);
+            }
+         }
          
          if(ttfont)
          {
@@ -616,12 +727,20 @@ void TTEngineSetFont(struct RastPort *rp, struct TextFont *font, UBYTE *fontface
             {
                /* Success - ttengine font is now active on rastport */
                /* Use TT_Text() for rendering instead of Text() */
+               SetActiveFont(rp, ttfont);
                return;
             }
             else
             {
-               /* Failed to set, close and fall through to standard font */
-               TT_CloseFont(ttfont);
+               /* Failed to set, fall through to standard font. Only close the
+                * font if it was opened here, a cached one is shared. */
+               if(opened)
+               {
+                  REMOVE(tf);
+                  FREE(tf->face);
+                  FREE(tf);
+                  TT_CloseFont(ttfont);
+               }
             }
          }
          /* If ttengine font not found, fall through to use standard TextFont */
@@ -639,6 +758,7 @@ void TTEngineSetFont(struct RastPort *rp, struct TextFont *font, UBYTE *fontface
          /* Clear ttengine state on rastport - this will reset it to use standard fonts */
          TT_DoneRastPort(rp);
       }
+      SetActiveFont(rp, NULL);
    }
    
    /* If ttengine not available or font not found, normal SetFont was already called above */
@@ -673,6 +793,23 @@ BOOL IsTTEngineFontActive(struct RastPort *rp)
 
 /*------------------------------------------------------------------------*/
 
+/* Get the font handle set on a rastport by TTEngineSetFont() */
+APTR TTEngineActiveFont(struct RastPort *rp)
+{
+   short i;
+   
+   for(i = 0; i < NRTTACTIVE; i++)
+   {
+      if(ttactive[i].rp == rp)
+      {
+         return ttactive[i].ttfont;
+      }
+   }
+   return NULL;
+}
+
+/*------------------------------------------------------------------------*/
+
 /* Text rendering wrapper (uses ttengine if available) */
 /* Uses TT_Text() if ttengine font is active, otherwise uses standard Text() */
 void TTEngineText(struct RastPort *rp, UBYTE *string, ULONG count)
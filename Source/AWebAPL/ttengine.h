@@ -61,4 +61,9 @@ ULONG TTEngineTextFit(struct RastPort *rp, UBYTE *string, UWORD count, struct Te
 /* Check if ttengine font is currently active on a rastport */
 BOOL IsTTEngineFontActive(struct RastPort *rp);
 
+/* Get the font handle set on a rastport by TTEngineSetFont(), or NULL if
+ * not known. Handles stay valid until FreeTTEngine(), so the same handle
+ * means the same face, size and style. */
+APTR TTEngineActiveFont(struct RastPort *rp);
+
 #endif
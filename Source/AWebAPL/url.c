@@ -23,6 +23,7 @@
 #include "link.h"
 #include "source.h"
 #include "cache.h"
+#include "capack.h"
 #include "fetch.h"
 #include "window.h"
 #include "xhrjs.h"
@@ -48,6 +49,9 @@ struct Url
    struct Aobject *dsource;   /* Docext source */
    LIST(Child) childs;        /* Childs pointing to this URL */
    long loadnr;               /* Load sequence number */
+   ULONG hash;                /* Hash of URL string */
+   struct Url *hashnext;      /* Next in hash bucket */
+   struct Url *loadnext;      /* Next in load number bucket */
 };
 
 #define URLF_VISITED    0x0001   /* Url is visited before */
@@ -67,13 +71,22 @@ struct Child
 
 static UBYTE absurl[4096];
 
-#define NRLISTS 64
-#define HASHMASK  (NRLISTS-1)
-
-static LIST(Url) urls[NRLISTS];
+/* All urls are in one list, newest first. For lookup there is a hash table
+ * by URL string, and one by load number for the urls that were loaded.
+ * Both tables double in size when the average bucket holds more than
+ * URLLOADFACTOR urls. */
+#define URLHASHMIN      256
+#define URLLOADFACTOR   2
+
+static LIST(Url) urls;
+static struct Url **urlhash;
+static long urlhashsize;
+static long nrurls;
+static struct Url **loadhash;
+static long loadhashsize;
+static long nrloaded;
 static long lastpostnr=0;
 static long loadnr=0;
-static long dupchecklist;
 
 #define UQID_DUPCHECK   1
 
@@ -284,13 +297,115 @@ static void Buildabsurl(UBYTE *base,UBYTE *rel)
 
 /*---------------------------------------------------------------------*/
 
-/* Compute hash from name */
-static short Hash(UBYTE *name)
-{  UBYTE hash=0,*p;
+/* Compute case-insensitive hash from name. Urls that differ only in case
+ * must end up in the same bucket for Dupcheck(). */
+static ULONG Hash(UBYTE *name)
+{  ULONG hash=2166136261UL;
+   UBYTE *p;
    if(name)
-   {  for(p=name;*p;p++) hash^=*p;
+   {  for(p=name;*p;p++)
+      {  hash^=(ULONG)tolower(*p);
+         hash*=16777619UL;
+      }
+   }
+   return hash;
+}
+
+/* Bucket index for this hash. Fold the high bits in, the table is small. */
+#define BUCKET(h,size)  (((h)^((h)>>16))&((size)-1))
+
+/* Double the URL hash table. Rebuild it from the url list, oldest first,
+ * so every bucket stays newest first. */
+static BOOL Growurlhash(void)
+{  struct Url **newhash,*u;
+   long newsize,i;
+   newsize=urlhashsize?2*urlhashsize:URLHASHMIN;
+   if(!(newhash=ALLOCTYPE(struct Url *,newsize,MEMF_CLEAR))) return FALSE;
+   for(u=urls.last;u->prev;u=u->prev)
+   {  i=BUCKET(u->hash,newsize);
+      u->hashnext=newhash[i];
+      newhash[i]=u;
+   }
+   if(urlhash) FREE(urlhash);
+   urlhash=newhash;
+   urlhashsize=newsize;
+   return TRUE;
+}
+
+/* Add a new url to the list and the hash table */
+static void Addurlhash(struct Url *url)
+{  long i;
+   url->hash=Hash(url->url);
+   ADDHEAD(&urls,url);
+   nrurls++;
+   if(nrurls>urlhashsize*URLLOADFACTOR && Growurlhash()) return;
+   if(urlhash)
+   {  i=BUCKET(url->hash,urlhashsize);
+      url->hashnext=urlhash[i];
+      urlhash[i]=url;
+   }
+}
+
+/* Remove the url from the list and the hash table */
+static void Remurlhash(struct Url *url)
+{  struct Url **pu;
+   if(urlhash)
+   {  for(pu=&urlhash[BUCKET(url->hash,urlhashsize)];*pu;pu=&(*pu)->hashnext)
+      {  if(*pu==url)
+         {  *pu=url->hashnext;
+            break;
+         }
+      }
+   }
+   REMOVE(url);
+   nrurls--;
+}
+
+/* Remove the url from the load number table */
+static void Remloadhash(struct Url *url)
+{  struct Url **pu;
+   if(url->loadnr && loadhash)
+   {  for(pu=&loadhash[url->loadnr&(loadhashsize-1)];*pu;pu=&(*pu)->loadnext)
+      {  if(*pu==url)
+         {  *pu=url->loadnext;
+            nrloaded--;
+            break;
+         }
+      }
+   }
+}
+
+/* Double the load number table */
+static BOOL Growloadhash(void)
+{  struct Url **newhash,*u,*next;
+   long newsize,i;
+   newsize=loadhashsize?2*loadhashsize:URLHASHMIN;
+   if(!(newhash=ALLOCTYPE(struct Url *,newsize,MEMF_CLEAR))) return FALSE;
+   for(i=0;i<loadhashsize;i++)
+   {  for(u=loadhash[i];u;u=next)
+      {  next=u->loadnext;
+         u->loadnext=newhash[u->loadnr&(newsize-1)];
+         newhash[u->loadnr&(newsize-1)]=u;
+      }
+   }
+   if(loadhash) FREE(loadhash);
+   loadhash=newhash;
+   loadhashsize=newsize;
+   return TRUE;
+}
+
+/* Give the url a new load number */
+static void Setloadnr(struct Url *url,long nr)
+{  long i;
+   Remloadhash(url);
+   url->loadnr=nr;
+   if(nrloaded>=loadhashsize*URLLOADFACTOR) Growloadhash();
+   if(loadhash)
+   {  i=nr&(loadhashsize-1);
+      url->loadnext=loadhash[i];
+      loadhash[i]=url;
+      nrloaded++;
    }
-   return (short)(hash&HASHMASK);
 }
 
 /* Dispose object and clear pointer */
@@ -600,10 +715,12 @@ static long Loadurl(struct Url *url,struct Aumload *auml)
    {  Replacesource(url,NULL);
    }
    if(arf)
-   {  url->rfetch=Anewobject(AOTP_FETCH,
+   {  struct Caploc *loc=(struct Caploc *)Agetattr(url->cache,AOCAC_Packloc);
+      url->rfetch=Anewobject(AOTP_FETCH,
          AOFCH_Url,url,
          AOFCH_Cache,TRUE,
-         AOFCH_Name,Agetattr(url->cache,AOCAC_Name),
+         AOFCH_Name,loc?loc->seg->name:(UBYTE *)Agetattr(url->cache,AOCAC_Name),
+         AOFCH_Packloc,loc,
          AOFCH_Imagefetch,BOOLVAL(auml->flags&AUMLF_IMAGE),
          AOFCH_Windowkey,Agetattr(window,AOWIN_Key),
          TAG_END);
@@ -689,7 +806,7 @@ static long Loadurl(struct Url *url,struct Aumload *auml)
       }
    }
    if((af || avf) && !assrc)
-   {  url->loadnr=++loadnr;
+   {  Setloadnr(url,++loadnr);
    }
    if(af || arf)
    {  SETFLAG(url->flags,URLF_DEXFETCH,adsrc);
@@ -1008,12 +1125,12 @@ static void Srcupdatefetch(struct Url *url,struct Amsrcupdate *ams,BOOL cache)
    }
 }
 
-/* Check for duplicate URL in the same list. Then queue a check for the next
- * url in this list, or for the first url in the next list. */
+/* Check for older duplicates of this URL in its hash bucket. Then queue
+ * a check for the next url. */
 static void Dupcheck(struct Url *url)
 {  struct Url *u;
-   for(u=url->next;u->next;u=u->next)
-   {  if(STRIEQUAL(url->url,u->url) && url->postnr==u->postnr)
+   for(u=url->hashnext;u;u=u->hashnext)
+   {  if(u->hash==url->hash && STRIEQUAL(url->url,u->url) && url->postnr==u->postnr)
       {  Clearobject(&u->cache);
          u->movedto=url;
          u->flags&=~URLF_TEMPMOVED;
@@ -1021,19 +1138,18 @@ static void Dupcheck(struct Url *url)
       }
    }
    u=url->next;
-   if(!u->next)
-   {  for(dupchecklist++;dupchecklist<NRLISTS;dupchecklist++)
-      {  if(!ISEMPTY(&urls[dupchecklist]))
-         {  u=urls[dupchecklist].first;
-            break;
-         }
-      }
-   }
    if(u->next) Queuesetmsg(u,UQID_DUPCHECK);
 }
 
 /*---------------------------------------------------------------------*/
 
+/* Start a waiting image fetch before images that are not visible */
+static void Fetchvisible(struct Aobject *fetch)
+{  if(fetch && Agetattr(fetch,AOFCH_Priority)==FQP_OFFSCREEN)
+   {  Asetattrs(fetch,AOFCH_Priority,FQP_IMAGE,TAG_END);
+   }
+}
+
 static long Seturl(struct Url *url,struct Amset *ams)
 {  struct TagItem *tag,*tstate=ams->tags;
    while(tag=NextTagItem(&tstate))
@@ -1077,6 +1193,12 @@ static long Seturl(struct Url *url,struct Amset *ams)
             if(tag->ti_Data) url->flags|=URLF_VIEWSOURCE;
             else url->flags&=~URLF_VIEWSOURCE;
             break;
+         case AOURL_Visible:
+            if(tag->ti_Data)
+            {  Fetchvisible(url->fetch);
+               Fetchvisible(url->vfetch);
+            }
+            break;
          case AOBJ_Queueid:
             if(tag->ti_Data==UQID_DUPCHECK)
             {  Dupcheck(url);
@@ -1186,7 +1308,8 @@ static struct Url *Newurl(struct Amset *ams)
    {  NEWLIST(&url->childs);
       url->flags|=URLF_CACHEABLE;
       Seturl(url,ams);
-      ADDHEAD(&urls[Hash(url->url)],url);
+      Addurlhash(url);
+      if(!url->postnr) Cachelookup(url);
    }
    return url;
 }
@@ -1250,18 +1373,20 @@ static void Disposeurl(struct Url *url)
    Clearobject(&url->ssource);
    Clearobject(&url->dsource);
    /* Cache objects will be disposed of by cache */
+   Remurlhash(url);
+   Remloadhash(url);
    if(url->url) FREE(url->url);
    Amethodas(AOTP_OBJECT,url,AOM_DISPOSE);
 }
 
 static void Deinstall(void)
-{  short i;
-   void *p;
-   for(i=0;i<NRLISTS;i++)
-   {  if(urls[i].first)
-      {  while(p=REMHEAD(&urls[i])) Disposeurl(p);
-      }
+{  if(urls.first)
+   {  while(urls.first->next) Disposeurl(urls.first);
    }
+   if(urlhash) FREE(urlhash);
+   if(loadhash) FREE(loadhash);
+   urlhash=loadhash=NULL;
+   urlhashsize=loadhashsize=0;
 }
 
 static long Dispatch(struct Url *url,struct Amessage *amsg)
@@ -1304,10 +1429,8 @@ static long Dispatch(struct Url *url,struct Amessage *amsg)
 /*---------------------------------------------------------------------*/
 
 BOOL Installurl(void)
-{  short i;
-   for(i=0;i<NRLISTS;i++)
-   {  NEWLIST(&urls[i]);
-   }
+{  NEWLIST(&urls);
+   if(!Growurlhash() || !Growloadhash()) return FALSE;
    if(!Amethod(NULL,AOM_INSTALL,AOTP_URL,Dispatch)) return FALSE;
    return TRUE;
 }
@@ -1332,26 +1455,37 @@ BOOL Initurl(void)
 }
 
 BOOL Initurl2(void)
-{  for(dupchecklist=0;dupchecklist<NRLISTS;dupchecklist++)
-   {  if(!ISEMPTY(&urls[dupchecklist]))
-      {  Queuesetmsg(urls[dupchecklist].first,UQID_DUPCHECK);
-         break;
-      }
+{  if(!ISEMPTY(&urls))
+   {  Queuesetmsg(urls.first,UQID_DUPCHECK);
    }
    return TRUE;
 }
 
 void *Findurlloadnr(long loadnr)
 {  struct Url *url;
-   short i;
-   for(i=0;i<NRLISTS;i++)
-   {  for(url=urls[i].first;url->next;url=url->next)
+   if(loadnr && loadhash)
+   {  for(url=loadhash[loadnr&(loadhashsize-1)];url;url=url->loadnext)
       {  if(url->loadnr==loadnr) return url;
       }
    }
    return NULL;
 }
 
+void Urlstats(struct Urlstats *us)
+{  struct Url *u;
+   long i,n;
+   us->urls=nrurls;
+   us->buckets=urlhashsize;
+   us->used=0;
+   us->longest=0;
+   us->loaded=nrloaded;
+   for(i=0;i<urlhashsize;i++)
+   {  for(n=0,u=urlhash[i];u;u=u->hashnext) n++;
+      if(n) us->used++;
+      if(n>us->longest) us->longest=n;
+   }
+}
+
 UBYTE *Makeabsurl(UBYTE *base,UBYTE *url)
 {  Buildabsurl(base?base:NULLSTRING,url);
    return Dupstr(absurl,-1);
@@ -1404,10 +1538,10 @@ UBYTE *Fragmentpart(UBYTE *url)
 void *Findurl(UBYTE *base,UBYTE *url,long postnr)
 {  struct Url *u;
    UBYTE *absurl=Makeabsurl(base,url);
-   UBYTE hash=0;
+   ULONG hash;
    hash=Hash(absurl);
-   for(u=urls[hash].first;u->next;u=u->next)
-   {  if(STREQUAL(u->url,absurl) && u->postnr==postnr)
+   for(u=urlhash[BUCKET(hash,urlhashsize)];u;u=u->hashnext)
+   {  if(u->hash==hash && STREQUAL(u->url,absurl) && u->postnr==postnr)
       {  FREE(absurl);
          return u;
       }
@@ -1418,6 +1552,9 @@ void *Findurl(UBYTE *base,UBYTE *url,long postnr)
       AOURL_Url,absurl,
       AOURL_Postnr,postnr,
       TAG_END);
+   /* A new URL referenced from a document may be on a new host. Start
+    * resolving it, it will likely be fetched or followed soon. */
+   if(u && base && *base && !postnr) Prefetchname(absurl);
    FREE(absurl);
    return u;
 }
@@ -79,6 +79,10 @@
 #define AOURL_Finalurlptr  (AOURL_Dummy+17)  /* GET */
    /* (void *) Final URL object, solving all relocations (temporary and permanent). */
 
+#define AOURL_Visible      (AOURL_Dummy+18)  /* SET */
+   /* (BOOL) An object showing this URL is visible. A waiting image fetch
+    * is started before images that are not visible. */
+
 #define AOURL_    (AOURL_Dummy+)
 #define AOURL_    (AOURL_Dummy+)
 
@@ -194,6 +198,9 @@
 #define AOURL_Viewsource   (AOURL_Dummy+137)
    /* (BOOL) This URL was loaded via view-source: scheme - render as plain text */
 
+#define AOURL_Requeue      (AOURL_Dummy+138)
+   /* (BOOL) The pipelined request got no response, queue the fetch again */
+
 #define AOURL_    (AOURL_Dummy+)
 #define AOURL_    (AOURL_Dummy+)
 
@@ -249,6 +256,8 @@ struct Aumload
 #define AUMLF_MULTIPART    0x00000800  /* The postmsg message is actually a Multipartdata
                                         * header, not plain text. */
 #define AUMLF_DOCEXT       0x00001000  /* Want this as a document extension */
+#define AUMLF_STYLE        0x00002000  /* Load is a style sheet */
+#define AUMLF_SCRIPT       0x00004000  /* Load is a script */
 
 
 /* AUM_SPECIAL */
@@ -275,6 +284,17 @@ extern void *Findurl(UBYTE *base,UBYTE *url,long postnr);
 extern void *Findurlloadnr(long loadnr);
    /* Return the URL for this load number or NULL */
 
+struct Urlstats
+{  long urls;              /* Number of url objects */
+   long buckets;           /* Size of the hash table */
+   long used;              /* Buckets in use */
+   long longest;           /* Longest bucket */
+   long loaded;            /* Urls with a load number */
+};
+
+extern void Urlstats(struct Urlstats *us);
+   /* Fill in statistics about the url registry */
+
 extern UBYTE *Makeabsurl(UBYTE *base,UBYTE *url);
    /* Returns dynamic string with resulting URL */
 
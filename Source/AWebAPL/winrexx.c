@@ -485,6 +485,13 @@ static BOOL Doget(struct Arexxcmd *ac,struct Awindow *win,
       else if(STRIEQUAL(item,"VERSION"))
       {  ac->result=Dupstr(awebversion,-1);
       }
+      else if(STRIEQUAL(item,"URLSTATS"))
+      {  struct Urlstats us;
+         UBYTE sbuf[64];
+         Urlstats(&us);
+         sprintf(sbuf,"%ld %ld %ld %ld %ld",us.urls,us.buckets,us.used,us.longest,us.loaded);
+         ac->result=Dupstr(sbuf,-1);
+      }
       else if(STRIEQUAL(item,"CLIP"))
       {  UBYTE *buf;
          long len;
@@ -0,0 +1,141 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* gifdec.c - AWeb gif plugin LZW decoder */
+
+/* This file has no system dependencies, so it can be built and tested on any host. */
+
+#include <exec/types.h>
+#include <string.h>
+#include "gifdec.h"
+
+/*--------------------------------------------------------------------*/
+
+void Initgifdecoder(struct Gifdecoder *gd,int codesize)
+{  short i;
+   gd->flags=0;
+   gd->remaining=0;
+   gd->bitbuf=0;
+   gd->bits=0;
+   gd->codesize=gd->startcodesize=codesize+1;
+   gd->clearcode=1<<codesize;
+   gd->eofcode=gd->clearcode+1;
+   gd->nextcode=gd->eofcode+1;
+   gd->lastcode=-1;
+   gd->pendpos=0;
+   gd->pendlength=0;
+   for(i=0;i<gd->clearcode;i++)
+   {  gd->prefix[i]=0;
+      gd->length[i]=1;
+      gd->suffix[i]=i;
+      gd->first[i]=i;
+   }
+}
+
+long Gifdecode(struct Gifdecoder *gd,UBYTE *out,long length)
+{  UBYTE *p=out,*pend=out+length,*q;
+   short code,c,n;
+   /* First the rest of a string that didn't fit last time */
+   if(gd->pendlength)
+   {  n=gd->pendlength;
+      if(n>pend-p) n=pend-p;
+      memcpy(p,gd->string+gd->pendpos,n);
+      p+=n;
+      gd->pendpos+=n;
+      gd->pendlength-=n;
+   }
+   while(p<pend && !(gd->flags&(GIFDF_END|GIFDF_ERROR)))
+   {  /* Collect the bits for the next code */
+      while(gd->bits<gd->codesize)
+      {  if(!gd->remaining)
+         {  if(gd->next>=gd->end) return p-out;
+            if(!(gd->remaining=*gd->next++))
+            {  gd->flags|=GIFDF_END|GIFDF_TERMINATOR;
+               return p-out;
+            }
+         }
+         if(gd->next>=gd->end) return p-out;
+         gd->bitbuf|=(ULONG)*gd->next++<<gd->bits;
+         gd->bits+=8;
+         gd->remaining--;
+      }
+      code=gd->bitbuf&((1<<gd->codesize)-1);
+      gd->bitbuf>>=gd->codesize;
+      gd->bits-=gd->codesize;
+
+      if(code==gd->clearcode)
+      {  gd->nextcode=gd->eofcode+1;
+         gd->codesize=gd->startcodesize;
+         gd->lastcode=-1;
+         continue;
+      }
+      if(code==gd->eofcode)
+      {  gd->flags|=GIFDF_END;
+         break;
+      }
+      if(gd->lastcode<0)
+      {  /* First code after a clear is a single pixel */
+         if(code>gd->eofcode)
+         {  gd->flags|=GIFDF_ERROR;
+            break;
+         }
+      }
+      else if(code<gd->nextcode || (code==gd->nextcode && code<GIFD_MAXCODES))
+      {  /* Add the last string plus the first byte of this one. If this code
+          * is the one being added, its first byte is that of the last string. */
+         if(gd->nextcode<GIFD_MAXCODES)
+         {  c=gd->nextcode++;
+            gd->prefix[c]=gd->lastcode;
+            gd->suffix[c]=gd->first[(code<c)?code:gd->lastcode];
+            gd->first[c]=gd->first[gd->lastcode];
+            gd->length[c]=gd->length[gd->lastcode]+1;
+            if(gd->nextcode>=(1<<gd->codesize) && gd->codesize<12)
+            {  gd->codesize++;
+            }
+         }
+      }
+      else
+      {  gd->flags|=GIFDF_ERROR;
+         break;
+      }
+      gd->lastcode=code;
+
+      /* Write the string back to front at its final position, or in the
+       * string buffer if it doesn't fit. */
+      n=gd->length[code];
+      if(n<=pend-p)
+      {  p+=n;
+         q=p;
+      }
+      else
+      {  q=gd->string+n;
+      }
+      for(c=code;c>gd->eofcode;c=gd->prefix[c])
+      {  *--q=gd->suffix[c];
+      }
+      *--q=(UBYTE)c;
+      if(q==gd->string)
+      {  c=pend-p;
+         memcpy(p,gd->string,c);
+         p+=c;
+         gd->pendpos=c;
+         gd->pendlength=n-c;
+      }
+   }
+   return p-out;
+}
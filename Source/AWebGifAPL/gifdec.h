@@ -0,0 +1,73 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* gifdec.h - AWeb gif plugin LZW decoder */
+
+#ifndef AWEBGIF_GIFDEC_H
+#define AWEBGIF_GIFDEC_H
+
+#include <exec/types.h>
+
+#define GIFD_MAXCODES      4096
+
+/* The decoder takes the image data as it appears in the file, that is
+ * LZW codes packed in sub-blocks of up to 255 bytes, and writes pixels
+ * to the caller's buffer. Strings are written forward, using the length
+ * of each string. Input is taken from a window that the caller refills
+ * whenever the decoder runs out, so the data may be split at any byte. */
+
+struct Gifdecoder
+{  /* Input window. Set by the caller, advanced by the decoder. */
+
+   UBYTE *next;               /* Next input byte */
+   UBYTE *end;                /* End of input */
+
+   /* Decoder state */
+
+   UWORD flags;               /* See below */
+   short remaining;           /* Bytes left in current sub-block */
+   ULONG bitbuf;              /* Input bits not yet used */
+   short bits;                /* Number of bits in bitbuf */
+   short clearcode;           /* Code to clear strings */
+   short eofcode;             /* Code for end of data */
+   short startcodesize;       /* Initial nr of bits in code */
+   short codesize;            /* Current nr of bits in code */
+   short nextcode;            /* Next free code */
+   short lastcode;            /* Last code read, or -1 after a clear */
+   short pendpos;             /* Start of string not yet returned */
+   short pendlength;          /* Length of string not yet returned */
+   UWORD prefix[GIFD_MAXCODES];  /* Prefix code per code */
+   UWORD length[GIFD_MAXCODES];  /* String length per code */
+   UBYTE suffix[GIFD_MAXCODES];  /* Last byte per code */
+   UBYTE first[GIFD_MAXCODES];   /* First byte per code */
+   UBYTE string[GIFD_MAXCODES];  /* String that didn't fit in the output */
+};
+
+/* flags */
+#define GIFDF_END          0x0001   /* End code or end of data reached */
+#define GIFDF_ERROR        0x0002   /* Invalid code */
+#define GIFDF_TERMINATOR   0x0004   /* The zero length sub-block was read */
+
+/* Prepare the decoder for a new image with this LZW minimum code size */
+extern void Initgifdecoder(struct Gifdecoder *gd,int codesize);
+
+/* Decode up to (length) pixels. Returns the number of pixels written, which
+ * is less than (length) if the input window is empty or if a flag is set. */
+extern long Gifdecode(struct Gifdecoder *gd,UBYTE *out,long length);
+
+#endif
@@ -24,6 +24,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include "ezlists.h"
+#include "gifdec.h"
 #include <libraries/awebplugin.h>
 #include <libraries/Picasso96.h>
 #include <exec/memory.h>
@@ -107,23 +108,11 @@ struct Gifsource
 /* This structure holds vital data for the decoding subprocess */
 struct Decoder
 {  struct Datablock *current;       /* The current datablock */
-   long currentbyte;                /* The current byte in the current datablock */
+   UBYTE *next;                     /* Next byte to read in current datablock */
+   UBYTE *end;                      /* End of current datablock */
    struct Gifsource *source;        /* Points back to our Gifsource */
-   /* LZW decompress fields: */
-   long remaining;                  /* nr of bytes remaining in current data block */
-   short rembits;                   /* nr of bits remaining in last char */
-   UBYTE lastchar;                  /* last character partially read */
-   short clearcode;                 /* code to clear strings */
-   short eofcode;                   /* code for eof */
-   short startcodesize;             /* initial nr of bits in code */
-   short codesize;                  /* current nr of bits in code */
-   short nextcode;                  /* next free code index */
-   UBYTE outstack[4096];            /* stacked output bytes */
-   UBYTE suffix[4096];              /* last byte per code */
-   short prefix[4096];              /* prefix codes per code */
-   short outsp;                     /* stack pointer in outstack, if >0 then data is available */
-   short lastcode;                  /* last code read */
-   UBYTE lastgifbyte;               /* last decoded byte */
+   struct Gifdecoder *lzw;          /* LZW decompressor */
+   UBYTE *pixels;                   /* Row of decoded GIF pixels */
    /* Output fields: */
    struct BitMap *bitmap;           /* Bitmap to be filled */
    UBYTE *mask;                     /* Transparent mask to be built */
@@ -163,215 +152,83 @@ struct Decoder
 /* Read from the input stream                                         */
 /*--------------------------------------------------------------------*/
 
-/* Read the next byte. First check any waiting messages, if the task
- * should stop then set the DECOF_STOP flag.
- * If end of current block reached, skip to next block. If no more
- * blocks available, wait until a new block is added or eof is
- * reached. */
-static UBYTE Readbyte(struct Decoder *decoder)
+/* Process waiting messages. If the task should stop then set the DECOF_STOP flag. */
+static void Checktaskmsgs(struct Decoder *decoder)
 {  struct Taskmsg *tm;
    struct TagItem *tag,*tstate;
-   struct Datablock *db;
-   BOOL wait;
-   UBYTE retval=0;
-   static int readbyte_count=0;
-#ifdef DEBUG_PLUGINS
-   if(AwebPluginBase && (readbyte_count++ % 100 == 0))
-   {  Aprintf("GIF: Readbyte called, decoder=0x%08lx, count=%d\n", (ULONG)decoder, readbyte_count);
-   }
-#endif
-   if(!decoder)
-   {  #ifdef DEBUG_PLUGINS
-      if(AwebPluginBase)
-      {  Aprintf("GIF: Readbyte: ERROR - decoder is NULL!\n");
-      }
-      #endif
-      return 0;
-   }
-   if(!decoder->source)
-   {  #ifdef DEBUG_PLUGINS
-      if(AwebPluginBase)
-      {  Aprintf("GIF: Readbyte: ERROR - decoder->source is NULL!\n");
+   while(!(decoder->flags&DECOF_STOP) && (tm=Gettaskmsg()))
+   {  if(tm->amsg && tm->amsg->method==AOM_SET)
+      {  tstate=((struct Amset *)tm->amsg)->tags;
+         while((tag=NextTagItem(&tstate)))
+         {  switch(tag->ti_Tag)
+            {  case AOTSK_Stop:
+                  if(tag->ti_Data) decoder->flags|=DECOF_STOP;
+                  break;
+               case AOGIF_Data:
+                  /* Ignore these now */
+                  break;
+            }
+         }
       }
-      #endif
-      return 0;
+      Replytaskmsg(tm);
    }
+}
+
+/* Skip to the next block. First check any waiting messages.
+ * If no more blocks available, wait until a new block is added or eof is
+ * reached. Returns FALSE if the task should stop or at eof. */
+static BOOL Nextblock(struct Decoder *decoder)
+{  struct Datablock *db;
+   BOOL wait;
    for(;;)
-   {  wait=FALSE;
-      while(!(decoder->flags&DECOF_STOP) && (tm=Gettaskmsg()))
-      {  if(tm->amsg && tm->amsg->method==AOM_SET)
-         {  tstate=((struct Amset *)tm->amsg)->tags;
-            while((tag=NextTagItem(&tstate)))
-            {  switch(tag->ti_Tag)
-               {  case AOTSK_Stop:
-                     if(tag->ti_Data) decoder->flags|=DECOF_STOP;
-                     break;
-                  case AOGIF_Data:
-                     /* Ignore these now */
-                     break;
-               }
-            }
-         }
-         Replytaskmsg(tm);
-      }
-      /* Only continue if we shouldn't stop */
-      if(decoder->flags&DECOF_STOP) break;
-      if(decoder->current)
-      {  if(++decoder->currentbyte>=decoder->current->length)
-         {  /* End of block reached */
-            ObtainSemaphore(&decoder->source->sema);
-            db=decoder->current->next;
-            if(db && db->next)
-            {  decoder->current=db;
-               decoder->currentbyte=0;
-            }
-            else if(decoder->source->flags&GIFSF_EOF)
-            {  decoder->flags|=DECOF_EOF;
-            }
-            else
-            {  /* No more blocks; wait for next block */
-               wait=TRUE;
-            }
-            ReleaseSemaphore(&decoder->source->sema);
-         }
+   {  Checktaskmsgs(decoder);
+      if(decoder->flags&DECOF_STOP) return FALSE;
+      wait=FALSE;
+      ObtainSemaphore(&decoder->source->sema);
+      if(decoder->current) db=decoder->current->next;
+      else db=decoder->source->data.first;
+      if(db && db->next)
+      {  decoder->current=db;
+         decoder->next=db->data;
+         decoder->end=db->data+db->length;
+      }
+      else if(decoder->source->flags&GIFSF_EOF)
+      {  decoder->flags|=DECOF_EOF;
       }
       else
-      {  /* No current block yet */
-         if(!decoder->source)
-         {  #ifdef DEBUG_PLUGINS
-            if(AwebPluginBase)
-            {  Aprintf("GIF: Readbyte: ERROR - decoder->source is NULL in else branch!\n");
-            }
-            #endif
-            decoder->flags|=DECOF_EOF;
-            return 0;
-         }
-         ObtainSemaphore(&decoder->source->sema);
-         db=decoder->source->data.first;
-         if(db && db->next)
-         {  decoder->current=db;
-            decoder->currentbyte=0;
-#ifdef DEBUG_PLUGINS
-            if(AwebPluginBase && readbyte_count <= 10)
-            {  Aprintf("GIF: Readbyte: Got first block, current=0x%08lx, length=%ld\n", (ULONG)decoder->current, decoder->current ? decoder->current->length : 0);
-            }
-#endif
-         }
-         else if(decoder->source->flags&GIFSF_EOF)
-         {  #ifdef DEBUG_PLUGINS
-            if(AwebPluginBase && readbyte_count <= 10)
-            {  Aprintf("GIF: Readbyte: EOF flag set\n");
-            }
-            #endif
-            decoder->flags|=DECOF_EOF;
-         }
-         else
-         {  /* No block yet; wait for next block */
-            #ifdef DEBUG_PLUGINS
-            if(AwebPluginBase && readbyte_count <= 10)
-            {  Aprintf("GIF: Readbyte: No block yet, waiting...\n");
-            }
-            #endif
-            wait=TRUE;
-         }
-         ReleaseSemaphore(&decoder->source->sema);
-      }
-      if(!wait)
-      {  if(!(decoder->flags&DECOF_EOF))
-         {  if(!decoder->current)
-            {  #ifdef DEBUG_PLUGINS
-               if(AwebPluginBase)
-               {  Aprintf("GIF: Readbyte: ERROR - current is NULL!\n");
-               }
-               #endif
-               decoder->flags|=DECOF_EOF;
-               return 0;
-            }
-            if(!decoder->current->data)
-            {  #ifdef DEBUG_PLUGINS
-               if(AwebPluginBase)
-               {  Aprintf("GIF: Readbyte: ERROR - current->data is NULL!\n");
-               }
-               #endif
-               decoder->flags|=DECOF_EOF;
-               return 0;
-            }
-            if(decoder->currentbyte >= decoder->current->length)
-            {  #ifdef DEBUG_PLUGINS
-               if(AwebPluginBase)
-               {  Aprintf("GIF: Readbyte: ERROR - currentbyte %ld >= length %ld!\n", decoder->currentbyte, decoder->current->length);
-               }
-               #endif
-               decoder->flags|=DECOF_EOF;
-               return 0;
-            }
-            if(decoder->currentbyte < 0)
-            {  #ifdef DEBUG_PLUGINS
-               if(AwebPluginBase)
-               {  Aprintf("GIF: Readbyte: ERROR - currentbyte %ld < 0!\n", decoder->currentbyte);
-               }
-               #endif
-               decoder->flags|=DECOF_EOF;
-               return 0;
-            }
-            retval=decoder->current->data[decoder->currentbyte];
-#ifdef DEBUG_PLUGINS
-            if(AwebPluginBase && readbyte_count <= 10)
-            {  Aprintf("GIF: Readbyte: Returning byte %d at offset %ld\n", retval, decoder->currentbyte);
-            }
-#endif
-         }
-         else
-         {  #ifdef DEBUG_PLUGINS
-            if(AwebPluginBase && readbyte_count <= 10)
-            {  Aprintf("GIF: Readbyte: EOF flag set, returning 0\n");
-            }
-            #endif
-         }
-         break;
-      }
-#ifdef DEBUG_PLUGINS
-      if(AwebPluginBase && readbyte_count <= 10)
-      {  Aprintf("GIF: Readbyte: Waiting for data...\n");
+      {  /* No more blocks; wait for next block */
+         wait=TRUE;
       }
-#endif
-      Waittask(0);
+      ReleaseSemaphore(&decoder->source->sema);
+      if(decoder->flags&DECOF_EOF) return FALSE;
+      if(!wait && decoder->next<decoder->end) return TRUE;
+      if(wait) Waittask(0);
    }
-#ifdef DEBUG_PLUGINS
-   if(AwebPluginBase && readbyte_count <= 10)
-   {  Aprintf("GIF: Readbyte: Exiting, returning %d\n", retval);
-   }
-#endif
-   return retval;
+}
+
+/* Read the next byte. If the current block is exhausted, skip to the
+ * next one. At eof or if the task should stop, 0 is returned and the
+ * DECOF_EOF or DECOF_STOP flag is set. */
+static UBYTE Readbyte(struct Decoder *decoder)
+{  if(decoder->next>=decoder->end && !Nextblock(decoder)) return 0;
+   return *decoder->next++;
 }
 
 /* Read or skip a number of bytes. Returns TRUE if ok, FALSE of EOF reached before
  * end of block, or task should stop. If block is passed as NULL, data is skipped. */
 static BOOL Readblock(struct Decoder *decoder,UBYTE *block,long length)
-{  UBYTE c;
-#ifdef DEBUG_PLUGINS
-   if(AwebPluginBase && length > 0)
-   {  Aprintf("GIF: Readblock called, decoder=0x%08lx, length=%ld, block=0x%08lx\n", (ULONG)decoder, length, (ULONG)block);
-   }
-#endif
-   while(length && !(decoder->flags&(DECOF_STOP|DECOF_EOF)))
-   {  c=Readbyte(decoder);
-      if(decoder->flags&(DECOF_STOP|DECOF_EOF))
-      {  #ifdef DEBUG_PLUGINS
-         if(AwebPluginBase)
-         {  Aprintf("GIF: Readblock: EOF or STOP flag set, returning FALSE\n");
-         }
-         #endif
-         return FALSE;
-      }
-      if(block) *block++=c;
-      length--;
+{  long n;
+   while(length)
+   {  if(decoder->next>=decoder->end && !Nextblock(decoder)) return FALSE;
+      n=decoder->end-decoder->next;
+      if(n>length) n=length;
+      if(block)
+      {  memcpy(block,decoder->next,n);
+         block+=n;
+      }
+      decoder->next+=n;
+      length-=n;
    }
-#ifdef DEBUG_PLUGINS
-   if(AwebPluginBase && length == 0)
-   {  Aprintf("GIF: Readblock: Done, read all %ld bytes\n", length);
-   }
-#endif
    return (BOOL)!(decoder->flags&(DECOF_STOP|DECOF_EOF));
 }
 
@@ -379,109 +236,29 @@ static BOOL Readblock(struct Decoder *decoder,UBYTE *block,long length)
 /* Read from the GIF file, decompress                                 */
 /*--------------------------------------------------------------------*/
 
-/* Read a byte from the GIF data block */
-static UBYTE Readchar(struct Decoder *d)
-{  UBYTE c;
-   if(d->remaining==0)
-   {  d->remaining=Readbyte(d);
-      if(d->remaining==0)
-      {  d->flags|=DECOF_EOF;
-      }
-   }
-   c=Readbyte(d);
-   d->remaining--;
-   return c;
-}
-
-/* Read a code from the compressed input stream */
-static int Getcode(struct Decoder *d)
-{  int code;
-   if(d->rembits==0)
-   {  d->lastchar=Readchar(d);
-      d->rembits=8;
-   }
-   code=d->lastchar>>(8-d->rembits);
-   while(d->rembits<d->codesize)
-   {  d->lastchar=Readchar(d);
-      code|=d->lastchar<<d->rembits;
-      d->rembits+=8;
-   }
-   d->rembits-=d->codesize;
-   code&=(1<<d->codesize)-1;
-   return code;
-}
-
-/* Get an uncompressed byte from the input stream */
-static UBYTE Getgifbyte(struct Decoder *d)
-{  int code,curcode;
-
-   if(d->outsp > 0)
-   {  return d->outstack[--d->outsp];
-   }
-
-   code=Getcode(d);
-   if(d->flags&DECOF_EOF) return 0;
-
-   if(code==d->eofcode)
-   {  d->flags|=DECOF_EOF;
-      return 0;
-   }
-
-   if(code==d->clearcode)
-   {  while(code==d->clearcode)
-      {  d->nextcode=d->eofcode+1;
-         d->codesize=d->startcodesize;
-         code=Getcode(d);
-         if(d->flags&DECOF_EOF) return 0;
+/* Decode a row of pixels. The LZW decoder works directly on the data
+ * blocks, the next block is only fetched when it runs out of input. */
+static BOOL Readpixels(struct Decoder *decoder,UBYTE *row,long width)
+{  struct Gifdecoder *gd=decoder->lzw;
+   long n;
+   for(;;)
+   {  gd->next=decoder->next;
+      gd->end=decoder->end;
+      n=Gifdecode(gd,row,width);
+      decoder->next=gd->next;
+      row+=n;
+      width-=n;
+      if(!width) return TRUE;
+      if(gd->flags&GIFDF_ERROR)
+      {  decoder->flags|=DECOF_STOP;
+         return FALSE;
       }
-      d->lastcode=code;
-      d->lastgifbyte=code;
-      return (UBYTE)code;
-   }
-
-   if(code>d->nextcode)
-   {  d->flags|=DECOF_STOP;
-      return 0;
-   }
-   if(code==d->nextcode)
-   {  curcode=d->lastcode;
-      /* olsen: paranoia; don't let the buffer overflow. */
-      if(d->outsp < sizeof(d->outstack))
-         d->outstack[d->outsp++]=d->lastgifbyte;
-   }
-   else
-   {  curcode=code;
-   }
-
-   /* olsen: paranoia; keep the index in bounds. */
-   while(curcode>d->eofcode && curcode < sizeof(d->suffix))
-   {
-      /* olsen: paranoia; don't let the buffer overflow. */
-      if(d->outsp < sizeof(d->outstack))
-         d->outstack[d->outsp++]=d->suffix[curcode];
-      curcode=d->prefix[curcode];
-   }
-   d->lastgifbyte=curcode;
-   if(d->nextcode<4096)
-   {  d->prefix[d->nextcode]=d->lastcode;
-      d->suffix[d->nextcode]=d->lastgifbyte;
-      d->nextcode++;
-      if(d->nextcode>=(1<<d->codesize) && d->codesize<12)
-      {  d->codesize++;
+      if(gd->flags&GIFDF_END)
+      {  decoder->flags|=DECOF_EOF;
+         return FALSE;
       }
+      if(!Nextblock(decoder)) return FALSE;
    }
-   d->lastcode=code;
-   return d->lastgifbyte;
-}
-
-static void Setcodesize(struct Decoder *d,int codesize)
-{  d->codesize=d->startcodesize=codesize+1;
-   d->clearcode=1<<codesize;
-   d->eofcode=d->clearcode+1;
-   d->nextcode=d->eofcode+1;
-   d->rembits=0;
-   d->outsp=0;
-   d->remaining=0;  /* Initialize remaining bytes counter */
 }
 
 /*--------------------------------------------------------------------*/
@@ -775,12 +552,12 @@ static BOOL Buildgifimage(struct Decoder *decoder)
          {  memset(decoder->chunky,0,decoder->iwidth);
          }
       }
+      Checktaskmsgs(decoder);
+      if(decoder->flags&DECOF_STOP) return FALSE;
+      if(!Readpixels(decoder,decoder->pixels,decoder->iwidth)) return FALSE;
       for(x=0;x<decoder->iwidth;x++)
       {  col=x+decoder->ileft;
-         pen=Getgifbyte(decoder);
-         if(decoder->flags&(DECOF_STOP|DECOF_EOF))
-         {  return FALSE;
-         }
+         pen=decoder->pixels[x];
 /* Always store the colour, in case a subsequent image isn't transparent
  * any more but requests this bitmap as its base.
  * But don't store the colour if (mergemask), because the previous colour
@@ -1019,7 +796,7 @@ static BOOL Parsegifimage(struct Decoder *decoder)
    {  Aprintf("GIF: Parsegifimage: Setting code size to %d\n", c);
    }
 #endif
-   Setcodesize(decoder,c);
+   Initgifdecoder(decoder->lzw,c);
 
    /* Hereafter comes the image data. First allocate a bitmap.
     * Always allocate a bitmap of depth >=8. Even if our source has less
@@ -1172,11 +949,11 @@ static BOOL Parsegifimage(struct Decoder *decoder)
    }
 
    /* Skip remaining characters of data block, and following spurious blocks */
-   if(decoder->remaining)
-   {  if(!Readblock(decoder,NULL,decoder->remaining)) return FALSE;
-      decoder->remaining=0;
+   if(decoder->lzw->remaining)
+   {  if(!Readblock(decoder,NULL,decoder->lzw->remaining)) return FALSE;
+      decoder->lzw->remaining=0;
    }
-   if(!Skipgifdata(decoder))
+   if(!(decoder->lzw->flags&GIFDF_TERMINATOR) && !Skipgifdata(decoder))
    {  #ifdef DEBUG_PLUGINS
       if(AwebPluginBase)
       {  Aprintf("GIF: Parsegifimage: Skipgifdata failed\n");
@@ -1237,6 +1014,11 @@ static __saveds __asm void Decodetask(register __a0 struct Gifsource *is)
       #endif
       goto err;
    }
+   /* The LZW tables are too large for our stack */
+   if(!(decoder->lzw=(struct Gifdecoder *)AllocVec(sizeof(struct Gifdecoder),MEMF_PUBLIC))
+   || !(decoder->pixels=(UBYTE *)AllocVec(decoder->width,MEMF_PUBLIC)))
+   {  goto err;
+   }
    while(!(decoder->flags&DECOF_EOF))
    {  #ifdef DEBUG_PLUGINS
       if(AwebPluginBase)
@@ -1263,6 +1045,8 @@ static __saveds __asm void Decodetask(register __a0 struct Gifsource *is)
 #endif
    Updatetaskattrs(AOGIF_Decodeready,TRUE,TAG_END);
    if(decoder->saverp.BitMap) FreeBitMap(decoder->saverp.BitMap);
+   if(decoder->lzw) FreeVec(decoder->lzw);
+   if(decoder->pixels) FreeVec(decoder->pixels);
 #ifdef DEBUG_PLUGINS
    if(AwebPluginBase)
    {  Aprintf("GIF: Decodetask: Done, exiting\n");
@@ -1279,6 +1063,8 @@ err:
    Updatetaskattrs(AOGIF_Error,TRUE,TAG_END);
    if(decoder->saverp.BitMap) FreeBitMap(decoder->saverp.BitMap);
    if(decoder->savemask) FreeVec(decoder->savemask);
+   if(decoder->lzw) FreeVec(decoder->lzw);
+   if(decoder->pixels) FreeVec(decoder->pixels);
 #ifdef DEBUG_PLUGINS
    if(AwebPluginBase)
    {  Aprintf("GIF: Decodetask: ERROR path done, exiting\n");
@@ -78,6 +78,9 @@ void Tcpmessage(struct Fetchdriver *fd, long msgtype, ...);
 void Tcperror(struct Fetchdriver *fd, long errtype, ...);
 void Updatetaskattrs(ULONG tag, ...);
 void UpdatetaskattrsA(struct TagItem *tags);
+void Httpconnstats(ULONG *opened, ULONG *reused);
+
+extern struct Library *SocketBase;
 
 
 
@@ -137,6 +140,10 @@ void InitTestFetchDriver(struct TestFetchDriver *tfd, UBYTE *url, BOOL ssl)
     tfd->fd.flags |= FDVF_NOCACHE; /* Don't use cache for testing */
 }
 
+/* Benchmark mode: count data bytes instead of printing every tag */
+static BOOL bench_quiet = FALSE;
+static long bench_bytes = 0;
+
 /* Simplified task attribute update function for testing */
 void Updatetaskattrs(ULONG tag, ...)
 {
@@ -154,6 +161,13 @@ void UpdatetaskattrsA(struct TagItem *tags)
 {
     struct TagItem *tag;
     
+    if (bench_quiet) {
+        for (tag = tags; tag->ti_Tag != TAG_END; tag++) {
+            if (tag->ti_Tag == AOURL_Datalength) bench_bytes += (long)tag->ti_Data;
+            else if (tag->ti_Tag == AOURL_Error) printf("ERROR occurred!\n");
+        }
+        return;
+    }
     for (tag = tags; tag->ti_Tag != TAG_END; tag++) {
         switch (tag->ti_Tag) {
             case AOURL_Status:
@@ -346,12 +360,240 @@ void TestURL(struct TestURL *test_url)
     printf("\n");
 }
 
+/* Fetch a URL repeatedly and report the receive throughput.
+ * Run against a local server to measure the cost of the receive path itself. */
+void BenchURL(UBYTE *url, long count)
+{
+    struct TestFetchDriver tfd;
+    struct DateStamp start, stop;
+    long i, ticks;
+    ULONG hits, misses;
+    ULONG opened, reused, oldopened, oldreused;
+    BOOL olddebug = httpdebug;
+    
+    printf("Benchmark: %ld fetches of %s\n", count, url);
+    Httpconnstats(&oldopened, &oldreused);
+    httpdebug = FALSE;
+    bench_quiet = TRUE;
+    bench_bytes = 0;
+    DateStamp(&start);
+    for (i = 0; i < count; i++) {
+        InitTestFetchDriver(&tfd, url, (strncmp(url, "https://", 8) == 0));
+        Httptask(&tfd.fd);
+    }
+    DateStamp(&stop);
+    bench_quiet = FALSE;
+    httpdebug = olddebug;
+    ticks = ((stop.ds_Days - start.ds_Days) * 24 * 60 + (stop.ds_Minute - start.ds_Minute)) * 60 * TICKS_PER_SECOND
+        + (stop.ds_Tick - start.ds_Tick);
+    if (ticks <= 0) ticks = 1;
+    printf("Received %ld bytes in %ld.%02ld s (%ld bytes/s)\n",
+           bench_bytes, ticks / TICKS_PER_SECOND, (ticks % TICKS_PER_SECOND) * 2,
+           (long)((double)bench_bytes * TICKS_PER_SECOND / ticks));
+    printf("%ld ms per fetch\n", ticks * 1000 / TICKS_PER_SECOND / count);
+    Httpconnstats(&opened, &reused);
+    printf("Connections: %lu opened, %lu reused\n", opened - oldopened, reused - oldreused);
+    if (strncmp(url, "https://", 8) == 0) {
+        Assl_sessionstats(&hits, &misses);
+        printf("TLS handshakes: %lu resumed, %lu full\n", hits, misses);
+    }
+}
+
+/* Loopback test server. It serves HTTP/1.1 with keep-alive and counts the
+ * connections and requests, so connection reuse can be checked and timed
+ * without a network: run "AWebGet -s 8080" in one shell, and
+ * "AWebGet -u http://127.0.0.1:8080/ -b 60" in another to fetch a page
+ * with 60 parts. Connections are served one at a time. */
+
+#define SERVE_BODYSIZE      4096    /* Size of the default body */
+#define SERVE_TIMEOUT       5       /* Idle seconds before a connection is closed */
+#define SERVE_MAXREQUESTS   100     /* Requests per connection */
+
+static long serve_connections = 0;
+static long serve_requests = 0;
+
+/* Send all of (length) bytes */
+static BOOL SendAll(long sock, UBYTE *data, long length)
+{
+    long n;
+    
+    while (length > 0) {
+        n = send(sock, data, length, 0);
+        if (n <= 0) return FALSE;
+        data += n;
+        length -= n;
+    }
+    return TRUE;
+}
+
+/* Find a header line in the request, case insensitive */
+static UBYTE *FindHeader(UBYTE *request, UBYTE *name)
+{
+    UBYTE *p = request;
+    long len = strlen(name);
+    
+    while ((p = strstr(p, "\r\n")) != NULL) {
+        p += 2;
+        if (Strnicmp(p, name, len) == 0) return p + len;
+    }
+    return NULL;
+}
+
+/* Answer one request. Paths:
+ *   /           4K body with Content-Length, 304 if If-None-Match is sent
+ *   /empty      Content-Length: 0
+ *   /nocontent  204 without body
+ *   /chunked    4K body in chunks
+ *   /redirect   302 to / with a short body
+ *   /close      4K body, then the connection is closed
+ * Returns FALSE if the connection must be closed. */
+static BOOL ServeRequest(long sock, UBYTE *request, long number)
+{
+    static UBYTE body[SERVE_BODYSIZE];
+    UBYTE head[512], path[128], method[16], alive[96], *connection;
+    BOOL keepalive;
+    long n, half = SERVE_BODYSIZE / 2;
+    
+    memset(body, 'x', sizeof(body));
+    *method = *path = '\0';
+    sscanf(request, "%15s %127s", method, path);
+    keepalive = (strstr(request, " HTTP/1.1\r\n") != NULL);
+    if ((connection = FindHeader(request, "Connection:")) != NULL) {
+        while (*connection == ' ') connection++;
+        if (Strnicmp(connection, "close", 5) == 0) keepalive = FALSE;
+    }
+    if (strcmp(path, "/close") == 0 || number >= SERVE_MAXREQUESTS) keepalive = FALSE;
+    if (strcmp(method, "GET") != 0) {
+        sprintf(head, "HTTP/1.1 501 Not Implemented\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        SendAll(sock, head, strlen(head));
+        return FALSE;
+    }
+    if (keepalive) {
+        connection = alive;
+        sprintf(connection, "Connection: keep-alive\r\nKeep-Alive: timeout=%d, max=%ld\r\n",
+                SERVE_TIMEOUT, SERVE_MAXREQUESTS - number);
+    } else {
+        connection = "Connection: close\r\n";
+    }
+    
+    if (strcmp(path, "/nocontent") == 0) {
+        n = sprintf(head, "HTTP/1.1 204 No Content\r\n%s\r\n", connection);
+        return SendAll(sock, head, n) && keepalive;
+    }
+    if (strcmp(path, "/empty") == 0) {
+        n = sprintf(head, "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: 0\r\n%s\r\n",
+                    connection);
+        return SendAll(sock, head, n) && keepalive;
+    }
+    if (strcmp(path, "/redirect") == 0) {
+        n = sprintf(head, "HTTP/1.1 302 Found\r\nLocation: /\r\nContent-Type: text/plain\r\n"
+                    "Content-Length: 6\r\n%s\r\nMoved\n", connection);
+        return SendAll(sock, head, n) && keepalive;
+    }
+    if (strcmp(path, "/chunked") == 0) {
+        n = sprintf(head, "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nTransfer-Encoding: chunked\r\n"
+                    "%s\r\n%lx\r\n", connection, half);
+        if (!SendAll(sock, head, n) || !SendAll(sock, body, half)) return FALSE;
+        n = sprintf(head, "\r\n%lx\r\n", SERVE_BODYSIZE - half);
+        if (!SendAll(sock, head, n) || !SendAll(sock, body, SERVE_BODYSIZE - half)) return FALSE;
+        return SendAll(sock, "\r\n0\r\n\r\n", 7) && keepalive;
+    }
+    if (FindHeader(request, "If-None-Match:")) {
+        n = sprintf(head, "HTTP/1.1 304 Not Modified\r\nETag: \"awg\"\r\n%s\r\n", connection);
+        return SendAll(sock, head, n) && keepalive;
+    }
+    n = sprintf(head, "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: %d\r\n"
+                "ETag: \"awg\"\r\n%s\r\n", SERVE_BODYSIZE, connection);
+    return SendAll(sock, head, n) && SendAll(sock, body, SERVE_BODYSIZE) && keepalive;
+}
+
+/* Serve the requests on one connection, including pipelined ones.
+ * Returns the number of requests. */
+static long ServeConnection(long sock)
+{
+    UBYTE buf[4096 + 1], *end;
+    long length = 0, n, requests = 0;
+    fd_set fds;
+    struct timeval tv;
+    
+    buf[0] = '\0';
+    for (;;) {
+        while ((end = strstr(buf, "\r\n\r\n")) != NULL && length > 0) {
+            end += 4;
+            requests++;
+            serve_requests++;
+            if (!ServeRequest(sock, buf, requests)) return requests;
+            n = end - buf;
+            memmove(buf, end, length - n + 1);
+            length -= n;
+        }
+        if (length >= sizeof(buf) - 1) return requests;  /* Request too long */
+        FD_ZERO(&fds);
+        FD_SET(sock, &fds);
+        tv.tv_sec = SERVE_TIMEOUT;
+        tv.tv_usec = 0;
+        if (WaitSelect(sock + 1, &fds, NULL, NULL, &tv, NULL) <= 0) return requests;
+        n = recv(sock, buf + length, sizeof(buf) - 1 - length, 0);
+        if (n <= 0) return requests;
+        length += n;
+        buf[length] = '\0';
+    }
+}
+
+void Serve(long port)
+{
+    struct sockaddr_in addr;
+    long lsock, sock, n, one = 1;
+    fd_set fds;
+    struct timeval tv;
+    
+    if (!(SocketBase = OpenLibrary("bsdsocket.library", 4))) {
+        printf("ERROR: No TCP stack available\n");
+        return;
+    }
+    if ((lsock = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+        printf("ERROR: Can't create socket\n");
+        CloseLibrary(SocketBase);
+        SocketBase = NULL;
+        return;
+    }
+    setsockopt(lsock, SOL_SOCKET, SO_REUSEADDR, (char *)&one, sizeof(one));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(lsock, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(lsock, 5) < 0) {
+        printf("ERROR: Can't listen on port %ld\n", port);
+    } else {
+        printf("Serving on 127.0.0.1:%ld, press Ctrl-C to stop\n", port);
+        while (!(SetSignal(0, 0) & SIGBREAKF_CTRL_C)) {
+            FD_ZERO(&fds);
+            FD_SET(lsock, &fds);
+            tv.tv_sec = 1;
+            tv.tv_usec = 0;
+            if (WaitSelect(lsock + 1, &fds, NULL, NULL, &tv, NULL) <= 0) continue;
+            if ((sock = accept(lsock, NULL, NULL)) < 0) continue;
+            serve_connections++;
+            n = ServeConnection(sock);
+            CloseSocket(sock);
+            printf("Connection %ld: %ld requests\n", serve_connections, n);
+        }
+        SetSignal(0, SIGBREAKF_CTRL_C);
+        printf("%ld requests on %ld connections\n", serve_requests, serve_connections);
+    }
+    CloseSocket(lsock);
+    CloseLibrary(SocketBase);
+    SocketBase = NULL;
+}
+
 /* Main function */
 int main(int argc, char *argv[])
 {
     int i;
     UBYTE *test_url = NULL;
     BOOL test_specific = FALSE;
+    long bench_count = 0;
+    long serve_port = 0;
     
     printf("AWebGet - AWeb Network Test Tool\n");
     printf("================================\n\n");
@@ -379,10 +621,22 @@ int main(int argc, char *argv[])
                 test_specific = TRUE;
                 i++; /* Skip next argument */
             }
+        } else if (strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--bench") == 0) {
+            if (i + 1 < argc) {
+                bench_count = atol(argv[i + 1]);
+                i++; /* Skip next argument */
+            }
+        } else if (strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--serve") == 0) {
+            if (i + 1 < argc) {
+                serve_port = atol(argv[i + 1]);
+                i++; /* Skip next argument */
+            }
         } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
             printf("Usage: AWebGet [options]\n");
             printf("Options:\n");
             printf("  -u, --url <url>    Test specific URL\n");
+            printf("  -b, --bench <n>    Fetch the URL n times and report throughput\n");
+            printf("  -s, --serve <port> Run a test server on 127.0.0.1 and count connections\n");
             printf("  -h, --help         Show this help\n");
             printf("\n");
             printf("If no URL is specified, runs built-in test suite.\n");
@@ -390,7 +644,11 @@ int main(int argc, char *argv[])
         }
     }
     
-    if (test_specific && test_url) {
+    if (serve_port > 0) {
+        Serve(serve_port);
+    } else if (test_specific && test_url && bench_count > 0) {
+        BenchURL(test_url, bench_count);
+    } else if (test_specific && test_url) {
         /* Test specific URL */
         struct TestURL single_test = {
             test_url,
@@ -0,0 +1,559 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb-II distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* CSSIndexTest.c - Test and benchmark for the CSS rule index */
+
+#include <exec/types.h>
+#include <exec/memory.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#include "cssindex.c"
+
+static long errors;
+
+#define CHECK(c) do { if (!(c)) { printf("line %d: %s\n", __LINE__, #c); errors++; } } while (0)
+
+/* As in memory.c, memory is cleared */
+void *Allocmem(long size, ULONG flags)
+{
+    return calloc(1, size);
+}
+
+void Freemem(void *mem)
+{
+    free(mem);
+}
+
+/*--------------------------------------------------------------------*/
+/* Style sheets                                                       */
+/*--------------------------------------------------------------------*/
+
+static void Newlist(struct MinList *list)
+{
+    list->mlh_Head = (struct MinNode *)&list->mlh_Tail;
+    list->mlh_Tail = NULL;
+    list->mlh_TailPred = (struct MinNode *)&list->mlh_Head;
+}
+
+static void Addtail(struct MinList *list, struct MinNode *node)
+{
+    node->mln_Succ = (struct MinNode *)&list->mlh_Tail;
+    node->mln_Pred = list->mlh_TailPred;
+    list->mlh_TailPred->mln_Succ = node;
+    list->mlh_TailPred = node;
+}
+
+static UBYTE *Dupstr(char *s, long len)
+{
+    UBYTE *d = malloc(len + 1);
+    memcpy(d, s, len);
+    d[len] = '\0';
+    return d;
+}
+
+/* Append a word to a space-separated list */
+static UBYTE *Addword(UBYTE *list, char *s, long len)
+{
+    long n = list ? strlen((char *)list) : 0;
+    UBYTE *d = malloc(n + len + 2);
+    if (list) {
+        memcpy(d, list, n);
+        d[n++] = ' ';
+        free(list);
+    }
+    memcpy(d + n, s, len);
+    d[n + len] = '\0';
+    return d;
+}
+
+/* Parse one compound selector like ParseSelector() does: a tag name or
+ * '*', then classes, an id, pseudo-classes and attributes */
+static struct CSSSelector *Parsecompound(char **pp)
+{
+    struct CSSSelector *sel = calloc(1, sizeof(*sel));
+    char *p = *pp, *s;
+    if (*p == '*') p++;
+    else if (isalpha(*p)) {
+        for (s = p; isalnum(*p); p++);
+        sel->name = Dupstr(s, p - s);
+        sel->type |= CSS_SEL_ELEMENT;
+    }
+    while (*p && *p != ' ' && *p != ',') {
+        char c = *p++;
+        if (c == '[') {
+            for (s = p; *p && *p != ']'; p++);
+            sel->attr = calloc(1, sizeof(*sel->attr));
+            sel->attr->name = Dupstr(s, p - s);
+            sel->type |= CSS_SEL_ATTRIBUTE;
+            if (*p) p++;
+            continue;
+        }
+        for (s = p; isalnum(*p) || *p == '-'; p++);
+        if (c == '.') {
+            sel->class = Addword(sel->class, s, p - s);
+            sel->type |= CSS_SEL_CLASS;
+        } else if (c == '#') {
+            sel->id = Dupstr(s, p - s);
+            sel->type |= CSS_SEL_ID;
+        } else if (c == ':' && p - s == 4 && !strncmp(s, "root", 4)) {
+            sel->type |= CSS_SEL_ROOT;
+        } else if (c == ':') {
+            sel->pseudo = Dupstr(s, p - s);
+            sel->type |= CSS_SEL_PSEUDO;
+        }
+    }
+    *pp = p;
+    return sel;
+}
+
+/* Add a rule with one or more comma-separated selectors. Only the
+ * rightmost compound of a selector is in the rule's list, the others
+ * hang off it as parents. */
+static struct CSSRule *Addrule(struct CSSStylesheet *sheet, char *text)
+{
+    struct CSSRule *rule = calloc(1, sizeof(*rule));
+    struct CSSSelector *sel, *parent;
+    char *p = text;
+    Newlist(&rule->selectors);
+    Newlist(&rule->properties);
+    while (*p) {
+        parent = NULL;
+        for (;;) {
+            while (*p == ' ') p++;
+            sel = Parsecompound(&p);
+            if (parent) {
+                sel->parent = parent;
+                sel->combinator = CSS_COMB_DESCENDANT;
+            }
+            parent = sel;
+            while (*p == ' ') p++;
+            if (!*p || *p == ',') break;
+        }
+        Addtail(&rule->selectors, &sel->node);
+        if (*p == ',') p++;
+    }
+    Addtail(&sheet->rules, &rule->node);
+    return rule;
+}
+
+static void Freeselector(struct CSSSelector *sel)
+{
+    if (sel->parent) Freeselector(sel->parent);
+    free(sel->name);
+    free(sel->class);
+    free(sel->id);
+    free(sel->pseudo);
+    if (sel->attr) {
+        free(sel->attr->name);
+        free(sel->attr);
+    }
+    free(sel);
+}
+
+static void Freesheet(struct CSSStylesheet *sheet)
+{
+    struct CSSRule *rule, *nextrule;
+    struct CSSSelector *sel, *nextsel;
+    for (rule = (struct CSSRule *)sheet->rules.mlh_Head; rule->node.mln_Succ; rule = nextrule) {
+        nextrule = (struct CSSRule *)rule->node.mln_Succ;
+        for (sel = (struct CSSSelector *)rule->selectors.mlh_Head; sel->node.mln_Succ; sel = nextsel) {
+            nextsel = (struct CSSSelector *)sel->node.mln_Succ;
+            Freeselector(sel);
+        }
+        free(rule);
+    }
+    FreeCSSIndex(sheet);
+    Newlist(&sheet->rules);
+    sheet->nrules = 0;
+    sheet->nextorder = 0;
+}
+
+/*--------------------------------------------------------------------*/
+/* Matching                                                           */
+/*--------------------------------------------------------------------*/
+
+/* An element, or with no tag name the document root or body */
+struct Testelt {
+    char *tag;
+    char *class;
+    char *id;
+};
+
+static BOOL Sameword(UBYTE *a, long alen, UBYTE *b, long blen)
+{
+    long i;
+    if (alen != blen) return FALSE;
+    for (i = 0; i < alen; i++) {
+        if (tolower(a[i]) != tolower(b[i])) return FALSE;
+    }
+    return TRUE;
+}
+
+static BOOL Samename(UBYTE *a, UBYTE *b)
+{
+    return (BOOL)(a && b && Sameword(a, strlen((char *)a), b, strlen((char *)b)));
+}
+
+/* Does the element have all classes of (classes)? */
+static BOOL Hasclasses(char *elclass, UBYTE *classes)
+{
+    UBYTE *p, *q, *word, *elword;
+    long len, ellen;
+    for (p = classes; (len = FirstCSSWord(p, &word)) > 0; p = word + len) {
+        if (!elclass) return FALSE;
+        for (q = (UBYTE *)elclass; (ellen = FirstCSSWord(q, &elword)) > 0; q = elword + ellen) {
+            if (Sameword(word, len, elword, ellen)) break;
+        }
+        if (ellen <= 0) return FALSE;
+    }
+    return TRUE;
+}
+
+/* Match the rightmost compound of a selector like MatchSelectorComponent()
+ * and MatchSelectorComponentBody() do. Ancestors are not looked at: they
+ * don't decide which index bucket a selector is in. Nothing is hovered. */
+static BOOL Matchcompound(struct CSSSelector *sel, struct Testelt *e)
+{
+    UBYTE *tag = (UBYTE *)e->tag;
+    if (sel->type & CSS_SEL_ROOT) return Samename(tag, (UBYTE *)"html");
+    if ((sel->type & CSS_SEL_ELEMENT) && sel->name) {
+        if (Samename(sel->name, (UBYTE *)"html") || Samename(sel->name, (UBYTE *)"body")) {
+            if (tag && !Samename(sel->name, tag)) return FALSE;
+        } else if (!Samename(sel->name, tag)) return FALSE;
+    }
+    if ((sel->type & CSS_SEL_CLASS) && sel->class && !Hasclasses(e->class, sel->class)) return FALSE;
+    if ((sel->type & CSS_SEL_ID) && sel->id && !Samename(sel->id, (UBYTE *)e->id)) return FALSE;
+    if ((sel->type & CSS_SEL_ATTRIBUTE) && sel->attr) {
+        if (Samename(sel->attr->name, (UBYTE *)"class")) {
+            if (!e->class) return FALSE;
+        } else if (Samename(sel->attr->name, (UBYTE *)"id")) {
+            if (!e->id) return FALSE;
+        } else return FALSE;
+    }
+    if (sel->type & CSS_SEL_PSEUDO) return FALSE;
+    return TRUE;
+}
+
+/* Matching selectors by walking all rules, as before the index */
+static long Fullwalk(struct CSSStylesheet *sheet, struct Testelt *e, struct CSSSelector **found)
+{
+    struct CSSRule *rule;
+    struct CSSSelector *sel;
+    long n = 0;
+    for (rule = (struct CSSRule *)sheet->rules.mlh_Head; rule->node.mln_Succ;
+        rule = (struct CSSRule *)rule->node.mln_Succ) {
+        for (sel = (struct CSSSelector *)rule->selectors.mlh_Head; sel->node.mln_Succ;
+            sel = (struct CSSSelector *)sel->node.mln_Succ) {
+            if (Matchcompound(sel, e)) found[n++] = sel;
+        }
+    }
+    return n;
+}
+
+/* Matching selectors from the candidates in the index */
+static long Indexed(struct CSSStylesheet *sheet, struct Testelt *e, struct CSSSelector **found)
+{
+    struct CSSCandidates cand;
+    long n = 0, i;
+    FindCSSCandidates(sheet, (UBYTE *)e->tag, (UBYTE *)e->class, (UBYTE *)e->id, &cand);
+    for (i = 0; i < cand.count; i++) {
+        if (Matchcompound(cand.entries[i]->sel, e)) found[n++] = cand.entries[i]->sel;
+    }
+    FreeCSSCandidates(&cand);
+    return n;
+}
+
+/* Do the full walk and the index find the same selectors in the same order? */
+static BOOL Samematches(struct CSSStylesheet *sheet, struct Testelt *e, struct CSSSelector **a,
+    struct CSSSelector **b)
+{
+    long na = Fullwalk(sheet, e, a), nb = Indexed(sheet, e, b);
+    return (BOOL)(na == nb && !memcmp(a, b, na * sizeof(*a)));
+}
+
+/*--------------------------------------------------------------------*/
+/* Checks                                                             */
+/*--------------------------------------------------------------------*/
+
+static char *rules[] = {
+    "p", ".a", "#x", "*", "html", "body", ":root", "div p", "p.a.b", ".b.a",
+    "P#X", "[class]", "a:hover", "HTML .a", "em, .c, #y", NULL
+};
+
+/* Numbers of the rules that match (e) through the index */
+static void Matchrules(struct CSSStylesheet *sheet, struct Testelt *e, char *buf)
+{
+    struct CSSSelector *found[64];
+    struct CSSRule *rule;
+    struct CSSSelector *sel;
+    long n = Indexed(sheet, e, found), i, nr;
+    *buf = '\0';
+    for (i = 0; i < n; i++) {
+        for (rule = (struct CSSRule *)sheet->rules.mlh_Head, nr = 0; rule->node.mln_Succ;
+            rule = (struct CSSRule *)rule->node.mln_Succ, nr++) {
+            for (sel = (struct CSSSelector *)rule->selectors.mlh_Head; sel->node.mln_Succ;
+                sel = (struct CSSSelector *)sel->node.mln_Succ) {
+                if (sel == found[i]) sprintf(buf + strlen(buf), "%s%ld", *buf ? " " : "", nr);
+            }
+        }
+    }
+}
+
+static void Checksheet(struct CSSStylesheet *sheet)
+{
+    static struct {
+        struct Testelt e;
+        char *rules;
+    } tests[] = {
+        { { "p", "a b", "x" }, "0 1 2 3 7 8 9 10 11 13" },
+        { { "html", NULL, NULL }, "3 4 6" },
+        { { NULL, NULL, NULL }, "3 4 5" },
+        { { "body", "A", NULL }, "1 3 5 11 13" },
+        { { "div", "b a a", NULL }, "1 3 9 11 13" },
+        { { "a", NULL, NULL }, "3" },
+        { { "span", NULL, "X" }, "2 3" },
+        { { "EM", "c", "y" }, "3 11 14 14 14" },
+    };
+    struct CSSSelector *a[64], *b[64];
+    char buf[200];
+    long i;
+    for (i = 0; i < (long)(sizeof(tests) / sizeof(tests[0])); i++) {
+        Matchrules(sheet, &tests[i].e, buf);
+        if (strcmp(buf, tests[i].rules)) {
+            printf("%s.%s#%s: matched \"%s\", expected \"%s\"\n", tests[i].e.tag ? tests[i].e.tag : "(none)",
+                tests[i].e.class ? tests[i].e.class : "", tests[i].e.id ? tests[i].e.id : "",
+                buf, tests[i].rules);
+            errors++;
+        }
+        CHECK(Samematches(sheet, &tests[i].e, a, b));
+    }
+}
+
+static void Checkfunctions(void)
+{
+    struct CSSStylesheet sheet;
+    struct CSSCandidates cand;
+    struct CSSRule *first = NULL, *rule;
+    long i;
+
+    memset(&sheet, 0, sizeof(sheet));
+    Newlist(&sheet.rules);
+
+    /* An empty sheet, and no sheet */
+    IndexCSSRules(&sheet, (struct CSSRule *)sheet.rules.mlh_Head);
+    FindCSSCandidates(&sheet, (UBYTE *)"p", (UBYTE *)"a", (UBYTE *)"x", &cand);
+    CHECK(cand.count == 0);
+    FreeCSSCandidates(&cand);
+    FindCSSCandidates(NULL, (UBYTE *)"p", NULL, NULL, &cand);
+    CHECK(cand.count == 0);
+    FreeCSSCandidates(&cand);
+
+    /* One sheet */
+    for (i = 0; rules[i]; i++) Addrule(&sheet, rules[i]);
+    IndexCSSRules(&sheet, (struct CSSRule *)sheet.rules.mlh_Head);
+    CHECK(sheet.nrules == i);
+    CHECK(sheet.nextorder == i + 2);
+    Checksheet(&sheet);
+    Freesheet(&sheet);
+
+    /* The same rules, with the second half merged in later like
+     * MergeCSSStylesheet() does */
+    for (i = 0; rules[i]; i++) {
+        if (i == 7) IndexCSSRules(&sheet, (struct CSSRule *)sheet.rules.mlh_Head);
+        rule = Addrule(&sheet, rules[i]);
+        if (i == 7) first = rule;
+    }
+    IndexCSSRules(&sheet, first);
+    CHECK(sheet.nrules == i);
+    Checksheet(&sheet);
+    Freesheet(&sheet);
+}
+
+/*--------------------------------------------------------------------*/
+/* Benchmark                                                          */
+/*--------------------------------------------------------------------*/
+
+static unsigned long seed = 12345;
+
+static long Random(long n)
+{
+    seed = seed * 1103515245 + 12345;
+    return (long)(((seed >> 8) & 0xffffff) % n);
+}
+
+static char *tags[] = {
+    "div", "span", "p", "a", "li", "ul", "td", "tr", "table", "img", "h1", "h2",
+    "em", "strong", "form", "input", "label", "pre", "code", "dd"
+};
+
+#define NTAGS (long)(sizeof(tags) / sizeof(tags[0]))
+#define NCLASSES 300
+#define NIDS 500
+
+/* A selector like those of a large site's style sheet */
+static void Makeselector(char *buf)
+{
+    char *tag = tags[Random(NTAGS)];
+    long c1 = Random(NCLASSES), c2 = Random(NCLASSES), id = Random(NIDS);
+    switch (Random(20)) {
+    case 0: sprintf(buf, "#i%ld", id); break;
+    case 1: sprintf(buf, "%s#i%ld", tag, id); break;
+    case 2: case 3: case 4: case 5: sprintf(buf, ".c%ld", c1); break;
+    case 6: case 7: sprintf(buf, ".c%ld.c%ld", c1, c2); break;
+    case 8: case 9: sprintf(buf, "%s.c%ld", tag, c1); break;
+    case 10: sprintf(buf, "%s", tag); break;
+    case 11: case 12: case 13: sprintf(buf, ".c%ld %s", c2, tag); break;
+    case 14: case 15: sprintf(buf, ".c%ld .c%ld", c2, c1); break;
+    case 16: sprintf(buf, "%s:hover", tag); break;
+    case 17: sprintf(buf, "#I%ld .C%ld", id, c1); break;
+    case 18: sprintf(buf, "%s %s", tags[Random(NTAGS)], tag); break;
+    default:
+        switch (Random(8)) {
+        case 0: strcpy(buf, "*"); break;
+        case 1: strcpy(buf, "html"); break;
+        case 2: strcpy(buf, "body"); break;
+        case 3: strcpy(buf, ":root"); break;
+        case 4: strcpy(buf, "[class]"); break;
+        default: sprintf(buf, ".c%ld", c1); break;
+        }
+    }
+}
+
+static void Makesheet(struct CSSStylesheet *sheet, long nrules, long merge)
+{
+    char text[200];
+    struct CSSRule *rule, *first = NULL;
+    long i, j, n;
+    memset(sheet, 0, sizeof(*sheet));
+    Newlist(&sheet->rules);
+    seed = 12345;
+    for (i = 0; i < nrules; i++) {
+        n = 1 + (Random(4) == 0) + (Random(8) == 0);
+        *text = '\0';
+        for (j = 0; j < n; j++) {
+            if (j) strcat(text, ", ");
+            Makeselector(text + strlen(text));
+        }
+        if (merge && i == merge) IndexCSSRules(sheet, (struct CSSRule *)sheet->rules.mlh_Head);
+        rule = Addrule(sheet, text);
+        if (merge && i == merge) first = rule;
+    }
+    IndexCSSRules(sheet, first ? first : (struct CSSRule *)sheet->rules.mlh_Head);
+}
+
+static void Makeelements(struct Testelt *elts, long n)
+{
+    char buf[100];
+    long i, j, k;
+    seed = 54321;
+    for (i = 0; i < n; i++) {
+        k = Random(50);
+        elts[i].tag = (k == 0) ? NULL : (k == 1) ? "html" : (k == 2) ? "body" : tags[Random(NTAGS)];
+        *buf = '\0';
+        for (j = Random(4); j > 0; j--) {
+            sprintf(buf + strlen(buf), "%s%c%ld", *buf ? " " : "", Random(10) ? 'c' : 'C',
+                Random(NCLASSES));
+        }
+        elts[i].class = *buf ? (char *)Dupstr(buf, strlen(buf)) : NULL;
+        if (Random(3) == 0) {
+            sprintf(buf, "i%ld", Random(NIDS));
+            elts[i].id = (char *)Dupstr(buf, strlen(buf));
+        } else elts[i].id = NULL;
+    }
+}
+
+static double Seconds(clock_t from, clock_t to)
+{
+    return (double)(to - from) / CLOCKS_PER_SEC;
+}
+
+static void Benchmark(long nrules, long nelts, long runs)
+{
+    struct CSSStylesheet sheet, merged;
+    struct Testelt *elts = calloc(nelts, sizeof(*elts));
+    long maxfound, i, r, nsel = 0, nmatch = 0, same = 0;
+    struct CSSSelector **a, **b;
+    clock_t t0, t1, t2;
+
+    Makesheet(&sheet, nrules, 0);
+    Makesheet(&merged, nrules, nrules / 2);
+    Makeelements(elts, nelts);
+    maxfound = sheet.nextorder;
+    a = malloc(maxfound * sizeof(*a));
+    b = malloc(maxfound * sizeof(*b));
+
+    /* Same matches in the same order, in one sheet and in a merged one */
+    for (i = 0; i < nelts; i++) {
+        if (Samematches(&sheet, &elts[i], a, b) && Samematches(&merged, &elts[i], a, b)) same++;
+        nmatch += Fullwalk(&sheet, &elts[i], a);
+    }
+    CHECK(same == nelts);
+    CHECK(nmatch > nelts);
+
+    t0 = clock();
+    for (r = 0; r < runs; r++) {
+        for (i = 0; i < nelts; i++) nsel += Fullwalk(&sheet, &elts[i], a);
+    }
+    t1 = clock();
+    for (r = 0; r < runs; r++) {
+        for (i = 0; i < nelts; i++) nsel -= Indexed(&sheet, &elts[i], b);
+    }
+    t2 = clock();
+    CHECK(nsel == 0);
+
+    printf("%ld rules, %ld selectors, %ld elements, %.1f matches per element\n",
+        nrules, (long)sheet.nextorder, nelts, (double)nmatch / nelts);
+    printf("Full walk  %ld runs: %.3f s\n", runs, Seconds(t0, t1));
+    printf("Index      %ld runs: %.3f s\n", runs, Seconds(t1, t2));
+
+    for (i = 0; i < nelts; i++) {
+        free(elts[i].class);
+        free(elts[i].id);
+    }
+    free(elts);
+    free(a);
+    free(b);
+    Freesheet(&sheet);
+    Freesheet(&merged);
+}
+
+int main(int argc, char *argv[])
+{
+    long nrules = 2000, nelts = 5000, runs = 10, i;
+    BOOL bench = TRUE;
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n")) bench = FALSE;
+        else if (!strcmp(argv[i], "-r") && i + 1 < argc) nrules = atol(argv[++i]);
+        else if (!strcmp(argv[i], "-e") && i + 1 < argc) nelts = atol(argv[++i]);
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc) runs = atol(argv[++i]);
+        else {
+            printf("Usage: CSSIndexTest [-n] [-r <rules>] [-e <elements>] [-t <runs>]\n");
+            printf("Checks the CSS rule index, and compares finding the matching selectors\n");
+            printf("through the index with walking all rules.\n");
+            return 0;
+        }
+    }
+    Checkfunctions();
+    if (bench && nrules > 0 && nelts > 0) Benchmark(nrules, nelts, runs);
+    printf("%ld errors\n", errors);
+    return errors ? 20 : 0;
+}
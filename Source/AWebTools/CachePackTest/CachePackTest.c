@@ -0,0 +1,404 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb-II distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* CachePackTest.c - Test and benchmark for the disk cache pack files */
+
+#include <exec/types.h>
+#include <dos/dos.h>
+#include <proto/exec.h>
+#include <proto/dos.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "aweb.h"
+#include "asyncio.h"
+#include "capack.h"
+
+#define NROBJECTS    2000     /* Objects in benchmark */
+#define MINSIZE      300
+#define MAXSIZE      12000
+
+static long failed;
+
+static void Check(BOOL ok,char *what)
+{  if(!ok)
+   {  printf("FAILED: %s\n",what);
+      failed++;
+   }
+}
+
+static ULONG seed=12345;
+
+static ULONG Random(void)
+{  seed=seed*1103515245+12345;
+   return (seed>>8)&0xffffff;
+}
+
+/* Fill (buf) with data depending on (nr) */
+static void Filldata(UBYTE *buf,long length,ULONG nr)
+{  long i;
+   for(i=0;i<length;i++) buf[i]=(UBYTE)(nr*31+i*7+(i>>8));
+}
+
+static BOOL Checkdata(UBYTE *buf,long length,ULONG nr)
+{  long i;
+   for(i=0;i<length;i++)
+   {  if(buf[i]!=(UBYTE)(nr*31+i*7+(i>>8))) return FALSE;
+   }
+   return TRUE;
+}
+
+static BOOL Exists(UBYTE *name)
+{  long lock;
+   if(lock=Lock(name,SHARED_LOCK))
+   {  UnLock(lock);
+      return TRUE;
+   }
+   return FALSE;
+}
+
+static long Nrsegs(struct Capack *cp)
+{  struct Capseg *seg;
+   long n=0;
+   for(seg=cp->segs.first;seg->next;seg=seg->next) n++;
+   return n;
+}
+
+/* Delete the pack files that are left */
+static void Removepacks(struct Capack *cp)
+{  struct Capseg *seg;
+   for(seg=cp->segs.first;seg->next;seg=seg->next) DeleteFile(seg->name);
+}
+
+static long Milliseconds(struct DateStamp *from,struct DateStamp *to)
+{  return ((to->ds_Days-from->ds_Days)*24*60*60*1000
+      +(to->ds_Minute-from->ds_Minute)*60*1000
+      +(to->ds_Tick-from->ds_Tick)*(1000/TICKS_PER_SECOND));
+}
+
+/* Bytes used on the volume of (dir) */
+static long Diskused(UBYTE *dir)
+{  __aligned struct InfoData id;
+   long lock,used=0;
+   if(lock=Lock(dir,SHARED_LOCK))
+   {  if(Info(lock,&id)) used=id.id_NumBlocksUsed*id.id_BytesPerBlock;
+      UnLock(lock);
+   }
+   return used;
+}
+
+/*-----------------------------------------------------------------------*/
+
+static void Testwrite(UBYTE *dir)
+{  struct Capack cp;
+   struct Caploc loc[3]={0};
+   static long lengths[3]={1,1000,CAPMAXOBJECT};
+   UBYTE *buf;
+   long i;
+   BOOL ok;
+   if(!(buf=ALLOCTYPE(UBYTE,CAPMAXOBJECT,0))) return;
+   Initcapack(&cp,dir);
+   for(i=0;i<3;i++)
+   {  Filldata(buf,lengths[i],i);
+      Check(Capackwrite(&cp,&loc[i],i,buf,lengths[i]),"write object");
+   }
+   Check(Nrsegs(&cp)==1 && loc[0].seg==loc[2].seg,"objects in one pack file");
+   Check(loc[1].offset==sizeof(struct Caprecord)+1,"objects follow each other");
+   for(i=0;i<3;i++)
+   {  memset(buf,0,CAPMAXOBJECT);
+      ok=Capackread(loc[i].seg->name,loc[i].offset,loc[i].length,loc[i].checksum,buf);
+      Check(ok && Checkdata(buf,lengths[i],i),"read object back");
+   }
+   Check(!Capackread(loc[1].seg->name,loc[1].offset,loc[1].length,loc[1].checksum+1,buf),
+      "wrong checksum fails");
+   Check(!Capackread(loc[1].seg->name,loc[1].offset+1,loc[1].length,loc[1].checksum,buf),
+      "wrong offset fails");
+   Check(Capacksize(&cp)==3*sizeof(struct Caprecord)+1+1000+CAPMAXOBJECT,"pack size");
+   for(i=0;i<3;i++) Capackfree(&cp,&loc[i]);
+   Removepacks(&cp);
+   Exitcapack(&cp);
+   FREE(buf);
+}
+
+/* Damage a byte of an object in the file */
+static void Testcorrupt(UBYTE *dir)
+{  struct Capack cp;
+   struct Caploc loc={0};
+   UBYTE buf[500];
+   long fh;
+   Initcapack(&cp,dir);
+   Filldata(buf,sizeof(buf),7);
+   Check(Capackwrite(&cp,&loc,7,buf,sizeof(buf)),"write object");
+   if(fh=Open(loc.seg->name,MODE_OLDFILE))
+   {  Seek(fh,loc.offset+sizeof(struct Caprecord)+100,OFFSET_BEGINNING);
+      Write(fh,"X",1);
+      Close(fh);
+   }
+   Check(!Capackread(loc.seg->name,loc.offset,loc.length,loc.checksum,buf),
+      "damaged object fails");
+   Capackfree(&cp,&loc);
+   Removepacks(&cp);
+   Exitcapack(&cp);
+}
+
+/* Fill pack files, delete most objects, compact and purge */
+static void Testcompact(UBYTE *dir)
+{  struct Capack cp;
+   struct Caploc *locs;
+   struct Capseg *first;
+   UBYTE *buf,*name=NULL;
+   long i,n=(5*CAPSEGSIZE/2)/(8000+sizeof(struct Caprecord));
+   long steps=0;
+   BOOL ok=TRUE;
+   if(!(buf=ALLOCTYPE(UBYTE,8000,0))) return;
+   if(!(locs=ALLOCSTRUCT(Caploc,n,MEMF_CLEAR)))
+   {  FREE(buf);
+      return;
+   }
+   Initcapack(&cp,dir);
+   for(i=0;i<n;i++)
+   {  Filldata(buf,8000,i);
+      if(!Capackwrite(&cp,&locs[i],i,buf,8000)) ok=FALSE;
+   }
+   Check(ok,"write objects");
+   Check(Nrsegs(&cp)==3,"new pack file when full");
+   Check(Capacksize(&cp)==n*(8000+sizeof(struct Caprecord)),"pack size");
+   first=cp.segs.first;
+   if(name=ALLOCTYPE(UBYTE,strlen(first->name)+1,0)) strcpy(name,first->name);
+   Check(!Capackcompact(&cp,32768),"nothing to compact");
+   /* Delete 3 of every 4 objects in the first pack file */
+   for(i=0;i<n;i++)
+   {  if(locs[i].seg==first && i%4) Capackfree(&cp,&locs[i]);
+   }
+   while(!Capackcompact(&cp,32768) && steps<100) steps++;
+   Check(steps>0 && steps<100,"compacted in steps");
+   Check(!first->locs.first->next && (first->flags&CAPSF_DELETE),"pack file emptied");
+   ok=TRUE;
+   for(i=0;i<n;i++)
+   {  if(locs[i].seg)
+      {  if(locs[i].seg==first
+         || !Capackread(locs[i].seg->name,locs[i].offset,locs[i].length,locs[i].checksum,buf)
+         || !Checkdata(buf,8000,i)) ok=FALSE;
+      }
+   }
+   Check(ok,"moved objects read back");
+   Check(name && Exists(name),"emptied pack file kept until purge");
+   Capackpurge(&cp);
+   Check(Nrsegs(&cp)==2 && name && !Exists(name),"emptied pack file deleted");
+   /* Free all, the current pack file stays */
+   for(i=0;i<n;i++) Capackfree(&cp,&locs[i]);
+   Capackpurge(&cp);
+   Check(Nrsegs(&cp)==1,"empty pack files deleted");
+   Removepacks(&cp);
+   Exitcapack(&cp);
+   if(name) FREE(name);
+   FREE(locs);
+   FREE(buf);
+}
+
+/* Pack files from a registration are not appended to */
+static void Testload(UBYTE *dir)
+{  struct Capack cp;
+   struct Caploc loc={0},loc2={0},loc3={0};
+   UBYTE buf[100],*name=NULL;
+   ULONG segnr;
+   Initcapack(&cp,dir);
+   Filldata(buf,sizeof(buf),1);
+   Capackwrite(&cp,&loc,1,buf,sizeof(buf));
+   segnr=loc.seg->nr;
+   loc2=loc;
+   Exitcapack(&cp);
+   Initcapack(&cp,dir);
+   Check(Capackload(&cp,&loc,segnr,loc2.offset,loc2.length,loc2.checksum),"load object");
+   Check(Capacksize(&cp)==sizeof(struct Caprecord)+sizeof(buf),"size from registration");
+   Capackwrite(&cp,&loc3,2,buf,sizeof(buf));
+   Check(loc3.seg && loc3.seg!=loc.seg && loc3.seg->nr>segnr,"loaded pack file not appended");
+   memset(buf,0,sizeof(buf));
+   Check(Capackread(loc.seg->name,loc.offset,loc.length,loc.checksum,buf)
+      && Checkdata(buf,sizeof(buf),1),"read loaded object");
+   if(name=ALLOCTYPE(UBYTE,strlen(loc.seg->name)+1,0)) strcpy(name,loc.seg->name);
+   Capackfree(&cp,&loc);
+   Capackfree(&cp,&loc3);
+   Capackpurge(&cp);
+   Check(Nrsegs(&cp)==1 && name && !Exists(name),"loaded pack file deleted");
+   Removepacks(&cp);
+   Exitcapack(&cp);
+   if(name) FREE(name);
+}
+
+/*-----------------------------------------------------------------------*/
+
+/* Store, read and delete objects in files of their own, like the cache
+ * does without pack files: AWCDxx/xxxxxxxx with the URL as comment. */
+static void Benchfiles(UBYTE *dir,long *sizes,UBYTE *buf)
+{  struct DateStamp t0,t1,t2,t3;
+   UBYTE *name,sub[12];
+   void *fh;
+   long i,len=strlen(dir)+32,used0,used1;
+   BOOL ok=TRUE;
+   long lock;
+   if(!(name=ALLOCTYPE(UBYTE,len,0))) return;
+   for(i=0;i<64;i++)
+   {  strcpy(name,dir);
+      sprintf(sub,"AWCD%02lX",i);
+      AddPart(name,sub,len);
+      if(lock=CreateDir(name)) UnLock(lock);
+   }
+   used0=Diskused(dir);
+   DateStamp(&t0);
+   for(i=0;i<NROBJECTS;i++)
+   {  strcpy(name,dir);
+      sprintf(sub,"AWCD%02lX",i%64);
+      AddPart(name,sub,len);
+      sprintf(sub,"%08lX",i);
+      AddPart(name,sub,len);
+      Filldata(buf,sizes[i],i);
+      if(fh=OpenAsync(name,MODE_WRITE,FILEBLOCKSIZE))
+      {  if(WriteAsync(fh,buf,sizes[i])!=sizes[i]) ok=FALSE;
+         CloseAsync(fh);
+         SetComment(name,"http://www.example.com/images/picture.gif");
+      }
+      else ok=FALSE;
+   }
+   DateStamp(&t1);
+   used1=Diskused(dir);
+   for(i=0;i<NROBJECTS;i++)
+   {  strcpy(name,dir);
+      sprintf(sub,"AWCD%02lX",i%64);
+      AddPart(name,sub,len);
+      sprintf(sub,"%08lX",i);
+      AddPart(name,sub,len);
+      if(fh=OpenAsync(name,MODE_READ,FILEBLOCKSIZE))
+      {  if(ReadAsync(fh,buf,sizes[i])!=sizes[i] || !Checkdata(buf,sizes[i],i)) ok=FALSE;
+         CloseAsync(fh);
+      }
+      else ok=FALSE;
+   }
+   DateStamp(&t2);
+   for(i=0;i<NROBJECTS;i++)
+   {  strcpy(name,dir);
+      sprintf(sub,"AWCD%02lX",i%64);
+      AddPart(name,sub,len);
+      sprintf(sub,"%08lX",i);
+      AddPart(name,sub,len);
+      if(!DeleteFile(name)) ok=FALSE;
+   }
+   DateStamp(&t3);
+   for(i=0;i<64;i++)
+   {  strcpy(name,dir);
+      sprintf(sub,"AWCD%02lX",i);
+      AddPart(name,sub,len);
+      DeleteFile(name);
+   }
+   Check(ok,"own files");
+   printf("Own files:  write %6ld ms  read %6ld ms  delete %6ld ms  disk %7ld kB\n",
+      Milliseconds(&t0,&t1),Milliseconds(&t1,&t2),Milliseconds(&t2,&t3),
+      (used1-used0)/1024);
+   FREE(name);
+}
+
+/* The same with pack files */
+static void Benchpacks(UBYTE *dir,long *sizes,UBYTE *buf)
+{  struct DateStamp t0,t1,t2,t3;
+   struct Capack cp;
+   struct Caploc *locs;
+   long i,used0,used1,nrfiles;
+   BOOL ok=TRUE;
+   if(!(locs=ALLOCSTRUCT(Caploc,NROBJECTS,MEMF_CLEAR))) return;
+   Initcapack(&cp,dir);
+   used0=Diskused(dir);
+   DateStamp(&t0);
+   for(i=0;i<NROBJECTS;i++)
+   {  Filldata(buf,sizes[i],i);
+      if(!Capackwrite(&cp,&locs[i],i,buf,sizes[i])) ok=FALSE;
+   }
+   DateStamp(&t1);
+   used1=Diskused(dir);
+   nrfiles=Nrsegs(&cp);
+   for(i=0;i<NROBJECTS;i++)
+   {  if(!locs[i].seg
+      || !Capackread(locs[i].seg->name,locs[i].offset,locs[i].length,locs[i].checksum,buf)
+      || !Checkdata(buf,sizes[i],i)) ok=FALSE;
+   }
+   DateStamp(&t2);
+   for(i=0;i<NROBJECTS;i++) Capackfree(&cp,&locs[i]);
+   Capackpurge(&cp);
+   DateStamp(&t3);
+   Check(ok,"pack files");
+   printf("Pack files: write %6ld ms  read %6ld ms  delete %6ld ms  disk %7ld kB"
+      "  (%ld files)\n",
+      Milliseconds(&t0,&t1),Milliseconds(&t1,&t2),Milliseconds(&t2,&t3),
+      (used1-used0)/1024,nrfiles);
+   Removepacks(&cp);
+   Exitcapack(&cp);
+   FREE(locs);
+}
+
+static void Benchmark(UBYTE *dir)
+{  long *sizes,total=0;
+   UBYTE *buf;
+   long i;
+   if(!(sizes=ALLOCTYPE(long,NROBJECTS,0))) return;
+   if(!(buf=ALLOCTYPE(UBYTE,MAXSIZE,0)))
+   {  FREE(sizes);
+      return;
+   }
+   for(i=0;i<NROBJECTS;i++)
+   {  sizes[i]=MINSIZE+Random()%(MAXSIZE-MINSIZE);
+      total+=sizes[i];
+   }
+   printf("%ld objects, %ld kB\n",(long)NROBJECTS,total/1024);
+   Benchfiles(dir,sizes,buf);
+   Benchpacks(dir,sizes,buf);
+   FREE(buf);
+   FREE(sizes);
+}
+
+int main(int argc,char *argv[])
+{  UBYTE *dir="T:CachePackTest";
+   UBYTE *name;
+   long lock,len;
+   BOOL bench=TRUE;
+   short i;
+   for(i=1;i<argc;i++)
+   {  if(STREQUAL(argv[i],"-n")) bench=FALSE;
+      else dir=argv[i];
+   }
+   if(!Initmemory())
+   {  printf("Can't initialize\n");
+      return 20;
+   }
+   if(lock=CreateDir(dir)) UnLock(lock);
+   Testwrite(dir);
+   Testcorrupt(dir);
+   Testcompact(dir);
+   Testload(dir);
+   if(failed) printf("%ld checks failed\n",failed);
+   else printf("All checks passed\n");
+   if(bench) Benchmark(dir);
+   len=strlen(dir)+8;
+   if(name=ALLOCTYPE(UBYTE,len,0))
+   {  strcpy(name,dir);
+      AddPart(name,"AWCP",len);
+      DeleteFile(name);
+      FREE(name);
+   }
+   DeleteFile(dir);
+   Freememory();
+   return failed?10:0;
+}
@@ -0,0 +1,389 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb-II distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* CacheReplayTest.c - Test and trace replay for the disk cache eviction order */
+
+#include <exec/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "caevict.c"
+
+static long errors;
+
+#define CHECK(c) do { if (!(c)) { printf("line %d: %s\n", __LINE__, #c); errors++; } } while (0)
+
+/* Same as cache.c */
+#define FLUSHTO   90
+#define PROTECTED 80
+
+/*--------------------------------------------------------------------*/
+/* Eviction functions                                                 */
+/*--------------------------------------------------------------------*/
+
+static void Setentry(struct Caentry *ce, long size, UWORD hits)
+{
+    memset(ce, 0, sizeof(*ce));
+    ce->size = size;
+    ce->hits = hits;
+    ce->userdata = ce;
+}
+
+static void Checkfunctions(void)
+{
+    struct Caevict cae;
+    struct Caentry e[6];
+
+    /* Used once, evicted in order of use */
+    Initcaevict(&cae);
+    cae.protmax = 1000;
+    Setentry(&e[0], 100, 0);
+    Setentry(&e[1], 100, 0);
+    Setentry(&e[2], 100, 0);
+    Caeadd(&cae, &e[0]);
+    Caeadd(&cae, &e[1]);
+    Caeadd(&cae, &e[2]);
+    Caetouch(&cae, &e[0], 10);
+    CHECK(e[0].flags & CAEF_PROTECTED);
+    CHECK(e[0].atime == 10 && e[0].hits == 1);
+    CHECK(cae.protsize == 100);
+    /* Reused entry goes after all entries used once */
+    CHECK(Caevictnext(&cae) == &e[1]);
+    CHECK(Caevictnext(&cae) == &e[2]);
+    CHECK(Caevictnext(&cae) == &e[0]);
+    CHECK(cae.protsize == 0);
+    CHECK(Caevictnext(&cae) == NULL);
+    CHECK(!(e[0].flags & (CAEF_LINKED | CAEF_PROTECTED)));
+
+    /* Removing twice, and removing an entry that was never added */
+    Caeremove(&cae, &e[0]);
+    Setentry(&e[3], 100, 0);
+    Caeremove(&cae, &e[3]);
+    CHECK(Caevictnext(&cae) == NULL);
+
+    /* Loaded entries keep their segment */
+    Setentry(&e[0], 100, 3);
+    Setentry(&e[1], 100, 0);
+    Caeadd(&cae, &e[0]);
+    Caeadd(&cae, &e[1]);
+    CHECK(e[0].flags & CAEF_PROTECTED);
+    CHECK(Caevictnext(&cae) == &e[1]);
+    Caeremove(&cae, &e[0]);
+    CHECK(cae.protsize == 0);
+
+    /* Protected segment over its limit demotes least recently used */
+    cae.protmax = 250;
+    Setentry(&e[0], 100, 1);
+    Setentry(&e[1], 100, 1);
+    Setentry(&e[2], 100, 1);
+    Setentry(&e[3], 100, 0);
+    Caeadd(&cae, &e[3]);
+    Caeadd(&cae, &e[0]);
+    Caeadd(&cae, &e[1]);
+    Caeadd(&cae, &e[2]);
+    CHECK(!(e[0].flags & CAEF_PROTECTED) && e[0].hits == 0);
+    CHECK(cae.protsize == 200);
+    CHECK(Caevictnext(&cae) == &e[3]);
+    CHECK(Caevictnext(&cae) == &e[0]);
+    /* Growing a protected entry demotes too */
+    Caesetsize(&cae, &e[1], 200);
+    CHECK(!(e[1].flags & CAEF_PROTECTED));
+    CHECK(cae.protsize == 100);
+    CHECK(Caevictnext(&cae) == &e[1]);
+    CHECK(Caevictnext(&cae) == &e[2]);
+    CHECK(Caevictnext(&cae) == NULL);
+    CHECK(cae.protsize == 0);
+
+    /* Touching an entry that isn't linked (still being written) */
+    Setentry(&e[4], 100, 0);
+    Caetouch(&cae, &e[4], 20);
+    CHECK(!(e[4].flags & CAEF_LINKED) && e[4].hits == 1);
+    Caeadd(&cae, &e[4]);
+    CHECK(e[4].flags & CAEF_PROTECTED);
+    CHECK(Caevictnext(&cae) == &e[4]);
+}
+
+/*--------------------------------------------------------------------*/
+/* Trace                                                              */
+/*--------------------------------------------------------------------*/
+
+struct Request
+{
+    long id;                /* Object number */
+    long size;
+};
+
+static struct Request *trace;
+static long ntrace, nobjects;
+
+static void Addrequest(long id, long size)
+{
+    static long max;
+    if (ntrace >= max) {
+        max = max ? max * 2 : 4096;
+        if (!(trace = realloc(trace, max * sizeof(*trace)))) {
+            printf("Out of memory\n");
+            exit(20);
+        }
+    }
+    trace[ntrace].id = id;
+    trace[ntrace].size = size;
+    ntrace++;
+    if (id >= nobjects) nobjects = id + 1;
+}
+
+/* URLs of a trace file get numbers through a hash table */
+struct Urlname
+{
+    struct Urlname *next;
+    long id;
+    char url[1];
+};
+
+#define NAMEHASH 16384
+
+static long Urlid(char *url)
+{
+    static struct Urlname *names[NAMEHASH];
+    struct Urlname *un;
+    unsigned long h = 5381;
+    char *p;
+    for (p = url; *p; p++) h = h * 33 + (unsigned char)*p;
+    for (un = names[h % NAMEHASH]; un; un = un->next) {
+        if (!strcmp(un->url, url)) return un->id;
+    }
+    if (!(un = malloc(sizeof(*un) + strlen(url)))) {
+        printf("Out of memory\n");
+        exit(20);
+    }
+    strcpy(un->url, url);
+    un->id = nobjects++;
+    un->next = names[h % NAMEHASH];
+    names[h % NAMEHASH] = un;
+    return un->id;
+}
+
+/* Lines of "URL SIZE". Empty lines and lines starting with # are skipped. */
+static BOOL Readtrace(char *name)
+{
+    FILE *f;
+    char line[2048], url[2048];
+    long size;
+    if (!(f = fopen(name, "r"))) {
+        printf("Can't open %s\n", name);
+        return FALSE;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%2047s %ld", url, &size) != 2) continue;
+        if (size < 0) size = 0;
+        Addrequest(Urlid(url), size);
+    }
+    fclose(f);
+    return ntrace > 0;
+}
+
+static unsigned long seed = 12345;
+
+static double Random(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return ((seed >> 8) & 0xffffff) / (double)0x1000000;
+}
+
+/* A user browsing: page elements picked with Zipf popularity, so the logos
+ * and style sheets of favourite sites come back all the time, and a few
+ * large downloads that are never used again. */
+#define NELEMENTS   20000
+#define NREQUESTS   200000
+
+static void Maketrace(void)
+{
+    static long sizes[NELEMENTS];
+    static double cumulative[NELEMENTS];
+    double total = 0.0, r;
+    long i, lo, hi, mid, next = NELEMENTS;
+    for (i = 0; i < NELEMENTS; i++) {
+        /* Mostly small files, some larger images */
+        sizes[i] = 500 + (long)(Random() * Random() * 60000);
+        total += 1.0 / pow(i + 1, 0.8);
+        cumulative[i] = total;
+    }
+    nobjects = NELEMENTS;
+    for (i = 0; i < NREQUESTS; i++) {
+        if (Random() < 0.02) {
+            Addrequest(next++, 200000 + (long)(Random() * 1800000));
+        }
+        else {
+            r = Random() * total;
+            lo = 0;
+            hi = NELEMENTS - 1;
+            while (lo < hi) {
+                mid = (lo + hi) / 2;
+                if (cumulative[mid] < r) lo = mid + 1;
+                else hi = mid;
+            }
+            Addrequest(lo, sizes[lo]);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+/* Replay                                                             */
+/*--------------------------------------------------------------------*/
+
+struct Result
+{
+    long hits, misses;
+    double hitbytes, missbytes;
+    long flushes;           /* Flush passes that deleted files */
+    long deleted;
+};
+
+/* The cache before: one list in order of use, and everything beyond the
+ * limit deleted after every file added. */
+static void Replaylru(long max, struct Result *res)
+{
+    struct Caentry *objects = calloc(nobjects, sizeof(*objects));
+    struct Caentry *ce, *tailnode;
+    Calist list;
+    long i, total = 0, before;
+    if (!objects) return;
+    memset(res, 0, sizeof(*res));
+    Newlist(&list);
+    tailnode = (struct Caentry *)&list.tail;
+    for (i = 0; i < ntrace; i++) {
+        ce = &objects[trace[i].id];
+        if (ce->flags & CAEF_LINKED) {
+            res->hits++;
+            res->hitbytes += ce->size;
+            Remove(ce);
+            Addtail(&list, ce);
+            continue;
+        }
+        res->misses++;
+        res->missbytes += trace[i].size;
+        ce->size = trace[i].size;
+        total += ce->size;
+        Addtail(&list, ce);
+        ce->flags |= CAEF_LINKED;
+        before = res->deleted;
+        while (total > max && list.first != tailnode) {
+            ce = list.first;
+            Remove(ce);
+            ce->flags = 0;
+            total -= ce->size;
+            res->deleted++;
+        }
+        if (res->deleted > before) res->flushes++;
+    }
+    free(objects);
+}
+
+/* The cache now: segmented LRU, flushed down to FLUSHTO percent */
+static void Replayslru(long max, struct Result *res)
+{
+    struct Caentry *objects = calloc(nobjects, sizeof(*objects));
+    struct Caentry *ce;
+    struct Caevict cae;
+    long i, total = 0, before;
+    if (!objects) return;
+    memset(res, 0, sizeof(*res));
+    Initcaevict(&cae);
+    cae.protmax = max / 100 * PROTECTED;
+    for (i = 0; i < ntrace; i++) {
+        ce = &objects[trace[i].id];
+        if (ce->flags & CAEF_LINKED) {
+            res->hits++;
+            res->hitbytes += ce->size;
+            Caetouch(&cae, ce, i);
+            continue;
+        }
+        res->misses++;
+        res->missbytes += trace[i].size;
+        ce->hits = 0;
+        ce->atime = i;
+        Caesetsize(&cae, ce, trace[i].size);
+        total += ce->size;
+        Caeadd(&cae, ce);
+        before = res->deleted;
+        if (total > max) {
+            while (total > max / 100 * FLUSHTO && (ce = Caevictnext(&cae))) {
+                total -= ce->size;
+                res->deleted++;
+            }
+        }
+        if (res->deleted > before) res->flushes++;
+    }
+    free(objects);
+}
+
+static void Print(char *name, struct Result *res)
+{
+    long n = res->hits + res->misses;
+    double bytes = res->hitbytes + res->missbytes;
+    printf("  %-14s hits %5.1f%%  bytes %5.1f%%  flushes %6ld  deleted %6ld\n",
+        name,
+        n ? 100.0 * res->hits / n : 0.0,
+        bytes > 0 ? 100.0 * res->hitbytes / bytes : 0.0,
+        res->flushes, res->deleted);
+}
+
+static void Compare(long kbytes)
+{
+    struct Result lru, slru;
+    memset(&lru, 0, sizeof(lru));
+    memset(&slru, 0, sizeof(slru));
+    Replaylru(kbytes * 1024, &lru);
+    Replayslru(kbytes * 1024, &slru);
+    printf("Cache %ld kB, %ld requests, %ld objects\n", kbytes, ntrace, nobjects);
+    Print("LRU", &lru);
+    Print("Segmented LRU", &slru);
+    /* The segmented LRU should not do worse on a trace with reuse */
+    if (slru.hits < lru.hits) printf("  Segmented LRU has fewer hits\n");
+}
+
+int main(int argc, char *argv[])
+{
+    long kbytes = 0, i;
+    char *tracename = NULL;
+    static long sizes[] = { 2048, 8192, 32768 };
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-s") && i + 1 < argc) kbytes = atol(argv[++i]);
+        else if (argv[i][0] != '-' && !tracename) tracename = argv[i];
+        else {
+            printf("Usage: CacheReplayTest [-s <cache kB>] [<trace file>]\n");
+            printf("Checks the cache eviction order, and replays a trace of \"URL SIZE\"\n");
+            printf("lines, or a generated one, with the old and the new eviction.\n");
+            return 0;
+        }
+    }
+    Checkfunctions();
+    if (tracename) {
+        if (!Readtrace(tracename)) return 20;
+    }
+    else Maketrace();
+    if (kbytes) Compare(kbytes);
+    else {
+        for (i = 0; i < 3; i++) Compare(sizes[i]);
+    }
+    printf("%ld errors\n", errors);
+    return errors ? 20 : 0;
+}
@@ -0,0 +1,452 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb-II distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* CacheSnapTest.c - Test and benchmark for the disk cache registration snapshot */
+
+#include <exec/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "casnap.c"
+
+static long errors;
+
+#define CHECK(c) do { if (!(c)) { printf("line %d: %s\n", __LINE__, #c); errors++; } } while (0)
+
+/*--------------------------------------------------------------------*/
+/* Writing to memory                                                  */
+/*--------------------------------------------------------------------*/
+
+struct Membuf {
+    UBYTE *data;
+    long length;
+    long size;
+};
+
+static long Memwrite(void *handle, void *data, long length)
+{
+    struct Membuf *mb = handle;
+    if (mb->length + length > mb->size) {
+        long size = (mb->length + length) * 2;
+        UBYTE *p = realloc(mb->data, size);
+        if (!p) return -1;
+        mb->data = p;
+        mb->size = size;
+    }
+    memcpy(mb->data + mb->length, data, length);
+    mb->length += length;
+    return length;
+}
+
+static long Filewrite(void *handle, void *data, long length)
+{
+    return (long)fwrite(data, 1, length, handle);
+}
+
+static void Setentry(struct Csnapentry *e, ULONG nr)
+{
+    memset(e, 0, sizeof(*e));
+    e->nr = nr;
+    e->date = 1000 + nr;
+    e->cachedate = 2000 + nr;
+    e->size = 100 * nr;
+    e->atime = 3000 + nr;
+    e->hits = (UWORD)(nr % 3);
+}
+
+/*--------------------------------------------------------------------*/
+/* Functions                                                          */
+/*--------------------------------------------------------------------*/
+
+static void Checkfunctions(void)
+{
+    struct Membuf mb = { NULL, 0, 0 };
+    struct Casnapwriter w;
+    struct Csnapentry e, *f, *entries[8];
+    struct Casnap cs;
+    ULONG buckets[256];
+    UBYTE *copy, url[40];
+    long i, n;
+
+    /* Write and read back */
+    Casnapstart(&w, Memwrite, &mb, buckets, 5, 7, 99);
+    for (i = 1; i <= 4; i++) {
+        Setentry(&e, i);
+        sprintf(url, "http://host/page%ld.html", i);
+        Casnapadd(&w, &e, url, NULL, "text/html", i == 2 ? "\"abc\"" : "");
+    }
+    Setentry(&e, 5);
+    e.type = 1;
+    e.segnr = 3;
+    e.packoffset = 4096;
+    e.packlength = 1234;
+    e.packsum = 0x12345678;
+    Casnapadd(&w, &e, "http://host/old", "http://host/new", "", "");
+    CHECK(Casnapend(&w));
+    CHECK(mb.length % 4 == 0);
+    CHECK(Casnapcount(mb.data, mb.length) == 5);
+    CHECK(Casnapinit(&cs, mb.data, mb.length, entries));
+    CHECK(cs.hdr->serial == 7 && cs.hdr->lastnr == 99);
+    for (i = 1; i <= 4; i++) {
+        sprintf(url, "http://host/page%ld.html", i);
+        f = Casnapfind(&cs, url);
+        CHECK(f && f->nr == (ULONG)i && f->size == 100 * i && f->hits == i % 3);
+        CHECK(f && f == entries[f->index]);
+        CHECK(f && !strcmp(Casnapurl(f), url) && !Casnapmovedto(f));
+        CHECK(f && !strcmp(Casnapmimetype(f), "text/html"));
+    }
+    f = Casnapfind(&cs, "http://host/page2.html");
+    CHECK(f && !strcmp(Casnapetag(f), "\"abc\""));
+    f = Casnapfind(&cs, "http://host/old");
+    CHECK(f && f->type == 1 && f->segnr == 3 && f->packoffset == 4096);
+    CHECK(f && f->packlength == 1234 && f->packsum == 0x12345678);
+    CHECK(f && Casnapmovedto(f) && !strcmp(Casnapmovedto(f), "http://host/new"));
+    CHECK(f && !*Casnapmimetype(f) && !*Casnapetag(f));
+    CHECK(!Casnapfind(&cs, "http://host/new"));
+    CHECK(!Casnapfind(&cs, "http://host/page5.html"));
+    CHECK(!Casnapfind(&cs, ""));
+
+    /* Truncated, or any byte of an entry damaged */
+    CHECK(!Casnapinit(&cs, mb.data, mb.length - 4, entries));
+    CHECK(!Casnapinit(&cs, mb.data, sizeof(struct Csnaphdr) - 1, entries));
+    copy = malloc(mb.length);
+    memcpy(copy, mb.data, mb.length);
+    ((struct Csnaphdr *)copy)->version++;
+    CHECK(Casnapcount(copy, mb.length) < 0);
+    memcpy(copy, mb.data, mb.length);
+    ((struct Csnaphdr *)copy)->nrentries = 0x10000000;
+    CHECK(Casnapcount(copy, mb.length) < 0);
+    memcpy(copy, mb.data, mb.length);
+    ((struct Csnaphdr *)copy)->nrbuckets = 255;
+    CHECK(Casnapcount(copy, mb.length) < 0);
+    memcpy(copy, mb.data, mb.length);
+    entries[0] = (struct Csnapentry *)(copy + sizeof(struct Csnaphdr));
+    entries[0]->reclen += 4;
+    CHECK(!Casnapinit(&cs, copy, mb.length, entries));
+    memcpy(copy, mb.data, mb.length);
+    entries[0]->urlsize += 1;
+    CHECK(!Casnapinit(&cs, copy, mb.length, entries));
+    memcpy(copy, mb.data, mb.length);
+    entries[0]->index = 1;
+    CHECK(!Casnapinit(&cs, copy, mb.length, entries));
+    /* A string without its '\0' */
+    memcpy(copy, mb.data, mb.length);
+    n = entries[0]->reclen;
+    memset((UBYTE *)(entries[0] + 1), 'x', n - sizeof(struct Csnapentry));
+    CHECK(!Casnapinit(&cs, copy, mb.length, entries));
+
+    /* Damaged chain offsets aren't followed */
+    memcpy(copy, mb.data, mb.length);
+    CHECK(Casnapinit(&cs, copy, mb.length, entries));
+    for (i = 0; i < (long)cs.hdr->nrbuckets; i++) {
+        if (cs.buckets[i]) cs.buckets[i] += 2;
+    }
+    CHECK(!Casnapfind(&cs, "http://host/page1.html"));
+    memcpy(copy, mb.data, mb.length);
+    CHECK(Casnapinit(&cs, copy, mb.length, entries));
+    for (i = 0; i < (long)cs.hdr->nrbuckets; i++) {
+        if (cs.buckets[i]) cs.buckets[i] = mb.length - 4;
+    }
+    CHECK(!Casnapfind(&cs, "http://host/page1.html"));
+    memcpy(copy, mb.data, mb.length);
+    CHECK(Casnapinit(&cs, copy, mb.length, entries));
+    /* A chain that loops ends */
+    for (i = 0; i < 5; i++) entries[i]->next = (UBYTE *)entries[i] - copy;
+    CHECK(!Casnapfind(&cs, "http://host/missing"));
+    for (i = 0; i < (long)cs.hdr->nrbuckets; i++) cs.buckets[i] = (UBYTE *)entries[0] - copy;
+    CHECK(!Casnapfind(&cs, "http://host/missing"));
+    CHECK(Casnapfind(&cs, "http://host/page1.html") == entries[0]);
+    free(copy);
+
+    /* Wrong number of entries */
+    mb.length = 0;
+    Casnapstart(&w, Memwrite, &mb, buckets, 2, 1, 1);
+    Setentry(&e, 1);
+    Casnapadd(&w, &e, "http://a/", NULL, "", "");
+    CHECK(!Casnapend(&w));
+    mb.length = 0;
+    Casnapstart(&w, Memwrite, &mb, buckets, 0, 1, 1);
+    Casnapadd(&w, &e, "http://a/", NULL, "", "");
+    CHECK(!Casnapend(&w));
+
+    /* Empty snapshot */
+    mb.length = 0;
+    Casnapstart(&w, Memwrite, &mb, buckets, 0, 1, 1);
+    CHECK(Casnapend(&w));
+    CHECK(Casnapinit(&cs, mb.data, mb.length, entries));
+    CHECK(!Casnapfind(&cs, "http://a/"));
+
+    /* Entries that don't fit */
+    copy = malloc(40000);
+    memset(copy, 'a', 39999);
+    copy[39999] = '\0';
+    CHECK(!Casnapentrysize(copy, NULL, "", ""));
+    CHECK(!Casnapentrysize("http://a/", NULL, "text/a-very-long-mime-type-name-here", ""));
+    CHECK(Casnapentrysize("http://a/", NULL, "text/html", "") % 4 == 0);
+    free(copy);
+
+    CHECK(Casnapbuckets(0) == 256 && Casnapbuckets(1000) == 1024);
+    free(mb.data);
+}
+
+/*--------------------------------------------------------------------*/
+/* Benchmark                                                          */
+/*--------------------------------------------------------------------*/
+
+/* As in cache.c */
+struct Cregheader {
+    UBYTE label[4];
+    long version;
+    ULONG lastnr;
+};
+
+struct Cregentry {
+    ULONG nr;
+    ULONG date;
+    ULONG expires;
+    ULONG cachedate;
+    long size;
+    short type;
+    short urlsize;
+};
+
+struct Cregtail {
+    ULONG atime;
+    ULONG hits;
+    ULONG segnr;
+    long offset;
+    long length;
+    ULONG checksum;
+};
+
+/* What loading the registration creates for each entry: an URL object
+ * in the URL hash and a cache object */
+struct Object {
+    struct Object *next;
+    UBYTE *url;
+    ULONG nr, date, expires, cachedate;
+    long size;
+    UBYTE mimetype[32];
+    UBYTE etag[64];
+    ULONG atime, hits;
+};
+
+#define HASHSIZE 4096
+
+static struct Object *hash[HASHSIZE];
+
+static char *mimetypes[] = { "text/html", "image/gif", "image/jpeg", "image/png", "text/css" };
+
+static void Makeurl(UBYTE *buf, long i)
+{
+    sprintf(buf, "http://www.site%ld.com/images/%ld/picture%ld.gif", i % 997, i / 997, i);
+}
+
+static void Writeregistration(FILE *f, long n)
+{
+    struct Cregheader crh;
+    struct Cregentry cre;
+    struct Cregtail crt;
+    UBYTE url[100];
+    long i;
+    memcpy(crh.label, "AWCR", 4);
+    crh.version = 6;
+    crh.lastnr = n;
+    fwrite(&crh, sizeof(crh), 1, f);
+    memset(&crt, 0, sizeof(crt));
+    for (i = 1; i <= n; i++) {
+        Makeurl(url, i);
+        cre.nr = i;
+        cre.date = cre.expires = 0;
+        cre.cachedate = 1000 + i;
+        cre.size = 2000 + i % 5000;
+        cre.type = 0;
+        cre.urlsize = strlen(url) + 1;
+        fwrite(&cre, sizeof(cre), 1, f);
+        fwrite(mimetypes[i % 5], strlen(mimetypes[i % 5]) + 1, 1, f);
+        fwrite(url, cre.urlsize, 1, f);
+        fwrite("", 1, 1, f);
+        fwrite(&crt, sizeof(crt), 1, f);
+    }
+}
+
+static void Writesnapshot(FILE *f, long n)
+{
+    struct Casnapwriter w;
+    struct Csnapentry e;
+    ULONG *buckets = malloc(Casnapbuckets(n) * sizeof(ULONG));
+    UBYTE url[100];
+    long i;
+    Casnapstart(&w, Filewrite, f, buckets, n, 1, n);
+    for (i = 1; i <= n; i++) {
+        Makeurl(url, i);
+        memset(&e, 0, sizeof(e));
+        e.nr = i;
+        e.cachedate = e.atime = 1000 + i;
+        e.size = 2000 + i % 5000;
+        Casnapadd(&w, &e, url, NULL, mimetypes[i % 5], "");
+    }
+    CHECK(Casnapend(&w));
+    free(buckets);
+}
+
+/* Read string byte by byte, like Readcachereg() does */
+static BOOL Readstring(FILE *f, UBYTE *buf, long max)
+{
+    long i = 0;
+    int c;
+    do {
+        if ((c = getc(f)) == EOF || i >= max) return FALSE;
+        buf[i++] = c;
+    } while (c);
+    return TRUE;
+}
+
+/* Parse all entries and create an object for each */
+static long Loadregistration(FILE *f)
+{
+    struct Cregheader crh;
+    struct Cregentry cre;
+    struct Cregtail crt;
+    struct Object *o;
+    UBYTE mimetype[32], etag[64], url[1024];
+    ULONG h;
+    long n = 0;
+    rewind(f);
+    if (fread(&crh, sizeof(crh), 1, f) != 1) return -1;
+    while (fread(&cre, sizeof(cre), 1, f) == 1) {
+        if (!Readstring(f, mimetype, 32)) return -1;
+        if (cre.urlsize > (short)sizeof(url) || fread(url, cre.urlsize, 1, f) != 1) return -1;
+        if (!Readstring(f, etag, 64)) return -1;
+        if (fread(&crt, sizeof(crt), 1, f) != 1) return -1;
+        h = Casnaphash(url) & (HASHSIZE - 1);
+        for (o = hash[h]; o && strcmp(o->url, url); o = o->next);
+        if (!o) {
+            if (!(o = calloc(1, sizeof(*o)))) return -1;
+            o->url = malloc(strlen(url) + 1);
+            strcpy(o->url, url);
+            o->next = hash[h];
+            hash[h] = o;
+        }
+        o->nr = cre.nr;
+        o->cachedate = cre.cachedate;
+        o->size = cre.size;
+        strcpy(o->mimetype, mimetype);
+        strcpy(o->etag, etag);
+        o->atime = crt.atime;
+        o->hits = crt.hits;
+        n++;
+    }
+    return n;
+}
+
+static void Freeobjects(void)
+{
+    struct Object *o;
+    long i;
+    for (i = 0; i < HASHSIZE; i++) {
+        while ((o = hash[i])) {
+            hash[i] = o->next;
+            free(o->url);
+            free(o);
+        }
+    }
+}
+
+static double Seconds(clock_t from, clock_t to)
+{
+    return (double)(to - from) / CLOCKS_PER_SEC;
+}
+
+static void Benchmark(long n, long lookups)
+{
+    FILE *reg = tmpfile(), *snap = tmpfile();
+    struct Casnap cs;
+    struct Csnapentry **entries;
+    UBYTE *block, url[100];
+    clock_t t0, t1, t2, t3;
+    long size, i, found = 0, loaded;
+    if (!reg || !snap) {
+        printf("Can't create temporary files\n");
+        errors++;
+        return;
+    }
+    Writeregistration(reg, n);
+    Writesnapshot(snap, n);
+    fflush(reg);
+    fflush(snap);
+
+    t0 = clock();
+    loaded = Loadregistration(reg);
+    t1 = clock();
+    CHECK(loaded == n);
+    printf("Registration  %7ld entries, %8ld bytes: load %.3f s\n",
+        n, ftell(reg), Seconds(t0, t1));
+    Freeobjects();
+
+    t0 = clock();
+    fseek(snap, 0, SEEK_END);
+    size = ftell(snap);
+    rewind(snap);
+    block = malloc(size);
+    entries = malloc((n + 1) * sizeof(*entries));
+    CHECK(block && entries && fread(block, size, 1, snap) == 1);
+    CHECK(Casnapinit(&cs, block, size, entries));
+    t1 = clock();
+    /* The URLs of a session, plus some that aren't cached */
+    for (i = 0; i < lookups; i++) {
+        Makeurl(url, i * 7919 % (n + n / 10) + 1);
+        if (Casnapfind(&cs, url)) found++;
+    }
+    t2 = clock();
+    for (i = 1; i <= n; i++) {
+        Makeurl(url, i);
+        if (!Casnapfind(&cs, url)) break;
+    }
+    t3 = clock();
+    CHECK(i > n);
+    printf("Snapshot      %7ld entries, %8ld bytes: load %.3f s, %ld lookups %.3f s, all %.3f s\n",
+        n, size, Seconds(t0, t1), lookups, Seconds(t1, t2), Seconds(t2, t3));
+    CHECK(found > 0 && found < lookups);
+    free(entries);
+    free(block);
+    fclose(reg);
+    fclose(snap);
+}
+
+int main(int argc, char *argv[])
+{
+    long n = 100000, i;
+    BOOL bench = TRUE;
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n")) bench = FALSE;
+        else if (!strcmp(argv[i], "-e") && i + 1 < argc) n = atol(argv[++i]);
+        else {
+            printf("Usage: CacheSnapTest [-n] [-e <entries>]\n");
+            printf("Checks the cache registration snapshot, and compares loading the\n");
+            printf("registration entry by entry with loading a snapshot.\n");
+            return 0;
+        }
+    }
+    Checkfunctions();
+    if (bench && n > 0) Benchmark(n, 1000);
+    printf("%ld errors\n", errors);
+    return errors ? 20 : 0;
+}
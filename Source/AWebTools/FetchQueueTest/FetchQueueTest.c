@@ -0,0 +1,484 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb-II distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* FetchQueueTest.c - Test and latency simulation for the fetch scheduler */
+
+#include <exec/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fetchq.c"
+
+static long errors;
+
+#define CHECK(c) do { if (!(c)) { printf("line %d: %s\n", __LINE__, #c); errors++; } } while (0)
+
+/*--------------------------------------------------------------------*/
+/* Queue functions                                                    */
+/*--------------------------------------------------------------------*/
+
+static void Setentry(struct Fqentry *fqe, UBYTE *url, UWORD priority)
+{
+    memset(fqe, 0, sizeof(*fqe));
+    fqe->host = Fqhostkey(url);
+    fqe->priority = priority;
+    fqe->userdata = url;
+}
+
+static void Checkfunctions(void)
+{
+    struct Fetchqueue fq;
+    struct Fqentry e[8];
+
+    CHECK(Fqhostkey("http://www.example.com/a") == Fqhostkey("HTTP://WWW.Example.COM/b?c"));
+    CHECK(Fqhostkey("http://www.example.com/") == Fqhostkey("https://user:pw@www.example.com"));
+    CHECK(Fqhostkey("http://www.example.com/") != Fqhostkey("http://www.example.com:8080/"));
+    CHECK(Fqhostkey("http://www.example.com/") != Fqhostkey("http://www.example.org/"));
+    CHECK(Fqhostkey("mailto:someone@example.com") == 0);
+    CHECK(Fqhostkey("file:///ram:index.html") == 0);
+    CHECK(Fqhostkey("x-aweb:about") == 0);
+
+    /* Classes in order, FIFO within a class */
+    Initfetchqueue(&fq);
+    fq.maxrunning = 1;
+    Setentry(&e[0], "http://a/1", FQP_OFFSCREEN);
+    Setentry(&e[1], "http://a/2", FQP_STYLE);
+    Setentry(&e[2], "http://a/3", FQP_IMAGE);
+    Setentry(&e[3], "http://a/4", FQP_STYLE);
+    Setentry(&e[4], "http://a/5", FQP_PREFETCH);
+    Fqqueue(&fq, &e[0]);
+    Fqqueue(&fq, &e[1]);
+    Fqqueue(&fq, &e[2]);
+    Fqqueue(&fq, &e[3]);
+    Fqqueue(&fq, &e[4]);
+    /* Moving up puts it at the end of its new class */
+    Fqsetpriority(&fq, &e[4], FQP_STYLE);
+    /* Removing a queued entry */
+    Fqremove(&fq, &e[3]);
+    CHECK(!(e[3].flags & FQEF_QUEUED));
+    CHECK(Fqnext(&fq) == &e[1]);
+    Fqstart(&fq, &e[1]);
+    CHECK(Fqnext(&fq) == NULL);
+    Fqremove(&fq, &e[1]);
+    CHECK(fq.nrunning == 0);
+    CHECK(Fqnext(&fq) == &e[4]);
+    Fqstart(&fq, &e[4]);
+    Fqremove(&fq, &e[4]);
+    CHECK(Fqnext(&fq) == &e[2]);
+    Fqstart(&fq, &e[2]);
+    Fqremove(&fq, &e[2]);
+    CHECK(Fqnext(&fq) == &e[0]);
+    Fqstart(&fq, &e[0]);
+    Fqremove(&fq, &e[0]);
+    CHECK(Fqnext(&fq) == NULL);
+
+    /* A busy host is passed over */
+    Initfetchqueue(&fq);
+    fq.maxrunning = 4;
+    fq.maxperhost = 2;
+    Setentry(&e[0], "http://a/1", FQP_DOCUMENT);
+    Setentry(&e[1], "http://a/2", FQP_DOCUMENT);
+    Setentry(&e[2], "http://a/3", FQP_STYLE);
+    Setentry(&e[3], "http://b/4", FQP_OFFSCREEN);
+    Setentry(&e[4], "mailto:x@a", FQP_PREFETCH);
+    Fqstart(&fq, &e[0]);
+    Fqstart(&fq, &e[1]);
+    CHECK(!Fqcanstart(&fq, &e[2]));
+    CHECK(Fqcanstart(&fq, &e[3]));
+    Fqqueue(&fq, &e[2]);
+    Fqqueue(&fq, &e[3]);
+    Fqqueue(&fq, &e[4]);
+    CHECK(Fqnext(&fq) == &e[3]);
+    Fqstart(&fq, &e[3]);
+    Fqremove(&fq, &e[0]);
+    CHECK(Fqnext(&fq) == &e[2]);
+    Fqstart(&fq, &e[2]);
+    /* The last connection is kept while a document loads */
+    fq.reserved = 1;
+    CHECK(fq.nrunning == 3);
+    CHECK(Fqnext(&fq) == NULL);
+    Fqremove(&fq, &e[1]);
+    Fqremove(&fq, &e[2]);
+    CHECK(Fqnext(&fq) == &e[4]);
+    Fqstart(&fq, &e[4]);
+    Fqremove(&fq, &e[3]);
+    Fqremove(&fq, &e[4]);
+    CHECK(fq.nrunning == 0);
+    /* Removing twice does nothing */
+    Fqremove(&fq, &e[4]);
+    CHECK(fq.nrunning == 0);
+
+    /* A busy host goes over its limit when no other host can start */
+    Initfetchqueue(&fq);
+    fq.maxrunning = 4;
+    fq.maxperhost = 2;
+    Setentry(&e[0], "http://a/1", FQP_DOCUMENT);
+    Setentry(&e[1], "http://a/2", FQP_DOCUMENT);
+    Setentry(&e[2], "http://a/3", FQP_IMAGE);
+    Setentry(&e[3], "http://b/4", FQP_OFFSCREEN);
+    Fqstart(&fq, &e[0]);
+    Fqstart(&fq, &e[1]);
+    Fqqueue(&fq, &e[2]);
+    Fqqueue(&fq, &e[3]);
+    CHECK(!Fqcanstart(&fq, &e[2]));
+    CHECK(Fqnext(&fq) == &e[3]);
+    Fqstart(&fq, &e[3]);
+    CHECK(Fqnext(&fq) == &e[2]);
+    Fqstart(&fq, &e[2]);
+    CHECK(Fqnext(&fq) == NULL);
+    Fqremove(&fq, &e[0]);
+    Fqremove(&fq, &e[1]);
+    Fqremove(&fq, &e[2]);
+    Fqremove(&fq, &e[3]);
+    CHECK(fq.nrunning == 0);
+}
+
+/*--------------------------------------------------------------------*/
+/* Page load simulation                                               */
+/*--------------------------------------------------------------------*/
+
+/* Round trip time in ms and transfer rate in bytes per ms of a host.
+ * Every fetch takes two round trips (connect and request) before the
+ * data arrives. */
+struct Simhost {
+    char *name;
+    long rtt;
+    long rate;
+};
+
+static struct Simhost hosts[] = {
+    { "http://www.example.com", 150, 40 },
+    { "http://cdn.example.net", 80, 100 },
+    { "http://ads.example.org", 700, 8 },
+};
+
+#define WWW 0
+#define CDN 1
+#define ADS 2
+
+/* What the document refers to. References in the document are found when
+ * the parser gets at (offset), others when the (parent) is loaded. A
+ * blocking script stops the parser until it is loaded. Images are on
+ * (screen) 0 when the page is first shown, on screen 1 after scrolling
+ * down, or never shown. */
+
+#define R_DOC       0
+#define R_STYLE     1
+#define R_SCRIPT    2
+#define R_IMAGE     3
+
+struct Simresource {
+    short type;
+    short host;
+    long size;
+    short parent;           /* Index, or -1 for the document */
+    long offset;
+    short screen;           /* For images, or -1 if not shown */
+
+    /* Simulation state */
+    struct Fqentry fqe;
+    short state;
+    long end;
+};
+
+#define SS_UNKNOWN  0
+#define SS_WAITING  1
+#define SS_RUNNING  2
+#define SS_DONE     3
+
+#define MAXRESOURCES 80
+
+static struct Simresource page[MAXRESOURCES];
+static long nresources;
+
+static void Add(short type, short host, long size, short parent, long offset, short screen)
+{
+    struct Simresource *r = &page[nresources++];
+    memset(r, 0, sizeof(*r));
+    r->type = type;
+    r->host = host;
+    r->size = size;
+    r->parent = parent;
+    r->offset = offset;
+    r->screen = screen;
+}
+
+/* A news page: style sheets with an import, a blocking script in the
+ * head and one at the end, article images, thumbnails from a content
+ * server and banners from a slow advertising server. */
+static void Makepage(void)
+{
+    long i;
+    nresources = 0;
+    Add(R_DOC, WWW, 48000, -1, 0, 0);
+    Add(R_STYLE, WWW, 14000, -1, 600, -1);
+    Add(R_STYLE, CDN, 4000, -1, 900, -1);
+    Add(R_STYLE, WWW, 6000, 1, 0, -1);      /* @import in the first */
+    Add(R_SCRIPT, CDN, 30000, -1, 1400, -1);
+    Add(R_IMAGE, WWW, 3000, -1, 2200, 0);   /* Logo */
+    for (i = 0; i < 8; i++) {
+        Add(R_IMAGE, ADS, 12000, -1, 2600 + i * 5000, i < 2 ? 0 : -1);
+    }
+    for (i = 0; i < 24; i++) {
+        Add(R_IMAGE, WWW, 16000, -1, 3000 + i * 1800, i < 4 ? 0 : i < 10 ? 1 : -1);
+    }
+    for (i = 0; i < 12; i++) {
+        Add(R_IMAGE, CDN, 5000, -1, 20000 + i * 1500, -1);
+    }
+    Add(R_IMAGE, WWW, 2000, 1, 0, 0);       /* Background in the style sheet */
+    Add(R_SCRIPT, WWW, 8000, -1, 47000, -1);
+}
+
+struct Simresult {
+    long layout;            /* Document parsed, style sheets loaded */
+    long visible;           /* Images on the first screen loaded */
+    long scrolled;          /* Images on the second screen loaded, after scrolling */
+    long done;              /* Everything loaded */
+};
+
+struct Simopts {
+    long maxconnect;
+    long latency;           /* Latency in percent */
+    BOOL scheduler;         /* Use classes and limits, else the old queue */
+    BOOL verbose;
+};
+
+static long Rtt(struct Simresource *r, struct Simopts *so)
+{
+    return hosts[r->host].rtt * so->latency / 100;
+}
+
+static UWORD Simpriority(struct Simresource *r, struct Simopts *so)
+{
+    if (!so->scheduler) {
+        /* Documents before images, in order of arrival */
+        return r->type == R_IMAGE ? FQP_IMAGE : FQP_DOCUMENT;
+    }
+    switch (r->type) {
+        case R_STYLE:  return FQP_STYLE;
+        case R_SCRIPT: return FQP_SCRIPT;
+        case R_IMAGE:  return FQP_OFFSCREEN;
+    }
+    return FQP_DOCUMENT;
+}
+
+static void Start(struct Fetchqueue *fq, struct Simresource *r, long t, struct Simopts *so)
+{
+    Fqstart(fq, &r->fqe);
+    r->state = SS_RUNNING;
+    r->end = t + 2 * Rtt(r, so) + r->size / hosts[r->host].rate;
+    if (so->verbose) {
+        printf("%6ld start %2ld class %d %s\n", t, (long)(r - page), r->fqe.priority, hosts[r->host].name);
+    }
+}
+
+static BOOL pending;
+
+/* As Startdriver(). The scheduler queues images until the parser is done
+ * with what it has, and checks the queue again for fetches that can't
+ * start at once. */
+static void Found(struct Fetchqueue *fq, struct Simresource *r, long t, struct Simopts *so)
+{
+    char url[64];
+    sprintf(url, "%s/%ld", hosts[r->host].name, (long)(r - page));
+    r->fqe.userdata = r;
+    r->fqe.host = Fqhostkey(url);
+    r->fqe.priority = Simpriority(r, so);
+    if (so->scheduler && r->fqe.priority >= FQP_DELAYABLE) pending = TRUE;
+    else if (Fqcanstart(fq, &r->fqe)) {
+        Start(fq, r, t, so);
+        return;
+    }
+    else if (so->scheduler) pending = TRUE;
+    Fqqueue(fq, &r->fqe);
+    r->state = SS_WAITING;
+}
+
+/* Images shown on the screen are moved up, as Rendercopy() does */
+static void Show(struct Fetchqueue *fq, short screen, struct Simopts *so)
+{
+    long i;
+    if (!so->scheduler) return;
+    for (i = 0; i < nresources; i++) {
+        if (page[i].type == R_IMAGE && page[i].screen == screen && page[i].fqe.priority == FQP_OFFSCREEN) {
+            Fqsetpriority(fq, &page[i].fqe, FQP_IMAGE);
+        }
+    }
+}
+
+static BOOL Alldone(short screen, BOOL layout)
+{
+    long i;
+    for (i = 0; i < nresources; i++) {
+        if (page[i].state == SS_DONE) continue;
+        if (layout && page[i].type != R_IMAGE) return FALSE;
+        if (!layout && page[i].type == R_IMAGE && (screen < 0 || page[i].screen == screen)) return FALSE;
+    }
+    return TRUE;
+}
+
+/* Check the limits after every step. A host may only be over its limit
+ * while no fetch for another host can start. */
+static void Checklimits(struct Fetchqueue *fq, struct Simopts *so)
+{
+    long i, n = 0, perhost[3] = { 0, 0, 0 };
+    BOOL over = FALSE;
+    for (i = 0; i < nresources; i++) {
+        if (page[i].state == SS_RUNNING) {
+            n++;
+            perhost[page[i].host]++;
+        }
+    }
+    CHECK(n == fq->nrunning);
+    CHECK(n <= so->maxconnect);
+    if (so->scheduler) {
+        for (i = 0; i < 3; i++) {
+            if (perhost[i] > fq->maxperhost) over = TRUE;
+        }
+        for (i = 0; over && i < nresources; i++) {
+            if (page[i].state == SS_WAITING) CHECK(!Fqcanstart(fq, &page[i].fqe));
+        }
+    }
+}
+
+#define SCROLLDELAY 2000
+#define MAXTIME     600000
+
+static void Simulate(struct Simopts *so, struct Simresult *res)
+{
+    struct Fetchqueue fq;
+    struct Fqentry *fqe;
+    struct Simresource *doc = &page[0], *r;
+    long t, i, next = 1, received, scroll = -1;
+    BOOL blocked, changed;
+
+    Makepage();
+    memset(res, 0, sizeof(*res));
+    pending = FALSE;
+    Initfetchqueue(&fq);
+    fq.maxrunning = so->maxconnect;
+    if (so->scheduler) {
+        fq.maxperhost = so->maxconnect < 4 ? so->maxconnect : 4;
+        fq.reserved = 1;
+    }
+    Found(&fq, doc, 0, so);
+    for (t = 0; t < MAXTIME && !res->done; t++) {
+        changed = FALSE;
+        for (i = 0; i < nresources; i++) {
+            r = &page[i];
+            if (r->state == SS_RUNNING && r->end <= t) {
+                Fqremove(&fq, &r->fqe);
+                r->state = SS_DONE;
+                changed = TRUE;
+                if (so->verbose) printf("%6ld done  %2ld\n", t, i);
+            }
+        }
+        /* The parser follows the document data */
+        received = 0;
+        if (doc->state == SS_DONE) received = doc->size;
+        else if (doc->state == SS_RUNNING) {
+            received = (t - (doc->end - doc->size / hosts[doc->host].rate)) * hosts[doc->host].rate;
+            if (received < 0) received = 0;
+        }
+        blocked = FALSE;
+        while (!blocked && next < nresources) {
+            for (i = 1; i < next; i++) {
+                if (page[i].type == R_SCRIPT && page[i].parent < 0 && page[i].state != SS_DONE) blocked = TRUE;
+            }
+            if (blocked) break;
+            r = &page[next];
+            if (r->parent < 0) {
+                if (r->offset > received) break;
+                Found(&fq, r, t, so);
+            }
+            next++;
+        }
+        /* References in loaded style sheets */
+        for (i = 1; i < nresources; i++) {
+            r = &page[i];
+            if (r->state == SS_UNKNOWN && r->parent > 0 && page[r->parent].state == SS_DONE) {
+                Found(&fq, r, t, so);
+            }
+        }
+        if (changed || pending) {
+            pending = FALSE;
+            /* As Checkqueues() */
+            while (fqe = Fqnext(&fq)) Start(&fq, (struct Simresource *)fqe->userdata, t, so);
+        }
+        Checklimits(&fq, so);
+        if (!res->layout && next >= nresources && Alldone(0, TRUE)) {
+            res->layout = t;
+            scroll = t + SCROLLDELAY;
+            Show(&fq, 0, so);
+        }
+        if (t == scroll) Show(&fq, 1, so);
+        if (res->layout && !res->visible && Alldone(0, FALSE)) res->visible = t;
+        if (scroll >= 0 && t >= scroll && !res->scrolled && Alldone(1, FALSE)) res->scrolled = t - scroll;
+        if (next >= nresources && Alldone(-1, FALSE) && Alldone(0, TRUE)) res->done = t;
+    }
+    CHECK(res->done > 0);
+    CHECK(fq.nrunning == 0);
+}
+
+static void Compare(long maxconnect, long latency, BOOL verbose)
+{
+    struct Simopts so;
+    struct Simresult old, new;
+    so.maxconnect = maxconnect;
+    so.latency = latency;
+    so.verbose = verbose;
+    so.scheduler = FALSE;
+    Simulate(&so, &old);
+    so.scheduler = TRUE;
+    Simulate(&so, &new);
+    printf("%2ld connections, latency %3ld%%: first layout %6ld -> %6ld ms, "
+        "visible images %6ld -> %6ld ms, after scrolling %6ld -> %6ld ms, all %6ld -> %6ld ms\n",
+        maxconnect, latency, old.layout, new.layout, old.visible, new.visible,
+        old.scrolled, new.scrolled, old.done, new.done);
+    CHECK(new.layout <= old.layout);
+    CHECK(new.visible <= old.visible);
+}
+
+int main(int argc, char *argv[])
+{
+    long maxconnect = 0, latency = 0, i;
+    BOOL verbose = FALSE;
+    static long connections[] = { 2, 4, 8 };
+    static long latencies[] = { 50, 100, 200 };
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-c") && i + 1 < argc) maxconnect = atol(argv[++i]);
+        else if (!strcmp(argv[i], "-l") && i + 1 < argc) latency = atol(argv[++i]);
+        else if (!strcmp(argv[i], "-v")) verbose = TRUE;
+        else {
+            printf("Usage: FetchQueueTest [-c <connections>] [-l <latency%%>] [-v]\n");
+            printf("Checks the fetch queue, and simulates loading a page over slow hosts\n");
+            printf("with the old queue and with the scheduler. Times are simulated.\n");
+            return 0;
+        }
+    }
+    Checkfunctions();
+    if (maxconnect || latency) {
+        Compare(maxconnect ? maxconnect : 4, latency ? latency : 100, verbose);
+    }
+    else {
+        for (i = 0; i < 9; i++) Compare(connections[i / 3], latencies[i % 3], FALSE);
+    }
+    printf("%ld errors\n", errors);
+    return errors ? 20 : 0;
+}
@@ -0,0 +1,356 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb-II distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* GifDecTest.c - Test and benchmark for the GIF plugin LZW decoder */
+
+#include <exec/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "gifdec.h"
+
+#define MAXFRAMES 256
+
+/* One image in a GIF file */
+struct Frame {
+    UBYTE *data;            /* LZW minimum code size, followed by the sub-blocks */
+    long width, height;
+    BOOL interlaced;
+};
+
+/*--------------------------------------------------------------------*/
+/* The per-byte decoder as it was in gifsource.c, for reference       */
+/*--------------------------------------------------------------------*/
+
+struct Olddecoder {
+    UBYTE *next, *end;
+    BOOL eof, stop;
+    long remaining;
+    short rembits;
+    UBYTE lastchar;
+    short clearcode, eofcode, startcodesize, codesize, nextcode;
+    UBYTE outstack[4096];
+    UBYTE suffix[4096];
+    short prefix[4096];
+    short outsp;
+    short lastcode;
+    UBYTE lastgifbyte;
+};
+
+static UBYTE Oldreadbyte(struct Olddecoder *d)
+{
+    if (d->next >= d->end) {
+        d->eof = TRUE;
+        return 0;
+    }
+    return *d->next++;
+}
+
+static UBYTE Oldreadchar(struct Olddecoder *d)
+{
+    UBYTE c;
+    if (d->remaining == 0) {
+        d->remaining = Oldreadbyte(d);
+        if (d->remaining == 0) d->eof = TRUE;
+    }
+    c = Oldreadbyte(d);
+    d->remaining--;
+    return c;
+}
+
+static int Oldgetcode(struct Olddecoder *d)
+{
+    int code;
+    if (d->rembits == 0) {
+        d->lastchar = Oldreadchar(d);
+        d->rembits = 8;
+    }
+    code = d->lastchar >> (8 - d->rembits);
+    while (d->rembits < d->codesize) {
+        d->lastchar = Oldreadchar(d);
+        code |= d->lastchar << d->rembits;
+        d->rembits += 8;
+    }
+    d->rembits -= d->codesize;
+    code &= (1 << d->codesize) - 1;
+    return code;
+}
+
+static UBYTE Oldgetgifbyte(struct Olddecoder *d)
+{
+    int code, curcode;
+    if (d->outsp > 0) return d->outstack[--d->outsp];
+    code = Oldgetcode(d);
+    if (d->eof) return 0;
+    if (code == d->eofcode) {
+        d->eof = TRUE;
+        return 0;
+    }
+    if (code == d->clearcode) {
+        while (code == d->clearcode) {
+            d->nextcode = d->eofcode + 1;
+            d->codesize = d->startcodesize;
+            code = Oldgetcode(d);
+            if (d->eof) return 0;
+        }
+        d->lastcode = code;
+        d->lastgifbyte = code;
+        return (UBYTE)code;
+    }
+    if (code > d->nextcode) {
+        d->stop = TRUE;
+        return 0;
+    }
+    if (code == d->nextcode) {
+        curcode = d->lastcode;
+        if (d->outsp < sizeof(d->outstack)) d->outstack[d->outsp++] = d->lastgifbyte;
+    } else {
+        curcode = code;
+    }
+    while (curcode > d->eofcode && curcode < sizeof(d->suffix)) {
+        if (d->outsp < sizeof(d->outstack)) d->outstack[d->outsp++] = d->suffix[curcode];
+        curcode = d->prefix[curcode];
+    }
+    d->lastgifbyte = curcode;
+    if (d->nextcode < 4096) {
+        d->prefix[d->nextcode] = d->lastcode;
+        d->suffix[d->nextcode] = d->lastgifbyte;
+        d->nextcode++;
+        if (d->nextcode >= (1 << d->codesize) && d->codesize < 12) d->codesize++;
+    }
+    d->lastcode = code;
+    return d->lastgifbyte;
+}
+
+/* Decode a frame pixel by pixel. Returns FALSE on error. */
+static BOOL Olddecode(struct Olddecoder *d, struct Frame *f, UBYTE *pixels, UBYTE *end)
+{
+    long i, n = f->width * f->height;
+    memset(d, 0, sizeof(*d));
+    d->next = f->data + 1;
+    d->end = end;
+    d->codesize = d->startcodesize = f->data[0] + 1;
+    d->clearcode = 1 << f->data[0];
+    d->eofcode = d->clearcode + 1;
+    d->nextcode = d->eofcode + 1;
+    for (i = 0; i < n; i++) {
+        pixels[i] = Oldgetgifbyte(d);
+        if (d->eof || d->stop) return FALSE;
+    }
+    return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+/* The new decoder                                                    */
+/*--------------------------------------------------------------------*/
+
+/* Decode a frame row by row like the plugin does, with the input split
+ * in blocks of (step) bytes. Returns FALSE on error. */
+static BOOL Newdecode(struct Gifdecoder *gd, struct Frame *f, UBYTE *pixels, UBYTE *end, long step)
+{
+    UBYTE *next = f->data + 1, *row = pixels;
+    long y, width, n;
+    Initgifdecoder(gd, f->data[0]);
+    gd->next = gd->end = next;
+    for (y = 0; y < f->height; y++) {
+        for (width = f->width; width; width -= n, row += n) {
+            n = Gifdecode(gd, row, width);
+            if (n < width) {
+                if (gd->flags & (GIFDF_END | GIFDF_ERROR)) return FALSE;
+                if (gd->end >= end) return FALSE;
+                gd->end += step;
+                if (gd->end > end) gd->end = end;
+            }
+        }
+    }
+    return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+static UBYTE *Readfile(char *name, long *length)
+{
+    FILE *f;
+    UBYTE *buf = NULL;
+    if ((f = fopen(name, "rb"))) {
+        fseek(f, 0, SEEK_END);
+        *length = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        if ((buf = malloc(*length + 1))) {
+            if (fread(buf, 1, *length, f) != (size_t)*length) {
+                free(buf);
+                buf = NULL;
+            }
+        }
+        fclose(f);
+    }
+    return buf;
+}
+
+/* Skip data sub-blocks. Returns pointer after the terminator or NULL. */
+static UBYTE *Skipblocks(UBYTE *p, UBYTE *end)
+{
+    while (p < end && *p) p += *p + 1;
+    return (p < end) ? p + 1 : NULL;
+}
+
+/* Find the images in a GIF file. Returns the number of frames or -1. */
+static int Findframes(UBYTE *data, long length, struct Frame *frames)
+{
+    UBYTE *p = data + 13, *end = data + length;
+    int n = 0;
+    if (length < 13 || (strncmp((char *)data, "GIF87a", 6) && strncmp((char *)data, "GIF89a", 6))) {
+        return -1;
+    }
+    if (data[10] & 0x80) p += 3 << ((data[10] & 0x07) + 1);
+    while (p && p < end && *p != 0x3b && n < MAXFRAMES) {
+        if (*p == 0x21 && p + 2 < end) {
+            p = Skipblocks(p + 2, end);
+        } else if (*p == 0x2c && p + 11 < end) {
+            frames[n].width = p[5] | (p[6] << 8);
+            frames[n].height = p[7] | (p[8] << 8);
+            frames[n].interlaced = (p[9] & 0x40) != 0;
+            if (p[9] & 0x80) p += 3 << ((p[9] & 0x07) + 1);
+            p += 10;
+            if (p >= end || *p < 2 || *p > 9) return -1;
+            frames[n++].data = p;
+            p = Skipblocks(p + 1, end);
+        } else {
+            return -1;
+        }
+    }
+    return n;
+}
+
+/* Compare old and new decoder on all frames, with the input split in
+ * several block sizes. */
+static BOOL Runfile(char *name)
+{
+    static long steps[] = { 0, 1, 2, 13, 255, 1460 };
+    struct Frame frames[MAXFRAMES];
+    struct Olddecoder *od = malloc(sizeof(struct Olddecoder));
+    struct Gifdecoder *gd = malloc(sizeof(struct Gifdecoder));
+    UBYTE *data, *oldpix = NULL, *newpix = NULL;
+    long length, size, pixels = 0;
+    int nframes, i, s, interlaced = 0;
+    BOOL ok = TRUE;
+
+    if (!(data = Readfile(name, &length)) || !od || !gd) {
+        printf("%s: cannot read file\n", name);
+        free(od);
+        free(gd);
+        return FALSE;
+    }
+    if ((nframes = Findframes(data, length, frames)) < 0) {
+        printf("%s: not a valid GIF file\n", name);
+        ok = FALSE;
+    }
+    for (i = 0; ok && i < nframes; i++) {
+        size = frames[i].width * frames[i].height;
+        oldpix = realloc(oldpix, size + 1);
+        newpix = realloc(newpix, size + 1);
+        pixels += size;
+        if (frames[i].interlaced) interlaced++;
+        if (!Olddecode(od, &frames[i], oldpix, data + length)) {
+            /* Not a fault of the new decoder, but the corpus should be valid */
+            printf("%s: frame %d: reference decoder failed\n", name, i);
+            ok = FALSE;
+        }
+        for (s = 0; ok && s < (int)(sizeof(steps) / sizeof(steps[0])); s++) {
+            memset(newpix, 0, size);
+            if (!Newdecode(gd, &frames[i], newpix, data + length, steps[s] ? steps[s] : length)) {
+                printf("%s: frame %d: decoder failed (flags 0x%04x, step %ld)\n", name, i, gd->flags, steps[s]);
+                ok = FALSE;
+            } else if (memcmp(oldpix, newpix, size)) {
+                printf("%s: frame %d: pixels differ (step %ld)\n", name, i, steps[s]);
+                ok = FALSE;
+            }
+        }
+    }
+    if (ok) {
+        printf("%s: ok (%d frames, %d interlaced, %ld pixels)\n", name, nframes, interlaced, pixels);
+    }
+    free(data);
+    free(oldpix);
+    free(newpix);
+    free(od);
+    free(gd);
+    return ok;
+}
+
+/* Decode all frames of all files (runs) times with both decoders */
+static void Benchmark(int nfiles, char **names, long runs)
+{
+    struct Olddecoder *od = malloc(sizeof(struct Olddecoder));
+    struct Gifdecoder *gd = malloc(sizeof(struct Gifdecoder));
+    struct Frame frames[MAXFRAMES];
+    UBYTE *data, *pix = malloc(65536L * 16);
+    long length, r, pixels = 0;
+    int i, f, nframes;
+    clock_t oldtime = 0, newtime = 0, start;
+    double oldsecs, newsecs;
+
+    if (!od || !gd || !pix) return;
+    for (i = 0; i < nfiles; i++) {
+        if (!(data = Readfile(names[i], &length))) continue;
+        if ((nframes = Findframes(data, length, frames)) > 0) {
+            for (f = 0; f < nframes; f++) {
+                if (frames[f].width * frames[f].height > 65536L * 16) continue;
+                pixels += frames[f].width * frames[f].height * runs;
+                start = clock();
+                for (r = 0; r < runs; r++) Olddecode(od, &frames[f], pix, data + length);
+                oldtime += clock() - start;
+                start = clock();
+                /* Blocks of 1460 bytes, as received from the network */
+                for (r = 0; r < runs; r++) Newdecode(gd, &frames[f], pix, data + length, 1460);
+                newtime += clock() - start;
+            }
+        }
+        free(data);
+    }
+    oldsecs = (double)oldtime / CLOCKS_PER_SEC;
+    newsecs = (double)newtime / CLOCKS_PER_SEC;
+    if (oldsecs <= 0) oldsecs = 0.001;
+    if (newsecs <= 0) newsecs = 0.001;
+    printf("Benchmark: %ld Mpixels, per-byte decoder %.2f s (%.1f Mpixels/s), block decoder %.2f s (%.1f Mpixels/s), %.1fx\n",
+           pixels / 1000000, oldsecs, pixels / oldsecs / 1e6, newsecs, pixels / newsecs / 1e6, oldsecs / newsecs);
+    free(od);
+    free(gd);
+    free(pix);
+}
+
+int main(int argc, char *argv[])
+{
+    int i, first = 1, failed = 0;
+    long runs = 0;
+    if (argc < 2) {
+        printf("Usage: GifDecTest [-b <runs>] file.gif...\n");
+        printf("Compares the LZW decoder with the old per-byte decoder on every frame.\n");
+        return 0;
+    }
+    if (!strcmp(argv[1], "-b") && argc > 2) {
+        runs = atol(argv[2]);
+        first = 3;
+    }
+    for (i = first; i < argc; i++) {
+        if (!Runfile(argv[i])) failed++;
+    }
+    if (runs > 0) Benchmark(argc - first, argv + first, runs);
+    return failed ? 10 : 0;
+}
@@ -0,0 +1,369 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb-II distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* HtmlNamesTest.c - Test and benchmark for the HTML name lookup */
+
+#include <exec/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+/* Include the module itself, to get at its tables */
+#include "htmlnames.c"
+
+/*--------------------------------------------------------------------*/
+/* The lookups as they were in parse.c, for reference                 */
+/*--------------------------------------------------------------------*/
+
+static int Oldstricmp(UBYTE *a, UBYTE *b)
+{
+    int ca, cb;
+    for (;;) {
+        ca = toupper(*a++);
+        cb = toupper(*b++);
+        if (ca != cb || !ca) return ca - cb;
+    }
+}
+
+static struct Tagdes *Oldfindtag(UBYTE *name)
+{
+    short a = 0, b = NRTAGS - 1, m;
+    long c;
+    while (a <= b) {
+        m = (a + b) / 2;
+        c = Oldstricmp(tags[m].name, name);
+        if (c == 0) return &tags[m];
+        if (c < 0) a = m + 1;
+        else b = m - 1;
+    }
+    return NULL;
+}
+
+static struct Attrdes *Oldfindattr(UBYTE *name)
+{
+    short a = 0, b = NRATTRS - 1, m;
+    long c;
+    while (a <= b) {
+        m = (a + b) / 2;
+        c = Oldstricmp(tagattrs[m].name, name);
+        if (c == 0) return &tagattrs[m];
+        if (c < 0) a = m + 1;
+        else b = m - 1;
+    }
+    return NULL;
+}
+
+static struct Chardes *Oldfindchar(UBYTE *name)
+{
+    short i;
+    for (i = 0; i < NRCHARS; i++) {
+        if (!strcmp(chars[i].name, name)) return &chars[i];
+    }
+    return NULL;
+}
+
+/* Decode a reference the old way. Returns its length, or 0. */
+static long Oldcharref(UBYTE *p, UBYTE *end, ULONG *ch)
+{
+    UBYTE *q = p + 1, name[8];
+    struct Chardes *cd;
+    ULONG n = 0;
+    short i;
+    if (q >= end) return 0;
+    if (*q == '#') {
+        q++;
+        if (q < end && isdigit(*q)) {
+            for (; q < end && isdigit(*q); q++) n = 10 * n + (*q - '0');
+        } else if (q + 1 < end && toupper(*q) == 'X' && isxdigit(q[1])) {
+            for (q++; q < end && isxdigit(*q); q++) {
+                n = 16 * n + ((*q <= '9') ? (*q - '0') : (toupper(*q) - 'A' + 10));
+            }
+        } else return 0;
+    } else {
+        for (i = 0; q < end && i < 7 && (isalnum(*q) || *q == '.' || *q == '-'); q++, i++) name[i] = *q;
+        name[i] = '\0';
+        if (!(cd = Oldfindchar(name))) return 0;
+        n = cd->ch;
+    }
+    if (q < end && *q == ';') q++;
+    *ch = n;
+    return q - p;
+}
+
+/*--------------------------------------------------------------------*/
+
+static BOOL Issgml(UBYTE c)
+{
+    return (BOOL)(isalnum(c) || c == '-' || c == '.' || c == '_' || c == ':');
+}
+
+/* Run the tokenizer's name lookups over a document. Returns a checksum
+ * of everything found, which must be the same for both lookups. */
+static ULONG Scan(UBYTE *p, UBYTE *end, BOOL old)
+{
+    UBYTE buf[32], *name, *q, quote;
+    struct Tagdes *td;
+    struct Attrdes *ad;
+    ULONG sum = 0, ch;
+    long l;
+    while (p < end) {
+        if (*p == '<' && p + 1 < end && (isalpha(p[1]) || p[1] == '/')) {
+            p++;
+            if (*p == '/') p++;
+            for (name = p; p < end && Issgml(*p) && p - name < 31; p++);
+            if (old) {
+                memcpy(buf, name, p - name);
+                buf[p - name] = '\0';
+                td = Oldfindtag(buf);
+            } else td = Findtag(name, p - name);
+            if (td) sum = sum * 31 + td->type;
+            while (p < end && *p != '>') {
+                while (p < end && isspace(*p)) p++;
+                for (name = p; p < end && Issgml(*p) && p - name < 31; p++);
+                if (p == name) {
+                    if (p < end && *p != '>') p++;
+                    continue;
+                }
+                if (old) {
+                    memcpy(buf, name, p - name);
+                    buf[p - name] = '\0';
+                    ad = Oldfindattr(buf);
+                } else ad = Findattr(name, p - name);
+                if (ad) sum = sum * 31 + ad->type;
+                if (p < end && *p == '=') {
+                    p++;
+                    if (p < end && (*p == '"' || *p == '\'')) {
+                        quote = *p++;
+                        for (q = p; q < end && *q != quote; q++);
+                    } else {
+                        for (q = p; q < end && !isspace(*q) && *q != '>'; q++);
+                    }
+                    /* Entities in the value */
+                    while (p < q) {
+                        if (*p == '&' && (l = old ? Oldcharref(p, q, &ch) : Charref(p, q, FALSE, &ch))) {
+                            sum = sum * 31 + ch;
+                            p += l;
+                        } else p++;
+                    }
+                    if (p < end && (*p == '"' || *p == '\'')) p++;
+                }
+            }
+            if (p < end) p++;
+        } else if (*p == '&' && (l = old ? Oldcharref(p, end, &ch) : Charref(p, end, FALSE, &ch))) {
+            sum = sum * 31 + ch;
+            p += l;
+        } else p++;
+    }
+    return sum;
+}
+
+/*--------------------------------------------------------------------*/
+
+static void Lower(UBYTE *to, UBYTE *from)
+{
+    while (*to++ = tolower(*from++));
+}
+
+/* Look up every name in every table, in several cases, and some names
+ * that are not in the tables. Returns number of errors. */
+static long Checknames(void)
+{
+    UBYTE name[40];
+    long i, errors = 0, len;
+    ULONG ch;
+    for (i = 0; i < NRTAGS; i++) {
+        len = strlen(tags[i].name);
+        Lower(name, tags[i].name);
+        if (Findtag(tags[i].name, len) != &tags[i] || Findtag(name, len) != &tags[i]) {
+            printf("tag %s not found\n", tags[i].name);
+            errors++;
+        }
+        strcpy(name, tags[i].name);
+        name[len - 1] = '\0';
+        if (Findtag(name, len - 1) != Oldfindtag(name)) {
+            printf("tag %s: wrong result for %s\n", tags[i].name, name);
+            errors++;
+        }
+        strcpy(name, tags[i].name);
+        strcat(name, "X");
+        if (Findtag(name, len + 1) != Oldfindtag(name)) {
+            printf("tag %s: wrong result for %s\n", tags[i].name, name);
+            errors++;
+        }
+    }
+    for (i = 0; i < NRATTRS; i++) {
+        len = strlen(tagattrs[i].name);
+        Lower(name, tagattrs[i].name);
+        if (Findattr(tagattrs[i].name, len) != &tagattrs[i] || Findattr(name, len) != &tagattrs[i]) {
+            printf("attribute %s not found\n", tagattrs[i].name);
+            errors++;
+        }
+        strcpy(name, tagattrs[i].name);
+        strcat(name, "S");
+        if (Findattr(name, len + 1) != Oldfindattr(name)) {
+            printf("attribute %s: wrong result for %s\n", tagattrs[i].name, name);
+            errors++;
+        }
+    }
+    for (i = 0; i < NRCHARS; i++) {
+        len = strlen(chars[i].name);
+        if (Findchar(chars[i].name, len) != &chars[i]) {
+            printf("entity %s not found\n", chars[i].name);
+            errors++;
+        }
+        /* Entities are case sensitive */
+        strcpy(name, chars[i].name);
+        name[0] = isupper(name[0]) ? tolower(name[0]) : toupper(name[0]);
+        if (Findchar(name, len) != Oldfindchar(name)) {
+            printf("entity %s: wrong result for %s\n", chars[i].name, name);
+            errors++;
+        }
+        sprintf(name, "&%s;x", chars[i].name);
+        if (Charref(name, name + strlen(name), TRUE, &ch) != len + 2 || ch != chars[i].ch) {
+            printf("entity %s: wrong reference\n", chars[i].name);
+            errors++;
+        }
+    }
+    if (Findtag("", 0) || Findattr("", 0) || Findchar("", 0)) {
+        printf("empty name found\n");
+        errors++;
+    }
+    return errors;
+}
+
+/* Check references that are not in the tables */
+static long Checkrefs(void)
+{
+    static struct {
+        char *text;
+        long length;
+        ULONG ch;
+    } refs[] = {
+        { "&#65;", 5, 65 },
+        { "&#65 ", 4, 65 },
+        { "&#x41;", 6, 65 },
+        { "&#X4a", 5, 74 },
+        { "&#8230;", 7, 8230 },
+        { "&amp", 4, '&' },
+        { "&ampx", 0, 0 },
+        { "&#;", 0, 0 },
+        { "&#x;", 0, 0 },
+        { "&#", 0, 0 },
+        { "&", 0, 0 },
+        { "& ", 0, 0 },
+        { "&zzz;", 0, 0 },
+        { NULL }
+    };
+    long i, l, errors = 0;
+    ULONG ch;
+    for (i = 0; refs[i].text; i++) {
+        ch = 0;
+        l = Charref(refs[i].text, refs[i].text + strlen(refs[i].text), FALSE, &ch);
+        if (l != refs[i].length || (l && ch != refs[i].ch)) {
+            printf("reference %s: length %ld char %lu\n", refs[i].text, l, (unsigned long)ch);
+            errors++;
+        }
+    }
+    return errors;
+}
+
+/*--------------------------------------------------------------------*/
+
+static char *words[] = {
+    "The", "quick", "brown", "fox", "jumps", "over", "the", "lazy", "dog", "caf&eacute;",
+    "&nbsp;", "&amp;", "&lt;b&gt;", "&copy;", "&#160;", "&#x2014;", "&hellip;", "na&iuml;ve",
+    "&quot;quoted&quot;", "&euro;", "&mdash;", "&laquo;", "&raquo;", "&#8217;", "&reg;",
+    "&sect;", "&frac12;", "&AElig;", "&szlig;", "&unknown;", "R&D", "&#65;&#66;&#67;",
+};
+
+static char *elements[] = {
+    "<p>", "</p>", "<br>", "<td align=left valign=top>", "</td>",
+    "<a href=\"page.html?a=1&amp;b=2\" title=\"Caf&eacute;\">", "</a>",
+    "<font face=\"Helvetica\" size=2 color=\"#000000\">", "</font>",
+    "<img src=\"x.gif\" width=10 height=10 border=0 alt=\"&lt;img&gt;\">",
+    "<table cellpadding=0 cellspacing=0 bgcolor=#ffffff>", "</table>",
+    "<TR>", "</TR>", "<span class=\"c\" style=\"x\">", "</span>", "<custom data-x=1>",
+};
+
+/* Make an entity heavy document of about (size) bytes */
+static UBYTE *Makedocument(long size, long *length)
+{
+    UBYTE *doc = malloc(size + 256), *p = doc;
+    char *s;
+    long n = 0;
+    if (!doc) return NULL;
+    srand(1);
+    while (p - doc < size) {
+        if (n++ % 6 == 0) s = elements[rand() % (sizeof(elements) / sizeof(*elements))];
+        else s = words[rand() % (sizeof(words) / sizeof(*words))];
+        strcpy(p, s);
+        p += strlen(s);
+        *p++ = ' ';
+    }
+    *length = p - doc;
+    return doc;
+}
+
+static void Benchmark(long size, long runs)
+{
+    UBYTE *doc;
+    long length, r;
+    ULONG oldsum = 0, newsum = 0;
+    clock_t oldtime, newtime, start;
+    double oldsecs, newsecs, mb;
+    if (!(doc = Makedocument(size, &length))) return;
+    start = clock();
+    for (r = 0; r < runs; r++) oldsum += Scan(doc, doc + length, TRUE);
+    oldtime = clock() - start;
+    start = clock();
+    for (r = 0; r < runs; r++) newsum += Scan(doc, doc + length, FALSE);
+    newtime = clock() - start;
+    if (oldsum != newsum) printf("Benchmark: lookups differ\n");
+    oldsecs = (double)oldtime / CLOCKS_PER_SEC;
+    newsecs = (double)newtime / CLOCKS_PER_SEC;
+    if (oldsecs <= 0) oldsecs = 0.001;
+    if (newsecs <= 0) newsecs = 0.001;
+    mb = (double)length * runs / 1e6;
+    printf("Benchmark: %.1f MB, binary and linear search %.2f s (%.1f MB/s), perfect hash %.2f s (%.1f MB/s), %.1fx\n",
+           mb, oldsecs, mb / oldsecs, newsecs, mb / newsecs, oldsecs / newsecs);
+    free(doc);
+}
+
+int main(int argc, char *argv[])
+{
+    long errors = 0, runs = 0;
+    if (argc > 1 && !strcmp(argv[1], "-h")) {
+        printf("Usage: HtmlNamesTest [-b <runs>]\n");
+        printf("Checks the tag, attribute and entity lookup against the old searches,\n");
+        printf("and with -b compares their speed on a 1 MB entity heavy document.\n");
+        return 0;
+    }
+    if (argc > 2 && !strcmp(argv[1], "-b")) runs = atol(argv[2]);
+    if (!Inithtmlnames()) {
+        printf("Perfect hash could not be built, using linear search\n");
+        errors++;
+    }
+    errors += Checknames();
+    errors += Checkrefs();
+    printf("%s: %ld tags, %ld attributes, %ld entities, %ld errors\n",
+           errors ? "FAILED" : "ok", (long)NRTAGS, (long)NRATTRS, (long)NRCHARS, errors);
+    if (runs > 0) Benchmark(1000000, runs);
+    return errors ? 10 : 0;
+}
@@ -0,0 +1,298 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb-II distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* HttpDecTest.c - Test and benchmark for the HTTP body decoder */
+
+#include <exec/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <string.h>
+#include <time.h>
+#include "zlib.h"
+#include "httpdec.h"
+
+#define OUTBUFSIZE 16384
+
+/* Collected decoder output */
+struct Output {
+    UBYTE *data;
+    long length;
+    long size;
+};
+
+static BOOL Collect(void *userdata, UBYTE *data, long length)
+{
+    struct Output *out = (struct Output *)userdata;
+    if (out->length + length > out->size) {
+        return FALSE;
+    }
+    memcpy(out->data + out->length, data, length);
+    out->length += length;
+    return TRUE;
+}
+
+static BOOL Discard(void *userdata, UBYTE *data, long length)
+{
+    *(long *)userdata += length;
+    return TRUE;
+}
+
+/* Read a whole file */
+static UBYTE *Readfile(char *name, long *length)
+{
+    FILE *f;
+    UBYTE *buf = NULL;
+    if ((f = fopen(name, "rb"))) {
+        fseek(f, 0, SEEK_END);
+        *length = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        if ((buf = malloc(*length + 1))) {
+            if (fread(buf, 1, *length, f) != (size_t)*length) {
+                free(buf);
+                buf = NULL;
+            }
+        }
+        fclose(f);
+    }
+    return buf;
+}
+
+/* Case insensitive header lookup. Returns pointer to the value or NULL. */
+static char *Findheader(char *headers, char *name)
+{
+    char *p;
+    long l = strlen(name);
+    for (p = headers; p && *p; p = strchr(p, '\n'), p = p ? p + 1 : NULL) {
+        long i;
+        for (i = 0; i < l && p[i] && toupper(p[i]) == toupper(name[i]); i++);
+        if (i == l && p[l] == ':') {
+            for (p += l + 1; *p == ' '; p++);
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/* Set up the decoder from the response headers */
+static void Setupdecoder(struct Httpdecoder *hd, char *headers)
+{
+    char *p;
+    memset(hd, 0, sizeof(*hd));
+    hd->framing = HDFR_CLOSE;
+    if ((p = Findheader(headers, "Transfer-Encoding")) && !strncmp(p, "chunked", 7)) {
+        hd->framing = HDFR_CHUNKED;
+    } else if ((p = Findheader(headers, "Content-Length"))) {
+        hd->framing = HDFR_LENGTH;
+        hd->length = atol(p);
+    }
+    if ((p = Findheader(headers, "Content-Encoding"))) {
+        if (!strncmp(p, "gzip", 4)) hd->coding = HDCO_GZIP;
+        else if (!strncmp(p, "deflate", 7)) hd->coding = HDCO_DEFLATE;
+    }
+}
+
+/* Decode (body) fed in two slices split at (split), or in slices of
+ * (step) bytes if (step) is nonzero. Returns TRUE if the output matches. */
+static BOOL Decode(char *headers, UBYTE *body, long bodylength, long split, long step,
+                   UBYTE *expect, long expectlength, UBYTE *outbuf)
+{
+    struct Httpdecoder hd;
+    struct Output out;
+    long pos = 0, n, want;
+    BOOL ok;
+
+    out.size = expectlength;
+    out.length = 0;
+    out.data = malloc(expectlength + 1);
+    Setupdecoder(&hd, headers);
+    hd.buffer = outbuf;
+    hd.bufsize = OUTBUFSIZE;
+    hd.sink = Collect;
+    hd.userdata = &out;
+    if (!out.data || !Inithttpdecoder(&hd)) {
+        printf("  cannot initialize decoder\n");
+        free(out.data);
+        return FALSE;
+    }
+    while (pos < bodylength && !(hd.flags & (HDF_END | HDF_ERROR | HDF_STOP))) {
+        if (step) want = step;
+        else want = ((pos < split) ? split : bodylength) - pos;
+        if (want > bodylength - pos) want = bodylength - pos;
+        n = Httpdecode(&hd, body + pos, want);
+        pos += n;
+        if (n < want && !(hd.flags & (HDF_END | HDF_ERROR | HDF_STOP))) {
+            printf("  decoder stopped early at %ld\n", pos);
+            break;
+        }
+    }
+    ok = Finishhttpdecoder(&hd);
+    Freehttpdecoder(&hd);
+    if (!ok) {
+        printf("  incomplete or malformed (flags 0x%04x, split %ld, step %ld)\n", hd.flags, split, step);
+    } else if (out.length != expectlength || memcmp(out.data, expect, expectlength)) {
+        printf("  output differs (%ld/%ld bytes, split %ld, step %ld)\n", out.length, expectlength, split, step);
+        ok = FALSE;
+    } else if (pos < bodylength && strncmp((char *)body + pos, "HTTP/", 5)) {
+        /* Only the next response may follow the body */
+        printf("  body ends at %ld of %ld (split %ld, step %ld)\n", pos, bodylength, split, step);
+        ok = FALSE;
+    }
+    free(out.data);
+    return ok;
+}
+
+/* Run one fixture: name.resp is a recorded response, name.out the expected body */
+static BOOL Runfixture(char *name)
+{
+    char fname[256];
+    UBYTE *resp, *expect, *body, *outbuf;
+    long resplength, expectlength, bodylength, split;
+    char *p;
+    BOOL ok = TRUE;
+
+    sprintf(fname, "%.240s.resp", name);
+    resp = Readfile(fname, &resplength);
+    sprintf(fname, "%.240s.out", name);
+    expect = Readfile(fname, &expectlength);
+    outbuf = malloc(OUTBUFSIZE);
+    if (!resp || !expect || !outbuf) {
+        printf("%s: cannot read fixture\n", name);
+        free(resp);
+        free(expect);
+        free(outbuf);
+        return FALSE;
+    }
+    resp[resplength] = '\0';
+    if (!(p = strstr((char *)resp, "\r\n\r\n"))) {
+        printf("%s: no end of headers\n", name);
+        ok = FALSE;
+    } else {
+        p[2] = '\0';
+        body = (UBYTE *)p + 4;
+        bodylength = resplength - (body - resp);
+        for (split = 0; ok && split <= bodylength; split++) {
+            ok = Decode((char *)resp, body, bodylength, split, 0, expect, expectlength, outbuf);
+        }
+        if (ok) {
+            ok = Decode((char *)resp, body, bodylength, 0, 1, expect, expectlength, outbuf);
+        }
+        printf("%s: %s (%ld body bytes, every split point and byte by byte)\n",
+               name, ok ? "ok" : "FAILED", bodylength);
+    }
+    free(resp);
+    free(expect);
+    free(outbuf);
+    return ok;
+}
+
+/* Throughput of chunked gzip decoding, fed in blocks as received from the network */
+static void Benchmark(long megabytes)
+{
+    long textlength = 1024L * 1024L, zlength, bodylength, pos, n, i, runs = megabytes;
+    UBYTE *text, *zdata, *body, *outbuf, *p;
+    z_stream zs;
+    struct Httpdecoder hd;
+    long total;
+    clock_t start, stop;
+    double secs;
+
+    text = malloc(textlength);
+    zdata = malloc(textlength + 1024);
+    body = malloc(textlength + 1024 + (textlength / 1000 + 1) * 16);
+    outbuf = malloc(OUTBUFSIZE);
+    if (!text || !zdata || !body || !outbuf) {
+        printf("Benchmark: out of memory\n");
+        return;
+    }
+    /* Reasonably compressible html-like text */
+    for (p = text, i = 0; p < text + textlength - 100; i++) {
+        p += sprintf((char *)p, "<tr><td class=\"c%ld\">%ld</td><td>row %ld</td></tr>\n", i % 7, i * 31 % 1000, i);
+    }
+    while (p < text + textlength) *p++ = '\n';
+    memset(&zs, 0, sizeof(zs));
+    deflateInit2(&zs, 6, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY);
+    zs.next_in = text;
+    zs.avail_in = textlength;
+    zs.next_out = zdata;
+    zs.avail_out = textlength + 1024;
+    deflate(&zs, Z_FINISH);
+    zlength = zs.total_out;
+    deflateEnd(&zs);
+    /* Chunk it the way servers commonly do */
+    for (p = body, pos = 0; pos < zlength; pos += n) {
+        n = zlength - pos;
+        if (n > 1000) n = 1000;
+        p += sprintf((char *)p, "%lx\r\n", n);
+        memcpy(p, zdata + pos, n);
+        p += n;
+        *p++ = '\r';
+        *p++ = '\n';
+    }
+    p += sprintf((char *)p, "0\r\n\r\n");
+    bodylength = p - body;
+
+    start = clock();
+    for (i = 0; i < runs; i++) {
+        memset(&hd, 0, sizeof(hd));
+        hd.framing = HDFR_CHUNKED;
+        hd.coding = HDCO_GZIP;
+        hd.buffer = outbuf;
+        hd.bufsize = OUTBUFSIZE;
+        hd.sink = Discard;
+        total = 0;
+        hd.userdata = &total;
+        Inithttpdecoder(&hd);
+        for (pos = 0; pos < bodylength; pos += n) {
+            n = bodylength - pos;
+            if (n > 1460) n = 1460;
+            Httpdecode(&hd, body + pos, n);
+        }
+        if (!Finishhttpdecoder(&hd) || total != textlength) {
+            printf("Benchmark: decoding failed\n");
+        }
+        Freehttpdecoder(&hd);
+    }
+    stop = clock();
+    secs = (double)(stop - start) / CLOCKS_PER_SEC;
+    if (secs <= 0) secs = 0.001;
+    printf("Benchmark: %ld MB decoded from %ld KB chunked gzip per MB in %.2f s (%.1f MB/s)\n",
+           runs, bodylength / 1024, secs, runs / secs);
+    free(text);
+    free(zdata);
+    free(body);
+    free(outbuf);
+}
+
+int main(int argc, char *argv[])
+{
+    int i, failed = 0;
+    if (argc < 2) {
+        printf("Usage: HttpDecTest [-b <megabytes>] fixture...\n");
+        printf("Each fixture is a recorded response (fixture.resp) and its decoded body (fixture.out).\n");
+        return 0;
+    }
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+            Benchmark(atol(argv[++i]));
+        } else if (!Runfixture(argv[i])) {
+            failed++;
+        }
+    }
+    return failed ? 10 : 0;
+}
@@ -0,0 +1,232 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb-II distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* NameservTest.c - Test for the name cache, using a stub resolver */
+
+#include <netdb.h>
+#include <exec/types.h>
+#include <exec/semaphores.h>
+#include <dos/dostags.h>
+#include <proto/exec.h>
+#include <proto/dos.h>
+#include <stdio.h>
+#include <string.h>
+#include "aweb.h"
+
+#define NRWAITERS 8
+
+/* Needed by nameserv.c */
+BOOL httpdebug=FALSE;
+struct SignalSemaphore debug_log_sema;
+BOOL debug_log_sema_initialized=FALSE;
+
+UBYTE *Dupstr(UBYTE *str,long length)
+{  UBYTE *dup;
+   if(!str) return NULL;
+   if(length<0) length=strlen(str);
+   if(dup=ALLOCTYPE(UBYTE,length+1,0))
+   {  memmove(dup,str,length);
+      dup[length]='\0';
+   }
+   return dup;
+}
+
+struct hostent *a_gethostbyname(char *name,struct Library *base)
+{  return NULL;
+}
+
+/*-----------------------------------------------------------------------*/
+
+/* The stub resolver. Names starting with "bad" fail, names starting with
+ * "multi" have 3 addresses, names starting with "slow" take a second.
+ * The second byte of each address is (variant). If (down) is set, all
+ * lookups fail. */
+
+static struct SignalSemaphore stubsema;
+static long calls;
+static UBYTE variant;
+static BOOL down;
+
+static struct hostent *Stubresolver(UBYTE *name,struct Library *base)
+{  static struct hostent hent;
+   static UBYTE addr[3][4];
+   static UBYTE *list[4];
+   short i,n;
+   ObtainSemaphore(&stubsema);
+   calls++;
+   ReleaseSemaphore(&stubsema);
+   if(STRNIEQUAL(name,"SLOW",4)) Delay(50);
+   if(down || STRNIEQUAL(name,"BAD",3)) return NULL;
+   n=STRNIEQUAL(name,"MULTI",5)?3:1;
+   for(i=0;i<n;i++)
+   {  addr[i][0]=10;
+      addr[i][1]=variant;
+      addr[i][2]=0;
+      addr[i][3]=i+1;
+      list[i]=addr[i];
+   }
+   list[n]=NULL;
+   hent.h_name=name;
+   hent.h_aliases=NULL;
+   hent.h_addrtype=AF_INET;
+   hent.h_length=4;
+   hent.h_addr_list=(char **)list;
+   return &hent;
+}
+
+/*-----------------------------------------------------------------------*/
+
+static long failed;
+
+static void Check(BOOL ok,char *what)
+{  if(!ok)
+   {  printf("FAILED: %s\n",what);
+      failed++;
+   }
+}
+
+/* Processes looking up the same slow name at the same time */
+static struct SignalSemaphore donesema;
+static struct hostent *results[NRWAITERS];
+static long nrdone;
+
+static __saveds void Waiterproc(void)
+{  struct Task *task=FindTask(NULL);
+   long i=(long)task->tc_UserData;
+   results[i]=Lookup("slow.test",NULL);
+   ObtainSemaphore(&donesema);
+   nrdone++;
+   ReleaseSemaphore(&donesema);
+}
+
+static void Testcoalesce(void)
+{  struct Process *proc;
+   long i,n=0;
+   calls=0;
+   nrdone=0;
+   Forbid();
+   for(i=0;i<NRWAITERS;i++)
+   {  if(proc=CreateNewProcTags(
+         NP_Entry,Waiterproc,
+         NP_Name,"NameservTest waiter",
+         NP_StackSize,8000,
+         TAG_END))
+      {  proc->pr_Task.tc_UserData=(APTR)i;
+         n++;
+      }
+   }
+   Permit();
+   for(;;)
+   {  ObtainSemaphore(&donesema);
+      i=nrdone;
+      ReleaseSemaphore(&donesema);
+      if(i>=n) break;
+      Delay(5);
+   }
+   Check(n==NRWAITERS,"start waiter processes");
+   Check(calls==1,"concurrent lookups resolve once");
+   for(i=1;i<n;i++)
+   {  Check(results[i] && results[i]==results[0],"concurrent lookups share result");
+   }
+}
+
+static void Testcache(void)
+{  struct hostent *hent,*hent2;
+   UBYTE buf[32];
+   long i;
+
+   calls=0;
+   hent=Lookup("a.test",NULL);
+   Check(hent && calls==1,"resolve name");
+   Check(hent && hent->h_addr_list[0][3]==1 && !hent->h_addr_list[1],"single address");
+   hent2=Lookup("A.Test",NULL);
+   Check(hent2==hent && calls==1,"cached, case insensitive");
+
+   Check(!Lookup("bad.test",NULL) && calls==2,"failed lookup");
+   Check(!Lookup("bad.test",NULL) && calls==2,"failed lookup cached");
+
+   hent=Lookup("multi.test",NULL);
+   Check(hent && hent->h_addr_list[2] && !hent->h_addr_list[3],"multiple addresses");
+   if(hent)
+   {  Nextaddress(hent);
+      Check(hent->h_addr_list[0][3]==2 && hent->h_addr_list[2][3]==1,"next address");
+   }
+
+   calls=0;
+   for(i=0;i<1000;i++)
+   {  sprintf(buf,"host%ld.test",i);
+      Lookup(buf,NULL);
+   }
+   for(i=0;i<1000;i++)
+   {  sprintf(buf,"host%ld.test",i);
+      Lookup(buf,NULL);
+   }
+   Check(calls==1000,"many names cached");
+}
+
+static void Testexpiry(void)
+{  struct hostent *hent,*hent2;
+   /* Names expire after 1 second */
+   Setnameresolver(Stubresolver,1,1);
+   calls=0;
+   hent=Lookup("b.test",NULL);
+   Check(!Lookup("bad2.test",NULL),"failed lookup");
+   Delay(2*TICKS_PER_SECOND+10);
+   hent2=Lookup("b.test",NULL);
+   Check(calls==3 && hent2==hent,"expired name refreshed in place");
+   Lookup("bad2.test",NULL);
+   Check(calls==4,"expired failure retried");
+   variant=7;
+   Delay(2*TICKS_PER_SECOND+10);
+   hent2=Lookup("b.test",NULL);
+   Check(hent2 && hent2!=hent && hent2->h_addr_list[0][1]==7,"changed addresses");
+   Check(hent->h_addr_list[0][1]==0,"old entry kept");
+   hent=hent2;
+   down=TRUE;
+   Delay(2*TICKS_PER_SECOND+10);
+   calls=0;
+   hent2=Lookup("b.test",NULL);
+   Check(calls==1 && hent2==hent && hent2->h_addr_list[0][1]==7,
+      "failed refresh keeps addresses");
+   hent2=Lookup("b.test",NULL);
+   Check(calls==1 && hent2==hent,"failed refresh cached");
+   Delay(2*TICKS_PER_SECOND+10);
+   down=FALSE;
+   hent2=Lookup("b.test",NULL);
+   Check(calls==2 && hent2==hent,"refresh after failure in place");
+   variant=0;
+   Setnameresolver(Stubresolver,0,0);
+}
+
+int main(int argc,char *argv[])
+{  InitSemaphore(&stubsema);
+   InitSemaphore(&donesema);
+   if(!Initmemory() || !Initnameserv())
+   {  printf("Can't initialize\n");
+      return 20;
+   }
+   Setnameresolver(Stubresolver,0,0);
+   Testcache();
+   Testcoalesce();
+   Testexpiry();
+   Freenameserv();
+   Freememory();
+   if(failed) printf("%ld checks failed\n",failed);
+   else printf("All checks passed\n");
+   return failed?10:0;
+}
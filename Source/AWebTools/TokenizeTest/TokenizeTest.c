@@ -0,0 +1,383 @@
+/**********************************************************************
+ *
+ * This file is part of the AWeb-II distribution
+ *
+ * Copyright (C) 2002 Yvon Rozijn
+ * Changes Copyright (C) 2025 amigazen project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the AWeb Public License as included in this
+ * distribution.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * AWeb Public License for more details.
+ *
+ **********************************************************************/
+
+/* TokenizeTest.c - Test and benchmark for the HTML tokenizer */
+
+#include <exec/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#include "htmlnames.c"
+#include "tokenize.c"
+
+/* As in aweb.c */
+BOOL Issgmlchar(UBYTE c)
+{
+    return (BOOL)(c > ' ' && c < 0x7f && !strchr("\"&',;<=>`", c));
+}
+
+/*--------------------------------------------------------------------*/
+/* Token lists                                                        */
+/*--------------------------------------------------------------------*/
+
+struct Tokenlist {
+    struct Token *tokens;
+    long count, size;
+    struct Tokenattr *attrs;
+    long nattrs, attrsize;
+    long limit;             /* Pause after this many tokens, or 0 */
+    long emitted;
+};
+
+static BOOL Addtoken(struct Tokenlist *tl, struct Token *tk)
+{
+    if (tl->count == tl->size) {
+        tl->size = tl->size * 2 + 256;
+        tl->tokens = realloc(tl->tokens, tl->size * sizeof(struct Token));
+    }
+    if (tl->nattrs + tk->nattrs >= tl->attrsize) {
+        tl->attrsize = tl->attrsize * 2 + tk->nattrs + 1024;
+        tl->attrs = realloc(tl->attrs, tl->attrsize * sizeof(struct Tokenattr));
+    }
+    if (!tl->tokens || !tl->attrs) {
+        printf("Out of memory\n");
+        exit(20);
+    }
+    tl->tokens[tl->count] = *tk;
+    /* Store the index, the array may move */
+    tl->tokens[tl->count].attrs = (struct Tokenattr *)tl->nattrs;
+    memcpy(tl->attrs + tl->nattrs, tk->attrs, tk->nattrs * sizeof(struct Tokenattr));
+    tl->nattrs += tk->nattrs;
+    tl->count++;
+    return (BOOL)(!tl->limit || ++tl->emitted % tl->limit);
+}
+
+static struct Tokenattr *Attrs(struct Tokenlist *tl, struct Token *tk)
+{
+    return tl->attrs + (long)tk->attrs;
+}
+
+static void Freelist(struct Tokenlist *tl)
+{
+    free(tl->tokens);
+    free(tl->attrs);
+    memset(tl, 0, sizeof(*tl));
+}
+
+/* Tokenize (length) bytes of (src) as if it arrived in blocks of (block)
+ * bytes, like the token task does. */
+static void Tokenizeall(struct Tokenlist *tl, UBYTE *src, long length,
+    USHORT lexmode, long block, long limit)
+{
+    struct Tokenizer tkz = { 0 };
+    long avail = 0;
+    short result;
+    memset(tl, 0, sizeof(*tl));
+    tl->limit = limit;
+    tkz.lexmode = lexmode;
+    tkz.emit = (BOOL (*)(void *, struct Token *))Addtoken;
+    tkz.userdata = tl;
+    tkz.maxattrs = 4;
+    tkz.attrs = malloc(tkz.maxattrs * sizeof(struct Tokenattr));
+    Inittokenizer(&tkz);
+    while (avail < length) {
+        avail += block;
+        if (avail > length) avail = length;
+        do {
+            result = Tokenize(&tkz, src, avail);
+            if (result == TKZ_FULL) {
+                tkz.maxattrs *= 2;
+                tkz.attrs = realloc(tkz.attrs, tkz.maxattrs * sizeof(struct Tokenattr));
+            }
+        } while (result != TKZ_MORE);
+    }
+    free(tkz.attrs);
+}
+
+static BOOL Sametoken(struct Tokenlist *l1, struct Token *t1,
+    struct Tokenlist *l2, struct Token *t2, struct Tokenattr *a2)
+{
+    struct Tokenattr *a1;
+    long i;
+    if (t1->pos != t2->pos || t1->length != t2->length || t1->type != t2->type
+    || t1->flags != t2->flags || t1->nattrs != t2->nattrs) return FALSE;
+    a1 = Attrs(l1, t1);
+    if (!a2) a2 = Attrs(l2, t2);
+    for (i = 0; i < t1->nattrs; i++) {
+        if (a1[i].name != a2[i].name || a1[i].namelength != a2[i].namelength
+        || a1[i].value != a2[i].value || a1[i].valuelength != a2[i].valuelength
+        || a1[i].attr != a2[i].attr || a1[i].flags != a2[i].flags) return FALSE;
+    }
+    return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+/* Checks                                                             */
+/*--------------------------------------------------------------------*/
+
+static char *modenames[] = { "strict", "tolerant", "compatible" };
+static USHORT modes[] = { LXM_STRICT, 0, LXM_COMPATIBLE };
+
+/* Tokens must not depend on how the source arrives, and every tag token
+ * must be what the parser gets when it lexes the tag itself. */
+static long Check(char *name, UBYTE *src, long length)
+{
+    static long blocks[] = { 1, 2, 7, 61, 1460, 8192 };
+    struct Tokenlist whole, split;
+    struct Token tk;
+    struct Tokenattr *attrs;
+    long m, b, i, n, errors = 0;
+    for (m = 0; m < 3; m++) {
+        Tokenizeall(&whole, src, length, modes[m], length, 0);
+        for (b = 0; b < sizeof(blocks) / sizeof(blocks[0]); b++) {
+            Tokenizeall(&split, src, length, modes[m], blocks[b], b % 2 ? 5 : 0);
+            if (split.count != whole.count) {
+                printf("%s %s: %ld tokens in blocks of %ld, %ld in one go\n",
+                    name, modenames[m], split.count, blocks[b], whole.count);
+                errors++;
+            } else {
+                for (i = 0; i < whole.count; i++) {
+                    if (!Sametoken(&whole, &whole.tokens[i], &split, &split.tokens[i], NULL)) {
+                        printf("%s %s: token at %ld differs in blocks of %ld\n",
+                            name, modenames[m], whole.tokens[i].pos, blocks[b]);
+                        errors++;
+                        break;
+                    }
+                }
+            }
+            Freelist(&split);
+        }
+        attrs = malloc(65536 * sizeof(struct Tokenattr));
+        for (i = 0; i < whole.count; i++) {
+            struct Token *t = &whole.tokens[i];
+            if (t->flags & TKF_COMMENT) continue;
+            n = Lextagname(src + t->pos, src + length, &tk);
+            if (n > 0) n = Lextagattrs(src + t->pos, src + length, n, modes[m], &tk, attrs, 65536);
+            if (n <= 0 || (tk.pos = t->pos, !Sametoken(&whole, t, NULL, &tk, attrs))) {
+                printf("%s %s: token at %ld is not what the parser lexes\n",
+                    name, modenames[m], t->pos);
+                errors++;
+                break;
+            }
+        }
+        free(attrs);
+        if (m == 1) {
+            printf("%s: %ld bytes, %ld tokens, %ld attributes\n",
+                name, length, whole.count, whole.nattrs);
+        }
+        Freelist(&whole);
+    }
+    return errors;
+}
+
+/*--------------------------------------------------------------------*/
+/* Benchmark                                                          */
+/*--------------------------------------------------------------------*/
+
+static UBYTE *args;
+static long argsize;
+
+/* What the parser does with a tag after it is lexed: copy the values. */
+static long Build(UBYTE *p, struct Token *tk, struct Tokenattr *attrs)
+{
+    long i, n = 0;
+    UBYTE *v, *vend;
+    for (i = 0; i < tk->nattrs; i++) {
+        if (!(attrs[i].flags & TAF_VALUE)) continue;
+        v = p + attrs[i].value;
+        vend = v + attrs[i].valuelength;
+        if (n + (vend - v) + 1 > argsize) break;
+        for (; v < vend; v++) {
+            if (*v == '\r' || *v == '\n') args[n++] = ' ';
+            else args[n++] = *v;
+        }
+        args[n++] = '\0';
+    }
+    return n;
+}
+
+/* The parser on its own: find the tags and lex them */
+static long Parseinline(UBYTE *src, long length, USHORT lexmode)
+{
+    static struct Tokenattr attrs[4096];
+    UBYTE *p = src, *end = src + length, *q;
+    struct Token tk;
+    long n, sum = 0;
+    USHORT raw;
+    while (p < end) {
+        if (*p == '<' && p < end - 1 && (isalpha(p[1]) || p[1] == '/')) {
+            n = Lextagname(p, end, &tk);
+            if (n > 0) n = Lextagattrs(p, end, n, lexmode, &tk, attrs, 4096);
+            if (n <= 0) break;
+            sum += Build(p, &tk, attrs) + tk.type;
+            p += n;
+            if (tk.type == MARKUP_SCRIPT || tk.type == MARKUP_XMP || tk.type == MARKUP_LISTING) {
+                /* The parser copies the contents in data mode */
+                raw = tk.type | MARKUP_END;
+                while ((q = memchr(p, '<', end - p)) && q < end - 1
+                && (q[1] != '/' || Lextagname(q, end, &tk) <= 0 || tk.type != raw)) p = q + 1;
+                if (!q) break;
+                p = q;
+            }
+        } else if (*p == '<' && p < end - 3 && p[1] == '!' && p[2] == '-' && p[3] == '-') {
+            if (!(q = Parsecommenttolerant(p + 4, end, TRUE))) break;
+            p = q;
+        } else {
+            if (!(q = memchr(p + 1, '<', end - p - 1))) break;
+            p = q;
+        }
+    }
+    return sum;
+}
+
+/* The parser with tokens: use the token at each tag */
+static long Parsetokens(UBYTE *src, long length, struct Tokenlist *tl)
+{
+    UBYTE *p = src, *end = src + length, *q;
+    struct Token *tk = tl->tokens, *tkend = tl->tokens + tl->count;
+    long sum = 0;
+    while (p < end) {
+        while (tk < tkend && src + tk->pos < p) tk++;
+        if (tk < tkend && src + tk->pos == p) {
+            sum += Build(p, tk, Attrs(tl, tk)) + tk->type;
+            p += tk->length;
+        } else {
+            if (!(q = memchr(p + 1, '<', end - p - 1))) break;
+            p = q;
+        }
+    }
+    return sum;
+}
+
+static double Seconds(clock_t t)
+{
+    return (double)t / CLOCKS_PER_SEC;
+}
+
+static void Bench(char *name, UBYTE *src, long length, long runs)
+{
+    struct Tokenlist tl;
+    clock_t start, inlinetime, producetime = 0, consumetime = 0;
+    long i, sum1 = 0, sum2 = 0;
+    start = clock();
+    for (i = 0; i < runs; i++) sum1 += Parseinline(src, length, 0);
+    inlinetime = clock() - start;
+    for (i = 0; i < runs; i++) {
+        start = clock();
+        Tokenizeall(&tl, src, length, 0, 1460, 64);
+        producetime += clock() - start;
+        start = clock();
+        sum2 += Parsetokens(src, length, &tl);
+        consumetime += clock() - start;
+        Freelist(&tl);
+    }
+    if (sum1 != sum2) printf("%s: parser results differ\n", name);
+    printf("%s: main task %.3f s without tokens, %.3f s with tokens (%.0f%%), token task %.3f s\n",
+        name, Seconds(inlinetime), Seconds(consumetime),
+        inlinetime ? 100.0 * consumetime / inlinetime : 0.0, Seconds(producetime));
+}
+
+/*--------------------------------------------------------------------*/
+
+static char *elements[] = {
+    "<p>", "</p>", "<br>", "<td align=left valign=top>", "</td>",
+    "<a href=\"page.html?a=1&amp;b=2\" title=\"Caf&eacute;\">", "</a>",
+    "<font face=\"Helvetica\" size=2 color=\"#000000\">", "</font>",
+    "<img src=\"x.gif\" width=10 height=10 border=0 alt=\"&lt;img&gt;\">",
+    "<!-- comment -->", "<table width=\"100%\"\n cellpadding=0 cellspacing=0>", "</table>",
+    "<input type=hidden name=\"q\" value=\"a\r\nb\">", "<embed src=x.mid autostart=true>",
+    "<script>if(a<b && c>d) document.write('<b>');</script>", "<div\nclass='x' id=y>",
+    "</div>", "a < b", "text with more words ", "<!DOCTYPE html>", "<!---->",
+};
+
+/* A page with the tags of a table-layout site */
+static UBYTE *Makepage(long size)
+{
+    UBYTE *page = malloc(size + 256), *p = page;
+    long n = 0;
+    srand(1);
+    while (p - page < size) {
+        strcpy(p, elements[rand() % (sizeof(elements) / sizeof(elements[0]))]);
+        p += strlen(p);
+        n++;
+    }
+    return page;
+}
+
+static UBYTE *Readfile(char *name, long *length)
+{
+    FILE *f;
+    UBYTE *buf = NULL;
+    if (f = fopen(name, "rb")) {
+        fseek(f, 0, SEEK_END);
+        *length = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        if (buf = malloc(*length + 1)) {
+            if (fread(buf, 1, *length, f) != *length) {
+                free(buf);
+                buf = NULL;
+            }
+        }
+        fclose(f);
+    }
+    if (!buf) printf("Can't read %s\n", name);
+    return buf;
+}
+
+int main(int argc, char *argv[])
+{
+    long runs = 0, errors = 0, length, i;
+    UBYTE *src;
+    if (argc > 1 && !strcmp(argv[1], "-h")) {
+        printf("Usage: TokenizeTest [-b <runs>] [page.html ...]\n");
+        printf("Checks that the tokens don't depend on how the source arrives and are\n");
+        printf("what the parser lexes itself, and with -b compares the main task time\n");
+        printf("of the parser with and without the token task.\n");
+        return 0;
+    }
+    i = 1;
+    if (argc > 2 && !strcmp(argv[1], "-b")) {
+        runs = atol(argv[2]);
+        i = 3;
+    }
+    Inithtmlnames();
+    argsize = 65536;
+    args = malloc(argsize);
+    if (i >= argc) {
+        length = 256 * 1024;
+        src = Makepage(length);
+        errors += Check("generated", src, length);
+        if (runs) Bench("generated", src, length, runs);
+        free(src);
+    }
+    for (; i < argc; i++) {
+        if (!(src = Readfile(argv[i], &length))) {
+            errors++;
+            continue;
+        }
+        errors += Check(argv[i], src, length);
+        if (runs) Bench(argv[i], src, length, runs);
+        free(src);
+    }
+    printf("%ld errors\n", errors);
+    free(args);
+    return errors ? 20 : 0;
+}